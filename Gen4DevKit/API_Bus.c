@@ -0,0 +1,136 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+#include <string.h>
+#include "API_Bus.h"
+#include "API_Hardware.h"
+#include "API_Trace.h"
+#include "I2C.h"
+
+/***********************************************************/
+/***********************************************************/
+/********************* MODULE VARIABLES ********************/
+
+static busDevice_t* _devices[BUS_MAX_DEVICES];
+static uint8_t _deviceCount = 0;
+static uint32_t _clockFrequency = 0;   /**< Clock the bus runs at, 0 before it started */
+
+/***********************************************************/
+/***********************************************************/
+/********************* HELPER FUNCTIONS ********************/
+
+static void begin(busDevice_t* device)
+{
+    if(device->depth++ != 0)
+    {
+        return;
+    }
+    if(device->clockFrequency != _clockFrequency)
+    {
+        I2C_setClock(device->clockFrequency);
+        _clockFrequency = device->clockFrequency;
+        device->stats.clockChanges++;
+    }
+    TRACE_BEGIN(TRACE_ID_I2C, device->address);
+    device->acquiredUs = API_Hardware_micros();
+}
+
+/***********************************************************/
+/***********************************************************/
+/******************* IMPORTANT FUNCTIONS *******************/
+
+/** Registers a device on the bus, starting the bus for the first one. 
+    Registering a device again updates its settings (a driver re-initialized 
+    with another clock) without touching the bus. */
+void API_Bus_addDevice(busDevice_t* device)
+{
+    uint8_t i;
+
+    for(i = 0; i < _deviceCount && _devices[i] != device; i++);
+    if(i == _deviceCount)
+    {
+        if(_deviceCount == BUS_MAX_DEVICES)
+        {
+            return;
+        }
+        _devices[_deviceCount++] = device;
+    }
+    if(_clockFrequency == 0)
+    {
+        I2C_init(device->clockFrequency);
+        _clockFrequency = device->clockFrequency;
+    }
+    else if(device->clockFrequency == 0)
+    {
+        device->clockFrequency = _clockFrequency;
+    }
+}
+
+/** True if no device of higher priority has work waiting */
+bool API_Bus_isFree(const busDevice_t* device)
+{
+    for(uint8_t i = 0; i < _deviceCount; i++)
+    {
+        const busDevice_t* other = _devices[i];
+        if(other->priority < device->priority && other->pending != 0 && other->pending())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/** Takes the bus for an operation of device. Returns false, without 
+    touching the bus, if a higher priority device has work waiting; the 
+    operation has to be tried again later. Acquires nest. */
+bool API_Bus_acquire(busDevice_t* device)
+{
+    if(device->depth == 0 && !API_Bus_isFree(device))
+    {
+        device->stats.deferrals++;
+        return false;
+    }
+    begin(device);
+    return true;
+}
+
+/** Takes the bus regardless of other devices, for operations that cannot 
+    be put off (setup, or finishing what an earlier operation started) */
+void API_Bus_acquireNow(busDevice_t* device)
+{
+    begin(device);
+}
+
+/** Ends an operation started with API_Bus_acquire or API_Bus_acquireNow */
+void API_Bus_release(busDevice_t* device)
+{
+    if(device->depth == 0 || --device->depth != 0)
+    {
+        return;
+    }
+    uint32_t elapsed = API_Hardware_micros() - device->acquiredUs;
+    TRACE_END(TRACE_ID_I2C, device->address);
+    device->stats.operations++;
+    device->stats.totalUs += elapsed;
+    if(elapsed > device->stats.maxUs)
+    {
+        device->stats.maxUs = elapsed;
+    }
+}
+
+void API_Bus_resetStats(void)
+{
+    for(uint8_t i = 0; i < _deviceCount; i++)
+    {
+        memset(&_devices[i]->stats, 0, sizeof(busStats_t));
+    }
+}
+
+uint8_t API_Bus_getDeviceCount(void)
+{
+    return _deviceCount;
+}
+
+const busDevice_t* API_Bus_getDevice(uint8_t index)
+{
+    return (index < _deviceCount) ? _devices[index] : 0;
+}
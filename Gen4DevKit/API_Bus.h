@@ -0,0 +1,93 @@
+#ifndef API_BUS_H
+#define API_BUS_H
+
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+/**@file API_Bus.h
+   @brief Shares the one I2C bus between the devices on it.
+
+   The touchpad (API_HostBus) and the INA219 current sense are on the same
+   Wire bus. Each driver registers a busDevice_t with its address, clock and
+   priority. The first registration starts the bus (I2C_init); later ones
+   never re-initialize it under a driver that is already using it.
+
+   A driver wraps each operation, one or more transactions that belong
+   together, in API_Bus_acquire and API_Bus_release. Acquiring sets the
+   device's clock if the last device ran at another one, and the time until
+   release is counted against the device.
+
+   Priorities: a device can say it has work waiting (pending(), for the pad
+   its Data Ready line). Acquiring for a lower priority device fails while a
+   higher priority one has work waiting, so a DR read never waits behind
+   queued INA219 traffic. The caller backs off and tries again later; tasks
+   use API_Bus_isFree as their ready() predicate (see API_Scheduler.h) so
+   they only run when they will get the bus. Nothing is preempted part way
+   through an operation. */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/***********************************************************/
+/***********************************************************/
+/******************* PROVIDED DEFINES **********************/
+
+#define BUS_MAX_DEVICES         (4)
+
+/** Priorities, highest first */
+#define BUS_PRIORITY_TOUCH      (0)
+#define BUS_PRIORITY_SENSOR     (1)
+
+/***********************************************************/
+/***********************************************************/
+/****************** PUBLIC DATA STRUCTURES *****************/
+
+typedef struct
+{
+    uint32_t operations;     /**< Acquire/release pairs */
+    uint32_t deferrals;      /**< Acquires refused for a higher priority device */
+    uint32_t clockChanges;   /**< Times the bus clock was switched for this device */
+    uint32_t maxUs;          /**< Longest operation */
+    uint64_t totalUs;        /**< Time holding the bus */
+} busStats_t;
+
+typedef struct busDevice
+{
+    const char* name;
+    uint8_t     address;
+    uint32_t    clockFrequency;
+    uint8_t     priority;          /**< BUS_PRIORITY_ */
+    bool      (*pending)(void);    /**< NULL, or true while the device has work waiting */
+
+    /* Bus state, zero it before API_Bus_addDevice */
+    uint8_t     depth;             /**< Nested acquires */
+    uint32_t    acquiredUs;
+    busStats_t  stats;
+} busDevice_t;
+
+/***********************************************************/
+/***********************************************************/
+/******************* IMPORTANT FUNCTIONS *******************/
+
+void API_Bus_addDevice(busDevice_t* device);
+
+bool API_Bus_isFree(const busDevice_t* device);
+
+bool API_Bus_acquire(busDevice_t* device);
+
+void API_Bus_acquireNow(busDevice_t* device);
+
+void API_Bus_release(busDevice_t* device);
+
+void API_Bus_resetStats(void);
+
+uint8_t API_Bus_getDeviceCount(void);
+
+const busDevice_t* API_Bus_getDevice(uint8_t index);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // API_BUS_H
@@ -1,89 +1,33 @@
 // Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
 
 #include "API_C2.h"
+#include "API_Trace.h"
+#include <string.h>
 
 /***********************************************************/
 /***********************************************************/
-/********************* HELPER FUNCTIONS ********************/
+/********************* MODULE VARIABLES ********************/
 
-/** Decodes a packet of a mouse report and puts it into result. */
-void decodeMouseReport(uint8_t* packet, report_t* result)
-{
-    uint8_t* iter = &packet[2];
-    if(*iter != MOUSE_REPORT_ID)
-    {
-        // not a mouse report 
-        return; 
-    }
+/** Factory calibration steps, see API_C2_pollFactoryCalibrate() */
+#define CAL_IDLE            (0)
+#define CAL_SETTLE          (1)  /**< Calibrate bit set, give the firmware 20 ms */
+#define CAL_WAIT_CALIBRATE  (2)  /**< Waiting for the firmware to clear the calibrate bit */
+#define CAL_WAIT_PERSIST    (3)  /**< Waiting for the calibration to be saved */
 
-    iter++;
-    result->mouse.buttons = *iter++;
-    result->mouse.xDelta = (int8_t) *iter++;
-    result->mouse.yDelta = (int8_t) *iter++;
-    result->mouse.scrollDelta = (int8_t) *iter++;
-    result->mouse.panDelta = (int8_t) *iter;
-}
+static uint8_t  _calState = CAL_IDLE;
+static uint8_t  _calValue;       /**< 0xC2C4 with the calibrate bit set */
+static uint32_t _calStepStart;   /**< micros() when the current step began */
 
-/** Decodes a keyboard report packet into result. */
-void decodeKeyboardReport(uint8_t* packet, report_t* result)
-{
-    uint8_t* iter = &packet[2];
-    if(*iter != KEYBOARD_REPORT_ID)
-    {
-        // not a keyboard report 
-        return; // probably shouldn't leave cleanly
-    }
-  
-    iter++;
-    result->keyboard.modifier = *iter++;
-    iter++;             //reserved byte
-    result->keyboard.keycode[0] = *iter++;
-    result->keyboard.keycode[1] = *iter++;
-    result->keyboard.keycode[2] = *iter++;
-    result->keyboard.keycode[3] = *iter++;
-    result->keyboard.keycode[4] = *iter++;
-    result->keyboard.keycode[5] = *iter++;
-}
+static bool     _reportRetryPending = false; /**< The last report read failed, see API_C2_reportWaiting() */
+static uint32_t _reportFailedUs;             /**< micros() when it did */
 
-void decodeCirqueAbsoluteReport(uint8_t* packet, report_t* result)
-{
-    uint8_t* iter = &packet[2];
-    if(*iter != CRQ_ABSOLUTE_REPORT_ID)
-    {
-        // not a absolute report 
-        return; 
-    }
-    iter++;
-    result->abs.contactFlags = *iter++;
-    uint8_t i;
-    for(i = 0; i < 5; i++)
-    {
-        result->abs.fingers[i].palm = *iter++;
-        
-        result->abs.fingers[i].x = (uint16_t ) *iter++;
-        result->abs.fingers[i].x |= (uint16_t ) *iter++ << 8;
-        
-        result->abs.fingers[i].y = (uint16_t ) *iter++;
-        result->abs.fingers[i].y |= (uint16_t ) *iter++ << 8;
-    }
-    result->abs.buttons = *iter;
-}
+/***********************************************************/
+/***********************************************************/
+/********************* HELPER FUNCTIONS ********************/
 
-/** Clears all values of report to zero. 
-    Assumes absolute report is the largest of the union. */
-void clearReport(report_t* report)
+static uint16_t get16bit(const uint8_t* data)
 {
-    report->reportID = 0;
-    // Clears the values in the Union.
-    report->abs.contactFlags = 0;
-    uint8_t i;
-    for(i = 0; i < 5; i++) // each of the 5 fingers
-    {
-        report->abs.fingers[i].palm = 0;
-        report->abs.fingers[i].x = 0;
-        report->abs.fingers[i].y = 0;
-    }
-    report->abs.buttons = 0;
+    return (uint16_t)(data[0] | (data[1] << 8));
 }
 
 uint16_t read16bitRegister(uint32_t address)
@@ -113,6 +57,19 @@ bool API_C2_DR_Asserted(void)
     return (HB_DR_Asserted()); 
 }
 
+/** True when DR is asserted and a report should be read, which is not 
+    until REPORT_RETRY_US after a failed read. Only the time since that 
+    failure is compared, and only while the retry is pending, so the result 
+    does not depend on how long the board has been running. */
+bool API_C2_reportWaiting(uint32_t nowUs)
+{
+    if(_reportRetryPending && nowUs - _reportFailedUs >= REPORT_RETRY_US)
+    {
+        _reportRetryPending = false;
+    }
+    return !_reportRetryPending && API_C2_DR_Asserted();
+}
+
 /** Reads a report from the Host Bus. The report is read and 
 	decoded into the result parameter. Call this when the 
 	DR line is asserted. */
@@ -120,8 +77,38 @@ void API_C2_getReport(report_t* result) //<-- double check this function with HI
 {
     //read packet
     uint8_t packet[PACKET_SIZE]; 
-    HB_readReport(packet, PACKET_SIZE); //fills packet with i2c packet
+    API_C2_getReportPacket(packet, result);
+}
+
+/** Same as API_C2_getReport, but the raw packet (PACKET_SIZE bytes) 
+    is also left in packet for callers that log or forward it. 
+    Returns the HB_readReport status. */
+uint8_t API_C2_getReportPacket(uint8_t* packet, report_t* result)
+{
+    uint8_t status = API_C2_readReportPacket(packet);
     API_C2_decodeReport(packet, result);
+    return status;
+}
+
+/** Reads a report into packet (PACKET_SIZE bytes) without decoding it. 
+    Use API_C2_viewReport to get at its fields in place. Every packet 
+    read successfully is kept by the flight recorder (see API_Recorder.h). 
+    Returns the HB_readReport status. */
+uint8_t API_C2_readReportPacket(uint8_t* packet)
+{
+    TRACE_BEGIN(TRACE_ID_REPORT, 0);
+    uint8_t status = HB_readReport(packet, PACKET_SIZE); //fills packet with i2c packet
+    _reportRetryPending = (status != SUCCESS);
+    if(status == SUCCESS)
+    {
+        API_Recorder_recordPacket(API_Hardware_micros(), packet, PACKET_SIZE);
+    }
+    else
+    {
+        _reportFailedUs = API_Hardware_micros();
+    }
+    TRACE_END(TRACE_ID_REPORT, (status == SUCCESS) ? packet[2] : 0);
+    return status;
 }
 
 /** Reads the contents of a register at a given address */
@@ -136,18 +123,72 @@ uint8_t API_C2_readRegister(uint32_t address)
     modify the necessary bits, then write it back. */
 void API_C2_writeRegister(uint32_t address, uint8_t value)
 {
-    HB_writeExtendedMemory(address, &value, 1);
+    API_C2_writeMemory(address, &value, 1);
+}
+
+/** Reads count bytes of extended memory starting at address. 
+    Returns the HB_readExtendedMemory status (SUCCESS, BAD_CHECKSUM, 
+    LENGTH_MISMATCH, BUS_TIMEOUT, NO_RESPONSE). */
+uint8_t API_C2_readMemory(uint32_t address, uint8_t* data, uint16_t count)
+{
+    return HB_readExtendedMemory(address, data, count);
 }
 
-/** Reads the System info and puts it into result. */
-void API_C2_readSystemInfo(systemInfo_t* result)
+/** Writes count bytes of extended memory starting at address. 
+    The write is kept by the flight recorder. Returns the 
+    HB_writeExtendedMemory status. */
+uint8_t API_C2_writeMemory(uint32_t address, uint8_t* data, uint8_t count)
 {
-    result->chipId = API_C2_readRegister(REG_CHIP_ID);
-    result->firmwareVersion = API_C2_readRegister(REG_FIRMWARE_VER);
-    result->firmwareSubversion = API_C2_readRegister(REG_FIRMWARE_SUBVERSION);
-    result->vendorId = read16bitRegister(REG_VENDOR_ID);
-    result->productId = read16bitRegister(REG_PRODUCT_ID);
-    result->versionId = read16bitRegister(REG_VERSION_ID);
+    API_Recorder_recordRegisterWrite(API_Hardware_micros(), address, data, count);
+    return HB_writeExtendedMemory(address, data, count);
+}
+
+/** Reads the System info and puts it into result. All of it is read in 
+    one burst of SYSTEM_INFO_SIZE bytes from REG_CHIP_ID. Returns the 
+    HB_readExtendedMemory status; result is all zeros if the read failed. */
+uint8_t API_C2_readSystemInfo(systemInfo_t* result)
+{
+    uint8_t block[SYSTEM_INFO_SIZE];
+    uint8_t status = HB_readExtendedMemory(REG_CHIP_ID, block, SYSTEM_INFO_SIZE);
+    if(status != SUCCESS)
+    {
+        memset(block, 0, SYSTEM_INFO_SIZE);
+    }
+
+    result->chipId = block[REG_CHIP_ID - REG_CHIP_ID];
+    result->firmwareVersion = block[REG_FIRMWARE_VER - REG_CHIP_ID];
+    result->firmwareSubversion = block[REG_FIRMWARE_SUBVERSION - REG_CHIP_ID];
+    result->feedConfig1 = block[REG_FEED_CONFIG_1 - REG_CHIP_ID];
+    result->vendorId = get16bit(&block[REG_VENDOR_ID - REG_CHIP_ID]);
+    result->productId = get16bit(&block[REG_PRODUCT_ID - REG_CHIP_ID]);
+    result->versionId = get16bit(&block[REG_VERSION_ID - REG_CHIP_ID]);
+    return status;
+}
+
+/** Waits for the pad to finish booting after power on, by polling its 
+    system info every STARTUP_POLL_US until it answers with a chip ID, 
+    instead of waiting out the longest boot time. Gives up after timeoutUs. 
+    Returns SUCCESS with result filled in, or the status of the last 
+    attempt (NO_RESPONSE if the pad answered with an empty chip ID). */
+uint8_t API_C2_waitReady(systemInfo_t* result, uint32_t timeoutUs)
+{
+    uint32_t start = API_Hardware_micros();
+
+    for(;;)
+    {
+        uint32_t attempt = API_Hardware_micros();
+        uint8_t status = API_C2_readSystemInfo(result);
+        if(status == SUCCESS && result->chipId != 0x00 && result->chipId != 0xFF)
+        {
+            return SUCCESS;
+        }
+        if(API_Hardware_micros() - start >= timeoutUs)
+        {
+            return (status == SUCCESS) ? NO_RESPONSE : status;
+        }
+        // a pad that is still booting NAKs at once; don't poll it flat out
+        while(API_Hardware_micros() - attempt < STARTUP_POLL_US);
+    }
 }
 
 /***********************************************************/
@@ -209,34 +250,74 @@ void API_C2_forceComp()
 
 /** Takes a clean compensation image in the factory
     returns true if successful, false if watchdog timeout
-    This takes about 200 ms to run. */
+    This takes about 200 ms to run and blocks until it is done; 
+    see API_C2_startFactoryCalibrate() for a version that does not. */
 bool API_C2_factoryCalibrate()
+{
+    uint8_t result;
+    
+    API_C2_startFactoryCalibrate();
+    while((result = API_C2_pollFactoryCalibrate()) == CALIBRATE_BUSY);
+    return (result == CALIBRATE_DONE);
+}
+
+/** Starts a factory calibration and returns at once. Call 
+    API_C2_pollFactoryCalibrate() until it stops returning CALIBRATE_BUSY. */
+void API_C2_startFactoryCalibrate(void)
 {
     uint8_t previousValue = API_C2_readRegister(0xC2C4);           // read
-    uint8_t modifiedValue = previousValue | 0x80;                  // modify
-    API_C2_writeRegister(0xC2C4, modifiedValue);                   // write
+    _calValue = previousValue | 0x80;                              // modify
+    API_C2_writeRegister(0xC2C4, _calValue);                       // write
     
-    API_Hardware_delay(20);
+    _calState = CAL_SETTLE;
+    _calStepStart = API_Hardware_micros();
+}
+
+/** Advances a factory calibration by at most one register read or write.
+    Returns CALIBRATE_BUSY, CALIBRATE_DONE or CALIBRATE_FAILED (a step took
+    longer than CALIBRATE_TIMEOUT_US, or no calibration was started). */
+uint8_t API_C2_pollFactoryCalibrate(void)
+{
+    uint32_t elapsed = API_Hardware_micros() - _calStepStart;
     
-    uint32_t timeout = 0; // times out at 5e6 count.  ~150ms- ish
-    while(API_C2_readRegister(0xC2C4) == modifiedValue 
-			&& (timeout < 5000000) ) timeout++;
-    if(timeout == 500000)
+    switch(_calState)
     {
-        return false;
+        case CAL_SETTLE:
+            if(elapsed >= 20000)
+            {
+                _calState = CAL_WAIT_CALIBRATE;
+                _calStepStart = API_Hardware_micros();
+            }
+            return CALIBRATE_BUSY;
+            
+        case CAL_WAIT_CALIBRATE:
+            if(API_C2_readRegister(0xC2C4) != _calValue)
+            {
+                API_C2_writeRegister(0xC2DF, 0x03);               // write
+                _calState = CAL_WAIT_PERSIST;
+                _calStepStart = API_Hardware_micros();
+                return CALIBRATE_BUSY;
+            }
+            break;
+            
+        case CAL_WAIT_PERSIST:
+            if(API_C2_readRegister(0xC2D4) == 0x00)
+            {
+                _calState = CAL_IDLE;
+                return CALIBRATE_DONE;
+            }
+            break;
+            
+        default:
+            return CALIBRATE_FAILED;
     }
-    API_C2_writeRegister(0xC2DF, 0x03);                           // write
     
-    timeout = 0; // times out at 5e6 count.  ~150ms- ish
-    while(API_C2_readRegister(0xC2D4) != 0x00 && (timeout < 5000000)) timeout++;
-    if(timeout == 500000)
-    {
-        return false;
-    }
-    else
+    if(elapsed > CALIBRATE_TIMEOUT_US)
     {
-        return true;
+        _calState = CAL_IDLE;
+        return CALIBRATE_FAILED;
     }
+    return CALIBRATE_BUSY;
 }
 
 /** Turns off the feed. The touchpad continues to calculate the touch data, 
@@ -275,90 +356,3 @@ void API_C2_enableTracking()
     sysConfig1 |= 0x02;                                      // modify
     API_C2_writeRegister(0xC2C2, sysConfig1);                // write
 }
-
-/**********************************************************/
-/**********************************************************/
-/*********** TOOLS FOR DETERMINIG INPUT EVENTS ************/
-
-/** determines if the finger_num finger corresponds to a valid finger in the report 
-    The finger may still have x,y coordinates when the finger is invalid. These 
-    coordinates should be ignored */
-bool API_C2_isFingerValid(report_t* report, uint8_t finger_num)
-{
-    if(finger_num > 4 || finger_num < 0 )
-    {
-        return false;
-    }
-    
-    if(report == NULL || report->reportID != CRQ_ABSOLUTE_REPORT_ID)
-    {
-        return false;
-    }
-    
-    uint8_t palm = report->abs.fingers[finger_num].palm;
-    return ((palm & CRQ_ABSOLUTE_CONFIDENCE_MASK) && !(palm &CRQ_ABSOLUTE_PALM_REJECT_MASK));
-}
-
-/** determines if the finger_num finger is in contact with the module */
-bool API_C2_isFingerContacted(report_t* report, uint8_t finger_num)
-{
-    if(finger_num > 4 || finger_num < 0 )
-    {
-        return false;
-    }
-    
-    if(report == NULL || report->reportID != CRQ_ABSOLUTE_REPORT_ID)
-    {
-        return false;
-    }
-    return report->abs.contactFlags &  (0x1 << finger_num); 
-}
-
-
-/** determines if a button is pressed according to its mask. 
-    returns false if it's a keyboard report with no button information.*/
-bool API_C2_isButtonPressed(report_t* report, uint8_t buttonMask)
-{
-    uint8_t buttons = 0;
-    if(report == NULL)
-        return false;
-    switch(report->reportID)
-    {
-        case MOUSE_REPORT_ID:
-            buttons = report->mouse.buttons;
-            break;
-        case CRQ_ABSOLUTE_REPORT_ID:
-            buttons = report->abs.buttons;
-            break;
-        default:
-            buttons = 0;
-    }
-    return buttons & buttonMask;
-}
-
-/**********************************************************/
-/**********************************************************/
-/**********************************************************/
-
-/** Included for testing purposes. API_C2_getReport calls this */
-void API_C2_decodeReport(uint8_t* packet, report_t* result)
-{
-    result->reportID = packet[2];
-    //determine which type of report it is and decode it
-    switch(result->reportID) //packet id
-    {
-        case MOUSE_REPORT_ID:
-            decodeMouseReport(packet, result);
-            break;
-        case KEYBOARD_REPORT_ID:
-            decodeKeyboardReport(packet, result);
-            break;
-        case CRQ_ABSOLUTE_REPORT_ID:
-            decodeCirqueAbsoluteReport(packet, result);
-            break;
-        default:
-            clearReport(result); //return an empty report
-            break;
-        
-    }
-}
\ No newline at end of file
@@ -0,0 +1,260 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+#include <string.h>
+#include "API_C2_Idle.h"
+#include "API_C2.h"
+
+/***********************************************************/
+/***********************************************************/
+/********************* MODULE VARIABLES ********************/
+
+static idlePolicy_t _policy;
+static idleStats_t _stats;
+static bool _running = false;
+static uint8_t _state = IDLE_ACTIVE;
+static bool _tracking = true;       /**< What tracking was last set to */
+static uint32_t _stateSinceUs;      /**< When _state was entered, or its time last counted */
+static uint32_t _lastActivityUs;
+static uint32_t _sampleStartUs;     /**< When tracking was last turned on for a sample */
+static uint32_t _lastLookUs;        /**< When tracking was last turned off with nothing seen */
+static uint32_t _nextUs;            /**< When API_C2_idlePoll has work to do */
+
+/***********************************************************/
+/***********************************************************/
+/******************** HELPER FUNCTIONS *********************/
+
+/** A report counts as activity unless it is an absolute report with no
+    contacts and no buttons (the report sent when the last finger lifts).
+    The pad sends mouse and keyboard reports only when something changed. */
+static bool isActivity(const reportView_t* view)
+{
+    switch(API_C2_viewKind(view))
+    {
+        case REPORT_KIND_ABSOLUTE:
+            return API_C2_viewContactFlags(view) != 0 || API_C2_viewButtons(view) != 0;
+        case REPORT_KIND_NONE:
+            return false;
+        default:
+            return true;
+    }
+}
+
+static void setTracking(bool on)
+{
+    if(on != _tracking)
+    {
+        if(on)
+        {
+            API_C2_enableTracking();
+        }
+        else
+        {
+            API_C2_disableTracking();
+        }
+        _tracking = on;
+    }
+}
+
+static void enterState(uint8_t state, uint32_t nowUs)
+{
+    _stats.timeUs[_state] += nowUs - _stateSinceUs;
+    _stateSinceUs = nowUs;
+    _state = state;
+    _stats.entries[state]++;
+}
+
+static uint32_t periodUs(uint8_t state)
+{
+    return (state == IDLE_SLEEP ? _policy.sleepPeriodMs : _policy.dozePeriodMs) * 1000u;
+}
+
+/** Idle time that leaves ACTIVE, 0 if nothing does */
+static uint32_t idleAfterUs(void)
+{
+    return (_policy.dozeAfterMs != 0 ? _policy.dozeAfterMs : _policy.sleepAfterMs) * 1000u;
+}
+
+static bool sleepDue(uint32_t nowUs)
+{
+    return _policy.sleepAfterMs != 0 && nowUs - _lastActivityUs >= _policy.sleepAfterMs * 1000u;
+}
+
+/** The next sample starts a period after the last one did, or now if that
+    has passed already */
+static void scheduleSample(uint32_t nowUs)
+{
+    _nextUs = _sampleStartUs + periodUs(_state);
+    if((int32_t)(_nextUs - nowUs) < 0)
+    {
+        _nextUs = nowUs;
+    }
+}
+
+/***********************************************************/
+/***********************************************************/
+/******************* IMPORTANT FUNCTIONS *******************/
+
+/** Starts the policy with the pad ACTIVE and tracking on, and clears the
+    statistics. The periods must be longer than policy->sampleMs. */
+void API_C2_initIdle(const idlePolicy_t* policy, uint32_t nowUs)
+{
+    _policy = *policy;
+    _running = true;
+    _state = IDLE_ACTIVE;
+    _tracking = false;
+    setTracking(true);
+    _lastActivityUs = nowUs;
+    _nextUs = nowUs + idleAfterUs();
+    API_C2_resetIdleStats(nowUs);
+    _stats.entries[IDLE_ACTIVE] = 1;
+}
+
+/** Stops the policy, back in ACTIVE with tracking on */
+void API_C2_stopIdle(uint32_t nowUs)
+{
+    if(_running && _state != IDLE_ACTIVE)
+    {
+        setTracking(true);
+        enterState(IDLE_ACTIVE, nowUs);
+    }
+    _running = false;
+}
+
+bool API_C2_idleRunning(void)
+{
+    return _running;
+}
+
+/** Hands the policy a report read at nowUs. Activity keeps the pad ACTIVE,
+    or wakes it from DOZE or SLEEP. */
+void API_C2_idleReport(const reportView_t* view, uint32_t nowUs)
+{
+    if(!_running || !isActivity(view))
+    {
+        return;
+    }
+    _lastActivityUs = nowUs;
+    if(_state != IDLE_ACTIVE)
+    {
+        uint32_t wakeUs = nowUs - _lastLookUs;
+        _stats.wakes++;
+        _stats.lastWakeUs = wakeUs;
+        _stats.totalWakeUs += wakeUs;
+        _stats.maxWakeUs = wakeUs > _stats.maxWakeUs ? wakeUs : _stats.maxWakeUs;
+        if(_tracking && nowUs - _sampleStartUs > _stats.maxResumeUs)
+        {
+            _stats.maxResumeUs = nowUs - _sampleStartUs;
+        }
+        setTracking(true);
+        enterState(IDLE_ACTIVE, nowUs);
+    }
+    _nextUs = nowUs + idleAfterUs();
+}
+
+bool API_C2_idleDue(uint32_t nowUs)
+{
+    return _running && (_state != IDLE_ACTIVE || idleAfterUs() != 0) && (int32_t)(nowUs - _nextUs) >= 0;
+}
+
+/** Steps the policy: leaves ACTIVE once idle long enough, and in DOZE and
+    SLEEP starts and ends the samples. */
+void API_C2_idlePoll(uint32_t nowUs)
+{
+    if(_state == IDLE_ACTIVE)
+    {
+        if(nowUs - _lastActivityUs < idleAfterUs())
+        {
+            _nextUs = _lastActivityUs + idleAfterUs();
+            return;
+        }
+        // count going idle as the end of a sample, so the first one comes a period on
+        setTracking(false);
+        _lastLookUs = nowUs;
+        _sampleStartUs = nowUs - _policy.sampleMs * 1000u;
+        enterState((_policy.dozeAfterMs == 0 || sleepDue(nowUs)) ? IDLE_SLEEP : IDLE_DOZE, nowUs);
+        scheduleSample(nowUs);
+    }
+    else if(_tracking)
+    {
+        // the sample saw nothing
+        setTracking(false);
+        _lastLookUs = nowUs;
+        if(_state == IDLE_DOZE && sleepDue(nowUs))
+        {
+            enterState(IDLE_SLEEP, nowUs);
+        }
+        scheduleSample(nowUs);
+    }
+    else
+    {
+        setTracking(true);
+        _sampleStartUs = nowUs;
+        _stats.samples++;
+        _nextUs = nowUs + _policy.sampleMs * 1000u;
+    }
+}
+
+/** Counts a shunt voltage sample against the current state */
+void API_C2_idleRecordShunt(int32_t microvolts)
+{
+    _stats.shuntSum[_state] += microvolts;
+    _stats.shuntSamples[_state]++;
+}
+
+/***********************************************************/
+/***********************************************************/
+/******************** PUBLIC FUNCTIONS *********************/
+
+uint8_t API_C2_getIdleState(void)
+{
+    return _state;
+}
+
+/** Longest a touch can wait to be seen in state: a period in DOZE and SLEEP
+    (the pad's own report interval on top is not counted), 0 in ACTIVE */
+uint32_t API_C2_idleWakeBoundUs(uint8_t state)
+{
+    return state == IDLE_ACTIVE ? 0 : periodUs(state);
+}
+
+/** Statistics since the last reset, with the time in the current state
+    counted up to nowUs */
+const idleStats_t* API_C2_getIdleStats(uint32_t nowUs)
+{
+    _stats.timeUs[_state] += nowUs - _stateSinceUs;
+    _stateSinceUs = nowUs;
+    return &_stats;
+}
+
+/** Mean shunt voltage in state, uV, or 0 without samples */
+int32_t API_C2_idleMeanShunt(const idleStats_t* stats, uint8_t state)
+{
+    return stats->shuntSamples[state] ? (int32_t)(stats->shuntSum[state] / stats->shuntSamples[state]) : 0;
+}
+
+/** Energy saved against tracking the whole time, in thousandths: each
+    state's time at its mean shunt voltage, over all the time at ACTIVE's.
+    A state without samples counts as ACTIVE. 0 without ACTIVE samples. */
+int32_t API_C2_idleSavedPermille(const idleStats_t* stats)
+{
+    int32_t active = API_C2_idleMeanShunt(stats, IDLE_ACTIVE);
+    int64_t used = 0, baseline = 0;
+
+    if(stats->shuntSamples[IDLE_ACTIVE] == 0 || active <= 0)
+    {
+        return 0;
+    }
+    for(uint8_t state = 0; state < IDLE_STATES; state++)
+    {
+        int64_t ms = (int64_t)(stats->timeUs[state] / 1000u);
+        used += ms * (stats->shuntSamples[state] ? API_C2_idleMeanShunt(stats, state) : active);
+        baseline += ms * active;
+    }
+    return baseline ? (int32_t)(1000 - used * 1000 / baseline) : 0;
+}
+
+void API_C2_resetIdleStats(uint32_t nowUs)
+{
+    memset(&_stats, 0, sizeof(_stats));
+    _stateSinceUs = nowUs;
+}
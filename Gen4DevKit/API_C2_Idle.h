@@ -0,0 +1,126 @@
+#ifndef API_C2_IDLE_H
+#define API_C2_IDLE_H
+
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+/**@file API_C2_Idle.h
+   @brief Idle power policy: steps tracking down while no one touches the pad.
+
+   The pad starts ACTIVE, tracking all the time. After dozeAfterMs with no
+   activity (a contact, a button, a mouse or keyboard report) it goes to
+   DOZE, and after sleepAfterMs to SLEEP. In both, tracking is turned off
+   (API_C2_disableTracking, which lets the pad sleep) and turned back on for
+   a sample of sampleMs once every period, dozePeriodMs or sleepPeriodMs. A
+   touch seen in a sample wakes the pad back to ACTIVE with tracking left on.
+
+   A touch that starts just after a sample ends is seen by the next one, so
+   the wake latency is bounded by the period, as long as sampleMs is long
+   enough for the pad to start tracking and report. The policy measures
+   both: for each wake, the time since the pad last looked and saw nothing
+   (the most the touch can have waited) and the time from tracking being
+   turned on to the report that woke it (how long the pad takes to resume).
+
+   Energy is accounted from shunt voltage samples handed in with
+   API_C2_idleRecordShunt (the sketch's INA219 power task), per state, and
+   compared with the pad tracking the whole time.
+
+   The policy is driven from the caller's time (micros()): API_C2_idleReport
+   for every report and API_C2_idlePoll once API_C2_idleDue says so. The
+   policy assumes it alone turns tracking on and off while it runs;
+   API_C2_stopIdle leaves tracking on. */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "API_C2_Report.h"
+
+/***********************************************************/
+/***********************************************************/
+/******************* PROVIDED DEFINES **********************/
+
+#define IDLE_ACTIVE         (0) /**< Tracking all the time */
+#define IDLE_DOZE           (1) /**< Tracking a sample every dozePeriodMs */
+#define IDLE_SLEEP          (2) /**< Tracking a sample every sleepPeriodMs */
+#define IDLE_STATES         (3)
+
+/** Default policy. The periods are not multiples of the sketch's 100 ms
+    power samples, so those land at every point of the cycle. */
+#ifndef IDLE_DOZE_AFTER_MS
+#define IDLE_DOZE_AFTER_MS  (2000)
+#endif
+#ifndef IDLE_SLEEP_AFTER_MS
+#define IDLE_SLEEP_AFTER_MS (30000)
+#endif
+#ifndef IDLE_DOZE_PERIOD_MS
+#define IDLE_DOZE_PERIOD_MS (90)
+#endif
+#ifndef IDLE_SLEEP_PERIOD_MS
+#define IDLE_SLEEP_PERIOD_MS (490)
+#endif
+#ifndef IDLE_SAMPLE_MS
+#define IDLE_SAMPLE_MS      (25)
+#endif
+
+/***********************************************************/
+/***********************************************************/
+/****************** PUBLIC DATA STRUCTURES *****************/
+
+typedef struct
+{
+    uint32_t dozeAfterMs;       /**< No activity for this long goes to DOZE, 0 to never */
+    uint32_t sleepAfterMs;      /**< No activity for this long goes to SLEEP, 0 to never */
+    uint32_t dozePeriodMs;      /**< Time from one sample to the next in DOZE */
+    uint32_t sleepPeriodMs;     /**< Time from one sample to the next in SLEEP */
+    uint32_t sampleMs;          /**< How long tracking stays on for a sample */
+} idlePolicy_t;
+
+typedef struct
+{
+    uint32_t entries[IDLE_STATES];  /**< Times each state was entered */
+    uint64_t timeUs[IDLE_STATES];   /**< Time spent in each state */
+    int64_t  shuntSum[IDLE_STATES]; /**< Shunt voltage samples per state, uV */
+    uint32_t shuntSamples[IDLE_STATES];
+    uint32_t samples;           /**< Samples taken in DOZE and SLEEP */
+    uint32_t wakes;             /**< Returns to ACTIVE from DOZE or SLEEP */
+    uint32_t lastWakeUs;        /**< Time since the pad last saw nothing, at the last wake */
+    uint32_t maxWakeUs;
+    uint64_t totalWakeUs;
+    uint32_t maxResumeUs;       /**< Longest time from tracking on to the waking report */
+} idleStats_t;
+
+/***********************************************************/
+/***********************************************************/
+/******************* IMPORTANT FUNCTIONS *******************/
+
+void API_C2_initIdle(const idlePolicy_t* policy, uint32_t nowUs);
+
+void API_C2_stopIdle(uint32_t nowUs);
+
+bool API_C2_idleRunning(void);
+
+void API_C2_idleReport(const reportView_t* view, uint32_t nowUs);
+
+bool API_C2_idleDue(uint32_t nowUs);
+
+void API_C2_idlePoll(uint32_t nowUs);
+
+void API_C2_idleRecordShunt(int32_t microvolts);
+
+uint8_t API_C2_getIdleState(void);
+
+uint32_t API_C2_idleWakeBoundUs(uint8_t state);
+
+const idleStats_t* API_C2_getIdleStats(uint32_t nowUs);
+
+int32_t API_C2_idleMeanShunt(const idleStats_t* stats, uint8_t state);
+
+int32_t API_C2_idleSavedPermille(const idleStats_t* stats);
+
+void API_C2_resetIdleStats(uint32_t nowUs);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // API_C2_IDLE_H
@@ -0,0 +1,264 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+#include <string.h>
+#include "API_C2_Latency.h"
+#include "API_C2.h"
+#include "API_Hardware.h"
+#include "API_HostBus.h"
+
+/***********************************************************/
+/***********************************************************/
+/********************* MODULE VARIABLES ********************/
+
+#define LATENCY_OFF      (0)
+#define LATENCY_SETUP    (1)    /**< Set up the next run at _nextUs */
+#define LATENCY_GAP      (2)    /**< Press at _nextUs */
+#define LATENCY_PRESSED  (3)    /**< Waiting for the press, until _nextUs */
+#define LATENCY_HELD     (4)    /**< Release at _nextUs */
+#define LATENCY_RELEASED (5)    /**< Waiting for the release, until _nextUs */
+
+static latencyPlan_t _plan;
+static latencyStats_t _stats[LATENCY_MAX_RUNS];
+static uint8_t _state = LATENCY_OFF;
+static uint8_t _run;                /**< Run in progress, runs before it are done */
+static uint16_t _iteration;
+static uint8_t _mask;               /**< The button's bit in the reports */
+static uint8_t _lastButtons;        /**< Buttons of the last mouse or absolute report */
+static bool _wasAbsolute;           /**< Report mode before the benchmark */
+static uint32_t _edgeUs;            /**< When the button was last pressed or released */
+static uint32_t _nextUs;
+static uint32_t _random = 1;
+
+/***********************************************************/
+/***********************************************************/
+/******************** HELPER FUNCTIONS *********************/
+
+static void setReportMode(bool absolute)
+{
+    if(absolute)
+    {
+        API_C2_setCRQ_AbsoluteMode();
+    }
+    else
+    {
+        API_C2_setRelativeMode();
+    }
+}
+
+/** A gap with its random part, in us */
+static uint32_t gapUs(void)
+{
+    uint32_t jitterUs = _plan.jitterMs * 1000u;
+
+    _random = _random * 1103515245u + 12345u;
+    return _plan.gapMs * 1000u + (jitterUs ? (_random >> 8) % (jitterUs + 1) : 0);
+}
+
+static void countLatency(latencyStats_t* stats, uint32_t latencyUs)
+{
+    uint32_t bucket = latencyUs / LATENCY_BUCKET_US;
+
+    stats->histogram[bucket < LATENCY_BUCKETS ? bucket : LATENCY_BUCKETS - 1]++;
+    stats->minUs = (stats->samples == 0 || latencyUs < stats->minUs) ? latencyUs : stats->minUs;
+    stats->maxUs = latencyUs > stats->maxUs ? latencyUs : stats->maxUs;
+    stats->totalUs += latencyUs;
+    stats->samples++;
+}
+
+/** Ends a press and release, and the run after its last one */
+static void endIteration(uint32_t nowUs)
+{
+    if(++_iteration >= _plan.iterations)
+    {
+        _run++;
+        _state = LATENCY_SETUP;
+        _nextUs = nowUs;
+    }
+    else
+    {
+        _state = LATENCY_GAP;
+        _nextUs = nowUs + gapUs();
+    }
+}
+
+/** Puts back the report mode and clock the pad had */
+static void finish(void)
+{
+    setReportMode(_wasAbsolute);
+    API_C2_init(_plan.restoreClockHz, CIRQUE_SLAVE_ADDR);
+    _state = LATENCY_OFF;
+}
+
+/** Sets the mode and clock of the next run, or finishes once every run is
+    done */
+static void setUpRun(uint32_t nowUs)
+{
+    if(_run >= _plan.runCount)
+    {
+        finish();
+        return;
+    }
+    const latencyRun_t* run = &_plan.runs[_run];
+    API_C2_init(run->clockHz, CIRQUE_SLAVE_ADDR);
+    setReportMode(run->absolute);
+    memset(&_stats[_run], 0, sizeof(latencyStats_t));
+    _iteration = 0;
+    _state = LATENCY_GAP;
+    _nextUs = nowUs + LATENCY_MODE_SETTLE_MS * 1000u;
+}
+
+/***********************************************************/
+/***********************************************************/
+/******************* IMPORTANT FUNCTIONS *******************/
+
+/** Starts the runs of plan (copied) with the button released. Tracking and
+    the feed must be on for the pad to report the presses. */
+void API_C2_startLatency(const latencyPlan_t* plan, uint32_t nowUs)
+{
+    _plan = *plan;
+    if(_plan.runCount > LATENCY_MAX_RUNS)
+    {
+        _plan.runCount = LATENCY_MAX_RUNS;
+    }
+    _mask = (uint8_t)(1 << _plan.button);
+    _lastButtons = 0;
+    _wasAbsolute = (API_C2_readRegister(0xC2C4) & 0x02) != 0;
+    _random = nowUs | 1;
+    _run = 0;
+    API_Hardware_injectButton(_plan.button, false);
+    setUpRun(nowUs);
+}
+
+/** Stops the benchmark, releasing the button and putting back the report
+    mode and clock. Runs done so far keep their statistics. */
+void API_C2_stopLatency(void)
+{
+    if(_state == LATENCY_OFF)
+    {
+        return;
+    }
+    API_Hardware_injectButton(_plan.button, false);
+    finish();
+}
+
+bool API_C2_latencyRunning(void)
+{
+    return _state != LATENCY_OFF;
+}
+
+/** Hands the benchmark a report as soon as it is read, with timestamp the
+    micros() after the read */
+void API_C2_latencyReport(const reportView_t* view, uint32_t timestamp)
+{
+    uint8_t kind = API_C2_viewKind(view);
+
+    if(_state == LATENCY_OFF || (kind != REPORT_KIND_MOUSE && kind != REPORT_KIND_ABSOLUTE))
+    {
+        return;
+    }
+    _lastButtons = API_C2_viewButtons(view);
+    if(_state == LATENCY_PRESSED && (_lastButtons & _mask))
+    {
+        countLatency(&_stats[_run], timestamp - _edgeUs);
+        _state = LATENCY_HELD;
+        _nextUs = timestamp + gapUs();
+    }
+    else if(_state == LATENCY_RELEASED && !(_lastButtons & _mask))
+    {
+        endIteration(timestamp);
+    }
+}
+
+bool API_C2_latencyDue(uint32_t nowUs)
+{
+    return _state != LATENCY_OFF && (int32_t)(nowUs - _nextUs) >= 0;
+}
+
+/** Steps the benchmark: sets up runs, makes the edges and times out the
+    ones the pad did not report */
+void API_C2_latencyPoll(uint32_t nowUs)
+{
+    switch(_state)
+    {
+        case LATENCY_SETUP:
+            setUpRun(nowUs);
+            break;
+        case LATENCY_GAP:
+            if(_lastButtons & _mask)
+            {
+                // the pad still reports the button down, from before the run
+                _nextUs = nowUs + gapUs();
+                break;
+            }
+            API_Hardware_injectButton(_plan.button, true);
+            _edgeUs = nowUs;
+            _state = LATENCY_PRESSED;
+            _nextUs = nowUs + LATENCY_TIMEOUT_MS * 1000u;
+            break;
+        case LATENCY_PRESSED:
+            // not reported in time: count it and release all the same
+            _stats[_run].timeouts++;
+            // fall through
+        case LATENCY_HELD:
+            API_Hardware_injectButton(_plan.button, false);
+            _edgeUs = nowUs;
+            _state = LATENCY_RELEASED;
+            _nextUs = nowUs + LATENCY_TIMEOUT_MS * 1000u;
+            break;
+        case LATENCY_RELEASED:
+            _stats[_run].releaseTimeouts++;
+            _lastButtons &= (uint8_t)~_mask;
+            endIteration(nowUs);
+            break;
+        default:
+            break;
+    }
+}
+
+/***********************************************************/
+/***********************************************************/
+/******************** PUBLIC FUNCTIONS *********************/
+
+/** Runs finished, whose statistics are complete */
+uint8_t API_C2_latencyRunsDone(void)
+{
+    return _run;
+}
+
+const latencyRun_t* API_C2_getLatencyRun(uint8_t run)
+{
+    return &_plan.runs[run < LATENCY_MAX_RUNS ? run : 0];
+}
+
+const latencyStats_t* API_C2_getLatencyStats(uint8_t run)
+{
+    return &_stats[run < LATENCY_MAX_RUNS ? run : 0];
+}
+
+uint32_t API_C2_latencyMeanUs(const latencyStats_t* stats)
+{
+    return stats->samples ? (uint32_t)(stats->totalUs / stats->samples) : 0;
+}
+
+/** Latency that permille thousandths of the presses were reported within,
+    to a bucket (the top of the bucket, or maxUs if that is lower). 0 without
+    samples. */
+uint32_t API_C2_latencyPercentileUs(const latencyStats_t* stats, uint16_t permille)
+{
+    uint32_t counted = 0;
+
+    if(stats->samples == 0)
+    {
+        return 0;
+    }
+    for(uint16_t b = 0; b < LATENCY_BUCKETS - 1; b++)
+    {
+        counted += stats->histogram[b];
+        if(counted * 1000u >= (uint32_t)permille * stats->samples)
+        {
+            uint32_t top = (b + 1u) * LATENCY_BUCKET_US;
+            return top < stats->maxUs ? top : stats->maxUs;
+        }
+    }
+    return stats->maxUs;
+}
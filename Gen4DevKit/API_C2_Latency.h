@@ -0,0 +1,132 @@
+#ifndef API_C2_LATENCY_H
+#define API_C2_LATENCY_H
+
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+/**@file API_C2_Latency.h
+   @brief Controller latency benchmark using the button injection pins.
+
+   The board presses one of the pad's buttons itself (API_Hardware_injectButton)
+   and times how long the pad takes to report it: from the edge on the BTN pin
+   to the report read with the button's bit set (mouse.buttons in relative
+   mode, abs.buttons in absolute mode). That is the pad's own response, the
+   wait for its next report, Data Ready being serviced and the report read
+   over I2C, which is what the board adds before a host could see the press.
+
+   Each press is held until the pad reports it, then released, and the
+   release waited for too, so every press starts from a released button. The
+   gaps between edges are LATENCY_GAP_MS plus a random part of up to
+   LATENCY_JITTER_MS, so presses do not lock to the pad's scan and the
+   measured latency covers every phase of it.
+
+   A benchmark is a list of runs, one per report mode and I2C clock. Each run
+   sets the mode and the clock, waits LATENCY_MODE_SETTLE_MS for the mode to
+   take effect and times plan->iterations presses into a histogram of
+   LATENCY_BUCKET_US buckets. Afterwards the report mode the pad had and
+   plan->restoreClockHz are set back. */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "API_C2_Report.h"
+
+/***********************************************************/
+/***********************************************************/
+/******************* PROVIDED DEFINES **********************/
+
+#define LATENCY_MAX_RUNS        (4)
+#define LATENCY_BUCKET_US       (250)
+#define LATENCY_BUCKETS         (128)   /**< 32 ms; the last bucket holds anything longer */
+
+#ifndef LATENCY_ITERATIONS
+#define LATENCY_ITERATIONS      (1000)  /**< Presses per run */
+#endif
+
+/** Time between a report and the next edge: the fixed part and the most
+    added at random. Two 8 ms scans of random part put the edge at every
+    phase of a 125 Hz scan equally often. */
+#ifndef LATENCY_GAP_MS
+#define LATENCY_GAP_MS          (10)
+#endif
+#ifndef LATENCY_JITTER_MS
+#define LATENCY_JITTER_MS       (16)
+#endif
+
+/** An edge without a report after this long counts as a timeout */
+#ifndef LATENCY_TIMEOUT_MS
+#define LATENCY_TIMEOUT_MS      (100)
+#endif
+
+/** Time for a report mode change to take effect, see API_C2_setRelativeMode */
+#ifndef LATENCY_MODE_SETTLE_MS
+#define LATENCY_MODE_SETTLE_MS  (50)
+#endif
+
+/***********************************************************/
+/***********************************************************/
+/****************** PUBLIC DATA STRUCTURES *****************/
+
+typedef struct
+{
+    bool     absolute;          /**< Cirque absolute reports, else relative (mouse) */
+    uint32_t clockHz;           /**< I2C clock for the pad */
+} latencyRun_t;
+
+typedef struct
+{
+    uint8_t      button;        /**< 0 to HARDWARE_BUTTONS - 1 */
+    uint16_t     iterations;    /**< Presses per run */
+    uint16_t     gapMs;         /**< LATENCY_GAP_MS */
+    uint16_t     jitterMs;      /**< LATENCY_JITTER_MS */
+    uint32_t     restoreClockHz;
+    uint8_t      runCount;
+    latencyRun_t runs[LATENCY_MAX_RUNS];
+} latencyPlan_t;
+
+typedef struct
+{
+    uint16_t samples;           /**< Presses reported in time */
+    uint16_t timeouts;          /**< Presses not reported within LATENCY_TIMEOUT_MS */
+    uint16_t releaseTimeouts;   /**< Releases not reported within LATENCY_TIMEOUT_MS */
+    uint32_t minUs;
+    uint32_t maxUs;
+    uint64_t totalUs;
+    uint16_t histogram[LATENCY_BUCKETS];
+} latencyStats_t;
+
+/***********************************************************/
+/***********************************************************/
+/******************* IMPORTANT FUNCTIONS *******************/
+
+void API_C2_startLatency(const latencyPlan_t* plan, uint32_t nowUs);
+
+void API_C2_stopLatency(void);
+
+bool API_C2_latencyRunning(void);
+
+void API_C2_latencyReport(const reportView_t* view, uint32_t timestamp);
+
+bool API_C2_latencyDue(uint32_t nowUs);
+
+void API_C2_latencyPoll(uint32_t nowUs);
+
+/***********************************************************/
+/***********************************************************/
+/******************** PUBLIC FUNCTIONS *********************/
+
+uint8_t API_C2_latencyRunsDone(void);
+
+const latencyRun_t* API_C2_getLatencyRun(uint8_t run);
+
+const latencyStats_t* API_C2_getLatencyStats(uint8_t run);
+
+uint32_t API_C2_latencyMeanUs(const latencyStats_t* stats);
+
+uint32_t API_C2_latencyPercentileUs(const latencyStats_t* stats, uint16_t permille);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // API_C2_LATENCY_H
@@ -0,0 +1,179 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+#include "API_C2_Map.h"
+#include <string.h>
+
+/***********************************************************/
+/***********************************************************/
+/********************* HELPER FUNCTIONS ********************/
+
+static uint8_t bitLength(uint32_t value)
+{
+    uint8_t bits = 0;
+    while(value != 0)
+    {
+        bits++;
+        value >>= 1;
+    }
+    return bits;
+}
+
+/** Picks the largest shift for which range * scale, plus rounding, still fits
+    in 32 bits, and the scale that maps 0..range onto 0..maxOut. */
+static void compileScale(uint32_t range, uint32_t maxOut, uint32_t* scale, uint8_t* shift)
+{
+    *shift = (uint8_t)(31 - bitLength(maxOut));
+    *scale = (uint32_t)((((uint64_t)maxOut << *shift) + range / 2) / range);
+}
+
+static bool compileAxis(uint16_t min, uint16_t max, const mapConfig_t* config, bool invert,
+                        uint16_t size, const uint16_t* table, mapAxis_t* axis)
+{
+    if(size == 0 || (uint32_t)min + 2u * config->deadZone >= max)
+    {
+        return false;
+    }
+    axis->low = (uint16_t)(min + config->deadZone);
+    axis->high = (uint16_t)(max - config->deadZone);
+    axis->maxOut = (uint16_t)(size - 1);
+    axis->flip = invert;
+    axis->table = table;
+    if(table == NULL)
+    {
+        compileScale(axis->high - axis->low, axis->maxOut, &axis->scale, &axis->shift);
+    }
+    else
+    {
+        compileScale(axis->high - axis->low, MAP_UNIT, &axis->inScale, &axis->inShift);
+        compileScale(MAP_UNIT, axis->maxOut, &axis->scale, &axis->shift);
+    }
+    return true;
+}
+
+/** Steps 1 and 2 of the mapping for one pad axis. Returns false if the touch
+    is dropped. */
+static inline bool mapAxis(const mapAxis_t* axis, bool clip, uint16_t raw, uint16_t* result)
+{
+    uint32_t value;
+
+    if(raw < axis->low)
+    {
+        if(!clip)
+        {
+            return false;
+        }
+        raw = axis->low;
+    }
+    else if(raw > axis->high)
+    {
+        if(!clip)
+        {
+            return false;
+        }
+        raw = axis->high;
+    }
+
+    if(axis->table == NULL)
+    {
+        value = axis->flip ? (uint32_t)(axis->high - raw) : (uint32_t)(raw - axis->low);
+    }
+    else
+    {
+        // to table units, then interpolate between the two nearest points
+        uint32_t unit = ((uint32_t)(raw - axis->low) * axis->inScale + (1u << (axis->inShift - 1))) >> axis->inShift;
+        uint32_t index = unit >> MAP_SEGMENT_BITS;
+        if(index >= MAP_TABLE_POINTS - 1)
+        {
+            value = axis->table[MAP_TABLE_POINTS - 1];
+        }
+        else
+        {
+            int32_t step = (int32_t)axis->table[index + 1] - (int32_t)axis->table[index];
+            int32_t fraction = (int32_t)(unit & ((1u << MAP_SEGMENT_BITS) - 1));
+            value = (uint32_t)((int32_t)axis->table[index] + ((step * fraction) >> MAP_SEGMENT_BITS));
+        }
+        if(value > MAP_UNIT)
+        {
+            value = MAP_UNIT;
+        }
+        if(axis->flip)
+        {
+            value = MAP_UNIT - value;
+        }
+    }
+
+    value = (value * axis->scale + (1u << (axis->shift - 1))) >> axis->shift;
+    *result = (uint16_t)((value > axis->maxOut) ? axis->maxOut : value);
+    return true;
+}
+
+/***********************************************************/
+/***********************************************************/
+/******************* IMPORTANT FUNCTIONS *******************/
+
+/** Works out the integer parameters for config. Returns false if the config
+    is unusable: an empty output, an unknown rotation, or a dead zone that
+    leaves no active area. */
+bool API_C2_compileMap(const mapConfig_t* config, mapTransform_t* transform)
+{
+    bool invertX = config->invertX, invertY = config->invertY;
+    uint16_t sizeX, sizeY;
+
+    memset(transform, 0, sizeof(*transform));
+    if(config->rotation > MAP_ROTATE_270)
+    {
+        return false;
+    }
+
+    /* Rotating clockwise by 90 sends pad x to output y and mirrored pad y to
+       output x; by 180 mirrors both; by 270 sends pad y to output x and
+       mirrored pad x to output y. */
+    transform->swap = (config->rotation == MAP_ROTATE_90 || config->rotation == MAP_ROTATE_270);
+    if(config->rotation == MAP_ROTATE_90 || config->rotation == MAP_ROTATE_180)
+    {
+        invertY = !invertY;
+    }
+    if(config->rotation == MAP_ROTATE_180 || config->rotation == MAP_ROTATE_270)
+    {
+        invertX = !invertX;
+    }
+    sizeX = transform->swap ? config->height : config->width;
+    sizeY = transform->swap ? config->width : config->height;
+
+    transform->clip = config->clip;
+    return compileAxis(config->minX, config->maxX, config, invertX, sizeX, config->edgeTableX, &transform->padX)
+        && compileAxis(config->minY, config->maxY, config, invertY, sizeY, config->edgeTableY, &transform->padY);
+}
+
+/** Maps every valid finger (in contact, confident and not a palm) of an
+    absolute report. Fingers outside the active area are left out unless the
+    map clips. points must have room for 5. Returns the number of points. */
+uint8_t API_C2_mapFingers(const mapTransform_t* transform, const report_t* report, mappedPoint_t* points)
+{
+    uint8_t count = 0;
+
+    if(API_C2_getReportKind(report->reportID) != REPORT_KIND_ABSOLUTE)
+    {
+        return 0;
+    }
+    for(uint8_t i = 0; i < 5; i++)
+    {
+        const fingerData_t* finger = &report->abs.fingers[i];
+        uint16_t x, y;
+        if(!(report->abs.contactFlags & (1 << i))
+           || (finger->palm & (CRQ_ABSOLUTE_CONFIDENCE_MASK | CRQ_ABSOLUTE_PALM_REJECT_MASK)) != CRQ_ABSOLUTE_CONFIDENCE_MASK)
+        {
+            continue;
+        }
+        if(!mapAxis(&transform->padX, transform->clip, finger->x, &x)
+           || !mapAxis(&transform->padY, transform->clip, finger->y, &y))
+        {
+            continue;
+        }
+        points[count].x = transform->swap ? y : x;
+        points[count].y = transform->swap ? x : y;
+        points[count].finger = i;
+        count++;
+    }
+    return count;
+}
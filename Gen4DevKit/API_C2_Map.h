@@ -0,0 +1,113 @@
+#ifndef API_C2_MAP_H
+#define API_C2_MAP_H
+
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+/**@file API_C2_Map.h
+   @brief Maps absolute finger positions from pad counts to an output space.
+
+   A mapConfig_t describes the mapping: the pad's raw range, an edge dead zone,
+   what happens to touches outside the active area, axis inversion, rotation,
+   the output size and an optional edge correction curve for each pad axis.
+   API_C2_compileMap turns it into a mapTransform_t of integer parameters once;
+   API_C2_mapFingers then maps every valid finger of a report in one pass with
+   integer multiplies and shifts only, no floating point.
+
+   Per finger and pad axis the steps are:
+     1. Touches outside the active area (the raw range less deadZone at each
+        edge) are clamped to its edge if clip is set, otherwise dropped.
+     2. The position is scaled to the output axis it ends up on. With an edge
+        table it is first scaled to 0..MAP_UNIT, corrected through the table
+        and then scaled to the output.
+     3. Inversion and rotation flip the axis and pick which output axis it
+        feeds. Pad axes are inverted first, then the result is rotated
+        clockwise as seen on a screen whose Y axis points down.
+
+   Scaling is accurate to within 1/2 output unit for outputs up to 4096 wide
+   and within 2 units at the 65535 maximum. This part of the API has no
+   hardware dependencies, like API_C2_Report.h. */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "API_C2_Report.h"
+
+/***********************************************************/
+/***********************************************************/
+/******************* PROVIDED DEFINES **********************/
+
+/** Rotations, clockwise */
+#define MAP_ROTATE_0        (0)
+#define MAP_ROTATE_90       (1)
+#define MAP_ROTATE_180      (2)
+#define MAP_ROTATE_270      (3)
+
+/** Edge tables: MAP_TABLE_POINTS values, evenly spaced over 0..MAP_UNIT, giving
+    the corrected position for each. Positions between points are interpolated. */
+#define MAP_UNIT            (4096)
+#define MAP_SEGMENT_BITS    (8)
+#define MAP_TABLE_POINTS    ((MAP_UNIT >> MAP_SEGMENT_BITS) + 1)
+
+/***********************************************************/
+/***********************************************************/
+/****************** PUBLIC DATA STRUCTURES *****************/
+
+typedef struct
+{
+    uint16_t minX, maxX;        /**< Raw range of the pad */
+    uint16_t minY, maxY;
+    uint16_t deadZone;          /**< Raw counts at each edge left out of the active area */
+    bool     clip;              /**< Clamp touches outside the active area to its edge, otherwise drop them */
+    bool     invertX;           /**< Mirror the pad X axis */
+    bool     invertY;           /**< Mirror the pad Y axis */
+    uint8_t  rotation;          /**< MAP_ROTATE_ */
+    uint16_t width;             /**< Output size after rotation: x runs 0..width-1 */
+    uint16_t height;            /**< and y runs 0..height-1 */
+    const uint16_t* edgeTableX; /**< NULL, or MAP_TABLE_POINTS values for the pad X axis */
+    const uint16_t* edgeTableY; /**< NULL, or MAP_TABLE_POINTS values for the pad Y axis */
+} mapConfig_t;
+
+/** One pad axis compiled for the output axis it feeds. */
+typedef struct
+{
+    uint16_t low;               /**< Active area in raw counts */
+    uint16_t high;
+    uint32_t scale;             /**< Raw counts (or table units) to output, scaled by 2^shift */
+    uint8_t  shift;
+    uint32_t inScale;           /**< Raw counts to table units, scaled by 2^inShift */
+    uint8_t  inShift;
+    uint16_t maxOut;
+    bool     flip;
+    const uint16_t* table;
+} mapAxis_t;
+
+typedef struct
+{
+    mapAxis_t padX;
+    mapAxis_t padY;
+    bool      swap;             /**< Pad X feeds output y and pad Y output x */
+    bool      clip;
+} mapTransform_t;
+
+/** A mapped finger */
+typedef struct
+{
+    uint16_t x;
+    uint16_t y;
+    uint8_t  finger;            /**< Index in CRQabsoluteReport_t.fingers */
+} mappedPoint_t;
+
+/***********************************************************/
+/***********************************************************/
+/******************* IMPORTANT FUNCTIONS *******************/
+
+bool API_C2_compileMap(const mapConfig_t* config, mapTransform_t* transform);
+
+uint8_t API_C2_mapFingers(const mapTransform_t* transform, const report_t* report, mappedPoint_t* points);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // API_C2_MAP_H
@@ -0,0 +1,78 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+#include "API_C2_Region.h"
+#include "API_C2.h"
+
+/***********************************************************/
+/***********************************************************/
+/******************* IMPORTANT FUNCTIONS *******************/
+
+/** Sets reader up to read length bytes from address, chunkSize bytes at a 
+    time. A chunkSize of 0 or above REGION_MAX_CHUNK reads the largest chunks. */
+void API_C2_startRegion(regionReader_t* reader, uint32_t address, uint32_t length, uint8_t chunkSize)
+{
+    reader->address = address;
+    reader->length = length;
+    reader->offset = 0;
+    reader->chunkSize = (chunkSize == 0 || chunkSize > REGION_MAX_CHUNK) ? REGION_MAX_CHUNK : chunkSize;
+    reader->status = SUCCESS;
+    reader->stats.chunks = 0;
+    reader->stats.retries = 0;
+    reader->stats.failedChunks = 0;
+}
+
+bool API_C2_regionDone(const regionReader_t* reader)
+{
+    return reader->offset >= reader->length;
+}
+
+/** Reads the next chunk into data (chunkSize bytes of room) and sets count 
+    to its length. Returns the status of the last attempt: SUCCESS, or the 
+    HB_readExtendedMemory flags after REGION_RETRIES more tries. */
+uint8_t API_C2_readRegionChunk(regionReader_t* reader, uint8_t* data, uint8_t* count)
+{
+    uint32_t remaining = reader->length - reader->offset;
+    uint8_t piece = (remaining < reader->chunkSize) ? (uint8_t)remaining : reader->chunkSize;
+    uint8_t status = SUCCESS;
+
+    *count = piece;
+    if(piece == 0)
+    {
+        return SUCCESS;
+    }
+    for(uint8_t attempt = 0; attempt <= REGION_RETRIES; attempt++)
+    {
+        status = API_C2_readMemory(reader->address + reader->offset, data, piece);
+        if(status == SUCCESS)
+        {
+            break;
+        }
+        if(attempt < REGION_RETRIES)
+        {
+            reader->stats.retries++;
+        }
+    }
+    if(status != SUCCESS)
+    {
+        reader->stats.failedChunks++;
+        reader->status |= status;
+    }
+    reader->stats.chunks++;
+    reader->offset += piece;
+    return status;
+}
+
+/** Reads length bytes from address into data in the largest chunks. 
+    Returns the combined status of every chunk. */
+uint8_t API_C2_readRegion(uint32_t address, uint8_t* data, uint32_t length)
+{
+    regionReader_t reader;
+    uint8_t count;
+
+    API_C2_startRegion(&reader, address, length, 0);
+    while(!API_C2_regionDone(&reader))
+    {
+        API_C2_readRegionChunk(&reader, &data[reader.offset], &count);
+    }
+    return reader.status;
+}
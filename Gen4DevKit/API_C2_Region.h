@@ -0,0 +1,77 @@
+#ifndef API_C2_REGION_H
+#define API_C2_REGION_H
+
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+/**@file API_C2_Region.h
+   @brief Reads extended memory regions of any length, a chunk at a time.
+
+   One extended memory read moves at most HB_MAX_READ_COUNT bytes, what fits
+   in the Wire buffer with the length and checksum bytes. A regionReader_t
+   walks a longer region, such as compensation or raw sensor data, in chunks
+   of up to that size. Each chunk's checksum and length are checked, and a
+   chunk that fails is read again up to REGION_RETRIES times before its
+   status is handed back; the reader then moves on, so one bad chunk does not
+   stall the rest.
+
+   API_C2_readRegionChunk reads one chunk per call, so a caller can hand each
+   chunk on (to the output queue, for instance) before the next is read and
+   other work can run in between. API_C2_readRegion reads a whole region
+   into memory. */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "API_HostBus.h"
+
+/***********************************************************/
+/***********************************************************/
+/******************* PROVIDED DEFINES **********************/
+
+/** Largest chunk, and the default */
+#define REGION_MAX_CHUNK    (HB_MAX_READ_COUNT)
+
+/** Times a chunk is read again after a bad checksum, length or bus error */
+#ifndef REGION_RETRIES
+#define REGION_RETRIES      (2)
+#endif
+
+/***********************************************************/
+/***********************************************************/
+/****************** PUBLIC DATA STRUCTURES *****************/
+
+typedef struct
+{
+    uint32_t chunks;            /**< Chunks read */
+    uint32_t retries;           /**< Reads repeated after an error */
+    uint32_t failedChunks;      /**< Chunks still bad after REGION_RETRIES */
+} regionStats_t;
+
+typedef struct
+{
+    uint32_t address;           /**< Start of the region */
+    uint32_t length;            /**< Bytes in the region */
+    uint32_t offset;            /**< Bytes read so far */
+    uint8_t  chunkSize;
+    uint8_t  status;            /**< Host Bus flags of every chunk that failed */
+    regionStats_t stats;
+} regionReader_t;
+
+/***********************************************************/
+/***********************************************************/
+/******************* IMPORTANT FUNCTIONS *******************/
+
+void API_C2_startRegion(regionReader_t* reader, uint32_t address, uint32_t length, uint8_t chunkSize);
+
+bool API_C2_regionDone(const regionReader_t* reader);
+
+uint8_t API_C2_readRegionChunk(regionReader_t* reader, uint8_t* data, uint8_t* count);
+
+uint8_t API_C2_readRegion(uint32_t address, uint8_t* data, uint32_t length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // API_C2_REGION_H
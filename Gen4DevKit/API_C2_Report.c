@@ -0,0 +1,722 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+#include "API_C2_Report.h"
+#include <string.h>
+
+/***********************************************************/
+/***********************************************************/
+/********************* HELPER FUNCTIONS ********************/
+
+/** Report layouts for the reports the Gen4 sends by default.
+    Offsets are in bits from the start of the packet, which begins with the 
+    two length bytes and the report ID. */
+static const reportField_t mouseFields[] =
+{
+    { 3 * 8, 8, 0,                   offsetof(report_t, mouse.buttons),     0, 0 },
+    { 4 * 8, 8, REPORT_FIELD_SIGNED, offsetof(report_t, mouse.xDelta),      0, 0 },
+    { 5 * 8, 8, REPORT_FIELD_SIGNED, offsetof(report_t, mouse.yDelta),      0, 0 },
+    { 6 * 8, 8, REPORT_FIELD_SIGNED, offsetof(report_t, mouse.scrollDelta), 0, 0 },
+    { 7 * 8, 8, REPORT_FIELD_SIGNED, offsetof(report_t, mouse.panDelta),    0, 0 },
+};
+
+static const reportField_t keyboardFields[] =
+{
+    { 3 * 8,  8, 0, offsetof(report_t, keyboard.modifier),   0, 0 },
+    // byte 4 is reserved
+    { 5 * 8,  8, 0, offsetof(report_t, keyboard.keycode[0]), 0, 0 },
+    { 6 * 8,  8, 0, offsetof(report_t, keyboard.keycode[1]), 0, 0 },
+    { 7 * 8,  8, 0, offsetof(report_t, keyboard.keycode[2]), 0, 0 },
+    { 8 * 8,  8, 0, offsetof(report_t, keyboard.keycode[3]), 0, 0 },
+    { 9 * 8,  8, 0, offsetof(report_t, keyboard.keycode[4]), 0, 0 },
+    { 10 * 8, 8, 0, offsetof(report_t, keyboard.keycode[5]), 0, 0 },
+};
+
+static const reportField_t absoluteFields[] =
+{
+    { 3 * 8,  8, 0, offsetof(report_t, abs.contactFlags), 0, 0 },
+    { 29 * 8, 8, 0, offsetof(report_t, abs.buttons),      0, 0 },
+};
+
+/** Finger records start at byte 4 and are 5 bytes each: palm, x, y */
+static const reportField_t absoluteFingerFields[] =
+{
+    { 0,  8, 0,                  offsetof(fingerData_t, palm), 0, 0 },
+    { 8,  16, REPORT_FIELD_16BIT, offsetof(fingerData_t, x),   0, 0 },
+    { 24, 16, REPORT_FIELD_16BIT, offsetof(fingerData_t, y),   0, 0 },
+};
+
+/** Windows Precision Touchpad input report (parallel mode, 5 contacts).
+    Contact records start at byte 3 and are 5 bytes each:
+    bit 0 confidence, bit 1 tip switch, bits 2-7 contact ID, then 16 bit X and Y.
+    They are followed by a 16 bit scan time, the contact count and the buttons.
+    Each contact is placed in the finger slot matching its contact ID, so finger 
+    numbers stay stable like they do in the Cirque absolute report. Contact IDs 
+    past the last slot go in a free one (see recordSlots), so none is lost. */
+static const reportField_t ptpFields[] =
+{
+    { 31 * 8, 3, 0, offsetof(report_t, abs.buttons), 0, 0 },
+};
+
+static const reportField_t ptpFingerFields[] =
+{
+    { 2,  6,  REPORT_FIELD_SLOT, 0, 0, 0 },
+    { 1,  1,  REPORT_FIELD_PRESENCE | REPORT_FIELD_FLAG | REPORT_FIELD_IN_REPORT, 
+              offsetof(report_t, abs.contactFlags), 0x01, 0 },
+    { 0,  1,  REPORT_FIELD_FLAG, offsetof(fingerData_t, palm), 
+              CRQ_ABSOLUTE_CONFIDENCE_MASK, CRQ_ABSOLUTE_PALM_REJECT_MASK },
+    { 8,  16, REPORT_FIELD_16BIT, offsetof(fingerData_t, x), 0, 0 },
+    { 24, 16, REPORT_FIELD_16BIT, offsetof(fingerData_t, y), 0, 0 },
+};
+
+#define FIELD_COUNT(table) ((uint8_t)(sizeof(table) / sizeof(table[0])))
+
+static const reportLayout_t mouseLayout =
+{
+    MOUSE_REPORT_ID, REPORT_KIND_MOUSE, FIELD_COUNT(mouseFields), mouseFields,
+    0, 0, 0, 0, NULL
+};
+
+static const reportLayout_t keyboardLayout =
+{
+    KEYBOARD_REPORT_ID, REPORT_KIND_KEYBOARD, FIELD_COUNT(keyboardFields), keyboardFields,
+    0, 0, 0, 0, NULL
+};
+
+static const reportLayout_t absoluteLayout =
+{
+    CRQ_ABSOLUTE_REPORT_ID, REPORT_KIND_ABSOLUTE, FIELD_COUNT(absoluteFields), absoluteFields,
+    5, 4 * 8, 5 * 8, FIELD_COUNT(absoluteFingerFields), absoluteFingerFields
+};
+
+static const reportLayout_t ptpLayout =
+{
+    PTP_REPORT_ID, REPORT_KIND_ABSOLUTE, FIELD_COUNT(ptpFields), ptpFields,
+    5, 3 * 8, 5 * 8, FIELD_COUNT(ptpFingerFields), ptpFingerFields
+};
+
+/** Dispatch table. layoutIndex_g maps a report ID to its entry in 
+    layouts_g plus one, so zero means no layout is registered. */
+static const reportLayout_t* layouts_g[REPORT_MAX_LAYOUTS] =
+{
+    &mouseLayout, &keyboardLayout, &absoluteLayout, &ptpLayout
+};
+static uint8_t layoutCount_g = 4;
+static uint8_t layoutIndex_g[256] =
+{
+    [MOUSE_REPORT_ID]        = 1,
+    [KEYBOARD_REPORT_ID]     = 2,
+    [CRQ_ABSOLUTE_REPORT_ID] = 3,
+    [PTP_REPORT_ID]          = 4,
+};
+
+/** Reads a little endian field of up to 16 bits starting at any bit. */
+static inline uint16_t extractBits(const uint8_t* base, uint16_t bitOffset, uint8_t bitWidth)
+{
+    const uint8_t* iter = &base[bitOffset >> 3];
+    uint8_t shift = bitOffset & 0x07;
+    uint32_t raw;
+
+    // byte aligned fields are the common case
+    if(shift == 0)
+    {
+        if(bitWidth == 8)
+        {
+            return iter[0];
+        }
+        if(bitWidth == 16)
+        {
+            return (uint16_t)(iter[0] | (iter[1] << 8));
+        }
+    }
+
+    // only touch the bytes the field covers
+    raw = iter[0];
+    if(shift + bitWidth > 8)
+    {
+        raw |= (uint32_t)iter[1] << 8;
+    }
+    if(shift + bitWidth > 16)
+    {
+        raw |= (uint32_t)iter[2] << 16;
+    }
+    return (uint16_t)((raw >> shift) & ((1UL << bitWidth) - 1));
+}
+
+/** Extracts one field from source as it is stored in report_t: sign extended 
+    if needed, or for a REPORT_FIELD_FLAG field the mask it ORs in, shifted 
+    by slot for REPORT_FIELD_IN_REPORT masks. */
+static inline uint16_t fieldValue(const reportField_t* field, const uint8_t* source, uint8_t slot)
+{
+    uint16_t value = extractBits(source, field->bitOffset, field->bitWidth);
+
+    if(field->flags & REPORT_FIELD_FLAG)
+    {
+        uint8_t mask = value ? field->setMask : field->clearMask;
+        if(field->flags & REPORT_FIELD_IN_REPORT)
+        {
+            mask <<= slot;
+        }
+        return mask;
+    }
+
+    if((field->flags & REPORT_FIELD_SIGNED) && field->bitWidth < 16 
+       && (value & (1U << (field->bitWidth - 1))))
+    {
+        value |= (uint16_t)(0xFFFF << field->bitWidth); // sign extend
+    }
+    return value;
+}
+
+/** Extracts one field from source and stores it at its destination in base.
+    slot is the finger slot, used to shift REPORT_FIELD_IN_REPORT masks. */
+static inline void applyField(const reportField_t* field, const uint8_t* source, 
+                       uint8_t* base, uint8_t slot)
+{
+    uint16_t value = fieldValue(field, source, slot);
+    uint8_t* destination = base + field->destination;
+
+    if(field->flags & REPORT_FIELD_FLAG)
+    {
+        *destination |= (uint8_t)value;
+        return;
+    }
+
+    if(field->flags & REPORT_FIELD_16BIT)
+    {
+        *(uint16_t*)(void*)destination = value;
+    }
+    else
+    {
+        *destination = (uint8_t)value;
+    }
+}
+
+#define NO_SLOT (0xFF)   /**< recordSlots: the record is skipped */
+
+/** Reads the slot and presence fields at the start of a finger record, which 
+    decide whether and where the record lands. slot starts as the record 
+    number. Returns false if the record is to be skipped. */
+static bool recordSlot(const reportLayout_t* layout, const uint8_t* record, uint8_t* slot)
+{
+    const reportField_t* fields = layout->fingerFields;
+    bool present = true;
+    uint8_t first;
+
+    for(first = 0; first < layout->fingerFieldCount 
+        && (fields[first].flags & (REPORT_FIELD_SLOT | REPORT_FIELD_PRESENCE)); first++)
+    {
+        uint16_t value = extractBits(record, fields[first].bitOffset, fields[first].bitWidth);
+        if(fields[first].flags & REPORT_FIELD_SLOT)
+        {
+            *slot = (uint8_t)value;
+        }
+        else if(value == 0)
+        {
+            present = false;
+        }
+    }
+    return present;
+}
+
+/** Finds the finger slot of each finger record of packet, NO_SLOT for the 
+    records that are skipped. A record goes in the slot its slot field names. 
+    One that names no slot (a contact ID past 4) or one an earlier record 
+    took goes in the lowest slot no record names, so every contact has a 
+    slot; there are no more records than slots. */
+static void recordSlots(const reportLayout_t* layout, const uint8_t* packet, uint8_t* slots)
+{
+    const uint8_t* record = &packet[layout->fingerBitOffset >> 3];
+    uint8_t taken = 0, finger, free = 0;
+    bool remap = false;
+
+    for(finger = 0; finger < layout->fingerCount; finger++, record += layout->fingerBitStride >> 3)
+    {
+        uint8_t slot = finger;
+        if(!recordSlot(layout, record, &slot))
+        {
+            slots[finger] = NO_SLOT;
+        }
+        else if(slot < 5 && !(taken & (1 << slot)))
+        {
+            taken |= (uint8_t)(1 << slot);
+            slots[finger] = slot;
+        }
+        else
+        {
+            slots[finger] = 5;              // placed below
+            remap = true;
+        }
+    }
+    for(finger = 0; remap && finger < layout->fingerCount; finger++)
+    {
+        if(slots[finger] == 5)
+        {
+            while(taken & (1 << free))
+            {
+                free++;
+            }
+            taken |= (uint8_t)(1 << free);
+            slots[finger] = free;
+        }
+    }
+}
+
+/** Decodes the finger records of an absolute layout. Finger records are 
+    byte aligned; slot and presence fields must come first in the table. */
+static void decodeFingers(const reportLayout_t* layout, const uint8_t* packet, report_t* result)
+{
+    const reportField_t* fields = layout->fingerFields;
+    const uint8_t* record = &packet[layout->fingerBitOffset >> 3];
+    uint8_t strideBytes = (uint8_t)(layout->fingerBitStride >> 3);
+    uint8_t slots[5];
+    uint8_t finger, i;
+
+    recordSlots(layout, packet, slots);
+    for(finger = 0; finger < layout->fingerCount; finger++, record += strideBytes)
+    {
+        uint8_t slot = slots[finger];
+        if(slot == NO_SLOT)
+        {
+            continue;
+        }
+
+        uint8_t* fingerBase = (uint8_t*)&result->abs.fingers[slot];
+        for(i = 0; i < layout->fingerFieldCount; i++)
+        {
+            if(fields[i].flags & REPORT_FIELD_SLOT)
+            {
+                continue;
+            }
+            applyField(&fields[i], record,
+                       (fields[i].flags & REPORT_FIELD_IN_REPORT) ? (uint8_t*)result : fingerBase,
+                       slot);
+        }
+    }
+}
+
+/** Folds a field into the byte it lands on: FLAG fields OR their mask in, 
+    others replace the value. */
+static inline uint8_t foldField(const reportField_t* field, const uint8_t* source, 
+                                uint8_t slot, uint8_t current)
+{
+    uint8_t value = (uint8_t)fieldValue(field, source, slot);
+    return (field->flags & REPORT_FIELD_FLAG) ? (uint8_t)(current | value) : value;
+}
+
+/** Gathers the byte of report_t at destination from the per report fields 
+    of the viewed packet, as API_C2_decodeReport would leave it. */
+static uint8_t viewByte(const reportView_t* view, uint8_t destination)
+{
+    const reportLayout_t* layout = view->layout;
+    uint8_t result = 0, i;
+
+    for(i = 0; i < layout->fieldCount; i++)
+    {
+        const reportField_t* field = &layout->fields[i];
+        if(field->destination == destination && !(field->flags & REPORT_FIELD_16BIT))
+        {
+            result = foldField(field, view->packet, 0, result);
+        }
+    }
+    return result;
+}
+
+/** True if the finger records of layout carry bits of report_t itself, 
+    like the tip switches of a Precision Touchpad report. */
+static bool fingersInReport(const reportLayout_t* layout)
+{
+    uint8_t i;
+    for(i = 0; i < layout->fingerFieldCount; i++)
+    {
+        if(layout->fingerFields[i].flags & REPORT_FIELD_IN_REPORT)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/** Walks the finger records of the viewed absolute report once. ORs the 
+    contact bits kept in the records into contactFlags and, unless it is 
+    NULL, sets validFlags to the fingers that are confident and not a palm. 
+    Positions are never extracted. */
+static void viewFingerFlags(const reportView_t* view, uint8_t* contactFlags, uint8_t* validFlags)
+{
+    const reportLayout_t* layout = view->layout;
+    const uint8_t* record = &view->packet[layout->fingerBitOffset >> 3];
+    uint8_t palms[5] = { 0, 0, 0, 0, 0 };
+    uint8_t slots[5];
+    uint8_t finger, f;
+
+    recordSlots(layout, view->packet, slots);
+    for(finger = 0; finger < layout->fingerCount; finger++, record += layout->fingerBitStride >> 3)
+    {
+        uint8_t slot = slots[finger];
+        if(slot == NO_SLOT)
+        {
+            continue;
+        }
+        for(f = 0; f < layout->fingerFieldCount; f++)
+        {
+            const reportField_t* field = &layout->fingerFields[f];
+            if(field->flags & REPORT_FIELD_SLOT)
+            {
+                continue;
+            }
+            if(field->flags & REPORT_FIELD_IN_REPORT)
+            {
+                if(field->destination == offsetof(report_t, abs.contactFlags))
+                {
+                    *contactFlags = foldField(field, record, slot, *contactFlags);
+                }
+            }
+            else if(validFlags != NULL && field->destination == offsetof(fingerData_t, palm))
+            {
+                palms[slot] = foldField(field, record, slot, palms[slot]);
+            }
+        }
+    }
+
+    if(validFlags != NULL)
+    {
+        *validFlags = 0;
+        for(finger = 0; finger < 5; finger++)
+        {
+            if((palms[finger] & CRQ_ABSOLUTE_CONFIDENCE_MASK) && !(palms[finger] & CRQ_ABSOLUTE_PALM_REJECT_MASK))
+            {
+                *validFlags |= (uint8_t)(1 << finger);
+            }
+        }
+    }
+}
+
+/** Where a per report field of the given kind lands in a reportState_t, 
+    or NULL if the state does not keep it. */
+static uint8_t* stateByte(reportState_t* state, uint8_t kind, uint8_t destination)
+{
+    switch(kind)
+    {
+        case REPORT_KIND_MOUSE:
+            return (destination == offsetof(report_t, mouse.buttons)) ? &state->buttons : NULL;
+        case REPORT_KIND_KEYBOARD:
+            if(destination == offsetof(report_t, keyboard.modifier))
+            {
+                return &state->modifier;
+            }
+            if((uint8_t)(destination - offsetof(report_t, keyboard.keycode)) < 6)
+            {
+                return &state->keycode[destination - offsetof(report_t, keyboard.keycode)];
+            }
+            return NULL;
+        case REPORT_KIND_ABSOLUTE:
+            if(destination == offsetof(report_t, abs.contactFlags))
+            {
+                return &state->contactFlags;
+            }
+            return (destination == offsetof(report_t, abs.buttons)) ? &state->buttons : NULL;
+        default:
+            return NULL;
+    }
+}
+
+/** Clears all values of report to zero, except the report ID.
+    Assumes absolute report is the largest of the union. */
+void clearReport(report_t* report)
+{
+    // Clears the values in the Union.
+    report->abs.contactFlags = 0;
+    uint8_t i;
+    for(i = 0; i < 5; i++) // each of the 5 fingers
+    {
+        report->abs.fingers[i].palm = 0;
+        report->abs.fingers[i].x = 0;
+        report->abs.fingers[i].y = 0;
+    }
+    report->abs.buttons = 0;
+}
+
+/***********************************************************/
+/***********************************************************/
+/********************* REPORT LAYOUTS **********************/
+
+/** Adds a report layout to the decoder, or replaces the layout already 
+    registered for the same report ID. The layout and its field tables 
+    must stay valid (normally they are static const). Returns false when 
+    all REPORT_MAX_LAYOUTS entries are in use. */
+bool API_C2_registerReportLayout(const reportLayout_t* layout)
+{
+    uint8_t index = layoutIndex_g[layout->reportID];
+    if(index != 0)
+    {
+        layouts_g[index - 1] = layout;
+        return true;
+    }
+    if(layoutCount_g >= REPORT_MAX_LAYOUTS)
+    {
+        return false;
+    }
+    layouts_g[layoutCount_g++] = layout;
+    layoutIndex_g[layout->reportID] = layoutCount_g;
+    return true;
+}
+
+/** Returns the layout registered for reportID, or NULL if there is none. */
+const reportLayout_t* API_C2_getReportLayout(uint8_t reportID)
+{
+    uint8_t index = layoutIndex_g[reportID];
+    return index ? layouts_g[index - 1] : NULL;
+}
+
+/** Returns the REPORT_KIND_ of reportID, REPORT_KIND_NONE if it is unknown. */
+uint8_t API_C2_getReportKind(uint8_t reportID)
+{
+    uint8_t index = layoutIndex_g[reportID];
+    return index ? layouts_g[index - 1]->kind : REPORT_KIND_NONE;
+}
+
+/**********************************************************/
+/**********************************************************/
+/*********** TOOLS FOR DETERMINIG INPUT EVENTS ************/
+
+/** determines if the finger_num finger corresponds to a valid finger in the report 
+    The finger may still have x,y coordinates when the finger is invalid. These 
+    coordinates should be ignored */
+bool API_C2_isFingerValid(report_t* report, uint8_t finger_num)
+{
+    if(finger_num > 4 || finger_num < 0 )
+    {
+        return false;
+    }
+    
+    if(report == NULL || API_C2_getReportKind(report->reportID) != REPORT_KIND_ABSOLUTE)
+    {
+        return false;
+    }
+    
+    uint8_t palm = report->abs.fingers[finger_num].palm;
+    return ((palm & CRQ_ABSOLUTE_CONFIDENCE_MASK) && !(palm &CRQ_ABSOLUTE_PALM_REJECT_MASK));
+}
+
+/** determines if the finger_num finger is in contact with the module */
+bool API_C2_isFingerContacted(report_t* report, uint8_t finger_num)
+{
+    if(finger_num > 4 || finger_num < 0 )
+    {
+        return false;
+    }
+    
+    if(report == NULL || API_C2_getReportKind(report->reportID) != REPORT_KIND_ABSOLUTE)
+    {
+        return false;
+    }
+    return report->abs.contactFlags &  (0x1 << finger_num); 
+}
+
+
+/** determines if a button is pressed according to its mask. 
+    returns false if it's a keyboard report with no button information.*/
+bool API_C2_isButtonPressed(report_t* report, uint8_t buttonMask)
+{
+    uint8_t buttons = 0;
+    if(report == NULL)
+        return false;
+    switch(API_C2_getReportKind(report->reportID))
+    {
+        case REPORT_KIND_MOUSE:
+            buttons = report->mouse.buttons;
+            break;
+        case REPORT_KIND_ABSOLUTE:
+            buttons = report->abs.buttons;
+            break;
+        default:
+            buttons = 0;
+    }
+    return buttons & buttonMask;
+}
+
+/**********************************************************/
+/**********************************************************/
+/**********************************************************/
+
+/** Included for testing purposes. API_C2_getReport calls this.
+    The report ID in packet selects a layout from the dispatch table and 
+    the layout's field tables drive the decode. Returns false, with the 
+    report cleared but reportID still set, if no layout is registered 
+    for the report ID. */
+bool API_C2_decodeReport(uint8_t* packet, report_t* result)
+{
+    const reportLayout_t* layout = API_C2_getReportLayout(packet[2]);
+    uint8_t i;
+
+    result->reportID = packet[2];
+    clearReport(result);
+    if(layout == NULL)
+    {
+        return false;
+    }
+
+    for(i = 0; i < layout->fieldCount; i++)
+    {
+        applyField(&layout->fields[i], packet, (uint8_t*)result, 0);
+    }
+    if(layout->fingerCount)
+    {
+        decodeFingers(layout, packet, result);
+    }
+    return true;
+}
+
+/**********************************************************/
+/**********************************************************/
+/********************** REPORT VIEWS **********************/
+
+/** Sets view up over packet, which must stay valid while the view is used. 
+    Nothing is decoded yet. Returns false if no layout is registered for 
+    the report ID; the accessors then return zeros. */
+bool API_C2_viewReport(const uint8_t* packet, reportView_t* view)
+{
+    view->packet = packet;
+    view->layout = API_C2_getReportLayout(packet[2]);
+    return view->layout != NULL;
+}
+
+/** Returns the REPORT_KIND_ of the viewed report */
+uint8_t API_C2_viewKind(const reportView_t* view)
+{
+    return view->layout ? view->layout->kind : REPORT_KIND_NONE;
+}
+
+/** Bitmap of contacted fingers of an absolute report, 0 for other kinds */
+uint8_t API_C2_viewContactFlags(const reportView_t* view)
+{
+    if(API_C2_viewKind(view) != REPORT_KIND_ABSOLUTE)
+    {
+        return 0;
+    }
+    uint8_t contactFlags = viewByte(view, offsetof(report_t, abs.contactFlags));
+    if(fingersInReport(view->layout))
+    {
+        viewFingerFlags(view, &contactFlags, NULL);
+    }
+    return contactFlags;
+}
+
+/** Button bitmap of a mouse or absolute report, 0 for a keyboard report */
+uint8_t API_C2_viewButtons(const reportView_t* view)
+{
+    switch(API_C2_viewKind(view))
+    {
+        case REPORT_KIND_MOUSE:
+            return viewByte(view, offsetof(report_t, mouse.buttons));
+        case REPORT_KIND_ABSOLUTE:
+            return viewByte(view, offsetof(report_t, abs.buttons));
+        default:
+            return 0;
+    }
+}
+
+/** Modifier bitmap of a keyboard report, 0 for other kinds */
+uint8_t API_C2_viewModifier(const reportView_t* view)
+{
+    if(API_C2_viewKind(view) != REPORT_KIND_KEYBOARD)
+    {
+        return 0;
+    }
+    return viewByte(view, offsetof(report_t, keyboard.modifier));
+}
+
+/** Keycode index (0 to 5) of a keyboard report, 0 for other kinds */
+uint8_t API_C2_viewKeycode(const reportView_t* view, uint8_t index)
+{
+    if(API_C2_viewKind(view) != REPORT_KIND_KEYBOARD || index > 5)
+    {
+        return 0;
+    }
+    return viewByte(view, (uint8_t)(offsetof(report_t, keyboard.keycode) + index));
+}
+
+/** Decodes just finger finger_num of an absolute report into finger, the 
+    same as report_t.abs.fingers[finger_num] after API_C2_decodeReport. 
+    Returns false, with finger cleared, if the report has no record for it. */
+bool API_C2_viewFinger(const reportView_t* view, uint8_t finger_num, fingerData_t* finger)
+{
+    const reportLayout_t* layout = view->layout;
+    const uint8_t* record;
+    bool found = false;
+    uint8_t slots[5];
+    uint8_t i, f;
+
+    finger->x = 0;
+    finger->y = 0;
+    finger->palm = 0;
+    if(API_C2_viewKind(view) != REPORT_KIND_ABSOLUTE || finger_num > 4)
+    {
+        return false;
+    }
+
+    // records are matched to the slot the way decodeFingers places them
+    recordSlots(layout, view->packet, slots);
+    record = &view->packet[layout->fingerBitOffset >> 3];
+    for(i = 0; i < layout->fingerCount; i++, record += layout->fingerBitStride >> 3)
+    {
+        uint8_t slot = slots[i];
+        if(slot != finger_num)
+        {
+            continue;
+        }
+        for(f = 0; f < layout->fingerFieldCount; f++)
+        {
+            if(!(layout->fingerFields[f].flags & (REPORT_FIELD_SLOT | REPORT_FIELD_IN_REPORT)))
+            {
+                applyField(&layout->fingerFields[f], record, (uint8_t*)finger, slot);
+            }
+        }
+        found = true;
+    }
+    return found;
+}
+
+/** Bitmap of the fingers of an absolute report that API_C2_isFingerValid 
+    would call valid (confident and not a palm). Only the palm fields of 
+    the finger records are read. */
+uint8_t API_C2_viewValidFlags(const reportView_t* view)
+{
+    uint8_t contactFlags = 0, validFlags;
+
+    if(API_C2_viewKind(view) != REPORT_KIND_ABSOLUTE)
+    {
+        return 0;
+    }
+    viewFingerFlags(view, &contactFlags, &validFlags);
+    return validFlags;
+}
+
+/** Fills state with what the viewed report changes: buttons, contact and 
+    valid fingers, or keys. Reads the packet in one pass over the layout, 
+    skipping positions and mouse deltas. */
+void API_C2_saveReportState(const reportView_t* view, reportState_t* state)
+{
+    const reportLayout_t* layout = view->layout;
+    uint8_t kind = API_C2_viewKind(view);
+    uint8_t i;
+
+    memset(state, 0, sizeof(reportState_t));
+    state->reportID = view->packet[2];
+    if(layout == NULL)
+    {
+        return;
+    }
+    for(i = 0; i < layout->fieldCount; i++)
+    {
+        const reportField_t* field = &layout->fields[i];
+        uint8_t* target = stateByte(state, kind, field->destination);
+        if(target != NULL && !(field->flags & REPORT_FIELD_16BIT))
+        {
+            *target = foldField(field, view->packet, 0, *target);
+        }
+    }
+    if(kind == REPORT_KIND_ABSOLUTE)
+    {
+        viewFingerFlags(view, &state->contactFlags, &state->validFlags);
+    }
+}
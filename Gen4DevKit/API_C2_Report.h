@@ -0,0 +1,225 @@
+#ifndef API_C2_REPORT_H
+#define API_C2_REPORT_H
+
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+/**@file API_C2_Report.h
+   @brief Report structures and decoding for the Gen4 firmware.
+   This part of the API has no hardware dependencies, so host tools can
+   decode captured packets with exactly the same code as the dev kit. */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/***********************************************************/
+/***********************************************************/
+/******************* PROVIDED DEFINES **********************/
+
+/** Report IDs */
+#define MOUSE_REPORT_ID         (0x06) /**< ID of a Mouse Report */
+#define KEYBOARD_REPORT_ID      (0x08) /**< ID of a Keyboard Report */
+#define CRQ_ABSOLUTE_REPORT_ID  (0x09) /**< ID of a Cirque Absolute Report */
+#define PTP_REPORT_ID           (0x01) /**< ID of a Windows Precision Touchpad report. 
+                                            Register a different layout if the pad's 
+                                            report descriptor uses another ID. */
+
+/** Report kinds. Tells which member of the report_t union a layout fills. */
+#define REPORT_KIND_NONE        (0) /**< No layout registered for the report ID */
+#define REPORT_KIND_MOUSE       (1) /**< Fills report_t.mouse */
+#define REPORT_KIND_KEYBOARD    (2) /**< Fills report_t.keyboard */
+#define REPORT_KIND_ABSOLUTE    (3) /**< Fills report_t.abs */
+
+/** reportField_t flags */
+#define REPORT_FIELD_SIGNED     0x01 /**< Sign extend the field */
+#define REPORT_FIELD_16BIT      0x02 /**< Destination is 16 bits wide, otherwise 8 */
+#define REPORT_FIELD_FLAG       0x04 /**< OR setMask into the destination if the field is non-zero, clearMask if zero */
+#define REPORT_FIELD_IN_REPORT  0x08 /**< Finger field whose destination is in report_t; masks are shifted by the finger slot */
+#define REPORT_FIELD_SLOT       0x10 /**< Finger field holding the finger slot (contact ID) for the record; IDs past 4 get a free slot */
+#define REPORT_FIELD_PRESENCE   0x20 /**< Finger field that must be non-zero for the record to be decoded */
+
+/** Number of layouts the dispatch table can hold, including the built in ones */
+#define REPORT_MAX_LAYOUTS      8
+
+/** Keyboard Modifier Masks see keyboardReport_t */
+#define KEYBOARD_MODIFIER_LEFT_CTRL_KEY_MASK    0x01
+#define KEYBOARD_MODIFIER_LEFT_SHIFT_KEY_MASK   0x02
+#define KEYBOARD_MODIFIER_LEFT_ALT_KEY_MASK     0x04
+#define KEYBOARD_MODIFIER_LEFT_GUI_KEY_MASK     0x08
+#define KEYBOARD_MODIFIER_RIGHT_CTRL_KEY_MASK   0x10
+#define KEYBOARD_MODIFIER_RIGHT_SHIFT_KEY_MASK  0x20
+#define KEYBOARD_MODIFIER_RIGHT_ALT_KEY_MASK    0x40
+#define KEYBOARD_MODIFIER_RIGHT_GUI_KEY_MASK    0x80
+
+/** Palm Data Masks see fingerData_t */
+#define CRQ_ABSOLUTE_PALM_REJECT_MASK   0x80
+#define CRQ_ABSOLUTE_CONFIDENCE_MASK    0x02
+#define CRQ_ABSOLUTE_SINGLE_SAMPLE_MASK 0x01
+
+/** Button Masks see mouseReport_t, CRQabsoluteReport_t */
+#define BUTTON_1_MASK 0x1   /** Left */
+#define BUTTON_2_MASK 0x2   /** Right */
+#define BUTTON_3_MASK 0x4   /** Middle */
+#define BUTTON_8_MASK 0x80  /** Touchpad button */
+
+/** length of cirque absolute report packet
+	(largest packet size) */
+#define PACKET_SIZE 53
+
+/***********************************************************/
+/***********************************************************/
+/****************** PUBLIC DATA STRUCTURES *****************/
+
+/** Contains the data from a mouse report packet.*/
+typedef struct
+{
+    uint8_t buttons;     /**< Bitmap of the button states */
+    int8_t  xDelta;      /**< Change in Horizontal movement */
+    int8_t  yDelta;      /**< Change in vertical movement */
+    int8_t  scrollDelta; /**< Vertical Scroll value */
+    int8_t  panDelta;    /**< Horizontal Scroll (or Pan) value */
+} mouseReport_t;
+
+/** Contains the data for a Keyboard report */
+typedef struct
+{
+    uint8_t keycode[6]; /**< Keycodes pressed, only the first one is used for now */
+    uint8_t modifier;   /**< alt,ctrl, gui keys */
+} keyboardReport_t;
+
+/** Subcontainer for holding the Cirque Absolute Report data of a single finger*/
+typedef struct
+{
+    uint16_t x;    /** < Absolute X position of finger */
+    uint16_t y;    /**< Absolute Y position of finger */
+    uint8_t  palm; /** < Bitfield with Palm-reject, confidence and single sample information Note: a finger may have old or inaccurate x,y data when the confidence is low*/
+} fingerData_t;
+
+/** Contains the Report data for the Cirque Absolute mode (report id 9) */
+typedef struct
+{
+    fingerData_t fingers[5];   /**< Array of 5 Fingers */
+    uint8_t      contactFlags; /**< bitmap of contacted fingers ie. 0x3 means fingers 0 and 1 are down*/
+    uint8_t      buttons;      /**< Bitmap of the button states */
+} CRQabsoluteReport_t;
+
+/** Struct that describes a generic report.
+    This is a convienent container for handling report data.
+    Use the reportID to know which member of the Union to use.*/
+typedef struct
+{
+	/** This union allows the report to be generic.*/
+    union
+    {
+        CRQabsoluteReport_t abs;   /**< Treats the data as an absolute report */
+        keyboardReport_t keyboard; /**< Treats the data as a keyboard report */
+        mouseReport_t mouse;       /**< Treat the data as a mouse report */
+    };
+    uint8_t reportID; /**< ID of the report. Shows what type of report to use */
+} report_t;
+
+/** Describes where one value lives in a report packet and where it goes in report_t. */
+typedef struct
+{
+    uint16_t bitOffset;   /**< Position in bits from the start of the packet (or finger record) */
+    uint8_t  bitWidth;    /**< 1 to 16 bits, little endian */
+    uint8_t  flags;       /**< REPORT_FIELD_ flags */
+    uint8_t  destination; /**< offsetof() the target in report_t, or in fingerData_t for finger fields */
+    uint8_t  setMask;     /**< REPORT_FIELD_FLAG bits when the field is non-zero */
+    uint8_t  clearMask;   /**< REPORT_FIELD_FLAG bits when the field is zero */
+} reportField_t;
+
+/** Describes the layout of one report ID. Absolute layouts add a table of 
+    fields that repeats for every finger record; REPORT_FIELD_SLOT and 
+    REPORT_FIELD_PRESENCE fields must be at the start of that table. */
+typedef struct
+{
+    uint8_t  reportID;
+    uint8_t  kind;             /**< REPORT_KIND_ */
+    uint8_t  fieldCount;
+    const reportField_t* fields;      /**< Fields decoded once per report */
+    uint8_t  fingerCount;      /**< Number of finger records (at most 5) */
+    uint16_t fingerBitOffset;  /**< Start of the first finger record, in bits (byte aligned) */
+    uint16_t fingerBitStride;  /**< Distance between finger records, in bits (whole bytes) */
+    uint8_t  fingerFieldCount;
+    const reportField_t* fingerFields; /**< Fields decoded for every finger record */
+} reportLayout_t;
+
+/** A report read in place. The packet is not copied or decoded; the 
+    API_C2_view functions extract only the fields they are asked for, so 
+    code that needs contact flags or buttons never decodes finger records. */
+typedef struct
+{
+    const uint8_t* packet;          /**< PACKET_SIZE bytes as HB_readReport returned them */
+    const reportLayout_t* layout;   /**< Layout of the report ID, NULL if none is registered */
+} reportView_t;
+
+/** What event detection needs to remember of a report: its change of state, 
+    not its positions. Fields that do not apply to the kind are zero. */
+typedef struct
+{
+    uint8_t reportID;
+    uint8_t buttons;        /**< Mouse and absolute reports */
+    uint8_t contactFlags;   /**< Absolute: bitmap of contacted fingers */
+    uint8_t validFlags;     /**< Absolute: bitmap of valid fingers, see API_C2_isFingerValid */
+    uint8_t modifier;       /**< Keyboard */
+    uint8_t keycode[6];     /**< Keyboard */
+} reportState_t;
+
+/***********************************************************/
+/***********************************************************/
+/********************* REPORT LAYOUTS **********************/
+
+bool API_C2_registerReportLayout(const reportLayout_t* layout);
+
+const reportLayout_t* API_C2_getReportLayout(uint8_t reportID);
+
+uint8_t API_C2_getReportKind(uint8_t reportID);
+
+/***********************************************************/
+/***********************************************************/
+/*********** TOOLS FOR DETERMINIG INPUT EVENTS *************/
+
+bool API_C2_isFingerValid(report_t* report, uint8_t finger_num);
+
+bool API_C2_isFingerContacted(report_t* report, uint8_t finger_num);
+
+// uint8_t API_C2_numberFingers(report_t* report); no definition
+
+bool API_C2_isButtonPressed(report_t* report, uint8_t buttonMask);
+
+/***********************************************************/
+/***********************************************************/
+/***********************************************************/
+
+bool API_C2_decodeReport(uint8_t* packet, report_t* result);
+
+/***********************************************************/
+/***********************************************************/
+/********************** REPORT VIEWS ***********************/
+
+bool API_C2_viewReport(const uint8_t* packet, reportView_t* view);
+
+uint8_t API_C2_viewKind(const reportView_t* view);
+
+uint8_t API_C2_viewContactFlags(const reportView_t* view);
+
+uint8_t API_C2_viewButtons(const reportView_t* view);
+
+uint8_t API_C2_viewModifier(const reportView_t* view);
+
+uint8_t API_C2_viewKeycode(const reportView_t* view, uint8_t index);
+
+bool API_C2_viewFinger(const reportView_t* view, uint8_t finger_num, fingerData_t* finger);
+
+uint8_t API_C2_viewValidFlags(const reportView_t* view);
+
+void API_C2_saveReportState(const reportView_t* view, reportState_t* state);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // API_C2_REPORT_H
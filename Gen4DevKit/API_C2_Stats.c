@@ -0,0 +1,436 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+#include <string.h>
+#include "API_C2_Stats.h"
+
+/***********************************************************/
+/***********************************************************/
+/********************* MODULE VARIABLES ********************/
+
+/** Running mean and sum of squared differences, Welford's update. The mean
+    is in 1/256 counts and m2 in 1/65536 counts squared. */
+typedef struct
+{
+    uint32_t count;
+    int32_t  mean;
+    int64_t  m2;
+} welford_t;
+
+typedef struct
+{
+    bool      down;
+    uint32_t  downUs;           /**< When the contact started */
+    uint16_t  anchorX;          /**< Where the current still run started */
+    uint16_t  anchorY;
+    welford_t runX;             /**< The current still run */
+    welford_t runY;
+
+    /* The window */
+    uint32_t  samples;
+    uint32_t  palmRejected;
+    uint32_t  lowConfidence;
+    uint32_t  contacts;
+    uint32_t  contactMsTotal;
+    uint32_t  contactMsMax;
+    uint32_t  stillSamples;
+    uint32_t  stillDegrees;     /**< Samples less one per run, for the pooled variance */
+    int64_t   stillM2X;
+    int64_t   stillM2Y;
+    int32_t   lastMeanX;        /**< Mean of the last still run, 1/256 counts */
+    int32_t   lastMeanY;
+} fingerStats_t;
+
+static bool _running = false;
+static uint32_t _intervalUs;
+static uint32_t _windowStartUs;
+static uint32_t _nextUs;
+static bool _haveLast;
+static uint32_t _lastReportUs;
+static uint32_t _reports;
+static uint32_t _pauses;
+static uint32_t _intervalMinUs;
+static uint32_t _intervalMaxUs;
+static uint32_t _histogram[STATS_INTERVAL_BUCKETS];
+static fingerStats_t _fingers[STATS_FINGERS];
+
+/***********************************************************/
+/***********************************************************/
+/******************** HELPER FUNCTIONS *********************/
+
+static uint16_t saturate16(uint32_t value)
+{
+    return (value > 0xFFFF) ? 0xFFFF : (uint16_t)value;
+}
+
+static void put16(uint8_t* buffer, uint16_t value)
+{
+    buffer[0] = (uint8_t)(value & 0x00FF);
+    buffer[1] = (uint8_t)((value & 0xFF00) >> 8);
+}
+
+static void put32(uint8_t* buffer, uint32_t value)
+{
+    put16(buffer, (uint16_t)(value & 0xFFFF));
+    put16(&buffer[2], (uint16_t)(value >> 16));
+}
+
+static uint16_t get16(const uint8_t* buffer)
+{
+    return (uint16_t)(buffer[0] | (buffer[1] << 8));
+}
+
+static uint32_t get32(const uint8_t* buffer)
+{
+    return get16(buffer) | ((uint32_t)get16(&buffer[2]) << 16);
+}
+
+static void welfordAdd(welford_t* w, uint16_t value)
+{
+    int32_t fixed = (int32_t)value << STATS_FRACTION_BITS;
+    int32_t delta = fixed - w->mean;
+
+    w->count++;
+    w->mean += delta / (int32_t)w->count;
+    w->m2 += (int64_t)delta * (fixed - w->mean);
+}
+
+static uint32_t isqrt64(uint64_t value)
+{
+    uint64_t root = 0, bit = 1ull << 62;
+
+    while(bit > value)
+    {
+        bit >>= 2;
+    }
+    while(bit != 0)
+    {
+        if(value >= root + bit)
+        {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        }
+        else
+        {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint32_t)root;
+}
+
+/** Adds the current still run to the window, if it is long enough to say
+    anything about noise, and starts a new one */
+static void foldRun(fingerStats_t* finger)
+{
+    if(finger->runX.count >= 2)
+    {
+        finger->stillSamples += finger->runX.count;
+        finger->stillDegrees += finger->runX.count - 1;
+        finger->stillM2X += finger->runX.m2;
+        finger->stillM2Y += finger->runY.m2;
+        finger->lastMeanX = finger->runX.mean;
+        finger->lastMeanY = finger->runY.mean;
+    }
+    memset(&finger->runX, 0, sizeof(welford_t));
+    memset(&finger->runY, 0, sizeof(welford_t));
+}
+
+static uint16_t noise(int64_t m2, uint32_t degrees)
+{
+    return degrees ? saturate16(isqrt64((uint64_t)m2 / degrees)) : 0;
+}
+
+static uint8_t intervalBucket(uint32_t intervalUs)
+{
+    uint32_t ms = intervalUs / 1000;
+    uint8_t bucket = 0;
+
+    while(ms >= 2 && bucket < STATS_INTERVAL_BUCKETS - 1)
+    {
+        ms >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+static void countInterval(uint32_t timestamp)
+{
+    uint32_t interval = timestamp - _lastReportUs;
+
+    if(_haveLast)
+    {
+        if(interval > STATS_GAP_US)
+        {
+            _pauses++;
+        }
+        else
+        {
+            _histogram[intervalBucket(interval)]++;
+            _intervalMinUs = (_intervalMinUs == 0 || interval < _intervalMinUs) ? interval : _intervalMinUs;
+            _intervalMaxUs = interval > _intervalMaxUs ? interval : _intervalMaxUs;
+        }
+    }
+    _haveLast = true;
+    _lastReportUs = timestamp;
+}
+
+static void countFinger(fingerStats_t* stats, const fingerData_t* finger, uint32_t timestamp)
+{
+    bool palm = (finger->palm & CRQ_ABSOLUTE_PALM_REJECT_MASK) != 0;
+    bool confident = (finger->palm & CRQ_ABSOLUTE_CONFIDENCE_MASK) != 0;
+
+    stats->samples++;
+    stats->palmRejected += palm ? 1 : 0;
+    stats->lowConfidence += confident ? 0 : 1;
+    if(!stats->down)
+    {
+        stats->down = true;
+        stats->downUs = timestamp;
+    }
+    if(palm || !confident)
+    {
+        return;
+    }
+    if(stats->runX.count == 0
+       || finger->x > stats->anchorX + STATS_STILL_RADIUS || finger->x + STATS_STILL_RADIUS < stats->anchorX
+       || finger->y > stats->anchorY + STATS_STILL_RADIUS || finger->y + STATS_STILL_RADIUS < stats->anchorY)
+    {
+        foldRun(stats);
+        stats->anchorX = finger->x;
+        stats->anchorY = finger->y;
+    }
+    welfordAdd(&stats->runX, finger->x);
+    welfordAdd(&stats->runY, finger->y);
+}
+
+static void countLift(fingerStats_t* stats, uint32_t timestamp)
+{
+    uint32_t ms = (timestamp - stats->downUs) / 1000;
+
+    foldRun(stats);
+    stats->down = false;
+    stats->contacts++;
+    stats->contactMsTotal += ms;
+    stats->contactMsMax = ms > stats->contactMsMax ? ms : stats->contactMsMax;
+}
+
+/** Clears the window, keeping the contacts that are down */
+static void startWindow(uint32_t nowUs)
+{
+    _windowStartUs = nowUs;
+    _nextUs = nowUs + _intervalUs;
+    _reports = 0;
+    _pauses = 0;
+    _intervalMinUs = 0;
+    _intervalMaxUs = 0;
+    memset(_histogram, 0, sizeof(_histogram));
+    for(uint8_t i = 0; i < STATS_FINGERS; i++)
+    {
+        fingerStats_t* finger = &_fingers[i];
+        finger->samples = 0;
+        finger->palmRejected = 0;
+        finger->lowConfidence = 0;
+        finger->contacts = 0;
+        finger->contactMsTotal = 0;
+        finger->contactMsMax = 0;
+        finger->stillSamples = 0;
+        finger->stillDegrees = 0;
+        finger->stillM2X = 0;
+        finger->stillM2Y = 0;
+    }
+}
+
+/***********************************************************/
+/***********************************************************/
+/******************* IMPORTANT FUNCTIONS *******************/
+
+/** Starts a new set of statistics with a summary every intervalMs, or
+    STATS_INTERVAL_MS for 0 */
+void API_C2_startStats(uint16_t intervalMs, uint32_t nowUs)
+{
+    memset(_fingers, 0, sizeof(_fingers));
+    _intervalUs = (intervalMs ? intervalMs : STATS_INTERVAL_MS) * 1000u;
+    _haveLast = false;
+    _running = true;
+    startWindow(nowUs);
+}
+
+void API_C2_stopStats(void)
+{
+    _running = false;
+}
+
+bool API_C2_statsRunning(void)
+{
+    return _running;
+}
+
+/** Counts a report read at timestamp (micros()) */
+void API_C2_statsReport(const reportView_t* view, uint32_t timestamp)
+{
+    if(!_running)
+    {
+        return;
+    }
+    _reports++;
+    countInterval(timestamp);
+    if(API_C2_viewKind(view) != REPORT_KIND_ABSOLUTE)
+    {
+        return;
+    }
+
+    uint8_t contactFlags = API_C2_viewContactFlags(view);
+    for(uint8_t i = 0; i < STATS_FINGERS; i++)
+    {
+        if(contactFlags & (1 << i))
+        {
+            fingerData_t finger;
+            API_C2_viewFinger(view, i, &finger);
+            countFinger(&_fingers[i], &finger, timestamp);
+        }
+        else if(_fingers[i].down)
+        {
+            countLift(&_fingers[i], timestamp);
+        }
+    }
+}
+
+bool API_C2_statsDue(uint32_t nowUs)
+{
+    return _running && (int32_t)(nowUs - _nextUs) >= 0;
+}
+
+/** Fills summary with the window up to nowUs and starts the next one. A
+    still run that goes on past the end of the window is split there. */
+void API_C2_takeStatsSummary(statsSummary_t* summary, uint32_t nowUs)
+{
+    memset(summary, 0, sizeof(statsSummary_t));
+    summary->windowMs = (nowUs - _windowStartUs) / 1000;
+    summary->reports = saturate16(_reports);
+    summary->pauses = saturate16(_pauses);
+    summary->intervalMinUs = _intervalMinUs;
+    summary->intervalMaxUs = _intervalMaxUs;
+    for(uint8_t b = 0; b < STATS_INTERVAL_BUCKETS; b++)
+    {
+        summary->histogram[b] = saturate16(_histogram[b]);
+    }
+    for(uint8_t i = 0; i < STATS_FINGERS; i++)
+    {
+        fingerStats_t* finger = &_fingers[i];
+        statsFinger_t* out = &summary->fingers[i];
+
+        foldRun(finger);
+        if(finger->samples == 0 && finger->contacts == 0)
+        {
+            continue;
+        }
+        summary->fingerMask |= (uint8_t)(1 << i);
+        out->samples = saturate16(finger->samples);
+        out->palmRejected = saturate16(finger->palmRejected);
+        out->lowConfidence = saturate16(finger->lowConfidence);
+        out->contacts = saturate16(finger->contacts);
+        out->contactMsAvg = finger->contacts ? saturate16(finger->contactMsTotal / finger->contacts) : 0;
+        out->contactMsMax = saturate16(finger->contactMsMax);
+        out->stillSamples = saturate16(finger->stillSamples);
+        out->meanX = (uint16_t)((finger->lastMeanX + (1 << (STATS_FRACTION_BITS - 1))) >> STATS_FRACTION_BITS);
+        out->meanY = (uint16_t)((finger->lastMeanY + (1 << (STATS_FRACTION_BITS - 1))) >> STATS_FRACTION_BITS);
+        out->noiseX = noise(finger->stillM2X, finger->stillDegrees);
+        out->noiseY = noise(finger->stillM2Y, finger->stillDegrees);
+    }
+    startWindow(nowUs);
+}
+
+/***********************************************************/
+/***********************************************************/
+/******************** PUBLIC FUNCTIONS *********************/
+
+/** Lays a summary out for a STREAM_TYPE_STATS frame (little endian):
+        version fingerMask windowMs[4] reports[2] pauses[2]
+        intervalMinUs[4] intervalMaxUs[4] histogram[2 * STATS_INTERVAL_BUCKETS]
+    then for each finger in fingerMask, lowest first, the statsFinger_t
+    fields in order, 2 bytes each. Returns the length. */
+uint16_t API_C2_encodeStatsSummary(const statsSummary_t* summary, uint8_t* payload)
+{
+    uint16_t length = STATS_SUMMARY_HEADER;
+
+    payload[0] = STATS_SUMMARY_VERSION;
+    payload[1] = summary->fingerMask;
+    put32(&payload[2], summary->windowMs);
+    put16(&payload[6], summary->reports);
+    put16(&payload[8], summary->pauses);
+    put32(&payload[10], summary->intervalMinUs);
+    put32(&payload[14], summary->intervalMaxUs);
+    for(uint8_t b = 0; b < STATS_INTERVAL_BUCKETS; b++)
+    {
+        put16(&payload[18 + 2 * b], summary->histogram[b]);
+    }
+    for(uint8_t i = 0; i < STATS_FINGERS; i++)
+    {
+        const statsFinger_t* finger = &summary->fingers[i];
+        if(!(summary->fingerMask & (1 << i)))
+        {
+            continue;
+        }
+        put16(&payload[length + 0], finger->samples);
+        put16(&payload[length + 2], finger->palmRejected);
+        put16(&payload[length + 4], finger->lowConfidence);
+        put16(&payload[length + 6], finger->contacts);
+        put16(&payload[length + 8], finger->contactMsAvg);
+        put16(&payload[length + 10], finger->contactMsMax);
+        put16(&payload[length + 12], finger->stillSamples);
+        put16(&payload[length + 14], finger->meanX);
+        put16(&payload[length + 16], finger->meanY);
+        put16(&payload[length + 18], finger->noiseX);
+        put16(&payload[length + 20], finger->noiseY);
+        length += STATS_FINGER_SIZE;
+    }
+    return length;
+}
+
+/** Reads back what API_C2_encodeStatsSummary wrote. Returns false for
+    another version or a payload of the wrong length. */
+bool API_C2_decodeStatsSummary(const uint8_t* payload, uint16_t length, statsSummary_t* summary)
+{
+    uint16_t offset = STATS_SUMMARY_HEADER;
+
+    memset(summary, 0, sizeof(statsSummary_t));
+    if(length < STATS_SUMMARY_HEADER || payload[0] != STATS_SUMMARY_VERSION)
+    {
+        return false;
+    }
+    summary->fingerMask = payload[1] & ((1 << STATS_FINGERS) - 1);
+    summary->windowMs = get32(&payload[2]);
+    summary->reports = get16(&payload[6]);
+    summary->pauses = get16(&payload[8]);
+    summary->intervalMinUs = get32(&payload[10]);
+    summary->intervalMaxUs = get32(&payload[14]);
+    for(uint8_t b = 0; b < STATS_INTERVAL_BUCKETS; b++)
+    {
+        summary->histogram[b] = get16(&payload[18 + 2 * b]);
+    }
+    for(uint8_t i = 0; i < STATS_FINGERS; i++)
+    {
+        statsFinger_t* finger = &summary->fingers[i];
+        if(!(summary->fingerMask & (1 << i)))
+        {
+            continue;
+        }
+        if(offset + STATS_FINGER_SIZE > length)
+        {
+            return false;
+        }
+        finger->samples = get16(&payload[offset + 0]);
+        finger->palmRejected = get16(&payload[offset + 2]);
+        finger->lowConfidence = get16(&payload[offset + 4]);
+        finger->contacts = get16(&payload[offset + 6]);
+        finger->contactMsAvg = get16(&payload[offset + 8]);
+        finger->contactMsMax = get16(&payload[offset + 10]);
+        finger->stillSamples = get16(&payload[offset + 12]);
+        finger->meanX = get16(&payload[offset + 14]);
+        finger->meanY = get16(&payload[offset + 16]);
+        finger->noiseX = get16(&payload[offset + 18]);
+        finger->noiseY = get16(&payload[offset + 20]);
+        offset += STATS_FINGER_SIZE;
+    }
+    return offset == length;
+}
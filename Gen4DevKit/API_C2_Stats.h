@@ -0,0 +1,126 @@
+#ifndef API_C2_STATS_H
+#define API_C2_STATS_H
+
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+/**@file API_C2_Stats.h
+   @brief Touch statistics kept on the dev kit, sent as a summary per window.
+
+   Instead of every report, the host gets one summary every intervalMs. For
+   the window it covers, the summary holds the report interval (smallest,
+   largest and a histogram), and for each finger:
+     - samples with the finger down, palm rejected or without confidence
+       (from fingerData_t.palm),
+     - contacts that ended, with their mean and longest duration,
+     - the noise of the position while the finger stays still.
+
+   A finger is still while it stays within STATS_STILL_RADIUS counts of
+   where it settled; moving further starts a new still run there. The mean
+   and variance of each run are kept with Welford's update in fixed point
+   (positions in 1/256 counts, STATS_FRACTION_BITS), and the noise is the
+   standard deviation pooled over the runs of the window, so slow drift
+   between runs does not count as noise. Only confident, not palm rejected
+   samples are used for it.
+
+   Everything is integer arithmetic, for the Cortex-M4 without an FPU. A
+   summary is at most STATS_SUMMARY_MAX_SIZE bytes (see
+   API_C2_encodeStatsSummary), against a report frame for every report. */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "API_C2_Report.h"
+
+/***********************************************************/
+/***********************************************************/
+/******************* PROVIDED DEFINES **********************/
+
+#define STATS_FINGERS           (5)
+#define STATS_FRACTION_BITS     (8)   /**< Fixed point fraction of means and noise */
+
+/** Report interval histogram: bucket 0 holds intervals under 2 ms, bucket b
+    those from 2^b to 2^(b+1) ms, and the last everything from 128 ms up */
+#define STATS_INTERVAL_BUCKETS  (8)
+
+/** Default summary interval */
+#ifndef STATS_INTERVAL_MS
+#define STATS_INTERVAL_MS       (1000)
+#endif
+
+/** Movement, in counts, that ends a still run */
+#ifndef STATS_STILL_RADIUS
+#define STATS_STILL_RADIUS      (4)
+#endif
+
+/** A longer time between reports is a pause (nothing touched), not an interval */
+#ifndef STATS_GAP_US
+#define STATS_GAP_US            (250000)
+#endif
+
+#define STATS_SUMMARY_VERSION   (1)
+#define STATS_SUMMARY_HEADER    (34)  /**< Bytes before the finger records */
+#define STATS_FINGER_SIZE       (22)  /**< Bytes per finger record */
+#define STATS_SUMMARY_MAX_SIZE  (STATS_SUMMARY_HEADER + STATS_FINGERS * STATS_FINGER_SIZE)
+
+/***********************************************************/
+/***********************************************************/
+/****************** PUBLIC DATA STRUCTURES *****************/
+
+/** One finger's part of a summary. Counts saturate at 0xFFFF. */
+typedef struct
+{
+    uint16_t samples;           /**< Reports with the finger down */
+    uint16_t palmRejected;      /**< ... marked palm rejected */
+    uint16_t lowConfidence;     /**< ... without the confidence bit */
+    uint16_t contacts;          /**< Contacts that ended in the window */
+    uint16_t contactMsAvg;
+    uint16_t contactMsMax;
+    uint16_t stillSamples;      /**< Samples in still runs of 2 or more */
+    uint16_t meanX;             /**< Where the finger last stayed still, counts */
+    uint16_t meanY;
+    uint16_t noiseX;            /**< Pooled standard deviation while still, 1/256 counts */
+    uint16_t noiseY;
+} statsFinger_t;
+
+typedef struct
+{
+    uint32_t windowMs;          /**< Time the summary covers */
+    uint16_t reports;
+    uint16_t pauses;            /**< Gaps longer than STATS_GAP_US */
+    uint32_t intervalMinUs;     /**< 0 without intervals */
+    uint32_t intervalMaxUs;
+    uint16_t histogram[STATS_INTERVAL_BUCKETS];
+    uint8_t  fingerMask;        /**< Fingers with samples or contacts, one record each */
+    statsFinger_t fingers[STATS_FINGERS];
+} statsSummary_t;
+
+/***********************************************************/
+/***********************************************************/
+/******************* IMPORTANT FUNCTIONS *******************/
+
+void API_C2_startStats(uint16_t intervalMs, uint32_t nowUs);
+
+void API_C2_stopStats(void);
+
+bool API_C2_statsRunning(void);
+
+void API_C2_statsReport(const reportView_t* view, uint32_t timestamp);
+
+bool API_C2_statsDue(uint32_t nowUs);
+
+void API_C2_takeStatsSummary(statsSummary_t* summary, uint32_t nowUs);
+
+/***********************************************************/
+/***********************************************************/
+/******************** PUBLIC FUNCTIONS *********************/
+
+uint16_t API_C2_encodeStatsSummary(const statsSummary_t* summary, uint8_t* payload);
+
+bool API_C2_decodeStatsSummary(const uint8_t* payload, uint16_t length, statsSummary_t* summary);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // API_C2_STATS_H
@@ -0,0 +1,480 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+#include <string.h>
+#include "API_C2_Watch.h"
+#include "API_C2.h"
+#include "API_Hardware.h"
+
+/** Most bytes one burst reads, within HB_MAX_READ_COUNT */
+#define WATCH_MAX_BURST         (32)
+
+/** Bus time per byte assumed until a burst has been timed: 9 bits at 400 kHz */
+#define WATCH_DEFAULT_NS_PER_BYTE (22500)
+
+typedef struct
+{
+    uint32_t address;
+    uint32_t periodUs;
+    uint32_t dueUs;             /**< When the register is next read */
+    uint32_t value;
+    uint8_t  length;
+    bool     valid;             /**< value has been read */
+} watchEntry_t;
+
+/***********************************************************/
+/***********************************************************/
+/********************* MODULE VARIABLES ********************/
+
+static watchEntry_t _entries[WATCH_MAX_REGISTERS];  /**< In address order */
+static uint8_t _count = 0;
+static bool _enabled = false;
+static watchEvent_t _events[WATCH_EVENTS];
+static uint8_t _eventHead = 0;
+static uint8_t _eventCount = 0;
+static watchStats_t _stats;
+static uint32_t _nsPerByte = WATCH_DEFAULT_NS_PER_BYTE;
+static bool _seenReport = false;
+static uint32_t _lastReadyUs;       /**< Data Ready of the last report */
+static uint32_t _intervalUs = 0;    /**< Shortest recent report interval, 0 while not known */
+static bool _deferred = false;      /**< A due read has waited since the last report */
+static bool _burstKept = false;     /**< The last burst has not yet been matched to a report */
+static uint32_t _burstStartUs;
+static uint32_t _burstEndUs;
+
+/***********************************************************/
+/***********************************************************/
+/******************** HELPER FUNCTIONS *********************/
+
+static void put32(uint8_t* buffer, uint32_t value)
+{
+    buffer[0] = (uint8_t)(value & 0xFF);
+    buffer[1] = (uint8_t)((value >> 8) & 0xFF);
+    buffer[2] = (uint8_t)((value >> 16) & 0xFF);
+    buffer[3] = (uint8_t)(value >> 24);
+}
+
+static uint32_t get32(const uint8_t* buffer)
+{
+    return (uint32_t)buffer[0] | ((uint32_t)buffer[1] << 8)
+         | ((uint32_t)buffer[2] << 16) | ((uint32_t)buffer[3] << 24);
+}
+
+/** Little endian value of length bytes */
+static uint32_t getValue(const uint8_t* data, uint8_t length)
+{
+    uint32_t value = 0;
+
+    for(uint8_t i = length; i > 0; i--)
+    {
+        value = (value << 8) | data[i - 1];
+    }
+    return value;
+}
+
+static uint32_t predictUs(uint16_t bytes)
+{
+    return (uint32_t)(((uint64_t)(WATCH_READ_OVERHEAD + bytes) * _nsPerByte + 999) / 1000);
+}
+
+/** A timed successful burst: a slower bus is followed a quarter of the way
+    at a time, a faster one an eighth, so the gaps asked for lean long. A
+    burst held up by an interrupt counts as twice the estimate at most, so
+    it cannot price every register out of the gaps there are. */
+static void learnCost(uint16_t bytes, uint32_t durationUs)
+{
+    uint32_t sample = (uint32_t)((uint64_t)durationUs * 1000 / (WATCH_READ_OVERHEAD + bytes));
+
+    sample = sample > 2 * _nsPerByte ? 2 * _nsPerByte : sample;
+    if(sample > _nsPerByte)
+    {
+        _nsPerByte += (sample - _nsPerByte) / 4;
+    }
+    else
+    {
+        _nsPerByte -= (_nsPerByte - sample) / 8;
+    }
+}
+
+/** True if a read of burstUs started now ends WATCH_GUARD_US before the next
+    report is expected. With no report interval known, or the reports
+    stopped (none for two intervals), any time is a gap. */
+static bool gapFits(uint32_t nowUs, uint32_t burstUs)
+{
+    if(!_seenReport || _intervalUs == 0 || nowUs - _lastReadyUs >= 2 * _intervalUs)
+    {
+        return true;
+    }
+    uint32_t nextUs = _lastReadyUs + _intervalUs;
+    return (int32_t)(nextUs - (nowUs + burstUs + WATCH_GUARD_US)) >= 0;
+}
+
+static bool isDue(const watchEntry_t* entry, uint32_t nowUs)
+{
+    return (int32_t)(nowUs - entry->dueUs) >= 0;
+}
+
+/** Due, or at least half way there */
+static bool isNearlyDue(const watchEntry_t* entry, uint32_t nowUs)
+{
+    return (int32_t)(entry->dueUs - nowUs) <= (int32_t)(entry->periodUs / 2);
+}
+
+/** True if bytes start up to end fit one burst: WATCH_MAX_BURST,
+    WATCH_MAX_DELAY_US and, unless overdue, the gap */
+static bool burstFits(uint32_t start, uint32_t end, uint32_t nowUs, bool overdue)
+{
+    uint32_t burstUs = predictUs((uint16_t)(end - start));
+
+    return end - start <= WATCH_MAX_BURST && burstUs <= WATCH_MAX_DELAY_US && (overdue || gapFits(nowUs, burstUs));
+}
+
+/** Picks the next burst: the register longest past due, and around it the
+    nearly due ones that can join it within WATCH_MAX_GAP and burstFits.
+    Registers in between are read along with them. A register a whole
+    period past due has waited long enough for a gap, and is read now if it
+    fits WATCH_MAX_DELAY_US. Returns false if nothing is due or the register
+    longest past due does not fit. */
+static bool planBurst(uint32_t nowUs, uint8_t* first, uint8_t* last, uint16_t* bytes)
+{
+    uint8_t i = _count;
+
+    for(uint8_t j = 0; j < _count; j++)
+    {
+        if(isDue(&_entries[j], nowUs) && (i == _count || (int32_t)(_entries[j].dueUs - _entries[i].dueUs) < 0))
+        {
+            i = j;
+        }
+    }
+    if(i == _count)
+    {
+        return false;
+    }
+    const watchEntry_t* oldest = &_entries[i];
+    uint32_t start = oldest->address;
+    uint32_t end = start + oldest->length;
+    uint32_t oldestUs = predictUs(oldest->length);
+    bool overdue = nowUs - oldest->dueUs >= oldest->periodUs && oldestUs <= WATCH_MAX_DELAY_US;
+    if(!overdue && !gapFits(nowUs, oldestUs))
+    {
+        if(!_deferred)
+        {
+            _stats.deferrals++;
+            _deferred = true;
+        }
+        return false;
+    }
+    *first = *last = i;
+    uint32_t readStart = start, readEnd = end;
+    for(uint8_t j = i + 1; j < _count; j++)
+    {
+        const watchEntry_t* entry = &_entries[j];
+        uint32_t entryEnd = entry->address + entry->length;
+        uint32_t spanEnd = entryEnd > end ? entryEnd : end;
+        if(entry->address > end + WATCH_MAX_GAP || !burstFits(readStart, spanEnd, nowUs, overdue))
+        {
+            break;
+        }
+        end = spanEnd;
+        if(isNearlyDue(entry, nowUs))
+        {
+            *last = j;
+            readEnd = end;
+        }
+    }
+    end = readEnd;
+    for(uint8_t j = i; j-- > 0;)
+    {
+        const watchEntry_t* entry = &_entries[j];
+        uint32_t entryEnd = entry->address + entry->length;
+        uint32_t spanEnd = entryEnd > end ? entryEnd : end;
+        if(entryEnd + WATCH_MAX_GAP < start || !burstFits(entry->address, spanEnd, nowUs, overdue))
+        {
+            break;
+        }
+        start = entry->address;
+        end = spanEnd;
+        if(isNearlyDue(entry, nowUs))
+        {
+            *first = j;
+            readStart = start;
+            readEnd = end;
+        }
+    }
+    *bytes = (uint16_t)(readEnd - readStart);
+    return true;
+}
+
+static void queueEvent(const watchEntry_t* entry, uint32_t value, uint32_t timestamp)
+{
+    _stats.changes++;
+    if(_eventCount == WATCH_EVENTS)
+    {
+        _stats.eventsDropped++;
+        return;
+    }
+    watchEvent_t* event = &_events[(_eventHead + _eventCount) % WATCH_EVENTS];
+    event->address = entry->address;
+    event->length = entry->length;
+    event->flags = entry->valid ? 0 : WATCH_EVENT_FIRST;
+    event->previous = entry->valid ? entry->value : 0;
+    event->value = value;
+    event->timestamp = timestamp;
+    _eventCount++;
+}
+
+/***********************************************************/
+/***********************************************************/
+/******************* IMPORTANT FUNCTIONS *******************/
+
+/** Watches length bytes (1 to WATCH_MAX_LENGTH) at address, read every
+    periodMs. The first read is due at once and makes a WATCH_EVENT_FIRST
+    event. Adding an address already watched changes its length and period;
+    periodMs 0 stops watching it. Returns false if length is out of range or
+    WATCH_MAX_REGISTERS are already watched. */
+bool API_C2_watchAdd(uint32_t address, uint8_t length, uint16_t periodMs, uint32_t nowUs)
+{
+    uint8_t i = 0;
+
+    if(length == 0 || length > WATCH_MAX_LENGTH)
+    {
+        return false;
+    }
+    while(i < _count && _entries[i].address < address)
+    {
+        i++;
+    }
+    bool found = i < _count && _entries[i].address == address;
+    if(periodMs == 0)
+    {
+        if(found)
+        {
+            memmove(&_entries[i], &_entries[i + 1], (_count - i - 1) * sizeof(watchEntry_t));
+            _count--;
+        }
+        return true;
+    }
+    if(!found)
+    {
+        if(_count == WATCH_MAX_REGISTERS)
+        {
+            return false;
+        }
+        memmove(&_entries[i + 1], &_entries[i], (_count - i) * sizeof(watchEntry_t));
+        _count++;
+    }
+    watchEntry_t* entry = &_entries[i];
+    entry->address = address;
+    entry->length = length;
+    entry->periodUs = (uint32_t)periodMs * 1000;
+    entry->dueUs = nowUs;
+    entry->value = 0;
+    entry->valid = false;
+    return true;
+}
+
+void API_C2_watchClear(void)
+{
+    _count = 0;
+}
+
+uint8_t API_C2_watchCount(void)
+{
+    return _count;
+}
+
+/** Turns the monitor on or off. The watch list is kept either way. */
+void API_C2_watchEnable(bool enable)
+{
+    _enabled = enable;
+    _deferred = false;
+}
+
+bool API_C2_watchEnabled(void)
+{
+    return _enabled;
+}
+
+/** Tells the monitor a report was read, readyUs being when its Data Ready
+    asserted (as for API_Haptic_report). Learns the report interval from it,
+    and if Data Ready asserted while the last burst was on the bus, counts
+    the wait to the end of the burst against the monitor. */
+void API_C2_watchReport(uint32_t readyUs, uint32_t nowUs)
+{
+    (void)nowUs;
+    if(_seenReport)
+    {
+        uint32_t intervalUs = readyUs - _lastReadyUs;
+        if(intervalUs > 0 && intervalUs < WATCH_QUIET_US)
+        {
+            if(_intervalUs == 0 || intervalUs < _intervalUs)
+            {
+                _intervalUs = intervalUs;
+            }
+            else
+            {
+                _intervalUs += (intervalUs - _intervalUs) / 8;
+            }
+        }
+    }
+    _seenReport = true;
+    _lastReadyUs = readyUs;
+    _deferred = false;
+
+    if(_burstKept && (int32_t)(_burstEndUs - readyUs) > 0)
+    {
+        uint32_t fromUs = (int32_t)(readyUs - _burstStartUs) > 0 ? readyUs : _burstStartUs;
+        uint32_t delayUs = _burstEndUs - fromUs;
+        _stats.reportsDelayed++;
+        _stats.totalDelayUs += delayUs;
+        _stats.maxDelayUs = delayUs > _stats.maxDelayUs ? delayUs : _stats.maxDelayUs;
+        if(delayUs > WATCH_MAX_DELAY_US)
+        {
+            _stats.overCap++;
+        }
+    }
+    _burstKept = false;
+}
+
+/** True when a burst is due and the bus is in a gap that fits it: the
+    ready() of the sketch's watch task */
+bool API_C2_watchDue(uint32_t nowUs)
+{
+    uint8_t first, last;
+    uint16_t bytes;
+
+    if(!_enabled || _count == 0 || API_C2_DR_Asserted())
+    {
+        return false;
+    }
+    return planBurst(nowUs, &first, &last, &bytes);
+}
+
+/** Makes one burst, if one is due and fits (see API_C2_watchDue), and
+    queues an event for each register whose value changed */
+void API_C2_watchPoll(uint32_t nowUs)
+{
+    uint8_t first, last;
+    uint16_t bytes;
+    uint8_t data[WATCH_MAX_BURST];
+
+    if(!_enabled || !planBurst(nowUs, &first, &last, &bytes))
+    {
+        return;
+    }
+    uint32_t base = _entries[first].address;
+    uint32_t startUs = API_Hardware_micros();
+    uint8_t status = API_C2_readMemory(base, data, bytes);
+    uint32_t endUs = API_Hardware_micros();
+    uint32_t durationUs = endUs - startUs;
+
+    _burstKept = true;
+    _burstStartUs = startUs;
+    _burstEndUs = endUs;
+    _stats.bursts++;
+    _stats.bytes += bytes;
+    _stats.maxBurstUs = durationUs > _stats.maxBurstUs ? durationUs : _stats.maxBurstUs;
+    if(status == SUCCESS)
+    {
+        learnCost(bytes, durationUs);
+    }
+    else
+    {
+        _stats.errors++;
+    }
+    for(uint8_t i = first; i <= last; i++)
+    {
+        watchEntry_t* entry = &_entries[i];
+        if(isDue(entry, nowUs))
+        {
+            uint32_t lateUs = nowUs - entry->dueUs;
+            _stats.maxLateUs = lateUs > _stats.maxLateUs ? lateUs : _stats.maxLateUs;
+        }
+        entry->dueUs = nowUs + entry->periodUs;
+        _stats.registers++;
+        if(status != SUCCESS)
+        {
+            continue;
+        }
+        uint32_t value = getValue(&data[entry->address - base], entry->length);
+        if(!entry->valid || value != entry->value)
+        {
+            queueEvent(entry, value, endUs);
+            entry->value = value;
+            entry->valid = true;
+        }
+    }
+}
+
+bool API_C2_watchEventPending(void)
+{
+    return _eventCount > 0;
+}
+
+/** Takes the oldest change event. Returns false if there is none. */
+bool API_C2_takeWatchEvent(watchEvent_t* event)
+{
+    if(_eventCount == 0)
+    {
+        return false;
+    }
+    *event = _events[_eventHead];
+    _eventHead = (_eventHead + 1) % WATCH_EVENTS;
+    _eventCount--;
+    return true;
+}
+
+/** Writes an event as the payload of a STREAM_TYPE_WATCH frame, whose
+    timestamp is the event's:
+        address[4] length[1] flags[1] previous[4] value[4]
+    Returns WATCH_EVENT_SIZE. */
+uint8_t API_C2_encodeWatchEvent(const watchEvent_t* event, uint8_t* payload)
+{
+    put32(&payload[0], event->address);
+    payload[4] = event->length;
+    payload[5] = event->flags;
+    put32(&payload[6], event->previous);
+    put32(&payload[10], event->value);
+    return WATCH_EVENT_SIZE;
+}
+
+/** Reads back what API_C2_encodeWatchEvent wrote, the timestamp being the
+    frame's. Returns false for a payload of the wrong length. */
+bool API_C2_decodeWatchEvent(const uint8_t* payload, uint16_t length, uint32_t timestamp, watchEvent_t* event)
+{
+    if(length != WATCH_EVENT_SIZE)
+    {
+        return false;
+    }
+    event->address = get32(&payload[0]);
+    event->length = payload[4];
+    event->flags = payload[5];
+    event->previous = get32(&payload[6]);
+    event->value = get32(&payload[10]);
+    event->timestamp = timestamp;
+    return true;
+}
+
+/***********************************************************/
+/***********************************************************/
+/******************** PUBLIC FUNCTIONS *********************/
+
+const watchStats_t* API_C2_getWatchStats(void)
+{
+    return &_stats;
+}
+
+uint32_t API_C2_watchMeanDelayUs(const watchStats_t* stats)
+{
+    return stats->reportsDelayed ? (uint32_t)(stats->totalDelayUs / stats->reportsDelayed) : 0;
+}
+
+/** Bus time per byte as measured, which bursts are planned with */
+uint32_t API_C2_watchNsPerByte(void)
+{
+    return _nsPerByte;
+}
+
+void API_C2_resetWatchStats(void)
+{
+    memset(&_stats, 0, sizeof(_stats));
+}
@@ -0,0 +1,144 @@
+#ifndef API_C2_WATCH_H
+#define API_C2_WATCH_H
+
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+/**@file API_C2_Watch.h
+   @brief Background register monitor: registers read in the bus gaps
+   between reports, with an event for every change.
+
+   Each watched register has an address, a length of 1 to WATCH_MAX_LENGTH
+   bytes and a polling period. A read is only started in an idle window:
+   Data Ready not asserted and, from the report interval seen so far, the
+   next report not expected before the read would be done (plus
+   WATCH_GUARD_US). A register left a whole period past due for want of
+   such a gap is read at the next chance Data Ready allows, within
+   WATCH_MAX_DELAY_US, so a busy stream only slows the watch down.
+
+   Registers are kept in address order. A burst is built around the one
+   longest past due and takes in the registers either side of it that are
+   at most WATCH_MAX_GAP bytes apart and at least half way to being due, so
+   neighbouring registers cost one extended memory read instead of one each.
+
+   A burst is never planned to take longer than WATCH_MAX_DELAY_US, the
+   most it may hold up a report whose Data Ready asserts just after it
+   starts. Its time is predicted from its bytes and the bus time per byte
+   measured on the bursts so far. A register that alone would take longer
+   is still read, but only where the gap fits it.
+
+   What a burst actually cost reports is measured: a report whose Data
+   Ready asserted during a burst (API_C2_watchReport) was held up until the
+   burst ended, and that delay is kept in watchStats_t. The sketch calls
+   API_C2_watchReport from reportTask, and API_C2_watchPoll from a task
+   below the report tasks whose ready() is API_C2_watchDue. */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/***********************************************************/
+/***********************************************************/
+/******************* PROVIDED DEFINES **********************/
+
+#define WATCH_MAX_REGISTERS     (16)
+#define WATCH_MAX_LENGTH        (4)
+#define WATCH_EVENTS            (16)    /**< Change events waiting to be taken */
+#define WATCH_EVENT_SIZE        (14)    /**< Bytes of API_C2_encodeWatchEvent */
+
+/** Bytes of bus traffic an extended memory read has besides its data: the
+    8 byte preamble, two address bytes and the 3 bytes of length and checksum */
+#define WATCH_READ_OVERHEAD     (13)
+
+/** Flags of watchEvent_t */
+#define WATCH_EVENT_FIRST       (0x01)  /**< First read of the register, previous is not known */
+
+#ifndef WATCH_MAX_GAP
+#define WATCH_MAX_GAP           (4)     /**< Unwatched bytes a burst reads to join two registers */
+#endif
+#ifndef WATCH_MAX_DELAY_US
+#define WATCH_MAX_DELAY_US      (500)   /**< Longest burst planned, the most a report is held up */
+#endif
+#ifndef WATCH_GUARD_US
+#define WATCH_GUARD_US          (200)   /**< Margin left before the next expected report */
+#endif
+#ifndef WATCH_QUIET_US
+#define WATCH_QUIET_US          (50000) /**< Longer between reports is not a report interval */
+#endif
+
+/***********************************************************/
+/***********************************************************/
+/****************** PUBLIC DATA STRUCTURES *****************/
+
+typedef struct
+{
+    uint32_t address;
+    uint8_t  length;
+    uint8_t  flags;             /**< WATCH_EVENT_ */
+    uint32_t previous;          /**< Little endian, as read */
+    uint32_t value;
+    uint32_t timestamp;         /**< When the read that saw the change ended */
+} watchEvent_t;
+
+typedef struct
+{
+    uint32_t bursts;            /**< Extended memory reads made */
+    uint32_t registers;         /**< Register reads they made, more than bursts when coalesced */
+    uint32_t bytes;             /**< Data bytes read, unwatched bytes between registers too */
+    uint32_t errors;            /**< Bursts the bus failed */
+    uint32_t changes;           /**< Events made, first reads too */
+    uint32_t eventsDropped;     /**< Events lost to a full queue */
+    uint32_t deferrals;         /**< Report intervals a due read waited out for want of a gap */
+    uint32_t maxLateUs;         /**< Longest a register waited past due */
+    uint32_t maxBurstUs;        /**< Longest burst */
+    uint32_t reportsDelayed;    /**< Reports whose Data Ready asserted during a burst */
+    uint32_t maxDelayUs;        /**< Longest of those delays */
+    uint64_t totalDelayUs;
+    uint32_t overCap;           /**< Delays longer than WATCH_MAX_DELAY_US */
+} watchStats_t;
+
+/***********************************************************/
+/***********************************************************/
+/******************* IMPORTANT FUNCTIONS *******************/
+
+bool API_C2_watchAdd(uint32_t address, uint8_t length, uint16_t periodMs, uint32_t nowUs);
+
+void API_C2_watchClear(void);
+
+uint8_t API_C2_watchCount(void);
+
+void API_C2_watchEnable(bool enable);
+
+bool API_C2_watchEnabled(void);
+
+void API_C2_watchReport(uint32_t readyUs, uint32_t nowUs);
+
+bool API_C2_watchDue(uint32_t nowUs);
+
+void API_C2_watchPoll(uint32_t nowUs);
+
+bool API_C2_watchEventPending(void);
+
+bool API_C2_takeWatchEvent(watchEvent_t* event);
+
+uint8_t API_C2_encodeWatchEvent(const watchEvent_t* event, uint8_t* payload);
+
+bool API_C2_decodeWatchEvent(const uint8_t* payload, uint16_t length, uint32_t timestamp, watchEvent_t* event);
+
+/***********************************************************/
+/***********************************************************/
+/******************** PUBLIC FUNCTIONS *********************/
+
+const watchStats_t* API_C2_getWatchStats(void);
+
+uint32_t API_C2_watchMeanDelayUs(const watchStats_t* stats);
+
+uint32_t API_C2_watchNsPerByte(void);
+
+void API_C2_resetWatchStats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // API_C2_WATCH_H
@@ -0,0 +1,273 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+#include <string.h>
+#include "API_Command.h"
+#include "API_C2.h"
+#include "API_C2_Idle.h"
+#include "API_C2_Region.h"
+#include "API_C2_Stats.h"
+#include "API_Haptic.h"
+#include "API_C2_Watch.h"
+#include "API_Hardware.h"
+
+/** Bytes of one READ_BATCH range: address(4) + count(2) */
+#define COMMAND_RANGE_SIZE (6)
+
+/***********************************************************/
+/***********************************************************/
+/********************* MODULE VARIABLES ********************/
+
+/** The READ_REGION being streamed, see API_Command_nextRegionFrame */
+static regionReader_t _region;
+static uint16_t _regionRequestId;
+
+/***********************************************************/
+/***********************************************************/
+/********************* HELPER FUNCTIONS ********************/
+
+static uint32_t get32(const uint8_t* buffer)
+{
+    return (uint32_t)buffer[0] | ((uint32_t)buffer[1] << 8)
+         | ((uint32_t)buffer[2] << 16) | ((uint32_t)buffer[3] << 24);
+}
+
+static uint16_t get16(const uint8_t* buffer)
+{
+    return (uint16_t)(buffer[0] | (buffer[1] << 8));
+}
+
+static void put16(uint8_t* buffer, uint16_t value)
+{
+    buffer[0] = (uint8_t)(value & 0x00FF);
+    buffer[1] = (uint8_t)((value & 0xFF00) >> 8);
+}
+
+static void put32(uint8_t* buffer, uint32_t value)
+{
+    put16(buffer, (uint16_t)(value & 0xFFFF));
+    put16(&buffer[2], (uint16_t)(value >> 16));
+}
+
+/** Writes count bytes in COMMAND_TRANSFER_SIZE pieces. Returns the combined status. */
+static uint8_t writeRange(uint32_t address, uint8_t* data, uint16_t count)
+{
+    uint8_t status = SUCCESS;
+    while(count > 0)
+    {
+        uint8_t piece = (count < COMMAND_TRANSFER_SIZE) ? (uint8_t)count : COMMAND_TRANSFER_SIZE;
+        status |= API_C2_writeMemory(address, data, piece);
+        address += piece;
+        data += piece;
+        count -= piece;
+    }
+    return status;
+}
+
+/** Runs one of the menu operations. Returns the response status. */
+static uint8_t runAction(uint8_t action)
+{
+    switch(action)
+    {
+        case COMMAND_ACTION_ABSOLUTE_MODE:    API_C2_setCRQ_AbsoluteMode(); break;
+        case COMMAND_ACTION_RELATIVE_MODE:    API_C2_setRelativeMode();     break;
+        case COMMAND_ACTION_ENABLE_FEED:      API_C2_enableFeed();          break;
+        case COMMAND_ACTION_DISABLE_FEED:     API_C2_disableFeed();         break;
+        case COMMAND_ACTION_ENABLE_COMP:      API_C2_enableComp();          break;
+        case COMMAND_ACTION_DISABLE_COMP:     API_C2_disableComp();         break;
+        case COMMAND_ACTION_FORCE_COMP:       API_C2_forceComp();           break;
+        case COMMAND_ACTION_ENABLE_TRACKING:
+            API_C2_stopIdle(API_Hardware_micros());     // or it would turn tracking off again
+            API_C2_enableTracking();
+            break;
+        case COMMAND_ACTION_DISABLE_TRACKING:
+            API_C2_stopIdle(API_Hardware_micros());     // or it would turn tracking back on
+            API_C2_disableTracking();
+            break;
+        case COMMAND_ACTION_PERSIST:          API_C2_persistToFlash();      break;
+        case COMMAND_ACTION_FACTORY_CAL:
+            return API_C2_factoryCalibrate() ? SUCCESS : COMMAND_STATUS_FAILED;
+        default:
+            return COMMAND_STATUS_UNKNOWN;
+    }
+    return SUCCESS;
+}
+
+/***********************************************************/
+/***********************************************************/
+/******************* IMPORTANT FUNCTIONS *******************/
+
+/** Executes one command (the payload of a STREAM_TYPE_COMMAND frame) and
+    builds its response payload, which can be up to STREAM_MAX_PAYLOAD bytes.
+    Returns the response length; 0 means the request was too short to carry
+    a request ID and should be dropped. */
+uint16_t API_Command_execute(const uint8_t* request, uint16_t length, uint8_t* response)
+{
+    const uint8_t* args = request + COMMAND_HEADER_SIZE;
+    uint16_t argLength = length - COMMAND_HEADER_SIZE;
+    uint8_t* data = response + COMMAND_RESPONSE_HEADER;
+    uint16_t dataLength = 0;
+    uint8_t status = SUCCESS;
+
+    if(length < COMMAND_HEADER_SIZE)
+    {
+        return 0;
+    }
+    response[0] = request[0];
+    response[1] = request[1];
+    response[2] = request[2];
+
+    switch(request[2])
+    {
+        case COMMAND_PING:
+            dataLength = (argLength < COMMAND_MAX_DATA) ? argLength : COMMAND_MAX_DATA;
+            memcpy(data, args, dataLength);
+            break;
+
+        case COMMAND_READ_MEMORY:
+            if(argLength != COMMAND_RANGE_SIZE || get16(&args[4]) > COMMAND_MAX_DATA)
+            {
+                status = COMMAND_STATUS_BAD_REQUEST;
+                break;
+            }
+            dataLength = get16(&args[4]);
+            status = API_C2_readRegion(get32(args), data, dataLength);
+            break;
+
+        case COMMAND_WRITE_MEMORY:
+            if(argLength < 4)
+            {
+                status = COMMAND_STATUS_BAD_REQUEST;
+                break;
+            }
+            // HB_writeExtendedMemory takes a non-const buffer; stage the bytes in data
+            memcpy(data, &args[4], argLength - 4);
+            status = writeRange(get32(args), data, argLength - 4);
+            break;
+
+        case COMMAND_READ_BATCH:
+        {
+            uint16_t total = 0;
+            if(argLength == 0 || (argLength % COMMAND_RANGE_SIZE) != 0)
+            {
+                status = COMMAND_STATUS_BAD_REQUEST;
+                break;
+            }
+            for(uint16_t i = 0; i < argLength; i += COMMAND_RANGE_SIZE)
+            {
+                total += get16(&args[i + 4]);
+            }
+            if(total > COMMAND_MAX_DATA)
+            {
+                status = COMMAND_STATUS_BAD_REQUEST;
+                break;
+            }
+            for(uint16_t i = 0; i < argLength; i += COMMAND_RANGE_SIZE)
+            {
+                uint16_t count = get16(&args[i + 4]);
+                status |= API_C2_readRegion(get32(&args[i]), &data[dataLength], count);
+                dataLength += count;
+            }
+            break;
+        }
+
+        case COMMAND_ACTION:
+            status = (argLength == 1) ? runAction(args[0]) : COMMAND_STATUS_BAD_REQUEST;
+            break;
+
+        case COMMAND_SYSTEM_INFO:
+        {
+            systemInfo_t info;
+            status = API_C2_readSystemInfo(&info);
+            put16(&data[0], info.vendorId);
+            put16(&data[2], info.productId);
+            put16(&data[4], info.versionId);
+            data[6] = info.chipId;
+            data[7] = info.firmwareVersion;
+            data[8] = info.firmwareSubversion;
+            dataLength = 9;
+            break;
+        }
+
+        case COMMAND_READ_REGION:
+            if(argLength != 8 || get32(&args[4]) == 0 || API_Command_regionPending())
+            {
+                status = COMMAND_STATUS_BAD_REQUEST;
+                break;
+            }
+            _regionRequestId = get16(request);
+            API_C2_startRegion(&_region, get32(args), get32(&args[4]), 0);
+            put32(&data[0], _region.length);
+            data[4] = _region.chunkSize;
+            dataLength = 5;
+            break;
+
+        case COMMAND_STATS:
+            if(argLength != 2)
+            {
+                status = COMMAND_STATUS_BAD_REQUEST;
+            }
+            else if(get16(args) == 0)
+            {
+                API_C2_stopStats();
+            }
+            else
+            {
+                API_C2_startStats(get16(args), API_Hardware_micros());
+            }
+            break;
+
+        case COMMAND_HAPTIC:
+            if(argLength != 7 || args[0] >= HAPTIC_EVENTS)
+            {
+                status = COMMAND_STATUS_BAD_REQUEST;
+            }
+            else
+            {
+                hapticPattern_t pattern = { get16(&args[1]), get16(&args[3]), args[5], args[6] };
+                API_Haptic_setPattern(args[0], &pattern);
+                API_Haptic_enable(true);
+            }
+            break;
+
+        case COMMAND_WATCH:
+            if(argLength != 7 || !API_C2_watchAdd(get32(args), args[4], get16(&args[5]), API_Hardware_micros()))
+            {
+                status = COMMAND_STATUS_BAD_REQUEST;
+            }
+            else
+            {
+                API_C2_watchEnable(true);
+            }
+            break;
+
+        default:
+            status = COMMAND_STATUS_UNKNOWN;
+            break;
+    }
+
+    response[3] = status;
+    return COMMAND_RESPONSE_HEADER + dataLength;
+}
+
+/** True while a READ_REGION has chunks left to send */
+bool API_Command_regionPending(void)
+{
+    return !API_C2_regionDone(&_region);
+}
+
+/** Reads the next chunk of the READ_REGION in progress and builds its 
+    STREAM_TYPE_REGION_DATA payload, COMMAND_REGION_HEADER + REGION_MAX_CHUNK 
+    bytes at most. Returns the payload length, 0 if no region is pending. */
+uint16_t API_Command_nextRegionFrame(uint8_t* payload)
+{
+    uint8_t count;
+
+    if(!API_Command_regionPending())
+    {
+        return 0;
+    }
+    put16(&payload[0], _regionRequestId);
+    put32(&payload[2], _region.offset);
+    payload[6] = API_C2_readRegionChunk(&_region, &payload[COMMAND_REGION_HEADER], &count);
+    return COMMAND_REGION_HEADER + count;
+}
@@ -0,0 +1,128 @@
+#ifndef API_COMMAND_H
+#define API_COMMAND_H
+
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+/**@file API_Command.h
+   @brief Binary command channel for scripted access to the Gen4 over the serial link.
+
+   A host sends STREAM_TYPE_COMMAND frames (see API_Stream.h) and the dev kit
+   answers each one with a STREAM_TYPE_RESPONSE frame, in the order the commands
+   arrived. Both payloads start with the same header (multi-byte fields are
+   little endian):
+
+       request:   requestId[2] opcode arguments...
+       response:  requestId[2] opcode status data...
+
+   The request ID is chosen by the host and echoed back unchanged, so a host can
+   keep many commands in flight and match the responses as they come back.
+   The dev kit has no command queue of its own; the USB serial receive buffer
+   holds the commands not yet executed.
+
+   Opcodes and their arguments:
+
+       PING          anything          data echoes the arguments
+       READ_MEMORY   address[4] count[2]          data is count bytes
+       WRITE_MEMORY  address[4] bytes...          no data
+       READ_BATCH    { address[4] count[2] }...   data is every range, back to back
+       ACTION        action[1]                    no data
+       SYSTEM_INFO   none              data is vendorId[2] productId[2] versionId[2]
+                                       chipId firmwareVersion firmwareSubversion
+       READ_REGION   address[4] length[4]         data is length[4] chunkSize[1]
+       STATS         intervalMs[2]                no data
+       HAPTIC        event[1] onMs[2] offMs[2] pulses[1] strength[1]   no data
+       WATCH         address[4] length[1] periodMs[2]             no data
+
+   Reads are split into extended memory accesses of up to REGION_MAX_CHUNK
+   bytes and writes into COMMAND_TRANSFER_SIZE pieces, so that each fits the
+   Wire buffer.
+
+   READ_REGION reads more than fits in a response. Its response only says
+   the read has started; the bytes follow in STREAM_TYPE_REGION_DATA frames,
+   one per chunk, in order:
+
+       region data:  requestId[2] offset[4] status data...
+
+   where status is the Host Bus result of that chunk after its retries (see
+   API_C2_Region.h). The sketch sends one frame per API_Command_nextRegionFrame
+   call while API_Command_regionPending, so the next chunk is read while the
+   last one is still going out over USB. One region is read at a time.
+
+   STATS starts touch statistics (see API_C2_Stats.h) with a summary every
+   intervalMs, or stops them for 0. While they run the sketch sends a
+   STREAM_TYPE_STATS frame per summary instead of a frame per report.
+
+   HAPTIC sets the pattern of one event (see API_Haptic.h) and turns haptics
+   on; pulses 0 turns that event off.
+
+   WATCH adds a register to the register watch (see API_C2_Watch.h), or
+   changes it, and turns the watch on; periodMs 0 stops watching it. Each
+   change is sent as a STREAM_TYPE_WATCH frame while binary streaming. */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "API_Stream.h"
+
+/***********************************************************/
+/***********************************************************/
+/******************* PROVIDED DEFINES **********************/
+
+#define COMMAND_HEADER_SIZE        (3)   /**< requestId(2) + opcode(1) */
+#define COMMAND_RESPONSE_HEADER    (4)   /**< requestId(2) + opcode(1) + status(1) */
+#define COMMAND_MAX_DATA           (STREAM_MAX_PAYLOAD - COMMAND_RESPONSE_HEADER)
+#define COMMAND_REGION_HEADER      (7)   /**< requestId(2) + offset(4) + status(1) */
+
+/** Largest single extended memory write. A write moves count + 9 bytes 
+    through the Wire buffer (I2C_BUFFER_SIZE, see I2C.h). */
+#ifndef COMMAND_TRANSFER_SIZE
+#define COMMAND_TRANSFER_SIZE      (32)
+#endif
+
+/** Opcodes */
+#define COMMAND_PING               (0x00)
+#define COMMAND_READ_MEMORY        (0x01)
+#define COMMAND_WRITE_MEMORY       (0x02)
+#define COMMAND_READ_BATCH         (0x03)
+#define COMMAND_ACTION             (0x04)
+#define COMMAND_SYSTEM_INFO        (0x05)
+#define COMMAND_READ_REGION        (0x06)
+#define COMMAND_STATS              (0x07)
+#define COMMAND_HAPTIC             (0x08)
+#define COMMAND_WATCH              (0x09)
+
+/** Actions, the same operations as the single character menu */
+#define COMMAND_ACTION_ABSOLUTE_MODE   (0x01)
+#define COMMAND_ACTION_RELATIVE_MODE   (0x02)
+#define COMMAND_ACTION_ENABLE_FEED     (0x03)
+#define COMMAND_ACTION_DISABLE_FEED    (0x04)
+#define COMMAND_ACTION_ENABLE_COMP     (0x05)
+#define COMMAND_ACTION_DISABLE_COMP    (0x06)
+#define COMMAND_ACTION_FORCE_COMP      (0x07)
+#define COMMAND_ACTION_ENABLE_TRACKING (0x08)
+#define COMMAND_ACTION_DISABLE_TRACKING (0x09)
+#define COMMAND_ACTION_PERSIST         (0x0A)
+#define COMMAND_ACTION_FACTORY_CAL     (0x0B)
+
+/** Response status flags. The low bits are the Host Bus result (BAD_CHECKSUM, 
+    LENGTH_MISMATCH, BUS_TIMEOUT, NO_RESPONSE) of every access the command made. */
+#define COMMAND_STATUS_FAILED      (0x20) /**< The action reported a failure */
+#define COMMAND_STATUS_BAD_REQUEST (0x40) /**< Arguments malformed or data would not fit */
+#define COMMAND_STATUS_UNKNOWN     (0x80) /**< Opcode or action not known */
+
+/***********************************************************/
+/***********************************************************/
+/******************* IMPORTANT FUNCTIONS *******************/
+
+uint16_t API_Command_execute(const uint8_t* request, uint16_t length, uint8_t* response);
+
+bool API_Command_regionPending(void);
+
+uint16_t API_Command_nextRegionFrame(uint8_t* payload);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // API_COMMAND_H
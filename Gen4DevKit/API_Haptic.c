@@ -0,0 +1,195 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+#include <string.h>
+#include "API_Haptic.h"
+#include "API_Hardware.h"
+#include "HardwareTimer.h"
+
+/***********************************************************/
+/***********************************************************/
+/********************* MODULE VARIABLES ********************/
+
+static hapticPattern_t _patterns[HAPTIC_EVENTS];
+static hapticStats_t _stats;
+static bool _enabled = false;
+static uint8_t _lastButtons = 0;
+static uint8_t _lastContacts = 0;
+
+/* The pattern playing, shared with the timer interrupt */
+static volatile bool _playing = false;
+static volatile bool _on;           /**< In a pulse, else in a gap */
+static volatile uint16_t _ticksLeft; /**< Of the pulse or gap */
+static volatile uint8_t _pulsesLeft; /**< Counting the one playing */
+static uint16_t _onTicks;
+static uint16_t _offTicks;
+static uint8_t _strength;
+
+/***********************************************************/
+/***********************************************************/
+/******************** HELPER FUNCTIONS *********************/
+
+static uint16_t ticks(uint16_t ms)
+{
+    uint32_t count = ((uint32_t)ms * 1000u + HAPTIC_TICK_US / 2) / HAPTIC_TICK_US;
+    return count == 0 ? 1 : (count > 0xFFFF ? 0xFFFF : (uint16_t)count);
+}
+
+/** Timer interrupt: ends pulses and gaps, and the pattern after its last pulse */
+static void tick(void)
+{
+    if(--_ticksLeft != 0)
+    {
+        return;
+    }
+    if(_on)
+    {
+        API_Hardware_setHaptic(0);
+        _on = false;
+        if(--_pulsesLeft == 0)
+        {
+            HardwareTimer_stop();
+            _playing = false;
+            return;
+        }
+        _ticksLeft = _offTicks;
+    }
+    else
+    {
+        API_Hardware_setHaptic(_strength);
+        _on = true;
+        _ticksLeft = _onTicks;
+    }
+}
+
+/** Starts pattern with its first pulse, and counts the time since readyUs */
+static void play(uint8_t event, uint32_t readyUs)
+{
+    const hapticPattern_t* pattern = &_patterns[event];
+
+    HardwareTimer_stop();           // the interrupt stays out until it is set up
+    if(_playing)
+    {
+        _stats.restarts++;
+    }
+    _onTicks = ticks(pattern->onMs);
+    _offTicks = ticks(pattern->offMs);
+    _strength = pattern->strength;
+    _pulsesLeft = pattern->pulses;
+    _ticksLeft = _onTicks;
+    _on = true;
+    _playing = true;
+    API_Hardware_setHaptic(_strength);
+
+    uint32_t latencyUs = API_Hardware_micros() - readyUs;
+    _stats.triggers[event]++;
+    _stats.minUs = (_stats.started == 0 || latencyUs < _stats.minUs) ? latencyUs : _stats.minUs;
+    _stats.maxUs = latencyUs > _stats.maxUs ? latencyUs : _stats.maxUs;
+    _stats.totalUs += latencyUs;
+    _stats.lastUs = latencyUs;
+    _stats.started++;
+    HardwareTimer_start(HAPTIC_TICK_US, tick);
+}
+
+/** The highest priority event in the report with a pattern, HAPTIC_EVENTS
+    for none. Remembers the buttons and contacts for the next report. */
+static uint8_t findEvent(const reportView_t* view)
+{
+    uint8_t kind = API_C2_viewKind(view);
+    uint8_t buttons = _lastButtons, contacts = _lastContacts;
+    uint8_t found = HAPTIC_EVENTS;
+
+    if(kind == REPORT_KIND_MOUSE || kind == REPORT_KIND_ABSOLUTE)
+    {
+        buttons = API_C2_viewButtons(view);
+    }
+    if(kind == REPORT_KIND_ABSOLUTE)
+    {
+        contacts = API_C2_viewContactFlags(view);
+    }
+    bool events[HAPTIC_EVENTS] =
+    {
+        (buttons & ~_lastButtons) != 0,
+        (contacts & ~_lastContacts) != 0,
+        _lastContacts != 0 && contacts == 0,
+    };
+    _lastButtons = buttons;
+    _lastContacts = contacts;
+    for(uint8_t event = 0; event < HAPTIC_EVENTS && found == HAPTIC_EVENTS; event++)
+    {
+        found = (events[event] && _patterns[event].pulses != 0) ? event : found;
+    }
+    return found;
+}
+
+/***********************************************************/
+/***********************************************************/
+/******************* IMPORTANT FUNCTIONS *******************/
+
+/** Sets what event plays, a copy of pattern. pulses 0 turns the event off. */
+void API_Haptic_setPattern(uint8_t event, const hapticPattern_t* pattern)
+{
+    if(event < HAPTIC_EVENTS)
+    {
+        _patterns[event] = *pattern;
+    }
+}
+
+/** Turns the pulses on or off. Turning them off stops the motor at once. */
+void API_Haptic_enable(bool enable)
+{
+    _enabled = enable;
+    if(!enable)
+    {
+        HardwareTimer_stop();
+        API_Hardware_setHaptic(0);
+        _playing = false;
+    }
+}
+
+bool API_Haptic_enabled(void)
+{
+    return _enabled;
+}
+
+/** Hands over a report as soon as it is read. readyUs is when it could first
+    have been read: when Data Ready asserted (HostDR_assertedUs), or when the
+    last read ended if the line stayed asserted. Reports are followed while
+    haptics are off too, so turning them on does not play stale events. */
+void API_Haptic_report(const reportView_t* view, uint32_t readyUs)
+{
+    uint8_t event = findEvent(view);
+
+    if(_enabled && event != HAPTIC_EVENTS)
+    {
+        play(event, readyUs);
+    }
+}
+
+/***********************************************************/
+/***********************************************************/
+/******************** PUBLIC FUNCTIONS *********************/
+
+bool API_Haptic_playing(void)
+{
+    return _playing;
+}
+
+const hapticPattern_t* API_Haptic_getPattern(uint8_t event)
+{
+    return &_patterns[event < HAPTIC_EVENTS ? event : 0];
+}
+
+const hapticStats_t* API_Haptic_getStats(void)
+{
+    return &_stats;
+}
+
+uint32_t API_Haptic_meanLatencyUs(const hapticStats_t* stats)
+{
+    return stats->started ? (uint32_t)(stats->totalUs / stats->started) : 0;
+}
+
+void API_Haptic_resetStats(void)
+{
+    memset(&_stats, 0, sizeof(_stats));
+}
@@ -0,0 +1,92 @@
+#ifndef API_HAPTIC_H
+#define API_HAPTIC_H
+
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+/**@file API_Haptic.h
+   @brief Haptic pulses on HAPTIC_PIN for touch and button events.
+
+   API_Haptic_report is called from the report read itself (reportTask),
+   before the report is queued for decoding and printing, so a pulse starts
+   as soon as the board knows about the event. It compares each report with
+   the last one for the events below and plays the pattern set for the first
+   one it finds. The motor is driven by PWM (API_Hardware_setHaptic) at the
+   pattern's strength; the pulses are timed by a hardware timer interrupt
+   every HAPTIC_TICK_US (HardwareTimer.h), so nothing in loop() has to run on
+   time to end one. An event while a pattern plays starts its own at once.
+
+   The time from Data Ready asserting to the motor being turned on is kept
+   for every pattern started (see hapticStats_t). */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "API_C2_Report.h"
+
+/***********************************************************/
+/***********************************************************/
+/******************* PROVIDED DEFINES **********************/
+
+/** Events, highest priority first */
+#define HAPTIC_EVENT_PRESS      (0)   /**< A button goes down (mouse or absolute reports) */
+#define HAPTIC_EVENT_CONTACT    (1)   /**< A finger touches down (absolute reports) */
+#define HAPTIC_EVENT_LIFT       (2)   /**< The last finger lifts (absolute reports) */
+#define HAPTIC_EVENTS           (3)
+
+#define HAPTIC_TICK_US          (500) /**< Timer period, the resolution of the pulses */
+
+/***********************************************************/
+/***********************************************************/
+/****************** PUBLIC DATA STRUCTURES *****************/
+
+typedef struct
+{
+    uint16_t onMs;              /**< Length of each pulse */
+    uint16_t offMs;             /**< Gap between pulses */
+    uint8_t  pulses;            /**< 0 turns the event off */
+    uint8_t  strength;          /**< PWM duty cycle out of 255 */
+} hapticPattern_t;
+
+typedef struct
+{
+    uint32_t triggers[HAPTIC_EVENTS];
+    uint32_t started;           /**< Patterns started, all events */
+    uint32_t restarts;          /**< Patterns cut short by the next one */
+    uint32_t minUs;             /**< Data Ready to the motor turned on */
+    uint32_t maxUs;
+    uint64_t totalUs;
+    uint32_t lastUs;
+} hapticStats_t;
+
+/***********************************************************/
+/***********************************************************/
+/******************* IMPORTANT FUNCTIONS *******************/
+
+void API_Haptic_setPattern(uint8_t event, const hapticPattern_t* pattern);
+
+void API_Haptic_enable(bool enable);
+
+bool API_Haptic_enabled(void);
+
+void API_Haptic_report(const reportView_t* view, uint32_t readyUs);
+
+/***********************************************************/
+/***********************************************************/
+/******************** PUBLIC FUNCTIONS *********************/
+
+bool API_Haptic_playing(void);
+
+const hapticPattern_t* API_Haptic_getPattern(uint8_t event);
+
+const hapticStats_t* API_Haptic_getStats(void);
+
+uint32_t API_Haptic_meanLatencyUs(const hapticStats_t* stats);
+
+void API_Haptic_resetStats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // API_HAPTIC_H
@@ -1,5 +1,6 @@
 // Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
 
+#include <Arduino.h>
 #include "API_Hardware.h"
 
 /************************************************************/
@@ -8,6 +9,7 @@
 
 static const uint8_t LED_Pins[] PROGMEM = { LED1_PIN, LED2_PIN };
 static const uint8_t NumberOfLeds PROGMEM = sizeof(LED_Pins) / sizeof(LED_Pins[0]);
+static const uint8_t Button_Pins[HARDWARE_BUTTONS] = { BTN1_PIN, BTN2_PIN, BTN3_PIN };
 
 /************************************************************/
 /************************************************************/
@@ -17,15 +19,19 @@ void API_Hardware_init(void)
 {
     pinMode(V_SEL_PIN, OUTPUT);
     
-    /**  Outputs for Debug
-		pinMode(SCOPE1_PIN, OUTPUT);
-		pinMode(SCOPE2_PIN, OUTPUT);
-    */
+    // Outputs for Debug
+#if CONFIG_TRACE_SCOPE
+    pinMode(SCOPE1_PIN, OUTPUT);
+    pinMode(SCOPE2_PIN, OUTPUT);
+#endif
 
     pinMode(BTN1_PIN, INPUT);
     pinMode(BTN2_PIN, INPUT);
     pinMode(BTN3_PIN, INPUT);
 
+    analogWriteFrequency(HAPTIC_PIN, HAPTIC_PWM_HZ);
+    API_Hardware_setHaptic(0);
+
     byte x;
     for (x = 0; x < NumberOfLeds; x++)
     {
@@ -57,3 +63,42 @@ void API_Hardware_delay(uint32_t ms)
 {
     delay(ms); //wraps the internal Arduino hardware delay
 }
+
+/** Microseconds since the board started. Wraps after about 71 minutes. */
+uint32_t API_Hardware_micros(void)
+{
+    return micros();
+}
+
+/** Drives a scope trigger line. Used by the trace points (API_Trace.h). */
+void API_Hardware_setScope(uint8_t pin, bool high)
+{
+    digitalWriteFast(pin, high ? HIGH : LOW);
+}
+
+/** Presses (pulls low) or releases one of the pad's button inputs through
+    the BTN pins, button 0 to HARDWARE_BUTTONS - 1. Released, the pin is an
+    input again so the line floats back the way it does with no button. */
+void API_Hardware_injectButton(uint8_t button, bool pressed)
+{
+    if(button >= HARDWARE_BUTTONS)
+    {
+        return;
+    }
+    if(pressed)
+    {
+        digitalWriteFast(Button_Pins[button], LOW);
+        pinMode(Button_Pins[button], OUTPUT);
+    }
+    else
+    {
+        pinMode(Button_Pins[button], INPUT);
+    }
+}
+
+/** Drives the haptic motor at strength, the PWM duty cycle out of 255.
+    0 turns it off. Safe to call from an interrupt. */
+void API_Hardware_setHaptic(uint8_t strength)
+{
+    analogWrite(HAPTIC_PIN, strength);
+}
@@ -12,7 +12,7 @@ extern "C" {
 #endif
 
 #include <stdint.h>
-#include <Arduino.h>
+#include <stdbool.h>
 #include "Project_Config.h"
 #include "INA219.h"
 
@@ -24,9 +24,11 @@ extern "C" {
 #define BTN1_PIN      (3)
 #define BTN2_PIN      (4)
 #define BTN3_PIN      (5)
+#define HARDWARE_BUTTONS (3)  /**< BTN1_PIN to BTN3_PIN: buttons 1 to 3 of the reports */
 
 // Haptic control
 #define HAPTIC_PIN    (6)
+#define HAPTIC_PWM_HZ (20000)  /**< Above hearing, so the motor drive does not whine */
 // "Scope Trigger lines"
 #define SCOPE1_PIN    (7)
 #define SCOPE2_PIN    (8)
@@ -47,6 +49,14 @@ void API_Hardware_PowerOff(void);
 
 void API_Hardware_delay(uint32_t ms);
 
+uint32_t API_Hardware_micros(void);
+
+void API_Hardware_setScope(uint8_t pin, bool high);
+
+void API_Hardware_injectButton(uint8_t button, bool pressed);
+
+void API_Hardware_setHaptic(uint8_t strength);
+
 #ifdef __cplusplus
 }
 #endif
@@ -2,9 +2,28 @@
 
 
 #include "API_HostBus.h"
+#include <string.h>
 
 uint8_t _deviceAddress;
 
+/** The pad on the shared bus. It has the highest priority: while DR is 
+	asserted other devices wait (see API_Bus.h). */
+static busDevice_t _bus = { "touch", 0, 0, BUS_PRIORITY_TOUCH, HB_DR_Asserted, 0, 0, { 0 } };
+
+/************************************************************/
+/************************************************************/
+/******************* HELPER FUNCTIONS ***********************/
+
+/** Turns an I2C.h transaction result into a Host Bus status. */
+static uint8_t busStatus(uint8_t i2cResult)
+{
+  if(i2cResult == I2C_SUCCESS)
+  {
+    return SUCCESS;
+  }
+  return (i2cResult == I2C_TIMEOUT) ? BUS_TIMEOUT : NO_RESPONSE;
+}
+
 /************************************************************/
 /************************************************************/
 /********************  PUBLIC FUNCTIONS *********************/
@@ -13,8 +32,10 @@ uint8_t _deviceAddress;
 	The operation of touch system is also tested at 100kHz. */
 void HB_init(int I2CFrequency, uint8_t I2CAddress)
 {
-  I2C_init(I2CFrequency);
   _deviceAddress = I2CAddress;
+  _bus.address = I2CAddress;
+  _bus.clockFrequency = (uint32_t)I2CFrequency;
+  API_Bus_addDevice(&_bus);
   HostDR_init();
 }
 
@@ -29,25 +50,35 @@ bool HB_DR_Asserted(void)
 
 /** The most common I2C action is a "report read" operation to transfer touch 
 	information from the touch system to the host. The details of the read 
-	operation are shown in HB_readReport(). */
-void HB_readReport(uint8_t * reportData, uint16_t readLength)
+	operation are shown in HB_readReport(). Bytes the device did not send 
+	are returned as 0. */
+uint8_t HB_readReport(uint8_t * reportData, uint16_t readLength)
 {
-  uint8_t i = 0;
+  uint16_t i = 0;
  
-  I2C_request((uint16_t)_deviceAddress, readLength, (uint16_t)true);
+  API_Bus_acquireNow(&_bus);
+  uint8_t result = I2C_request((uint16_t)_deviceAddress, readLength, (uint16_t)true);
 
-  while(I2C_available())
+  while(i < readLength && I2C_available())
   {
     reportData[i++] = I2C_read();
   }
+  API_Bus_release(&_bus);
+  for(; i < readLength; i++)
+  {
+    reportData[i] = 0;
+  }
+  return busStatus(result);
 }
 
 /** The touch system functionality is controlled using the Entended Memory 
 	Access operations. The details of the memory access process are shown 
-	in HB_readExtendedMemory() and HB_writeExtendedMemory(); */
+	in HB_readExtendedMemory() and HB_writeExtendedMemory(); 
+	If the bus fails, data is zeroed and BUS_TIMEOUT or NO_RESPONSE returned. 
+	count can be at most HB_MAX_READ_COUNT; API_C2_Region.h reads more. */
 uint8_t HB_readExtendedMemory(uint32_t registerAddress, uint8_t * data, uint16_t count)
 {
-  uint8_t checksum = 0, result = SUCCESS;
+  uint8_t checksum = 0, result = SUCCESS, i2cResult;
   uint16_t i = 0, bytesRead = 0;
   uint8_t lengthBytes[2];
   uint8_t preamble[8] = 
@@ -63,17 +94,29 @@ uint8_t HB_readExtendedMemory(uint32_t registerAddress, uint8_t * data, uint16_t
   };
   
   // Send extended memory access command to Gen4
+  API_Bus_acquireNow(&_bus);
   I2C_beginTransmission(_deviceAddress);
   for(; i < 8; i++)
   {
     I2C_write(preamble[i]);
   }    
-  I2C_endTransmission(false);
+  i2cResult = I2C_endTransmission(false);
   
   /* Read requested data from Gen4, plus overhead 
 	(3 extra bytes for lengthLow, lengthHigh, & checksum)
   */
-  I2C_request(_deviceAddress, count + 3, true);
+  if(i2cResult == I2C_SUCCESS)
+  {
+    i2cResult = I2C_request(_deviceAddress, count + 3, true);
+  }
+  
+  // Never hand back bytes that the bus did not deliver
+  if(i2cResult != I2C_SUCCESS)
+  {
+    API_Bus_release(&_bus);
+    memset(data, 0, count);
+    return busStatus(i2cResult);
+  }
 
   // Read first 2 bytes (lower and upper length-bytes)
   for(i = 0; i < 2; i++)
@@ -94,6 +137,7 @@ uint8_t HB_readExtendedMemory(uint32_t registerAddress, uint8_t * data, uint16_t
   {
     result |= BAD_CHECKSUM;
   }
+  API_Bus_release(&_bus);
 
   if(++bytesRead != (lengthBytes[0] | (lengthBytes[1] << 8)))
   {
@@ -103,7 +147,7 @@ uint8_t HB_readExtendedMemory(uint32_t registerAddress, uint8_t * data, uint16_t
   return result;
 }
 
-void HB_writeExtendedMemory(uint32_t registerAddress, uint8_t * data, uint8_t count)
+uint8_t HB_writeExtendedMemory(uint32_t registerAddress, uint8_t * data, uint8_t count)
 {
   uint8_t checksum = 0, i = 0;
   uint8_t preamble[8] = 
@@ -118,6 +162,7 @@ void HB_writeExtendedMemory(uint32_t registerAddress, uint8_t * data, uint8_t co
     (uint8_t)((count & 0xFF00) >> 8)
   };
 
+  API_Bus_acquireNow(&_bus);
   I2C_beginTransmission(_deviceAddress);
   for(; i < 8; i++)
   {
@@ -131,5 +176,7 @@ void HB_writeExtendedMemory(uint32_t registerAddress, uint8_t * data, uint8_t co
     checksum += data[i];
   }
   I2C_write(checksum);
-  I2C_endTransmission(true);
+  uint8_t result = busStatus(I2C_endTransmission(true));
+  API_Bus_release(&_bus);
+  return result;
 }
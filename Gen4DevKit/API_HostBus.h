@@ -10,13 +10,20 @@ extern "C" {
 
 #include "I2C.h"
 #include "HostDR.h"
+#include "API_Bus.h"
 
 #define SUCCESS           0x00
 #define BAD_CHECKSUM      0x01
 #define LENGTH_MISMATCH   0x02
+#define BUS_TIMEOUT       0x04  /**< The bus was stuck or too slow and has been cleared */
+#define NO_RESPONSE       0x08  /**< The device did not acknowledge or sent too few bytes */
 #define CIRQUE_SLAVE_ADDR 0x2A
 #define ALPS_SLAVE_ADDR   0x2C
 
+/** Most bytes one HB_readExtendedMemory call can read: the Wire buffer also 
+	holds the two length bytes and the checksum. See API_C2_Region.h for more. */
+#define HB_MAX_READ_COUNT (I2C_BUFFER_SIZE - 3)
+
 /************************************************************/
 /************************************************************/
 /********************  PUBLIC FUNCTIONS *********************/
@@ -32,11 +39,11 @@ void HB_init(int I2CFrequency, uint8_t I2CAddress);
 
 bool HB_DR_Asserted(void);
 
-void HB_readReport(uint8_t * packet, uint16_t readLength);
+uint8_t HB_readReport(uint8_t * packet, uint16_t readLength);
 
 uint8_t HB_readExtendedMemory(uint32_t, uint8_t *, uint16_t);
 
-void HB_writeExtendedMemory(uint32_t, uint8_t *, uint8_t);
+uint8_t HB_writeExtendedMemory(uint32_t, uint8_t *, uint8_t);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,458 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+#include "API_I2CHID.h"
+
+/************************************************************/
+/************************************************************/
+/********************  GLOBAL VARIABLES *********************/
+
+static uint8_t _hidAddress = 0x2A;
+static hidDescriptor_t _descriptor;
+static hidReportInfo_t _reports[I2CHID_MAX_REPORTS];
+static uint8_t _reportCount = 0;
+static bool _usesReportIDs = false;
+
+/** Report descriptor item prefixes (bTag | bType, size bits masked off) */
+#define ITEM_INPUT          (0x80)
+#define ITEM_OUTPUT         (0x90)
+#define ITEM_FEATURE        (0xB0)
+#define ITEM_REPORT_SIZE    (0x74)
+#define ITEM_REPORT_ID      (0x84)
+#define ITEM_REPORT_COUNT   (0x94)
+#define ITEM_PUSH           (0xA4)
+#define ITEM_POP            (0xB4)
+#define ITEM_LONG           (0xFE)
+
+#define GLOBAL_STACK_DEPTH  (4)
+
+/************************************************************/
+/************************************************************/
+/******************* HELPER FUNCTIONS ***********************/
+
+static uint16_t readLittleEndian16(const uint8_t* data)
+{
+    return (uint16_t)(data[0] | (data[1] << 8));
+}
+
+/** Writes a 16 bit register address and reads count bytes back after a
+    repeated start. Returns I2CHID_SHORT_READ if the device sent less. */
+static uint8_t readRegister(uint16_t reg, uint8_t* data, uint16_t count)
+{
+    uint16_t i = 0;
+
+    I2C_beginTransmission(_hidAddress);
+    I2C_write((uint8_t)(reg & 0x00FF));
+    I2C_write((uint8_t)((reg & 0xFF00) >> 8));
+    I2C_endTransmission(false);
+
+    I2C_request(_hidAddress, count, true);
+    while(i < count && I2C_available())
+    {
+        data[i++] = I2C_read();
+    }
+    return (i == count) ? I2CHID_SUCCESS : I2CHID_SHORT_READ;
+}
+
+/** Writes the command register address and the command bytes. Report IDs of
+    15 and above don't fit in the command byte and follow it instead. */
+static void beginCommand(uint8_t opcode, uint8_t lowByte, uint8_t reportID, bool hasReportID)
+{
+    I2C_beginTransmission(_hidAddress);
+    I2C_write((uint8_t)(_descriptor.commandRegister & 0x00FF));
+    I2C_write((uint8_t)((_descriptor.commandRegister & 0xFF00) >> 8));
+    if(hasReportID && reportID >= 0x0F)
+    {
+        I2C_write(lowByte | 0x0F);
+        I2C_write(opcode);
+        I2C_write(reportID);
+    }
+    else
+    {
+        I2C_write(lowByte | (hasReportID ? reportID : 0));
+        I2C_write(opcode);
+    }
+}
+
+static void writeDataRegister(void)
+{
+    I2C_write((uint8_t)(_descriptor.dataRegister & 0x00FF));
+    I2C_write((uint8_t)((_descriptor.dataRegister & 0xFF00) >> 8));
+}
+
+static hidReportInfo_t* findOrAddReport(uint8_t reportID)
+{
+    uint8_t i;
+    for(i = 0; i < _reportCount; i++)
+    {
+        if(_reports[i].reportID == reportID)
+        {
+            return &_reports[i];
+        }
+    }
+    if(_reportCount >= I2CHID_MAX_REPORTS)
+    {
+        return NULL;
+    }
+    _reports[_reportCount].reportID = reportID;
+    _reports[_reportCount].inputLength = 0;
+    _reports[_reportCount].outputLength = 0;
+    _reports[_reportCount].featureLength = 0;
+    return &_reports[_reportCount++];
+}
+
+/** Size in bytes of a report that has bits of data, plus the report ID byte. */
+static uint16_t reportBytes(uint32_t bits)
+{
+    return (uint16_t)((bits + 7) / 8 + (_usesReportIDs ? 1 : 0));
+}
+
+/************************************************************/
+/************************************************************/
+/********************  PUBLIC FUNCTIONS *********************/
+
+/** Reads and checks the HID descriptor of the device at I2CAddress.
+    Must succeed before any other I2CHID_ call. I2C_init must already
+    have been called (HB_init does this). */
+uint8_t I2CHID_init(uint8_t I2CAddress, uint16_t descriptorRegister)
+{
+    uint8_t raw[I2CHID_DESCRIPTOR_LENGTH];
+    uint8_t result;
+
+    _hidAddress = I2CAddress;
+    _reportCount = 0;
+    _usesReportIDs = false;
+
+    result = readRegister(descriptorRegister, raw, I2CHID_DESCRIPTOR_LENGTH);
+    if(result != I2CHID_SUCCESS)
+    {
+        return result | I2CHID_BAD_DESCRIPTOR;
+    }
+
+    _descriptor.hidDescLength      = readLittleEndian16(&raw[0]);
+    _descriptor.bcdVersion         = readLittleEndian16(&raw[2]);
+    _descriptor.reportDescLength   = readLittleEndian16(&raw[4]);
+    _descriptor.reportDescRegister = readLittleEndian16(&raw[6]);
+    _descriptor.inputRegister      = readLittleEndian16(&raw[8]);
+    _descriptor.maxInputLength     = readLittleEndian16(&raw[10]);
+    _descriptor.outputRegister     = readLittleEndian16(&raw[12]);
+    _descriptor.maxOutputLength    = readLittleEndian16(&raw[14]);
+    _descriptor.commandRegister    = readLittleEndian16(&raw[16]);
+    _descriptor.dataRegister       = readLittleEndian16(&raw[18]);
+    _descriptor.vendorId           = readLittleEndian16(&raw[20]);
+    _descriptor.productId          = readLittleEndian16(&raw[22]);
+    _descriptor.versionId          = readLittleEndian16(&raw[24]);
+
+    if(_descriptor.hidDescLength != I2CHID_DESCRIPTOR_LENGTH
+       || _descriptor.bcdVersion != I2CHID_BCD_VERSION
+       || _descriptor.maxInputLength < 2)
+    {
+        return I2CHID_BAD_DESCRIPTOR;
+    }
+    return I2CHID_SUCCESS;
+}
+
+/** The HID descriptor read by I2CHID_init. */
+const hidDescriptor_t* I2CHID_getDescriptor(void)
+{
+    return &_descriptor;
+}
+
+/** Reads the whole report descriptor into buffer (which must hold
+    reportDescLength bytes) and parses it for report lengths.
+    NOTE: the descriptor is read in one transaction, so the Wire buffer
+    (BUFFER_LENGTH) must be at least reportDescLength. */
+uint8_t I2CHID_readReportDescriptor(uint8_t* buffer, uint16_t size)
+{
+    uint16_t length = _descriptor.reportDescLength;
+    uint8_t result;
+
+    if(size < length)
+    {
+        return I2CHID_BUFFER_TOO_SMALL;
+    }
+    result = readRegister(_descriptor.reportDescRegister, buffer, length);
+    if(result != I2CHID_SUCCESS)
+    {
+        return result;
+    }
+    return I2CHID_parseReportDescriptor(buffer, length);
+}
+
+/** Walks a report descriptor and totals the Input, Output and Feature bits of
+    every report ID. Only the items that affect report size are interpreted. */
+uint8_t I2CHID_parseReportDescriptor(const uint8_t* descriptor, uint16_t length)
+{
+    uint32_t reportSize = 0, reportCount = 0;
+    uint8_t  reportID = 0;
+    uint32_t stackSize[GLOBAL_STACK_DEPTH], stackCount[GLOBAL_STACK_DEPTH];
+    uint8_t  stackID[GLOBAL_STACK_DEPTH];
+    uint8_t  depth = 0;
+    uint32_t inputBits[I2CHID_MAX_REPORTS] = {0};
+    uint32_t outputBits[I2CHID_MAX_REPORTS] = {0};
+    uint32_t featureBits[I2CHID_MAX_REPORTS] = {0};
+    uint16_t i = 0;
+    uint8_t  r, result = I2CHID_SUCCESS;
+
+    _reportCount = 0;
+    _usesReportIDs = false;
+    findOrAddReport(0);
+
+    while(i < length)
+    {
+        uint8_t prefix = descriptor[i++];
+        uint8_t dataSize;
+        uint32_t value = 0;
+        uint8_t b;
+
+        if(prefix == ITEM_LONG)
+        {
+            // long items carry their size in the next byte
+            if(i >= length)
+            {
+                break;
+            }
+            i += 2 + descriptor[i];
+            continue;
+        }
+
+        dataSize = prefix & 0x03;
+        dataSize = (dataSize == 3) ? 4 : dataSize;
+        if(i + dataSize > length)
+        {
+            result = I2CHID_BAD_DESCRIPTOR;
+            break;
+        }
+        for(b = 0; b < dataSize; b++)
+        {
+            value |= (uint32_t)descriptor[i++] << (8 * b);
+        }
+
+        hidReportInfo_t* report = NULL;
+        switch(prefix & 0xFC)
+        {
+            case ITEM_REPORT_SIZE:
+                reportSize = value;
+                break;
+            case ITEM_REPORT_COUNT:
+                reportCount = value;
+                break;
+            case ITEM_REPORT_ID:
+                reportID = (uint8_t)value;
+                _usesReportIDs = true;
+                if(findOrAddReport(reportID) == NULL)
+                {
+                    result = I2CHID_BUFFER_TOO_SMALL;
+                }
+                break;
+            case ITEM_PUSH:
+                if(depth < GLOBAL_STACK_DEPTH)
+                {
+                    stackSize[depth] = reportSize;
+                    stackCount[depth] = reportCount;
+                    stackID[depth] = reportID;
+                    depth++;
+                }
+                break;
+            case ITEM_POP:
+                if(depth > 0)
+                {
+                    depth--;
+                    reportSize = stackSize[depth];
+                    reportCount = stackCount[depth];
+                    reportID = stackID[depth];
+                }
+                break;
+            case ITEM_INPUT:
+            case ITEM_OUTPUT:
+            case ITEM_FEATURE:
+                report = findOrAddReport(reportID);
+                if(report == NULL)
+                {
+                    break;
+                }
+                r = (uint8_t)(report - _reports);
+                if((prefix & 0xFC) == ITEM_INPUT)
+                {
+                    inputBits[r] += reportSize * reportCount;
+                }
+                else if((prefix & 0xFC) == ITEM_OUTPUT)
+                {
+                    outputBits[r] += reportSize * reportCount;
+                }
+                else
+                {
+                    featureBits[r] += reportSize * reportCount;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
+    for(r = 0; r < _reportCount; r++)
+    {
+        _reports[r].inputLength = inputBits[r] ? reportBytes(inputBits[r]) : 0;
+        _reports[r].outputLength = outputBits[r] ? reportBytes(outputBits[r]) : 0;
+        _reports[r].featureLength = featureBits[r] ? reportBytes(featureBits[r]) : 0;
+    }
+    return result;
+}
+
+/** Returns the sizes of reportID from the parsed report descriptor,
+    or NULL if the descriptor did not define it. */
+const hidReportInfo_t* I2CHID_getReportInfo(uint8_t reportID)
+{
+    uint8_t i;
+    for(i = 0; i < _reportCount; i++)
+    {
+        if(_reports[i].reportID == reportID)
+        {
+            return &_reports[i];
+        }
+    }
+    return NULL;
+}
+
+/** Reads one input report from the input register into packet.
+    The read is exactly maxInputLength bytes, the transfer size the spec
+    defines for the device, rather than a fixed worst case. The report's own
+    length field tells how much of it is valid; it is checked against the
+    report descriptor when one has been parsed. Returns I2CHID_NO_REPORT when
+    the device had nothing to send (length 0, such as the reset response). */
+uint8_t I2CHID_readInputReport(uint8_t* packet, uint16_t size)
+{
+    uint16_t count = _descriptor.maxInputLength;
+    uint16_t i = 0, length;
+    const hidReportInfo_t* info;
+    uint8_t result = I2CHID_SUCCESS;
+
+    if(size < count)
+    {
+        return I2CHID_BUFFER_TOO_SMALL;
+    }
+
+    // input reports are read without writing a register address first
+    I2C_request(_hidAddress, count, true);
+    while(i < count && I2C_available())
+    {
+        packet[i++] = I2C_read();
+    }
+    if(i < 2)
+    {
+        return I2CHID_SHORT_READ;
+    }
+
+    length = readLittleEndian16(packet);
+    if(length == 0)
+    {
+        return I2CHID_NO_REPORT;
+    }
+    if(length > i || length < 2)
+    {
+        return I2CHID_SHORT_READ | I2CHID_LENGTH_MISMATCH;
+    }
+
+    info = I2CHID_getReportInfo(_usesReportIDs ? packet[2] : 0);
+    if(info != NULL && info->inputLength != 0 && info->inputLength != length - 2)
+    {
+        result |= I2CHID_LENGTH_MISMATCH;
+    }
+    return result;
+}
+
+/** GET_REPORT: asks the device for a report through the command and data
+    registers. Exactly the length given by the report descriptor is read.
+    data receives the report (starting with its ID when IDs are used),
+    and length the number of bytes the device said were valid. */
+uint8_t I2CHID_getReport(uint8_t reportType, uint8_t reportID, uint8_t* data, uint16_t size, uint16_t* length)
+{
+    const hidReportInfo_t* info = I2CHID_getReportInfo(reportID);
+    uint16_t expected = 0, received, i = 0;
+    uint8_t lengthBytes[2];
+
+    if(info != NULL)
+    {
+        expected = (reportType == I2CHID_REPORT_FEATURE) ? info->featureLength
+                 : (reportType == I2CHID_REPORT_OUTPUT) ? info->outputLength
+                 : info->inputLength;
+    }
+    if(expected == 0)
+    {
+        expected = size; // unknown report, fall back to the caller's buffer size
+    }
+    if(size < expected)
+    {
+        return I2CHID_BUFFER_TOO_SMALL;
+    }
+
+    beginCommand(I2CHID_OPCODE_GET_REPORT, (uint8_t)(reportType << 4), reportID, _usesReportIDs);
+    writeDataRegister();
+    I2C_endTransmission(false);
+
+    I2C_request(_hidAddress, expected + 2, true);
+    while(i < 2 && I2C_available())
+    {
+        lengthBytes[i++] = I2C_read();
+    }
+    if(i < 2)
+    {
+        *length = 0;
+        return I2CHID_SHORT_READ;
+    }
+    received = readLittleEndian16(lengthBytes);
+    received = (received >= 2) ? received - 2 : 0;
+
+    for(i = 0; i < expected && I2C_available(); i++)
+    {
+        data[i] = I2C_read();
+    }
+    *length = (received < i) ? received : i;
+
+    if(i < expected)
+    {
+        return I2CHID_SHORT_READ;
+    }
+    return (received == expected) ? I2CHID_SUCCESS : I2CHID_LENGTH_MISMATCH;
+}
+
+/** SET_REPORT: sends a report through the command and data registers.
+    data is the report body without the report ID, which is added here
+    when the device uses IDs. */
+uint8_t I2CHID_setReport(uint8_t reportType, uint8_t reportID, const uint8_t* data, uint16_t length)
+{
+    uint16_t total = length + 2 + (_usesReportIDs ? 1 : 0);
+    uint16_t i;
+
+    beginCommand(I2CHID_OPCODE_SET_REPORT, (uint8_t)(reportType << 4), reportID, _usesReportIDs);
+    writeDataRegister();
+    I2C_write((uint8_t)(total & 0x00FF));
+    I2C_write((uint8_t)((total & 0xFF00) >> 8));
+    if(_usesReportIDs)
+    {
+        I2C_write(reportID);
+    }
+    for(i = 0; i < length; i++)
+    {
+        I2C_write(data[i]);
+    }
+    I2C_endTransmission(true);
+    return I2CHID_SUCCESS;
+}
+
+/** SET_POWER: I2CHID_POWER_ON or I2CHID_POWER_SLEEP. */
+uint8_t I2CHID_setPower(uint8_t powerState)
+{
+    beginCommand(I2CHID_OPCODE_SET_POWER, powerState & 0x03, 0, false);
+    I2C_endTransmission(true);
+    return I2CHID_SUCCESS;
+}
+
+/** RESET: the device answers by asserting DR and returning a length 0 input
+    report, so wait for DR and call I2CHID_readInputReport (which returns
+    I2CHID_NO_REPORT) before using the device again. */
+uint8_t I2CHID_reset(void)
+{
+    beginCommand(I2CHID_OPCODE_RESET, 0, 0, false);
+    I2C_endTransmission(true);
+    return I2CHID_SUCCESS;
+}
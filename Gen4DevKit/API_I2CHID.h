@@ -0,0 +1,122 @@
+#ifndef API_I2CHID_H
+#define API_I2CHID_H
+
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+/**@file API_I2CHID.h
+   @brief Standard I2C-HID host protocol (HID over I2C, Microsoft spec v1.0).
+
+   This sits next to the Cirque extended memory protocol in API_HostBus and
+   talks to the pad's native HID interface: HID descriptor, report descriptor,
+   input register, command register (RESET, GET_REPORT, SET_REPORT, SET_POWER)
+   and data register. Only I2C.h is used, so the same code runs in host builds.
+
+   Input reports are framed exactly as the spec defines them: two length bytes
+   (which include themselves), then the report ID and report data. That is the
+   same packet layout API_C2_decodeReport expects. */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "I2C.h"
+
+/***********************************************************/
+/***********************************************************/
+/******************* PROVIDED DEFINES **********************/
+
+/** HID descriptor register. Gen4 modules are normally set up for 0x0020;
+    use the value from the module's integration (ACPI) settings if it differs. */
+#define I2CHID_DEFAULT_DESCRIPTOR_REGISTER  (0x0020)
+#define I2CHID_DESCRIPTOR_LENGTH            (30)
+#define I2CHID_BCD_VERSION                  (0x0100)
+
+/** Status bits returned by the I2CHID_ functions */
+#define I2CHID_SUCCESS          0x00
+#define I2CHID_SHORT_READ       0x01 /**< The device returned fewer bytes than requested */
+#define I2CHID_LENGTH_MISMATCH  0x02 /**< Length field disagrees with the report descriptor */
+#define I2CHID_BAD_DESCRIPTOR   0x04 /**< HID descriptor missing or not version 1.00 */
+#define I2CHID_BUFFER_TOO_SMALL 0x08 /**< Caller's buffer can't hold the data */
+#define I2CHID_NO_REPORT        0x10 /**< Input register held no report (length 0, e.g. reset response) */
+
+/** Report types for GET_REPORT / SET_REPORT */
+#define I2CHID_REPORT_INPUT     (1)
+#define I2CHID_REPORT_OUTPUT    (2)
+#define I2CHID_REPORT_FEATURE   (3)
+
+/** Power states for SET_POWER */
+#define I2CHID_POWER_ON         (0)
+#define I2CHID_POWER_SLEEP      (1)
+
+/** Command opcodes */
+#define I2CHID_OPCODE_RESET         (0x01)
+#define I2CHID_OPCODE_GET_REPORT    (0x02)
+#define I2CHID_OPCODE_SET_REPORT    (0x03)
+#define I2CHID_OPCODE_SET_POWER     (0x08)
+
+/** Most report IDs tracked from the report descriptor */
+#define I2CHID_MAX_REPORTS      (16)
+
+/***********************************************************/
+/***********************************************************/
+/****************** PUBLIC DATA STRUCTURES *****************/
+
+/** The HID descriptor, as read from the descriptor register */
+typedef struct
+{
+    uint16_t hidDescLength;       /**< Always 30 */
+    uint16_t bcdVersion;          /**< 0x0100 */
+    uint16_t reportDescLength;    /**< Length of the report descriptor */
+    uint16_t reportDescRegister;  /**< Register to read the report descriptor from */
+    uint16_t inputRegister;       /**< Register input reports are read from */
+    uint16_t maxInputLength;      /**< Longest input report, including the two length bytes */
+    uint16_t outputRegister;
+    uint16_t maxOutputLength;
+    uint16_t commandRegister;
+    uint16_t dataRegister;
+    uint16_t vendorId;
+    uint16_t productId;
+    uint16_t versionId;
+} hidDescriptor_t;
+
+/** Report sizes found in the report descriptor. Lengths are in bytes and
+    include the report ID byte (when the device uses IDs) but not the two
+    length bytes. Zero means the report has no items of that type. */
+typedef struct
+{
+    uint8_t  reportID;
+    uint16_t inputLength;
+    uint16_t outputLength;
+    uint16_t featureLength;
+} hidReportInfo_t;
+
+/***********************************************************/
+/***********************************************************/
+/******************* IMPORTANT FUNCTIONS *******************/
+
+uint8_t I2CHID_init(uint8_t I2CAddress, uint16_t descriptorRegister);
+
+const hidDescriptor_t* I2CHID_getDescriptor(void);
+
+uint8_t I2CHID_readReportDescriptor(uint8_t* buffer, uint16_t size);
+
+uint8_t I2CHID_parseReportDescriptor(const uint8_t* descriptor, uint16_t length);
+
+const hidReportInfo_t* I2CHID_getReportInfo(uint8_t reportID);
+
+uint8_t I2CHID_readInputReport(uint8_t* packet, uint16_t size);
+
+uint8_t I2CHID_getReport(uint8_t reportType, uint8_t reportID, uint8_t* data, uint16_t size, uint16_t* length);
+
+uint8_t I2CHID_setReport(uint8_t reportType, uint8_t reportID, const uint8_t* data, uint16_t length);
+
+uint8_t I2CHID_setPower(uint8_t powerState);
+
+uint8_t I2CHID_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // API_I2CHID_H
@@ -0,0 +1,417 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+#include <string.h>
+#include "API_Recorder.h"
+
+#define RECORDER_MASK (RECORDER_BUFFER_SIZE - 1)
+
+#if (RECORDER_BUFFER_SIZE & RECORDER_MASK) != 0
+#error RECORDER_BUFFER_SIZE must be a power of two
+#endif
+
+/** Largest record body; bodyLength is one byte */
+#define RECORDER_MAX_BODY (255)
+
+/***********************************************************/
+/***********************************************************/
+/********************* MODULE VARIABLES ********************/
+
+static uint8_t  _buffer[RECORDER_BUFFER_SIZE];
+static uint32_t _head = 0;      /**< Offset of the oldest record */
+static uint32_t _length = 0;    /**< Bytes of records in the buffer */
+
+static uint8_t  _previous[RECORDER_MAX_PACKET]; /**< Last packet recorded, for deltas */
+static uint16_t _previousLength = 0;
+static uint32_t _lastTimestamp = 0;
+static uint8_t  _sinceKeyframe = 0;
+
+static bool _enabled = true;
+static recorderStats_t _stats;
+
+/***********************************************************/
+/***********************************************************/
+/********************* HELPER FUNCTIONS ********************/
+
+static void put32(uint8_t* buffer, uint32_t value)
+{
+    buffer[0] = (uint8_t)(value & 0x000000FF);
+    buffer[1] = (uint8_t)((value & 0x0000FF00) >> 8);
+    buffer[2] = (uint8_t)((value & 0x00FF0000) >> 16);
+    buffer[3] = (uint8_t)((value & 0xFF000000) >> 24);
+}
+
+static uint32_t get32(const uint8_t* buffer)
+{
+    return (uint32_t)buffer[0] | ((uint32_t)buffer[1] << 8)
+         | ((uint32_t)buffer[2] << 16) | ((uint32_t)buffer[3] << 24);
+}
+
+/** Drops the oldest record. */
+static void evictOldest(void)
+{
+    uint16_t size = RECORDER_RECORD_HEADER + _buffer[(_head + 1) & RECORDER_MASK];
+    _head = (_head + size) & RECORDER_MASK;
+    _length -= size;
+    _stats.evicted++;
+}
+
+/** Appends a record, evicting old records until it fits. */
+static void appendRecord(uint8_t tag, const uint8_t* body, uint8_t bodyLength)
+{
+    uint16_t size = RECORDER_RECORD_HEADER + bodyLength;
+    uint32_t tail;
+    uint16_t first;
+
+    while(RECORDER_BUFFER_SIZE - _length < size)
+    {
+        evictOldest();
+    }
+
+    tail = (_head + _length) & RECORDER_MASK;
+    _buffer[tail] = tag;
+    _buffer[(tail + 1) & RECORDER_MASK] = bodyLength;
+    tail = (tail + 2) & RECORDER_MASK;
+
+    // the body may wrap around the end of the buffer
+    first = RECORDER_BUFFER_SIZE - tail;
+    if(first > bodyLength)
+    {
+        first = bodyLength;
+    }
+    memcpy(&_buffer[tail], body, first);
+    memcpy(&_buffer[0], body + first, bodyLength - first);
+
+    _length += size;
+    _stats.storedBytes += size;
+}
+
+/** Writes value as a base-128 varint. Returns the bytes used (1 to 5). */
+static uint8_t putVarint(uint8_t* buffer, uint32_t value)
+{
+    uint8_t i = 0;
+    while(value >= 0x80)
+    {
+        buffer[i++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    buffer[i++] = (uint8_t)value;
+    return i;
+}
+
+/** Encodes the changes from _previous to packet as (skip, count, bytes) runs.
+    Equal gaps of up to two bytes are folded into a run, since a new run
+    would cost two header bytes anyway. Returns the bytes written to body,
+    or 0 if the delta would not be smaller than limit. */
+static uint16_t encodeRuns(const uint8_t* packet, uint16_t length, uint8_t* body, uint16_t limit)
+{
+    uint16_t size = 0, position = 0, i = 0;
+
+    while(i < length)
+    {
+        uint16_t start, last, end;
+
+        if(packet[i] == _previous[i])
+        {
+            i++;
+            continue;
+        }
+
+        start = last = i;
+        for(end = i + 1; end < length && end - last <= 2; end++)
+        {
+            if(packet[end] != _previous[end])
+            {
+                last = end;
+            }
+        }
+
+        uint16_t count = last - start + 1;
+        if(size + 2 + count >= limit)
+        {
+            return 0;
+        }
+        body[size++] = (uint8_t)(start - position);
+        body[size++] = (uint8_t)count;
+        memcpy(&body[size], &packet[start], count);
+        size += count;
+
+        position = i = last + 1;
+    }
+    return size;
+}
+
+/***********************************************************/
+/***********************************************************/
+/******************* IMPORTANT FUNCTIONS *******************/
+
+/** Empties the buffer and resets the statistics. */
+void API_Recorder_clear(void)
+{
+    _head = 0;
+    _length = 0;
+    _previousLength = 0;
+    _sinceKeyframe = 0;
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+/** Recording is on by default. Turning it off keeps the current history,
+    e.g. to freeze it right after a fault is noticed. */
+void API_Recorder_enable(bool enable)
+{
+    _enabled = enable;
+}
+
+/** Records one report packet. Stored as a delta against the previous packet
+    when that is smaller, otherwise as a keyframe. */
+void API_Recorder_recordPacket(uint32_t timestamp, const uint8_t* packet, uint16_t length)
+{
+    uint8_t body[RECORDER_MAX_BODY];
+    uint16_t bodyLength = 0;
+
+    if(!_enabled)
+    {
+        return;
+    }
+    if(length > RECORDER_MAX_PACKET)
+    {
+        length = RECORDER_MAX_PACKET;
+    }
+
+    _stats.packets++;
+    _stats.rawBytes += length;
+
+    // the report ID lives at byte 2 of every packet; a different ID or length starts over
+    if(length == _previousLength && length > 2 && packet[2] == _previous[2]
+       && _sinceKeyframe < RECORDER_KEYFRAME_INTERVAL)
+    {
+        uint8_t timeLength = putVarint(body, timestamp - _lastTimestamp);
+        uint16_t runLength = encodeRuns(packet, length, &body[timeLength], 4 + length - timeLength);
+        if(runLength != 0 || memcmp(packet, _previous, length) == 0)
+        {
+            bodyLength = timeLength + runLength;
+        }
+    }
+
+    if(bodyLength != 0)
+    {
+        appendRecord(RECORDER_TAG_DELTA, body, (uint8_t)bodyLength);
+        _sinceKeyframe++;
+    }
+    else
+    {
+        put32(body, timestamp);
+        memcpy(&body[4], packet, length);
+        appendRecord(RECORDER_TAG_KEYFRAME, body, (uint8_t)(4 + length));
+        _sinceKeyframe = 0;
+        _stats.keyframes++;
+    }
+
+    memcpy(_previous, packet, length);
+    _previousLength = length;
+    _lastTimestamp = timestamp;
+}
+
+/** Records an extended memory write. */
+void API_Recorder_recordRegisterWrite(uint32_t timestamp, uint32_t address, const uint8_t* data, uint16_t count)
+{
+    uint8_t body[RECORDER_MAX_BODY];
+
+    if(!_enabled)
+    {
+        return;
+    }
+    if(count > RECORDER_MAX_REGISTER_DATA)
+    {
+        count = RECORDER_MAX_REGISTER_DATA;
+    }
+
+    put32(body, timestamp);
+    put32(&body[4], address);
+    memcpy(&body[8], data, count);
+    appendRecord(RECORDER_TAG_REGISTER, body, (uint8_t)(8 + count));
+
+    _stats.registerWrites++;
+    _stats.rawBytes += count;
+    _lastTimestamp = timestamp;
+}
+
+const recorderStats_t* API_Recorder_getStats(void)
+{
+    return &_stats;
+}
+
+/***********************************************************/
+/***********************************************************/
+/************************* DUMPING *************************/
+
+/** Bytes of records currently held, oldest first. Records are never split,
+    so these bytes always start and end on record boundaries. */
+uint32_t API_Recorder_getLength(void)
+{
+    return _length;
+}
+
+/** Copies count bytes of the history, starting offset bytes after the oldest
+    record. Returns the number of bytes copied. */
+uint16_t API_Recorder_copy(uint32_t offset, uint8_t* buffer, uint16_t count)
+{
+    uint32_t start;
+    uint16_t first;
+
+    if(offset >= _length)
+    {
+        return 0;
+    }
+    if(count > _length - offset)
+    {
+        count = (uint16_t)(_length - offset);
+    }
+
+    start = (_head + offset) & RECORDER_MASK;
+    first = (RECORDER_BUFFER_SIZE - start < count) ? (uint16_t)(RECORDER_BUFFER_SIZE - start) : count;
+    memcpy(buffer, &_buffer[start], first);
+    memcpy(buffer + first, &_buffer[0], count - first);
+    return count;
+}
+
+/** Fills buffer (RECORDER_DUMP_INFO_SIZE bytes) with the header sent before
+    a dump. Returns the number of bytes used. */
+uint8_t API_Recorder_encodeDumpInfo(uint8_t* buffer)
+{
+    buffer[0] = RECORDER_DUMP_VERSION;
+    put32(&buffer[1], RECORDER_BUFFER_SIZE);
+    put32(&buffer[5], _length);
+    put32(&buffer[9], _stats.packets);
+    put32(&buffer[13], _stats.keyframes);
+    put32(&buffer[17], _stats.registerWrites);
+    put32(&buffer[21], _stats.evicted);
+    put32(&buffer[25], _stats.rawBytes);
+    put32(&buffer[29], _stats.storedBytes);
+    return RECORDER_DUMP_INFO_SIZE;
+}
+
+/** Reverse of API_Recorder_encodeDumpInfo. Returns false for a short buffer
+    or an unknown version. */
+bool API_Recorder_decodeDumpInfo(const uint8_t* buffer, uint16_t length, recorderDumpInfo_t* info)
+{
+    if(length < RECORDER_DUMP_INFO_SIZE || buffer[0] != RECORDER_DUMP_VERSION)
+    {
+        return false;
+    }
+    info->version = buffer[0];
+    info->bufferSize = get32(&buffer[1]);
+    info->length = get32(&buffer[5]);
+    info->stats.packets = get32(&buffer[9]);
+    info->stats.keyframes = get32(&buffer[13]);
+    info->stats.registerWrites = get32(&buffer[17]);
+    info->stats.evicted = get32(&buffer[21]);
+    info->stats.rawBytes = get32(&buffer[25]);
+    info->stats.storedBytes = get32(&buffer[29]);
+    return true;
+}
+
+void API_Recorder_initDecoder(recorderDecoder_t* decoder)
+{
+    decoder->packetLength = 0;
+    decoder->timestamp = 0;
+    decoder->synced = false;
+    decoder->skipped = 0;
+    decoder->corrupt = 0;
+}
+
+/** Decodes one complete record (RECORDER_RECORD_HEADER + record[1] bytes).
+    Returns false if the record produced no event: deltas before the first
+    keyframe are counted in skipped, malformed records in corrupt. */
+bool API_Recorder_decodeRecord(recorderDecoder_t* decoder, const uint8_t* record, recorderEvent_t* event)
+{
+    const uint8_t* body = &record[RECORDER_RECORD_HEADER];
+    uint8_t bodyLength = record[1];
+    uint16_t i = 0;
+
+    event->type = RECORDER_EVENT_NONE;
+
+    switch(record[0])
+    {
+        case RECORDER_TAG_KEYFRAME:
+            if(bodyLength < 4 || bodyLength - 4 > RECORDER_MAX_PACKET)
+            {
+                break;
+            }
+            decoder->timestamp = get32(body);
+            decoder->packetLength = bodyLength - 4;
+            memcpy(decoder->packet, &body[4], decoder->packetLength);
+            decoder->synced = true;
+            event->type = RECORDER_EVENT_PACKET;
+            break;
+
+        case RECORDER_TAG_DELTA:
+        {
+            uint32_t timeDelta = 0;
+            uint8_t shift = 0;
+            uint16_t position = 0;
+
+            if(!decoder->synced)
+            {
+                decoder->skipped++;
+                return false;
+            }
+            do
+            {
+                if(i >= bodyLength || shift > 28)
+                {
+                    decoder->corrupt++;
+                    return false;
+                }
+                timeDelta |= (uint32_t)(body[i] & 0x7F) << shift;
+                shift += 7;
+            } while(body[i++] & 0x80);
+
+            while(i + 2 <= bodyLength)
+            {
+                uint8_t count = body[i + 1];
+                position += body[i];
+                i += 2;
+                if(position + count > decoder->packetLength || i + count > bodyLength)
+                {
+                    // the decoder's base packet can't be trusted any more
+                    decoder->synced = false;
+                    decoder->corrupt++;
+                    return false;
+                }
+                memcpy(&decoder->packet[position], &body[i], count);
+                position += count;
+                i += count;
+            }
+            decoder->timestamp += timeDelta;
+            event->type = RECORDER_EVENT_PACKET;
+            break;
+        }
+
+        case RECORDER_TAG_REGISTER:
+            if(bodyLength < 8)
+            {
+                break;
+            }
+            decoder->timestamp = get32(body);
+            event->type = RECORDER_EVENT_REGISTER;
+            event->timestamp = decoder->timestamp;
+            event->address = get32(&body[4]);
+            event->length = bodyLength - 8;
+            event->data = &body[8];
+            return true;
+
+        default:
+            break;
+    }
+
+    if(event->type == RECORDER_EVENT_NONE)
+    {
+        decoder->corrupt++;
+        return false;
+    }
+    event->timestamp = decoder->timestamp;
+    event->address = 0;
+    event->length = decoder->packetLength;
+    event->data = decoder->packet;
+    return true;
+}
@@ -0,0 +1,150 @@
+#ifndef API_RECORDER_H
+#define API_RECORDER_H
+
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+/**@file API_Recorder.h
+   @brief Always-on flight recorder for report packets and register writes.
+
+   The recorder keeps the most recent history in a fixed RAM buffer, dropping
+   the oldest records when it is full. Each record is:
+
+       tag bodyLength body[bodyLength]
+
+   RECORDER_TAG_KEYFRAME      timestamp[4] packet[]
+   RECORDER_TAG_DELTA         timeDelta(varint) { skip count bytes[count] }...
+   RECORDER_TAG_REGISTER      timestamp[4] address[4] data[]
+
+   A delta record stores only the bytes that changed since the previous packet,
+   as runs of (bytes skipped, bytes changed, new bytes), with the time since the
+   previous record as a base-128 varint. An unchanged packet costs 3 bytes
+   instead of PACKET_SIZE. A keyframe is forced every RECORDER_KEYFRAME_INTERVAL
+   packets, and whenever the report ID or length changes, so decoding can start
+   soon after the oldest (possibly evicted) record.
+
+   Timestamps are supplied by the caller, so this file has no hardware
+   dependencies and the host tools decode dumps with the same code. */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/***********************************************************/
+/***********************************************************/
+/******************* PROVIDED DEFINES **********************/
+
+/** RAM used for history. Must be a power of two. The Teensy 3.2 has 64 KB. */
+#ifndef RECORDER_BUFFER_SIZE
+#define RECORDER_BUFFER_SIZE        (32768)
+#endif
+
+/** Packets between forced keyframes */
+#ifndef RECORDER_KEYFRAME_INTERVAL
+#define RECORDER_KEYFRAME_INTERVAL  (32)
+#endif
+
+/** Longest packet kept; longer packets are truncated */
+#define RECORDER_MAX_PACKET         (240)
+/** Most register bytes kept per write; longer writes are truncated */
+#define RECORDER_MAX_REGISTER_DATA  (240)
+
+#define RECORDER_RECORD_HEADER      (2)   /**< tag + bodyLength */
+
+/** Record tags */
+#define RECORDER_TAG_KEYFRAME       (0x01)
+#define RECORDER_TAG_DELTA          (0x02)
+#define RECORDER_TAG_REGISTER       (0x03)
+
+/** Event types produced by the decoder */
+#define RECORDER_EVENT_NONE         (0) /**< Record skipped (no keyframe yet) */
+#define RECORDER_EVENT_PACKET       (1)
+#define RECORDER_EVENT_REGISTER     (2)
+
+/** Dump format version, sent in recorderDumpInfo_t */
+#define RECORDER_DUMP_VERSION       (1)
+
+/***********************************************************/
+/***********************************************************/
+/****************** PUBLIC DATA STRUCTURES *****************/
+
+/** Running totals since the last API_Recorder_clear */
+typedef struct
+{
+    uint32_t packets;        /**< Packets recorded */
+    uint32_t keyframes;      /**< Packets stored as keyframes */
+    uint32_t registerWrites; /**< Register writes recorded */
+    uint32_t evicted;        /**< Records dropped to make room */
+    uint32_t rawBytes;       /**< Packet and register bytes handed to the recorder */
+    uint32_t storedBytes;    /**< Record bytes written to the buffer */
+} recorderStats_t;
+
+/** Sent ahead of a dump (STREAM_TYPE_RECORDER_INFO). Little endian on the wire. */
+typedef struct
+{
+    uint8_t  version;        /**< RECORDER_DUMP_VERSION */
+    uint32_t bufferSize;     /**< RECORDER_BUFFER_SIZE */
+    uint32_t length;         /**< Bytes of records that follow */
+    recorderStats_t stats;
+} recorderDumpInfo_t;
+
+#define RECORDER_DUMP_INFO_SIZE (9 + 6 * 4)
+
+/** One decoded record. data points into the decoder (packets) or the
+    record (register writes) and is valid until the next decode call. */
+typedef struct
+{
+    uint8_t        type;      /**< RECORDER_EVENT_ */
+    uint32_t       timestamp; /**< Caller's timestamp when recorded (micros on the dev kit) */
+    uint32_t       address;   /**< Register address, for RECORDER_EVENT_REGISTER */
+    uint16_t       length;
+    const uint8_t* data;
+} recorderEvent_t;
+
+/** Decoder state: the packet that delta records apply to */
+typedef struct
+{
+    uint8_t  packet[RECORDER_MAX_PACKET];
+    uint16_t packetLength;
+    uint32_t timestamp;
+    bool     synced;   /**< A keyframe has been seen */
+    uint32_t skipped;  /**< Records skipped before the first keyframe */
+    uint32_t corrupt;  /**< Records that did not decode */
+} recorderDecoder_t;
+
+/***********************************************************/
+/***********************************************************/
+/******************* IMPORTANT FUNCTIONS *******************/
+
+void API_Recorder_clear(void);
+
+void API_Recorder_enable(bool enable);
+
+void API_Recorder_recordPacket(uint32_t timestamp, const uint8_t* packet, uint16_t length);
+
+void API_Recorder_recordRegisterWrite(uint32_t timestamp, uint32_t address, const uint8_t* data, uint16_t count);
+
+const recorderStats_t* API_Recorder_getStats(void);
+
+/***********************************************************/
+/***********************************************************/
+/************************* DUMPING *************************/
+
+uint32_t API_Recorder_getLength(void);
+
+uint16_t API_Recorder_copy(uint32_t offset, uint8_t* buffer, uint16_t count);
+
+uint8_t API_Recorder_encodeDumpInfo(uint8_t* buffer);
+
+bool API_Recorder_decodeDumpInfo(const uint8_t* buffer, uint16_t length, recorderDumpInfo_t* info);
+
+void API_Recorder_initDecoder(recorderDecoder_t* decoder);
+
+bool API_Recorder_decodeRecord(recorderDecoder_t* decoder, const uint8_t* record, recorderEvent_t* event);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // API_RECORDER_H
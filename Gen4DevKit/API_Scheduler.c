@@ -0,0 +1,159 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+#include <string.h>
+#include "API_Scheduler.h"
+#include "API_Hardware.h"
+#include "API_Trace.h"
+
+/***********************************************************/
+/***********************************************************/
+/********************* MODULE VARIABLES ********************/
+
+static schedTask_t* _tasks = 0;
+static uint8_t _taskCount = 0;
+static schedTask_t* _current = 0;   /**< Task being run */
+
+/***********************************************************/
+/***********************************************************/
+/********************* HELPER FUNCTIONS ********************/
+
+/** Updates a task's pending state. Returns true if it should run now. */
+static bool checkReady(schedTask_t* task, uint32_t now)
+{
+    if(task->periodUs == 0)
+    {
+        // ready() is asked again while the task waits its turn: a higher 
+        // priority task may since have used what it needs, e.g. output room
+        bool ready = task->ready();
+        if(!task->pending && ready)
+        {
+            task->pending = true;
+            task->dueUs = now;
+        }
+        return task->pending && ready;
+    }
+
+    // Periodic: due once (int32_t)(now - dueUs) >= 0, wraps with micros()
+    if((int32_t)(now - task->dueUs) < 0)
+    {
+        return false;
+    }
+    if(task->ready != 0 && !task->ready())
+    {
+        task->dueUs = now;      // nothing to do yet; due counts from when it is
+        return false;
+    }
+    task->pending = true;
+    return true;
+}
+
+static void runTask(schedTask_t* task, uint32_t now)
+{
+    schedStats_t* stats = &task->stats;
+    uint32_t due = task->dueUs;
+    uint32_t latency = now - due;
+
+    task->pending = false;
+    if(task->periodUs != 0)
+    {
+        // Next period counts from this due time, or from now if a whole period was lost
+        task->dueUs = (latency < task->periodUs) ? due + task->periodUs : now + task->periodUs;
+    }
+
+    _current = task;
+    TRACE_BEGIN(TRACE_ID_TASK, task - _tasks);
+    task->run();
+    TRACE_END(TRACE_ID_TASK, task - _tasks);
+    _current = 0;
+
+    uint32_t end = API_Hardware_micros();
+    uint32_t runTime = end - now;
+    stats->runs++;
+    stats->lastRunUs = runTime;
+    stats->totalRunUs += runTime;
+    if(runTime > stats->maxRunUs)
+    {
+        stats->maxRunUs = runTime;
+    }
+    if(latency > stats->maxLatencyUs)
+    {
+        stats->maxLatencyUs = latency;
+    }
+    if(task->deadlineUs != 0 && end - due > task->deadlineUs)
+    {
+        stats->misses++;
+    }
+}
+
+/***********************************************************/
+/***********************************************************/
+/******************* IMPORTANT FUNCTIONS *******************/
+
+/** Takes over a task table, ordered by priority with the highest first.
+    The table must stay valid for as long as the scheduler runs.
+    Periodic tasks first run one period from now. */
+void API_Scheduler_init(schedTask_t* tasks, uint8_t count)
+{
+    uint32_t now = API_Hardware_micros();
+
+    _tasks = tasks;
+    _taskCount = count;
+    for(uint8_t i = 0; i < count; i++)
+    {
+        tasks[i].pending = false;
+        tasks[i].dueUs = now + tasks[i].periodUs;
+        memset(&tasks[i].stats, 0, sizeof(schedStats_t));
+    }
+}
+
+/** Runs the highest priority task that is ready. Every task is checked
+    on each call so that due times are noted even for tasks that have to
+    wait. Returns false if no task was ready. */
+bool API_Scheduler_runOnce(void)
+{
+    schedTask_t* next = 0;
+    uint32_t now = API_Hardware_micros();
+
+    for(uint8_t i = 0; i < _taskCount; i++)
+    {
+        if(checkReady(&_tasks[i], now) && next == 0)
+        {
+            next = &_tasks[i];
+        }
+    }
+    if(next == 0)
+    {
+        return false;
+    }
+    runTask(next, now);
+    return true;
+}
+
+/** Called from a periodic task: makes the task next run delayUs from now 
+    instead of at the end of its period, e.g. to come back when a conversion 
+    it started is finished. */
+void API_Scheduler_runAfter(uint32_t delayUs)
+{
+    if(_current != 0)
+    {
+        _current->dueUs = API_Hardware_micros() + delayUs;
+    }
+}
+
+void API_Scheduler_resetStats(void)
+{
+    for(uint8_t i = 0; i < _taskCount; i++)
+    {
+        memset(&_tasks[i].stats, 0, sizeof(schedStats_t));
+    }
+}
+
+uint8_t API_Scheduler_getTaskCount(void)
+{
+    return _taskCount;
+}
+
+const schedTask_t* API_Scheduler_getTask(uint8_t index)
+{
+    return (index < _taskCount) ? &_tasks[index] : 0;
+}
@@ -0,0 +1,83 @@
+#ifndef API_SCHEDULER_H
+#define API_SCHEDULER_H
+
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+/**@file API_Scheduler.h
+   @brief Small cooperative scheduler for the sketch's main loop.
+
+   The work of the sketch is split into tasks kept in a table ordered by
+   priority, highest first. Each call to API_Scheduler_runOnce runs exactly
+   one task: the first one in the table that is ready. Putting the Data Ready
+   task first therefore means it is checked before every other task runs.
+
+   A task is ready when
+     - periodUs is 0 and its ready() predicate returns true (event task), or
+     - periodUs has passed since it last ran and ready() is NULL or returns
+       true (periodic task).
+
+   ready() is asked again on every call, also for a task that is already due,
+   and a task only runs when it returns true on that call; a task can rely on
+   what ready() checked, such as room in the output queue, even when higher
+   priority tasks ran first.
+
+   The task becomes due when it is first seen ready (event tasks) or when its
+   period ends (periodic tasks; with a ready() predicate, when it is first
+   seen ready after that). It misses its deadline when it has not
+   finished deadlineUs after becoming due. Tasks are not preempted, so a task
+   that needs to wait must return and continue on a later run. */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/***********************************************************/
+/***********************************************************/
+/****************** PUBLIC DATA STRUCTURES *****************/
+
+typedef struct
+{
+    uint32_t runs;
+    uint32_t misses;         /**< Runs that finished after their deadline */
+    uint32_t lastRunUs;      /**< Run time of the last run */
+    uint32_t maxRunUs;
+    uint64_t totalRunUs;
+    uint32_t maxLatencyUs;   /**< Longest wait from due to start */
+} schedStats_t;
+
+typedef struct
+{
+    const char* name;
+    void      (*run)(void);
+    bool      (*ready)(void); /**< NULL for periodic tasks that are always ready */
+    uint32_t    periodUs;     /**< 0 for event tasks */
+    uint32_t    deadlineUs;   /**< 0 for no deadline */
+
+    /* Scheduler state, zero it before API_Scheduler_init */
+    bool        pending;      /**< Due and waiting to run */
+    uint32_t    dueUs;        /**< When it became (or next becomes) due */
+    schedStats_t stats;
+} schedTask_t;
+
+/***********************************************************/
+/***********************************************************/
+/******************* IMPORTANT FUNCTIONS *******************/
+
+void API_Scheduler_init(schedTask_t* tasks, uint8_t count);
+
+bool API_Scheduler_runOnce(void);
+
+void API_Scheduler_runAfter(uint32_t delayUs);
+
+void API_Scheduler_resetStats(void);
+
+uint8_t API_Scheduler_getTaskCount(void);
+
+const schedTask_t* API_Scheduler_getTask(uint8_t index);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // API_SCHEDULER_H
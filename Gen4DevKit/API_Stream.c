@@ -0,0 +1,127 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+#include "API_Stream.h"
+
+/***********************************************************/
+/***********************************************************/
+/******************* IMPORTANT FUNCTIONS *******************/
+
+/** Builds a complete frame (header, payload and checksum) into frame, which
+    must hold at least length + STREAM_OVERHEAD bytes.
+    Returns the number of bytes to send, or 0 if the payload is too long. */
+uint16_t API_Stream_encodeFrame(uint8_t type, uint32_t timestamp,
+                                const uint8_t* payload, uint16_t length, uint8_t* frame)
+{
+    uint8_t checksum = 0;
+    uint16_t i;
+
+    if(length > STREAM_MAX_PAYLOAD)
+    {
+        return 0;
+    }
+
+    frame[0] = STREAM_SYNC_0;
+    frame[1] = STREAM_SYNC_1;
+    frame[2] = type;
+    frame[3] = (uint8_t)(length & 0x00FF);
+    frame[4] = (uint8_t)((length & 0xFF00) >> 8);
+    frame[5] = (uint8_t)(timestamp & 0x000000FF);
+    frame[6] = (uint8_t)((timestamp & 0x0000FF00) >> 8);
+    frame[7] = (uint8_t)((timestamp & 0x00FF0000) >> 16);
+    frame[8] = (uint8_t)((timestamp & 0xFF000000) >> 24);
+
+    for(i = 2; i < STREAM_HEADER_SIZE; i++)
+    {
+        checksum += frame[i];
+    }
+    for(i = 0; i < length; i++)
+    {
+        checksum += frame[STREAM_HEADER_SIZE + i] = payload[i];
+    }
+    frame[STREAM_HEADER_SIZE + length] = checksum;
+
+    return length + STREAM_OVERHEAD;
+}
+
+/** Resets a parser to search for the start of a frame. */
+void API_Stream_initParser(streamParser_t* parser)
+{
+    parser->index = 0;
+    parser->checksum = 0;
+    parser->badFrames = 0;
+    parser->skipped = 0;
+}
+
+/** Feeds one received byte to the parser. Returns true when the byte
+    completes a valid frame, which is then available in parser->frame.
+    Corrupt frames are counted in badFrames and silently dropped. */
+bool API_Stream_parseByte(streamParser_t* parser, uint8_t data)
+{
+    streamFrame_t* frame = &parser->frame;
+    uint16_t index = parser->index++;
+
+    switch(index)
+    {
+        case 0:
+            if(data != STREAM_SYNC_0)
+            {
+                parser->skipped++;
+                parser->index = 0;
+            }
+            return false;
+        case 1:
+            if(data != STREAM_SYNC_1)
+            {
+                // a repeated sync0 may still be the start of a frame
+                parser->skipped++;
+                parser->index = (data == STREAM_SYNC_0) ? 1 : 0;
+            }
+            return false;
+        case 2:
+            frame->type = data;
+            parser->checksum = data;
+            return false;
+        case 3:
+            frame->length = data;
+            parser->checksum += data;
+            return false;
+        case 4:
+            frame->length |= (uint16_t)data << 8;
+            parser->checksum += data;
+            if(frame->length > STREAM_MAX_PAYLOAD)
+            {
+                parser->badFrames++;
+                parser->index = 0;
+            }
+            return false;
+        case 5:
+        case 6:
+        case 7:
+        case 8:
+            if(index == 5)
+            {
+                frame->timestamp = 0;
+            }
+            frame->timestamp |= (uint32_t)data << (8 * (index - 5));
+            parser->checksum += data;
+            return false;
+        default:
+            break;
+    }
+
+    if(index < STREAM_HEADER_SIZE + frame->length)
+    {
+        frame->payload[index - STREAM_HEADER_SIZE] = data;
+        parser->checksum += data;
+        return false;
+    }
+
+    // checksum byte ends the frame either way
+    parser->index = 0;
+    if(data != parser->checksum)
+    {
+        parser->badFrames++;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,87 @@
+#ifndef API_STREAM_H
+#define API_STREAM_H
+
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+/**@file API_Stream.h
+   @brief Binary framing used to stream data between the dev kit and host tools.
+
+   Every frame on the serial link looks like this (multi-byte fields are little endian):
+
+       sync0 sync1 type lengthLow lengthHigh timestamp[4] payload[length] checksum
+
+   The checksum is the 8 bit sum of every byte from type through the end of the
+   payload, the same scheme used by the extended memory access protocol.
+   The timestamp is the sender's micros() value when the frame was built.
+   Frames may be interleaved with the plain text menu output; a parser simply
+   skips bytes until it finds a sync pattern that yields a valid frame. */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/***********************************************************/
+/***********************************************************/
+/******************* PROVIDED DEFINES **********************/
+
+#define STREAM_SYNC_0           (0xA5)
+#define STREAM_SYNC_1           (0x5A)
+#define STREAM_HEADER_SIZE      (9)    /**< sync(2) + type(1) + length(2) + timestamp(4) */
+#define STREAM_OVERHEAD         (STREAM_HEADER_SIZE + 1) /**< header + checksum */
+#define STREAM_MAX_PAYLOAD      (512)
+#define STREAM_MAX_FRAME        (STREAM_MAX_PAYLOAD + STREAM_OVERHEAD)
+
+/** Frame types */
+#define STREAM_TYPE_REPORT        (0x01) /**< Payload is a raw report packet as read by HB_readReport */
+#define STREAM_TYPE_RECORDER_INFO (0x02) /**< Flight recorder dump header, see API_Recorder_encodeDumpInfo */
+#define STREAM_TYPE_RECORDER_DATA (0x03) /**< Flight recorder dump chunk: offset[4] then record bytes */
+#define STREAM_TYPE_TRACE_INFO    (0x04) /**< Trace dump header, see API_Trace_encodeDumpInfo */
+#define STREAM_TYPE_TRACE_DATA    (0x05) /**< Trace dump chunk: index[4] then entries, see API_Trace_copy */
+#define STREAM_TYPE_STATS         (0x06) /**< Touch statistics summary, see API_C2_encodeStatsSummary */
+#define STREAM_TYPE_WATCH         (0x07) /**< Watched register change, see API_C2_encodeWatchEvent */
+#define STREAM_TYPE_COMMAND       (0x10) /**< Host to dev kit command, see API_Command.h */
+#define STREAM_TYPE_RESPONSE      (0x11) /**< Dev kit's response to a command */
+#define STREAM_TYPE_REGION_DATA   (0x12) /**< A chunk of a READ_REGION command, see API_Command.h */
+#define STREAM_TYPE_MERGED        (0x13) /**< Host tools: a frame of one of several boards, see gen4merge */
+
+/***********************************************************/
+/***********************************************************/
+/****************** PUBLIC DATA STRUCTURES *****************/
+
+/** A frame received by the parser. The payload is only valid until
+    the next call to API_Stream_parseByte. */
+typedef struct
+{
+    uint8_t  type;      /**< One of the STREAM_TYPE_ defines */
+    uint16_t length;    /**< Number of valid bytes in payload */
+    uint32_t timestamp; /**< Sender's micros() when the frame was built */
+    uint8_t  payload[STREAM_MAX_PAYLOAD];
+} streamFrame_t;
+
+/** Byte-at-a-time frame parser state. */
+typedef struct
+{
+    streamFrame_t frame;      /**< Frame currently being assembled */
+    uint16_t      index;      /**< Bytes of the current frame received so far */
+    uint8_t       checksum;   /**< Running checksum of the current frame */
+    uint32_t      badFrames;  /**< Frames dropped for checksum or length errors */
+    uint32_t      skipped;    /**< Bytes skipped while searching for sync */
+} streamParser_t;
+
+/***********************************************************/
+/***********************************************************/
+/******************* IMPORTANT FUNCTIONS *******************/
+
+uint16_t API_Stream_encodeFrame(uint8_t type, uint32_t timestamp,
+                                const uint8_t* payload, uint16_t length, uint8_t* frame);
+
+void API_Stream_initParser(streamParser_t* parser);
+
+bool API_Stream_parseByte(streamParser_t* parser, uint8_t data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // API_STREAM_H
@@ -0,0 +1,146 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+#include "API_Trace.h"
+
+#if (TRACE_BUFFER_ENTRIES & (TRACE_BUFFER_ENTRIES - 1)) != 0
+#error TRACE_BUFFER_ENTRIES must be a power of two
+#endif
+
+/***********************************************************/
+/***********************************************************/
+/********************* MODULE VARIABLES ********************/
+
+#if CONFIG_TRACE_ENABLE
+static traceEntry_t _entries[TRACE_BUFFER_ENTRIES];
+#endif
+static uint32_t _recorded = 0;      /**< Entries recorded since the last clear */
+static bool _enabled = true;
+
+/***********************************************************/
+/***********************************************************/
+/********************* HELPER FUNCTIONS ********************/
+
+static void put32(uint8_t* buffer, uint32_t value)
+{
+    buffer[0] = (uint8_t)(value & 0xFF);
+    buffer[1] = (uint8_t)((value >> 8) & 0xFF);
+    buffer[2] = (uint8_t)((value >> 16) & 0xFF);
+    buffer[3] = (uint8_t)((value >> 24) & 0xFF);
+}
+
+static uint32_t get32(const uint8_t* buffer)
+{
+    return (uint32_t)buffer[0] | ((uint32_t)buffer[1] << 8)
+         | ((uint32_t)buffer[2] << 16) | ((uint32_t)buffer[3] << 24);
+}
+
+/***********************************************************/
+/***********************************************************/
+/******************* IMPORTANT FUNCTIONS *******************/
+
+/** Stores one entry, overwriting the oldest once the ring is full. Use the 
+    TRACE_ macros, which compile to nothing when tracing is off. */
+void API_Trace_record(uint32_t timestamp, uint8_t id, uint8_t phase, uint16_t arg)
+{
+#if CONFIG_TRACE_ENABLE
+    if(!_enabled)
+    {
+        return;
+    }
+    traceEntry_t* entry = &_entries[_recorded & (TRACE_BUFFER_ENTRIES - 1)];
+    entry->timestamp = timestamp;
+    entry->id = id;
+    entry->phase = phase;
+    entry->arg = arg;
+    _recorded++;
+#else
+    (void)timestamp;
+    (void)id;
+    (void)phase;
+    (void)arg;
+#endif
+}
+
+void API_Trace_clear(void)
+{
+    _recorded = 0;
+}
+
+/** Pauses recording, for instance while the ring is being sent */
+void API_Trace_enable(bool enable)
+{
+    _enabled = enable;
+}
+
+/** Entries held, 0 when tracing is compiled out */
+uint32_t API_Trace_getCount(void)
+{
+#if CONFIG_TRACE_ENABLE
+    return (_recorded < TRACE_BUFFER_ENTRIES) ? _recorded : TRACE_BUFFER_ENTRIES;
+#else
+    return 0;
+#endif
+}
+
+/** Encodes up to maxEntries entries into buffer, starting index entries 
+    after the oldest. Returns the bytes written, TRACE_ENTRY_SIZE each. */
+uint16_t API_Trace_copy(uint32_t index, uint8_t* buffer, uint16_t maxEntries)
+{
+    uint16_t n = 0;
+#if CONFIG_TRACE_ENABLE
+    uint32_t count = API_Trace_getCount();
+    uint32_t oldest = _recorded - count;
+
+    for(; n < maxEntries && index + n < count; n++)
+    {
+        const traceEntry_t* entry = &_entries[(oldest + index + n) & (TRACE_BUFFER_ENTRIES - 1)];
+        uint8_t* out = &buffer[n * TRACE_ENTRY_SIZE];
+        put32(out, entry->timestamp);
+        out[4] = entry->id;
+        out[5] = entry->phase;
+        out[6] = (uint8_t)(entry->arg & 0xFF);
+        out[7] = (uint8_t)(entry->arg >> 8);
+    }
+#else
+    (void)index;
+    (void)buffer;
+    (void)maxEntries;
+#endif
+    return (uint16_t)(n * TRACE_ENTRY_SIZE);
+}
+
+/** Encodes the dump header (TRACE_DUMP_INFO_SIZE bytes). Returns its length. */
+uint8_t API_Trace_encodeDumpInfo(uint8_t* buffer)
+{
+    uint32_t count = API_Trace_getCount();
+
+    buffer[0] = TRACE_DUMP_VERSION;
+    buffer[1] = TRACE_ENTRY_SIZE;
+    put32(&buffer[2], count);
+    put32(&buffer[6], _recorded);
+    put32(&buffer[10], _recorded - count);
+    return TRACE_DUMP_INFO_SIZE;
+}
+
+/** Decodes a dump header. Returns false for an unknown version or size. */
+bool API_Trace_decodeDumpInfo(const uint8_t* buffer, uint16_t length, traceDumpInfo_t* info)
+{
+    if(length < TRACE_DUMP_INFO_SIZE || buffer[0] != TRACE_DUMP_VERSION || buffer[1] != TRACE_ENTRY_SIZE)
+    {
+        return false;
+    }
+    info->version = buffer[0];
+    info->entrySize = buffer[1];
+    info->count = get32(&buffer[2]);
+    info->recorded = get32(&buffer[6]);
+    info->overwritten = get32(&buffer[10]);
+    return true;
+}
+
+void API_Trace_decodeEntry(const uint8_t* data, traceEntry_t* entry)
+{
+    entry->timestamp = get32(data);
+    entry->id = data[4];
+    entry->phase = data[5];
+    entry->arg = (uint16_t)(data[6] | (data[7] << 8));
+}
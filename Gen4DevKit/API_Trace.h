@@ -0,0 +1,151 @@
+#ifndef API_TRACE_H
+#define API_TRACE_H
+
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+/**@file API_Trace.h
+   @brief Trace points: a timeline of what the firmware does, kept in RAM.
+
+   The TRACE_ macros mark the start and end of an activity, or a moment, with
+   an event ID and a 16 bit argument. With CONFIG_TRACE_ENABLE set to 0 (see
+   Project_Config.h) they compile to nothing. With it set to 1 each one
+   stores an 8 byte entry in a ring of TRACE_BUFFER_ENTRIES, overwriting the
+   oldest. With CONFIG_TRACE_SCOPE also set, the events TRACE_SCOPE1_ID and
+   TRACE_SCOPE2_ID drive SCOPE1_PIN and SCOPE2_PIN: high from begin to end,
+   a short pulse for an instant event.
+
+   The ring is sent as API_Stream frames: STREAM_TYPE_TRACE_INFO
+   (API_Trace_encodeDumpInfo), then STREAM_TYPE_TRACE_DATA chunks of entries,
+   oldest first. Gen4HostTools/gen4trace turns them into Chrome trace JSON
+   for chrome://tracing or ui.perfetto.dev. Each entry is:
+
+       timestamp[4] id phase arg[2]      little endian, timestamp in us
+
+   Entries are stored with a timestamp supplied by the macro, so the ring
+   and its decoding have no hardware dependencies. Nothing records from an
+   interrupt, so recording is not made interrupt safe. */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "Project_Config.h"
+#include "API_Hardware.h"
+
+/***********************************************************/
+/***********************************************************/
+/******************* PROVIDED DEFINES **********************/
+
+/** Entries kept, a power of two. 8 bytes each. */
+#ifndef TRACE_BUFFER_ENTRIES
+#define TRACE_BUFFER_ENTRIES    (512)
+#endif
+
+#define TRACE_ENTRY_SIZE        (8)
+
+/** Event IDs */
+#define TRACE_ID_DR             (1)   /**< Data Ready seen asserted (instant) */
+#define TRACE_ID_I2C            (2)   /**< A bus operation, arg: device address (API_Bus.h) */
+#define TRACE_ID_REPORT         (3)   /**< Report read, arg: report ID at the end */
+#define TRACE_ID_DECODE         (4)   /**< Report events worked out, arg: report ID */
+#define TRACE_ID_OUTPUT         (5)   /**< Output moved to USB, arg: bytes at the end */
+#define TRACE_ID_TASK           (6)   /**< Scheduler task run, arg: index in the task table */
+#define TRACE_ID_USER           (16)  /**< First ID free for the sketch */
+
+/** Phases, as in the Chrome trace format */
+#define TRACE_PHASE_BEGIN       ('B')
+#define TRACE_PHASE_END         ('E')
+#define TRACE_PHASE_INSTANT     ('i')
+#define TRACE_PHASE_COUNTER     ('C')
+
+/** Events shown on the scope pins with CONFIG_TRACE_SCOPE */
+#ifndef TRACE_SCOPE1_ID
+#define TRACE_SCOPE1_ID         TRACE_ID_REPORT
+#endif
+#ifndef TRACE_SCOPE2_ID
+#define TRACE_SCOPE2_ID         TRACE_ID_I2C
+#endif
+
+/** Dump format version, sent in traceDumpInfo_t */
+#define TRACE_DUMP_VERSION      (1)
+#define TRACE_DUMP_INFO_SIZE    (2 + 3 * 4)
+
+#if CONFIG_TRACE_ENABLE && CONFIG_TRACE_SCOPE
+#define TRACE_SCOPE(id, phase)                                                   \
+    do {                                                                         \
+        if((id) == TRACE_SCOPE1_ID || (id) == TRACE_SCOPE2_ID)                   \
+        {                                                                        \
+            uint8_t pin = ((id) == TRACE_SCOPE1_ID) ? SCOPE1_PIN : SCOPE2_PIN;   \
+            API_Hardware_setScope(pin, (phase) != TRACE_PHASE_END);              \
+            if((phase) == TRACE_PHASE_INSTANT)                                   \
+            {                                                                    \
+                API_Hardware_setScope(pin, false);                               \
+            }                                                                    \
+        }                                                                        \
+    } while(0)
+#else
+#define TRACE_SCOPE(id, phase)  ((void)0)
+#endif
+
+#if CONFIG_TRACE_ENABLE
+#define TRACE_RECORD(id, phase, arg)                                             \
+    do {                                                                         \
+        TRACE_SCOPE(id, phase);                                                  \
+        API_Trace_record(API_Hardware_micros(), (id), (phase), (uint16_t)(arg)); \
+    } while(0)
+#else
+#define TRACE_RECORD(id, phase, arg)  ((void)0)
+#endif
+
+#define TRACE_BEGIN(id, arg)     TRACE_RECORD(id, TRACE_PHASE_BEGIN, arg)
+#define TRACE_END(id, arg)       TRACE_RECORD(id, TRACE_PHASE_END, arg)
+#define TRACE_INSTANT(id, arg)   TRACE_RECORD(id, TRACE_PHASE_INSTANT, arg)
+#define TRACE_COUNTER(id, value) TRACE_RECORD(id, TRACE_PHASE_COUNTER, value)
+
+/***********************************************************/
+/***********************************************************/
+/****************** PUBLIC DATA STRUCTURES *****************/
+
+typedef struct
+{
+    uint32_t timestamp;
+    uint8_t  id;
+    uint8_t  phase;           /**< TRACE_PHASE_ */
+    uint16_t arg;
+} traceEntry_t;
+
+/** Dump header */
+typedef struct
+{
+    uint8_t  version;
+    uint8_t  entrySize;
+    uint32_t count;           /**< Entries in the dump */
+    uint32_t recorded;        /**< Entries recorded since the last clear */
+    uint32_t overwritten;     /**< Oldest entries lost to make room */
+} traceDumpInfo_t;
+
+/***********************************************************/
+/***********************************************************/
+/******************* IMPORTANT FUNCTIONS *******************/
+
+void API_Trace_record(uint32_t timestamp, uint8_t id, uint8_t phase, uint16_t arg);
+
+void API_Trace_clear(void);
+
+void API_Trace_enable(bool enable);
+
+uint32_t API_Trace_getCount(void);
+
+uint16_t API_Trace_copy(uint32_t index, uint8_t* buffer, uint16_t maxEntries);
+
+uint8_t API_Trace_encodeDumpInfo(uint8_t* buffer);
+
+bool API_Trace_decodeDumpInfo(const uint8_t* buffer, uint16_t length, traceDumpInfo_t* info);
+
+void API_Trace_decodeEntry(const uint8_t* data, traceEntry_t* entry);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // API_TRACE_H
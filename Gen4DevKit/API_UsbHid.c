@@ -0,0 +1,239 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+#include <string.h>
+#include "API_UsbHid.h"
+#include "API_Hardware.h"
+#include "UsbHid.h"
+
+/***********************************************************/
+/***********************************************************/
+/********************* MODULE VARIABLES ********************/
+
+static mapTransform_t _map;
+static bool _mapped = false;        /**< Absolute reports are dropped until a map is set */
+static bool _enabled = false;
+static usbHidOutput_t _last;        /**< What the host was last sent of each interface */
+static usbHidStats_t _stats;
+
+/***********************************************************/
+/***********************************************************/
+/******************** HELPER FUNCTIONS *********************/
+
+/** HID mouse buttons of a report's buttons. The pad's own button
+    (BUTTON_8_MASK, a click pad's click) is the left button. */
+static uint8_t mouseButtons(uint8_t buttons)
+{
+    return (buttons & (BUTTON_1_MASK | BUTTON_2_MASK | BUTTON_3_MASK))
+           | ((buttons & BUTTON_8_MASK) ? BUTTON_1_MASK : 0);
+}
+
+static void translateAbsolute(const report_t* report, usbHidOutput_t* output)
+{
+    mappedPoint_t points[USB_HID_FINGERS];
+    usbTouch_t* touch = &output->touch;
+    uint8_t count = _mapped ? API_C2_mapFingers(&_map, report, points) : 0;
+
+    output->mouse.buttons = mouseButtons(report->abs.buttons);
+    if(output->mouse.buttons != _last.mouse.buttons)
+    {
+        output->send |= 1 << USB_HID_MOUSE;
+    }
+    if(!_mapped)
+    {
+        return;
+    }
+    memset(touch, 0, sizeof(*touch));
+    for(uint8_t i = 0; i < count; i++)
+    {
+        uint8_t finger = points[i].finger;
+        touch->contacts |= 1 << finger;
+        touch->x[finger] = points[i].x;
+        touch->y[finger] = points[i].y;
+    }
+    touch->lifted = _last.touch.contacts & ~touch->contacts;
+    bool changed = touch->contacts != _last.touch.contacts;
+    for(uint8_t finger = 0; finger < USB_HID_FINGERS && !changed; finger++)
+    {
+        changed = touch->x[finger] != _last.touch.x[finger] || touch->y[finger] != _last.touch.y[finger];
+    }
+    if(changed)
+    {
+        output->send |= 1 << USB_HID_TOUCH;
+    }
+}
+
+/** Sends output's reports to the interfaces the USB Type has */
+static void send(const usbHidOutput_t* output)
+{
+    uint8_t interfaces = UsbHid_interfaces();
+
+    for(uint8_t i = 0; i < USB_HID_INTERFACES; i++)
+    {
+        if(!(output->send & (1 << i)))
+        {
+            continue;
+        }
+        if(!(interfaces & (1 << i)))
+        {
+            _stats.unsupported++;
+            continue;
+        }
+        _stats.sent[i]++;
+        switch(i)
+        {
+            case USB_HID_MOUSE:     UsbHid_sendMouse(&output->mouse);       break;
+            case USB_HID_KEYBOARD:  UsbHid_sendKeyboard(&output->keyboard); break;
+            default:                UsbHid_sendTouch(&output->touch);       break;
+        }
+    }
+}
+
+/***********************************************************/
+/***********************************************************/
+/******************* IMPORTANT FUNCTIONS *******************/
+
+/** Sets how finger positions are mapped to the touch screen, normally the
+    pad's raw range to USB_HID_TOUCH_RANGE wide and high. Returns false, and
+    keeps the last map, if config does not compile (see API_C2_compileMap). */
+bool API_UsbHid_setMap(const mapConfig_t* config)
+{
+    mapTransform_t transform;
+
+    if(!API_C2_compileMap(config, &transform))
+    {
+        return false;
+    }
+    _map = transform;
+    _mapped = true;
+    return true;
+}
+
+/** Turns passthrough on or off. Turning it off first lets go of every
+    button, key and contact the host was last sent, so none is left held. */
+void API_UsbHid_enable(bool enable)
+{
+    if(!enable && _enabled)
+    {
+        usbHidOutput_t release;
+        memset(&release, 0, sizeof(release));
+        release.send = (_last.mouse.buttons ? 1 << USB_HID_MOUSE : 0)
+                       | (memcmp(&_last.keyboard, &release.keyboard, sizeof(usbKeyboard_t)) ? 1 << USB_HID_KEYBOARD : 0)
+                       | (_last.touch.contacts ? 1 << USB_HID_TOUCH : 0);
+        release.touch.lifted = _last.touch.contacts;
+        send(&release);
+    }
+    memset(&_last, 0, sizeof(_last));
+    _enabled = enable;
+}
+
+bool API_UsbHid_enabled(void)
+{
+    return _enabled;
+}
+
+/** Turns a decoded report into HID reports, and returns the bits of the
+    interfaces they are for (output->send): 0 if the report would send what
+    was sent last, or is of an unknown kind. What is returned is taken as
+    sent; the next report is compared with it. */
+uint8_t API_UsbHid_translate(const report_t* report, usbHidOutput_t* output)
+{
+    *output = _last;
+    output->send = 0;
+    output->touch.lifted = 0;
+    switch(API_C2_getReportKind(report->reportID))
+    {
+        case REPORT_KIND_MOUSE:
+            output->mouse.buttons = mouseButtons(report->mouse.buttons);
+            output->mouse.x = report->mouse.xDelta;
+            output->mouse.y = report->mouse.yDelta;
+            output->mouse.wheel = report->mouse.scrollDelta;
+            output->mouse.pan = report->mouse.panDelta;
+            if(output->mouse.buttons != _last.mouse.buttons || output->mouse.x || output->mouse.y
+               || output->mouse.wheel || output->mouse.pan)
+            {
+                output->send |= 1 << USB_HID_MOUSE;
+            }
+            break;
+        case REPORT_KIND_KEYBOARD:
+            output->keyboard.modifier = report->keyboard.modifier;
+            memcpy(output->keyboard.keys, report->keyboard.keycode, USB_HID_KEYS);
+            if(memcmp(&output->keyboard, &_last.keyboard, sizeof(usbKeyboard_t)) != 0)
+            {
+                output->send |= 1 << USB_HID_KEYBOARD;
+            }
+            break;
+        case REPORT_KIND_ABSOLUTE:
+            translateAbsolute(report, output);
+            break;
+        default:
+            break;
+    }
+    // movement is relative, so it is never repeated
+    _last.mouse.buttons = output->mouse.buttons;
+    _last.keyboard = output->keyboard;
+    _last.touch = output->touch;
+    _last.touch.lifted = 0;
+    return output->send;
+}
+
+/** Hands over a report packet as soon as it is read, and sends what it
+    translates to. readyUs is when it could first have been read, as for
+    API_Haptic_report. Does nothing while passthrough is off. */
+void API_UsbHid_report(uint8_t* packet, uint32_t readyUs)
+{
+    report_t report;
+    usbHidOutput_t output;
+
+    if(!_enabled)
+    {
+        return;
+    }
+    uint32_t startUs = API_Hardware_micros();
+    API_C2_decodeReport(packet, &report);
+    uint8_t interfaces = API_UsbHid_translate(&report, &output);
+    send(&output);
+    uint32_t doneUs = API_Hardware_micros();
+
+    _stats.reports++;
+    uint32_t costUs = doneUs - startUs;
+    _stats.maxCostUs = costUs > _stats.maxCostUs ? costUs : _stats.maxCostUs;
+    _stats.totalCostUs += costUs;
+    if(interfaces == 0)
+    {
+        _stats.unchanged++;
+        return;
+    }
+    if(!(interfaces & UsbHid_interfaces()))
+    {
+        return;
+    }
+    uint32_t latencyUs = doneUs - readyUs;
+    _stats.minUs = (_stats.forwarded == 0 || latencyUs < _stats.minUs) ? latencyUs : _stats.minUs;
+    _stats.maxUs = latencyUs > _stats.maxUs ? latencyUs : _stats.maxUs;
+    _stats.totalUs += latencyUs;
+    _stats.forwarded++;
+}
+
+/***********************************************************/
+/***********************************************************/
+/******************** PUBLIC FUNCTIONS *********************/
+
+const usbHidStats_t* API_UsbHid_getStats(void)
+{
+    return &_stats;
+}
+
+uint32_t API_UsbHid_meanLatencyUs(const usbHidStats_t* stats)
+{
+    return stats->forwarded ? (uint32_t)(stats->totalUs / stats->forwarded) : 0;
+}
+
+uint32_t API_UsbHid_meanCostUs(const usbHidStats_t* stats)
+{
+    return stats->reports ? (uint32_t)(stats->totalCostUs / stats->reports) : 0;
+}
+
+void API_UsbHid_resetStats(void)
+{
+    memset(&_stats, 0, sizeof(_stats));
+}
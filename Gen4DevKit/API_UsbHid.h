@@ -0,0 +1,134 @@
+#ifndef API_USBHID_H
+#define API_USBHID_H
+
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+/**@file API_UsbHid.h
+   @brief USB HID passthrough: the pad's reports sent on as the dev kit's
+   own USB mouse, keyboard and touch screen.
+
+   API_UsbHid_report is called from the report read itself (reportTask),
+   like API_Haptic_report, so a report goes out on USB as soon as it is read
+   and never waits behind the report queue or the serial output. Mouse
+   reports become USB mouse reports and keyboard reports keyboard reports,
+   field for field. Absolute reports become touch screen (digitizer)
+   contacts: the valid fingers, with their positions mapped to
+   0..USB_HID_TOUCH_RANGE-1 by API_C2_Map.h, and the buttons of the report
+   as mouse buttons. Only changes go out: a report that would send the same
+   HID report as last time (no movement and the same buttons, the same
+   keys, the same contacts at the same positions) sends nothing.
+
+   API_UsbHid_translate is the translation alone, with no USB behind it;
+   UsbHid.h hands its output to the board's USB stack. The board sends each
+   HID report at the host's next poll of the interface; at full speed, the
+   Teensy 3.2's, 1 ms is the shortest polling interval there is.
+
+   For every report forwarded the time from Data Ready asserting to the
+   HID reports handed to USB is kept, and the time API_UsbHid_report itself
+   took, which is what passthrough adds to the report read (see
+   usbHidStats_t). */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "API_C2_Report.h"
+#include "API_C2_Map.h"
+
+/***********************************************************/
+/***********************************************************/
+/******************* PROVIDED DEFINES **********************/
+
+/** The HID interfaces, and bits of usbHidOutput_t.send */
+#define USB_HID_MOUSE           (0)
+#define USB_HID_KEYBOARD        (1)
+#define USB_HID_TOUCH           (2)
+#define USB_HID_INTERFACES      (3)
+
+#define USB_HID_FINGERS         (5)
+#define USB_HID_KEYS            (6)
+#define USB_HID_TOUCH_RANGE     (32768) /**< Logical range of the touch screen's X and Y */
+
+/***********************************************************/
+/***********************************************************/
+/****************** PUBLIC DATA STRUCTURES *****************/
+
+/** A boot protocol mouse report, with a horizontal wheel */
+typedef struct
+{
+    uint8_t buttons;            /**< Bit 0 left, 1 right, 2 middle */
+    int8_t  x;
+    int8_t  y;
+    int8_t  wheel;
+    int8_t  pan;
+} usbMouse_t;
+
+typedef struct
+{
+    uint8_t modifier;           /**< KEYBOARD_MODIFIER_ bits, the same in HID */
+    uint8_t keys[USB_HID_KEYS];
+} usbKeyboard_t;
+
+/** Touch screen contacts, one per pad finger slot */
+typedef struct
+{
+    uint8_t  contacts;          /**< Fingers down */
+    uint8_t  lifted;            /**< Fingers down in the last one sent and not in this */
+    uint16_t x[USB_HID_FINGERS];
+    uint16_t y[USB_HID_FINGERS];
+} usbTouch_t;
+
+/** What one report turns into */
+typedef struct
+{
+    uint8_t       send;         /**< Bits (1 << USB_HID_) of the reports below to send */
+    usbMouse_t    mouse;
+    usbKeyboard_t keyboard;
+    usbTouch_t    touch;
+} usbHidOutput_t;
+
+typedef struct
+{
+    uint32_t reports;           /**< Passed to API_UsbHid_report while enabled */
+    uint32_t forwarded;         /**< Of those, handed at least one HID report to USB */
+    uint32_t unchanged;         /**< Would have sent what was sent last */
+    uint32_t sent[USB_HID_INTERFACES];
+    uint32_t unsupported;       /**< Not sent, the USB Type has no such interface */
+    uint32_t minUs;             /**< Data Ready to the HID reports handed to USB, of those forwarded */
+    uint32_t maxUs;
+    uint64_t totalUs;
+    uint32_t maxCostUs;         /**< Time in API_UsbHid_report, of every report */
+    uint64_t totalCostUs;
+} usbHidStats_t;
+
+/***********************************************************/
+/***********************************************************/
+/******************* IMPORTANT FUNCTIONS *******************/
+
+bool API_UsbHid_setMap(const mapConfig_t* config);
+
+void API_UsbHid_enable(bool enable);
+
+bool API_UsbHid_enabled(void);
+
+uint8_t API_UsbHid_translate(const report_t* report, usbHidOutput_t* output);
+
+void API_UsbHid_report(uint8_t* packet, uint32_t readyUs);
+
+/***********************************************************/
+/***********************************************************/
+/******************** PUBLIC FUNCTIONS *********************/
+
+const usbHidStats_t* API_UsbHid_getStats(void);
+
+uint32_t API_UsbHid_meanLatencyUs(const usbHidStats_t* stats);
+
+uint32_t API_UsbHid_meanCostUs(const usbHidStats_t* stats);
+
+void API_UsbHid_resetStats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // API_USBHID_H
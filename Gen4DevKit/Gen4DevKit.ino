@@ -6,95 +6,505 @@
 #include "API_C2.h"         /** < Provides API calls to interact with API_C2 firmware */
 #include "API_Hardware.h"
 #include "API_HostBus.h"    /** < Provides I2C connection to module */
+#include "API_Stream.h"     /** < Binary framing for streaming to host tools */
+#include "API_Command.h"    /** < Binary command channel for host tools */
+#include "API_C2_Region.h"   /** < Chunked reads of large memory regions */
+#include "INA219.h"         /** < Current sense for the power task */
+#include "API_Scheduler.h"  /** < Runs the work of the loop as prioritized tasks */
+#include "API_Bus.h"        /** < Shares the I2C bus between the pad and the INA219 */
+#include "OutputQueue.h"    /** < Non-blocking buffer in front of Serial */
+#include "API_Trace.h"      /** < Trace points, see CONFIG_TRACE_ENABLE */
+#include "API_C2_Idle.h"    /** < Idle power policy, see CONFIG_IDLE_ENABLE */
+#include "API_C2_Stats.h"   /** < Touch statistics summaries */
+#include "API_C2_Latency.h" /** < Button injection latency benchmark */
+#include "API_Haptic.h"     /** < Haptic pulses on touch and button events, see CONFIG_HAPTIC_ENABLE */
+#include "HostDR.h"         /** < When Data Ready asserted, for the haptic latency */
+#include "API_UsbHid.h"     /** < USB HID passthrough, see CONFIG_USB_HID_ENABLE */
+#include "API_C2_Watch.h"   /** < Register watch between reports, see CONFIG_WATCH_ENABLE */
 
 bool dataPrint_mode_g = true;  /** < toggle for printing out data > */
 bool eventPrint_mode_g = true; /** < toggle for printing off events */
+bool binaryStream_mode_g = false; /** < toggle for streaming raw packets to host tools */
+streamParser_t commandParser_g;   /** < assembles command frames from the host */
 
+/** Reports read by reportTask and waiting for eventTask. Only the packet is 
+    kept; eventTask reads it in place through a reportView_t. */
+#define REPORT_QUEUE_DEPTH (8)
+typedef struct
+{
+  uint8_t  packet[PACKET_SIZE];
+  uint32_t timestamp;           /** < micros() when DR was serviced */
+} queuedReport_t;
+
+queuedReport_t reportQueue_g[REPORT_QUEUE_DEPTH];
+uint8_t reportQueueHead_g = 0;
+uint8_t reportQueueCount_g = 0;
+uint32_t reportsDropped_g = 0;  /** < reports overwritten before eventTask got to them */
+uint32_t reportErrors_g = 0;    /** < report reads the bus failed */
+
+bool calibrating_g = false;     /** < a factory calibration is running */
+bool powerMeasuring_g = false;  /** < an INA219 conversion is running */
+int32_t shuntMicrovolts_g = 0;  /** < latest INA219 shunt voltage */
+
+/** An INA219 burst started with 'i' or 'I', see burstTask */
+#define BURST_SAMPLES (2000)
+uint32_t burstRemaining_g = 0;  /** < samples still to take */
+int32_t burstMin_g = 0;         /** < shunt voltage range and sum of the burst, uV */
+int32_t burstMax_g = 0;
+int64_t burstSum_g = 0;
+uint32_t dumpOffset_g = 0;      /** < flight recorder dump progress */
+uint32_t dumpLength_g = 0;
+uint32_t traceDumpIndex_g = 0;  /** < trace dump progress, in entries */
+uint32_t traceDumpCount_g = 0;
+
+/** Idle power policy started by setup() and 'z', see API_C2_Idle.h */
+idlePolicy_t idlePolicy_g = { IDLE_DOZE_AFTER_MS, IDLE_SLEEP_AFTER_MS, IDLE_DOZE_PERIOD_MS, 
+                              IDLE_SLEEP_PERIOD_MS, IDLE_SAMPLE_MS };
+
+/** Latency benchmark started with 'k', see API_C2_Latency.h: BTN1 in each
+    report mode at both I2C clocks, back to 400 kHz afterwards */
+latencyPlan_t latencyPlan_g = { 0, LATENCY_ITERATIONS, LATENCY_GAP_MS, LATENCY_JITTER_MS, 400000, 4,
+                                { { false, 400000 }, { false, 100000 }, { true, 400000 }, { true, 100000 } } };
+uint8_t latencyPrinted_g = 0;   /** < benchmark runs printed so far */
+
+/** Haptic patterns, see API_Haptic.h: a double click for a button press, a 
+    tap for a finger touching down and a light tick when the last one lifts */
+hapticPattern_t hapticPatterns_g[HAPTIC_EVENTS] = { { 15, 10, 2, 200 }, { 10, 0, 1, 120 }, { 5, 0, 1, 80 } };
+uint32_t lastReadUs_g = 0;      /** < when the last report read ended */
+
+/** USB HID passthrough's touch screen, see API_UsbHid.h: the pad's raw range 
+    (that of the host tools' synthetic reports) over the whole screen */
+mapConfig_t usbHidMap_g = { 0, 2047, 0, 1535, 0, true, false, false, MAP_ROTATE_0, 
+                            USB_HID_TOUCH_RANGE, USB_HID_TOUCH_RANGE, NULL, NULL };
+
+/** Registers the register watch starts with, see API_C2_Watch.h: feed config 1 
+    and compensation config (one burst), the register factory calibration polls, 
+    and persistent data control */
+typedef struct
+{
+  uint32_t address;
+  uint8_t  length;
+  uint16_t periodMs;
+} watchedRegister_t;
+
+watchedRegister_t watchList_g[] = { { REG_FEED_CONFIG_1, 1, 100 }, { 0xC2C7, 1, 100 }, 
+                                    { REG_VENDOR_ID, 1, 250 }, { 0xC2DF, 1, 250 } };
+
+/** Trace entries sent per STREAM_TYPE_TRACE_DATA frame */
+#define TRACE_DUMP_CHUNK (32)
+
+/** Startup timing, in micros() */
+uint32_t setupStartUs_g = 0;    /** < when setup() began */
+uint32_t padReadyUs_g = 0;      /** < when the pad first answered, after setupStartUs_g */
+uint32_t loopReadyUs_g = 0;     /** < when setup() handed over to the scheduler */
+uint32_t firstReportUs_g = 0;   /** < when the first report was read, 0 until then */
+uint8_t padReadyStatus_g = 0;   /** < API_C2_waitReady result */
+
+/** The work of loop(), highest priority first. Data Ready is checked before 
+    any other task runs. See API_Scheduler.h. */
+schedTask_t tasks_g[] =
+{
+  /* name         run            ready               period   deadline pending dueUs stats, times in us */
+  { "report",     reportTask,    reportWaiting,      0,       1000,    false,   0, {} },
+  { "events",     eventTask,     reportQueued,       0,       10000,   false,   0, {} },
+  { "idle",       idleTask,      idleWaiting,        0,       5000,    false,   0, {} },
+  { "latency",    latencyTask,   latencyWaiting,     0,       5000,    false,   0, {} },
+  { "burst",      burstTask,     burstWaiting,       0,       500,     false,   0, {} },
+  { "power",      powerTask,     INA219_busFree,     100000,  5000,    false,   0, {} },
+  { "stats",      statsTask,     statsWaiting,       0,       20000,   false,   0, {} },
+  { "output",     outputTask,    outputWaiting,      0,       20000,   false,   0, {} },
+  { "command",    commandTask,   commandWaiting,     0,       20000,   false,   0, {} },
+  { "watch",      watchTask,     watchWaiting,       0,       0,       false,   0, {} },
+  { "region",     regionTask,    regionWaiting,      0,       0,       false,   0, {} },
+  { "calibrate",  calibrateTask, calibrating,        5000,    0,       false,   0, {} },
+  { "dump",       dumpTask,      dumpWaiting,        0,       0,       false,   0, {} },
+  { "trace",      traceDumpTask, traceDumpWaiting,   0,       0,       false,   0, {} },
+};
+
+/** Startup does not wait for a USB host: output is queued (see OutputQueue.h) 
+    and sent once one is listening, so the board starts the same with or 
+    without a serial connection. Instead of fixed delays for power up and 
+    boot, the pad is polled until it answers (API_C2_waitReady). */
 void setup()
 {
+  setupStartUs_g = micros();
   Serial.begin(115200);
-  while(!Serial);
   
   API_Hardware_init();       //Initialize board hardware
   
   API_Hardware_PowerOn();    //Power up the board
-  delay(2);                  //delay for power up
   
   // initialize i2c connection at 400kHz 
   API_C2_init(400000, CIRQUE_SLAVE_ADDR); 
   
-  delay(50);                 //delay before reading registers after startup
-  
-  // Collect information about the system and print to Serial
+  // Wait for the pad to boot and collect information about the system in one read
   systemInfo_t sysInfo;
-  API_C2_readSystemInfo(&sysInfo);
-  printSystemInfo(&sysInfo);
+  padReadyStatus_g = API_C2_waitReady(&sysInfo, STARTUP_TIMEOUT_US);
+  padReadyUs_g = micros() - setupStartUs_g;
+  if(padReadyStatus_g == SUCCESS)
+  {
+    printSystemInfo(&sysInfo);
+    if(CONFIG_IDLE_ENABLE)
+    {
+      API_C2_initIdle(&idlePolicy_g, micros());
+    }
+  }
+  else
+  {
+    Output.print(F("Touchpad not responding, status 0x"));
+    Output.println(padReadyStatus_g, HEX);
+  }
+
+  for(uint8_t event = 0; event < HAPTIC_EVENTS; event++)
+  {
+    API_Haptic_setPattern(event, &hapticPatterns_g[event]);
+  }
+  API_Haptic_enable(CONFIG_HAPTIC_ENABLE);
+  API_UsbHid_setMap(&usbHidMap_g);
+  API_UsbHid_enable(CONFIG_USB_HID_ENABLE);
+  if(CONFIG_WATCH_ENABLE)
+  {
+    startWatch();
+  }
 
   initialize_saved_reports(); //initialize state for determining touch events
+  API_Stream_initParser(&commandParser_g);
+  API_Scheduler_init(tasks_g, sizeof(tasks_g) / sizeof(tasks_g[0]));
+  loopReadyUs_g = micros() - setupStartUs_g;
 }
 
 /** The main structure of the loop is: 
-    Wait for the Data Ready (DR) line to assert. When it does, read the data (which clears DR) and process the data.
-    The rest is just a user interface to change various settings.
+    Run the most important task that has work to do (see tasks_g). Servicing the 
+    Data Ready (DR) line comes first: when it asserts, the report is read (which 
+    clears DR) and queued. Everything else, printing, talking to the host, 
+    measuring power, is done in smaller steps by the other tasks so that none 
+    of them holds up the next report.
     */
 void loop()
 {
-  /* Handle incoming messages from module */
-  if(API_C2_DR_Asserted())          // When Data is ready
+  API_Scheduler_runOnce();
+}
+
+/******** Tasks ***********/
+
+/** Reads a report when DR asserts. If the queue is full the oldest report is 
+    dropped, but only once the new one has been read; DR must be serviced 
+    either way. */
+void reportTask()
+{
+  static queuedReport_t spare;  // read here while the queue is full, so a failed read drops nothing
+  TRACE_INSTANT(TRACE_ID_DR, 0);
+  bool full = reportQueueCount_g == REPORT_QUEUE_DEPTH;
+  queuedReport_t* entry = full ? &spare
+                               : &reportQueue_g[(reportQueueHead_g + reportQueueCount_g) % REPORT_QUEUE_DEPTH];
+  // the report was there from the DR edge, or from the last read if DR stayed asserted
+  uint32_t readyUs = HostDR_assertedUs();
+  if((int32_t)(lastReadUs_g - readyUs) > 0)
+  {
+    readyUs = lastReadUs_g;
+  }
+  entry->timestamp = micros();
+  if(API_C2_readReportPacket(entry->packet) != SUCCESS)    // read the report
+  {
+    reportErrors_g++;       // API_C2_reportWaiting holds off the retry for REPORT_RETRY_US
+    return;
+  }
+  lastReadUs_g = micros();
+  if(firstReportUs_g == 0)
+  {
+    firstReportUs_g = entry->timestamp - setupStartUs_g;
+  }
+  // haptics, USB passthrough, the register watch and the latency benchmark see 
+  // the report here rather than in eventTask, so queued reports do not delay them
+  reportView_t view;
+  API_C2_viewReport(entry->packet, &view);
+  API_Haptic_report(&view, readyUs);
+  API_UsbHid_report(entry->packet, readyUs);
+  API_C2_watchReport(readyUs, lastReadUs_g);
+  if(API_C2_latencyRunning())
+  {
+    API_C2_latencyReport(&view, lastReadUs_g);
+  }
+  if(full)
+  {
+    reportQueueHead_g = (reportQueueHead_g + 1) % REPORT_QUEUE_DEPTH;
+    reportQueueCount_g--;
+    reportsDropped_g++;
+    reportQueue_g[(reportQueueHead_g + reportQueueCount_g) % REPORT_QUEUE_DEPTH] = spare;
+  }
+  reportQueueCount_g++;
+}
+
+bool reportWaiting()
+{
+  return API_C2_reportWaiting(micros());
+}
+
+bool reportQueued()
+{
+  return reportQueueCount_g > 0;
+}
+
+/** Streams or prints the oldest queued report */
+void eventTask()
+{
+  queuedReport_t* entry = &reportQueue_g[reportQueueHead_g];
+  // keep the link for their results; passthrough has the reports on USB already
+  bool quiet = API_C2_statsRunning() || API_C2_latencyRunning() || API_UsbHid_enabled();
+  reportView_t view;
+  TRACE_BEGIN(TRACE_ID_DECODE, entry->packet[2]);
+  API_C2_viewReport(entry->packet, &view);
+  API_C2_idleReport(&view, entry->timestamp);
+  if(API_C2_statsRunning())
+  {
+      // only statsTask's summaries go to the host
+      API_C2_statsReport(&view, entry->timestamp);
+  }
+  else if(binaryStream_mode_g)
+  {
+      sendStreamFrame(STREAM_TYPE_REPORT, entry->timestamp, entry->packet, PACKET_SIZE);
+  }
+  /* Interpret report from module */
+  if(eventPrint_mode_g && !quiet)
+  {
+      printEvent(&view);
+  }
+  if(dataPrint_mode_g && !quiet)
+  {
+      // printing every field is the one place the whole report is needed
+      report_t report;
+      API_C2_decodeReport(entry->packet, &report);
+      printDataReport(&report);
+  }
+  TRACE_END(TRACE_ID_DECODE, entry->packet[2]);
+  reportQueueHead_g = (reportQueueHead_g + 1) % REPORT_QUEUE_DEPTH;
+  reportQueueCount_g--;
+}
+
+/** Samples the INA219 shunt voltage in two steps so the task never waits 
+    for the conversion: start it, then come back when it is done. */
+void powerTask()
+{
+  if(INA219_burstActive())
+  {
+    powerMeasuring_g = false;   // the burst owns the INA219 until it is done
+    return;
+  }
+  if(!powerMeasuring_g)
+  {
+    API_Scheduler_runAfter(INA219_startShuntMeasurement(CONFIG__SHUNT_ADC_AVERAGE_8));
+    powerMeasuring_g = true;
+  }
+  else
+  {
+    shuntMicrovolts_g = INA219_readShuntVoltage();
+    powerMeasuring_g = false;
+    API_C2_idleRecordShunt(shuntMicrovolts_g);
+  }
+}
+
+/** Starts and ends the idle policy's tracking samples, see API_C2_Idle.h */
+void idleTask()
+{
+  API_C2_idlePoll(micros());
+}
+
+bool idleWaiting()
+{
+  return API_C2_idleDue(micros());
+}
+
+/** Makes the latency benchmark's button edges and prints each run once it 
+    is done, see API_C2_Latency.h */
+void latencyTask()
+{
+  if(API_C2_latencyDue(micros()))
+  {
+    API_C2_latencyPoll(micros());
+  }
+  if(latencyPrinted_g < API_C2_latencyRunsDone())
   {
-    report_t report;
-    API_C2_getReport(&report);    // read the report
-    /* Interpret report from module */
-    if(eventPrint_mode_g)
+    printLatencyRun(latencyPrinted_g++);
+  }
+}
+
+bool latencyWaiting()
+{
+  return API_C2_latencyDue(micros()) || latencyPrinted_g < API_C2_latencyRunsDone();
+}
+
+/** Sends a touch statistics summary (see API_C2_Stats.h) once a window ends: 
+    a STREAM_TYPE_STATS frame when binary streaming, text otherwise */
+void statsTask()
+{
+  statsSummary_t summary;
+  API_C2_takeStatsSummary(&summary, micros());
+  if(binaryStream_mode_g)
+  {
+    uint8_t payload[STATS_SUMMARY_MAX_SIZE];
+    sendStreamFrame(STREAM_TYPE_STATS, micros(), payload, API_C2_encodeStatsSummary(&summary, payload));
+  }
+  else
+  {
+    printStatsSummary(&summary);
+  }
+}
+
+bool statsWaiting()
+{
+  return API_C2_statsDue(micros()) && Output.availableForWrite() >= STREAM_OVERHEAD + STATS_SUMMARY_MAX_SIZE;
+}
+
+/** Watches watchList_g, each register's first value its first event */
+void startWatch()
+{
+  for(uint8_t i = 0; i < sizeof(watchList_g) / sizeof(watchList_g[0]); i++)
+  {
+    API_C2_watchAdd(watchList_g[i].address, watchList_g[i].length, watchList_g[i].periodMs, micros());
+  }
+  API_C2_watchEnable(true);
+}
+
+/** Reads watched registers in the gaps between reports, and sends a change 
+    per run: a STREAM_TYPE_WATCH frame when binary streaming, text otherwise. 
+    See API_C2_Watch.h. */
+void watchTask()
+{
+  if(API_C2_watchDue(micros()))
+  {
+    API_C2_watchPoll(micros());
+  }
+  watchEvent_t event;
+  if(Output.availableForWrite() >= STREAM_OVERHEAD + WATCH_EVENT_SIZE && API_C2_takeWatchEvent(&event))
+  {
+    if(binaryStream_mode_g)
     {
-        printEvent(&report);
+      uint8_t payload[WATCH_EVENT_SIZE];
+      sendStreamFrame(STREAM_TYPE_WATCH, event.timestamp, payload, API_C2_encodeWatchEvent(&event, payload));
     }
-    if(dataPrint_mode_g)
+    else
+    {
+      printWatchEvent(&event);
+    }
+  }
+}
+
+bool watchWaiting()
+{
+  return API_C2_watchDue(micros()) 
+         || (API_C2_watchEventPending() && Output.availableForWrite() >= STREAM_OVERHEAD + WATCH_EVENT_SIZE);
+}
+
+/** Starts a burst of BURST_SAMPLES back-to-back shunt voltage samples with 
+    the given CONFIG__SHUNT_ADC_ setting (see INA219_startBurst) */
+void startBurst(uint16_t adcMask)
+{
+  burstRemaining_g = BURST_SAMPLES;
+  burstMin_g = INT32_MAX;
+  burstMax_g = INT32_MIN;
+  burstSum_g = 0;
+  INA219_startBurst(adcMask);
+}
+
+/** Takes the next burst sample, and prints the result after the last one, 
+    or once the driver ended the burst because the INA219 stopped answering */
+void burstTask()
+{
+  int32_t sample;
+  if(INA219_readBurst(&sample))
+  {
+    burstMin_g = sample < burstMin_g ? sample : burstMin_g;
+    burstMax_g = sample > burstMax_g ? sample : burstMax_g;
+    burstSum_g += sample;
+    burstRemaining_g--;
+  }
+  else if(INA219_burstActive())
+  {
+    return;
+  }
+  if(burstRemaining_g == 0 || !INA219_burstActive())
+  {
+    burstRemaining_g = 0;
+    ina219BurstStats_t stats;
+    INA219_getBurstStats(&stats);
+    INA219_stopBurst();
+    printBurstStats(&stats);
+  }
+}
+
+bool burstWaiting()
+{
+  return burstRemaining_g > 0 && (!INA219_burstActive() || (INA219_burstDue() && INA219_busFree()));
+}
+
+/** Moves queued output to USB serial, as much as it takes without blocking */
+void outputTask()
+{
+  TRACE_BEGIN(TRACE_ID_OUTPUT, 0);
+  uint16_t moved = Output.drain(Serial, Serial.availableForWrite());
+  TRACE_END(TRACE_ID_OUTPUT, moved);
+  (void)moved;
+}
+
+bool outputWaiting()
+{
+  return Output.queued() > 0 && Serial.availableForWrite() > 0;
+}
+
+/** Handles one binary command frame or one menu character from the host */
+void commandTask()
+{
+  /* Handle binary commands from host tools. A frame starts with STREAM_SYNC_0, 
+     which is not a menu character. One command is run per pass so reports 
+     keep flowing while a host has many commands queued. */
+  while(Serial.available() && (commandParser_g.index != 0 || Serial.peek() == STREAM_SYNC_0))
+  {
+    if(API_Stream_parseByte(&commandParser_g, Serial.read()) && commandParser_g.frame.type == STREAM_TYPE_COMMAND)
     {
-        printDataReport(&report);
+      static uint8_t response[STREAM_MAX_PAYLOAD];
+      uint16_t length = API_Command_execute(commandParser_g.frame.payload, commandParser_g.frame.length, response);
+      if(length > 0)
+      {
+        sendStreamFrame(STREAM_TYPE_RESPONSE, micros(), response, length);
+      }
+      return;
     }
   }
   
   /* Handle incoming messages from user on serial */
-  if(Serial.available())
+  if(Serial.available() && commandParser_g.index == 0 && Serial.peek() != STREAM_SYNC_0)
   {
     char rxChar = Serial.read();
     switch(rxChar)
     {
       case 'c':
-          Serial.println(F("Compensation Forced"));
+          Output.println(F("Compensation Forced"));
           API_C2_forceComp();
           break;
           
       case 'C':
-          Serial.println(F("Factory Calibrate... "));
-          if(API_C2_factoryCalibrate())
-          {
-              Serial.println(F("Done"));
-          }
-          else
-          {
-              Serial.println(F("Failed")); //Hardware timeout (Did the module disconnect?) 
-          }
+          Output.println(F("Factory Calibrate... "));
+          API_C2_startFactoryCalibrate();   // calibrateTask reports the result
+          calibrating_g = true;
           break;
           
       case 'f':
-          Serial.println(F("Feed Enabled"));
+          Output.println(F("Feed Enabled"));
           API_C2_enableFeed();
           break;
           
       case 'F':
-          Serial.println(F("Feed Disabled"));
+          Output.println(F("Feed Disabled"));
           API_C2_disableFeed();
           break;
           
       case 'a':
-          Serial.println(F("Absolute Mode Set"));
+          Output.println(F("Absolute Mode Set"));
           API_C2_setCRQ_AbsoluteMode();
           break;
           
       case 'r':
-          Serial.println(F("Relative Mode Set"));
+          Output.println(F("Relative Mode Set"));
           API_C2_setRelativeMode();
           break;
           
@@ -105,49 +515,155 @@ void loop()
           break;
           
       case 'p':
-          Serial.println(F("Settings saved to flash"));
+          Output.println(F("Settings saved to flash"));
           API_C2_persistToFlash();
           break;
           
       case 't':
-          Serial.println(F("Tracking Enabled"));
+          Output.println(F("Tracking Enabled (Idle Policy off)"));
+          API_C2_stopIdle(micros());    // or it would turn tracking off again
           API_C2_enableTracking();
           break;
           
       case 'T':
-          Serial.println(F("Tracking Disabled"));
+          Output.println(F("Tracking Disabled (Idle Policy off)"));
+          API_C2_stopIdle(micros());    // or it would turn tracking back on
           API_C2_disableTracking();
           break;
           
+      case 'z':
+          Output.println(F("Idle Policy turned on"));
+          API_C2_initIdle(&idlePolicy_g, micros());
+          break;
+          
+      case 'Z':
+          Output.println(F("Idle Policy turned off"));
+          API_C2_stopIdle(micros());
+          break;
+          
       case 'v':
-          Serial.println(F("Compensation Enabled"));
+          Output.println(F("Compensation Enabled"));
           API_C2_enableComp();
           break;
           
       case 'V':
-          Serial.println(F("Compensation Disabled"));
+          Output.println(F("Compensation Disabled"));
           API_C2_disableComp();
           break;
           
       //Print modes
       case 'd':
-          Serial.println(F("Data Printing turned on"));
+          Output.println(F("Data Printing turned on"));
           dataPrint_mode_g = true;
           break;
           
       case 'D':
-          Serial.println(F("Data Printing turned off"));
+          Output.println(F("Data Printing turned off"));
           dataPrint_mode_g = false;
           break;
           
       case 'e':
-          Serial.println(F("Event Printing turned on"));
+          Output.println(F("Event Printing turned on"));
           eventPrint_mode_g = true;
           break;
           
       case 'E':
-          Serial.println(F("Event Printing turned off"));
+          Output.println(F("Event Printing turned off"));
+          eventPrint_mode_g = false;
+          break;
+          
+      case 'b':
+          Output.println(F("Binary Streaming turned on"));
+          dataPrint_mode_g = false;   // keep the link free for frames
           eventPrint_mode_g = false;
+          binaryStream_mode_g = true;
+          break;
+          
+      case 'B':
+          binaryStream_mode_g = false;
+          Output.println(F("Binary Streaming turned off"));
+          break;
+          
+      case 'm':
+          Output.println(F("Touch Statistics turned on (replaces Data, Event and report streaming)"));
+          API_C2_startStats(STATS_INTERVAL_MS, micros());
+          break;
+          
+      case 'M':
+          API_C2_stopStats();
+          Output.println(F("Touch Statistics turned off"));
+          break;
+          
+      case 'k':
+          Output.println(F("Latency Benchmark on BTN1 (Idle Policy off, 'K' stops)"));
+          API_C2_stopIdle(micros());    // tracking must stay on for the presses
+          latencyPrinted_g = 0;
+          API_C2_startLatency(&latencyPlan_g, micros());
+          break;
+          
+      case 'K':
+          API_C2_stopLatency();
+          Output.println(F("Latency Benchmark stopped"));
+          break;
+          
+      case 'g':
+          Output.println(F("Haptics on"));
+          API_Haptic_enable(true);
+          break;
+          
+      case 'G':
+          Output.println(F("Haptics off"));
+          API_Haptic_enable(false);
+          break;
+          
+      case 'u':
+          Output.println(F("USB HID Passthrough on (Data and Event Printing paused)"));
+          API_UsbHid_enable(true);
+          break;
+          
+      case 'U':
+          Output.println(F("USB HID Passthrough off"));
+          API_UsbHid_enable(false);
+          break;
+          
+      case 'w':
+          Output.println(F("Register Watch on"));
+          startWatch();
+          break;
+          
+      case 'W':
+          Output.println(F("Register Watch off"));
+          API_C2_watchEnable(false);
+          break;
+          
+      case 'l':
+          Output.println(F("Flight Recorder Dump"));
+          startFlightRecorderDump();
+          break;
+          
+      case 'x':
+          Output.println(F("Trace Dump"));
+          startTraceDump();
+          break;
+          
+      case 'i':
+          Output.println(F("Current Burst (12 bit)"));
+          startBurst(CONFIG__SHUNT_ADC_RES_12);
+          break;
+          
+      case 'I':
+          Output.println(F("Current Burst (9 bit)"));
+          startBurst(CONFIG__SHUNT_ADC_RES_9);
+          break;
+          
+      case 'S':
+          printTaskStats();
+          API_Scheduler_resetStats();
+          API_Bus_resetStats();
+          API_C2_resetIdleStats(micros());
+          API_Haptic_resetStats();
+          API_UsbHid_resetStats();
+          API_C2_resetWatchStats();
           break;
       
       case '?':
@@ -160,225 +676,783 @@ void loop()
   }
 }
 
+bool commandWaiting()
+{
+  return Serial.available() > 0;
+}
+
+/** Sends the next chunk of a READ_REGION command (see API_Command.h). Each run 
+    reads one chunk, so a report is never held up by more than one chunk, and 
+    the USB port sends the frame queued by the last run while this one reads. */
+void regionTask()
+{
+  static uint8_t payload[COMMAND_REGION_HEADER + REGION_MAX_CHUNK];
+  uint16_t length = API_Command_nextRegionFrame(payload);
+  sendStreamFrame(STREAM_TYPE_REGION_DATA, micros(), payload, length);
+}
+
+bool regionWaiting()
+{
+  return API_Command_regionPending() 
+         && Output.availableForWrite() >= STREAM_OVERHEAD + COMMAND_REGION_HEADER + REGION_MAX_CHUNK;
+}
+
+/** Advances a factory calibration started with 'C' */
+void calibrateTask()
+{
+  uint8_t result = API_C2_pollFactoryCalibrate();
+  if(result == CALIBRATE_DONE)
+  {
+      Output.println(F("Done"));
+  }
+  else if(result == CALIBRATE_FAILED)
+  {
+      Output.println(F("Failed")); //Hardware timeout (Did the module disconnect?) 
+  }
+  calibrating_g = (result == CALIBRATE_BUSY);
+}
+
+bool calibrating()
+{
+  return calibrating_g;
+}
+
 /******** Functions for Printing Data ***********/
 
 /** Prints a simple table of available commands.
     Commands can be sent over serial through Serial Monitor in Arduino IDE*/
 void printHelpTable()
 {
-  Serial.println(F("Available Commands (case sensitive)"));
-  Serial.println(F(""));
-  Serial.println(F("c\t-\tForce Compensation"));
-  Serial.println(F("C\t-\tFactory Calibrate"));
-  Serial.println(F("f\t-\tEnable Feed (default)"));
-  Serial.println(F("F\t-\tDisable Feed"));
-  Serial.println(F("a\t-\tSet to Absolute Mode"));
-  Serial.println(F("r\t-\tSet to Relative Mode (default)"));
-  Serial.println(F("p\t-\tPersist Settings to Flash"));
-  Serial.println(F("s\t-\tPrint System Info"));
-  Serial.println(F("t\t-\tEnable Tracking (default)"));
-  Serial.println(F("T\t-\tDisable Tracking"));
+  Output.println(F("Available Commands (case sensitive)"));
+  Output.println(F(""));
+  Output.println(F("c\t-\tForce Compensation"));
+  Output.println(F("C\t-\tFactory Calibrate"));
+  Output.println(F("f\t-\tEnable Feed (default)"));
+  Output.println(F("F\t-\tDisable Feed"));
+  Output.println(F("a\t-\tSet to Absolute Mode"));
+  Output.println(F("r\t-\tSet to Relative Mode (default)"));
+  Output.println(F("p\t-\tPersist Settings to Flash"));
+  Output.println(F("s\t-\tPrint System Info"));
+  Output.println(F("t\t-\tEnable Tracking (default; turns off the Idle Policy)"));
+  Output.println(F("T\t-\tDisable Tracking (turns off the Idle Policy)"));
+  Output.println(F("z\t-\tTurn on the Idle Policy: sample tracking when untouched"));
+  Output.println(F("Z\t-\tTurn off the Idle Policy"));
   
-  Serial.println(F("v\t-\tEnable Compensation (default)"));
-  Serial.println(F("V\t-\tDisable Compensation"));
-  Serial.println(F(""));
-  Serial.println(F("h, H, ?\t-\tPrint this Table"));
-  Serial.println(F("d\t-\tTurn on Data Printing (default)"));
-  Serial.println(F("D\t-\tTurn off Data Printing "));
-  Serial.println(F("e\t-\tTurn on Event Printing (default)"));
-  Serial.println(F("E\t-\tTurn off Event Printing "));
-  Serial.println(F(""));
+  Output.println(F("v\t-\tEnable Compensation (default)"));
+  Output.println(F("V\t-\tDisable Compensation"));
+  Output.println(F(""));
+  Output.println(F("h, H, ?\t-\tPrint this Table"));
+  Output.println(F("d\t-\tTurn on Data Printing (default)"));
+  Output.println(F("D\t-\tTurn off Data Printing "));
+  Output.println(F("e\t-\tTurn on Event Printing (default)"));
+  Output.println(F("E\t-\tTurn off Event Printing "));
+  Output.println(F("b\t-\tTurn on Binary Streaming (turns off Data and Event Printing)"));
+  Output.println(F("B\t-\tTurn off Binary Streaming (default)"));
+  Output.println(F("m\t-\tTurn on Touch Statistics: a summary a second instead of every report"));
+  Output.println(F("M\t-\tTurn off Touch Statistics (default)"));
+  Output.println(F("k\t-\tLatency Benchmark: BTN1 press to report, per report mode and I2C clock"));
+  Output.println(F("K\t-\tStop the Latency Benchmark"));
+  Output.println(F("g\t-\tTurn on Haptics: pulses for button presses, touch down and lift"));
+  Output.println(F("G\t-\tTurn off Haptics (default)"));
+  Output.println(F("u\t-\tTurn on USB HID Passthrough: reports sent on as USB mouse, keyboard, touch screen"));
+  Output.println(F("U\t-\tTurn off USB HID Passthrough (default)"));
+  Output.println(F("w\t-\tTurn on the Register Watch: status registers read between reports, changes printed"));
+  Output.println(F("W\t-\tTurn off the Register Watch (default)"));
+  Output.println(F("l\t-\tDump Flight Recorder (binary, read with gen4flight)"));
+  Output.println(F("x\t-\tDump Trace Points (binary, read with gen4trace; needs CONFIG_TRACE_ENABLE)"));
+  Output.println(F("S\t-\tPrint Task Statistics (run times, deadline misses) and reset them"));
+  Output.println(F("i\t-\tCurrent Burst: 2000 back-to-back 12 bit shunt samples, print samples/sec"));
+  Output.println(F("I\t-\tCurrent Burst at 9 bits (fastest)"));
+  Output.println(F("0xA5\t-\tStart of a binary command frame (see API_Command.h, use gen4cmd)"));
+  Output.println(F(""));
+}
+
+/** Queues one API_Stream frame for Serial. Host tools (see Gen4HostTools) 
+    pick these frames out of the serial stream. A frame that does not fit in 
+    the output queue is dropped whole. */
+void sendStreamFrame(uint8_t type, uint32_t timestamp, const uint8_t* payload, uint16_t length)
+{
+  static uint8_t frame[STREAM_MAX_FRAME];
+  uint16_t frameLength = API_Stream_encodeFrame(type, timestamp, payload, length, frame);
+  Output.writeAll(frame, frameLength);
+}
+
+/** Starts sending the flight recorder history (see API_Recorder.h) as API_Stream 
+    frames: a STREAM_TYPE_RECORDER_INFO header, then STREAM_TYPE_RECORDER_DATA 
+    chunks of record bytes, oldest first, sent by dumpTask as the output queue 
+    has room. Nothing is recorded while the dump runs. */
+void startFlightRecorderDump()
+{
+  uint8_t info[RECORDER_DUMP_INFO_SIZE];
+  
+  API_Recorder_enable(false);
+  dumpOffset_g = 0;
+  dumpLength_g = API_Recorder_getLength();
+  sendStreamFrame(STREAM_TYPE_RECORDER_INFO, micros(), info, API_Recorder_encodeDumpInfo(info));
+  if(dumpLength_g == 0)
+  {
+    API_Recorder_enable(true);
+  }
+}
+
+/** Sends the next chunk of a flight recorder dump */
+void dumpTask()
+{
+  uint8_t chunk[4 + 256];
+  
+  chunk[0] = (uint8_t)(dumpOffset_g & 0x000000FF);
+  chunk[1] = (uint8_t)((dumpOffset_g & 0x0000FF00) >> 8);
+  chunk[2] = (uint8_t)((dumpOffset_g & 0x00FF0000) >> 16);
+  chunk[3] = (uint8_t)((dumpOffset_g & 0xFF000000) >> 24);
+  uint16_t count = API_Recorder_copy(dumpOffset_g, &chunk[4], 256);
+  sendStreamFrame(STREAM_TYPE_RECORDER_DATA, micros(), chunk, 4 + count);
+  dumpOffset_g += count;
+  if(dumpOffset_g >= dumpLength_g)
+  {
+    API_Recorder_enable(true);
+  }
+}
+
+bool dumpWaiting()
+{
+  return dumpOffset_g < dumpLength_g && Output.availableForWrite() >= STREAM_OVERHEAD + 4 + 256;
+}
+
+/** Starts sending the trace points (see API_Trace.h) as API_Stream frames: a 
+    STREAM_TYPE_TRACE_INFO header, then STREAM_TYPE_TRACE_DATA chunks of 
+    entries, oldest first, sent by traceDumpTask as the output queue has room. 
+    Nothing is traced while the dump runs. With tracing compiled out the 
+    header says there are no entries. */
+void startTraceDump()
+{
+  uint8_t info[TRACE_DUMP_INFO_SIZE];
+  
+  if(!CONFIG_TRACE_ENABLE)
+  {
+    Output.println(F("Tracing is off, set CONFIG_TRACE_ENABLE in Project_Config.h"));
+  }
+  API_Trace_enable(false);
+  traceDumpIndex_g = 0;
+  traceDumpCount_g = API_Trace_getCount();
+  sendStreamFrame(STREAM_TYPE_TRACE_INFO, micros(), info, API_Trace_encodeDumpInfo(info));
+  if(traceDumpCount_g == 0)
+  {
+    API_Trace_enable(true);
+  }
+}
+
+/** Sends the next chunk of a trace dump. Tracing restarts empty after the 
+    last one, so each dump covers the time since the one before. */
+void traceDumpTask()
+{
+  uint8_t chunk[4 + TRACE_DUMP_CHUNK * TRACE_ENTRY_SIZE];
+  
+  chunk[0] = (uint8_t)(traceDumpIndex_g & 0x000000FF);
+  chunk[1] = (uint8_t)((traceDumpIndex_g & 0x0000FF00) >> 8);
+  chunk[2] = (uint8_t)((traceDumpIndex_g & 0x00FF0000) >> 16);
+  chunk[3] = (uint8_t)((traceDumpIndex_g & 0xFF000000) >> 24);
+  uint16_t length = API_Trace_copy(traceDumpIndex_g, &chunk[4], TRACE_DUMP_CHUNK);
+  sendStreamFrame(STREAM_TYPE_TRACE_DATA, micros(), chunk, 4 + length);
+  traceDumpIndex_g += length / TRACE_ENTRY_SIZE;
+  if(traceDumpIndex_g >= traceDumpCount_g)
+  {
+    API_Trace_clear();
+    API_Trace_enable(true);
+  }
+}
+
+bool traceDumpWaiting()
+{
+  return traceDumpIndex_g < traceDumpCount_g 
+         && Output.availableForWrite() >= STREAM_OVERHEAD + 4 + TRACE_DUMP_CHUNK * TRACE_ENTRY_SIZE;
+}
+
+/** Prints each task's run count, run times, longest wait and deadline misses 
+    since the last call, see API_Scheduler.h */
+void printTaskStats()
+{
+  Output.println(F("Task		Runs	Avg us	Max us	Max wait us	Missed deadlines"));
+  for(uint8_t i = 0; i < API_Scheduler_getTaskCount(); i++)
+  {
+    const schedTask_t* task = API_Scheduler_getTask(i);
+    const schedStats_t* stats = &task->stats;
+    Output.print(task->name);
+    Output.print(F("\t\t"));
+    Output.print((unsigned long)stats->runs);
+    Output.print(F("\t"));
+    Output.print((unsigned long)(stats->runs ? stats->totalRunUs / stats->runs : 0));
+    Output.print(F("\t"));
+    Output.print((unsigned long)stats->maxRunUs);
+    Output.print(F("\t"));
+    Output.print((unsigned long)stats->maxLatencyUs);
+    Output.print(F("\t\t"));
+    Output.println((unsigned long)stats->misses);
+  }
+  Output.print(F("Reports dropped:\t"));
+  Output.println((unsigned long)reportsDropped_g);
+  Output.print(F("Report read errors:\t"));
+  Output.println((unsigned long)reportErrors_g);
+  Output.print(F("I2C bus recoveries:\t"));
+  Output.println((unsigned long)I2C_getRecoveryCount());
+  Output.print(F("Output bytes dropped:\t"));
+  Output.println((unsigned long)Output.droppedBytes);
+  Output.print(F("Shunt voltage (uV):\t"));
+  Output.println((long)shuntMicrovolts_g);
+  Output.print(F("INA219 read errors:\t"));
+  Output.println((unsigned long)INA219_getErrorCount());
+  printBusStats();
+  printIdleStats();
+  printHapticStats();
+  printUsbHidStats();
+  printWatchStats();
+  printStartupTimes();
+  Output.println(F(""));
+}
+
+/** Prints each device's time on the shared I2C bus since the last reset, 
+    see API_Bus.h. Deferred counts operations put off for the touchpad. */
+void printBusStats()
+{
+  Output.println(F("Bus device	Ops	Avg us	Max us	Total ms	Deferred	Clock changes"));
+  for(uint8_t i = 0; i < API_Bus_getDeviceCount(); i++)
+  {
+    const busDevice_t* device = API_Bus_getDevice(i);
+    const busStats_t* stats = &device->stats;
+    Output.print(device->name);
+    Output.print(F("\t\t"));
+    Output.print((unsigned long)stats->operations);
+    Output.print(F("\t"));
+    Output.print((unsigned long)(stats->operations ? stats->totalUs / stats->operations : 0));
+    Output.print(F("\t"));
+    Output.print((unsigned long)stats->maxUs);
+    Output.print(F("\t"));
+    Output.print((unsigned long)(stats->totalUs / 1000));
+    Output.print(F("\t\t"));
+    Output.print((unsigned long)stats->deferrals);
+    Output.print(F("\t\t"));
+    Output.println((unsigned long)stats->clockChanges);
+  }
+}
+
+/** Prints the idle policy's time, shunt voltage and entries per state since 
+    the last reset, the energy saved against tracking the whole time, and 
+    how long touches waited to wake the pad, see API_C2_Idle.h */
+void printIdleStats()
+{
+  static const char* const names[IDLE_STATES] = { "active", "doze", "sleep" };
+  const idleStats_t* stats = API_C2_getIdleStats(micros());
+  
+  Output.print(F("Idle policy:\t\t"));
+  Output.println(API_C2_idleRunning() ? F("on") : F("off"));
+  Output.println(F("Idle state	Time ms	Shunt uV	Entries	Wake bound ms"));
+  for(uint8_t state = 0; state < IDLE_STATES; state++)
+  {
+    Output.print(names[state]);
+    Output.print(F("\t\t"));
+    Output.print((unsigned long)(stats->timeUs[state] / 1000));
+    Output.print(F("\t"));
+    Output.print((long)API_C2_idleMeanShunt(stats, state));
+    Output.print(F("\t\t"));
+    Output.print((unsigned long)stats->entries[state]);
+    Output.print(F("\t"));
+    Output.println((unsigned long)(API_C2_idleWakeBoundUs(state) / 1000));
+  }
+  int32_t saved = API_C2_idleSavedPermille(stats);
+  Output.print(F("Energy saved (%):\t"));
+  if(saved < 0)
+  {
+    Output.print(F("-"));
+    saved = -saved;
+  }
+  Output.print((long)(saved / 10));
+  Output.print(F("."));
+  Output.println((long)(saved % 10));
+  Output.print(F("Wakes:\t\t\t"));
+  Output.println((unsigned long)stats->wakes);
+  Output.print(F("Wake latency avg/max (us):\t"));
+  Output.print((unsigned long)(stats->wakes ? stats->totalWakeUs / stats->wakes : 0));
+  Output.print(F("/"));
+  Output.println((unsigned long)stats->maxWakeUs);
+  Output.print(F("Resume max (us):\t"));
+  Output.println((unsigned long)stats->maxResumeUs);
+}
+
+/** Prints the haptic patterns started since the last reset, and the time 
+    from Data Ready asserting to the motor turning on, see API_Haptic.h */
+void printHapticStats()
+{
+  const hapticStats_t* stats = API_Haptic_getStats();
+  
+  Output.print(F("Haptics:\t\t"));
+  Output.println(API_Haptic_enabled() ? F("on") : F("off"));
+  Output.print(F("Pulses press/contact/lift:\t"));
+  Output.print((unsigned long)stats->triggers[HAPTIC_EVENT_PRESS]);
+  Output.print(F("/"));
+  Output.print((unsigned long)stats->triggers[HAPTIC_EVENT_CONTACT]);
+  Output.print(F("/"));
+  Output.print((unsigned long)stats->triggers[HAPTIC_EVENT_LIFT]);
+  Output.print(F(" ("));
+  Output.print((unsigned long)stats->restarts);
+  Output.println(F(" cut short)"));
+  Output.print(F("Haptic latency min/avg/max (us):\t"));
+  Output.print((unsigned long)stats->minUs);
+  Output.print(F("/"));
+  Output.print((unsigned long)API_Haptic_meanLatencyUs(stats));
+  Output.print(F("/"));
+  Output.println((unsigned long)stats->maxUs);
+}
+
+/** Prints the register watch's reads since the last reset: how many bursts 
+    and what they cost the reports whose Data Ready asserted during one, see 
+    API_C2_Watch.h */
+void printWatchStats()
+{
+  const watchStats_t* stats = API_C2_getWatchStats();
+  
+  Output.print(F("Register Watch:\t\t"));
+  Output.println(API_C2_watchEnabled() ? F("on") : F("off"));
+  Output.print(F("Watch bursts/registers/bytes:\t"));
+  Output.print((unsigned long)stats->bursts);
+  Output.print(F("/"));
+  Output.print((unsigned long)stats->registers);
+  Output.print(F("/"));
+  Output.print((unsigned long)stats->bytes);
+  Output.print(F(" ("));
+  Output.print((unsigned long)stats->errors);
+  Output.print(F(" failed, "));
+  Output.print((unsigned long)stats->deferrals);
+  Output.println(F(" waits for a gap)"));
+  Output.print(F("Watch changes:\t\t"));
+  Output.print((unsigned long)stats->changes);
+  Output.print(F(" ("));
+  Output.print((unsigned long)stats->eventsDropped);
+  Output.println(F(" dropped)"));
+  Output.print(F("Watch max late/burst (us):\t"));
+  Output.print((unsigned long)stats->maxLateUs);
+  Output.print(F("/"));
+  Output.println((unsigned long)stats->maxBurstUs);
+  Output.print(F("Reports delayed by watch:\t"));
+  Output.print((unsigned long)stats->reportsDelayed);
+  Output.print(F(", avg/max (us) "));
+  Output.print((unsigned long)API_C2_watchMeanDelayUs(stats));
+  Output.print(F("/"));
+  Output.print((unsigned long)stats->maxDelayUs);
+  Output.print(F(", "));
+  Output.print((unsigned long)stats->overCap);
+  Output.println(F(" over the cap"));
+}
+
+/** Prints a watched register's change: its address, the old value and the new */
+void printWatchEvent(const watchEvent_t* event)
+{
+  Output.print(F("Watch 0x"));
+  Output.print(event->address, HEX);
+  Output.print(F(":\t"));
+  if(!(event->flags & WATCH_EVENT_FIRST))
+  {
+    Output.print(F("0x"));
+    Output.print(event->previous, HEX);
+    Output.print(F(" -> "));
+  }
+  Output.print(F("0x"));
+  Output.println(event->value, HEX);
+}
+
+/** Prints the reports USB HID passthrough has sent since the last reset, the 
+    time from Data Ready asserting to them being handed to USB, and the time 
+    passthrough added to each report read, see API_UsbHid.h */
+void printUsbHidStats()
+{
+  const usbHidStats_t* stats = API_UsbHid_getStats();
+  
+  Output.print(F("USB HID Passthrough:\t"));
+  Output.println(API_UsbHid_enabled() ? F("on") : F("off"));
+  Output.print(F("Sent mouse/keyboard/touch:\t"));
+  Output.print((unsigned long)stats->sent[USB_HID_MOUSE]);
+  Output.print(F("/"));
+  Output.print((unsigned long)stats->sent[USB_HID_KEYBOARD]);
+  Output.print(F("/"));
+  Output.print((unsigned long)stats->sent[USB_HID_TOUCH]);
+  Output.print(F(" ("));
+  Output.print((unsigned long)stats->unchanged);
+  Output.print(F(" unchanged, "));
+  Output.print((unsigned long)stats->unsupported);
+  Output.println(F(" not in the USB Type)"));
+  Output.print(F("USB latency min/avg/max (us):\t"));
+  Output.print((unsigned long)stats->minUs);
+  Output.print(F("/"));
+  Output.print((unsigned long)API_UsbHid_meanLatencyUs(stats));
+  Output.print(F("/"));
+  Output.println((unsigned long)stats->maxUs);
+  Output.print(F("USB added avg/max (us):\t"));
+  Output.print((unsigned long)API_UsbHid_meanCostUs(stats));
+  Output.print(F("/"));
+  Output.println((unsigned long)stats->maxCostUs);
+}
+
+/** Prints a touch statistics summary: the report intervals of the window, 
+    then a line per finger. Noise is the standard deviation while the 
+    finger was still, in counts. */
+void printStatsSummary(const statsSummary_t* summary)
+{
+  Output.print(F("Stats "));
+  Output.print((unsigned long)summary->windowMs);
+  Output.print(F(" ms: "));
+  Output.print(summary->reports);
+  Output.print(F(" reports, interval "));
+  Output.print((unsigned long)summary->intervalMinUs);
+  Output.print(F("-"));
+  Output.print((unsigned long)summary->intervalMaxUs);
+  Output.print(F(" us, pauses "));
+  Output.println(summary->pauses);
+  Output.print(F("Interval ms <2,2-4,..,>=128:"));
+  for(uint8_t b = 0; b < STATS_INTERVAL_BUCKETS; b++)
+  {
+    Output.print(F(" "));
+    Output.print(summary->histogram[b]);
+  }
+  Output.println(F(""));
+  for(uint8_t i = 0; i < STATS_FINGERS; i++)
+  {
+    const statsFinger_t* finger = &summary->fingers[i];
+    if(!(summary->fingerMask & (1 << i)))
+    {
+      continue;
+    }
+    Output.print(F("F"));
+    Output.print(i);
+    Output.print(F(" samples "));
+    Output.print(finger->samples);
+    Output.print(F(" palm "));
+    Output.print(finger->palmRejected);
+    Output.print(F(" lowconf "));
+    Output.print(finger->lowConfidence);
+    Output.print(F(" contacts "));
+    Output.print(finger->contacts);
+    Output.print(F(" avg/max ms "));
+    Output.print(finger->contactMsAvg);
+    Output.print(F("/"));
+    Output.print(finger->contactMsMax);
+    Output.print(F(" still "));
+    Output.print(finger->stillSamples);
+    Output.print(F(" at "));
+    Output.print(finger->meanX);
+    Output.print(F(","));
+    Output.print(finger->meanY);
+    Output.print(F(" noise "));
+    printFixed8(finger->noiseX);
+    Output.print(F(","));
+    printFixed8(finger->noiseY);
+    Output.println(F(""));
+  }
+}
+
+/** Prints a value in 1/256ths with two decimals */
+void printFixed8(uint16_t value)
+{
+  uint16_t hundredths = (uint16_t)(((uint32_t)(value & 0xFF) * 100 + 128) >> 8);
+  uint16_t whole = value >> 8;
+  if(hundredths == 100)
+  {
+    whole++;
+    hundredths = 0;
+  }
+  Output.print(whole);
+  Output.print(hundredths < 10 ? F(".0") : F("."));
+  Output.print(hundredths);
+}
+
+/** Prints a latency benchmark run: the spread of the time from the BTN1 
+    edge to the report with the button, then the histogram from its first 
+    to its last non-empty bucket */
+void printLatencyRun(uint8_t run)
+{
+  const latencyRun_t* config = API_C2_getLatencyRun(run);
+  const latencyStats_t* stats = API_C2_getLatencyStats(run);
+  Output.print(config->absolute ? F("Latency absolute ") : F("Latency relative "));
+  Output.print((unsigned long)(config->clockHz / 1000));
+  Output.print(F(" kHz: "));
+  Output.print(stats->samples);
+  Output.print(F(" presses, "));
+  Output.print(stats->timeouts);
+  Output.print(F(" timeouts, us min "));
+  Output.print((unsigned long)stats->minUs);
+  Output.print(F(" mean "));
+  Output.print((unsigned long)API_C2_latencyMeanUs(stats));
+  Output.print(F(" p50 "));
+  Output.print((unsigned long)API_C2_latencyPercentileUs(stats, 500));
+  Output.print(F(" p90 "));
+  Output.print((unsigned long)API_C2_latencyPercentileUs(stats, 900));
+  Output.print(F(" p99 "));
+  Output.print((unsigned long)API_C2_latencyPercentileUs(stats, 990));
+  Output.print(F(" max "));
+  Output.println((unsigned long)stats->maxUs);
+  uint8_t first = LATENCY_BUCKETS, last = 0;
+  for(uint8_t b = 0; b < LATENCY_BUCKETS; b++)
+  {
+    if(stats->histogram[b] != 0)
+    {
+      first = (first == LATENCY_BUCKETS) ? b : first;
+      last = b;
+    }
+  }
+  if(first == LATENCY_BUCKETS)
+  {
+    return;
+  }
+  Output.print(F("Histogram from "));
+  Output.print((unsigned long)first * LATENCY_BUCKET_US);
+  Output.print(F(" us by "));
+  Output.print(LATENCY_BUCKET_US);
+  Output.print(F(" us:"));
+  for(uint8_t b = first; b <= last; b++)
+  {
+    Output.print(F(" "));
+    Output.print(stats->histogram[b]);
+  }
+  Output.println(F(""));
+}
+
+/** Prints the result of a burst: the rate achieved against the rate the 
+    ADC setting allows, conversions missed and the shunt voltage seen */
+void printBurstStats(const ina219BurstStats_t* stats)
+{
+  Output.print(F("Samples:\t\t"));
+  Output.println((unsigned long)stats->samples);
+  Output.print(F("Samples/sec:\t\t"));
+  Output.print((unsigned long)INA219_samplesPerSecond(stats));
+  Output.print(F(" (max "));
+  Output.print((unsigned long)(1000000u / stats->periodUs));
+  Output.println(F(")"));
+  Output.print(F("Missed conversions:\t"));
+  Output.println((unsigned long)stats->missed);
+  Output.print(F("Read errors:\t\t"));
+  Output.println((unsigned long)stats->errors);
+  Output.print(F("Shunt uV min/avg/max:\t"));
+  Output.print((long)burstMin_g);
+  Output.print(F("/"));
+  Output.print((long)(stats->samples ? burstSum_g / (int64_t)stats->samples : 0));
+  Output.print(F("/"));
+  Output.println((long)burstMax_g);
+  Output.println(F(""));
+}
+
+/** Prints how long startup took, from the start of setup(). The first 
+    report time also depends on when the pad first had something to say. */
+void printStartupTimes()
+{
+  Output.print(F("Pad ready (us):\t\t"));
+  Output.print((unsigned long)padReadyUs_g);
+  Output.println(padReadyStatus_g == SUCCESS ? F("") : F(" (not responding)"));
+  Output.print(F("Loop ready (us):\t"));
+  Output.println((unsigned long)loopReadyUs_g);
+  Output.print(F("First report (us):\t"));
+  if(firstReportUs_g != 0)
+  {
+    Output.println((unsigned long)firstReportUs_g);
+  }
+  else
+  {
+    Output.println(F("none yet"));
+  }
 }
 
 /** Prints a systemInfo_t struct to Serial.
     See API_C2.h for more information about the systemInfo_t struct */
 void printSystemInfo(systemInfo_t* sysInfo)
 {
-  Serial.println(F("System Information"));
-  Serial.print(F("Chip ID:\t"));
-  Serial.println(sysInfo->chipId, HEX);
-  Serial.print(F("FW Version:\t"));
-  Serial.println(sysInfo->firmwareVersion, HEX);
-  Serial.print(F("FW Subversion:\t"));
-  Serial.println(sysInfo->firmwareSubversion, HEX);
-  Serial.print(F("Vendor ID:\t"));
-  Serial.println(sysInfo->vendorId, HEX);
-  Serial.print(F("Product ID:\t"));
-  Serial.println(sysInfo->productId, HEX);
-  Serial.print(F("Version ID:\t"));
-  Serial.println(sysInfo->versionId, HEX);
-  Serial.println(F(""));
+  Output.println(F("System Information"));
+  Output.print(F("Chip ID:\t"));
+  Output.println(sysInfo->chipId, HEX);
+  Output.print(F("FW Version:\t"));
+  Output.println(sysInfo->firmwareVersion, HEX);
+  Output.print(F("FW Subversion:\t"));
+  Output.println(sysInfo->firmwareSubversion, HEX);
+  Output.print(F("Vendor ID:\t"));
+  Output.println(sysInfo->vendorId, HEX);
+  Output.print(F("Product ID:\t"));
+  Output.println(sysInfo->productId, HEX);
+  Output.print(F("Version ID:\t"));
+  Output.println(sysInfo->versionId, HEX);
+  Output.print(F("Report Mode:\t"));
+  Output.println((sysInfo->feedConfig1 & 0x02) ? F("CRQ_ABSOLUTE") : F("Relative"));
+  Output.println(F(""));
 }
 
 /** Prints the information stored in a report_t struct to serial */
 void printDataReport(report_t * report)
 {
-  //Use reportID to determine how to decode the report
-  switch(report->reportID)
+  //Use the kind of the report's layout to determine how to print the report
+  switch(API_C2_getReportKind(report->reportID))
   {
-    case MOUSE_REPORT_ID:
+    case REPORT_KIND_MOUSE:
         printMouseReport(report);
         break;
-    case KEYBOARD_REPORT_ID:
+    case REPORT_KIND_KEYBOARD:
         printKeyboardReport(report);
         break;
-    case CRQ_ABSOLUTE_REPORT_ID:
+    case REPORT_KIND_ABSOLUTE:
         printCRQ_AbsoluteReport(report);   
         break;
     default:
-        Serial.println(F("Error: Unknown Report ID"));
+        Output.print(F("Error: Unknown Report ID 0x"));
+        Output.println(report->reportID, HEX);
   }
 }
 
 /** Prints the information stored in a mouse report to serial */
 void printMouseReport(report_t* report)
 {
-  Serial.print(F("Report ID:\t0x"));
-  Serial.println(report->reportID, HEX);
-  Serial.print(F("Buttons:\t0b"));
-  Serial.println(report->mouse.buttons, BIN);
-  Serial.print(F("X Delta:\t"));
-  Serial.println(report->mouse.xDelta);
-  Serial.print(F("Y Delta:\t"));
-  Serial.println(report->mouse.yDelta);
-  Serial.print(F("Scroll Delta:\t"));
-  Serial.println(report->mouse.scrollDelta);
-  Serial.print(F("Pan Delta:\t"));
-  Serial.println(report->mouse.panDelta);
-  Serial.println(F(""));
+  Output.print(F("Report ID:\t0x"));
+  Output.println(report->reportID, HEX);
+  Output.print(F("Buttons:\t0b"));
+  Output.println(report->mouse.buttons, BIN);
+  Output.print(F("X Delta:\t"));
+  Output.println(report->mouse.xDelta);
+  Output.print(F("Y Delta:\t"));
+  Output.println(report->mouse.yDelta);
+  Output.print(F("Scroll Delta:\t"));
+  Output.println(report->mouse.scrollDelta);
+  Output.print(F("Pan Delta:\t"));
+  Output.println(report->mouse.panDelta);
+  Output.println(F(""));
 }
 
 /** Prints the information stored in a keyboard report to serial */
 void printKeyboardReport(report_t* report)
 {
-  Serial.print(F("Report ID:\t0x"));
-  Serial.println(report->reportID, HEX);
-  Serial.print(F("modifier:\t0x"));
-  Serial.println(report->keyboard.modifier, HEX);
-  Serial.print(F("Keycodes:"));
+  Output.print(F("Report ID:\t0x"));
+  Output.println(report->reportID, HEX);
+  Output.print(F("modifier:\t0x"));
+  Output.println(report->keyboard.modifier, HEX);
+  Output.print(F("Keycodes:"));
   for(uint8_t i = 0; i < 5; i++)
   {
-      Serial.print(F("\t0x"));
-      Serial.print(report->keyboard.keycode[i],HEX);
+      Output.print(F("\t0x"));
+      Output.print(report->keyboard.keycode[i],HEX);
   }
-  Serial.println();
-  Serial.println();
+  Output.println();
+  Output.println();
 }
 
 /** Prints the information stored in a CRQ_ABSOLUTE report to serial*/
 void printCRQ_AbsoluteReport(report_t * report)
 {
-  Serial.print(F("Report ID:\t0x"));
-  Serial.println(report->reportID, HEX);
-  Serial.print(F("Contact Flags:\t0b"));
-  Serial.println(report->abs.contactFlags, BIN);
-  Serial.print(F("Buttons:\t0b"));
-  Serial.println(report->abs.buttons, BIN);
+  Output.print(F("Report ID:\t0x"));
+  Output.println(report->reportID, HEX);
+  Output.print(F("Contact Flags:\t0b"));
+  Output.println(report->abs.contactFlags, BIN);
+  Output.print(F("Buttons:\t0b"));
+  Output.println(report->abs.buttons, BIN);
   for(uint8_t i = 0; i < 5; i++)
   {
-    Serial.print(F("Finger"));
-    Serial.print(i);
-    Serial.println(F(":"));
-    Serial.print(F("    Palm Flags:\t0b"));
-    Serial.println(report->abs.fingers[i].palm, BIN);
-    Serial.print(F("    Valid:\t"));
-    Serial.println(API_C2_isFingerValid(report,i)? F("Yes"):F("No"));
-    Serial.print(F("    (x,y):\t("));
-    Serial.print(report->abs.fingers[i].x, DEC);
-    Serial.print(F(","));
-    Serial.print(report->abs.fingers[i].y, DEC);
-    Serial.println(F(")"));
+    Output.print(F("Finger"));
+    Output.print(i);
+    Output.println(F(":"));
+    Output.print(F("    Palm Flags:\t0b"));
+    Output.println(report->abs.fingers[i].palm, BIN);
+    Output.print(F("    Valid:\t"));
+    Output.println(API_C2_isFingerValid(report,i)? F("Yes"):F("No"));
+    Output.print(F("    (x,y):\t("));
+    Output.print(report->abs.fingers[i].x, DEC);
+    Output.print(F(","));
+    Output.print(report->abs.fingers[i].y, DEC);
+    Output.println(F(")"));
   }
   
-  Serial.println();
+  Output.println();
 }
 
 /**************************************************************/
 /*************** FUNCTIONS FOR PRINTING EVENTS ****************/
 
 /** @ingroup prevReports 
-    These reports store the state of the most recent reports by type.
-    Determining if an event occurred requires information about the previous state. 
-*/
-report_t prevAbsReport_g;       /**< Most recent past CRQ_ABSOLUTE report */
-report_t prevMouseReport_g;     /**< Most recent past Mouse report */
-report_t prevKeyboardReport_g;  /**< Most recent past Keyboard report */
-
-/** Prints all the events that correspond to cur_report.
-    Determines which printing function to use from the reportID */
-void printEvent(report_t* cur_report)
-{
-  switch( cur_report->reportID)
-  {
-    case CRQ_ABSOLUTE_REPORT_ID:
-        printCRQ_AbsoluteEvents(cur_report, &prevAbsReport_g);
-        prevAbsReport_g = *cur_report;
+    These summaries store the state of the most recent reports by type.
+    Determining if an event occurred requires information about the previous state, 
+    but only the buttons, fingers and keys, not the positions (see reportState_t). */
+reportState_t prevAbsState_g;       /**< Most recent past CRQ_ABSOLUTE report */
+reportState_t prevMouseState_g;     /**< Most recent past Mouse report */
+reportState_t prevKeyboardState_g;  /**< Most recent past Keyboard report */
+
+/** Prints all the events that correspond to the viewed report.
+    Determines which printing function to use from the report kind. 
+    Only the fields that events depend on are read from the packet. */
+void printEvent(const reportView_t* view)
+{
+  reportState_t cur_state;
+  API_C2_saveReportState(view, &cur_state);
+
+  switch(API_C2_viewKind(view))
+  {
+    case REPORT_KIND_ABSOLUTE:
+        printCRQ_AbsoluteEvents(&cur_state, &prevAbsState_g);
+        prevAbsState_g = cur_state;
         break;
-    case MOUSE_REPORT_ID:
-        printMouseReportEvents(cur_report, &prevMouseReport_g); 
-        prevMouseReport_g = *cur_report;
+    case REPORT_KIND_MOUSE:
+        printMouseReportEvents(&cur_state, &prevMouseState_g); 
+        prevMouseState_g = cur_state;
         break;
-    case KEYBOARD_REPORT_ID:
-        printKeyboardEvents(cur_report, &prevKeyboardReport_g);
-        prevKeyboardReport_g = *cur_report;
+    case REPORT_KIND_KEYBOARD:
+        printKeyboardEvents(&cur_state, &prevKeyboardState_g);
+        prevKeyboardState_g = cur_state;
         break;
     default:
-        Serial.println(F("NOT VALID REPORT FOR EVENTS"));
+        Output.println(F("NOT VALID REPORT FOR EVENTS"));
         break;
   }
 }
 
 /** Prints all Mouse events.
-    cur_report and prev_report should both be Mouse reports (relative mode)
+    cur_state and prev_state should both be from Mouse reports (relative mode)
     Mouse events are button presses/releases.*/
-void printMouseReportEvents(report_t* cur_report, report_t* prev_report)
+void printMouseReportEvents(const reportState_t* cur_state, const reportState_t* prev_state)
 {
-    if(prev_report->reportID == MOUSE_REPORT_ID)
+    if(prev_state->reportID == MOUSE_REPORT_ID)
     {
-        printButtonEvents(cur_report, prev_report);
+        printButtonEvents(cur_state, prev_state);
     }
 }
 
 /** Prints all Absolute events.
-    cur_report and prev_report should both be CRQ_ABSOLUTE reports
+    cur_state and prev_state should both be from absolute reports (CRQ_ABSOLUTE or Precision Touchpad)
     Absolute events are finger presses/validation/releases and button presses/releases.*/
-void printCRQ_AbsoluteEvents(report_t* cur_report, report_t* prev_report)
+void printCRQ_AbsoluteEvents(const reportState_t* cur_state, const reportState_t* prev_state)
 {
-    if(prev_report->reportID == CRQ_ABSOLUTE_REPORT_ID)
+    if(API_C2_getReportKind(prev_state->reportID) == REPORT_KIND_ABSOLUTE)
     {
         for(uint8_t i = 0; i < 5; i++)
         {
-            printFingerEvents(cur_report, prev_report, i);
+            printFingerEvents(cur_state, prev_state, i);
         }
-        printButtonEvents(cur_report, prev_report);
+        printButtonEvents(cur_state, prev_state);
     }
 }
 
 /** Prints all keyboard events.
-    cur_report and prev_report should both be keyboard reports (relative mode)
+    cur_state and prev_state should both be from keyboard reports (relative mode)
     Keyboard events are modifier key presses/releases and keycode key presses/releases.*/
-void printKeyboardEvents(report_t* cur_report, report_t* prev_report)
+void printKeyboardEvents(const reportState_t* cur_state, const reportState_t* prev_state)
 {
-    if(prev_report->reportID == KEYBOARD_REPORT_ID && 
-        cur_report->reportID == KEYBOARD_REPORT_ID)
+    if(prev_state->reportID == KEYBOARD_REPORT_ID && 
+        cur_state->reportID == KEYBOARD_REPORT_ID)
     {
-        printModifierKeyEvents(cur_report, prev_report);
+        printModifierKeyEvents(cur_state, prev_state);
         for(uint8_t i = 0; i < 6; i++) //look at each of the 6 keycodes available in keyboard report
         {
-            printKeycodeEvents(cur_report, prev_report, i);
+            printKeycodeEvents(cur_state, prev_state, i);
         }
     }
 }
 
-/** Determines and prints what modifier keys have changed since prev_report.
+/** Determines and prints what modifier keys have changed since prev_state.
     Modifier keys are ctrl, alt, GUI/meta, and shift */
-void printModifierKeyEvents(report_t* cur_report, report_t* prev_report)
+void printModifierKeyEvents(const reportState_t* cur_state, const reportState_t* prev_state)
 {
-    // show bitmap of what keys have changed since prev_report
-    uint8_t changedModifier = cur_report->keyboard.modifier ^ prev_report->keyboard.modifier;
+    // show bitmap of what keys have changed since prev_state
+    uint8_t changedModifier = cur_state->modifier ^ prev_state->modifier;
     
     // shows what keys are currently "pressed" now
-    uint8_t curModifier = cur_report->keyboard.modifier;
+    uint8_t curModifier = cur_state->modifier;
     
     if(changedModifier & KEYBOARD_MODIFIER_LEFT_CTRL_KEY_MASK)
     {
@@ -417,14 +1491,14 @@ void printModifierKeyEvents(report_t* cur_report, report_t* prev_report)
 /** A simple helper for printing that a key was pressed or released */
 void printKeypressEvent(String keyname_str, bool pressed)
 {
-    Serial.print(keyname_str);
+    Output.print(keyname_str);
     if(pressed)
     {
-        Serial.println(F(" Key Pressed"));
+        Output.println(F(" Key Pressed"));
     }
     else
     {
-        Serial.println(F(" Key Released"));
+        Output.println(F(" Key Released"));
     }
 }
 
@@ -454,21 +1528,21 @@ String getKeyName(uint8_t keycode)
 /** Determines and prints any keycode events given by a Keyboard report.
     In relative (HID) mode, the module may send keycodes corresponding to keyboard presses
     and releases to represent the functionality of a gesture. */
-void printKeycodeEvents(report_t* cur_report, report_t* prev_report, uint8_t keycodeIndex)
+void printKeycodeEvents(const reportState_t* cur_state, const reportState_t* prev_state, uint8_t keycodeIndex)
 {
-    if(cur_report->keyboard.keycode[keycodeIndex] != prev_report->keyboard.keycode[keycodeIndex])
+    if(cur_state->keycode[keycodeIndex] != prev_state->keycode[keycodeIndex])
     {
         String keyName = "";
-        bool pressed = cur_report->keyboard.keycode[keycodeIndex] != 0x0;
+        bool pressed = cur_state->keycode[keycodeIndex] != 0x0;
         if(pressed)
         {
-            //use cur_report keycode
-            keyName = getKeyName(cur_report->keyboard.keycode[keycodeIndex]);
+            //use cur_state keycode
+            keyName = getKeyName(cur_state->keycode[keycodeIndex]);
         }
         else //released
         {
-            //use prev_report keycode
-            keyName = getKeyName(prev_report->keyboard.keycode[keycodeIndex]);
+            //use prev_state keycode
+            keyName = getKeyName(prev_state->keycode[keycodeIndex]);
         }
         printKeypressEvent(keyName, pressed);
     }
@@ -479,111 +1553,90 @@ void printKeycodeEvents(report_t* cur_report, report_t* prev_report, uint8_t key
     a couple frames before it is validated and confident. This is intended to 
     demonstrate the difference between those events. For most cases, you want to confirm 
     that the finger is valid before using its coordinates. */
-void printFingerEvents(report_t* cur_report, report_t* prev_report, uint8_t finger_num)
+void printFingerEvents(const reportState_t* cur_state, const reportState_t* prev_state, uint8_t finger_num)
 {
-    printContactEvents(cur_report, prev_report, finger_num);
-    printFingerValidationEvents(cur_report, prev_report, finger_num);
+    printContactEvents(cur_state, prev_state, finger_num);
+    printFingerValidationEvents(cur_state, prev_state, finger_num);
 }
-/** Determines and prints if a finger contact event occurred between cur_report and prev_report for finger_num. 
-    Demonstrates use of the API_C2_isFingerContacted function. */
-void printContactEvents(report_t* cur_report, report_t* prev_report, uint8_t finger_num)
+/** Determines and prints if a finger contact event occurred between cur_state and prev_state for finger_num. 
+    contactFlags holds what API_C2_isFingerContacted gives for each finger. */
+void printContactEvents(const reportState_t* cur_state, const reportState_t* prev_state, uint8_t finger_num)
 {
+    uint8_t mask = 0x1 << finger_num;
     //finger is contacted now
-    if(API_C2_isFingerContacted(cur_report, finger_num))
+    if(cur_state->contactFlags & mask)
     {
         //it wasn't contacted before
-        if(!API_C2_isFingerContacted(prev_report, finger_num))
+        if(!(prev_state->contactFlags & mask))
         {
-            Serial.print(F("Finger "));
-            Serial.print(finger_num);
-            Serial.println(F(" contacted"));
+            Output.print(F("Finger "));
+            Output.print(finger_num);
+            Output.println(F(" contacted"));
         }
     }
     //not contacted now
     else
     {
         //it was contacted before
-        if(API_C2_isFingerContacted(prev_report, finger_num))
+        if(prev_state->contactFlags & mask)
         {
-            Serial.print(F("Finger "));
-            Serial.print(finger_num);
-            Serial.println(F(" released"));
+            Output.print(F("Finger "));
+            Output.print(finger_num);
+            Output.println(F(" released"));
         }
     }
 }
-/** Determines and prints if a finger validation event occurred between cur_report and prev_report for finger_num. 
-    Demonstrates use of the API_C2_isFingerValid function. 
+/** Determines and prints if a finger validation event occurred between cur_state and prev_state for finger_num. 
+    validFlags holds what API_C2_isFingerValid gives for each finger. 
     Note: x,y data for invalid fingers should generally be ignored. When a finger is released, its last location is 
     still sent. This should be ignored because the finger is not valid. */
-void printFingerValidationEvents(report_t* cur_report, report_t* prev_report, uint8_t finger_num)
+void printFingerValidationEvents(const reportState_t* cur_state, const reportState_t* prev_state, uint8_t finger_num)
 {
+    uint8_t mask = 0x1 << finger_num;
     //finger is valid now
-    if(API_C2_isFingerValid(cur_report, finger_num))
+    if(cur_state->validFlags & mask)
     {
         //it wasn't valid before
-        if(!API_C2_isFingerValid(prev_report, finger_num))
+        if(!(prev_state->validFlags & mask))
         {
-            Serial.print(F("Finger "));
-            Serial.print(finger_num);
-            Serial.println(F(" valid"));
+            Output.print(F("Finger "));
+            Output.print(finger_num);
+            Output.println(F(" valid"));
         }
     }
     // finger is not valid now
     else
     {
         // it was valid before
-        if(API_C2_isFingerValid(prev_report, finger_num))
+        if(prev_state->validFlags & mask)
         {
-            Serial.print(F("Finger "));
-            Serial.print(finger_num);
-            Serial.println(F(" invalid"));
+            Output.print(F("Finger "));
+            Output.print(finger_num);
+            Output.println(F(" invalid"));
         }
     }
 }
 
-/** Returns the button information in the passed in report. 
-    returns 0 if NULL or report is a keyboard report that does not
-    have button data. */
-uint8_t getButtonsFromReport(report_t* report)
+/** Determines and prints if a button event (press or release) occurred between cur_state and prev_state. 
+    buttons is zero for keyboard reports, which have no button data. */
+void printButtonEvents(const reportState_t* cur_state, const reportState_t* prev_state)
 {
-    if(report == NULL)
-    {
-        return 0;
-    }
-    switch(report->reportID)
-    {
-        case MOUSE_REPORT_ID:
-            return report->mouse.buttons;
-        case CRQ_ABSOLUTE_REPORT_ID:
-            return report->abs.buttons;
-        default:
-            return 0;
-    }
-}
-
-/** Determines and prints if a button event (press or release) occurred between cur_report and prev_report. 
-    Demonstrates use of the API_C2_isButtonPressed function. */
-void printButtonEvents(report_t* cur_report, report_t* prev_report)
-{
-    uint8_t currentButtons = getButtonsFromReport(cur_report);
-    uint8_t prevButtons = getButtonsFromReport(prev_report);
-    
     // XOR of the button fields shows what changed
-    uint8_t changed_buttons = currentButtons ^ prevButtons;
+    uint8_t changed_buttons = cur_state->buttons ^ prev_state->buttons;
     uint8_t mask = 1;
     for(uint8_t i = 1; i < 9; i++)
     {
         if(changed_buttons & mask)
         {
-            Serial.print(F("Button "));
-            Serial.print(i);
-            if(API_C2_isButtonPressed(cur_report, mask))
+            Output.print(F("Button "));
+            Output.print(i);
+            if(cur_state->buttons & mask)
             {
-                Serial.println(F(" Pressed"));
+                Output.println(F(" Pressed"));
             }
             else
             {
-                Serial.println(F(" Released"));
+                Output.println(F(" Released"));
             }
         }
         
@@ -592,22 +1645,17 @@ void printButtonEvents(report_t* cur_report, report_t* prev_report)
     
 }
 
-/** Initializes reports used for keeping track of state.
-    Each report will represent the most recent past report of
-    its type. */
+/** Initializes the summaries used for keeping track of state.
+    Each one will represent the most recent past report of
+    its type, with nothing pressed or touching. */
 void initialize_saved_reports()
 {
-    prevAbsReport_g.reportID = CRQ_ABSOLUTE_REPORT_ID; //should be initialized... is there a conveninet way?
-    prevAbsReport_g.abs.buttons = 0x0;
-    prevAbsReport_g.abs.contactFlags = 0x0;
+    memset(&prevAbsState_g, 0, sizeof(reportState_t));
+    prevAbsState_g.reportID = CRQ_ABSOLUTE_REPORT_ID;
     
-    prevMouseReport_g.reportID = MOUSE_REPORT_ID;
-    prevMouseReport_g.mouse.buttons = 0x0;
+    memset(&prevMouseState_g, 0, sizeof(reportState_t));
+    prevMouseState_g.reportID = MOUSE_REPORT_ID;
     
-    prevKeyboardReport_g.reportID = KEYBOARD_REPORT_ID;
-    prevKeyboardReport_g.keyboard.modifier = 0x0;
-    for(uint8_t i = 0; i < 5; i++)
-    {
-        prevKeyboardReport_g.keyboard.keycode[i] = 0x0;
-    }
+    memset(&prevKeyboardState_g, 0, sizeof(reportState_t));
+    prevKeyboardState_g.reportID = KEYBOARD_REPORT_ID;
 }
@@ -0,0 +1,28 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+#include <Arduino.h>
+#include "HardwareTimer.h"
+
+/************************************************************/
+/************************************************************/
+/********************  GLOBAL VARIABLES *********************/
+
+static IntervalTimer _timer;
+
+/************************************************************/
+/************************************************************/
+/********************  PUBLIC FUNCTIONS *********************/
+
+/** Calls tick every periodUs from the timer interrupt, until
+	HardwareTimer_stop. Starting it again restarts the period. Returns false
+	if no PIT channel was free. */
+bool HardwareTimer_start(uint32_t periodUs, void (*tick)(void))
+{
+	_timer.end();
+	return _timer.begin(tick, periodUs);
+}
+
+void HardwareTimer_stop(void)
+{
+	_timer.end();
+}
@@ -0,0 +1,30 @@
+#ifndef HARDWARE_TIMER_H
+#define HARDWARE_TIMER_H
+
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+/** @file HardwareTimer.h
+	@brief A periodic hardware timer interrupt for C modules.
+
+	Wraps one Teensy IntervalTimer (a PIT channel). The callback runs in the
+	interrupt, so it must be short and may only share volatile state with
+	the rest of the sketch. */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/************************************************************/
+/************************************************************/
+/********************  PUBLIC FUNCTIONS *********************/
+bool HardwareTimer_start(uint32_t periodUs, void (*tick)(void));
+
+void HardwareTimer_stop(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,16 +1,30 @@
 // Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
 
+#include <Arduino.h>
 #include "HostDR.h"
 
+/************************************************************/
+/************************************************************/
+/********************  GLOBAL VARIABLES *********************/
+
+static volatile uint32_t _assertedUs = 0;
+
+static void assertedIsr(void)
+{
+	_assertedUs = micros();
+}
+
 /************************************************************/
 /************************************************************/
 /********************  PUBLIC FUNCTIONS *********************/
 
 /** Initialize the Host_DR line as an input.  No pull up is required as the line
-	is driven high and low by the touch system. */
+	is driven high and low by the touch system. An interrupt on the falling 
+	edge notes when it asserts, see HostDR_assertedUs. */
 void HostDR_init(void)
 {
 	pinMode(CONFIG_HOST_DR_PIN, INPUT);
+	attachInterrupt(digitalPinToInterrupt(CONFIG_HOST_DR_PIN), assertedIsr, FALLING);
 }
 
 /** Read the Host_DR line's state; either 0 or 1. */
@@ -19,4 +33,11 @@ bool HostDR_pinState(void)
 	return digitalRead(CONFIG_HOST_DR_PIN);
 }
 
+/** micros() when Host_DR last asserted (went low). While reports are 
+	waiting back to back the line stays low, so this is the first of them. */
+uint32_t HostDR_assertedUs(void)
+{
+	return _assertedUs;
+}
+
 
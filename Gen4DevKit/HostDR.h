@@ -3,12 +3,13 @@
 
 // Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
 /** @file */
-#include "Arduino.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+#include <stdint.h>
+#include <stdbool.h>
 #include "Project_Config.h"
 
 /** Required Host_DR API - The touch system requires the following Host_DR
@@ -21,6 +22,8 @@ void HostDR_init(void);
 
 bool HostDR_pinState(void);
 
+uint32_t HostDR_assertedUs(void);
+
 #ifdef __cplusplus
 }
 #endif
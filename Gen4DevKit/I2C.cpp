@@ -1,6 +1,8 @@
 // Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
 
 #include "I2C.h"
+#include "Project_Config.h"
+#include <Arduino.h>
 #include <Wire.h>
 #include <utility\twi.h>
 
@@ -11,11 +13,106 @@
 #error BUFFER_LENGTH must be at least 53 for I2C_HID serial to work correctly. Go to \Program Files (x86)\Arduino\hardware\teensy\avr\libraries\Wire\WireKinetis.h
 #endif
 
+#if BUFFER_LENGTH < I2C_BUFFER_SIZE
+#error I2C_BUFFER_SIZE (see I2C.h) is larger than the Wire buffer, BUFFER_LENGTH
+#endif
+
 #if TWI_BUFFER_LENGTH < 53
 #error TWI_BUFFER_LENGTH must be at least 53 for I2C_HID serial to work correctly. Go to \Program Files (x86)\Arduino\hardware\arduino\avr\libraries\Wire\src\utility\twi.h
 #error TWI_BUFFER_LENGTH must be at least 53 for I2C_HID serial to work correctly. Go to \Program Files (x86)\Arduino\hardware\teensy\avr\libraries\Wire\utility\twi.h
 #endif
 
+/************************************************************/
+/************************************************************/
+/******************** MODULE VARIABLES **********************/
+
+static uint32_t _clockFrequency = 400000;
+static uint32_t _timeoutUs = I2C_TIMEOUT_US;
+static uint32_t _recoveries = 0;
+static bool _holdingBus = false;   // last transaction ended without a stop (restart follows)
+
+/************************************************************/
+/************************************************************/
+/******************* HELPER FUNCTIONS ***********************/
+
+/** Releases a line (the pull-up takes it high) or pulls it low, like an 
+	open drain output. */
+static void driveLine(uint8_t pin, bool low)
+{
+  if(low)
+  {
+    digitalWrite(pin, LOW);
+    pinMode(pin, OUTPUT);
+  }
+  else
+  {
+    pinMode(pin, INPUT);
+  }
+}
+
+/** True when no device is holding SCL or SDA low. Reading the pins does not 
+	take them away from Wire. */
+static bool busIdle(void)
+{
+  return digitalRead(CONFIG_I2C_SDA_PIN) == HIGH && digitalRead(CONFIG_I2C_SCL_PIN) == HIGH;
+}
+
+/** Waits for the bus to go idle before a transaction starts, so Wire is never 
+	handed a bus it would wait on forever. Clears the bus once the deadline 
+	passes. Returns false if it is still stuck. */
+static bool waitForBus(uint32_t start)
+{
+  if(_holdingBus)
+  {
+    return true;                  // we hold SCL low ourselves for the restart
+  }
+  while(!busIdle())
+  {
+    if(micros() - start > _timeoutUs)
+    {
+      return I2C_recoverBus();
+    }
+  }
+  return true;
+}
+
+/** Hands the deadline to Wire, where Wire can end a transfer itself 
+	(setWireTimeout, AVR Wire since Arduino 1.8.13). Wire then gives up on a 
+	device that holds SCL low part way through a transfer. The Teensy 3.x Wire 
+	has no such call; there a transfer lasts as long as the device holds SCL, 
+	and the deadline is only checked before and after it. */
+static void setWireDeadline(void)
+{
+#ifdef WIRE_HAS_TIMEOUT
+  Wire.setWireTimeout(_timeoutUs, false);   // I2C_recoverBus clears the bus instead
+#endif
+}
+
+/** True if Wire gave up on the last transfer at the deadline */
+static bool wireTimedOut(void)
+{
+#ifdef WIRE_HAS_TIMEOUT
+  if(Wire.getWireTimeoutFlag())
+  {
+    Wire.clearWireTimeoutFlag();
+    return true;
+  }
+#endif
+  return false;
+}
+
+/** A transfer that ended past the deadline (a device stretched the clock or 
+	dropped off part way) leaves the bus in doubt, so it is cleared. */
+static uint8_t checkDeadline(uint32_t start, uint8_t status)
+{
+  if(wireTimedOut() || micros() - start > _timeoutUs)
+  {
+    I2C_recoverBus();
+    return I2C_TIMEOUT;
+  }
+  return status;
+}
+
 /************************************************************/
 /************************************************************/
 /********************  PUBLIC FUNCTIONS *********************/
@@ -23,16 +120,84 @@
 /** Set the Arduino as a master if no address is given and sets clock frequency. */
 void I2C_init(uint32_t clockFrequency)
 {
+  _clockFrequency = clockFrequency;
+  _holdingBus = false;
   Wire.begin();                   // Set the arduino as master.
   Wire.setClock(clockFrequency);  // call .setClock after .begin
+  setWireDeadline();
+}
+
+/** Changes the clock frequency of the running bus, between transactions. 
+	See API_Bus.h, which switches it for each device. */
+void I2C_setClock(uint32_t clockFrequency)
+{
+  _clockFrequency = clockFrequency;
+  Wire.setClock(clockFrequency);
+}
+
+/** Sets the deadline for each transaction (I2C_TIMEOUT_US by default). */
+void I2C_setTimeout(uint32_t timeoutUs)
+{
+  _timeoutUs = timeoutUs;
+  setWireDeadline();
+}
+
+/** Clears a bus held by a device, the standard way: a device that lost 
+	track part way through a byte still drives SDA low, so SCL is clocked 
+	(up to 9 times) until it lets go, then a STOP is sent and Wire is 
+	re-initialized. Returns true if the bus is idle afterwards. */
+bool I2C_recoverBus(void)
+{
+  _recoveries++;
+  driveLine(CONFIG_I2C_SDA_PIN, false);
+  driveLine(CONFIG_I2C_SCL_PIN, false);
+  delayMicroseconds(5);
+  for(uint8_t i = 0; i < 9 && digitalRead(CONFIG_I2C_SDA_PIN) == LOW; i++)
+  {
+    driveLine(CONFIG_I2C_SCL_PIN, true);
+    delayMicroseconds(5);
+    driveLine(CONFIG_I2C_SCL_PIN, false);
+    delayMicroseconds(5);
+  }
+  
+  // STOP: SDA goes high while SCL is high
+  driveLine(CONFIG_I2C_SDA_PIN, true);
+  delayMicroseconds(5);
+  driveLine(CONFIG_I2C_SDA_PIN, false);
+  delayMicroseconds(5);
+  
+  bool idle = busIdle();
+  I2C_init(_clockFrequency);      // gives the pins back to Wire
+  return idle;
+}
+
+/** Number of times the bus has been cleared since power up. */
+uint32_t I2C_getRecoveryCount(void)
+{
+  return _recoveries;
 }
 
 /** request the number of bytes specified by "count" from the given slave address
  * specified by "address". After transfer of data, set boolean "stop" as true to 
- * release the line. false will keep the line busy to send a restart. */
-void I2C_request(int16_t address, int16_t count, bool stop)
+ * release the line. false will keep the line busy to send a restart. 
+ * Returns I2C_SUCCESS only if all count bytes arrived; I2C_available() tells 
+ * how many did. */
+uint8_t I2C_request(int16_t address, int16_t count, bool stop)
 {
-  Wire.requestFrom(address, count, stop);
+  uint32_t start = micros();
+  if(!waitForBus(start))
+  {
+    while(Wire.available())
+    {
+      Wire.read();                // nothing left over from an earlier request
+    }
+    return I2C_TIMEOUT;
+  }
+  
+  uint8_t received = Wire.requestFrom(address, count, stop);
+  uint8_t status = checkDeadline(start, (received == count) ? I2C_SUCCESS : I2C_NACK);
+  _holdingBus = !stop && status == I2C_SUCCESS;
+  return status;
 }
 
 /** Returns the number of bytes available for reading. */
@@ -64,7 +229,26 @@ void I2C_beginTransmission(uint8_t address)
 /** Ends the transmission to a slave deivce that was begun by the begin transmission. 
 	Boolean "stop" if true, sends a stop condiction, releasing the bus. If false, 
 	sends a restart request, keeping the connection active. */
-void I2C_endTransmission(bool stop)
+uint8_t I2C_endTransmission(bool stop)
 {
-  Wire.endTransmission(stop);
+  uint32_t start = micros();
+  if(!waitForBus(start))
+  {
+    return I2C_TIMEOUT;
+  }
+  
+  // Wire: 0 sent, 1 too long, 2 address NACK, 3 data NACK, 4 bus error, 5 timeout
+  uint8_t result = Wire.endTransmission(stop);
+  uint8_t status;
+  if(wireTimedOut() || result >= 4)
+  {
+    I2C_recoverBus();
+    status = I2C_TIMEOUT;
+  }
+  else
+  {
+    status = checkDeadline(start, (result == 0) ? I2C_SUCCESS : I2C_NACK);
+  }
+  _holdingBus = !stop && status == I2C_SUCCESS;
+  return status;
 }
\ No newline at end of file
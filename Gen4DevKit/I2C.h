@@ -14,13 +14,43 @@ extern "C" {
 /** Required I2C API - The touch system requires the following 
 	I2C functionality from the host: */
 
+/** Transaction results returned by I2C_request and I2C_endTransmission */
+#define I2C_SUCCESS   0x00
+#define I2C_NACK      0x01  /**< Not acknowledged, or fewer bytes than requested */
+#define I2C_TIMEOUT   0x02  /**< Bus stuck or transfer past its deadline; the bus was cleared */
+
+/** Deadline for each transaction, from waiting for the bus to the end of the 
+	transfer. It has to cover the longest transfer at the slowest clock 
+	(a 53 byte report at 100kHz takes about 5ms). Inside a transfer only a 
+	Wire library with setWireTimeout (WIRE_HAS_TIMEOUT) enforces it. With the 
+	Teensy 3.x Wire a device that holds SCL low part way through a transfer 
+	holds the board for as long as it does; the deadline is checked before 
+	the transfer and when it ends, and the bus is cleared then. */
+#ifndef I2C_TIMEOUT_US
+#define I2C_TIMEOUT_US (10000)
+#endif
+
+/** Bytes one transfer can move, the size of the Wire buffer. I2C.cpp checks 
+	that Wire's buffer is at least this big. */
+#ifndef I2C_BUFFER_SIZE
+#define I2C_BUFFER_SIZE (53)
+#endif
+
 /************************************************************/
 /************************************************************/
 /********************  PUBLIC FUNCTIONS *********************/
 
 void I2C_init(uint32_t clockFrequency);
 
-void I2C_request(int16_t address, int16_t count, bool stop);
+void I2C_setClock(uint32_t clockFrequency);
+
+void I2C_setTimeout(uint32_t timeoutUs);
+
+bool I2C_recoverBus(void);
+
+uint32_t I2C_getRecoveryCount(void);
+
+uint8_t I2C_request(int16_t address, int16_t count, bool stop);
 
 uint16_t I2C_available(void);
 
@@ -30,7 +60,7 @@ void I2C_write(uint8_t data);
 
 void I2C_beginTransmission(uint8_t address);
 
-void I2C_endTransmission(bool stop);
+uint8_t I2C_endTransmission(bool stop);
 
 #ifdef __cplusplus
 }
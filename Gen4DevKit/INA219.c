@@ -1,151 +1,419 @@
 // Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
 
 #include "INA219.h"
+#include "API_Hardware.h"
+#include "API_Bus.h"
+
+#define POINTER_UNKNOWN (0xFF)
 
 static uint8_t _slaveAddress = 0x40;
 
+// The INA219 on the shared bus, below the touchpad (see API_Bus.h)
+static busDevice_t _bus = { "INA219", 0x40, INA219_CLOCK_FREQUENCY, BUS_PRIORITY_SENSOR, 0, 0, 0, { 0 } };
+
+// The driver keeps a copy of the config register, so changing one field is a 
+// single write, and remembers where the register pointer was left: it stays 
+// put between transactions, so reading the same register again needs no 
+// pointer write. Both are updated only by transactions that succeeded.
+static uint16_t _config = CONFIG__POR_DEFAULT;
+static uint8_t _pointer = POINTER_UNKNOWN;
+
+// A failed read gives no value: the last good samples are kept instead and 
+// the failure is counted, see INA219_getErrorCount()
+static uint32_t _readErrors = 0;
+static int32_t _shuntMicrovolts = 0;
+static int32_t _busMillivolts = 0;
+
+// Burst state, see INA219_startBurst()
+static bool _burstActive = false;
+static uint16_t _burstSavedConfig = 0;
+static uint32_t _burstStartUs = 0;
+static uint32_t _burstNextUs = 0;      // when the next fresh sample is ready
+static ina219BurstStats_t _burstStats;
+static uint8_t _burstFailures = 0;     // failed reads in a row
+
+// Conversion times in us by the 4 bit ADC field (bits 3-6 for the shunt ADC), 
+// the datasheet's maximums so a sample read after it is always a new one. 
+// 0x0-0x7 are 9 to 12 bit single conversions (bit 2 is don't care), 0x8 is 
+// 12 bit and 0x9-0xF average 2 to 128 samples.
+static const uint32_t _conversionUs[16] =
+{
+  93, 163, 304, 586, 93, 163, 304, 586,
+  586, 1170, 2350, 4700, 9400, 18800, 37600, 75200
+};
+
 /************************************************************/
 /************************************************************/
 /******************* HELPER FUNCTIONS ***********************/
 
-static void WriteRegister(uint8_t reg, uint16_t value)
+static bool WriteRegister(uint8_t reg, uint16_t value)
 {
+  uint8_t result;
+  
+  API_Bus_acquireNow(&_bus);
   I2C_beginTransmission(_slaveAddress);
   I2C_write(reg);
   I2C_write((value >> 8) & 0xFF);
   I2C_write(value & 0xFF);
-  I2C_endTransmission(true);
+  result = I2C_endTransmission(true);
+  API_Bus_release(&_bus);
+  _pointer = (result == I2C_SUCCESS) ? reg : POINTER_UNKNOWN;
+  return result == I2C_SUCCESS;
 }
 
-static uint16_t ReadRegister(uint8_t reg)
+// Points the INA219 at reg without reading or writing it
+static bool SetPointer(uint8_t reg, bool stop)
 {
+  uint8_t result;
+  
+  if(_pointer == reg)
+  {
+    return true;
+  }
+  API_Bus_acquireNow(&_bus);
   I2C_beginTransmission(_slaveAddress);
   I2C_write(reg);
-  I2C_endTransmission(false);  // NOTE: according to 8.5.6, no STOP condition
-  I2C_request(_slaveAddress, 2, true);
-  return ((I2C_read() << 8) | I2C_read());
+  result = I2C_endTransmission(stop);  // NOTE: according to 8.5.6, no STOP condition
+  API_Bus_release(&_bus);
+  _pointer = (result == I2C_SUCCESS) ? reg : POINTER_UNKNOWN;
+  return result == I2C_SUCCESS;
+}
+
+// Reads reg into value. Returns false, leaving value alone, if the pointer 
+// write or the read failed; the pointer is then not known any more.
+static bool ReadRegister(uint8_t reg, uint16_t* value)
+{
+  bool ok;
+  
+  API_Bus_acquireNow(&_bus);
+  ok = SetPointer(reg, false) && I2C_request(_slaveAddress, 2, true) == I2C_SUCCESS;
+  if(ok)
+  {
+    uint8_t high = I2C_read();
+    *value = (uint16_t)((high << 8) | I2C_read());
+  }
+  else
+  {
+    _pointer = POINTER_UNKNOWN;
+    _readErrors++;
+  }
+  API_Bus_release(&_bus);
+  return ok;
+}
+
+// Reads the shunt voltage register in uV, see ReadRegister()
+static bool ReadShunt(int32_t* microvolts)
+{
+  uint16_t value;
+  
+  if(!ReadRegister(REGISTER__SHUNT_VOLTAGE, &value))
+  {
+    return false;
+  }
+  *microvolts = (int32_t)(int16_t)value * 10;
+  return true;
+}
+
+static void WriteConfig(uint16_t value)
+{
+  if(WriteRegister(REGISTER__CONFIG, value))
+  {
+    _config = value;
+  }
+}
+
+static void WaitMicroseconds(uint32_t delay)
+{
+  uint32_t start = API_Hardware_micros();
+  while(API_Hardware_micros() - start < delay);
 }
 
 // Checks the Conversion Ready bit (CNVR) in INA219, returns true if set
 // INA219 sets this bit when conversions, plus any additional calculations are complete
+// Polling it leaves the pointer on the bus voltage register, so each poll after
+// the first is a single read. A failed read returns false.
 bool INA219_dataReady(void)  // Status Register, CNVR bit
 {
-  if((ReadRegister(REGISTER__BUS_VOLTAGE) & 0x0002) != 0) 
-	  return true;
-  return false;
+  uint16_t status;
+  
+  return ReadRegister(REGISTER__BUS_VOLTAGE, &status) && (status & 0x0002) != 0;
 }
 
 // Triggers a conversion for current measurement. The number of samples to be averaged (internal to INA219)
-// is set by INA219_shuntADCAveraging()
+// is set by averagingMask. Writing the config starts the conversion, so it is 
+// written even if it has not changed.
 static void INA219_triggerShuntMeasurement(uint16_t averagingMask)
 {
-  uint16_t temp = ReadRegister(REGISTER__CONFIG);
-  temp &= ~CONFIG__SHUNT_ADC_AVERAGE_128;
-  temp |= CONFIG__MODE_SHUNT_TRIG | averagingMask;
-  WriteRegister(REGISTER__CONFIG, temp);
+  uint16_t temp = _config & ~(CONFIG__SHUNT_ADC_MASK | CONFIG__MODE_MASK);
+  temp |= CONFIG__MODE_SHUNT_TRIG | (averagingMask & CONFIG__SHUNT_ADC_MASK);
+  WriteConfig(temp);
 }
 
-// Triggers a conversion for current measurement. The number of samples to be averaged (internal to INA219)
-// is set by INA219_shuntADCAveraging()
+// Triggers a conversion for bus voltage measurement. The number of samples to be averaged (internal to INA219)
+// is set by averagingMask.
 static void INA219_triggerBusMeasurement(uint16_t averagingMask)
 {
-  uint16_t temp = ReadRegister(REGISTER__CONFIG);
-  temp &= ~CONFIG__SHUNT_ADC_AVERAGE_128;
-  temp |= CONFIG__MODE_BUS_TRIG | averagingMask;
-  WriteRegister(REGISTER__CONFIG, temp);
+  uint16_t temp = _config & ~(CONFIG__BUS_ADC_MASK | CONFIG__MODE_MASK);
+  temp |= CONFIG__MODE_BUS_TRIG | (averagingMask & CONFIG__BUS_ADC_MASK);
+  WriteConfig(temp);
 }
 
 /************************************************************/
 /************************************************************/
 /********************  PUBLIC FUNCTIONS *********************/
 
-// Assigns an I2C slave address and opens the I2C port @ 400kHz
+// Assigns an I2C slave address and registers the INA219 on the shared bus at 
+// INA219_CLOCK_FREQUENCY, which starts the bus if it is the first device
 // NOTE: This function must be called before calling any other INA219 functions
 void INA219_init(uint8_t slaveAddress)
 {
   _slaveAddress = slaveAddress;
-  I2C_init(400000);
+  _pointer = POINTER_UNKNOWN;
+  _burstActive = false;
+  _shuntMicrovolts = 0;
+  _busMillivolts = 0;
+  _bus.address = slaveAddress;
+  API_Bus_addDevice(&_bus);
   
   WriteRegister(REGISTER__CALIBRATION, 13421);
+  
+  // the one config read: everything after works from the copy
+  if(!ReadRegister(REGISTER__CONFIG, &_config))
+  {
+    _config = CONFIG__POR_DEFAULT;
+  }
 }
 
 // Writes <data> to the config register (Reg: 0x00)
 // NOTE: Use CONFIG__ register masks in INA219.h for easy configuration
 void INA219_config(uint16_t data)
 {
-  WriteRegister(REGISTER__CONFIG, data);
+  WriteConfig(data);
 }
 
 // Resets all internal INA219 registers to POR defaults
 void INA219_reset(void)
 {
-  uint16_t temp = ReadRegister(REGISTER__CONFIG);
-  temp |= CONFIG__RESET;
-  WriteRegister(REGISTER__CONFIG, temp);
+  WriteRegister(REGISTER__CONFIG, _config | CONFIG__RESET);
+  _config = CONFIG__POR_DEFAULT;
+  _pointer = POINTER_UNKNOWN;
+  _burstActive = false;
 }
 
 // Measures voltage between IN+ and IN- (across shunt resistor) in uV
 // NOTE: Use CONFIG__SHUNT_ADC_AVERAGE masks in INA219.h for setting
 int32_t INA219_measureShuntVoltage(uint16_t averagingMask)
 {
-  int32_t temp = 0;
-  uint32_t delay = 0;
-  
+  WaitMicroseconds(INA219_startShuntMeasurement(averagingMask));
+  return INA219_readShuntVoltage();
+}
+
+// Starts a shunt voltage conversion and returns without waiting for it.
+// Returns the conversion time in us for the averaging setting. Read the 
+// result with INA219_readShuntVoltage() once it has passed.
+uint32_t INA219_startShuntMeasurement(uint16_t averagingMask)
+{
   INA219_triggerShuntMeasurement(averagingMask);
+  return INA219_shuntConversionUs(averagingMask);
+}
+
+// Reads the result of the last shunt voltage conversion in uV. If the read 
+// fails, returns the last sample that was read.
+int32_t INA219_readShuntVoltage(void)
+{
+  ReadShunt(&_shuntMicrovolts);
+  return _shuntMicrovolts;
+}
+
+// Measures voltage at IN- pin in mV
+// NOTE: Use CONFIG__BUS_ADC_AVERAGE masks in INA219.h for setting
+int32_t INA219_measureBusVoltage(uint16_t averagingMask, uint32_t delay)
+{
+  INA219_triggerBusMeasurement(averagingMask);
+  if (delay > 0)
+  {
+    WaitMicroseconds(delay);
+  }
+  else
+  {
+    // gives up on a failed read rather than poll a chip that is not there
+    uint16_t status = 0;
+    while(ReadRegister(REGISTER__BUS_VOLTAGE, &status) && (status & 0x0002) == 0);
+  }
+  uint16_t value;
+  if(ReadRegister(REGISTER__BUS_VOLTAGE, &value))
+  {
+    _busMillivolts = (int32_t)((value >> 3) * 4);
+  }
+  return _busMillivolts;
+}
+
+// Returns the longest a shunt conversion takes in us for a CONFIG__SHUNT_ADC_ 
+// setting (RES_ or AVERAGE_)
+uint32_t INA219_shuntConversionUs(uint16_t adcMask)
+{
+  return _conversionUs[(adcMask & CONFIG__SHUNT_ADC_MASK) >> 3];
+}
+
+// Starts a burst: the INA219 converts the shunt voltage continuously with 
+// the given CONFIG__SHUNT_ADC_ setting and the pointer is left on the shunt 
+// voltage register, so each sample is one 2 byte read with no writes. The 
+// config is only written if it changes. Samples are ready one conversion time 
+// apart; INA219_burstDue() tells when, without any bus traffic.
+void INA219_startBurst(uint16_t adcMask)
+{
+  uint16_t burstConfig = (_config & ~(CONFIG__SHUNT_ADC_MASK | CONFIG__MODE_MASK)) 
+                         | (adcMask & CONFIG__SHUNT_ADC_MASK) | CONFIG__MODE_SHUNT_CONT;
   
-  switch(averagingMask)
-  {
-	case CONFIG__SHUNT_ADC_AVERAGE_1:
-		delay = CONFIG_DELAY_1;
-		break;	
-	case CONFIG__SHUNT_ADC_AVERAGE_2:
-		delay = CONFIG_DELAY_2;
-		break;
-	case CONFIG__SHUNT_ADC_AVERAGE_4:
-		delay = CONFIG_DELAY_4;
-		break;
-	case CONFIG__SHUNT_ADC_AVERAGE_8:
-		delay = CONFIG_DELAY_8;
-		break;	
-	case CONFIG__SHUNT_ADC_AVERAGE_16:
-		delay = CONFIG_DELAY_16;
-		break;
-	case CONFIG__SHUNT_ADC_AVERAGE_32:
-		delay = CONFIG_DELAY_32;
-		break;
-	case CONFIG__SHUNT_ADC_AVERAGE_64:
-		delay = CONFIG_DELAY_64;
-		break;
-	case CONFIG__SHUNT_ADC_AVERAGE_128:
-		delay = CONFIG_DELAY_128;
-		break;
+  if(!_burstActive)
+  {
+    _burstSavedConfig = _config;
+  }
+  if(burstConfig != _config)
+  {
+    WriteConfig(burstConfig);
   }
+  SetPointer(REGISTER__SHUNT_VOLTAGE, true);
   
-  if (delay > 0)
+  _burstStats.samples = 0;
+  _burstStats.missed = 0;
+  _burstStats.errors = 0;
+  _burstFailures = 0;
+  _burstStats.elapsedUs = 0;
+  _burstStats.periodUs = INA219_shuntConversionUs(adcMask);
+  _burstStartUs = API_Hardware_micros();
+  _burstNextUs = _burstStartUs + _burstStats.periodUs;
+  _burstActive = true;
+}
+
+// Returns true when a burst is running and its next sample is ready
+bool INA219_burstDue(void)
+{
+  return _burstActive && (int32_t)(API_Hardware_micros() - _burstNextUs) >= 0;
+}
+
+// Takes the burst sample that is due. With yield, waits (returns false) 
+// while a device that goes first on the bus has work. A failed read stores 
+// nothing, is tried again a conversion time later and, after 
+// INA219_BURST_MAX_ERRORS in a row, ends the burst.
+static bool ReadBurstSample(int32_t* microvolts, bool yield)
+{
+  if(!INA219_burstDue())
   {
-	  delayMicroseconds(delay);
+    return false;
   }
-  else
+  if(!yield)
+  {
+    API_Bus_acquireNow(&_bus);
+  }
+  else if(!API_Bus_acquire(&_bus))
   {
-	  while(!INA219_dataReady());
+    return false;
   }
-  temp = (int16_t) ReadRegister(REGISTER__SHUNT_VOLTAGE);
-  temp *= 10;
-  return temp;
+  uint32_t now = API_Hardware_micros();
+  uint32_t late = now - _burstNextUs;
+  
+  bool ok = ReadShunt(microvolts);
+  API_Bus_release(&_bus);
+  if(!ok)
+  {
+    _burstStats.errors++;
+    _burstNextUs = now + _burstStats.periodUs;
+    if(++_burstFailures >= INA219_BURST_MAX_ERRORS)
+    {
+      INA219_stopBurst();
+    }
+    return false;
+  }
+  _burstFailures = 0;
+  _shuntMicrovolts = *microvolts;
+  _burstStats.samples++;
+  _burstStats.elapsedUs = now - _burstStartUs;
+  _burstStats.missed += late / _burstStats.periodUs;
+  
+  // A full conversion time from this read, not from when it was due: a read 
+  // that came late has to be followed by a whole conversion before the next 
+  // one is sure to be new.
+  _burstNextUs = now + _burstStats.periodUs;
+  return true;
 }
 
-// Measures voltage at IN- pin in mV
-// NOTE: Use CONFIG__BUS_ADC_AVERAGE masks in INA219.h for setting
-int32_t INA219_measureBusVoltage(uint16_t averagingMask, uint32_t delay)
+// Reads the next burst sample in uV if it is ready, otherwise returns false 
+// at once. It also returns false, leaving the sample due, while the touchpad 
+// has a report waiting, and when the read fails. Conversions that finished 
+// while nobody read them are counted as missed.
+bool INA219_readBurst(int32_t* microvolts)
 {
-  INA219_triggerBusMeasurement(averagingMask);
-  if (delay > 0)
+  return ReadBurstSample(microvolts, true);
+}
+
+// Ends a burst and puts back the config from before it
+void INA219_stopBurst(void)
+{
+  if(!_burstActive)
   {
-	  delayMicroseconds(delay);
+    return;
   }
-  else
+  _burstActive = false;
+  if(_config != _burstSavedConfig)
+  {
+    WriteConfig(_burstSavedConfig);
+  }
+}
+
+// True when no device that goes before the INA219 on the bus has work 
+// waiting. Tasks that use the INA219 check it before they run.
+bool INA219_busFree(void)
+{
+  return API_Bus_isFree(&_bus);
+}
+
+bool INA219_burstActive(void)
+{
+  return _burstActive;
+}
+
+// Register reads that failed since power up. The sample they were for was 
+// not taken.
+uint32_t INA219_getErrorCount(void)
+{
+  return _readErrors;
+}
+
+void INA219_getBurstStats(ina219BurstStats_t* stats)
+{
+  *stats = _burstStats;
+}
+
+// Achieved sample rate of a burst. Samples are counted from the first, one 
+// period after the start.
+uint32_t INA219_samplesPerSecond(const ina219BurstStats_t* stats)
+{
+  if(stats->elapsedUs == 0)
+  {
+    return 0;
+  }
+  return (uint32_t)(((uint64_t)stats->samples * 1000000u + stats->elapsedUs / 2) / stats->elapsedUs);
+}
+
+// Takes count back-to-back shunt samples in uV, waiting for each. Nothing 
+// else runs meanwhile, so the samples do not wait for the touchpad either.
+// Returns the achieved samples per second. If the INA219 stops answering the 
+// burst ends early and the rest of samples is left as it was.
+uint32_t INA219_burstShuntVoltage(uint16_t adcMask, int32_t* samples, uint32_t count)
+{
+  ina219BurstStats_t stats;
+  uint32_t n = 0;
+  
+  INA219_startBurst(adcMask);
+  while(n < count && _burstActive)
   {
-	  while(!INA219_dataReady());
+    if(ReadBurstSample(&samples[n], false))
+    {
+      n++;
+    }
   }
-  return (int32_t)((ReadRegister(REGISTER__BUS_VOLTAGE) >> 3) * 4);
+  INA219_getBurstStats(&stats);
+  INA219_stopBurst();
+  return INA219_samplesPerSecond(&stats);
 }
@@ -8,8 +8,8 @@ extern "C" {
 #endif
 
 #include "I2C.h"
+#include <stdbool.h>
 #include <stdint.h>
-#include <Arduino.h>
 
 // Config Register Masks
 #define CONFIG__FS_RANGE_16V      0x0000
@@ -79,6 +79,32 @@ extern "C" {
 #define CONFIG__SHUNT_ADC_RES_12    0x0018
 #define CONFIG__SHUNT_ADC_AVERAGING 0x0040
 
+// Config register fields
+#define CONFIG__MODE_MASK           0x0007
+#define CONFIG__SHUNT_ADC_MASK      0x0078
+#define CONFIG__BUS_ADC_MASK        0x0780
+#define CONFIG__POR_DEFAULT         0x399F  // after power on or CONFIG__RESET
+
+// Failed reads in a row that end a burst (the INA219 is not answering)
+#ifndef INA219_BURST_MAX_ERRORS
+#define INA219_BURST_MAX_ERRORS     10
+#endif
+
+// Bus clock for INA219 transactions (fast mode; see API_Bus.h)
+#ifndef INA219_CLOCK_FREQUENCY
+#define INA219_CLOCK_FREQUENCY      400000
+#endif
+
+/** Burst statistics, see INA219_startBurst() */
+typedef struct
+{
+  uint32_t samples;     // samples read since the burst started
+  uint32_t missed;      // conversions that came and went before they were read
+  uint32_t elapsedUs;   // from the start of the burst to the last sample
+  uint32_t periodUs;    // conversion time of the burst's ADC setting
+  uint32_t errors;      // reads that failed; no sample was taken
+} ina219BurstStats_t;
+
 /************************************************************/
 /************************************************************/
 /********************  PUBLIC FUNCTIONS *********************/
@@ -90,9 +116,26 @@ void INA219_config(uint16_t data);
 void INA219_reset(void);
 
 int32_t INA219_measureShuntVoltage(uint16_t averagingMask);
+uint32_t INA219_startShuntMeasurement(uint16_t averagingMask);
+int32_t INA219_readShuntVoltage(void);
+bool INA219_dataReady(void);
 
 int32_t INA219_measureBusVoltage(uint16_t averagingMask, uint32_t delay);
 
+uint32_t INA219_shuntConversionUs(uint16_t adcMask);
+
+// Burst mode: back-to-back shunt samples with one 2 byte read each
+void INA219_startBurst(uint16_t adcMask);
+bool INA219_burstDue(void);
+bool INA219_readBurst(int32_t* microvolts);
+void INA219_stopBurst(void);
+bool INA219_burstActive(void);
+bool INA219_busFree(void);
+uint32_t INA219_getErrorCount(void);
+void INA219_getBurstStats(ina219BurstStats_t* stats);
+uint32_t INA219_samplesPerSecond(const ina219BurstStats_t* stats);
+uint32_t INA219_burstShuntVoltage(uint16_t adcMask, int32_t* samples, uint32_t count);
+
 //void INA219_powerDown(void); Not defined.
 
 #ifdef __cplusplus
@@ -0,0 +1,91 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+#include "OutputQueue.h"
+
+#define OUTPUT_QUEUE_MASK (OUTPUT_QUEUE_SIZE - 1)
+
+#if (OUTPUT_QUEUE_SIZE & OUTPUT_QUEUE_MASK) != 0
+#error OUTPUT_QUEUE_SIZE must be a power of two
+#endif
+
+OutputQueue Output;
+
+/************************************************************/
+/************************************************************/
+/********************  PUBLIC FUNCTIONS *********************/
+
+OutputQueue::OutputQueue() : droppedBytes(0), _head(0), _count(0)
+{
+}
+
+size_t OutputQueue::write(uint8_t data)
+{
+    if(_count == OUTPUT_QUEUE_SIZE)
+    {
+        droppedBytes++;
+        return 0;
+    }
+    _buffer[(_head + _count) & OUTPUT_QUEUE_MASK] = data;
+    _count++;
+    return 1;
+}
+
+/** Queues as much of data as fits; the rest is dropped. */
+size_t OutputQueue::write(const uint8_t* data, size_t count)
+{
+    size_t i = 0;
+    for(; i < count && _count < OUTPUT_QUEUE_SIZE; i++)
+    {
+        _buffer[(_head + _count) & OUTPUT_QUEUE_MASK] = data[i];
+        _count++;
+    }
+    droppedBytes += count - i;
+    return i;
+}
+
+int OutputQueue::availableForWrite(void)
+{
+    return OUTPUT_QUEUE_SIZE - _count;
+}
+
+/** Queues all of data or, if it does not fit, none of it. Used for binary 
+    frames, which are useless to the host when cut short. */
+bool OutputQueue::writeAll(const uint8_t* data, size_t count)
+{
+    if(count > (size_t)(OUTPUT_QUEUE_SIZE - _count))
+    {
+        droppedBytes += count;
+        return false;
+    }
+    write(data, count);
+    return true;
+}
+
+uint16_t OutputQueue::queued(void) const
+{
+    return _count;
+}
+
+/** Writes up to maxCount queued bytes to port, in at most two contiguous 
+    pieces. Returns the number of bytes written. */
+uint16_t OutputQueue::drain(Print& port, uint16_t maxCount)
+{
+    uint16_t total = 0;
+    while(_count > 0 && total < maxCount)
+    {
+        uint16_t piece = OUTPUT_QUEUE_SIZE - _head;
+        if(piece > _count)
+        {
+            piece = _count;
+        }
+        if(piece > maxCount - total)
+        {
+            piece = maxCount - total;
+        }
+        port.write(&_buffer[_head], piece);
+        _head = (_head + piece) & OUTPUT_QUEUE_MASK;
+        _count -= piece;
+        total += piece;
+    }
+    return total;
+}
@@ -0,0 +1,44 @@
+#ifndef OUTPUTQUEUE_H
+#define OUTPUTQUEUE_H
+
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+/**@file OutputQueue.h
+   @brief RAM buffer in front of the USB serial port.
+
+   Text and frames printed by the sketch go into the queue and never wait
+   for the host. OutputQueue::drain moves as much as the USB serial port can
+   take without blocking, and is run by its own scheduler task. When the host
+   stops reading and the queue fills, further output is dropped and counted
+   instead of stalling the report reads. */
+
+#include <Arduino.h>
+
+#ifndef OUTPUT_QUEUE_SIZE
+#define OUTPUT_QUEUE_SIZE (4096)   /**< Must be a power of two */
+#endif
+
+class OutputQueue : public Print
+{
+public:
+    OutputQueue();
+
+    virtual size_t write(uint8_t data);
+    virtual size_t write(const uint8_t* data, size_t count);
+    virtual int availableForWrite(void);
+    using Print::write;
+
+    bool writeAll(const uint8_t* data, size_t count);
+    uint16_t queued(void) const;
+    uint16_t drain(Print& port, uint16_t maxCount);
+
+    uint32_t droppedBytes;     /**< Output lost because the queue was full */
+
+private:
+    uint8_t  _buffer[OUTPUT_QUEUE_SIZE];
+    uint16_t _head;            /**< Oldest queued byte */
+    uint16_t _count;
+};
+
+extern OutputQueue Output;
+
+#endif // OUTPUTQUEUE_H
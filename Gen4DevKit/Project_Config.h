@@ -6,6 +6,8 @@ extern "C" {
 #define __PROJECT_CONFIG_H__
 
 #define CONFIG_HOST_DR_PIN  9   //Hardware pin of DR line
+#define CONFIG_I2C_SDA_PIN  18  //Hardware pins of the I2C bus (Wire), used to clear a stuck bus
+#define CONFIG_I2C_SCL_PIN  19
 
 // Project Specific Header
 #define CONFIG_HARDWARE_REV     2
@@ -14,6 +16,36 @@ extern "C" {
 #define CONFIG_PROJECT_SUB_REV  5
 #define CONFIG_PROJECT_NAME "Gen4DevKit"
 
+// Trace points (API_Trace.h): 1 records them, 0 compiles them out
+#ifndef CONFIG_TRACE_ENABLE
+#define CONFIG_TRACE_ENABLE     0
+#endif
+// 1 also shows the traced report reads and bus operations on SCOPE1_PIN and SCOPE2_PIN
+#ifndef CONFIG_TRACE_SCOPE
+#define CONFIG_TRACE_SCOPE      0
+#endif
+
+// Idle power policy (API_C2_Idle.h): 1 starts it at power up, 'z' and 'Z' turn it on and off
+#ifndef CONFIG_IDLE_ENABLE
+#define CONFIG_IDLE_ENABLE      0
+#endif
+
+// Haptic pulses on touch and button events (API_Haptic.h): 1 turns them on at power up, 'g' and 'G' turn them on and off
+#ifndef CONFIG_HAPTIC_ENABLE
+#define CONFIG_HAPTIC_ENABLE    0
+#endif
+
+// USB HID passthrough (API_UsbHid.h): 1 turns it on at power up, 'u' and 'U' turn it on and off.
+// Needs a USB Type with Keyboard, Mouse and Touch Screen (Tools > USB Type).
+#ifndef CONFIG_USB_HID_ENABLE
+#define CONFIG_USB_HID_ENABLE   0
+#endif
+
+// Register watch (API_C2_Watch.h): 1 starts watching watchList_g at power up, 'w' and 'W' turn it on and off
+#ifndef CONFIG_WATCH_ENABLE
+#define CONFIG_WATCH_ENABLE     0
+#endif
+
 #endif // __PROJECT_CONFIG_H__
 
 #ifdef __cplusplus
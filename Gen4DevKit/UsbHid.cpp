@@ -0,0 +1,85 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+#include <Arduino.h>
+#include "UsbHid.h"
+
+/* A full speed interface is polled every 1 ms at best; the Teensyduino
+   descriptors ask for that, but say so if a USB Type asks for less */
+#if defined(MOUSE_INTERVAL) && MOUSE_INTERVAL > 1
+#warning "USB Type polls the mouse less often than every 1 ms"
+#endif
+#if defined(KEYBOARD_INTERVAL) && KEYBOARD_INTERVAL > 1
+#warning "USB Type polls the keyboard less often than every 1 ms"
+#endif
+#if defined(MULTITOUCH_INTERVAL) && MULTITOUCH_INTERVAL > 1
+#warning "USB Type polls the touch screen less often than every 1 ms"
+#endif
+
+/************************************************************/
+/************************************************************/
+/********************  PUBLIC FUNCTIONS *********************/
+
+/** Bits (1 << USB_HID_) of the interfaces the USB Type has */
+uint8_t UsbHid_interfaces(void)
+{
+	uint8_t interfaces = 0;
+#ifdef MOUSE_INTERFACE
+	interfaces |= 1 << USB_HID_MOUSE;
+#endif
+#ifdef KEYBOARD_INTERFACE
+	interfaces |= 1 << USB_HID_KEYBOARD;
+#endif
+#ifdef MULTITOUCH_INTERFACE
+	interfaces |= 1 << USB_HID_TOUCH;
+#endif
+	return interfaces;
+}
+
+/** Buttons and movement in one report: Mouse.set_buttons would send one
+	of its own */
+void UsbHid_sendMouse(const usbMouse_t* mouse)
+{
+#ifdef MOUSE_INTERFACE
+	usb_mouse_buttons_state = mouse->buttons;
+	Mouse.move(mouse->x, mouse->y, mouse->wheel, mouse->pan);
+#else
+	(void)mouse;
+#endif
+}
+
+void UsbHid_sendKeyboard(const usbKeyboard_t* keyboard)
+{
+#ifdef KEYBOARD_INTERFACE
+	Keyboard.set_modifier(keyboard->modifier);
+	Keyboard.set_key1(keyboard->keys[0]);
+	Keyboard.set_key2(keyboard->keys[1]);
+	Keyboard.set_key3(keyboard->keys[2]);
+	Keyboard.set_key4(keyboard->keys[3]);
+	Keyboard.set_key5(keyboard->keys[4]);
+	Keyboard.set_key6(keyboard->keys[5]);
+	Keyboard.send_now();
+#else
+	(void)keyboard;
+#endif
+}
+
+/** Contact IDs are the pad's finger slots. The contacts go out together
+	in the touch screen's next report. */
+void UsbHid_sendTouch(const usbTouch_t* touch)
+{
+#ifdef MULTITOUCH_INTERFACE
+	for(uint8_t finger = 0; finger < USB_HID_FINGERS; finger++)
+	{
+		if(touch->contacts & (1 << finger))
+		{
+			TouchscreenUSB.press(finger, touch->x[finger], touch->y[finger]);
+		}
+		else if(touch->lifted & (1 << finger))
+		{
+			TouchscreenUSB.release(finger);
+		}
+	}
+#else
+	(void)touch;
+#endif
+}
@@ -0,0 +1,37 @@
+#ifndef USB_HID_H
+#define USB_HID_H
+
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+/** @file UsbHid.h
+	@brief The board's USB HID interfaces, for C modules.
+
+	Wraps Teensyduino's Mouse, Keyboard and TouchscreenUSB. Which of them
+	exist depends on the USB Type the sketch is built with (Tools > USB
+	Type); UsbHid_interfaces tells, and sending to a missing one does
+	nothing. Each call queues one HID report, which the USB controller sends
+	at the host's next poll of the interface. */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "API_UsbHid.h"
+
+/************************************************************/
+/************************************************************/
+/********************  PUBLIC FUNCTIONS *********************/
+uint8_t UsbHid_interfaces(void);
+
+void UsbHid_sendMouse(const usbMouse_t* mouse);
+
+void UsbHid_sendKeyboard(const usbKeyboard_t* keyboard);
+
+void UsbHid_sendTouch(const usbTouch_t* touch);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,485 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+#include "HostAnalytics.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/************************************************************/
+/************************************************************/
+/******************* HELPER FUNCTIONS ***********************/
+
+static void statAdd(statAcc_t* stat, double value)
+{
+  if(stat->count == 0 || value < stat->min)
+  {
+    stat->min = value;
+  }
+  if(stat->count == 0 || value > stat->max)
+  {
+    stat->max = value;
+  }
+  stat->count++;
+  double delta = value - stat->mean;
+  stat->mean += delta / stat->count;
+  stat->m2 += delta * (value - stat->mean);
+}
+
+static void statMerge(statAcc_t* into, const statAcc_t* other)
+{
+  if(other->count == 0)
+  {
+    return;
+  }
+  if(into->count == 0)
+  {
+    *into = *other;
+    return;
+  }
+  double count = (double)into->count + other->count;
+  double delta = other->mean - into->mean;
+  into->m2 += other->m2 + delta * delta * into->count * other->count / count;
+  into->mean += delta * other->count / count;
+  into->min = other->min < into->min ? other->min : into->min;
+  into->max = other->max > into->max ? other->max : into->max;
+  into->count += other->count;
+}
+
+static void addInterval(sessionAgg_t* session, uint32_t interval)
+{
+  uint32_t bucket = interval / ANALYTICS_BUCKET_US;
+  statAdd(&session->interval, interval);
+  session->histogram[bucket < ANALYTICS_BUCKETS ? bucket : ANALYTICS_BUCKETS - 1]++;
+  session->durationUs += interval;
+}
+
+static bool isJump(uint16_t fromX, uint16_t fromY, uint16_t toX, uint16_t toY, uint32_t jumpLimit)
+{
+  double dx = (double)toX - fromX, dy = (double)toY - fromY;
+  return dx * dx + dy * dy > (double)jumpLimit * jumpLimit;
+}
+
+static void addJitter(fingerAgg_t* finger, uint16_t x, uint16_t y, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2)
+{
+  double ddx = (double)x - 2.0 * x1 + x2;
+  double ddy = (double)y - 2.0 * y1 + y2;
+  finger->jitterX += ddx * ddx;
+  finger->jitterY += ddy * ddy;
+  finger->jitterCount++;
+}
+
+/** Adds one valid position to a contact, counting jumps and jitter. */
+static void addPoint(fingerAgg_t* finger, contact_t* contact, uint16_t x, uint16_t y, uint32_t jumpLimit)
+{
+  bool jumped = false;
+  if(contact->validPoints >= 1)
+  {
+    jumped = isJump(contact->lastX[0], contact->lastY[0], x, y, jumpLimit);
+    finger->jumps += jumped;
+  }
+  if(contact->validPoints >= 2 && !jumped)
+  {
+    addJitter(finger, x, y, contact->lastX[0], contact->lastY[0], contact->lastX[1], contact->lastY[1]);
+  }
+  if(contact->validPoints < 2)
+  {
+    contact->firstX[contact->validPoints] = x;
+    contact->firstY[contact->validPoints] = y;
+  }
+  contact->lastX[1] = contact->lastX[0];
+  contact->lastY[1] = contact->lastY[0];
+  contact->lastX[0] = x;
+  contact->lastY[0] = y;
+  contact->validPoints++;
+  contact->sx += x;
+  contact->sy += y;
+  contact->sxx += (double)x * x;
+  contact->syy += (double)y * y;
+  contact->sxy += (double)x * y;
+}
+
+/** Counts a finished contact and judges its linearity: the RMS distance of
+	its valid points from their principal axis (the best fit line). */
+static void finalizeContact(fingerAgg_t* finger, contact_t* contact)
+{
+  finger->contacts++;
+  finger->shortContacts += contact->reports < ANALYTICS_SHORT_CONTACT;
+  statAdd(&finger->contactMs, contact->durationUs / 1000.0);
+
+  if(contact->validPoints >= ANALYTICS_STROKE_SAMPLES)
+  {
+    double n = contact->validPoints;
+    double mx = contact->sx / n, my = contact->sy / n;
+    double cxx = contact->sxx / n - mx * mx;
+    double cyy = contact->syy / n - my * my;
+    double cxy = contact->sxy / n - mx * my;
+    double mid = (cxx + cyy) / 2.0;
+    double spread = sqrt((cxx - cyy) * (cxx - cyy) / 4.0 + cxy * cxy);
+    double along = mid + spread, across = mid - spread;
+
+    if(along >= ANALYTICS_STROKE_EXTENT * ANALYTICS_STROKE_EXTENT)
+    {
+      double deviation = across > 0.0 ? sqrt(across) : 0.0;
+      finger->strokes++;
+      finger->strokeDeviation += deviation;
+      if(deviation > finger->strokeDeviationMax)
+      {
+        finger->strokeDeviationMax = deviation;
+      }
+    }
+  }
+  contact->active = false;
+}
+
+/** The finger lifted (or the session ended). A contact that was already down
+	when the partial started may continue a contact of the previous partial, so
+	it is parked in head for the merge instead of being counted. */
+static void endContact(fingerAgg_t* finger)
+{
+  if(finger->current.leftOpen)
+  {
+    finger->head = finger->current;
+    finger->current.active = false;
+  }
+  else
+  {
+    finalizeContact(finger, &finger->current);
+  }
+}
+
+static void closeSessionRight(sessionAgg_t* session)
+{
+  for(uint8_t i = 0; i < ANALYTICS_FINGERS; i++)
+  {
+    if(session->fingers[i].current.active)
+    {
+      endContact(&session->fingers[i]);
+    }
+  }
+}
+
+/** Nothing comes before this session: left-open contacts are complete. */
+static void closeSessionLeft(sessionAgg_t* session)
+{
+  for(uint8_t i = 0; i < ANALYTICS_FINGERS; i++)
+  {
+    fingerAgg_t* finger = &session->fingers[i];
+    if(finger->head.active)
+    {
+      finalizeContact(finger, &finger->head);
+    }
+    finger->current.leftOpen = false;
+  }
+}
+
+/** Appends the later part of a contact that was cut by a partial boundary,
+	adding the jump and jitter terms that needed points from both sides. */
+static void appendContact(fingerAgg_t* finger, contact_t* contact, const contact_t* part,
+                          uint32_t interval, uint32_t jumpLimit)
+{
+  if(contact->validPoints >= 1 && part->validPoints >= 1)
+  {
+    bool jumped = isJump(contact->lastX[0], contact->lastY[0], part->firstX[0], part->firstY[0], jumpLimit);
+    finger->jumps += jumped;
+    if(contact->validPoints >= 2 && !jumped)
+    {
+      addJitter(finger, part->firstX[0], part->firstY[0], contact->lastX[0], contact->lastY[0],
+                contact->lastX[1], contact->lastY[1]);
+    }
+    if(part->validPoints >= 2 
+       && !isJump(part->firstX[0], part->firstY[0], part->firstX[1], part->firstY[1], jumpLimit))
+    {
+      addJitter(finger, part->firstX[1], part->firstY[1], part->firstX[0], part->firstY[0],
+                contact->lastX[0], contact->lastY[0]);
+    }
+  }
+  for(uint32_t i = 0; contact->validPoints + i < 2 && i < part->validPoints; i++)
+  {
+    contact->firstX[contact->validPoints + i] = part->firstX[i];
+    contact->firstY[contact->validPoints + i] = part->firstY[i];
+  }
+  if(part->validPoints == 1)
+  {
+    contact->lastX[1] = contact->lastX[0];
+    contact->lastY[1] = contact->lastY[0];
+    contact->lastX[0] = part->lastX[0];
+    contact->lastY[0] = part->lastY[0];
+  }
+  else if(part->validPoints > 1)
+  {
+    memcpy(contact->lastX, part->lastX, sizeof(contact->lastX));
+    memcpy(contact->lastY, part->lastY, sizeof(contact->lastY));
+  }
+  contact->reports += part->reports;
+  contact->durationUs += interval + part->durationUs;
+  contact->validPoints += part->validPoints;
+  contact->sx += part->sx;
+  contact->sy += part->sy;
+  contact->sxx += part->sxx;
+  contact->syy += part->syy;
+  contact->sxy += part->sxy;
+}
+
+static void joinFinger(fingerAgg_t* into, fingerAgg_t* next, uint32_t interval, uint32_t jumpLimit)
+{
+  into->samples += next->samples;
+  into->validSamples += next->validSamples;
+  into->palmSamples += next->palmSamples;
+  into->contacts += next->contacts;
+  into->shortContacts += next->shortContacts;
+  into->jumps += next->jumps;
+  into->jitterCount += next->jitterCount;
+  into->jitterX += next->jitterX;
+  into->jitterY += next->jitterY;
+  into->strokes += next->strokes;
+  into->strokeDeviation += next->strokeDeviation;
+  if(next->strokeDeviationMax > into->strokeDeviationMax)
+  {
+    into->strokeDeviationMax = next->strokeDeviationMax;
+  }
+  statMerge(&into->contactMs, &next->contactMs);
+
+  // the contact, if any, that was down at the first report of next
+  contact_t* nextLeft = next->head.active ? &next->head
+                      : (next->current.active && next->current.leftOpen) ? &next->current : NULL;
+
+  if(into->current.active && nextLeft != NULL)
+  {
+    appendContact(into, &into->current, nextLeft, interval, jumpLimit);
+    if(nextLeft == &next->head)
+    {
+      endContact(into);
+      into->current = next->current;
+    }
+    // else the contact spans all of next and stays current
+  }
+  else
+  {
+    if(into->current.active)
+    {
+      endContact(into);
+    }
+    if(nextLeft != NULL)
+    {
+      nextLeft->leftOpen = false;
+      if(nextLeft == &next->head)
+      {
+        finalizeContact(into, &next->head);
+      }
+    }
+    into->current = next->current;
+  }
+}
+
+static void joinSessions(sessionAgg_t* into, sessionAgg_t* next, uint32_t interval, uint32_t jumpLimit)
+{
+  into->reports += next->reports;
+  for(uint8_t i = 0; i < 4; i++)
+  {
+    into->kindReports[i] += next->kindReports[i];
+  }
+  into->lastTimestamp = next->lastTimestamp;
+  addInterval(into, interval);
+  statMerge(&into->interval, &next->interval);
+  into->durationUs += next->durationUs;
+  for(uint32_t i = 0; i < ANALYTICS_BUCKETS; i++)
+  {
+    into->histogram[i] += next->histogram[i];
+  }
+  for(uint8_t i = 0; i < ANALYTICS_FINGERS; i++)
+  {
+    joinFinger(&into->fingers[i], &next->fingers[i], interval, jumpLimit);
+  }
+}
+
+static sessionAgg_t* newSession(analytics_t* analytics, uint32_t timestamp)
+{
+  if(analytics->sessionCount == analytics->sessionCapacity)
+  {
+    uint32_t capacity = analytics->sessionCapacity ? analytics->sessionCapacity * 2 : 4;
+    sessionAgg_t* sessions = realloc(analytics->sessions, capacity * sizeof(sessionAgg_t));
+    if(sessions == NULL)
+    {
+      return NULL;
+    }
+    analytics->sessions = sessions;
+    analytics->sessionCapacity = capacity;
+  }
+  sessionAgg_t* session = &analytics->sessions[analytics->sessionCount++];
+  memset(session, 0, sizeof(*session));
+  session->source = analytics->source;
+  session->firstTimestamp = session->lastTimestamp = timestamp;
+  return session;
+}
+
+/************************************************************/
+/************************************************************/
+/********************  PUBLIC FUNCTIONS *********************/
+
+/** source tags the sessions so captures from different files are never joined. */
+void ANALYTICS_init(analytics_t* analytics, uint32_t source, uint32_t gapUs, uint32_t jumpLimit)
+{
+  memset(analytics, 0, sizeof(*analytics));
+  analytics->source = source;
+  analytics->gapUs = gapUs;
+  analytics->jumpLimit = jumpLimit;
+}
+
+void ANALYTICS_free(analytics_t* analytics)
+{
+  free(analytics->sessions);
+  analytics->sessions = NULL;
+  analytics->sessionCount = analytics->sessionCapacity = 0;
+}
+
+/** Feeds one decoded report. timestamp is the board's micros() value; it may
+	wrap. Returns 0, or -1 if memory for a new session ran out. */
+int ANALYTICS_addReport(analytics_t* analytics, uint32_t timestamp, const report_t* report)
+{
+  sessionAgg_t* session = analytics->sessionCount ? &analytics->sessions[analytics->sessionCount - 1] : NULL;
+  uint32_t interval = 0;
+
+  if(session != NULL)
+  {
+    interval = timestamp - session->lastTimestamp;
+    if(interval > analytics->gapUs)
+    {
+      closeSessionRight(session);
+      session = NULL;
+      interval = 0;
+    }
+  }
+  if(session == NULL && (session = newSession(analytics, timestamp)) == NULL)
+  {
+    return -1;
+  }
+  if(session->reports != 0)
+  {
+    addInterval(session, interval);
+  }
+  bool firstOfPartial = analytics->sessionCount == 1 && session->reports == 0;
+  session->reports++;
+  session->lastTimestamp = timestamp;
+
+  uint8_t kind = API_C2_getReportKind(report->reportID);
+  session->kindReports[kind]++;
+  if(kind != REPORT_KIND_ABSOLUTE)
+  {
+    return 0;
+  }
+
+  report_t* abs = (report_t*)report; // the API_C2_ queries don't take const
+  for(uint8_t i = 0; i < ANALYTICS_FINGERS; i++)
+  {
+    fingerAgg_t* finger = &session->fingers[i];
+    contact_t* contact = &finger->current;
+
+    if(!API_C2_isFingerContacted(abs, i))
+    {
+      if(contact->active)
+      {
+        endContact(finger);
+      }
+      continue;
+    }
+
+    if(contact->active)
+    {
+      contact->durationUs += interval;
+    }
+    else
+    {
+      memset(contact, 0, sizeof(*contact));
+      contact->active = true;
+      contact->leftOpen = firstOfPartial;
+    }
+    contact->reports++;
+    finger->samples++;
+    if(report->abs.fingers[i].palm & CRQ_ABSOLUTE_PALM_REJECT_MASK)
+    {
+      finger->palmSamples++;
+    }
+    if(API_C2_isFingerValid(abs, i))
+    {
+      finger->validSamples++;
+      addPoint(finger, contact, report->abs.fingers[i].x, report->abs.fingers[i].y, analytics->jumpLimit);
+    }
+  }
+  return 0;
+}
+
+/** Appends next, the partial that directly follows into in the capture, and
+	frees next. Returns 0, or -1 if memory ran out. */
+int ANALYTICS_merge(analytics_t* into, analytics_t* next)
+{
+  uint32_t first = 0;
+
+  into->badFrames += next->badFrames;
+  into->skippedBytes += next->skippedBytes;
+  if(next->sessionCount == 0)
+  {
+    ANALYTICS_free(next);
+    return 0;
+  }
+  if(into->sessionCount != 0)
+  {
+    sessionAgg_t* last = &into->sessions[into->sessionCount - 1];
+    sessionAgg_t* following = &next->sessions[0];
+    uint32_t interval = following->firstTimestamp - last->lastTimestamp;
+
+    if(last->source == following->source && interval <= into->gapUs)
+    {
+      joinSessions(last, following, interval, into->jumpLimit);
+      first = 1;
+    }
+    else
+    {
+      closeSessionRight(last);
+      closeSessionLeft(following);
+    }
+  }
+
+  for(uint32_t i = first; i < next->sessionCount; i++)
+  {
+    sessionAgg_t* session = newSession(into, 0);
+    if(session == NULL)
+    {
+      return -1;
+    }
+    *session = next->sessions[i];
+  }
+  ANALYTICS_free(next);
+  return 0;
+}
+
+/** Closes every contact once the whole capture has been merged. */
+void ANALYTICS_finish(analytics_t* analytics)
+{
+  for(uint32_t i = 0; i < analytics->sessionCount; i++)
+  {
+    closeSessionLeft(&analytics->sessions[i]);
+    closeSessionRight(&analytics->sessions[i]);
+  }
+}
+
+double ANALYTICS_stddev(const statAcc_t* stat)
+{
+  return stat->count > 1 ? sqrt(stat->m2 / (stat->count - 1)) : 0.0;
+}
+
+/** Report interval (microseconds) that fraction of the intervals fall into or below,
+	to the histogram's resolution. */
+double ANALYTICS_intervalPercentile(const sessionAgg_t* session, double fraction)
+{
+  uint64_t target = (uint64_t)ceil(fraction * session->interval.count), seen = 0;
+  for(uint32_t i = 0; i < ANALYTICS_BUCKETS; i++)
+  {
+    seen += session->histogram[i];
+    if(seen >= target && seen != 0)
+    {
+      return i * (double)ANALYTICS_BUCKET_US;
+    }
+  }
+  return session->interval.max;
+}
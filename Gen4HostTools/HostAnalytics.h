@@ -0,0 +1,120 @@
+#ifndef HOSTANALYTICS_H
+#define HOSTANALYTICS_H
+
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+/** @file HostAnalytics.h
+	@brief Touch quality metrics with mergeable partial aggregates.
+
+	A capture is cut into consecutive pieces, each piece is fed report by report
+	into its own analytics_t, and the pieces are merged in capture order. The
+	result is the same as feeding the whole capture into one analytics_t.
+
+	A partial aggregate is a list of sessions (runs of reports without a gap
+	longer than gapUs). Its first session may continue the previous piece and
+	its last may continue into the next, so contacts that are still down at
+	either edge are kept open until the merge can join them. */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "API_C2_Report.h"
+
+#define ANALYTICS_FINGERS          (5)
+#define ANALYTICS_BUCKET_US        (50)   /**< Width of a report interval histogram bucket */
+#define ANALYTICS_BUCKETS          (512)  /**< Last bucket collects everything longer */
+#define ANALYTICS_SHORT_CONTACT    (3)    /**< Contacts with fewer reports count as flicker */
+#define ANALYTICS_STROKE_SAMPLES   (10)   /**< Valid samples needed to judge a stroke's linearity */
+#define ANALYTICS_STROKE_EXTENT    (100.0)/**< RMS extent along the stroke needed to judge it */
+
+/** Count, mean and spread, merged with Chan's parallel update */
+typedef struct
+{
+  uint64_t count;
+  double   mean;
+  double   m2;
+  double   min;
+  double   max;
+} statAcc_t;
+
+/** A contact (finger slot held down) being followed */
+typedef struct
+{
+  bool     active;
+  bool     leftOpen;     /**< Was down at the first report of the partial */
+  uint32_t reports;      /**< Reports with the finger contacted */
+  uint64_t durationUs;
+  uint32_t validPoints;
+  double   sx, sy, sxx, syy, sxy; /**< Sums of valid positions, for the line fit */
+  uint16_t firstX[2], firstY[2];  /**< First two valid positions */
+  uint16_t lastX[2], lastY[2];    /**< Last two valid positions, newest first */
+} contact_t;
+
+typedef struct
+{
+  uint64_t  samples;        /**< Reports with the finger contacted */
+  uint64_t  validSamples;   /**< ... and marked valid (confident) */
+  uint64_t  palmSamples;    /**< ... and marked palm rejected */
+  uint64_t  contacts;       /**< Finished contacts */
+  uint64_t  shortContacts;  /**< Finished contacts under ANALYTICS_SHORT_CONTACT reports */
+  uint64_t  jumps;          /**< Moves longer than jumpLimit between reports of one contact */
+  uint64_t  jitterCount;
+  double    jitterX, jitterY; /**< Sums of squared second differences */
+  uint64_t  strokes;        /**< Contacts long enough to judge linearity */
+  double    strokeDeviation;   /**< Sum of RMS deviations from the fitted line */
+  double    strokeDeviationMax;
+  statAcc_t contactMs;      /**< Duration of finished contacts */
+  contact_t head;           /**< Left-open contact that ended inside the partial */
+  contact_t current;        /**< Contact down at the last report */
+} fingerAgg_t;
+
+typedef struct
+{
+  uint32_t    source;       /**< Caller's file or capture index */
+  uint64_t    reports;
+  uint64_t    kindReports[4]; /**< By REPORT_KIND_ */
+  uint32_t    firstTimestamp;
+  uint32_t    lastTimestamp;
+  uint64_t    durationUs;
+  statAcc_t   interval;     /**< Microseconds between reports */
+  uint32_t    histogram[ANALYTICS_BUCKETS];
+  fingerAgg_t fingers[ANALYTICS_FINGERS];
+} sessionAgg_t;
+
+typedef struct
+{
+  uint32_t      gapUs;      /**< A longer gap (or a clock reset) starts a new session */
+  uint32_t      jumpLimit;  /**< Position change that counts as a jump */
+  uint32_t      source;
+  sessionAgg_t* sessions;
+  uint32_t      sessionCount;
+  uint32_t      sessionCapacity;
+  uint64_t      badFrames;
+  uint64_t      skippedBytes;
+} analytics_t;
+
+/************************************************************/
+/************************************************************/
+/********************  PUBLIC FUNCTIONS *********************/
+
+void ANALYTICS_init(analytics_t* analytics, uint32_t source, uint32_t gapUs, uint32_t jumpLimit);
+
+void ANALYTICS_free(analytics_t* analytics);
+
+int ANALYTICS_addReport(analytics_t* analytics, uint32_t timestamp, const report_t* report);
+
+int ANALYTICS_merge(analytics_t* into, analytics_t* next);
+
+void ANALYTICS_finish(analytics_t* analytics);
+
+double ANALYTICS_stddev(const statAcc_t* stat);
+
+double ANALYTICS_intervalPercentile(const sessionAgg_t* session, double fraction);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,296 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+#include "HostCommand.h"
+#include "HostUtil.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+/************************************************************/
+/************************************************************/
+/******************* HELPER FUNCTIONS ***********************/
+
+static void put32(uint8_t* data, uint32_t value)
+{
+  data[0] = (uint8_t)(value & 0xFF);
+  data[1] = (uint8_t)((value >> 8) & 0xFF);
+  data[2] = (uint8_t)((value >> 16) & 0xFF);
+  data[3] = (uint8_t)(value >> 24);
+}
+
+static void put16(uint8_t* data, uint16_t value)
+{
+  data[0] = (uint8_t)(value & 0xFF);
+  data[1] = (uint8_t)(value >> 8);
+}
+
+static uint32_t get32(const uint8_t* data)
+{
+  return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+/** Files a STREAM_TYPE_REGION_DATA frame of the region being collected. */
+static void collectRegion(cmdRegion_t* region, const streamFrame_t* frame)
+{
+  if(!region->active || frame->length < COMMAND_REGION_HEADER
+     || (uint16_t)(frame->payload[0] | (frame->payload[1] << 8)) != region->requestId)
+  {
+    return;
+  }
+  uint32_t offset = get32(&frame->payload[2]);
+  uint32_t count = frame->length - COMMAND_REGION_HEADER;
+  if(offset <= region->length && count <= region->length - offset)
+  {
+    memcpy(region->data + offset, frame->payload + COMMAND_REGION_HEADER, count);
+    region->received += count;
+    region->chunks++;
+    region->status |= frame->payload[6];
+  }
+}
+
+/** Parses buffered bytes. Returns true with response filled at the first response frame. */
+static bool parseBuffered(cmdLink_t* link, cmdResponse_t* response)
+{
+  while(link->bufferIndex < link->bufferLength)
+  {
+    if(!API_Stream_parseByte(&link->parser, link->buffer[link->bufferIndex++]))
+    {
+      continue;
+    }
+    const streamFrame_t* frame = &link->parser.frame;
+    if(frame->type == STREAM_TYPE_REGION_DATA)
+    {
+      collectRegion(&link->region, frame);
+      continue;
+    }
+    if(frame->type != STREAM_TYPE_RESPONSE || frame->length < COMMAND_RESPONSE_HEADER)
+    {
+      link->skippedFrames++;
+      continue;
+    }
+    response->requestId = (uint16_t)(frame->payload[0] | (frame->payload[1] << 8));
+    response->opcode = frame->payload[2];
+    response->status = frame->payload[3];
+    response->length = frame->length - COMMAND_RESPONSE_HEADER;
+    memcpy(response->data, frame->payload + COMMAND_RESPONSE_HEADER, response->length);
+    link->received++;
+    return true;
+  }
+  return false;
+}
+
+/** Reads more input into the buffer, waiting until deadline at most.
+	Returns 1 when bytes arrived, 0 on timeout, -1 on a read error or end of file. */
+static int fillBuffer(cmdLink_t* link, uint64_t deadline)
+{
+  for(;;)
+  {
+    uint64_t now = HOST_nowNs();
+    struct pollfd pfd = { link->fd, POLLIN, 0 };
+    if(now >= deadline)
+    {
+      return 0;
+    }
+    int ready = poll(&pfd, 1, (int)((deadline - now + 999999) / 1000000));
+    if(ready < 0 && errno == EINTR)
+    {
+      continue;
+    }
+    if(ready <= 0)
+    {
+      return ready;
+    }
+    ssize_t count = read(link->fd, link->buffer, sizeof(link->buffer));
+    if(count < 0 && (errno == EINTR || errno == EAGAIN))
+    {
+      continue;
+    }
+    if(count <= 0)
+    {
+      return -1;
+    }
+    link->bufferIndex = 0;
+    link->bufferLength = (uint16_t)count;
+    return 1;
+  }
+}
+
+/************************************************************/
+/************************************************************/
+/********************  PUBLIC FUNCTIONS *********************/
+
+/** fd is the board's serial port, open read/write (see HOST_openSerial).
+	Input already waiting, such as responses meant for an earlier session, is discarded. */
+void CMDLINK_init(cmdLink_t* link, int fd)
+{
+  tcflush(fd, TCIFLUSH);
+  memset(link, 0, sizeof(*link));
+  link->fd = fd;
+  API_Stream_initParser(&link->parser);
+}
+
+/** Sends a command without waiting for its response.
+	Returns the request ID, or -1 if the arguments are too long or the write failed. */
+int CMDLINK_send(cmdLink_t* link, uint8_t opcode, const uint8_t* args, uint16_t length)
+{
+  uint8_t payload[STREAM_MAX_PAYLOAD];
+  uint8_t frame[STREAM_MAX_FRAME];
+  uint16_t id = link->nextId++;
+
+  if(length > STREAM_MAX_PAYLOAD - COMMAND_HEADER_SIZE)
+  {
+    errno = EMSGSIZE;
+    return -1;
+  }
+  put16(payload, id);
+  payload[2] = opcode;
+  if(length > 0)
+  {
+    memcpy(payload + COMMAND_HEADER_SIZE, args, length);
+  }
+  uint16_t frameLength = API_Stream_encodeFrame(STREAM_TYPE_COMMAND, (uint32_t)(HOST_nowNs() / 1000),
+                                                payload, COMMAND_HEADER_SIZE + length, frame);
+  if(HOST_writeAll(link->fd, frame, frameLength) != 0)
+  {
+    return -1;
+  }
+  link->sent++;
+  return id;
+}
+
+int CMDLINK_sendRead(cmdLink_t* link, uint32_t address, uint16_t count)
+{
+  uint8_t args[6];
+  put32(args, address);
+  put16(&args[4], count);
+  return CMDLINK_send(link, COMMAND_READ_MEMORY, args, sizeof(args));
+}
+
+int CMDLINK_sendWrite(cmdLink_t* link, uint32_t address, const uint8_t* data, uint16_t count)
+{
+  uint8_t args[STREAM_MAX_PAYLOAD];
+  if(count > STREAM_MAX_PAYLOAD - COMMAND_HEADER_SIZE - 4)
+  {
+    errno = EMSGSIZE;
+    return -1;
+  }
+  put32(args, address);
+  memcpy(&args[4], data, count);
+  return CMDLINK_send(link, COMMAND_WRITE_MEMORY, args, 4 + count);
+}
+
+int CMDLINK_sendBatch(cmdLink_t* link, const cmdRange_t* ranges, uint16_t rangeCount)
+{
+  uint8_t args[STREAM_MAX_PAYLOAD];
+  if(rangeCount * 6u > STREAM_MAX_PAYLOAD - COMMAND_HEADER_SIZE)
+  {
+    errno = EMSGSIZE;
+    return -1;
+  }
+  for(uint16_t i = 0; i < rangeCount; i++)
+  {
+    put32(&args[i * 6], ranges[i].address);
+    put16(&args[i * 6 + 4], ranges[i].count);
+  }
+  return CMDLINK_send(link, COMMAND_READ_BATCH, args, rangeCount * 6);
+}
+
+int CMDLINK_sendAction(cmdLink_t* link, uint8_t action)
+{
+  return CMDLINK_send(link, COMMAND_ACTION, &action, 1);
+}
+
+int CMDLINK_sendRegion(cmdLink_t* link, uint32_t address, uint32_t length)
+{
+  uint8_t args[8];
+  put32(args, address);
+  put32(&args[4], length);
+  return CMDLINK_send(link, COMMAND_READ_REGION, args, sizeof(args));
+}
+
+/** Waits up to timeoutMs for the next response.
+	Returns 1 with response filled, 0 on timeout, -1 on a read error or end of file. */
+int CMDLINK_receive(cmdLink_t* link, cmdResponse_t* response, int timeoutMs)
+{
+  uint64_t deadline = HOST_nowNs() + (uint64_t)timeoutMs * 1000000u;
+
+  while(!parseBuffered(link, response))
+  {
+    int result = fillBuffer(link, deadline);
+    if(result <= 0)
+    {
+      return result;
+    }
+  }
+  return 1;
+}
+
+/** Reads length bytes from address into data with READ_REGION, waiting up to
+	timeoutMs for the response and then for each chunk. No other command may be
+	in flight. Returns the Host Bus flags of every chunk (0 when all were read
+	cleanly), the response status if the board refused the command, or -1 on
+	a timeout, read error or end of file. */
+int CMDLINK_readRegion(cmdLink_t* link, uint32_t address, uint8_t* data, uint32_t length, int timeoutMs)
+{
+  cmdRegion_t* region = &link->region;
+  cmdResponse_t response;
+
+  int id = CMDLINK_sendRegion(link, address, length);
+  if(id < 0)
+  {
+    return -1;
+  }
+  memset(region, 0, sizeof(*region));
+  region->requestId = (uint16_t)id;
+  region->data = data;
+  region->length = length;
+  region->active = true;
+
+  int result = CMDLINK_receive(link, &response, timeoutMs);
+  if(result <= 0 || response.requestId != (uint16_t)id)
+  {
+    region->active = false;
+    return -1;
+  }
+  if(response.status != 0)
+  {
+    region->active = false;
+    return response.status;
+  }
+  while(region->received < length)
+  {
+    // a response here is not ours: nothing else should be in flight
+    if(parseBuffered(link, &response) || region->received >= length)
+    {
+      continue;
+    }
+    if(fillBuffer(link, HOST_nowNs() + (uint64_t)timeoutMs * 1000000u) <= 0)
+    {
+      region->active = false;
+      return -1;
+    }
+  }
+  region->active = false;
+  return region->status;
+}
+
+const char* CMDLINK_opcodeName(uint8_t opcode)
+{
+  switch(opcode)
+  {
+    case COMMAND_PING:         return "ping";
+    case COMMAND_READ_MEMORY:  return "read";
+    case COMMAND_WRITE_MEMORY: return "write";
+    case COMMAND_READ_BATCH:   return "batch";
+    case COMMAND_ACTION:       return "action";
+    case COMMAND_SYSTEM_INFO:  return "info";
+    case COMMAND_READ_REGION:  return "region";
+    case COMMAND_STATS:        return "stats";
+    case COMMAND_HAPTIC:       return "haptic";
+    case COMMAND_WATCH:        return "watch";
+    default:                   return "unknown";
+  }
+}
@@ -0,0 +1,95 @@
+#ifndef HOSTCOMMAND_H
+#define HOSTCOMMAND_H
+
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+/** @file HostCommand.h
+	@brief Host end of the dev kit's binary command channel (API_Command.h).
+
+	CMDLINK_send writes a command frame and returns at once with the request
+	ID it used, so any number of commands can be in flight. CMDLINK_receive
+	returns the responses in the order the board ran the commands. Report
+	frames and menu text that arrive in between are skipped.
+	CMDLINK_readRegion reads a region of any length with READ_REGION and
+	collects the STREAM_TYPE_REGION_DATA frames that follow its response. */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "API_Command.h"
+#include "API_Stream.h"
+
+/** A response, decoded from a STREAM_TYPE_RESPONSE frame */
+typedef struct
+{
+  uint16_t requestId;
+  uint8_t  opcode;
+  uint8_t  status;        /**< COMMAND_STATUS_ flags, 0 on success */
+  uint16_t length;        /**< Bytes in data */
+  uint8_t  data[COMMAND_MAX_DATA];
+} cmdResponse_t;
+
+/** A READ_REGION being collected */
+typedef struct
+{
+  bool     active;
+  uint16_t requestId;
+  uint8_t* data;
+  uint32_t length;
+  uint32_t received;      /**< Bytes, counting each chunk once */
+  uint32_t chunks;
+  uint8_t  status;        /**< Host Bus flags of every chunk */
+} cmdRegion_t;
+
+typedef struct
+{
+  int            fd;
+  uint16_t       nextId;
+  streamParser_t parser;
+  uint8_t        buffer[4096]; /**< Bytes read but not parsed yet */
+  uint16_t       bufferIndex;
+  uint16_t       bufferLength;
+  uint32_t       sent;
+  uint32_t       received;
+  uint32_t       skippedFrames; /**< Frames other than responses */
+  cmdRegion_t    region;
+} cmdLink_t;
+
+/** One range of a READ_BATCH command */
+typedef struct
+{
+  uint32_t address;
+  uint16_t count;
+} cmdRange_t;
+
+/************************************************************/
+/************************************************************/
+/********************  PUBLIC FUNCTIONS *********************/
+
+void CMDLINK_init(cmdLink_t* link, int fd);
+
+int CMDLINK_send(cmdLink_t* link, uint8_t opcode, const uint8_t* args, uint16_t length);
+
+int CMDLINK_sendRead(cmdLink_t* link, uint32_t address, uint16_t count);
+
+int CMDLINK_sendWrite(cmdLink_t* link, uint32_t address, const uint8_t* data, uint16_t count);
+
+int CMDLINK_sendBatch(cmdLink_t* link, const cmdRange_t* ranges, uint16_t rangeCount);
+
+int CMDLINK_sendAction(cmdLink_t* link, uint8_t action);
+
+int CMDLINK_sendRegion(cmdLink_t* link, uint32_t address, uint32_t length);
+
+int CMDLINK_receive(cmdLink_t* link, cmdResponse_t* response, int timeoutMs);
+
+int CMDLINK_readRegion(cmdLink_t* link, uint32_t address, uint8_t* data, uint32_t length, int timeoutMs);
+
+const char* CMDLINK_opcodeName(uint8_t opcode);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
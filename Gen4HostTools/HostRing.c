@@ -0,0 +1,264 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+#define _GNU_SOURCE
+#include "HostRing.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+/************************************************************/
+/************************************************************/
+/******************* HELPER FUNCTIONS ***********************/
+
+static size_t slotsOffset(void)
+{
+  return (sizeof(ringHeader_t) + RING_CACHE_LINE - 1) & ~(size_t)(RING_CACHE_LINE - 1);
+}
+
+static size_t mappingSize(uint32_t slotCount)
+{
+  return slotsOffset() + (size_t)slotCount * sizeof(ringSlot_t);
+}
+
+static int futex(_Atomic uint32_t* word, int op, uint32_t value, const struct timespec* timeout)
+{
+  // shared mappings need the non-private futex ops
+  return (int)syscall(SYS_futex, (uint32_t*)word, op, value, timeout, NULL, 0);
+}
+
+static void setName(ring_t* ring, const char* name)
+{
+  strncpy(ring->name, name, sizeof(ring->name) - 1);
+  ring->name[sizeof(ring->name) - 1] = '\0';
+}
+
+/************************************************************/
+/************************************************************/
+/********************  PUBLIC FUNCTIONS *********************/
+
+/** Creates (or replaces) the shared memory ring called name with slotCount 
+	slots, rounded up to a power of two. Returns 0 or -1 with errno set. */
+int RING_create(ring_t* ring, const char* name, uint32_t slotCount, const char* source)
+{
+  uint32_t count = 1;
+  while(count < slotCount && count < (1u << 30))
+  {
+    count <<= 1;
+  }
+
+  int fd = shm_open(name, O_CREAT | O_RDWR, 0644);
+  if(fd < 0)
+  {
+    return -1;
+  }
+  size_t size = mappingSize(count);
+  if(ftruncate(fd, 0) != 0 || ftruncate(fd, (off_t)size) != 0)
+  {
+    close(fd);
+    shm_unlink(name);
+    return -1;
+  }
+  void* map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if(map == MAP_FAILED)
+  {
+    shm_unlink(name);
+    return -1;
+  }
+
+  ring->header = (ringHeader_t*)map;
+  ring->slots = (ringSlot_t*)((uint8_t*)map + slotsOffset());
+  ring->mapSize = size;
+  ring->owner = true;
+  setName(ring, name);
+
+  // ftruncate zero filled everything, so every slot starts with sequence 0
+  ringHeader_t* header = ring->header;
+  header->version = RING_VERSION;
+  header->slotCount = count;
+  header->slotSize = sizeof(ringSlot_t);
+  strncpy(header->source, source ? source : "", sizeof(header->source) - 1);
+  atomic_store_explicit(&header->published, 0, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+  header->magic = RING_MAGIC; // readers check this last
+  return 0;
+}
+
+/** Maps an existing ring read-only. Returns 0 or -1 with errno set
+	(EPROTO if the ring was made by an incompatible writer). */
+int RING_open(ring_t* ring, const char* name)
+{
+  int fd = shm_open(name, O_RDONLY, 0);
+  if(fd < 0)
+  {
+    return -1;
+  }
+  struct stat st;
+  if(fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(ringHeader_t))
+  {
+    close(fd);
+    errno = EPROTO;
+    return -1;
+  }
+  void* map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if(map == MAP_FAILED)
+  {
+    return -1;
+  }
+
+  ringHeader_t* header = (ringHeader_t*)map;
+  if(header->magic != RING_MAGIC || header->version != RING_VERSION
+     || header->slotSize != sizeof(ringSlot_t)
+     || (size_t)st.st_size < mappingSize(header->slotCount))
+  {
+    munmap(map, (size_t)st.st_size);
+    errno = EPROTO;
+    return -1;
+  }
+
+  ring->header = header;
+  ring->slots = (ringSlot_t*)((uint8_t*)map + slotsOffset());
+  ring->mapSize = (size_t)st.st_size;
+  ring->owner = false;
+  setName(ring, name);
+  return 0;
+}
+
+/** Unmaps the ring. The writer also removes the shared memory object;
+	readers that still have it mapped keep working until they close it. */
+void RING_close(ring_t* ring)
+{
+  if(ring->header == NULL)
+  {
+    return;
+  }
+  if(ring->owner)
+  {
+    ring->header->magic = 0;
+    shm_unlink(ring->name);
+  }
+  munmap(ring->header, ring->mapSize);
+  ring->header = NULL;
+  ring->slots = NULL;
+}
+
+/** Returns the slot for the next report and marks it as being written.
+	Fill it in place, then call RING_commitWrite. Writer only. */
+ringSlot_t* RING_beginWrite(ring_t* ring)
+{
+  uint64_t n = atomic_load_explicit(&ring->header->published, memory_order_relaxed);
+  ringSlot_t* slot = &ring->slots[n & (ring->header->slotCount - 1)];
+  atomic_store_explicit(&slot->sequence, 2 * n + 1, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release); // odd sequence is visible before any data changes
+  return slot;
+}
+
+/** Publishes the slot returned by RING_beginWrite and wakes sleeping readers. */
+void RING_commitWrite(ring_t* ring, ringSlot_t* slot)
+{
+  ringHeader_t* header = ring->header;
+  uint64_t n = atomic_load_explicit(&header->published, memory_order_relaxed);
+  atomic_store_explicit(&slot->sequence, 2 * n + 2, memory_order_release);
+  atomic_store_explicit(&header->published, n + 1, memory_order_release);
+
+  // readers map the ring read-only and can't register as waiters, so wake 
+  // unconditionally; FUTEX_WAKE with no sleepers returns without blocking
+  atomic_fetch_add_explicit(&header->wakeup, 1, memory_order_release);
+  futex(&header->wakeup, FUTEX_WAKE, INT_MAX, NULL);
+}
+
+/** Starts a reader at the newest report, or at the oldest one still in the ring. */
+void RING_attach(ringReader_t* reader, ring_t* ring, bool fromOldest)
+{
+  uint64_t published = atomic_load_explicit(&ring->header->published, memory_order_acquire);
+  uint64_t count = ring->header->slotCount;
+
+  reader->ring = ring;
+  reader->lost = 0;
+  reader->sequence = 0;
+  if(fromOldest)
+  {
+    reader->next = (published > count) ? published - count : 0;
+  }
+  else
+  {
+    reader->next = published;
+  }
+}
+
+/** Returns the next unread slot, without copying it, or NULL if the reader 
+	has caught up. The slot must be handed back with RING_release, which says 
+	whether the data read from it in the meantime can be trusted. */
+const ringSlot_t* RING_peek(ringReader_t* reader)
+{
+  ringHeader_t* header = reader->ring->header;
+  uint64_t count = header->slotCount;
+
+  for(;;)
+  {
+    uint64_t published = atomic_load_explicit(&header->published, memory_order_acquire);
+    if(reader->next >= published)
+    {
+      return NULL;
+    }
+    if(published - reader->next > count)
+    {
+      // lapped: everything older than one ring's worth is gone
+      reader->lost += published - count - reader->next;
+      reader->next = published - count;
+    }
+
+    const ringSlot_t* slot = &reader->ring->slots[reader->next & (count - 1)];
+    uint64_t sequence = atomic_load_explicit(&((ringSlot_t*)slot)->sequence, memory_order_acquire);
+    if(sequence == 2 * reader->next + 2)
+    {
+      reader->sequence = sequence;
+      return slot;
+    }
+    // the writer already reused this slot for a newer report
+    reader->lost++;
+    reader->next++;
+  }
+}
+
+/** Finishes with a slot from RING_peek and moves to the next report.
+	Returns false if the writer overwrote the slot while it was being used,
+	in which case anything read from it must be discarded. */
+bool RING_release(ringReader_t* reader, const ringSlot_t* slot)
+{
+  atomic_thread_fence(memory_order_acquire); // data reads complete before the re-check
+  uint64_t sequence = atomic_load_explicit(&((ringSlot_t*)slot)->sequence, memory_order_relaxed);
+  reader->next++;
+  if(sequence != reader->sequence)
+  {
+    reader->lost++;
+    return false;
+  }
+  return true;
+}
+
+/** Sleeps until a report newer than the reader's position is published or
+	timeoutMs passes (a negative timeout waits forever). Returns true if there
+	is something to read. The writer is never held up by sleeping readers. */
+bool RING_wait(ringReader_t* reader, int timeoutMs)
+{
+  ringHeader_t* header = reader->ring->header;
+  struct timespec timeout = { timeoutMs / 1000, (long)(timeoutMs % 1000) * 1000000L };
+
+  uint32_t wakeup = atomic_load_explicit(&header->wakeup, memory_order_acquire);
+  if(atomic_load_explicit(&header->published, memory_order_acquire) > reader->next)
+  {
+    return true;
+  }
+  futex(&header->wakeup, FUTEX_WAIT, wakeup, timeoutMs < 0 ? NULL : &timeout);
+  return atomic_load_explicit(&header->published, memory_order_acquire) > reader->next;
+}
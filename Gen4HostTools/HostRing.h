@@ -0,0 +1,97 @@
+#ifndef HOSTRING_H
+#define HOSTRING_H
+
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+/** @file HostRing.h
+	@brief Lock-free, single writer / many reader report ring in POSIX shared memory.
+
+	The writer (gen4fanoutd) never waits for readers. Each slot carries a sequence
+	number that the writer makes odd while it fills the slot and even once the
+	slot is published, so a reader can use a slot in place and then check that 
+	the writer did not lap it in the meantime (a seqlock). Readers that fall 
+	more than slotCount reports behind skip ahead and count the loss. */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include "API_C2_Report.h"
+
+#define RING_MAGIC          (0x47345247u) /**< "GR4G" */
+#define RING_VERSION        (1)
+#define RING_DEFAULT_NAME   "/gen4-reports"
+#define RING_DEFAULT_SLOTS  (4096)
+#define RING_CACHE_LINE     (64)
+
+/** One published report. Slots are cache line aligned so the writer
+	never shares a line between the slot being written and one being read. */
+typedef struct
+{
+  _Atomic uint64_t sequence;     /**< 2n+1 while report n is written, 2n+2 once it is published */
+  uint64_t hostTime;             /**< CLOCK_MONOTONIC ns when the frame was received */
+  uint32_t deviceTime;           /**< Board micros() from the stream frame */
+  uint8_t  packet[PACKET_SIZE];  /**< Raw packet as read from the touch controller */
+  report_t report;               /**< Packet decoded with API_C2_decodeReport */
+} __attribute__((aligned(RING_CACHE_LINE))) ringSlot_t;
+
+/** Shared header at the start of the mapping. */
+typedef struct
+{
+  uint32_t magic;
+  uint32_t version;
+  uint32_t slotCount;            /**< Always a power of two */
+  uint32_t slotSize;             /**< sizeof(ringSlot_t) of the writer, checked by readers */
+  char     source[64];           /**< Device the writer is reading from */
+  _Atomic uint64_t published __attribute__((aligned(RING_CACHE_LINE))); /**< Reports published so far */
+  _Atomic uint32_t wakeup;       /**< Futex word bumped on every publish */
+  _Atomic uint64_t badFrames;    /**< Corrupt frames seen by the writer */
+  _Atomic uint64_t skippedBytes; /**< Non-frame bytes (menu text) seen by the writer */
+} __attribute__((aligned(RING_CACHE_LINE))) ringHeader_t;
+
+typedef struct
+{
+  ringHeader_t* header;
+  ringSlot_t*   slots;
+  size_t        mapSize;
+  bool          owner;
+  char          name[64];
+} ring_t;
+
+typedef struct
+{
+  ring_t*  ring;
+  uint64_t next;      /**< Number of the next report to read */
+  uint64_t sequence;  /**< Sequence seen by the last RING_peek */
+  uint64_t lost;      /**< Reports overwritten before this reader got to them */
+} ringReader_t;
+
+/************************************************************/
+/************************************************************/
+/********************  PUBLIC FUNCTIONS *********************/
+
+int RING_create(ring_t* ring, const char* name, uint32_t slotCount, const char* source);
+
+int RING_open(ring_t* ring, const char* name);
+
+void RING_close(ring_t* ring);
+
+ringSlot_t* RING_beginWrite(ring_t* ring);
+
+void RING_commitWrite(ring_t* ring, ringSlot_t* slot);
+
+void RING_attach(ringReader_t* reader, ring_t* ring, bool fromOldest);
+
+const ringSlot_t* RING_peek(ringReader_t* reader);
+
+bool RING_release(ringReader_t* reader, const ringSlot_t* slot);
+
+bool RING_wait(ringReader_t* reader, int timeoutMs);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,191 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+#include "HostSynth.h"
+
+#include <math.h>
+#include <string.h>
+
+#define SYNTH_X_MAX    (2047)
+#define SYNTH_Y_MAX    (1535)
+
+/************************************************************/
+/************************************************************/
+/******************* HELPER FUNCTIONS ***********************/
+
+static uint32_t nextRandom(synth_t* synth)
+{
+  uint32_t x = synth->random;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  synth->random = x;
+  return x;
+}
+
+/** +/- 2 counts of sensor noise */
+static int jitter(synth_t* synth)
+{
+  return (int)(nextRandom(synth) % 5) - 2;
+}
+
+static uint16_t clampAxis(int value, int max)
+{
+  if(value < 0)
+  {
+    return 0;
+  }
+  return (uint16_t)(value > max ? max : value);
+}
+
+/** Builds a plausible absolute report: finger 0 traces a circle, finger 1 joins
+	it for part of each cycle, and every few seconds there is a lift, a palm and
+	a button click so event code has something to find. */
+static void makeAbsolute(synth_t* synth, report_t* report)
+{
+  uint32_t ms = (uint32_t)((uint64_t)synth->frame * synth->periodUs / 1000);
+  uint32_t phase = ms % 3000;
+  double angle = (double)ms / 1000.0;
+
+  memset(report, 0, sizeof(*report));
+  report->reportID = CRQ_ABSOLUTE_REPORT_ID;
+
+  for(uint8_t i = 0; i < 2; i++)
+  {
+    bool down = (i == 0) ? (phase < 2600) : (phase > 800 && phase < 2000);
+    if(!down)
+    {
+      // lifted fingers keep reporting their last location, without confidence
+      report->abs.fingers[i].x = synth->lastX[i];
+      report->abs.fingers[i].y = synth->lastY[i];
+      continue;
+    }
+    double radius = 400.0 + 150.0 * i;
+    int x = (int)(1024 + radius * cos(angle + i * 1.5)) + jitter(synth);
+    int y = (int)(768 + radius * sin(angle + i * 1.5)) + jitter(synth);
+    report->abs.fingers[i].x = synth->lastX[i] = clampAxis(x, SYNTH_X_MAX);
+    report->abs.fingers[i].y = synth->lastY[i] = clampAxis(y, SYNTH_Y_MAX);
+    report->abs.contactFlags |= (uint8_t)(1 << i);
+    // the first couple of frames after touch down are low confidence
+    bool settling = (i == 0) ? (phase < 20) : (phase < 820);
+    report->abs.fingers[i].palm = settling ? CRQ_ABSOLUTE_SINGLE_SAMPLE_MASK 
+                                           : CRQ_ABSOLUTE_CONFIDENCE_MASK;
+  }
+
+  if(phase >= 2700 && phase < 2800)
+  {
+    report->abs.contactFlags |= 0x04;
+    report->abs.fingers[2].x = 1800;
+    report->abs.fingers[2].y = 1400;
+    report->abs.fingers[2].palm = CRQ_ABSOLUTE_PALM_REJECT_MASK;
+  }
+  if(phase >= 1000 && phase < 1100)
+  {
+    report->abs.buttons = BUTTON_1_MASK;
+  }
+}
+
+static void makeMouse(synth_t* synth, report_t* report)
+{
+  uint32_t ms = (uint32_t)((uint64_t)synth->frame * synth->periodUs / 1000);
+  double angle = (double)ms / 1000.0;
+
+  memset(report, 0, sizeof(*report));
+  report->reportID = MOUSE_REPORT_ID;
+  report->mouse.xDelta = (int8_t)(6.0 * cos(angle) + jitter(synth));
+  report->mouse.yDelta = (int8_t)(6.0 * sin(angle) + jitter(synth));
+  if(ms % 3000 >= 1000 && ms % 3000 < 1100)
+  {
+    report->mouse.buttons = BUTTON_1_MASK;
+  }
+}
+
+/************************************************************/
+/************************************************************/
+/********************  PUBLIC FUNCTIONS *********************/
+
+void SYNTH_init(synth_t* synth, uint8_t reportID, uint32_t periodUs, uint32_t seed)
+{
+  memset(synth, 0, sizeof(*synth));
+  synth->reportID = reportID;
+  synth->periodUs = periodUs ? periodUs : 1;
+  synth->random = seed ? seed : 0x1CA037;
+}
+
+/** Produces the next PACKET_SIZE byte packet of the synthetic session. */
+void SYNTH_nextPacket(synth_t* synth, uint8_t* packet)
+{
+  report_t report;
+  if(synth->reportID == MOUSE_REPORT_ID)
+  {
+    makeMouse(synth, &report);
+  }
+  else
+  {
+    makeAbsolute(synth, &report);
+    report.reportID = synth->reportID; // CRQ absolute or Precision Touchpad
+  }
+  synth->frame++;
+  SYNTH_encodeReport(&report, packet);
+}
+
+/** The inverse of API_C2_decodeReport: lays report out as the controller
+	would send it. Unused trailing bytes of the PACKET_SIZE buffer are zeroed. */
+void SYNTH_encodeReport(const report_t* report, uint8_t* packet)
+{
+  uint8_t* iter = &packet[3];
+  uint16_t length;
+
+  memset(packet, 0, PACKET_SIZE);
+  packet[2] = report->reportID;
+  switch(report->reportID)
+  {
+    case MOUSE_REPORT_ID:
+      *iter++ = report->mouse.buttons;
+      *iter++ = (uint8_t)report->mouse.xDelta;
+      *iter++ = (uint8_t)report->mouse.yDelta;
+      *iter++ = (uint8_t)report->mouse.scrollDelta;
+      *iter++ = (uint8_t)report->mouse.panDelta;
+      break;
+    case KEYBOARD_REPORT_ID:
+      *iter++ = report->keyboard.modifier;
+      iter++; // reserved byte
+      for(uint8_t i = 0; i < 6; i++)
+      {
+        *iter++ = report->keyboard.keycode[i];
+      }
+      break;
+    case CRQ_ABSOLUTE_REPORT_ID:
+      *iter++ = report->abs.contactFlags;
+      for(uint8_t i = 0; i < 5; i++)
+      {
+        *iter++ = report->abs.fingers[i].palm;
+        *iter++ = (uint8_t)(report->abs.fingers[i].x & 0xFF);
+        *iter++ = (uint8_t)(report->abs.fingers[i].x >> 8);
+        *iter++ = (uint8_t)(report->abs.fingers[i].y & 0xFF);
+        *iter++ = (uint8_t)(report->abs.fingers[i].y >> 8);
+      }
+      *iter++ = report->abs.buttons;
+      break;
+    case PTP_REPORT_ID:
+      // contact ID = finger slot; confidence bit 0, tip switch bit 1
+      for(uint8_t i = 0; i < 5; i++)
+      {
+        bool tip = report->abs.contactFlags & (1 << i);
+        bool confident = !(report->abs.fingers[i].palm & CRQ_ABSOLUTE_PALM_REJECT_MASK);
+        *iter++ = (uint8_t)((i << 2) | (tip ? 0x02 : 0) | ((tip && confident) ? 0x01 : 0));
+        *iter++ = (uint8_t)(report->abs.fingers[i].x & 0xFF);
+        *iter++ = (uint8_t)(report->abs.fingers[i].x >> 8);
+        *iter++ = (uint8_t)(report->abs.fingers[i].y & 0xFF);
+        *iter++ = (uint8_t)(report->abs.fingers[i].y >> 8);
+      }
+      iter += 2; // scan time
+      *iter++ = (uint8_t)__builtin_popcount(report->abs.contactFlags);
+      *iter++ = report->abs.buttons & 0x07;
+      break;
+    default:
+      break;
+  }
+  length = (uint16_t)(iter - packet);
+  packet[0] = (uint8_t)(length & 0xFF);
+  packet[1] = (uint8_t)(length >> 8);
+}
@@ -0,0 +1,43 @@
+#ifndef HOSTSYNTH_H
+#define HOSTSYNTH_H
+
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+/** @file HostSynth.h
+	@brief Synthetic Gen4 report packets for exercising host tools without hardware.
+
+	Packets use the exact wire layout HB_readReport returns (two length bytes,
+	report ID, report data) so they decode with API_C2_decodeReport. */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "API_C2_Report.h"
+
+typedef struct
+{
+  uint8_t  reportID;     /**< MOUSE_REPORT_ID, CRQ_ABSOLUTE_REPORT_ID or PTP_REPORT_ID */
+  uint32_t frame;        /**< Packets generated so far */
+  uint32_t periodUs;     /**< Nominal report period, used for motion speed */
+  uint32_t random;       /**< xorshift state for jitter */
+  uint16_t lastX[5];
+  uint16_t lastY[5];
+} synth_t;
+
+/************************************************************/
+/************************************************************/
+/********************  PUBLIC FUNCTIONS *********************/
+
+void SYNTH_init(synth_t* synth, uint8_t reportID, uint32_t periodUs, uint32_t seed);
+
+void SYNTH_nextPacket(synth_t* synth, uint8_t* packet);
+
+void SYNTH_encodeReport(const report_t* report, uint8_t* packet);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
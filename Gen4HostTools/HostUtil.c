@@ -0,0 +1,114 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+#define _GNU_SOURCE
+#include "HostUtil.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+/************************************************************/
+/************************************************************/
+/******************* HELPER FUNCTIONS ***********************/
+
+/** Puts a tty into raw mode: no echo, no line editing and no CR/LF
+	translation, so binary frames pass through untouched. */
+static int setRaw(int fd)
+{
+  struct termios tio;
+  if(tcgetattr(fd, &tio) != 0)
+  {
+    return -1;
+  }
+  cfmakeraw(&tio);
+  tio.c_cc[VMIN] = 1;
+  tio.c_cc[VTIME] = 0;
+  cfsetispeed(&tio, B115200); // ignored by USB serial, which runs at full speed
+  cfsetospeed(&tio, B115200);
+  return tcsetattr(fd, TCSANOW, &tio);
+}
+
+/************************************************************/
+/************************************************************/
+/********************  PUBLIC FUNCTIONS *********************/
+
+/** Returns CLOCK_MONOTONIC in nanoseconds. */
+uint64_t HOST_nowNs(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/** Opens a serial port (tty or pty slave) for reading and writing in raw mode.
+	Returns the file descriptor or -1 with errno set. */
+int HOST_openSerial(const char* path)
+{
+  int fd = open(path, O_RDWR | O_NOCTTY | O_CLOEXEC);
+  if(fd < 0)
+  {
+    return -1;
+  }
+  if(isatty(fd) && setRaw(fd) != 0)
+  {
+    int saved = errno;
+    close(fd);
+    errno = saved;
+    return -1;
+  }
+  return fd;
+}
+
+/** Creates a pseudo terminal and returns its master side. The slave path is 
+	copied into slavePath. If slaveFd is not NULL the slave is also opened and 
+	put in raw mode; keeping it open stops the master from seeing hangups while 
+	readers come and go. */
+int HOST_openPty(char* slavePath, size_t slavePathLength, int* slaveFd)
+{
+  int master = posix_openpt(O_RDWR | O_NOCTTY | O_CLOEXEC);
+  if(master < 0)
+  {
+    return -1;
+  }
+  if(grantpt(master) != 0 || unlockpt(master) != 0 
+     || ptsname_r(master, slavePath, slavePathLength) != 0)
+  {
+    close(master);
+    return -1;
+  }
+  if(slaveFd != NULL)
+  {
+    *slaveFd = HOST_openSerial(slavePath);
+    if(*slaveFd < 0)
+    {
+      close(master);
+      return -1;
+    }
+  }
+  return master;
+}
+
+/** write() that retries on short writes and EINTR. Returns 0 or -1. */
+int HOST_writeAll(int fd, const void* data, size_t length)
+{
+  const uint8_t* iter = (const uint8_t*)data;
+  while(length > 0)
+  {
+    ssize_t written = write(fd, iter, length);
+    if(written < 0)
+    {
+      if(errno == EINTR)
+      {
+        continue;
+      }
+      return -1;
+    }
+    iter += written;
+    length -= (size_t)written;
+  }
+  return 0;
+}
@@ -0,0 +1,31 @@
+#ifndef HOSTUTIL_H
+#define HOSTUTIL_H
+
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+/** @file HostUtil.h
+	@brief Small Linux helpers shared by the Gen4 host tools. */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+/************************************************************/
+/************************************************************/
+/********************  PUBLIC FUNCTIONS *********************/
+
+uint64_t HOST_nowNs(void);
+
+int HOST_openSerial(const char* path);
+
+int HOST_openPty(char* slavePath, size_t slavePathLength, int* slaveFd);
+
+int HOST_writeAll(int fd, const void* data, size_t length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,105 @@
+#ifndef LINUXHAL_H
+#define LINUXHAL_H
+
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+/** @file LinuxHal.h
+	@brief Board functions for running the Gen4DevKit modules on a Linux SBC.
+
+	LinuxI2C.c implements I2C.h on an i2c-dev adapter (/dev/i2c-N) and
+	LinuxHardware.c implements HostDR.h on a GPIO character device line and
+	API_Hardware.h on the monotonic clock, so API_HostBus.c, API_C2.c and the
+	rest run unchanged on a pad wired straight to the SBC's I2C pins.
+
+	Each transaction is one I2C_RDWR ioctl. A write ended without a stop
+	(I2C_endTransmission(false), as in HB_readExtendedMemory) is held back
+	and sent in the same ioctl as the read that follows it, so the read
+	starts with a repeated start and an extended memory read is one system
+	call. Errors of a held write therefore come back from I2C_request. A
+	report read is one ioctl as well.
+
+	Data Ready is requested with both edges, so the line's level is kept
+	from its edge events and HostDR_assertedUs is the kernel's timestamp of
+	the falling edge. HostDR_pinState reads the events waiting, without
+	blocking; LINUXDR_wait sleeps until the line asserts instead of spinning
+	on it, and LINUXDR_fd hands the line to poll or epoll.
+
+	The adapter's clock is set by the device tree, not from user space:
+	I2C_init and I2C_setClock only record the clock asked for. The adapter
+	clears a stuck bus itself, so I2C_recoverBus only counts. The board
+	functions with no Linux counterpart (power, scope pins, button
+	injection, haptics) do nothing.
+
+	The system calls go through a linuxOps_t, normally the C library's.
+	SimLinuxDev.h has stand-ins that answer them from simulated devices, to
+	run the backend without hardware. */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+#define LINUXI2C_BUFFER_SIZE (256)  /**< Largest single write or read */
+
+/** The system calls the backend makes */
+typedef struct
+{
+  int     (*open)(const char* path, int flags);
+  int     (*close)(int fd);
+  int     (*ioctl)(int fd, unsigned long request, void* arg);
+  ssize_t (*read)(int fd, void* buffer, size_t count);
+  ssize_t (*write)(int fd, const void* buffer, size_t count);
+  int     (*poll)(int fd, short events, int timeoutMs);
+} linuxOps_t;
+
+/** System calls made, and the transactions they carried */
+typedef struct
+{
+  uint32_t clockFrequency;     /**< Asked for; the adapter's is fixed */
+  uint32_t syscalls;           /**< All of them, I2C and Data Ready */
+  uint32_t i2cSyscalls;
+  uint32_t drSyscalls;
+  uint32_t transactions;       /**< Start to stop, repeated starts included */
+  uint32_t messages;           /**< Reads and writes within them */
+  uint32_t bytesWritten;
+  uint32_t bytesRead;
+  uint32_t naks;
+  uint32_t timeouts;
+  uint32_t recoveries;
+  uint32_t drEdges;
+} linuxHalStats_t;
+
+/************************************************************/
+/************************************************************/
+/********************  PUBLIC FUNCTIONS *********************/
+
+void LINUXHAL_setOps(const linuxOps_t* ops);
+
+const linuxOps_t* LINUXHAL_getOps(void);
+
+linuxHalStats_t* LINUXHAL_getStats(void);
+
+void LINUXHAL_resetStats(void);
+
+bool LINUXI2C_open(const char* path);
+
+void LINUXI2C_close(void);
+
+void LINUXI2C_setCombined(bool combined);
+
+bool LINUXDR_open(const char* chipPath, uint32_t line);
+
+void LINUXDR_close(void);
+
+int LINUXDR_fd(void);
+
+bool LINUXDR_wait(uint32_t timeoutUs);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,226 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+#include "LinuxHal.h"
+#include "API_Hardware.h"
+#include "HostDR.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <time.h>
+#include <linux/gpio.h>
+
+#define DR_EVENTS_PER_READ (16)
+
+/************************************************************/
+/************************************************************/
+/********************  GLOBAL VARIABLES *********************/
+
+static uint64_t _startUs = 0;
+
+static int _lineFd = -1;
+static bool _level = true;            /**< Host_DR is active low */
+static uint32_t _assertedUs = 0;
+
+/************************************************************/
+/************************************************************/
+/******************* HELPER FUNCTIONS ***********************/
+
+static uint64_t nowUs(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+/** Takes in the edges waiting on the line, without blocking. Event
+	timestamps are CLOCK_MONOTONIC, the clock of API_Hardware_micros. */
+static void readEdges(void)
+{
+  const linuxOps_t* ops = LINUXHAL_getOps();
+  linuxHalStats_t* stats = LINUXHAL_getStats();
+  struct gpio_v2_line_event events[DR_EVENTS_PER_READ];
+
+  if(_lineFd < 0)
+  {
+    return;
+  }
+  stats->syscalls++;
+  stats->drSyscalls++;
+  if(ops->poll(_lineFd, POLLIN, 0) <= 0)
+  {
+    return;
+  }
+  stats->syscalls++;
+  stats->drSyscalls++;
+  ssize_t length = ops->read(_lineFd, events, sizeof(events));
+  for(ssize_t i = 0; length > 0 && i < length / (ssize_t)sizeof(events[0]); i++)
+  {
+    stats->drEdges++;
+    _level = events[i].id == GPIO_V2_LINE_EVENT_RISING_EDGE;
+    if(!_level)
+    {
+      _assertedUs = (uint32_t)(events[i].timestamp_ns / 1000u - _startUs);
+    }
+  }
+}
+
+/************************************************************/
+/************************************************************/
+/********************  PUBLIC FUNCTIONS *********************/
+
+/** Requests line of a GPIO chip such as /dev/gpiochip0 as Host_DR, an
+	input with both edges reported. false with errno set on failure. */
+bool LINUXDR_open(const char* chipPath, uint32_t line)
+{
+  const linuxOps_t* ops = LINUXHAL_getOps();
+  linuxHalStats_t* stats = LINUXHAL_getStats();
+  struct gpio_v2_line_request request;
+  struct gpio_v2_line_values values;
+
+  LINUXDR_close();
+  int chip = ops->open(chipPath, O_RDONLY);
+  if(chip < 0)
+  {
+    return false;
+  }
+  memset(&request, 0, sizeof(request));
+  request.offsets[0] = line;
+  request.num_lines = 1;
+  strncpy(request.consumer, "gen4-dr", sizeof(request.consumer) - 1);
+  request.config.flags = GPIO_V2_LINE_FLAG_INPUT | GPIO_V2_LINE_FLAG_EDGE_RISING | GPIO_V2_LINE_FLAG_EDGE_FALLING;
+  int result = ops->ioctl(chip, GPIO_V2_GET_LINE_IOCTL, &request);
+  int error = errno;
+  ops->close(chip);
+  stats->syscalls += 3;
+  stats->drSyscalls += 3;
+  if(result < 0)
+  {
+    errno = error;
+    return false;
+  }
+  _lineFd = request.fd;
+  values.bits = 0;
+  values.mask = 1;
+  stats->syscalls++;
+  stats->drSyscalls++;
+  if(ops->ioctl(_lineFd, GPIO_V2_LINE_GET_VALUES_IOCTL, &values) < 0)
+  {
+    error = errno;
+    LINUXDR_close();
+    errno = error;
+    return false;
+  }
+  _level = (values.bits & 1) != 0;
+  _assertedUs = (uint32_t)(nowUs() - _startUs);
+  return true;
+}
+
+void LINUXDR_close(void)
+{
+  if(_lineFd >= 0)
+  {
+    LINUXHAL_getOps()->close(_lineFd);
+  }
+  _lineFd = -1;
+  _level = true;
+}
+
+/** The line's file descriptor, readable when an edge is waiting; -1 if
+	none is open. HostDR_pinState takes the edges in. */
+int LINUXDR_fd(void)
+{
+  return _lineFd;
+}
+
+/** Sleeps until Host_DR asserts or timeoutUs pass. true if it is asserted. */
+bool LINUXDR_wait(uint32_t timeoutUs)
+{
+  uint64_t until = nowUs() + timeoutUs;
+  linuxHalStats_t* stats = LINUXHAL_getStats();
+
+  readEdges();
+  while(_level && _lineFd >= 0)
+  {
+    uint64_t now = nowUs();
+    if(now >= until)
+    {
+      break;
+    }
+    stats->syscalls++;
+    stats->drSyscalls++;
+    if(LINUXHAL_getOps()->poll(_lineFd, POLLIN, (int)((until - now + 999) / 1000)) < 0 && errno != EINTR)
+    {
+      break;
+    }
+    readEdges();
+  }
+  return !_level;
+}
+
+/************************************************************/
+/************************************************************/
+/******************* API_Hardware.h API *********************/
+
+void API_Hardware_init(void)
+{
+  _startUs = nowUs();
+}
+
+/** The pad is powered with the board */
+void API_Hardware_PowerOn(void)
+{
+}
+
+void API_Hardware_PowerOff(void)
+{
+}
+
+void API_Hardware_delay(uint32_t ms)
+{
+  struct timespec ts = { (time_t)(ms / 1000), (long)(ms % 1000) * 1000000L };
+  nanosleep(&ts, NULL);
+}
+
+uint32_t API_Hardware_micros(void)
+{
+  return (uint32_t)(nowUs() - _startUs);
+}
+
+void API_Hardware_setScope(uint8_t pin, bool high)
+{
+  (void)pin;
+  (void)high;
+}
+
+void API_Hardware_injectButton(uint8_t button, bool pressed)
+{
+  (void)button;
+  (void)pressed;
+}
+
+void API_Hardware_setHaptic(uint8_t strength)
+{
+  (void)strength;
+}
+
+/************************************************************/
+/************************************************************/
+/*********************** HostDR.h API ***********************/
+
+/** The line is requested with LINUXDR_open, before API_C2_init */
+void HostDR_init(void)
+{
+}
+
+bool HostDR_pinState(void)
+{
+  readEdges();
+  return _level;
+}
+
+uint32_t HostDR_assertedUs(void)
+{
+  return _assertedUs;
+}
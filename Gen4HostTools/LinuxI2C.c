@@ -0,0 +1,370 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+
+/** i2c-dev's I2C_TIMEOUT ioctl, whose name I2C.h gives to a result */
+static const unsigned long _timeoutIoctl = I2C_TIMEOUT;
+#undef I2C_TIMEOUT
+
+#include "LinuxHal.h"
+#include "I2C.h"
+
+/************************************************************/
+/************************************************************/
+/********************  GLOBAL VARIABLES *********************/
+
+static int libcOpen(const char* path, int flags)
+{
+  return open(path, flags);
+}
+
+static int libcIoctl(int fd, unsigned long request, void* arg)
+{
+  return ioctl(fd, request, arg);
+}
+
+static int libcPoll(int fd, short events, int timeoutMs)
+{
+  struct pollfd p = { fd, events, 0 };
+  return poll(&p, 1, timeoutMs);
+}
+
+static const linuxOps_t _libcOps = { libcOpen, close, libcIoctl, read, write, libcPoll };
+static const linuxOps_t* _ops = &_libcOps;
+static linuxHalStats_t _stats;
+
+static int _fd = -1;
+static bool _combined = true;
+static int _slaveAddress = -1;        /**< Set with I2C_SLAVE, for split transfers */
+
+static uint8_t _txAddress;
+static uint8_t _txBuffer[LINUXI2C_BUFFER_SIZE];
+static uint16_t _txLength;
+static bool _txHeld = false;          /**< Written without a stop, goes out with the next read */
+
+static uint8_t _rxBuffer[LINUXI2C_BUFFER_SIZE];
+static uint16_t _rxLength;
+static uint16_t _rxIndex;
+
+/************************************************************/
+/************************************************************/
+/******************* HELPER FUNCTIONS ***********************/
+
+/** The I2C.h result for a failed transfer's errno. The adapters report a
+	missing acknowledge as ENXIO or EREMOTEIO, some as EIO. */
+static uint8_t failure(int error)
+{
+  if(error == ETIMEDOUT || error == EAGAIN)
+  {
+    _stats.timeouts++;
+    return I2C_TIMEOUT;
+  }
+  _stats.naks++;
+  return I2C_NACK;
+}
+
+/** Sends msgs as one transaction, a repeated start between them */
+static uint8_t transfer(struct i2c_msg* msgs, uint32_t count)
+{
+  struct i2c_rdwr_ioctl_data data = { msgs, count };
+
+  if(_fd < 0)
+  {
+    _stats.naks++;
+    return I2C_NACK;
+  }
+  _stats.syscalls++;
+  _stats.i2cSyscalls++;
+  _stats.transactions++;
+  _stats.messages += count;
+  if(_ops->ioctl(_fd, I2C_RDWR, &data) < 0)
+  {
+    return failure(errno);
+  }
+  for(uint32_t i = 0; i < count; i++)
+  {
+    if(msgs[i].flags & I2C_M_RD)
+    {
+      _stats.bytesRead += msgs[i].len;
+    }
+    else
+    {
+      _stats.bytesWritten += msgs[i].len;
+    }
+  }
+  return I2C_SUCCESS;
+}
+
+/** Split transfers: the address is set once with I2C_SLAVE, then each
+	write() or read() is a transaction of its own */
+static bool setSlave(uint8_t address)
+{
+  if(_slaveAddress == address)
+  {
+    return true;
+  }
+  _stats.syscalls++;
+  _stats.i2cSyscalls++;
+  if(_ops->ioctl(_fd, I2C_SLAVE, (void*)(unsigned long)address) < 0)
+  {
+    _slaveAddress = -1;
+    return false;
+  }
+  _slaveAddress = address;
+  return true;
+}
+
+static uint8_t splitTransfer(uint8_t address, uint8_t* buffer, uint16_t length, bool reading)
+{
+  if(_fd < 0)
+  {
+    _stats.naks++;
+    return I2C_NACK;
+  }
+  if(!setSlave(address))
+  {
+    return failure(errno);
+  }
+  _stats.syscalls++;
+  _stats.i2cSyscalls++;
+  _stats.transactions++;
+  _stats.messages++;
+  ssize_t done = reading ? _ops->read(_fd, buffer, length) : _ops->write(_fd, buffer, length);
+  if(done < 0)
+  {
+    return failure(errno);
+  }
+  if(reading)
+  {
+    _stats.bytesRead += (uint32_t)done;
+  }
+  else
+  {
+    _stats.bytesWritten += (uint32_t)done;
+  }
+  if(done != length)
+  {
+    _stats.naks++;
+    return I2C_NACK;
+  }
+  return I2C_SUCCESS;
+}
+
+static uint8_t sendWrite(void)
+{
+  if(!_combined)
+  {
+    return splitTransfer(_txAddress, _txBuffer, _txLength, false);
+  }
+  struct i2c_msg msg = { _txAddress, 0, _txLength, _txBuffer };
+  return transfer(&msg, 1);
+}
+
+/** Sends a write held for a read that did not come */
+static void flushHeld(void)
+{
+  if(_txHeld)
+  {
+    _txHeld = false;
+    sendWrite();
+  }
+}
+
+/************************************************************/
+/************************************************************/
+/********************  PUBLIC FUNCTIONS *********************/
+
+/** Makes the backend's system calls through ops, NULL for the C library's */
+void LINUXHAL_setOps(const linuxOps_t* ops)
+{
+  _ops = ops != NULL ? ops : &_libcOps;
+}
+
+const linuxOps_t* LINUXHAL_getOps(void)
+{
+  return _ops;
+}
+
+linuxHalStats_t* LINUXHAL_getStats(void)
+{
+  return &_stats;
+}
+
+void LINUXHAL_resetStats(void)
+{
+  uint32_t clock = _stats.clockFrequency;
+  memset(&_stats, 0, sizeof(_stats));
+  _stats.clockFrequency = clock;
+}
+
+/** Opens an i2c-dev adapter such as /dev/i2c-1. false with errno set if it
+	cannot be opened or does not do plain I2C transfers. */
+bool LINUXI2C_open(const char* path)
+{
+  unsigned long functions = 0;
+
+  LINUXI2C_close();
+  _fd = _ops->open(path, O_RDWR);
+  if(_fd < 0)
+  {
+    return false;
+  }
+  _stats.syscalls += 2;
+  _stats.i2cSyscalls += 2;
+  if(_ops->ioctl(_fd, I2C_FUNCS, &functions) < 0 || !(functions & I2C_FUNC_I2C))
+  {
+    int error = errno != 0 ? errno : EOPNOTSUPP;
+    LINUXI2C_close();
+    errno = error;
+    return false;
+  }
+  return true;
+}
+
+void LINUXI2C_close(void)
+{
+  if(_fd >= 0)
+  {
+    _ops->close(_fd);
+  }
+  _fd = -1;
+  _slaveAddress = -1;
+  _txHeld = false;
+}
+
+/** With combined false, transfers are made the way a direct port of Wire
+	would: I2C_SLAVE, then write() and read(), each with its own start and
+	stop. A held write goes out on its own before the read. For comparison
+	with the combined transfers only. */
+void LINUXI2C_setCombined(bool combined)
+{
+  flushHeld();
+  _combined = combined;
+}
+
+/************************************************************/
+/************************************************************/
+/************************ I2C.h API *************************/
+
+void I2C_init(uint32_t clockFrequency)
+{
+  _stats.clockFrequency = clockFrequency;
+  _txLength = 0;
+  _txHeld = false;
+  _rxLength = _rxIndex = 0;
+}
+
+void I2C_setClock(uint32_t clockFrequency)
+{
+  _stats.clockFrequency = clockFrequency;
+}
+
+/** The adapter's timeout is in 10 ms units */
+void I2C_setTimeout(uint32_t timeoutUs)
+{
+  if(_fd >= 0)
+  {
+    _stats.syscalls++;
+    _stats.i2cSyscalls++;
+    _ops->ioctl(_fd, _timeoutIoctl, (void*)(unsigned long)((timeoutUs + 9999) / 10000));
+  }
+}
+
+bool I2C_recoverBus(void)
+{
+  _stats.recoveries++;
+  _txHeld = false;
+  _txLength = 0;
+  _rxLength = _rxIndex = 0;
+  return true;
+}
+
+uint32_t I2C_getRecoveryCount(void)
+{
+  return _stats.recoveries;
+}
+
+uint8_t I2C_request(int16_t address, int16_t count, bool stop)
+{
+  uint8_t result;
+
+  (void)stop;                 // the ioctl always ends with a stop
+  _rxIndex = 0;
+  _rxLength = 0;
+  if(count <= 0)
+  {
+    flushHeld();
+    return I2C_SUCCESS;
+  }
+  if(count > LINUXI2C_BUFFER_SIZE)
+  {
+    count = LINUXI2C_BUFFER_SIZE;
+  }
+  if(_txHeld && _combined && _txAddress == (uint8_t)address)
+  {
+    struct i2c_msg msgs[2] =
+    {
+      { _txAddress, 0, _txLength, _txBuffer },
+      { (uint16_t)address, I2C_M_RD, (uint16_t)count, _rxBuffer },
+    };
+    _txHeld = false;
+    result = transfer(msgs, 2);
+  }
+  else if(_combined)
+  {
+    flushHeld();
+    struct i2c_msg msg = { (uint16_t)address, I2C_M_RD, (uint16_t)count, _rxBuffer };
+    result = transfer(&msg, 1);
+  }
+  else
+  {
+    flushHeld();
+    result = splitTransfer((uint8_t)address, _rxBuffer, (uint16_t)count, true);
+  }
+  _rxLength = result == I2C_SUCCESS ? (uint16_t)count : 0;
+  return result;
+}
+
+uint16_t I2C_available(void)
+{
+  return _rxLength - _rxIndex;
+}
+
+uint8_t I2C_read(void)
+{
+  return (_rxIndex < _rxLength) ? _rxBuffer[_rxIndex++] : 0xFF;
+}
+
+void I2C_write(uint8_t data)
+{
+  if(_txLength < LINUXI2C_BUFFER_SIZE)
+  {
+    _txBuffer[_txLength++] = data;
+  }
+}
+
+void I2C_beginTransmission(uint8_t address)
+{
+  flushHeld();
+  _txAddress = address;
+  _txLength = 0;
+}
+
+/** A write without a stop is held for the read that follows it and
+	I2C_SUCCESS returned; see LinuxHal.h */
+uint8_t I2C_endTransmission(bool stop)
+{
+  if(!stop)
+  {
+    _txHeld = true;
+    return I2C_SUCCESS;
+  }
+  return sendWrite();
+}
@@ -0,0 +1,311 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+#include "SimBus.h"
+
+#include <string.h>
+
+/************************************************************/
+/************************************************************/
+/********************  GLOBAL VARIABLES *********************/
+
+static simDevice_t* _devices[SIMBUS_MAX_DEVICES];
+static uint8_t _deviceCount = 0;
+static simBusStats_t _stats;
+
+static uint8_t _txAddress;
+static uint8_t _txBuffer[SIMBUS_BUFFER_SIZE];
+static uint16_t _txLength;
+
+static uint8_t _rxBuffer[SIMBUS_BUFFER_SIZE];
+static uint16_t _rxLength;
+static uint16_t _rxIndex;
+
+static uint8_t _fault = SIMBUS_FAULT_NONE;
+static uint16_t _faultCount = 0;      /**< Transactions still to be hit */
+static uint16_t _stuckClocks = 0;     /**< SCL clocks until SDA is released, 0 when free */
+static uint32_t _timeoutUs = I2C_TIMEOUT_US;
+static uint32_t _stretchUs = SIMBUS_STRETCH_US;
+static bool _wireTimeout = false;     /**< Wire ends a transfer at the deadline itself */
+static bool _holdingBus = false;      /**< Last transaction ended without a stop */
+static void (*_onTransfer)(void) = NULL;
+
+/************************************************************/
+/************************************************************/
+/******************* HELPER FUNCTIONS ***********************/
+
+static simDevice_t* findDevice(uint8_t address)
+{
+  for(uint8_t i = 0; i < _deviceCount; i++)
+  {
+    if(_devices[i]->address == address)
+    {
+      bool present = _devices[i]->present == NULL || _devices[i]->present(_devices[i]);
+      return present ? _devices[i] : NULL;
+    }
+  }
+  return NULL;
+}
+
+/** Returns the fault for the next transaction. SHORT_READ and STRETCH only 
+	hit reads, NAK hits both. */
+static uint8_t takeFault(bool read)
+{
+  if(_faultCount == 0 || _fault == SIMBUS_FAULT_SDA_STUCK)
+  {
+    return SIMBUS_FAULT_NONE;
+  }
+  if(!read && _fault != SIMBUS_FAULT_NAK)
+  {
+    return SIMBUS_FAULT_NONE;
+  }
+  _faultCount--;
+  _stats.faults++;
+  return _fault;
+}
+
+/** Same as waitForBus in I2C.cpp: a held bus is waited on until the deadline, 
+	then cleared. Returns false if it is still stuck. */
+static bool waitForBus(void)
+{
+  if(_holdingBus || _stuckClocks == 0)
+  {
+    return true;
+  }
+  _stats.stalledUs += _timeoutUs;
+  if(I2C_recoverBus())
+  {
+    return true;
+  }
+  _stats.timeouts++;
+  return false;
+}
+
+/** A transfer the device held past the deadline. Wire gives up at the 
+	deadline if it can, else it waits until the device lets go and I2C.cpp 
+	finds the deadline passed once the transfer ends. */
+static uint8_t transferTimedOut(void)
+{
+  _stats.stalledUs += (_wireTimeout || _stretchUs < _timeoutUs) ? _timeoutUs : _stretchUs;
+  _stats.timeouts++;
+  I2C_recoverBus();
+  return I2C_TIMEOUT;
+}
+
+/************************************************************/
+/************************************************************/
+/********************  PUBLIC FUNCTIONS *********************/
+
+/** Adds a device to the bus. */
+void SIMBUS_attach(simDevice_t* device)
+{
+  if(_deviceCount < SIMBUS_MAX_DEVICES)
+  {
+    _devices[_deviceCount++] = device;
+  }
+}
+
+void SIMBUS_detachAll(void)
+{
+  _deviceCount = 0;
+}
+
+simBusStats_t* SIMBUS_getStats(void)
+{
+  return &_stats;
+}
+
+void SIMBUS_resetStats(void)
+{
+  uint32_t clock = _stats.clockFrequency;
+  memset(&_stats, 0, sizeof(_stats));
+  _stats.clockFrequency = clock;
+}
+
+/** Calls onTransfer (NULL for none) after each transaction that moved 
+	data, with its bytes already counted in simBusStats_t. A simulation 
+	that waits out the bus time there, running the world meanwhile, sees the 
+	transfer take as long as it would on the wire, and a device's Data Ready 
+	change part way through it. */
+void SIMBUS_setTransferHook(void (*onTransfer)(void))
+{
+  _onTransfer = onTransfer;
+}
+
+/** Makes the bus misbehave. For SIMBUS_FAULT_SDA_STUCK, count is the number 
+	of SCL clocks it takes for the device to let go of SDA (SIMBUS_STUCK_FOREVER 
+	for never); for the other faults it is the number of transactions hit. 
+	SIMBUS_FAULT_NONE clears every fault, a stuck SDA included. */
+void SIMBUS_injectFault(uint8_t fault, uint16_t count)
+{
+  _fault = fault;
+  _faultCount = (fault == SIMBUS_FAULT_SDA_STUCK || fault == SIMBUS_FAULT_NONE) ? 0 : count;
+  if(fault == SIMBUS_FAULT_SDA_STUCK)
+  {
+    _stuckClocks = count;
+  }
+  else if(fault == SIMBUS_FAULT_NONE)
+  {
+    _stuckClocks = 0;
+  }
+}
+
+/** Sets how long SIMBUS_FAULT_STRETCH holds SCL low (SIMBUS_STRETCH_US by 
+	default). Times under the deadline count as the deadline. */
+void SIMBUS_setStretchTime(uint32_t holdUs)
+{
+  _stretchUs = holdUs;
+}
+
+/** Sets whether Wire ends a transfer at the deadline itself, as I2C.cpp 
+	has it do with Wire libraries that have setWireTimeout. Off by default, 
+	as with the Teensy 3.x Wire: a stretched transfer lasts as long as the 
+	stretch. */
+void SIMBUS_setWireTimeout(bool enabled)
+{
+  _wireTimeout = enabled;
+}
+
+/************************************************************/
+/************************************************************/
+/************************ I2C.h API *************************/
+
+void I2C_init(uint32_t clockFrequency)
+{
+  _stats.clockFrequency = clockFrequency;
+  _txLength = 0;
+  _rxLength = _rxIndex = 0;
+  _holdingBus = false;
+}
+
+void I2C_setClock(uint32_t clockFrequency)
+{
+  _stats.clockFrequency = clockFrequency;
+}
+
+void I2C_setTimeout(uint32_t timeoutUs)
+{
+  _timeoutUs = timeoutUs;
+}
+
+/** Clocks SCL up to 9 times, like I2C.cpp; a stuck device counts the clocks 
+	down and lets go of SDA when they run out. */
+bool I2C_recoverBus(void)
+{
+  uint8_t clocks = 0;
+
+  _stats.recoveries++;
+  while(clocks < 9 && _stuckClocks > 0)
+  {
+    clocks++;
+    if(_stuckClocks != SIMBUS_STUCK_FOREVER)
+    {
+      _stuckClocks--;
+    }
+  }
+  _stats.stalledUs += clocks * SIMBUS_RECOVERY_CLOCK_US + SIMBUS_RECOVERY_EXTRA_US;
+  _holdingBus = false;
+  _txLength = 0;
+  _rxLength = _rxIndex = 0;
+  return _stuckClocks == 0;
+}
+
+uint32_t I2C_getRecoveryCount(void)
+{
+  return _stats.recoveries;
+}
+
+uint8_t I2C_request(int16_t address, int16_t count, bool stop)
+{
+  simDevice_t* device = findDevice((uint8_t)address);
+
+  _rxIndex = 0;
+  _rxLength = 0;
+  if(count <= 0)
+  {
+    return I2C_SUCCESS;
+  }
+  if(count > SIMBUS_BUFFER_SIZE)
+  {
+    count = SIMBUS_BUFFER_SIZE; // Wire clips requests to its buffer too
+  }
+  if(!waitForBus())
+  {
+    return I2C_TIMEOUT;
+  }
+  _stats.readTransactions++;
+  uint8_t fault = takeFault(true);
+  if(device == NULL || fault == SIMBUS_FAULT_NAK)
+  {
+    _stats.naks++;
+    _holdingBus = false;
+    return I2C_NACK;
+  }
+  _rxLength = device->read(device, _rxBuffer, (uint16_t)count);
+  if(fault == SIMBUS_FAULT_STRETCH)
+  {
+    return transferTimedOut();  // the device sent it, the master gave up
+  }
+  if(fault == SIMBUS_FAULT_SHORT_READ)
+  {
+    _rxLength /= 2;
+  }
+  _stats.bytesRead += _rxLength;
+  _holdingBus = !stop && _rxLength == count;
+  if(_onTransfer)
+  {
+    _onTransfer();
+  }
+  return (_rxLength == count) ? I2C_SUCCESS : I2C_NACK;
+}
+
+uint16_t I2C_available(void)
+{
+  return _rxLength - _rxIndex;
+}
+
+uint8_t I2C_read(void)
+{
+  // Wire returns -1 (0xFF once truncated) when the buffer is empty
+  return (_rxIndex < _rxLength) ? _rxBuffer[_rxIndex++] : 0xFF;
+}
+
+void I2C_write(uint8_t data)
+{
+  if(_txLength < SIMBUS_BUFFER_SIZE)
+  {
+    _txBuffer[_txLength++] = data;
+  }
+}
+
+void I2C_beginTransmission(uint8_t address)
+{
+  _txAddress = address;
+  _txLength = 0;
+}
+
+uint8_t I2C_endTransmission(bool stop)
+{
+  simDevice_t* device = findDevice(_txAddress);
+  uint16_t length = _txLength;
+
+  _txLength = 0;
+  if(!waitForBus())
+  {
+    return I2C_TIMEOUT;
+  }
+  _stats.writeTransactions++;
+  if(device == NULL || takeFault(false) == SIMBUS_FAULT_NAK)
+  {
+    _stats.naks++;
+    _holdingBus = false;
+    return I2C_NACK;
+  }
+  _stats.bytesWritten += length;
+  device->write(device, _txBuffer, length, stop);
+  _holdingBus = !stop;
+  if(_onTransfer)
+  {
+    _onTransfer();
+  }
+  return I2C_SUCCESS;
+}
@@ -0,0 +1,102 @@
+#ifndef SIMBUS_H
+#define SIMBUS_H
+
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+/** @file SimBus.h
+	@brief Simulated I2C bus for host builds.
+
+	SimBus.c implements the I2C.h API that the firmware modules use, with the 
+	same semantics as the Arduino Wire library (buffered writes sent on 
+	endTransmission, reads buffered by request). Transactions are delivered to 
+	simulated devices attached by address, so firmware code such as 
+	API_HostBus.c or API_I2CHID.c runs unchanged on the host. 
+
+	Faults can be injected with SIMBUS_injectFault. The bus then answers the 
+	way I2C.cpp does on the board: a stuck bus is waited on until the deadline 
+	(I2C_setTimeout), cleared with I2C_recoverBus and reported as I2C_TIMEOUT. 
+	A device stretching the clock holds the transfer in Wire: for as long as 
+	it stretches, or only until the deadline if the Wire library can end a 
+	transfer itself (SIMBUS_setWireTimeout, see I2C_TIMEOUT_US in I2C.h). 
+	Nothing actually waits; the time the board would lose is added up in 
+	simBusStats_t.stalledUs. */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "I2C.h"
+
+#define SIMBUS_MAX_DEVICES  (8)
+#define SIMBUS_BUFFER_SIZE  (1024)
+
+/** Faults for SIMBUS_injectFault */
+#define SIMBUS_FAULT_NONE        (0)
+#define SIMBUS_FAULT_NAK         (1)  /**< The device does not acknowledge, as when it lost power */
+#define SIMBUS_FAULT_SHORT_READ  (2)  /**< The device stops sending half way through a read */
+#define SIMBUS_FAULT_STRETCH     (3)  /**< The device holds SCL low part way through a read, see SIMBUS_setStretchTime */
+#define SIMBUS_FAULT_SDA_STUCK   (4)  /**< A device holds SDA low until SCL is clocked */
+
+#define SIMBUS_STUCK_FOREVER     (0xFFFF)  /**< SDA_STUCK count: no amount of clocking frees it */
+
+/** How long SIMBUS_FAULT_STRETCH holds SCL low by default, well past I2C_TIMEOUT_US */
+#define SIMBUS_STRETCH_US        (50000)
+
+/** Time the board's I2C.cpp takes to clear the bus: up to 9 clocks of 10us plus the STOP */
+#define SIMBUS_RECOVERY_CLOCK_US (10)
+#define SIMBUS_RECOVERY_EXTRA_US (15)
+
+/** A simulated I2C device. write receives each complete write transaction, 
+	read must fill data with count bytes and return how many it supplied 
+	(fewer is a short read, like a NAK). If present is set and returns false,
+	the device does not acknowledge its address, as while it boots. */
+typedef struct simDevice
+{
+  uint8_t address;
+  void (*write)(struct simDevice* device, const uint8_t* data, uint16_t count, bool stop);
+  uint16_t (*read)(struct simDevice* device, uint8_t* data, uint16_t count);
+  bool (*present)(const struct simDevice* device);
+  void* context;
+} simDevice_t;
+
+/** Bus traffic counters */
+typedef struct
+{
+  uint32_t clockFrequency;
+  uint32_t writeTransactions;
+  uint32_t readTransactions;
+  uint32_t bytesWritten;
+  uint32_t bytesRead;
+  uint32_t naks;               /**< Transactions not acknowledged (no device or a NAK fault) */
+  uint32_t faults;             /**< Transactions hit by an injected fault */
+  uint32_t timeouts;           /**< Transactions that returned I2C_TIMEOUT */
+  uint32_t recoveries;         /**< I2C_recoverBus calls */
+  uint64_t stalledUs;          /**< Time lost to deadlines and bus clearing */
+} simBusStats_t;
+
+/************************************************************/
+/************************************************************/
+/********************  PUBLIC FUNCTIONS *********************/
+
+void SIMBUS_attach(simDevice_t* device);
+
+void SIMBUS_detachAll(void);
+
+simBusStats_t* SIMBUS_getStats(void);
+
+void SIMBUS_resetStats(void);
+
+void SIMBUS_setTransferHook(void (*onTransfer)(void));
+
+void SIMBUS_injectFault(uint8_t fault, uint16_t count);
+
+void SIMBUS_setStretchTime(uint32_t holdUs);
+
+void SIMBUS_setWireTimeout(bool enabled);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,197 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+#include "SimGen4.h"
+#include "API_C2.h"
+#include "SimHardware.h"
+
+#include <string.h>
+
+#define EXTENDED_READ   (0x01)
+#define EXTENDED_WRITE  (0x00)
+#define EXTENDED_MARKER (0x09)
+#define PREAMBLE_SIZE   (8)
+
+/************************************************************/
+/************************************************************/
+/******************* HELPER FUNCTIONS ***********************/
+
+static uint32_t get32(const uint8_t* data)
+{
+  return (uint32_t)data[0] | ((uint32_t)data[1] << 8)
+       | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+static uint8_t* cell(simGen4_t* sim, uint32_t address)
+{
+  return &sim->memory[address & (SIMGEN4_MEMORY_SIZE - 1)];
+}
+
+/** Firmware reacts to a register write: command bits clear once taken. */
+static void afterWrite(simGen4_t* sim, uint32_t address, uint16_t count)
+{
+  for(uint16_t i = 0; i < count; i++)
+  {
+    uint16_t reg = (uint16_t)(address + i);
+    if(reg == 0xC2C4)
+    {
+      sim->memory[reg] &= (uint8_t)~0x80;  // factory calibrate done
+    }
+    else if(reg == 0xC2DF)
+    {
+      sim->calibrationPending = (sim->memory[reg] & 0x03) == 0x03;
+      sim->memory[reg] &= (uint8_t)~0x03;  // persist / calibrate request taken
+    }
+  }
+}
+
+static void simWrite(simDevice_t* device, const uint8_t* data, uint16_t count, bool stop)
+{
+  simGen4_t* sim = (simGen4_t*)device->context;
+  (void)stop;
+
+  if(count < PREAMBLE_SIZE || data[1] != EXTENDED_MARKER)
+  {
+    return;
+  }
+  uint32_t address = get32(&data[2]);
+  uint16_t length = (uint16_t)(data[6] | (data[7] << 8));
+
+  if(data[0] == EXTENDED_READ)
+  {
+    sim->readAddress = address;
+    sim->readCount = length;
+    sim->readPending = true;
+    return;
+  }
+  if(data[0] != EXTENDED_WRITE)
+  {
+    return;
+  }
+
+  uint8_t checksum = 0;
+  for(uint16_t i = 0; i < count - 1; i++)
+  {
+    checksum += data[i];
+  }
+  if(count != PREAMBLE_SIZE + length + 1 || checksum != data[count - 1])
+  {
+    sim->badWrites++;
+    return;
+  }
+  for(uint16_t i = 0; i < length; i++)
+  {
+    *cell(sim, address + i) = data[PREAMBLE_SIZE + i];
+  }
+  afterWrite(sim, address, length);
+  sim->memoryWrites++;
+}
+
+static uint16_t simRead(simDevice_t* device, uint8_t* data, uint16_t count)
+{
+  simGen4_t* sim = (simGen4_t*)device->context;
+
+  if(sim->readPending)
+  {
+    // lengthLow lengthHigh data[readCount] checksum, length counts all of it
+    uint16_t total = sim->readCount + 3;
+    uint8_t checksum = 0;
+    sim->readPending = false;
+    sim->memoryReads++;
+    for(uint16_t i = 0; i < count; i++)
+    {
+      uint8_t value = 0;
+      if(i == 0 || i == 1)
+      {
+        value = (uint8_t)(i == 0 ? (total & 0xFF) : (total >> 8));
+      }
+      else if(i < total - 1)
+      {
+        uint32_t address = sim->readAddress + i - 2;
+        value = *cell(sim, address);
+        if(sim->calibrationPending && (uint16_t)address == 0xC2D4)
+        {
+          value = 0;                  // calibration finished
+          sim->calibrationPending = false;
+        }
+      }
+      else if(i == total - 1)
+      {
+        value = checksum;
+      }
+      checksum += value;
+      data[i] = value;
+    }
+    return count;
+  }
+
+  if(sim->queueCount == 0)
+  {
+    memset(data, 0, count);   // nothing to report, an empty packet
+    return count;
+  }
+  uint16_t length = count < PACKET_SIZE ? count : PACKET_SIZE;
+  memcpy(data, sim->queue[sim->queueHead], length);
+  memset(data + length, 0, count - length);
+  sim->queueHead = (sim->queueHead + 1) % SIMGEN4_QUEUE_DEPTH;
+  sim->queueCount--;
+  sim->packetsSent++;
+  return count;
+}
+
+static bool simPresent(const simDevice_t* device)
+{
+  return SIMGEN4_isBooted((const simGen4_t*)device->context);
+}
+
+static void put16(simGen4_t* sim, uint16_t reg, uint16_t value)
+{
+  sim->memory[reg] = (uint8_t)(value & 0xFF);
+  sim->memory[reg + 1] = (uint8_t)(value >> 8);
+}
+
+/************************************************************/
+/************************************************************/
+/********************  PUBLIC FUNCTIONS *********************/
+
+/** Resets the device and its register image. The device still has to be
+	attached to the bus with SIMBUS_attach(&sim->device). */
+void SIMGEN4_init(simGen4_t* sim, uint8_t address)
+{
+  memset(sim, 0, sizeof(*sim));
+  sim->device.address = address;
+  sim->device.write = simWrite;
+  sim->device.read = simRead;
+  sim->device.present = simPresent;
+  sim->device.context = sim;
+
+  sim->memory[REG_CHIP_ID] = 0x40;
+  sim->memory[REG_FIRMWARE_VER] = 0x12;
+  sim->memory[REG_FIRMWARE_SUBVERSION] = 0x03;
+  put16(sim, REG_VENDOR_ID, 0x0488);
+  put16(sim, REG_PRODUCT_ID, 0xD001);
+  put16(sim, REG_VERSION_ID, 0x4514);
+}
+
+/** Queues a report packet (PACKET_SIZE bytes). Returns false when the queue is full. */
+bool SIMGEN4_queuePacket(simGen4_t* sim, const uint8_t* packet)
+{
+  if(sim->queueCount == SIMGEN4_QUEUE_DEPTH)
+  {
+    return false;
+  }
+  memcpy(sim->queue[(sim->queueHead + sim->queueCount) % SIMGEN4_QUEUE_DEPTH], packet, PACKET_SIZE);
+  sim->queueCount++;
+  return true;
+}
+
+/** True while a report is waiting, the state of the (active low) DR line. */
+bool SIMGEN4_dataReady(const simGen4_t* sim)
+{
+  return sim->queueCount > 0 && SIMGEN4_isBooted(sim);
+}
+
+/** True once bootUs have passed since the simulated board powered the pad */
+bool SIMGEN4_isBooted(const simGen4_t* sim)
+{
+  return sim->bootUs == 0 || SIMHW_poweredUs() >= sim->bootUs;
+}
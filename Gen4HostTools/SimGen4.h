@@ -0,0 +1,67 @@
+#ifndef SIMGEN4_H
+#define SIMGEN4_H
+
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+/** @file SimGen4.h
+	@brief Simulated Gen4 pad speaking the Host Bus protocol, for use on a SimBus.
+
+	The device answers extended memory reads and writes (see API_HostBus.c)
+	from a 64 KB register image, addressed by the low 16 bits of the address,
+	and hands out report packets queued with SIMGEN4_queuePacket. Data Ready
+	is asserted while packets are queued. The identification registers read
+	by API_C2_readSystemInfo are preset. The self clearing bits used by
+	API_C2_factoryCalibrate clear as soon as they are written, and 0xC2D4, 
+	which it polls for completion, reads 0 once while a calibration request 
+	written to 0xC2DF is pending. 
+
+	With bootUs set, the pad models its boot after power on (see
+	SimHardware.h): until bootUs have passed it does not acknowledge its
+	address and Data Ready stays deasserted. */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "API_C2_Report.h"
+#include "SimBus.h"
+
+#define SIMGEN4_MEMORY_SIZE  (0x10000)
+#define SIMGEN4_QUEUE_DEPTH  (16)
+
+typedef struct
+{
+  simDevice_t device;
+  uint8_t  memory[SIMGEN4_MEMORY_SIZE];
+  uint32_t readAddress;         /**< Set by the last extended memory read command */
+  uint16_t readCount;
+  bool     readPending;         /**< Next read returns memory instead of a report */
+  bool     calibrationPending;
+  uint8_t  queue[SIMGEN4_QUEUE_DEPTH][PACKET_SIZE];
+  uint8_t  queueHead;
+  uint8_t  queueCount;
+  uint32_t packetsSent;
+  uint32_t memoryReads;
+  uint32_t memoryWrites;
+  uint32_t badWrites;           /**< Write commands with a bad checksum or length */
+  uint32_t bootUs;              /**< Boot time after power on, 0 to answer at once */
+} simGen4_t;
+
+/************************************************************/
+/************************************************************/
+/********************  PUBLIC FUNCTIONS *********************/
+
+void SIMGEN4_init(simGen4_t* sim, uint8_t address);
+
+bool SIMGEN4_queuePacket(simGen4_t* sim, const uint8_t* packet);
+
+bool SIMGEN4_dataReady(const simGen4_t* sim);
+
+bool SIMGEN4_isBooted(const simGen4_t* sim);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
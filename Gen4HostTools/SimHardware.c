@@ -0,0 +1,297 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+#include "SimHardware.h"
+#include "API_Hardware.h"
+#include "HostDR.h"
+#include "HardwareTimer.h"
+#include "UsbHid.h"
+
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+
+/************************************************************/
+/************************************************************/
+/********************  GLOBAL VARIABLES *********************/
+
+static bool (*_dataReady)(const void* context) = NULL;
+static const void* _dataReadyContext = NULL;
+static bool _powered = false;
+static uint64_t _poweredAtUs = 0;
+static uint8_t _buttons = 0;
+static uint8_t _haptic = 0;
+static bool _drAsserted = false;
+static uint32_t _assertedUs = 0;
+static void (*_tick)(void) = NULL;
+static uint32_t _periodUs = 0;
+static uint32_t _nextTickUs = 0;
+static uint8_t _usbInterfaces = (1 << USB_HID_MOUSE) | (1 << USB_HID_KEYBOARD) | (1 << USB_HID_TOUCH);
+static simUsbHost_t _usbHost;
+
+static bool _virtualClock = false;
+static uint64_t _virtualUs = 0;
+
+static uint64_t nowUs(void)
+{
+  if(_virtualClock)
+  {
+    return _virtualUs;
+  }
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+static uint64_t _startUs = 0;
+static bool _ownClock = false;
+static uint32_t _clockOffsetUs = 0;
+static int32_t _clockDriftPpm = 0;
+
+/** Reads the Host_DR line, timestamping it when it asserts */
+static bool sampleDataReady(void)
+{
+  bool asserted = _dataReady != NULL && _dataReady(_dataReadyContext);
+  if(asserted && !_drAsserted)
+  {
+    _assertedUs = API_Hardware_micros();
+  }
+  _drAsserted = asserted;
+  return asserted;
+}
+
+/************************************************************/
+/************************************************************/
+/********************  PUBLIC FUNCTIONS *********************/
+
+/** Sets what the Host_DR line reports. dataReady returns true while the pad
+	has data, which reads as a low (asserted) line. */
+void SIMHW_setDataReady(bool (*dataReady)(const void* context), const void* context)
+{
+  _dataReady = dataReady;
+  _dataReadyContext = context;
+}
+
+bool SIMHW_isPowered(void)
+{
+  return _powered;
+}
+
+/** Microseconds since API_Hardware_PowerOn, 0 while the pad is off */
+uint32_t SIMHW_poweredUs(void)
+{
+  return _powered ? (uint32_t)(nowUs() - _poweredAtUs) : 0;
+}
+
+/** Buttons held down with API_Hardware_injectButton, bit 0 for BTN1_PIN */
+uint8_t SIMHW_getButtons(void)
+{
+  return _buttons;
+}
+
+/** Makes API_Hardware_micros a free running board clock instead of the time 
+	since API_Hardware_init: offsetUs plus CLOCK_MONOTONIC in us, gaining 
+	driftPpm us every second (losing, if negative), as a crystal that is off 
+	would. Whoever knows both can tell the host time of any timestamp. */
+void SIMHW_setClock(uint32_t offsetUs, int32_t driftPpm)
+{
+  _ownClock = true;
+  _clockOffsetUs = offsetUs;
+  _clockDriftPpm = driftPpm;
+}
+
+/** Stops time: from now on it only moves with SIMHW_advance (and 
+	API_Hardware_delay), so a simulation gives the same result however the 
+	host schedules it. Code that waits for micros() to move, such as 
+	API_C2_waitReady, must not run on it. */
+void SIMHW_useVirtualClock(void)
+{
+  _virtualUs = nowUs();
+  _virtualClock = true;
+}
+
+/** Moves the virtual clock on by us */
+void SIMHW_advance(uint32_t us)
+{
+  _virtualUs += us;
+}
+
+/** Duty cycle last set with API_Hardware_setHaptic, 0 for the motor off */
+uint8_t SIMHW_getHaptic(void)
+{
+  return _haptic;
+}
+
+/** Sets which HID interfaces the USB Type has, bits (1 << USB_HID_); all
+	three to start with */
+void SIMHW_setUsbInterfaces(uint8_t interfaces)
+{
+  _usbInterfaces = interfaces;
+}
+
+const simUsbHost_t* SIMHW_getUsbHost(void)
+{
+  return &_usbHost;
+}
+
+void SIMHW_resetUsbHost(void)
+{
+  memset(&_usbHost, 0, sizeof(_usbHost));
+}
+
+/** Does what the interrupts would have done by now: notes the Host_DR edge 
+	and runs the timer callback once per period passed. The callback may stop 
+	or restart the timer. */
+void SIMHW_poll(void)
+{
+  sampleDataReady();
+  while(_tick != NULL && (int32_t)(API_Hardware_micros() - _nextTickUs) >= 0)
+  {
+    _nextTickUs += _periodUs;
+    _tick();
+  }
+}
+
+/************************************************************/
+/************************************************************/
+/******************* API_Hardware.h API *********************/
+
+void API_Hardware_init(void)
+{
+  _startUs = nowUs();
+  _powered = false;
+}
+
+void API_Hardware_PowerOn(void)
+{
+  _powered = true;
+  _poweredAtUs = nowUs();
+}
+
+void API_Hardware_PowerOff(void)
+{
+  _powered = false;
+}
+
+void API_Hardware_delay(uint32_t ms)
+{
+  if(_virtualClock)
+  {
+    _virtualUs += (uint64_t)ms * 1000u;
+    return;
+  }
+  struct timespec ts = { (time_t)(ms / 1000), (long)(ms % 1000) * 1000000L };
+  nanosleep(&ts, NULL);
+}
+
+uint32_t API_Hardware_micros(void)
+{
+  if(_ownClock)
+  {
+    uint64_t us = nowUs();
+    return (uint32_t)(_clockOffsetUs + us + (uint64_t)((int64_t)us * _clockDriftPpm / 1000000));
+  }
+  return (uint32_t)(nowUs() - _startUs);
+}
+
+void API_Hardware_setScope(uint8_t pin, bool high)
+{
+  (void)pin;
+  (void)high;
+}
+
+void API_Hardware_injectButton(uint8_t button, bool pressed)
+{
+  if(button >= HARDWARE_BUTTONS)
+  {
+    return;
+  }
+  _buttons = pressed ? (uint8_t)(_buttons | (1 << button)) : (uint8_t)(_buttons & ~(1 << button));
+}
+
+void API_Hardware_setHaptic(uint8_t strength)
+{
+  _haptic = strength;
+}
+
+/************************************************************/
+/************************************************************/
+/*********************** HostDR.h API ***********************/
+
+void HostDR_init(void)
+{
+}
+
+bool HostDR_pinState(void)
+{
+  return !sampleDataReady();
+}
+
+uint32_t HostDR_assertedUs(void)
+{
+  return _assertedUs;
+}
+
+/************************************************************/
+/************************************************************/
+/******************** HardwareTimer.h API *******************/
+
+bool HardwareTimer_start(uint32_t periodUs, void (*tick)(void))
+{
+  _periodUs = periodUs;
+  _nextTickUs = API_Hardware_micros() + periodUs;
+  _tick = tick;
+  return true;
+}
+
+void HardwareTimer_stop(void)
+{
+  _tick = NULL;
+}
+
+/************************************************************/
+/************************************************************/
+/*********************** UsbHid.h API ***********************/
+
+uint8_t UsbHid_interfaces(void)
+{
+  return _usbInterfaces;
+}
+
+void UsbHid_sendMouse(const usbMouse_t* mouse)
+{
+  _usbHost.reports[USB_HID_MOUSE]++;
+  _usbHost.mouse = *mouse;
+  _usbHost.pointerX += mouse->x;
+  _usbHost.pointerY += mouse->y;
+  _usbHost.wheel += mouse->wheel;
+  _usbHost.pan += mouse->pan;
+}
+
+void UsbHid_sendKeyboard(const usbKeyboard_t* keyboard)
+{
+  _usbHost.reports[USB_HID_KEYBOARD]++;
+  _usbHost.keyboard = *keyboard;
+}
+
+/** As TouchscreenUSB's press and release */
+void UsbHid_sendTouch(const usbTouch_t* touch)
+{
+  usbTouch_t* held = &_usbHost.touch;
+  _usbHost.reports[USB_HID_TOUCH]++;
+  for(uint8_t finger = 0; finger < USB_HID_FINGERS; finger++)
+  {
+    uint8_t bit = (uint8_t)(1 << finger);
+    if(touch->contacts & bit)
+    {
+      _usbHost.presses++;
+      held->contacts |= bit;
+      held->x[finger] = touch->x[finger];
+      held->y[finger] = touch->y[finger];
+    }
+    else if(touch->lifted & bit)
+    {
+      _usbHost.releases++;
+      held->contacts &= (uint8_t)~bit;
+    }
+  }
+}
@@ -0,0 +1,80 @@
+#ifndef SIMHARDWARE_H
+#define SIMHARDWARE_H
+
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+/** @file SimHardware.h
+	@brief Host stand-ins for the dev kit board functions.
+
+	SimHardware.c implements API_Hardware.h, HostDR.h, HardwareTimer.h and 
+	UsbHid.h for host builds, so API_HostBus.c and API_C2.c run unchanged on 
+	top of a SimBus. Time is the host's monotonic clock. The Host_DR line 
+	follows a callback, normally SIMGEN4_dataReady of the simulated pad. 
+	Buttons pressed through the BTN pins are kept for the simulation to read 
+	with SIMHW_getButtons, the haptic PWM duty with SIMHW_getHaptic, and what 
+	a USB host would have seen of the HID reports with SIMHW_getUsbHost. 
+	SIMHW_setClock gives micros() an offset and drift of its own, as an 
+	unsynchronized board has. SIMHW_useVirtualClock stops time altogether 
+	until SIMHW_advance moves it, for simulations whose results must not 
+	depend on how the host schedules them.
+
+	There are no interrupts on the host: SIMHW_poll stands in for them. It 
+	timestamps the Host_DR edge and runs the timer callback for every period 
+	that has passed, so a simulation calls it as often as it can. */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "API_UsbHid.h"
+
+/** The USB host's side of the HID interfaces (UsbHid.h): every report, and
+	the state they add up to */
+typedef struct
+{
+  uint32_t      reports[USB_HID_INTERFACES];
+  usbMouse_t    mouse;         /**< Last mouse report */
+  int32_t       pointerX;      /**< Mouse movement, summed */
+  int32_t       pointerY;
+  int32_t       wheel;
+  int32_t       pan;
+  usbKeyboard_t keyboard;      /**< Last keyboard report */
+  usbTouch_t    touch;         /**< Contacts held down, at their last positions; lifted unused */
+  uint32_t      presses;       /**< Touch contacts pressed, moved or not */
+  uint32_t      releases;
+} simUsbHost_t;
+
+/************************************************************/
+/************************************************************/
+/********************  PUBLIC FUNCTIONS *********************/
+
+void SIMHW_setDataReady(bool (*dataReady)(const void* context), const void* context);
+
+bool SIMHW_isPowered(void);
+
+uint32_t SIMHW_poweredUs(void);
+
+uint8_t SIMHW_getButtons(void);
+
+void SIMHW_setClock(uint32_t offsetUs, int32_t driftPpm);
+
+void SIMHW_useVirtualClock(void);
+
+void SIMHW_advance(uint32_t us);
+
+uint8_t SIMHW_getHaptic(void);
+
+void SIMHW_setUsbInterfaces(uint8_t interfaces);
+
+const simUsbHost_t* SIMHW_getUsbHost(void);
+
+void SIMHW_resetUsbHost(void);
+
+void SIMHW_poll(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,298 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+#include "SimI2CHID.h"
+#include "API_I2CHID.h"
+#include "HostSynth.h"
+
+#include <string.h>
+
+/************************************************************/
+/************************************************************/
+/********************  GLOBAL VARIABLES *********************/
+
+#define PTP_FINGER_COLLECTION \
+  0x09, 0x22, 0xA1, 0x02,                 /* Finger, Logical collection */ \
+  0x09, 0x47, 0x09, 0x42, 0x15, 0x00,     /* Confidence, Tip switch */ \
+  0x25, 0x01, 0x75, 0x01, 0x95, 0x02, 0x81, 0x02, \
+  0x09, 0x51, 0x25, 0x3F, 0x75, 0x06,     /* Contact ID, 6 bits */ \
+  0x95, 0x01, 0x81, 0x02, \
+  0x05, 0x01, 0x26, 0xFF, 0x0F, 0x75, 0x10, /* X, Y 16 bits */ \
+  0x09, 0x30, 0x09, 0x31, 0x95, 0x02, 0x81, 0x02, \
+  0x05, 0x0D, 0xC0
+
+static const uint8_t reportDescriptor[] =
+{
+  // Mouse, report 0x06: 3 buttons, X, Y, wheel, AC pan
+  0x05, 0x01, 0x09, 0x02, 0xA1, 0x01, 0x85, 0x06, 0x09, 0x01, 0xA1, 0x00,
+  0x05, 0x09, 0x19, 0x01, 0x29, 0x03, 0x15, 0x00, 0x25, 0x01,
+  0x75, 0x01, 0x95, 0x03, 0x81, 0x02, 0x95, 0x05, 0x81, 0x03,
+  0x05, 0x01, 0x09, 0x30, 0x09, 0x31, 0x09, 0x38, 0x15, 0x81, 0x25, 0x7F,
+  0x75, 0x08, 0x95, 0x03, 0x81, 0x06,
+  0x05, 0x0C, 0x0A, 0x38, 0x02, 0x95, 0x01, 0x81, 0x06,
+  0xC0, 0xC0,
+
+  // Precision Touchpad, report 0x01: 5 contacts, scan time, contact count, buttons
+  0x05, 0x0D, 0x09, 0x05, 0xA1, 0x01, 0x85, 0x01,
+  PTP_FINGER_COLLECTION,
+  PTP_FINGER_COLLECTION,
+  PTP_FINGER_COLLECTION,
+  PTP_FINGER_COLLECTION,
+  PTP_FINGER_COLLECTION,
+  0x55, 0x0C, 0x66, 0x01, 0x10, 0x47, 0xFF, 0xFF, 0x00, 0x00,
+  0x27, 0xFF, 0xFF, 0x00, 0x00, 0x75, 0x10, 0x95, 0x01, 0x09, 0x56, 0x81, 0x02,
+  0x09, 0x54, 0x25, 0x7F, 0x95, 0x01, 0x75, 0x08, 0x81, 0x02,
+  0x05, 0x09, 0x09, 0x01, 0x09, 0x02, 0x09, 0x03, 0x25, 0x01,
+  0x75, 0x01, 0x95, 0x03, 0x81, 0x02, 0x95, 0x05, 0x81, 0x03,
+  // maximum contacts feature, report 0x02
+  0x05, 0x0D, 0x85, 0x02, 0x09, 0x55, 0x25, 0x05, 0x75, 0x08, 0x95, 0x01, 0xB1, 0x02,
+  0xC0,
+
+  // Configuration, report 0x03: Input Mode feature
+  0x05, 0x0D, 0x09, 0x0E, 0xA1, 0x01, 0x85, 0x03, 0x09, 0x22, 0xA1, 0x02,
+  0x09, 0x52, 0x15, 0x00, 0x25, 0x0A, 0x75, 0x08, 0x95, 0x01, 0xB1, 0x02,
+  0xC0, 0xC0,
+};
+
+/************************************************************/
+/************************************************************/
+/******************* HELPER FUNCTIONS ***********************/
+
+static void put16(uint8_t* data, uint16_t value)
+{
+  data[0] = (uint8_t)(value & 0xFF);
+  data[1] = (uint8_t)(value >> 8);
+}
+
+static uint16_t get16(const uint8_t* data)
+{
+  return (uint16_t)(data[0] | (data[1] << 8));
+}
+
+static uint16_t makeHidDescriptor(uint8_t* data)
+{
+  memset(data, 0, I2CHID_DESCRIPTOR_LENGTH);
+  put16(&data[0], I2CHID_DESCRIPTOR_LENGTH);
+  put16(&data[2], 0x0100);
+  put16(&data[4], sizeof(reportDescriptor));
+  put16(&data[6], SIMHID_REPORT_DESC_REGISTER);
+  put16(&data[8], SIMHID_INPUT_REGISTER);
+  put16(&data[10], SIMHID_MAX_INPUT_LENGTH);
+  put16(&data[12], SIMHID_OUTPUT_REGISTER);
+  put16(&data[14], 0);
+  put16(&data[16], SIMHID_COMMAND_REGISTER);
+  put16(&data[18], SIMHID_DATA_REGISTER);
+  put16(&data[20], 0x0488);
+  put16(&data[22], 0xD001);
+  put16(&data[24], 0x4514);
+  return I2CHID_DESCRIPTOR_LENGTH;
+}
+
+/** Builds a GET_REPORT response: length, report ID, data. */
+static void prepareGetReport(simI2CHID_t* sim, uint8_t type, uint8_t reportID)
+{
+  uint8_t* out = sim->response;
+  uint16_t length = 0;
+
+  sim->responseConsumesInput = false;
+  if(type == 3 && reportID == SIMHID_MAX_CONTACTS_ID)
+  {
+    out[2] = reportID;
+    out[3] = 5;
+    length = 4;
+  }
+  else if(type == 3 && reportID == SIMHID_INPUT_MODE_ID)
+  {
+    out[2] = reportID;
+    out[3] = sim->inputMode;
+    length = 4;
+  }
+  else if(type == 1 && sim->queueCount > 0 && sim->queue[sim->queueHead][2] == reportID)
+  {
+    length = get16(sim->queue[sim->queueHead]);
+    memcpy(out, sim->queue[sim->queueHead], length);
+    sim->responseConsumesInput = true;
+  }
+  put16(out, length);
+  sim->responseLength = length ? length : 2;
+}
+
+static void handleCommand(simI2CHID_t* sim, const uint8_t* data, uint16_t count)
+{
+  uint8_t low = data[2] & 0x0F;
+  uint8_t type = (data[2] >> 4) & 0x03;
+  uint8_t opcode = data[3] & 0x0F;
+  uint16_t i = 4;
+  uint8_t reportID = low;
+
+  sim->commands++;
+  if(low == 0x0F && (opcode == 0x02 || opcode == 0x03) && count > i)
+  {
+    reportID = data[i++];
+  }
+
+  switch(opcode)
+  {
+    case 0x01: // RESET
+      sim->resetPending = true;
+      sim->inputMode = SIMHID_INPUT_MODE_MOUSE;
+      sim->powerState = 0;
+      sim->queueCount = 0;
+      break;
+    case 0x02: // GET_REPORT, followed by the data register
+      prepareGetReport(sim, type, reportID);
+      sim->readRegister = SIMHID_DATA_REGISTER;
+      break;
+    case 0x03: // SET_REPORT: data register, length, report ID, data
+      if(count >= i + 5 && type == 3 && data[i + 4] == SIMHID_INPUT_MODE_ID)
+      {
+        sim->inputMode = data[i + 5];
+      }
+      break;
+    case 0x08: // SET_POWER
+      sim->powerState = data[2] & 0x03;
+      break;
+    default:
+      break;
+  }
+}
+
+static void simWrite(simDevice_t* device, const uint8_t* data, uint16_t count, bool stop)
+{
+  simI2CHID_t* sim = (simI2CHID_t*)device->context;
+  (void)stop;
+
+  if(count < 2)
+  {
+    return;
+  }
+  uint16_t reg = get16(data);
+  if(reg == SIMHID_COMMAND_REGISTER && count >= 4)
+  {
+    handleCommand(sim, data, count);
+  }
+  else
+  {
+    sim->readRegister = reg;
+  }
+}
+
+static uint16_t copyOut(uint8_t* data, uint16_t count, const uint8_t* source, uint16_t length)
+{
+  uint16_t n = count < length ? count : length;
+  memcpy(data, source, n);
+  if(count > n)
+  {
+    memset(data + n, 0, count - n);
+  }
+  return count;
+}
+
+static uint16_t simRead(simDevice_t* device, uint8_t* data, uint16_t count)
+{
+  simI2CHID_t* sim = (simI2CHID_t*)device->context;
+  uint16_t reg = sim->readRegister;
+  sim->readRegister = 0;
+
+  if(reg == SIMHID_DESCRIPTOR_REGISTER)
+  {
+    uint8_t descriptor[I2CHID_DESCRIPTOR_LENGTH];
+    return copyOut(data, count, descriptor, makeHidDescriptor(descriptor));
+  }
+  if(reg == SIMHID_REPORT_DESC_REGISTER)
+  {
+    return copyOut(data, count, reportDescriptor, sizeof(reportDescriptor));
+  }
+  if(reg == SIMHID_DATA_REGISTER)
+  {
+    if(sim->responseConsumesInput)
+    {
+      // an input report fetched by GET_REPORT is consumed
+      sim->responseConsumesInput = false;
+      sim->queueHead = (uint8_t)((sim->queueHead + 1) % SIMHID_QUEUE_DEPTH);
+      sim->queueCount--;
+    }
+    return copyOut(data, count, sim->response, sim->responseLength);
+  }
+
+  // input register
+  if(sim->resetPending)
+  {
+    sim->resetPending = false;
+    return copyOut(data, count, NULL, 0);
+  }
+  if(sim->queueCount == 0)
+  {
+    return copyOut(data, count, NULL, 0);
+  }
+  const uint8_t* report = sim->queue[sim->queueHead];
+  uint16_t length = get16(report);
+  sim->queueHead = (uint8_t)((sim->queueHead + 1) % SIMHID_QUEUE_DEPTH);
+  sim->queueCount--;
+  sim->reportsSent++;
+  if(count > length)
+  {
+    sim->overReadBytes += count - length;
+  }
+  return copyOut(data, count, report, length);
+}
+
+/************************************************************/
+/************************************************************/
+/********************  PUBLIC FUNCTIONS *********************/
+
+/** Sets up the simulated pad; attach sim->device to the bus afterwards. */
+void SIMHID_init(simI2CHID_t* sim, uint8_t address)
+{
+  memset(sim, 0, sizeof(*sim));
+  sim->device.address = address;
+  sim->device.write = simWrite;
+  sim->device.read = simRead;
+  sim->device.context = sim;
+  sim->inputMode = SIMHID_INPUT_MODE_MOUSE;
+}
+
+/** Queues a touch report for the host to read. Absolute reports are sent as 
+	PTP reports and need Input Mode 3; mouse reports need mouse mode. Returns 
+	false if the report doesn't fit the current mode, the pad is asleep or the 
+	queue is full. */
+bool SIMHID_queueReport(simI2CHID_t* sim, const report_t* report)
+{
+  uint8_t packet[PACKET_SIZE];
+  report_t copy = *report;
+
+  if(sim->powerState != 0 || sim->queueCount >= SIMHID_QUEUE_DEPTH)
+  {
+    return false;
+  }
+  if(sim->inputMode == SIMHID_INPUT_MODE_PTP)
+  {
+    if(API_C2_getReportKind(report->reportID) != REPORT_KIND_ABSOLUTE)
+    {
+      return false;
+    }
+    copy.reportID = PTP_REPORT_ID;
+  }
+  else if(report->reportID != MOUSE_REPORT_ID)
+  {
+    return false;
+  }
+
+  SYNTH_encodeReport(&copy, packet);
+  uint8_t slot = (uint8_t)((sim->queueHead + sim->queueCount) % SIMHID_QUEUE_DEPTH);
+  memcpy(sim->queue[slot], packet, SIMHID_MAX_INPUT_LENGTH);
+  sim->queueCount++;
+  return true;
+}
+
+/** The pad's interrupt (DR) line: asserted while a report or the reset
+	response is waiting. */
+bool SIMHID_interruptAsserted(const simI2CHID_t* sim)
+{
+  return sim->resetPending || sim->queueCount > 0;
+}
+
+const uint8_t* SIMHID_reportDescriptor(uint16_t* length)
+{
+  *length = sizeof(reportDescriptor);
+  return reportDescriptor;
+}
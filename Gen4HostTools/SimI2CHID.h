@@ -0,0 +1,71 @@
+#ifndef SIMI2CHID_H
+#define SIMI2CHID_H
+
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+/** @file SimI2CHID.h
+	@brief Simulated Gen4 pad speaking I2C-HID, for use on a SimBus.
+
+	The device has a mouse collection (report 0x06), a Precision Touchpad 
+	collection (input report 0x01, maximum contacts feature 0x02) and the 
+	Input Mode feature (0x03). Like a real pad it starts in mouse mode and 
+	switches to PTP reports when Input Mode is set to 3. */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "API_C2_Report.h"
+#include "SimBus.h"
+
+#define SIMHID_DESCRIPTOR_REGISTER  (0x0020)
+#define SIMHID_REPORT_DESC_REGISTER (0x0021)
+#define SIMHID_INPUT_REGISTER       (0x0022)
+#define SIMHID_OUTPUT_REGISTER      (0x0023)
+#define SIMHID_COMMAND_REGISTER     (0x0024)
+#define SIMHID_DATA_REGISTER        (0x0025)
+
+#define SIMHID_MAX_CONTACTS_ID      (0x02)
+#define SIMHID_INPUT_MODE_ID        (0x03)
+#define SIMHID_INPUT_MODE_MOUSE     (0)
+#define SIMHID_INPUT_MODE_PTP       (3)
+
+#define SIMHID_QUEUE_DEPTH          (16)
+#define SIMHID_MAX_INPUT_LENGTH     (32)
+
+typedef struct
+{
+  simDevice_t device;
+  uint8_t  inputMode;
+  uint8_t  powerState;
+  bool     resetPending;
+  uint16_t readRegister;        /**< Register selected by the last write, 0 for the input register */
+  uint8_t  response[64];        /**< GET_REPORT response */
+  uint16_t responseLength;
+  bool     responseConsumesInput;
+  uint8_t  queue[SIMHID_QUEUE_DEPTH][SIMHID_MAX_INPUT_LENGTH];
+  uint8_t  queueHead;
+  uint8_t  queueCount;
+  uint32_t reportsSent;
+  uint32_t overReadBytes;       /**< Bytes read beyond the length of the report returned */
+  uint32_t commands;
+} simI2CHID_t;
+
+/************************************************************/
+/************************************************************/
+/********************  PUBLIC FUNCTIONS *********************/
+
+void SIMHID_init(simI2CHID_t* sim, uint8_t address);
+
+bool SIMHID_queueReport(simI2CHID_t* sim, const report_t* report);
+
+bool SIMHID_interruptAsserted(const simI2CHID_t* sim);
+
+const uint8_t* SIMHID_reportDescriptor(uint16_t* length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
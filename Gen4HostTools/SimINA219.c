@@ -0,0 +1,170 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+#include "SimINA219.h"
+#include "API_Hardware.h"
+#include "INA219.h"
+
+#include <string.h>
+
+/************************************************************/
+/************************************************************/
+/********************  GLOBAL VARIABLES *********************/
+
+/** Typical conversion times in us by the 4 bit ADC field */
+static const uint32_t typicalUs[16] =
+{
+  84, 148, 276, 532, 84, 148, 276, 532,
+  532, 1060, 2130, 4260, 8510, 17020, 34050, 68100
+};
+
+/************************************************************/
+/************************************************************/
+/******************* HELPER FUNCTIONS ***********************/
+
+static uint32_t shuntPeriodUs(const simINA219_t* sim)
+{
+  return typicalUs[(sim->config & CONFIG__SHUNT_ADC_MASK) >> 3];
+}
+
+/** Conversions finished since the last config write */
+static uint32_t conversionsSinceStart(const simINA219_t* sim)
+{
+  uint16_t mode = sim->config & CONFIG__MODE_MASK;
+  uint32_t elapsed = API_Hardware_micros() - sim->startUs;
+  uint32_t count = elapsed / shuntPeriodUs(sim);
+
+  if(mode == CONFIG__MODE_POWER_DOWN || mode == CONFIG__MODE_ADC_OFF)
+  {
+    return 0;
+  }
+  if(mode < CONFIG__MODE_ADC_OFF && count > 1)
+  {
+    return 1;   // triggered: one conversion
+  }
+  return count;
+}
+
+static int16_t shuntRegister(const simINA219_t* sim, uint32_t* sequence)
+{
+  uint32_t count = conversionsSinceStart(sim);
+
+  *sequence = sim->baseSequence + count;
+  if(count == 0)
+  {
+    return sim->heldShunt;
+  }
+  uint32_t finishedUs = sim->startUs + count * shuntPeriodUs(sim);
+  if(sim->scanning != NULL && !sim->scanning(sim->scanningContext))
+  {
+    return (int16_t)(SIMINA_SLEEP_UV / 10);
+  }
+  return (int16_t)(SIMINA_shuntMicrovolts(finishedUs) / 10);
+}
+
+static void writeConfig(simINA219_t* sim, uint16_t value)
+{
+  uint32_t sequence;
+
+  sim->heldShunt = shuntRegister(sim, &sequence);
+  sim->baseSequence = sequence;
+  sim->startUs = API_Hardware_micros();
+  sim->stats.configWrites++;
+  if(value & CONFIG__RESET)
+  {
+    sim->config = CONFIG__POR_DEFAULT;
+    sim->calibration = 0;
+    sim->pointer = REGISTER__CONFIG;
+    return;
+  }
+  sim->config = value;
+}
+
+static void simWrite(simDevice_t* device, const uint8_t* data, uint16_t count, bool stop)
+{
+  simINA219_t* sim = (simINA219_t*)device->context;
+  (void)stop;
+
+  if(count == 0)
+  {
+    return;
+  }
+  sim->pointer = data[0];
+  if(count < 3)
+  {
+    sim->stats.pointerWrites++;
+    return;
+  }
+  uint16_t value = (uint16_t)((data[1] << 8) | data[2]);
+  if(sim->pointer == REGISTER__CONFIG)
+  {
+    writeConfig(sim, value);
+  }
+  else if(sim->pointer == REGISTER__CALIBRATION)
+  {
+    sim->calibration = value;
+  }
+}
+
+static uint16_t simRead(simDevice_t* device, uint8_t* data, uint16_t count)
+{
+  simINA219_t* sim = (simINA219_t*)device->context;
+  uint16_t value = 0;
+  uint32_t sequence;
+
+  switch(sim->pointer)
+  {
+    case REGISTER__CONFIG:
+      value = sim->config;
+      break;
+    case REGISTER__SHUNT_VOLTAGE:
+      value = (uint16_t)shuntRegister(sim, &sequence);
+      sim->stats.shuntReads++;
+      if(sequence == sim->lastReadSequence)
+      {
+        sim->stats.repeats++;
+      }
+      else
+      {
+        sim->stats.fresh++;
+        sim->stats.skipped += sequence - sim->lastReadSequence - 1;
+      }
+      sim->lastReadSequence = sequence;
+      break;
+    case REGISTER__BUS_VOLTAGE:   // 5V, CNVR once a conversion has finished
+      value = (uint16_t)((5000 / 4) << 3) | (conversionsSinceStart(sim) > 0 ? 0x0002 : 0);
+      break;
+    case REGISTER__CALIBRATION:
+      value = sim->calibration;
+      break;
+    default:
+      break;
+  }
+  for(uint16_t i = 0; i < count; i++)
+  {
+    data[i] = (i % 2 == 0) ? (uint8_t)(value >> 8) : (uint8_t)(value & 0xFF);
+  }
+  return count;
+}
+
+/************************************************************/
+/************************************************************/
+/********************  PUBLIC FUNCTIONS *********************/
+
+/** Sets sim up as a freshly powered INA219: POR config (converting 
+	continuously), pointer on the config register */
+void SIMINA_init(simINA219_t* sim, uint8_t address)
+{
+  memset(sim, 0, sizeof(*sim));
+  sim->device.address = address;
+  sim->device.write = simWrite;
+  sim->device.read = simRead;
+  sim->device.context = sim;
+  sim->config = CONFIG__POR_DEFAULT;
+  sim->startUs = API_Hardware_micros();
+}
+
+/** The simulated shunt voltage at time us */
+int32_t SIMINA_shuntMicrovolts(uint32_t us)
+{
+  return (us % SIMINA_SCAN_PERIOD_US) < SIMINA_SCAN_US ? SIMINA_SCAN_UV : SIMINA_IDLE_UV;
+}
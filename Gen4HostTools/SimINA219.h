@@ -0,0 +1,75 @@
+#ifndef SIMINA219_H
+#define SIMINA219_H
+
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+/** @file SimINA219.h
+	@brief Simulated INA219 current sense for use on a SimBus.
+
+	Register access works like the chip's: a write sets the register pointer 
+	and, with two more bytes, writes that register; a read returns the 
+	register the pointer was left on. Conversions take the datasheet's typical 
+	time for the ADC setting, on API_Hardware_micros(). Writing the config 
+	starts over: one conversion in a triggered mode, back-to-back conversions 
+	in a continuous one. The shunt voltage register holds the result of the 
+	last finished conversion and the bus voltage register has CNVR (bit 1) set 
+	once one has finished.
+
+	The shunt voltage follows SIMINA_shuntMicrovolts(): a quiet current with 
+	a pulse for each touch scan. With a scanning callback set, the pad only 
+	scans while it returns true and draws SIMINA_SLEEP_UV otherwise (a pad 
+	with tracking off sleeps). Each shunt read is checked against the 
+	conversion it returns, so a reader can tell fresh samples from repeats. */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "SimBus.h"
+
+#define SIMINA_IDLE_UV      (400)    /**< Shunt voltage between scans */
+#define SIMINA_SCAN_UV      (1900)   /**< Shunt voltage during a scan */
+#define SIMINA_SCAN_US      (1000)   /**< Scan length */
+#define SIMINA_SCAN_PERIOD_US (8000) /**< Scan interval */
+#define SIMINA_SLEEP_UV     (150)    /**< Shunt voltage while the pad is not scanning */
+
+/** Shunt reads, by what they returned */
+typedef struct
+{
+  uint32_t shuntReads;
+  uint32_t fresh;          /**< A conversion not read before */
+  uint32_t repeats;        /**< The same conversion as the last read */
+  uint32_t skipped;        /**< Conversions finished and overwritten without being read */
+  uint32_t configWrites;
+  uint32_t pointerWrites;  /**< Writes that only set the pointer */
+} simINA219Stats_t;
+
+typedef struct
+{
+  simDevice_t device;
+  uint8_t  pointer;
+  uint16_t config;
+  uint16_t calibration;
+  uint32_t startUs;        /**< Last config write, when conversions (re)started */
+  uint32_t baseSequence;   /**< Conversions finished before startUs */
+  int16_t  heldShunt;      /**< Shunt register before the first conversion since startUs */
+  uint32_t lastReadSequence;
+  simINA219Stats_t stats;
+  bool (*scanning)(const void* context);  /**< NULL when the pad always scans */
+  const void* scanningContext;
+} simINA219_t;
+
+/************************************************************/
+/************************************************************/
+/********************  PUBLIC FUNCTIONS *********************/
+
+void SIMINA_init(simINA219_t* sim, uint8_t address);
+
+int32_t SIMINA_shuntMicrovolts(uint32_t us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
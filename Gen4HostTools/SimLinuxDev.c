@@ -0,0 +1,357 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/gpio.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+
+/** i2c-dev's I2C_TIMEOUT ioctl, whose name I2C.h gives to a result */
+static const unsigned long _timeoutIoctl = I2C_TIMEOUT;
+#undef I2C_TIMEOUT
+
+#include "SimLinuxDev.h"
+
+/** File descriptors handed out, well clear of real ones */
+#define ADAPTER_FD (1000)
+#define CHIP_FD    (1001)
+#define LINE_FD    (1002)
+
+#define EDGE_QUEUE_DEPTH (16)
+
+/************************************************************/
+/************************************************************/
+/********************  GLOBAL VARIABLES *********************/
+
+static simDevice_t* _devices[SIMLINUX_MAX_DEVICES];
+static uint8_t _deviceCount = 0;
+static simLinuxStats_t _stats;
+static bool _syscallCost = true;
+static uint8_t _slaveAddress = 0;
+
+static bool (*_dataReady)(const void* context) = NULL;
+static const void* _dataReadyContext = NULL;
+static bool _lineLevel = true;        /**< As last looked at, active low */
+static struct gpio_v2_line_event _edges[EDGE_QUEUE_DEPTH];
+static uint8_t _edgeHead = 0;
+static uint8_t _edgeCount = 0;
+
+/************************************************************/
+/************************************************************/
+/******************* HELPER FUNCTIONS ***********************/
+
+static uint64_t nowNs(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static bool lineLevel(void)
+{
+  return !(_dataReady != NULL && _dataReady(_dataReadyContext));
+}
+
+/** Queues an edge event if the line changed since the last look. A full
+	queue drops the oldest, as the kernel's does. */
+static void lookAtLine(void)
+{
+  bool level = lineLevel();
+  if(level == _lineLevel)
+  {
+    return;
+  }
+  _lineLevel = level;
+  if(_edgeCount == EDGE_QUEUE_DEPTH)
+  {
+    _edgeHead = (uint8_t)((_edgeHead + 1) % EDGE_QUEUE_DEPTH);
+    _edgeCount--;
+  }
+  struct gpio_v2_line_event* event = &_edges[(_edgeHead + _edgeCount++) % EDGE_QUEUE_DEPTH];
+  memset(event, 0, sizeof(*event));
+  event->timestamp_ns = nowNs();
+  event->id = level ? GPIO_V2_LINE_EVENT_RISING_EDGE : GPIO_V2_LINE_EVENT_FALLING_EDGE;
+  event->seqno = ++_stats.edges;
+  event->line_seqno = event->seqno;
+}
+
+/** Every call enters the kernel once, as the real one would */
+static void enterKernel(void)
+{
+  _stats.calls++;
+  if(_syscallCost)
+  {
+    syscall(SYS_getppid);
+  }
+  lookAtLine();
+}
+
+static simDevice_t* findDevice(uint16_t address)
+{
+  for(uint8_t i = 0; i < _deviceCount; i++)
+  {
+    if(_devices[i]->address == address)
+    {
+      bool present = _devices[i]->present == NULL || _devices[i]->present(_devices[i]);
+      return present ? _devices[i] : NULL;
+    }
+  }
+  return NULL;
+}
+
+/** One message of a transaction. Returns bytes moved, -1 with errno set. */
+static int transferMessage(uint16_t address, uint8_t* buffer, uint16_t length, bool reading, bool stop)
+{
+  simDevice_t* device = findDevice(address);
+  if(device == NULL)
+  {
+    errno = ENXIO;
+    return -1;
+  }
+  if(!reading)
+  {
+    device->write(device, buffer, length, stop);
+    lookAtLine();
+    return length;
+  }
+  uint16_t done = device->read(device, buffer, length);
+  lookAtLine();
+  if(done != length)
+  {
+    errno = EREMOTEIO;
+    return -1;
+  }
+  return done;
+}
+
+static int adapterIoctl(unsigned long request, void* arg)
+{
+  switch(request)
+  {
+    case I2C_FUNCS:
+      *(unsigned long*)arg = I2C_FUNC_I2C;
+      return 0;
+    case I2C_SLAVE:
+    case I2C_SLAVE_FORCE:
+      _slaveAddress = (uint8_t)(unsigned long)arg;
+      return 0;
+    case I2C_RETRIES:
+      return 0;
+    case I2C_RDWR:
+    {
+      struct i2c_rdwr_ioctl_data* data = (struct i2c_rdwr_ioctl_data*)arg;
+      _stats.rdwrs++;
+      for(uint32_t i = 0; i < data->nmsgs; i++)
+      {
+        struct i2c_msg* msg = &data->msgs[i];
+        _stats.messages++;
+        if(transferMessage(msg->addr, msg->buf, msg->len, (msg->flags & I2C_M_RD) != 0, i + 1 == data->nmsgs) < 0)
+        {
+          return -1;
+        }
+      }
+      return (int)data->nmsgs;
+    }
+    default:
+      if(request == _timeoutIoctl)
+      {
+        return 0;
+      }
+      errno = ENOTTY;
+      return -1;
+  }
+}
+
+static int chipIoctl(unsigned long request, void* arg)
+{
+  if(request != GPIO_V2_GET_LINE_IOCTL)
+  {
+    errno = ENOTTY;
+    return -1;
+  }
+  struct gpio_v2_line_request* line = (struct gpio_v2_line_request*)arg;
+  if(line->num_lines != 1)
+  {
+    errno = EINVAL;
+    return -1;
+  }
+  line->fd = LINE_FD;
+  _lineLevel = lineLevel();
+  _edgeCount = 0;
+  return 0;
+}
+
+static int lineIoctl(unsigned long request, void* arg)
+{
+  if(request != GPIO_V2_LINE_GET_VALUES_IOCTL)
+  {
+    errno = ENOTTY;
+    return -1;
+  }
+  struct gpio_v2_line_values* values = (struct gpio_v2_line_values*)arg;
+  values->bits = (values->mask & 1) && lineLevel() ? 1 : 0;
+  return 0;
+}
+
+/************************************************************/
+/************************************************************/
+/************************ linuxOps_t ************************/
+
+static int simOpen(const char* path, int flags)
+{
+  (void)flags;
+  enterKernel();
+  if(strncmp(path, "/dev/i2c-", 9) == 0)
+  {
+    return ADAPTER_FD;
+  }
+  if(strncmp(path, "/dev/gpiochip", 13) == 0)
+  {
+    return CHIP_FD;
+  }
+  errno = ENOENT;
+  return -1;
+}
+
+static int simClose(int fd)
+{
+  (void)fd;
+  enterKernel();
+  return 0;
+}
+
+static int simIoctl(int fd, unsigned long request, void* arg)
+{
+  enterKernel();
+  switch(fd)
+  {
+    case ADAPTER_FD: return adapterIoctl(request, arg);
+    case CHIP_FD:    return chipIoctl(request, arg);
+    case LINE_FD:    return lineIoctl(request, arg);
+    default:         errno = EBADF; return -1;
+  }
+}
+
+/** Adapter: a read at the I2C_SLAVE address. Line: the edges waiting. */
+static ssize_t simRead(int fd, void* buffer, size_t count)
+{
+  enterKernel();
+  if(fd == ADAPTER_FD)
+  {
+    _stats.reads++;
+    return transferMessage(_slaveAddress, (uint8_t*)buffer, (uint16_t)count, true, true);
+  }
+  if(fd != LINE_FD || count < sizeof(struct gpio_v2_line_event))
+  {
+    errno = EINVAL;
+    return -1;
+  }
+  if(_edgeCount == 0)
+  {
+    errno = EAGAIN;
+    return -1;
+  }
+  struct gpio_v2_line_event* events = (struct gpio_v2_line_event*)buffer;
+  size_t taken = 0;
+  for(; taken < count / sizeof(*events) && _edgeCount > 0; taken++, _edgeCount--)
+  {
+    events[taken] = _edges[_edgeHead];
+    _edgeHead = (uint8_t)((_edgeHead + 1) % EDGE_QUEUE_DEPTH);
+  }
+  return (ssize_t)(taken * sizeof(*events));
+}
+
+static ssize_t simWrite(int fd, const void* buffer, size_t count)
+{
+  uint8_t data[LINUXI2C_BUFFER_SIZE];
+
+  enterKernel();
+  if(fd != ADAPTER_FD || count > sizeof(data))
+  {
+    errno = EINVAL;
+    return -1;
+  }
+  _stats.writes++;
+  memcpy(data, buffer, count);
+  return transferMessage(_slaveAddress, data, (uint16_t)count, false, true);
+}
+
+/** Only the line can be waited on. Waits by looking at the level every
+	50 us, since whatever changes it runs between the calls. */
+static int simPoll(int fd, short events, int timeoutMs)
+{
+  uint64_t until = nowNs() + (uint64_t)(timeoutMs < 0 ? 0 : timeoutMs) * 1000000u;
+
+  enterKernel();
+  _stats.polls++;
+  if(fd != LINE_FD || !(events & POLLIN))
+  {
+    return 0;
+  }
+  while(_edgeCount == 0 && nowNs() < until)
+  {
+    struct timespec ts = { 0, 50000 };
+    nanosleep(&ts, NULL);
+    lookAtLine();
+  }
+  return _edgeCount > 0 ? 1 : 0;
+}
+
+static const linuxOps_t _ops = { simOpen, simClose, simIoctl, simRead, simWrite, simPoll };
+
+/************************************************************/
+/************************************************************/
+/********************  PUBLIC FUNCTIONS *********************/
+
+void SIMLINUX_init(void)
+{
+  _deviceCount = 0;
+  _dataReady = NULL;
+  _lineLevel = true;
+  _edgeCount = 0;
+  memset(&_stats, 0, sizeof(_stats));
+}
+
+/** Puts a device on every adapter */
+void SIMLINUX_attach(simDevice_t* device)
+{
+  if(_deviceCount < SIMLINUX_MAX_DEVICES)
+  {
+    _devices[_deviceCount++] = device;
+  }
+}
+
+/** Sets what every GPIO line reads. dataReady returns true while the pad
+	has data, which reads as a low (asserted) line. */
+void SIMLINUX_setDataReady(bool (*dataReady)(const void* context), const void* context)
+{
+  _dataReady = dataReady;
+  _dataReadyContext = context;
+}
+
+/** false leaves out the real system call each call makes */
+void SIMLINUX_setSyscallCost(bool enable)
+{
+  _syscallCost = enable;
+}
+
+const linuxOps_t* SIMLINUX_ops(void)
+{
+  return &_ops;
+}
+
+simLinuxStats_t* SIMLINUX_getStats(void)
+{
+  return &_stats;
+}
+
+/** SimGen4.c takes the pad's power from SimHardware.h. With the Linux
+	backend the pad is powered with the board, so it is always on. */
+uint32_t SIMHW_poweredUs(void)
+{
+  return UINT32_MAX;
+}
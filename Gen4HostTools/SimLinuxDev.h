@@ -0,0 +1,71 @@
+#ifndef SIMLINUXDEV_H
+#define SIMLINUXDEV_H
+
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+/** @file SimLinuxDev.h
+	@brief Stand-ins for i2c-dev and the GPIO character device, to run the
+	Linux backend (LinuxHal.h) without hardware.
+
+	SIMLINUX_ops returns a linuxOps_t for LINUXHAL_setOps. Opening any
+	/dev/i2c-N gives an adapter whose transfers go to the simulated devices
+	attached with SIMLINUX_attach (the simDevice_t of SimGen4.h and the
+	others): I2C_RDWR with any number of messages, the last one ending with
+	the stop, and read() and write() at the I2C_SLAVE address. A device that
+	is missing or not present fails with ENXIO, a short read with EREMOTEIO.
+	Opening any /dev/gpiochipN gives a chip whose lines follow the callback
+	set with SIMLINUX_setDataReady, active low: GPIO_V2_LINE_GET_VALUES_IOCTL
+	reads the level, and poll and read give the edge events. The level is
+	looked at on every call and after every transfer (a report read clears
+	Data Ready), and an event queued, timestamped then, each time it has
+	changed. Two changes made between calls are not seen.
+
+	Every call makes one real system call as well (getppid), so a benchmark
+	against the stand-ins pays the kernel entry a real call would.
+
+	SimLinuxDev.c also provides SIMHW_poweredUs for SimGen4.c, which is
+	linked without SimHardware.c here: the pad is always powered. */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "LinuxHal.h"
+#include "SimBus.h"
+
+#define SIMLINUX_MAX_DEVICES (8)
+
+/** Calls made to the stand-ins */
+typedef struct
+{
+  uint32_t calls;
+  uint32_t rdwrs;             /**< I2C_RDWR ioctls */
+  uint32_t messages;          /**< ... and the messages in them */
+  uint32_t reads;             /**< read() and write() on the adapter */
+  uint32_t writes;
+  uint32_t polls;
+  uint32_t edges;
+} simLinuxStats_t;
+
+/************************************************************/
+/************************************************************/
+/********************  PUBLIC FUNCTIONS *********************/
+
+void SIMLINUX_init(void);
+
+void SIMLINUX_attach(simDevice_t* device);
+
+void SIMLINUX_setDataReady(bool (*dataReady)(const void* context), const void* context);
+
+void SIMLINUX_setSyscallCost(bool enable);
+
+const linuxOps_t* SIMLINUX_ops(void);
+
+simLinuxStats_t* SIMLINUX_getStats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,355 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+/** gen4analyze - touch quality metrics from report captures (files of
+	API_Stream frames, e.g. the dev kit's binary stream saved with cat, or
+	gen4flight -o output). Each file is memory mapped and cut into shards
+	that a pool of threads decodes in parallel; the per-shard partial
+	aggregates (HostAnalytics.h) are then merged in capture order and one
+	summary table is printed per session.
+
+	usage: gen4analyze [-j threads] [-s shard_mb] [-g gap_ms] [-J jump] file... */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "API_C2_Report.h"
+#include "API_Stream.h"
+#include "HostAnalytics.h"
+#include "HostUtil.h"
+
+typedef struct
+{
+  const char*    path;
+  const uint8_t* data;
+  size_t         size;
+} capture_t;
+
+typedef struct
+{
+  uint32_t    capture;
+  size_t      start;   /**< Frames whose first byte is in [start, end) belong to the shard */
+  size_t      end;
+  size_t      firstFrame; /**< Offset of the first frame found */
+  size_t      stop;       /**< Where the walk ended: the end of the last frame, or end */
+  analytics_t result;
+} shard_t;
+
+typedef struct
+{
+  capture_t*     captures;
+  shard_t*       shards;
+  uint32_t       shardCount;
+  atomic_uint    nextShard;
+  uint32_t       gapUs;
+  uint32_t       jumpLimit;
+} job_t;
+
+static void usage(const char* argv0)
+{
+  fprintf(stderr,
+          "usage: %s [-j threads] [-s shard_mb] [-g gap_ms] [-J jump] file...\n"
+          "  -j  worker threads (default: online CPUs)\n"
+          "  -s  shard size in MB (default 16)\n"
+          "  -g  a gap between reports longer than this starts a new session (default 1000)\n"
+          "  -J  position change between reports that counts as a jump (default 200)\n",
+          argv0);
+}
+
+/** Returns the size of the valid frame starting at offset, or 0. */
+static size_t frameAt(const uint8_t* data, size_t size, size_t offset)
+{
+  if(size - offset < STREAM_OVERHEAD || data[offset] != STREAM_SYNC_0 || data[offset + 1] != STREAM_SYNC_1)
+  {
+    return 0;
+  }
+  uint16_t length = data[offset + 3] | (data[offset + 4] << 8);
+  if(length > STREAM_MAX_PAYLOAD || size - offset < (size_t)length + STREAM_OVERHEAD)
+  {
+    return 0;
+  }
+  uint8_t checksum = 0;
+  const uint8_t* iter = &data[offset + 2];
+  const uint8_t* end = &data[offset + STREAM_HEADER_SIZE + length];
+  while(iter < end)
+  {
+    checksum += *iter++;
+  }
+  return *end == checksum ? (size_t)length + STREAM_OVERHEAD : 0;
+}
+
+/** Decodes the frames that start inside the shard. Unlike API_Stream_parseByte,
+	which has to consume a corrupt frame before it can look for the next, this
+	walks the mapped file and retries one byte later, so a false sync (in menu
+	text or straddling the shard start) can't swallow the frames after it. */
+static void processShard(const capture_t* capture, shard_t* shard)
+{
+  const uint8_t* data = capture->data;
+  size_t offset = shard->start;
+  bool found = false;
+
+  shard->firstFrame = shard->end;
+  while(offset < shard->end)
+  {
+    size_t frameSize = frameAt(data, capture->size, offset);
+    if(frameSize == 0)
+    {
+      // bytes before the first frame of a later shard are normally the tail of
+      // the previous shard's last frame; main() accounts for them
+      if(found || shard->start == 0)
+      {
+        if(data[offset] == STREAM_SYNC_0 && offset + 1 < capture->size && data[offset + 1] == STREAM_SYNC_1)
+        {
+          shard->result.badFrames++;
+        }
+        else
+        {
+          shard->result.skippedBytes++;
+        }
+      }
+      offset++;
+      continue;
+    }
+    if(!found)
+    {
+      found = true;
+      shard->firstFrame = offset;
+    }
+
+    const uint8_t* payload = &data[offset + STREAM_HEADER_SIZE];
+    uint16_t length = payload[-6] | (payload[-5] << 8);
+    if(data[offset + 2] == STREAM_TYPE_REPORT && length >= 3)
+    {
+      uint32_t timestamp = payload[-4] | (payload[-3] << 8) | (payload[-2] << 16) | ((uint32_t)payload[-1] << 24);
+      uint8_t packet[PACKET_SIZE];
+      report_t report;
+      memcpy(packet, payload, length < PACKET_SIZE ? length : PACKET_SIZE);
+      if(length < PACKET_SIZE)
+      {
+        memset(packet + length, 0, PACKET_SIZE - length);
+      }
+      API_C2_decodeReport(packet, &report);
+      ANALYTICS_addReport(&shard->result, timestamp, &report);
+    }
+    offset += frameSize;
+  }
+  shard->stop = offset;
+}
+
+static void* worker(void* argument)
+{
+  job_t* job = argument;
+  uint32_t index;
+  while((index = atomic_fetch_add(&job->nextShard, 1)) < job->shardCount)
+  {
+    shard_t* shard = &job->shards[index];
+    ANALYTICS_init(&shard->result, shard->capture, job->gapUs, job->jumpLimit);
+    processShard(&job->captures[shard->capture], shard);
+  }
+  return NULL;
+}
+
+static void printSession(uint32_t number, const capture_t* capture, const sessionAgg_t* session)
+{
+  double seconds = session->durationUs / 1e6;
+  printf("session %u  %s  %.3f s, %llu reports (%llu absolute, %llu mouse, %llu keyboard, %llu unknown)\n",
+         number, capture->path, seconds, (unsigned long long)session->reports,
+         (unsigned long long)session->kindReports[REPORT_KIND_ABSOLUTE],
+         (unsigned long long)session->kindReports[REPORT_KIND_MOUSE],
+         (unsigned long long)session->kindReports[REPORT_KIND_KEYBOARD],
+         (unsigned long long)session->kindReports[REPORT_KIND_NONE]);
+  if(session->interval.count)
+  {
+    printf("  report interval ms: mean %.3f  sd %.3f  min %.3f  p50 %.2f  p99 %.2f  max %.3f  (%.1f Hz)\n",
+           session->interval.mean / 1000.0, ANALYTICS_stddev(&session->interval) / 1000.0,
+           session->interval.min / 1000.0, ANALYTICS_intervalPercentile(session, 0.5) / 1000.0,
+           ANALYTICS_intervalPercentile(session, 0.99) / 1000.0, session->interval.max / 1000.0,
+           1e6 / session->interval.mean);
+  }
+  if(session->kindReports[REPORT_KIND_ABSOLUTE] == 0)
+  {
+    printf("\n");
+    return;
+  }
+  printf("  %-6s %8s %6s %6s %10s %7s %6s %8s %8s %8s %8s %8s %8s\n", "finger", "contacts", "short", "jumps",
+         "samples", "valid%", "palm%", "jitterX", "jitterY", "mean ms", "strokes", "lin rms", "lin max");
+  for(uint8_t i = 0; i < ANALYTICS_FINGERS; i++)
+  {
+    const fingerAgg_t* finger = &session->fingers[i];
+    if(finger->samples == 0)
+    {
+      continue;
+    }
+    // second differences of white noise have 6x its variance
+    double jitterX = finger->jitterCount ? sqrt(finger->jitterX / (6.0 * finger->jitterCount)) : 0.0;
+    double jitterY = finger->jitterCount ? sqrt(finger->jitterY / (6.0 * finger->jitterCount)) : 0.0;
+    printf("  %-6u %8llu %6llu %6llu %10llu %7.2f %6.2f %8.3f %8.3f %8.1f %8llu %8.2f %8.2f\n", i,
+           (unsigned long long)finger->contacts, (unsigned long long)finger->shortContacts,
+           (unsigned long long)finger->jumps, (unsigned long long)finger->samples,
+           100.0 * finger->validSamples / finger->samples, 100.0 * finger->palmSamples / finger->samples,
+           jitterX, jitterY, finger->contactMs.mean, (unsigned long long)finger->strokes,
+           finger->strokes ? finger->strokeDeviation / finger->strokes : 0.0, finger->strokeDeviationMax);
+  }
+  printf("\n");
+}
+
+int main(int argc, char** argv)
+{
+  long threads = sysconf(_SC_NPROCESSORS_ONLN);
+  size_t shardBytes = 16u << 20;
+  uint32_t gapMs = 1000, jumpLimit = 200;
+  int opt;
+
+  while((opt = getopt(argc, argv, "j:s:g:J:h")) != -1)
+  {
+    switch(opt)
+    {
+      case 'j': threads = strtol(optarg, NULL, 0); break;
+      case 's': shardBytes = (size_t)(strtod(optarg, NULL) * (1u << 20)); break;
+      case 'g': gapMs = (uint32_t)strtoul(optarg, NULL, 0); break;
+      case 'J': jumpLimit = (uint32_t)strtoul(optarg, NULL, 0); break;
+      default: usage(argv[0]); return 2;
+    }
+  }
+  if(optind >= argc || threads < 1 || shardBytes < STREAM_MAX_FRAME)
+  {
+    usage(argv[0]);
+    return 2;
+  }
+
+  uint32_t captureCount = (uint32_t)(argc - optind);
+  capture_t* captures = calloc(captureCount, sizeof(capture_t));
+  uint64_t totalBytes = 0;
+  uint32_t shardCount = 0;
+  for(uint32_t i = 0; i < captureCount; i++)
+  {
+    capture_t* capture = &captures[i];
+    struct stat st;
+    capture->path = argv[optind + i];
+    int fd = open(capture->path, O_RDONLY | O_CLOEXEC);
+    if(fd < 0 || fstat(fd, &st) != 0)
+    {
+      fprintf(stderr, "%s: %s\n", capture->path, strerror(errno));
+      return 1;
+    }
+    capture->size = (size_t)st.st_size;
+    if(capture->size != 0)
+    {
+      capture->data = mmap(NULL, capture->size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if(capture->data == MAP_FAILED)
+      {
+        fprintf(stderr, "%s: %s\n", capture->path, strerror(errno));
+        return 1;
+      }
+      madvise((void*)capture->data, capture->size, MADV_SEQUENTIAL);
+    }
+    close(fd);
+    totalBytes += capture->size;
+    shardCount += (uint32_t)((capture->size + shardBytes - 1) / shardBytes);
+  }
+
+  job_t job;
+  job.captures = captures;
+  job.shards = calloc(shardCount ? shardCount : 1, sizeof(shard_t));
+  job.shardCount = shardCount;
+  job.gapUs = gapMs * 1000u;
+  job.jumpLimit = jumpLimit;
+  atomic_init(&job.nextShard, 0);
+
+  // shards are byte ranges of the capture, so each one is a contiguous span of time
+  uint32_t n = 0;
+  for(uint32_t i = 0; i < captureCount; i++)
+  {
+    for(size_t start = 0; start < captures[i].size; start += shardBytes)
+    {
+      shard_t* shard = &job.shards[n++];
+      shard->capture = i;
+      shard->start = start;
+      shard->end = start + shardBytes < captures[i].size ? start + shardBytes : captures[i].size;
+    }
+  }
+
+  uint64_t begin = HOST_nowNs();
+  if(threads > shardCount)
+  {
+    threads = shardCount ? shardCount : 1;
+  }
+  pthread_t* pool = calloc((size_t)threads, sizeof(pthread_t));
+  for(long i = 1; i < threads; i++)
+  {
+    pthread_create(&pool[i], NULL, worker, &job);
+  }
+  worker(&job);
+  for(long i = 1; i < threads; i++)
+  {
+    pthread_join(pool[i], NULL);
+  }
+  uint64_t decoded = HOST_nowNs();
+
+  // a shard can't tell where its first frame starts until the previous shard
+  // says where its last frame ended; count the bytes in between as skipped
+  uint32_t resyncs = 0;
+  for(uint32_t i = 1; i < shardCount; i++)
+  {
+    shard_t* previous = &job.shards[i - 1];
+    shard_t* shard = &job.shards[i];
+    if(shard->start == 0)
+    {
+      continue;
+    }
+    if(shard->firstFrame >= previous->stop)
+    {
+      shard->result.skippedBytes += shard->firstFrame - previous->stop;
+    }
+    else
+    {
+      resyncs++; // the two walks disagree about a frame near the boundary
+    }
+  }
+
+  analytics_t total;
+  ANALYTICS_init(&total, 0, job.gapUs, jumpLimit);
+  for(uint32_t i = 0; i < shardCount; i++)
+  {
+    if(ANALYTICS_merge(&total, &job.shards[i].result) != 0)
+    {
+      fprintf(stderr, "out of memory\n");
+      return 1;
+    }
+  }
+  ANALYTICS_finish(&total);
+  uint64_t merged = HOST_nowNs();
+
+  for(uint32_t i = 0; i < total.sessionCount; i++)
+  {
+    printSession(i + 1, &captures[total.sessions[i].source], &total.sessions[i]);
+  }
+  double seconds = (decoded - begin) / 1e9;
+  fprintf(stderr, "%.1f MB in %u shards on %ld threads: decode %.3f s (%.0f MB/s), merge %.3f ms; "
+          "%llu bad frames, %llu skipped bytes, %u boundary resyncs\n",
+          totalBytes / 1e6, shardCount, threads, seconds, seconds > 0 ? totalBytes / 1e6 / seconds : 0.0,
+          (merged - decoded) / 1e6, (unsigned long long)total.badFrames, (unsigned long long)total.skippedBytes, resyncs);
+
+  ANALYTICS_free(&total);
+  for(uint32_t i = 0; i < captureCount; i++)
+  {
+    if(captures[i].size)
+    {
+      munmap((void*)captures[i].data, captures[i].size);
+    }
+  }
+  free(pool);
+  free(job.shards);
+  free(captures);
+  return 0;
+}
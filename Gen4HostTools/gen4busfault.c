@@ -0,0 +1,348 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+/** gen4busfault - runs the sketch's API_C2 and API_HostBus code against the
+	simulated pad (SimGen4.h) on a SimBus that injects faults: NAKs, short
+	reads, clock stretching past the deadline, and SDA held low by a device
+	that clocking frees, or does not. Stretching runs twice: with a Wire that
+	ends the transfer at the deadline (setWireTimeout), and with one that
+	waits for as long as the device holds SCL, as the Teensy 3.x Wire does.
+	For each fault it mixes report reads,
+	extended memory reads and writes, and checks that
+	  - every failure is reported as a Host Bus status,
+	  - no operation that reported SUCCESS returned wrong data,
+	  - a failed memory read never returns bytes the bus did not deliver,
+	  - the bus time of every operation stays under the bound the deadlines
+	    give (two transactions, each at most one deadline plus a bus clear;
+	    without a Wire timeout one of them lasts the whole stretch).
+	Then, on a virtual clock taken past 2^31 and 2^32 us, it checks that
+	API_C2_reportWaiting holds a report read off for REPORT_RETRY_US after
+	a failed one and no longer, however long the board has been running.
+	Exits non-zero if any check fails, so it doubles as a regression check.
+
+	usage: gen4busfault [-n operations] [-p fault_percent] [-k i2c_khz] [-t timeout_us] [-s seed] [-v] */
+
+#define _GNU_SOURCE
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "API_C2.h"
+#include "API_HostBus.h"
+#include "SimBus.h"
+#include "SimGen4.h"
+#include "SimHardware.h"
+
+#define REGION_START   (0x2000)   /**< Memory used for the checks, clear of the command registers */
+#define REGION_SIZE    (0x1000)
+#define READ_SIZE      (32)
+#define WRITE_SIZE     (8)
+#define STUCK_OPS      (5)        /**< Operations a never-released SDA lasts before the fault ends */
+
+typedef struct
+{
+  const char* name;
+  uint8_t     fault;
+  uint16_t    count;              /**< Passed to SIMBUS_injectFault */
+  bool        wireTimeout;        /**< Passed to SIMBUS_setWireTimeout */
+} scenario_t;
+
+static const scenario_t _scenarios[] =
+{
+  { "none",         SIMBUS_FAULT_NONE,       0,                    false },
+  { "nak",          SIMBUS_FAULT_NAK,        1,                    false },
+  { "short-read",   SIMBUS_FAULT_SHORT_READ, 1,                    false },
+  { "stretch",      SIMBUS_FAULT_STRETCH,    1,                    true },
+  { "stretch-held", SIMBUS_FAULT_STRETCH,    1,                    false },
+  { "sda-stuck",    SIMBUS_FAULT_SDA_STUCK,  5,                    false },
+  { "sda-stuck-18", SIMBUS_FAULT_SDA_STUCK,  18,                   false },
+  { "sda-forever",  SIMBUS_FAULT_SDA_STUCK,  SIMBUS_STUCK_FOREVER, false },
+};
+
+typedef struct
+{
+  uint32_t operations;
+  uint32_t injected;
+  uint32_t failed;                /**< Operations that returned a failure status */
+  uint32_t timeouts;              /**< ... of which BUS_TIMEOUT */
+  uint32_t undetected;            /**< SUCCESS with wrong data */
+  uint32_t stale;                 /**< Failed memory reads that returned bus bytes */
+  uint32_t falseAlarms;           /**< Failures with no fault injected */
+  uint32_t recoveries;
+  uint64_t maxBusUs;
+} result_t;
+
+static bool verbose_g = false;
+
+static void usage(const char* argv0)
+{
+  fprintf(stderr,
+          "usage: %s [-n operations] [-p fault_percent] [-k i2c_khz] [-t timeout_us] [-s seed] [-v]\n"
+          "  -n  operations per fault type (default 3000)\n"
+          "  -p  percentage of operations that start with a fault (default 10)\n"
+          "  -k  I2C clock used to work out bus time (default 400)\n"
+          "  -t  I2C transaction deadline (default I2C_TIMEOUT_US)\n"
+          "  -s  random seed (default 1)\n"
+          "  -v  print every failed operation\n",
+          argv0);
+}
+
+static bool dataReady(const void* context)
+{
+  return SIMGEN4_dataReady((const simGen4_t*)context);
+}
+
+/** Bus time so far: the traffic at clockHz plus what SimBus counted for deadlines and clearing */
+static uint64_t busTimeUs(uint32_t clockHz)
+{
+  simBusStats_t* stats = SIMBUS_getStats();
+  uint64_t bits = 9ull * ((uint64_t)stats->bytesRead + stats->bytesWritten
+                          + stats->readTransactions + stats->writeTransactions);
+  return bits * 1000000ull / clockHz + stats->stalledUs;
+}
+
+static bool allZero(const uint8_t* data, uint16_t count)
+{
+  for(uint16_t i = 0; i < count; i++)
+  {
+    if(data[i] != 0)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+/** One report read, memory read or memory write, picked by index.
+	Returns the Host Bus status and counts wrong data in result. */
+static uint8_t runOperation(simGen4_t* pad, uint32_t index, result_t* result)
+{
+  uint8_t status;
+
+  if(index % 3 == 0)
+  {
+    uint8_t expected[PACKET_SIZE], packet[PACKET_SIZE];
+    report_t report;
+    pad->queueCount = 0;              // a report a failed read left behind
+    for(uint16_t i = 0; i < PACKET_SIZE; i++)
+    {
+      expected[i] = (uint8_t)rand();
+    }
+    SIMGEN4_queuePacket(pad, expected);
+    status = API_C2_getReportPacket(packet, &report);
+    if(status == SUCCESS && memcmp(packet, expected, PACKET_SIZE) != 0)
+    {
+      result->undetected++;
+    }
+  }
+  else if(index % 3 == 1)
+  {
+    uint8_t data[READ_SIZE];
+    uint32_t address = REGION_START + (uint32_t)rand() % (REGION_SIZE - READ_SIZE);
+    memset(data, 0xA5, sizeof(data));
+    status = API_C2_readMemory(address, data, READ_SIZE);
+    if(status == SUCCESS && memcmp(data, &pad->memory[address], READ_SIZE) != 0)
+    {
+      result->undetected++;
+    }
+    if((status & (BUS_TIMEOUT | NO_RESPONSE)) && !allZero(data, READ_SIZE))
+    {
+      result->stale++;
+    }
+  }
+  else
+  {
+    uint8_t data[WRITE_SIZE];
+    uint32_t address = REGION_START + (uint32_t)rand() % (REGION_SIZE - WRITE_SIZE);
+    for(uint16_t i = 0; i < WRITE_SIZE; i++)
+    {
+      data[i] = (uint8_t)rand();
+    }
+    status = API_C2_writeMemory(address, data, WRITE_SIZE);
+    if(status == SUCCESS && memcmp(data, &pad->memory[address], WRITE_SIZE) != 0)
+    {
+      result->undetected++;
+    }
+  }
+  return status;
+}
+
+/** Moves the virtual clock on to atUs after API_Hardware_init */
+static void advanceTo(uint64_t* nowUs, uint64_t atUs)
+{
+  while(*nowUs < atUs)
+  {
+    uint64_t step = atUs - *nowUs < (1ull << 30) ? atUs - *nowUs : (1ull << 30);
+    SIMHW_advance((uint32_t)step);
+    *nowUs += step;
+  }
+}
+
+/** Fails a report read at each of a few times, some past where micros() 
+	turns negative as an int32_t or wraps, and checks when
+	API_C2_reportWaiting lets the next read through. Returns the checks
+	that went wrong. */
+static int checkRetry(simGen4_t* pad)
+{
+  static const uint64_t at[] = { 1000, (1ull << 31) - 5000, (1ull << 31) + 5000,
+                                 (1ull << 32) + 5000, 3ull << 31, (3ull << 31) + (1ull << 31) + 20000 };
+  uint8_t packet[PACKET_SIZE];
+  uint64_t nowUs = 0;
+  int wrong = 0;
+
+  memset(packet, 0, sizeof(packet));
+  SIMBUS_injectFault(SIMBUS_FAULT_NONE, 0);
+  SIMHW_useVirtualClock();
+  API_Hardware_init();
+  for(size_t i = 0; i < sizeof(at) / sizeof(at[0]); i++)
+  {
+    advanceTo(&nowUs, at[i]);
+    pad->queueCount = 0;
+    SIMGEN4_queuePacket(pad, packet);
+    bool ready = API_C2_reportWaiting(API_Hardware_micros());
+
+    SIMBUS_injectFault(SIMBUS_FAULT_NAK, 1);
+    bool failed = API_C2_readReportPacket(packet) != SUCCESS;
+    SIMBUS_injectFault(SIMBUS_FAULT_NONE, 0);
+    pad->queueCount = 0;
+    SIMGEN4_queuePacket(pad, packet);
+    bool heldOff = !API_C2_reportWaiting(API_Hardware_micros());
+    advanceTo(&nowUs, nowUs + REPORT_RETRY_US - 1);
+    heldOff = heldOff && !API_C2_reportWaiting(API_Hardware_micros());
+    advanceTo(&nowUs, nowUs + 1);
+    bool retried = API_C2_reportWaiting(API_Hardware_micros())
+                   && API_C2_readReportPacket(packet) == SUCCESS;
+
+    bool pass = ready && failed && heldOff && retried;
+    printf("retry at %11llu us (micros %10u): %s\n", (unsigned long long)at[i], (uint32_t)at[i],
+           pass ? "ok" : "FAIL");
+    wrong += pass ? 0 : 1;
+  }
+  return wrong;
+}
+
+static void runScenario(const scenario_t* scenario, simGen4_t* pad, uint32_t operations,
+                        uint32_t percent, uint32_t clockHz, result_t* result)
+{
+  uint32_t stuckLeft = 0;
+
+  memset(result, 0, sizeof(*result));
+  SIMBUS_injectFault(SIMBUS_FAULT_NONE, 0);
+  SIMBUS_setWireTimeout(scenario->wireTimeout);
+  SIMBUS_resetStats();
+  for(uint32_t i = 0; i < operations; i++)
+  {
+    bool inject = scenario->fault != SIMBUS_FAULT_NONE && stuckLeft == 0
+                  && (uint32_t)(rand() % 100) < percent;
+    if(inject)
+    {
+      SIMBUS_injectFault(scenario->fault, scenario->count);
+      result->injected++;
+      stuckLeft = (scenario->count == SIMBUS_STUCK_FOREVER) ? STUCK_OPS : 0;
+    }
+
+    uint64_t start = busTimeUs(clockHz);
+    uint8_t status = runOperation(pad, i, result);
+    uint64_t busUs = busTimeUs(clockHz) - start;
+
+    result->operations++;
+    if(busUs > result->maxBusUs)
+    {
+      result->maxBusUs = busUs;
+    }
+    if(status != SUCCESS)
+    {
+      result->failed++;
+      if(status & BUS_TIMEOUT)
+      {
+        result->timeouts++;
+      }
+      if(!inject && stuckLeft == 0)
+      {
+        result->falseAlarms++;
+      }
+      if(verbose_g)
+      {
+        printf("%s: operation %u status 0x%02X, %llu us\n", scenario->name, i, status,
+               (unsigned long long)busUs);
+      }
+    }
+    if(scenario->fault != SIMBUS_FAULT_SDA_STUCK)
+    {
+      SIMBUS_injectFault(SIMBUS_FAULT_NONE, 0);   // e.g. a read fault when the operation was a write
+    }
+    else if(stuckLeft > 0 && --stuckLeft == 0)
+    {
+      SIMBUS_injectFault(SIMBUS_FAULT_NONE, 0);   // the pad powered back up
+    }
+  }
+  result->recoveries = SIMBUS_getStats()->recoveries;
+  if(scenario->fault != SIMBUS_FAULT_SDA_STUCK)
+  {
+    result->injected = SIMBUS_getStats()->faults;   // the ones that found a transaction to hit
+  }
+}
+
+int main(int argc, char** argv)
+{
+  uint32_t operations = 3000, percent = 10, clockHz = 400000, timeoutUs = I2C_TIMEOUT_US, seed = 1;
+  int opt;
+
+  while((opt = getopt(argc, argv, "n:p:k:t:s:vh")) != -1)
+  {
+    switch(opt)
+    {
+      case 'n': operations = (uint32_t)strtoul(optarg, NULL, 0); break;
+      case 'p': percent = (uint32_t)strtoul(optarg, NULL, 0); break;
+      case 'k': clockHz = (uint32_t)strtoul(optarg, NULL, 0) * 1000u; break;
+      case 't': timeoutUs = (uint32_t)strtoul(optarg, NULL, 0); break;
+      case 's': seed = (uint32_t)strtoul(optarg, NULL, 0); break;
+      case 'v': verbose_g = true; break;
+      default: usage(argv[0]); return 2;
+    }
+  }
+  if(clockHz == 0)
+  {
+    usage(argv[0]);
+    return 2;
+  }
+  srand(seed);
+
+  static simGen4_t pad;
+  SIMGEN4_init(&pad, CIRQUE_SLAVE_ADDR);
+  for(uint32_t i = 0; i < REGION_SIZE; i++)
+  {
+    pad.memory[REGION_START + i] = (uint8_t)rand();
+  }
+  SIMBUS_attach(&pad.device);
+  SIMHW_setDataReady(dataReady, &pad);
+  API_C2_init((int32_t)clockHz, CIRQUE_SLAVE_ADDR);
+  I2C_setTimeout(timeoutUs);
+
+  // Worst operation: a memory read of READ_SIZE, both transactions waiting out
+  // a deadline and clearing the bus, plus the traffic itself
+  uint64_t transferUs = 9ull * (8 + READ_SIZE + 3 + 2) * 1000000ull / clockHz;
+  uint64_t boundUs = 2ull * (timeoutUs + 9 * SIMBUS_RECOVERY_CLOCK_US + SIMBUS_RECOVERY_EXTRA_US) + transferUs;
+  // Without a Wire timeout a stretched transfer takes the whole stretch instead of a deadline
+  uint64_t heldBoundUs = boundUs + (SIMBUS_STRETCH_US > timeoutUs ? SIMBUS_STRETCH_US - timeoutUs : 0);
+
+  int failures = 0;
+  printf("%-13s %6s %8s %7s %8s %10s %6s %6s %10s %11s\n", "fault", "ops", "injected", "failed",
+         "timeouts", "undetected", "stale", "false", "recoveries", "max bus us");
+  for(size_t s = 0; s < sizeof(_scenarios) / sizeof(_scenarios[0]); s++)
+  {
+    result_t result;
+    runScenario(&_scenarios[s], &pad, operations, percent, clockHz, &result);
+    bool held = _scenarios[s].fault == SIMBUS_FAULT_STRETCH && !_scenarios[s].wireTimeout;
+    bool pass = result.undetected == 0 && result.stale == 0 && result.falseAlarms == 0
+                && result.maxBusUs <= (held ? heldBoundUs : boundUs);
+    printf("%-13s %6u %8u %7u %8u %10u %6u %6u %10u %11llu %s\n", _scenarios[s].name, result.operations,
+           result.injected, result.failed, result.timeouts, result.undetected, result.stale,
+           result.falseAlarms, result.recoveries, (unsigned long long)result.maxBusUs, pass ? "ok" : "FAIL");
+    failures += pass ? 0 : 1;
+  }
+  printf("bound per operation: %llu us (deadline %u us), %llu us when held by a %u us stretch\n",
+         (unsigned long long)boundUs, timeoutUs, (unsigned long long)heldBoundUs, SIMBUS_STRETCH_US);
+  failures += checkRetry(&pad);
+  return failures == 0 ? 0 : 1;
+}
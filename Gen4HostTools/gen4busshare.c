@@ -0,0 +1,210 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+/** gen4busshare - runs the touchpad and the INA219 on one simulated bus
+	through API_Bus.h: a simulated pad (SimGen4.h) with a report every
+	report_us, and an INA219 (SimINA219.h) sampled in 12 bit bursts by a loop
+	that only reads reports when INA219_readBurst gives way. Each device
+	runs at its own clock.
+
+	Checks that every report was read, that no INA219 transaction was made
+	while Data Ready was asserted, and that the clock was right for every
+	transaction. Prints each device's API_Bus accounting, with bus time
+	worked out from the bytes each device moved at its clock (SimBus itself
+	takes none, so the measured times on the host are near 0).
+
+	usage: gen4busshare [-d ms] [-r report_us] [-p pad_khz] */
+
+#define _GNU_SOURCE
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "API_Bus.h"
+#include "API_C2.h"
+#include "API_Hardware.h"
+#include "HostSynth.h"
+#include "INA219.h"
+#include "SimBus.h"
+#include "SimGen4.h"
+#include "SimHardware.h"
+#include "SimINA219.h"
+
+/** Per device traffic seen by the device callbacks */
+typedef struct
+{
+  simDevice_t* device;
+  void (*write)(simDevice_t* device, const uint8_t* data, uint16_t count, bool stop);
+  uint16_t (*read)(simDevice_t* device, uint8_t* data, uint16_t count);
+  uint32_t clockFrequency;  /**< The clock it must be addressed at */
+  uint32_t transactions;
+  uint32_t wrongClock;      /**< Transactions at another clock */
+  uint32_t duringDR;        /**< Transactions while the pad had a report waiting */
+  double   busUs;           /**< 9 bits per byte and address byte, at the bus clock */
+} tap_t;
+
+static simGen4_t pad_g;
+static simINA219_t ina_g;
+static tap_t taps_g[2];
+
+static void usage(const char* argv0)
+{
+  fprintf(stderr,
+          "usage: %s [-d ms] [-r report_us] [-p pad_khz]\n"
+          "  -d  how long to run (default 1000)\n"
+          "  -r  time between reports (default 8000)\n"
+          "  -p  pad clock; the INA219 stays at %u kHz (default 100)\n",
+          argv0, INA219_CLOCK_FREQUENCY / 1000);
+}
+
+static bool dataReady(const void* context)
+{
+  return SIMGEN4_dataReady((const simGen4_t*)context);
+}
+
+/************************************************************/
+/************************************************************/
+/******************* HELPER FUNCTIONS ***********************/
+
+static tap_t* findTap(simDevice_t* device)
+{
+  return (taps_g[0].device == device) ? &taps_g[0] : &taps_g[1];
+}
+
+static void count(tap_t* tap, uint16_t bytes)
+{
+  uint32_t clock = SIMBUS_getStats()->clockFrequency;
+  tap->transactions++;
+  tap->busUs += 9.0 * (bytes + 1) * 1e6 / clock;
+  if(clock != tap->clockFrequency)
+  {
+    tap->wrongClock++;
+  }
+  if(tap->device == &ina_g.device && SIMGEN4_dataReady(&pad_g))
+  {
+    tap->duringDR++;
+  }
+}
+
+static void tapWrite(simDevice_t* device, const uint8_t* data, uint16_t bytes, bool stop)
+{
+  tap_t* tap = findTap(device);
+  count(tap, bytes);
+  tap->write(device, data, bytes, stop);
+}
+
+static uint16_t tapRead(simDevice_t* device, uint8_t* data, uint16_t bytes)
+{
+  tap_t* tap = findTap(device);
+  count(tap, bytes);
+  return tap->read(device, data, bytes);
+}
+
+static void attachTapped(tap_t* tap, simDevice_t* device, uint32_t clockFrequency)
+{
+  tap->device = device;
+  tap->write = device->write;
+  tap->read = device->read;
+  tap->clockFrequency = clockFrequency;
+  device->write = tapWrite;
+  device->read = tapRead;
+  SIMBUS_attach(device);
+}
+
+/************************************************************/
+/************************************************************/
+/************************** MAIN ****************************/
+
+int main(int argc, char** argv)
+{
+  uint32_t durationUs = 1000000, reportUs = 8000, padClock = 100000;
+  int opt;
+
+  while((opt = getopt(argc, argv, "d:r:p:h")) != -1)
+  {
+    switch(opt)
+    {
+      case 'd': durationUs = (uint32_t)strtoul(optarg, NULL, 0) * 1000u; break;
+      case 'r': reportUs = (uint32_t)strtoul(optarg, NULL, 0); break;
+      case 'p': padClock = (uint32_t)strtoul(optarg, NULL, 0) * 1000u; break;
+      default: usage(argv[0]); return 2;
+    }
+  }
+  if(durationUs == 0 || reportUs == 0 || padClock == 0)
+  {
+    usage(argv[0]);
+    return 2;
+  }
+
+  synth_t synth;
+  uint8_t packet[PACKET_SIZE];
+  uint32_t queued = 0, read = 0, samples = 0, bursts = 0;
+
+  SIMGEN4_init(&pad_g, CIRQUE_SLAVE_ADDR);
+  SIMINA_init(&ina_g, 0x40);
+  SIMBUS_detachAll();
+  attachTapped(&taps_g[0], &pad_g.device, padClock);
+  attachTapped(&taps_g[1], &ina_g.device, INA219_CLOCK_FREQUENCY);
+  SIMHW_setDataReady(dataReady, &pad_g);
+  SYNTH_init(&synth, CRQ_ABSOLUTE_REPORT_ID, 8000, 0);
+
+  // the sketch's order: API_Hardware_init starts the INA219, then the pad
+  API_Hardware_init();
+  INA219_init(0x40);
+  INA219_config(CONFIG__FS_RANGE_16V | CONFIG__SHUNT_PGA_DIV8);
+  API_Hardware_PowerOn();
+  API_C2_init((int32_t)padClock, CIRQUE_SLAVE_ADDR);
+  API_Bus_resetStats();
+
+  uint32_t start = API_Hardware_micros(), nextReport = start;
+  INA219_startBurst(CONFIG__SHUNT_ADC_RES_12);
+  while(API_Hardware_micros() - start < durationUs)
+  {
+    int32_t microvolts;
+    if((int32_t)(API_Hardware_micros() - nextReport) >= 0)
+    {
+      SYNTH_nextPacket(&synth, packet);
+      queued += SIMGEN4_queuePacket(&pad_g, packet) ? 1 : 0;
+      nextReport += reportUs;
+    }
+    if(INA219_readBurst(&microvolts))
+    {
+      if(++samples % 1000 == 0)
+      {
+        INA219_stopBurst();
+        INA219_startBurst(CONFIG__SHUNT_ADC_RES_12);
+        bursts++;
+      }
+    }
+    else if(API_C2_DR_Asserted() && API_C2_readReportPacket(packet) == SUCCESS)
+    {
+      read++;
+    }
+  }
+  INA219_stopBurst();
+  while(API_C2_DR_Asserted() && API_C2_readReportPacket(packet) == SUCCESS)
+  {
+    read++;
+  }
+
+  printf("%-8s %6s %7s %9s %8s %6s %6s %8s %8s\n", "device", "kHz", "ops", "deferred", "clock", "i2c",
+         "wrong", "during", "bus ms");
+  printf("%-8s %6s %7s %9s %8s %6s %6s %8s %8s\n", "", "", "", "", "changes", "", "clock", "DR", "");
+  int failures = 0;
+  for(uint8_t i = 0; i < API_Bus_getDeviceCount(); i++)
+  {
+    const busDevice_t* device = API_Bus_getDevice(i);
+    tap_t* tap = (device->address == CIRQUE_SLAVE_ADDR) ? &taps_g[0] : &taps_g[1];
+    printf("%-8s %6u %7u %9u %8u %6u %6u %8u %8.1f\n", device->name, device->clockFrequency / 1000,
+           device->stats.operations, device->stats.deferrals, device->stats.clockChanges,
+           tap->transactions, tap->wrongClock, tap->duringDR, tap->busUs / 1000.0);
+    failures += (tap->wrongClock != 0 || tap->duringDR != 0);
+  }
+  printf("reports %u queued, %u read; %u samples in %u bursts\n", queued, read, samples, bursts + 1);
+  if(read != queued)
+  {
+    fprintf(stderr, "%u reports not read\n", queued - read);
+    failures++;
+  }
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,1438 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+/** gen4capture - records everything the dev kit sends over its serial port,
+	for hours at full USB serial rate, into a compact indexed capture file.
+
+	A reader thread does nothing but read the tty into a lock free queue of
+	chunks, each stamped with the host time its read returned. A writer
+	thread packs the chunks into length framed, timestamped records in large
+	batches aligned to CAP_ALIGN and writes them with POSIX asynchronous I/O,
+	to disk directly (O_DIRECT) where the file system allows it, one batch in
+	flight while the next one fills. Every -i batches an index block lists
+	where each batch starts, its first record time and its place in the byte
+	stream, so a capture can be cut anywhere without reading what comes
+	before. Memory is the queue and two batches, however long the capture.
+	Input that finds the queue full is read anyway, so the board is never
+	held up, but thrown away; it is counted, and a drop record in the capture
+	says how much was lost where.
+
+	-l checks a capture and prints what it holds, -x writes out the bytes
+	received between two times, e.g. for gen4analyze or gen4trace. -S runs a
+	self test: a thread writes a known byte pattern to a pty at the given
+	rate while it is captured, then the capture is checked byte for byte.
+
+	usage: gen4capture [-o file] [-q chunks] [-B batch_kb] [-i batches] [-f flush_ms]
+	                   [-p seconds] [-d seconds] [-b] <tty or pty>
+	       gen4capture -S kbytes_per_s [-W stall_ms] [-d seconds] [-o file] [...]
+	       gen4capture -l file
+	       gen4capture -x [-t from_s] [-T to_s] [-o out] file */
+
+#define _GNU_SOURCE
+#include <aio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <linux/futex.h>
+#include <limits.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "HostUtil.h"
+
+/* Capture file layout, little endian:
+     header   capHeader_t in the first CAP_ALIGN bytes, completed on close
+     batch    capBatch_t, its records, zero padding to a multiple of CAP_ALIGN
+     record   capRecord_t, then length bytes padded to a multiple of 8
+     index    capIndex_t, then a capIndexEntry_t for each batch written since
+              the index before it, CAP_ALIGN bytes
+   A capture that was not closed (power cut, kill -9) has no last index in
+   its header; readers then find the batches by walking their headers. */
+#define CAP_ALIGN           (4096)
+#define CAP_VERSION         (1)
+#define CAP_MAGIC           (0x50433447u)   /**< "G4CP" */
+#define CAP_MAGIC_BATCH     (0x42433447u)   /**< "G4CB" */
+#define CAP_MAGIC_INDEX     (0x49433447u)   /**< "G4CI" */
+
+#define CAP_RECORD_DATA     (1)             /**< Bytes as one read returned them */
+#define CAP_RECORD_DROP     (2)             /**< uint64_t bytes lost here for want of queue room */
+
+#define CHUNK_SIZE          (4096)          /**< Most one tty read returns */
+#define PREALLOCATE         (64ull << 20)   /**< File space reserved ahead of the writes */
+#define DEFAULT_PATH        "capture.g4c"
+
+typedef struct
+{
+  uint32_t magic;
+  uint32_t version;
+  uint32_t align;
+  uint32_t batchSize;           /**< Largest batch */
+  uint64_t startNs;             /**< CLOCK_MONOTONIC at the start, the clock of the records */
+  uint64_t startRealNs;         /**< CLOCK_REALTIME at the same moment */
+  uint64_t lastIndex;           /**< Offset of the last index block, 0 until closed */
+  uint64_t end;                 /**< Offset the capture ends at, 0 until closed */
+  uint64_t records;
+  uint64_t bytes;               /**< Bytes captured */
+  uint64_t dropped;             /**< Bytes lost */
+  char     source[64];
+} capHeader_t;
+
+typedef struct
+{
+  uint32_t magic;
+  uint32_t size;                /**< Bytes in the file, a multiple of CAP_ALIGN */
+  uint32_t used;                /**< Bytes of this header and the records */
+  uint32_t records;
+  uint64_t sequence;
+  uint64_t firstNs;
+  uint64_t lastNs;
+  uint64_t firstByte;           /**< Stream bytes, captured and lost, before the first record */
+} capBatch_t;
+
+typedef struct
+{
+  uint32_t length;              /**< Bytes following, without padding */
+  uint32_t type;                /**< CAP_RECORD_ */
+  uint64_t hostNs;
+} capRecord_t;
+
+typedef struct
+{
+  uint32_t magic;
+  uint32_t size;
+  uint32_t entries;
+  uint32_t reserved;
+  uint64_t previous;            /**< Offset of the index block before, 0 for the first */
+} capIndex_t;
+
+typedef struct
+{
+  uint64_t offset;
+  uint64_t firstNs;
+  uint64_t firstByte;
+} capIndexEntry_t;
+
+#define INDEX_ENTRIES       ((uint32_t)((CAP_ALIGN - sizeof(capIndex_t)) / sizeof(capIndexEntry_t)))
+
+_Static_assert(sizeof(capHeader_t) <= CAP_ALIGN, "capture header must fit its block");
+_Static_assert(sizeof(capBatch_t) == 48 && sizeof(capRecord_t) == 16 && sizeof(capIndex_t) == 24,
+               "capture structures are a file format");
+
+/** One read from the tty. Chunks are cache line aligned so the reader
+	filling one never shares a line with the writer emptying another. */
+typedef struct
+{
+  uint64_t hostNs;              /**< When the read returned */
+  uint64_t dropped;             /**< Bytes lost just before these */
+  uint32_t length;
+  uint8_t  data[CHUNK_SIZE];
+} __attribute__((aligned(64))) chunk_t;
+
+/** Single producer, single consumer queue between the two threads. */
+typedef struct
+{
+  chunk_t*         chunks;
+  uint32_t         mask;
+  _Atomic uint64_t head __attribute__((aligned(64)));    /**< Chunks filled, moved by the reader */
+  _Atomic uint64_t tail __attribute__((aligned(64)));    /**< Chunks taken, moved by the writer */
+  _Atomic uint32_t wakeup __attribute__((aligned(64)));  /**< Futex word the writer sleeps on */
+  _Atomic uint32_t sleeping;
+  _Atomic uint32_t done;        /**< The reader has stopped; head is final */
+  uint64_t         trailingDrop; /**< Bytes lost after the last chunk, set before done */
+} queue_t;
+
+typedef struct
+{
+  _Atomic uint64_t bytes;       /**< Read from the tty */
+  _Atomic uint64_t dropped;     /**< Of those, lost for want of queue room */
+  _Atomic uint64_t written;     /**< File bytes written */
+  _Atomic uint32_t maxFill;     /**< Most chunks queued at once */
+  uint64_t         reads;
+  uint64_t         dropRuns;    /**< Separate losses; each is one drop record */
+  uint64_t         records;
+  uint64_t         batches;
+  uint64_t         indexes;
+  uint64_t         waits;       /**< Times the writer waited for a write to finish */
+  uint64_t         maxWaitNs;
+} stats_t;
+
+typedef struct
+{
+  int              fd;
+  bool             direct;
+  uint32_t         batchSize;
+  uint32_t         indexEvery;
+  uint64_t         flushNs;
+  uint64_t         stallNs;     /**< Self test: pause after each batch, to make the queue overflow */
+  uint8_t*         buffer[2];
+  struct aiocb     io[2];
+  bool             inFlight[2];
+  int              current;
+  uint32_t         used;
+  uint32_t         records;
+  uint64_t         firstNs;
+  uint64_t         lastNs;
+  uint64_t         firstByte;
+  uint64_t         streamByte;  /**< Bytes captured and lost so far */
+  uint64_t         sequence;
+  uint64_t         offset;      /**< Where the next batch goes */
+  uint64_t         allocated;
+  uint64_t         lastIndex;
+  capIndexEntry_t  entries[INDEX_ENTRIES];
+  uint32_t         entryCount;
+  uint8_t*         block;       /**< CAP_ALIGN bytes for the header and index blocks */
+  capHeader_t      header;
+  bool             failed;
+} writer_t;
+
+typedef struct
+{
+  int              fd;
+  const char*      path;
+  bool             enableStream;
+} reader_t;
+
+/** Self test input: a byte pattern written to a pty master at a fixed rate. */
+typedef struct
+{
+  int              master;
+  uint64_t         bytesPerS;
+  uint64_t         durationNs;
+  uint64_t         sent;
+  const int*       readerFd;
+} generator_t;
+
+/** An open capture file. */
+typedef struct
+{
+  int              fd;
+  capHeader_t      header;
+  capIndexEntry_t* entries;     /**< One per batch, in file order */
+  uint32_t         count;
+  uint32_t         indexes;
+  uint8_t*         batch;
+} capture_t;
+
+static volatile sig_atomic_t running_g = 1;
+static queue_t queue_g;
+static stats_t stats_g;
+static writer_t writer_g;
+
+static void onSignal(int sig)
+{
+  (void)sig;
+  running_g = 0;
+}
+
+static void usage(const char* argv0)
+{
+  fprintf(stderr,
+          "usage: %s [-o file] [-q chunks] [-B batch_kb] [-i batches] [-f flush_ms]\n"
+          "       %*s [-p seconds] [-d seconds] [-b] <tty or pty>\n"
+          "       %s -S kbytes_per_s [-W stall_ms] [-d seconds] [-o file] [...]\n"
+          "       %s -l file\n"
+          "       %s -x [-t from_s] [-T to_s] [-o out] file\n"
+          "  -o  capture file (default " DEFAULT_PATH "), or with -x where the bytes go (default stdout)\n"
+          "  -q  queue chunks of %d bytes, rounded up to a power of two (default 1024)\n"
+          "  -B  batch size in KB, a multiple of 4 (default 1024)\n"
+          "  -i  batches per index block, 1 to %u (default 64)\n"
+          "  -f  longest a record waits for its batch to be written (default 1000 ms)\n"
+          "  -p  print progress every so many seconds\n"
+          "  -d  stop after so many seconds (default: until interrupted or the input closes)\n"
+          "  -b  send 'b' to the board to turn on binary streaming\n"
+          "  -S  self test: capture a pty fed this many KB/s (default 10 s)\n"
+          "  -W  self test: stall the writer this long after each batch\n"
+          "  -l  check a capture and print what it holds\n"
+          "  -x  write out the bytes received from -t to -T seconds into the capture\n",
+          argv0, (int)strlen(argv0), "", argv0, argv0, argv0, CHUNK_SIZE, INDEX_ENTRIES);
+}
+
+/************************************************************/
+/************************************************************/
+/******************* HELPER FUNCTIONS ***********************/
+
+static int futex(_Atomic uint32_t* word, int op, uint32_t value, const struct timespec* timeout)
+{
+  return (int)syscall(SYS_futex, (uint32_t*)word, op, value, timeout, NULL, 0);
+}
+
+static uint32_t alignUp(uint32_t value, uint32_t align)
+{
+  return (value + align - 1) / align * align;
+}
+
+static void sleepNs(uint64_t ns)
+{
+  struct timespec ts = { (time_t)(ns / 1000000000ull), (long)(ns % 1000000000ull) };
+  while(nanosleep(&ts, &ts) != 0 && errno == EINTR)
+  {
+  }
+}
+
+static uint64_t realNs(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/** Peak resident memory in KB, from /proc, or 0. */
+static unsigned long peakRssKb(void)
+{
+  FILE* file = fopen("/proc/self/status", "r");
+  char line[128];
+  unsigned long kb = 0;
+  while(file != NULL && fgets(line, sizeof(line), file) != NULL)
+  {
+    if(sscanf(line, "VmHWM: %lu", &kb) == 1)
+    {
+      break;
+    }
+  }
+  if(file != NULL)
+  {
+    fclose(file);
+  }
+  return kb;
+}
+
+/** Byte i of the self test stream. */
+static uint8_t patternByte(uint64_t i)
+{
+  return (uint8_t)(((uint32_t)i * 2654435761u) >> 24);
+}
+
+/************************************************************/
+/************************************************************/
+/******************* WRITER *********************************/
+
+/** Waits for the write from buffer i, if any, and checks it all went out. */
+static int waitWrite(writer_t* writer, int i)
+{
+  if(!writer->inFlight[i])
+  {
+    return 0;
+  }
+  struct aiocb* io = &writer->io[i];
+  const struct aiocb* list[1] = { io };
+  uint64_t start = HOST_nowNs();
+  int error;
+  while((error = aio_error(io)) == EINPROGRESS)
+  {
+    aio_suspend(list, 1, NULL);
+  }
+  uint64_t waited = HOST_nowNs() - start;
+  stats_g.waits++;
+  if(waited > stats_g.maxWaitNs)
+  {
+    stats_g.maxWaitNs = waited;
+  }
+  writer->inFlight[i] = false;
+  ssize_t written = aio_return(io);
+  if(error != 0 || written != (ssize_t)io->aio_nbytes)
+  {
+    errno = error != 0 ? error : EIO;
+    return -1;
+  }
+  atomic_fetch_add_explicit(&stats_g.written, (uint64_t)written, memory_order_relaxed);
+  return 0;
+}
+
+/** Reserves file space ahead of the writes, so a long capture is not
+	fragmented or slowed by block allocation. Not all file systems can. */
+static void preallocate(writer_t* writer, uint64_t end)
+{
+  if(end > writer->allocated)
+  {
+    if(fallocate(writer->fd, FALLOC_FL_KEEP_SIZE, (off_t)writer->allocated, (off_t)PREALLOCATE) != 0)
+    {
+      writer->allocated = UINT64_MAX;
+      return;
+    }
+    writer->allocated += PREALLOCATE;
+  }
+}
+
+/** Writes one CAP_ALIGN block from writer->block, synchronously. */
+static int writeBlock(writer_t* writer, uint64_t offset)
+{
+  if(pwrite(writer->fd, writer->block, CAP_ALIGN, (off_t)offset) != CAP_ALIGN)
+  {
+    if(errno == 0)
+    {
+      errno = EIO;
+    }
+    return -1;
+  }
+  atomic_fetch_add_explicit(&stats_g.written, CAP_ALIGN, memory_order_relaxed);
+  return 0;
+}
+
+/** Writes an index block for the batches since the last one. Batches still
+	in flight are waited for first, so an index never points at a batch
+	that is not on disk. */
+static int writeIndex(writer_t* writer)
+{
+  if(waitWrite(writer, 0) != 0 || waitWrite(writer, 1) != 0)
+  {
+    return -1;
+  }
+  capIndex_t* index = (capIndex_t*)writer->block;
+  memset(writer->block, 0, CAP_ALIGN);
+  index->magic = CAP_MAGIC_INDEX;
+  index->size = CAP_ALIGN;
+  index->entries = writer->entryCount;
+  index->previous = writer->lastIndex;
+  memcpy(index + 1, writer->entries, writer->entryCount * sizeof(capIndexEntry_t));
+  preallocate(writer, writer->offset + CAP_ALIGN);
+  if(writeBlock(writer, writer->offset) != 0)
+  {
+    return -1;
+  }
+  writer->lastIndex = writer->offset;
+  writer->offset += CAP_ALIGN;
+  writer->entryCount = 0;
+  stats_g.indexes++;
+  return 0;
+}
+
+/** Starts the write of the batch being filled and switches to the other
+	buffer, waiting for its last write if that is still going. */
+static int submitBatch(writer_t* writer)
+{
+  if(writer->records == 0)
+  {
+    return 0;
+  }
+  uint8_t* buffer = writer->buffer[writer->current];
+  capBatch_t* batch = (capBatch_t*)buffer;
+  uint32_t size = alignUp(writer->used, CAP_ALIGN);
+
+  batch->magic = CAP_MAGIC_BATCH;
+  batch->size = size;
+  batch->used = writer->used;
+  batch->records = writer->records;
+  batch->sequence = writer->sequence++;
+  batch->firstNs = writer->firstNs;
+  batch->lastNs = writer->lastNs;
+  batch->firstByte = writer->firstByte;
+  memset(buffer + writer->used, 0, size - writer->used);
+  preallocate(writer, writer->offset + size);
+
+  struct aiocb* io = &writer->io[writer->current];
+  memset(io, 0, sizeof(*io));
+  io->aio_fildes = writer->fd;
+  io->aio_buf = buffer;
+  io->aio_nbytes = size;
+  io->aio_offset = (off_t)writer->offset;
+  io->aio_sigevent.sigev_notify = SIGEV_NONE;
+  if(aio_write(io) != 0)
+  {
+    return -1;
+  }
+  writer->inFlight[writer->current] = true;
+  writer->entries[writer->entryCount].offset = writer->offset;
+  writer->entries[writer->entryCount].firstNs = writer->firstNs;
+  writer->entries[writer->entryCount].firstByte = writer->firstByte;
+  writer->entryCount++;
+  writer->offset += size;
+  stats_g.batches++;
+
+  writer->current ^= 1;
+  writer->used = sizeof(capBatch_t);
+  writer->records = 0;
+  if(writer->stallNs != 0)
+  {
+    sleepNs(writer->stallNs);
+  }
+  if(waitWrite(writer, writer->current) != 0)
+  {
+    return -1;
+  }
+  return writer->entryCount == writer->indexEvery ? writeIndex(writer) : 0;
+}
+
+static int appendRecord(writer_t* writer, uint32_t type, uint64_t hostNs, const void* data, uint32_t length)
+{
+  uint32_t padded = alignUp(length, 8);
+  if(writer->used + sizeof(capRecord_t) + padded > writer->batchSize && submitBatch(writer) != 0)
+  {
+    return -1;
+  }
+  if(writer->records == 0)
+  {
+    writer->firstNs = hostNs;
+    writer->firstByte = writer->streamByte;
+  }
+  uint8_t* at = writer->buffer[writer->current] + writer->used;
+  capRecord_t record = { length, type, hostNs };
+  memcpy(at, &record, sizeof(record));
+  memcpy(at + sizeof(record), data, length);
+  memset(at + sizeof(record) + length, 0, padded - length);
+  writer->used += (uint32_t)sizeof(record) + padded;
+  writer->records++;
+  writer->lastNs = hostNs;
+  stats_g.records++;
+  return 0;
+}
+
+static int appendDrop(writer_t* writer, uint64_t hostNs, uint64_t dropped)
+{
+  if(appendRecord(writer, CAP_RECORD_DROP, hostNs, &dropped, sizeof(dropped)) != 0)
+  {
+    return -1;
+  }
+  writer->streamByte += dropped;
+  return 0;
+}
+
+/** Writes the last batch and index and completes the header. */
+static int closeWriter(writer_t* writer)
+{
+  if(submitBatch(writer) != 0 || waitWrite(writer, 0) != 0 || waitWrite(writer, 1) != 0)
+  {
+    return -1;
+  }
+  if(writer->entryCount > 0 && writeIndex(writer) != 0)
+  {
+    return -1;
+  }
+  writer->header.lastIndex = writer->lastIndex;
+  writer->header.end = writer->offset;
+  writer->header.records = stats_g.records;
+  writer->header.bytes = writer->streamByte - atomic_load(&stats_g.dropped);
+  writer->header.dropped = atomic_load(&stats_g.dropped);
+  memset(writer->block, 0, CAP_ALIGN);
+  memcpy(writer->block, &writer->header, sizeof(writer->header));
+  if(writeBlock(writer, 0) != 0)
+  {
+    return -1;
+  }
+  // give back the space reserved past the end
+  if(ftruncate(writer->fd, (off_t)writer->offset) != 0 || fdatasync(writer->fd) != 0)
+  {
+    return -1;
+  }
+  return 0;
+}
+
+/** Empties the queue into batches until the reader is done and the queue
+	is empty. Sleeps on the queue's futex when there is nothing to do, at
+	most until the batch being filled is due to be written. */
+static void* writerMain(void* arg)
+{
+  writer_t* writer = (writer_t*)arg;
+  queue_t* queue = &queue_g;
+  uint64_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+
+  while(!writer->failed)
+  {
+    if(tail != atomic_load_explicit(&queue->head, memory_order_acquire))
+    {
+      chunk_t* chunk = &queue->chunks[tail & queue->mask];
+      if(chunk->dropped != 0 && appendDrop(writer, chunk->hostNs, chunk->dropped) != 0)
+      {
+        writer->failed = true;
+      }
+      else if(chunk->length != 0 && appendRecord(writer, CAP_RECORD_DATA, chunk->hostNs, chunk->data, chunk->length) != 0)
+      {
+        writer->failed = true;
+      }
+      writer->streamByte += chunk->length;
+      atomic_store_explicit(&queue->tail, ++tail, memory_order_release);
+      continue;
+    }
+    if(atomic_load(&queue->done))
+    {
+      if(tail != atomic_load_explicit(&queue->head, memory_order_acquire))
+      {
+        continue;
+      }
+      break;
+    }
+
+    uint64_t now = HOST_nowNs();
+    uint64_t timeoutNs = 200000000ull;
+    if(writer->records > 0)
+    {
+      if(now - writer->firstNs >= writer->flushNs)
+      {
+        if(submitBatch(writer) != 0)
+        {
+          writer->failed = true;
+        }
+        continue;
+      }
+      timeoutNs = writer->flushNs - (now - writer->firstNs);
+    }
+    struct timespec timeout = { (time_t)(timeoutNs / 1000000000ull), (long)(timeoutNs % 1000000000ull) };
+    uint32_t word = atomic_load(&queue->wakeup);
+    atomic_store(&queue->sleeping, 1);
+    if(tail == atomic_load(&queue->head) && !atomic_load(&queue->done))
+    {
+      futex(&queue->wakeup, FUTEX_WAIT_PRIVATE, word, &timeout);
+    }
+    atomic_store(&queue->sleeping, 0);
+  }
+
+  if(!writer->failed && queue->trailingDrop != 0
+     && appendDrop(writer, HOST_nowNs(), queue->trailingDrop) != 0)
+  {
+    writer->failed = true;
+  }
+  if(!writer->failed && closeWriter(writer) != 0)
+  {
+    writer->failed = true;
+  }
+  if(writer->failed)
+  {
+    perror("capture write");
+    running_g = 0;
+  }
+  return NULL;
+}
+
+/************************************************************/
+/************************************************************/
+/******************* READER *********************************/
+
+/** Reads the tty into the queue and nothing else, so the kernel's buffer
+	never fills while the disk is slow. A read that finds the queue full
+	goes to a scratch buffer and only its length is kept. */
+static void* readerMain(void* arg)
+{
+  reader_t* reader = (reader_t*)arg;
+  queue_t* queue = &queue_g;
+  static uint8_t scratch[CHUNK_SIZE];
+  uint64_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+  uint64_t pending = 0;
+
+  if(reader->enableStream && HOST_writeAll(reader->fd, "b", 1) != 0)
+  {
+    fprintf(stderr, "%s: %s\n", reader->path, strerror(errno));
+  }
+
+  while(running_g)
+  {
+    struct pollfd pfd = { reader->fd, POLLIN, 0 };
+    int ready = poll(&pfd, 1, 200);
+    if(ready < 0 && errno != EINTR)
+    {
+      perror("poll");
+      break;
+    }
+    if(ready <= 0)
+    {
+      continue;
+    }
+
+    uint64_t tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+    chunk_t* chunk = head - tail <= queue->mask ? &queue->chunks[head & queue->mask] : NULL;
+    ssize_t count = read(reader->fd, chunk != NULL ? chunk->data : scratch, CHUNK_SIZE);
+    if(count <= 0)
+    {
+      if(count < 0 && (errno == EINTR || errno == EAGAIN))
+      {
+        continue;
+      }
+      // EOF, or EIO once the board or pty writer goes away
+      fprintf(stderr, "%s: input closed\n", reader->path);
+      break;
+    }
+    uint64_t now = HOST_nowNs();
+    stats_g.reads++;
+    atomic_fetch_add_explicit(&stats_g.bytes, (uint64_t)count, memory_order_relaxed);
+
+    if(chunk == NULL)
+    {
+      stats_g.dropRuns += pending == 0;
+      pending += (uint64_t)count;
+      atomic_fetch_add_explicit(&stats_g.dropped, (uint64_t)count, memory_order_relaxed);
+      continue;
+    }
+    chunk->hostNs = now;
+    chunk->dropped = pending;
+    chunk->length = (uint32_t)count;
+    pending = 0;
+    atomic_store_explicit(&queue->head, ++head, memory_order_release);
+
+    uint32_t fill = (uint32_t)(head - tail);
+    if(fill > atomic_load_explicit(&stats_g.maxFill, memory_order_relaxed))
+    {
+      atomic_store_explicit(&stats_g.maxFill, fill, memory_order_relaxed);
+    }
+    atomic_fetch_add(&queue->wakeup, 1);
+    if(atomic_load(&queue->sleeping))
+    {
+      futex(&queue->wakeup, FUTEX_WAKE_PRIVATE, 1, NULL);
+    }
+  }
+
+  queue->trailingDrop = pending;
+  atomic_store(&queue->done, 1);
+  atomic_fetch_add(&queue->wakeup, 1);
+  futex(&queue->wakeup, FUTEX_WAKE_PRIVATE, 1, NULL);
+  return NULL;
+}
+
+/** Self test source: writes the pattern to the pty master at the set rate,
+	then waits for the reader to take what is still in the pty and stops
+	the capture. */
+static void* generatorMain(void* arg)
+{
+  generator_t* generator = (generator_t*)arg;
+  uint8_t buffer[512];
+  uint64_t start = HOST_nowNs();
+
+  while(running_g)
+  {
+    uint64_t elapsed = HOST_nowNs() - start;
+    if(elapsed >= generator->durationNs)
+    {
+      break;
+    }
+    uint64_t due = (uint64_t)((double)generator->bytesPerS * (double)elapsed / 1e9);
+    while(generator->sent < due && running_g)
+    {
+      uint32_t length = due - generator->sent < sizeof(buffer) ? (uint32_t)(due - generator->sent) : sizeof(buffer);
+      for(uint32_t i = 0; i < length; i++)
+      {
+        buffer[i] = patternByte(generator->sent + i);
+      }
+      if(HOST_writeAll(generator->master, buffer, length) != 0)
+      {
+        perror("pty write");
+        running_g = 0;
+        return NULL;
+      }
+      generator->sent += length;
+    }
+    sleepNs(1000000);
+  }
+
+  for(int i = 0; i < 100; i++)
+  {
+    int queued = 0;
+    if(ioctl(*generator->readerFd, FIONREAD, &queued) != 0 || queued == 0)
+    {
+      break;
+    }
+    sleepNs(10000000);
+  }
+  running_g = 0;
+  return NULL;
+}
+
+/************************************************************/
+/************************************************************/
+/******************* CAPTURE FILES **************************/
+
+static void closeCapture(capture_t* capture)
+{
+  free(capture->entries);
+  free(capture->batch);
+  close(capture->fd);
+}
+
+static int addEntry(capture_t* capture, const capIndexEntry_t* entry, uint32_t* capacity)
+{
+  if(capture->count == *capacity)
+  {
+    *capacity = *capacity != 0 ? *capacity * 2 : 256;
+    capIndexEntry_t* grown = realloc(capture->entries, *capacity * sizeof(capIndexEntry_t));
+    if(grown == NULL)
+    {
+      return -1;
+    }
+    capture->entries = grown;
+  }
+  capture->entries[capture->count++] = *entry;
+  return 0;
+}
+
+/** Finds the batches by walking from one batch header to the next, for a
+	capture that was never closed, or to check the index of one that was. */
+static int scanCapture(capture_t* capture)
+{
+  uint32_t capacity = 0;
+  uint64_t offset = CAP_ALIGN;
+  capture->count = 0;
+  capture->indexes = 0;
+
+  for(;;)
+  {
+    capBatch_t batch;
+    if(pread(capture->fd, &batch, sizeof(batch), (off_t)offset) != sizeof(batch))
+    {
+      break;
+    }
+    if(batch.magic == CAP_MAGIC_INDEX)
+    {
+      capture->indexes++;
+      offset += CAP_ALIGN;
+      continue;
+    }
+    if(batch.magic != CAP_MAGIC_BATCH || batch.size == 0 || batch.size % CAP_ALIGN != 0
+       || batch.size > capture->header.batchSize || batch.used > batch.size)
+    {
+      break;
+    }
+    capIndexEntry_t entry = { offset, batch.firstNs, batch.firstByte };
+    if(addEntry(capture, &entry, &capacity) != 0)
+    {
+      return -1;
+    }
+    offset += batch.size;
+  }
+  return 0;
+}
+
+/** Loads the index blocks, following them back from the last one. */
+static int loadIndex(capture_t* capture)
+{
+  uint64_t* blocks = NULL;
+  uint32_t count = 0, capacity = 0;
+  uint8_t block[CAP_ALIGN];
+  const capIndex_t* index = (const capIndex_t*)block;
+  int status = 0;
+
+  for(uint64_t offset = capture->header.lastIndex; offset != 0; offset = index->previous)
+  {
+    if(pread(capture->fd, block, CAP_ALIGN, (off_t)offset) != CAP_ALIGN
+       || index->magic != CAP_MAGIC_INDEX || index->entries > INDEX_ENTRIES
+       || index->previous >= offset || count == UINT32_MAX)
+    {
+      free(blocks);
+      errno = EINVAL;
+      return -1;
+    }
+    if(count == capacity)
+    {
+      capacity = capacity != 0 ? capacity * 2 : 64;
+      uint64_t* grown = realloc(blocks, capacity * sizeof(uint64_t));
+      if(grown == NULL)
+      {
+        free(blocks);
+        return -1;
+      }
+      blocks = grown;
+    }
+    blocks[count++] = offset;
+  }
+
+  uint32_t entries = 0;
+  capture->count = 0;
+  capture->indexes = count;
+  while(count > 0 && status == 0)
+  {
+    count--;
+    if(pread(capture->fd, block, CAP_ALIGN, (off_t)blocks[count]) != CAP_ALIGN)
+    {
+      status = -1;
+      break;
+    }
+    const capIndexEntry_t* entry = (const capIndexEntry_t*)(index + 1);
+    for(uint32_t i = 0; i < index->entries && status == 0; i++)
+    {
+      status = addEntry(capture, &entry[i], &entries);
+    }
+  }
+  free(blocks);
+  return status;
+}
+
+static int openCapture(capture_t* capture, const char* path)
+{
+  memset(capture, 0, sizeof(*capture));
+  capture->fd = open(path, O_RDONLY | O_CLOEXEC);
+  if(capture->fd < 0)
+  {
+    return -1;
+  }
+  if(pread(capture->fd, &capture->header, sizeof(capture->header), 0) != sizeof(capture->header)
+     || capture->header.magic != CAP_MAGIC || capture->header.version != CAP_VERSION
+     || capture->header.align != CAP_ALIGN || capture->header.batchSize % CAP_ALIGN != 0
+     || capture->header.batchSize == 0)
+  {
+    close(capture->fd);
+    errno = EINVAL;
+    return -1;
+  }
+  capture->batch = malloc(capture->header.batchSize);
+  if(capture->batch == NULL)
+  {
+    close(capture->fd);
+    return -1;
+  }
+  int status = capture->header.lastIndex != 0 ? loadIndex(capture) : scanCapture(capture);
+  if(status != 0)
+  {
+    int saved = errno;
+    closeCapture(capture);
+    errno = saved;
+  }
+  return status;
+}
+
+/** Reads batch i and checks its header and records hang together. */
+static const capBatch_t* readBatch(capture_t* capture, uint32_t i)
+{
+  const capBatch_t* batch = (const capBatch_t*)capture->batch;
+  if(pread(capture->fd, capture->batch, sizeof(capBatch_t), (off_t)capture->entries[i].offset) != sizeof(capBatch_t)
+     || batch->magic != CAP_MAGIC_BATCH || batch->size > capture->header.batchSize
+     || batch->used > batch->size || batch->used < sizeof(capBatch_t))
+  {
+    return NULL;
+  }
+  if(pread(capture->fd, capture->batch, batch->used, (off_t)capture->entries[i].offset) != (ssize_t)batch->used)
+  {
+    return NULL;
+  }
+  uint32_t at = sizeof(capBatch_t);
+  for(uint32_t r = 0; r < batch->records; r++)
+  {
+    const capRecord_t* record = (const capRecord_t*)(capture->batch + at);
+    if(at + sizeof(capRecord_t) > batch->used || record->length > batch->used - at - sizeof(capRecord_t))
+    {
+      return NULL;
+    }
+    at += (uint32_t)sizeof(capRecord_t) + alignUp(record->length, 8);
+  }
+  return at == batch->used ? batch : NULL;
+}
+
+/** Returns the batch holding the first record at or after ns: the last one
+	starting at or before it. */
+static uint32_t seekCapture(const capture_t* capture, uint64_t ns)
+{
+  uint32_t low = 0, high = capture->count;
+  while(high - low > 1)
+  {
+    uint32_t middle = low + (high - low) / 2;
+    if(capture->entries[middle].firstNs <= ns)
+    {
+      low = middle;
+    }
+    else
+    {
+      high = middle;
+    }
+  }
+  return low;
+}
+
+/** Calls visit for every record in batches first to last. Stops when visit
+	returns false. Returns -1 if a batch is damaged. */
+static int forEachRecord(capture_t* capture, uint32_t first, bool (*visit)(const capRecord_t*, void*), void* context)
+{
+  for(uint32_t i = first; i < capture->count; i++)
+  {
+    const capBatch_t* batch = readBatch(capture, i);
+    if(batch == NULL)
+    {
+      fprintf(stderr, "batch %u at %llu is damaged\n", i, (unsigned long long)capture->entries[i].offset);
+      return -1;
+    }
+    uint32_t at = sizeof(capBatch_t);
+    for(uint32_t r = 0; r < batch->records; r++)
+    {
+      const capRecord_t* record = (const capRecord_t*)(capture->batch + at);
+      if(!visit(record, context))
+      {
+        return 0;
+      }
+      at += (uint32_t)sizeof(capRecord_t) + alignUp(record->length, 8);
+    }
+  }
+  return 0;
+}
+
+static uint64_t dropCount(const capRecord_t* record)
+{
+  uint64_t dropped = 0;
+  memcpy(&dropped, record + 1, record->length < sizeof(dropped) ? record->length : sizeof(dropped));
+  return dropped;
+}
+
+/************************************************************/
+/************************************************************/
+/******************* MODES **********************************/
+
+typedef struct
+{
+  uint64_t records;
+  uint64_t bytes;
+  uint64_t drops;
+  uint64_t dropped;
+  uint64_t firstNs;
+  uint64_t lastNs;
+  uint64_t outOfOrder;          /**< Records older than the one before */
+  uint64_t position;            /**< Self test: stream bytes so far */
+  uint64_t mismatches;          /**< Self test: bytes not matching the pattern */
+  bool     pattern;
+} listing_t;
+
+static bool listRecord(const capRecord_t* record, void* context)
+{
+  listing_t* listing = (listing_t*)context;
+  if(listing->records == 0)
+  {
+    listing->firstNs = record->hostNs;
+  }
+  else if(record->hostNs < listing->lastNs)
+  {
+    listing->outOfOrder++;
+  }
+  listing->lastNs = record->hostNs;
+  listing->records++;
+  if(record->type == CAP_RECORD_DROP)
+  {
+    listing->drops++;
+    listing->dropped += dropCount(record);
+    listing->position += dropCount(record);
+    return true;
+  }
+  const uint8_t* data = (const uint8_t*)(record + 1);
+  listing->bytes += record->length;
+  for(uint32_t i = 0; listing->pattern && i < record->length; i++)
+  {
+    listing->mismatches += data[i] != patternByte(listing->position + i);
+  }
+  listing->position += record->length;
+  return true;
+}
+
+/** Checks a capture: its index against a walk of the batch headers, then
+	every record. Returns 0 if it is sound. */
+static int listCapture(const char* path, bool pattern, listing_t* listing)
+{
+  capture_t capture;
+  if(openCapture(&capture, path) != 0)
+  {
+    fprintf(stderr, "%s: %s\n", path, errno == EINVAL ? "not a capture, or a damaged one" : strerror(errno));
+    return 1;
+  }
+  const capHeader_t* header = &capture.header;
+  int status = 0;
+
+  time_t started = (time_t)(header->startRealNs / 1000000000ull);
+  char when[64];
+  strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", localtime(&started));
+  printf("%s: %.*s, started %s, %u KB batches\n", path, (int)sizeof(header->source), header->source,
+         when, header->batchSize / 1024);
+
+  uint32_t indexed = capture.count, indexes = capture.indexes;
+  capIndexEntry_t* entries = capture.entries;
+  capture.entries = NULL;
+  if(scanCapture(&capture) != 0)
+  {
+    status = 1;
+  }
+  if(header->lastIndex == 0)
+  {
+    printf("not closed: %u batches found by walking their headers\n", capture.count);
+  }
+  else
+  {
+    bool same = indexed == capture.count && indexes == capture.indexes
+                && (indexed == 0 || memcmp(entries, capture.entries, indexed * sizeof(*entries)) == 0);
+    printf("%u batches in %u index blocks, %s the batch headers\n", indexed, indexes,
+           same ? "matching" : "NOT matching");
+    status |= !same;
+  }
+  free(entries);
+
+  memset(listing, 0, sizeof(*listing));
+  listing->pattern = pattern;
+  status |= forEachRecord(&capture, 0, listRecord, listing) != 0;
+  double seconds = listing->records > 1 ? (double)(listing->lastNs - listing->firstNs) / 1e9 : 0.0;
+  printf("%llu records over %.1f s: %llu bytes, %.1f KB/s; %llu bytes lost in %llu drops\n",
+         (unsigned long long)listing->records, seconds, (unsigned long long)listing->bytes,
+         seconds > 0 ? (double)listing->bytes / 1024.0 / seconds : 0.0,
+         (unsigned long long)listing->dropped, (unsigned long long)listing->drops);
+  if(header->lastIndex != 0 && (listing->records != header->records || listing->bytes != header->bytes
+                                || listing->dropped != header->dropped))
+  {
+    printf("header says %llu records, %llu bytes, %llu lost\n", (unsigned long long)header->records,
+           (unsigned long long)header->bytes, (unsigned long long)header->dropped);
+    status = 1;
+  }
+  if(listing->outOfOrder != 0)
+  {
+    printf("%llu records out of time order\n", (unsigned long long)listing->outOfOrder);
+    status = 1;
+  }
+  closeCapture(&capture);
+  return status;
+}
+
+typedef struct
+{
+  int      fd;
+  uint64_t fromNs;
+  uint64_t toNs;
+  uint64_t startNs;
+  uint64_t bytes;
+  uint64_t records;
+  bool     failed;
+} extract_t;
+
+static bool extractRecord(const capRecord_t* record, void* context)
+{
+  extract_t* extract = (extract_t*)context;
+  if(record->hostNs >= extract->toNs)
+  {
+    return false;
+  }
+  if(record->hostNs < extract->fromNs)
+  {
+    return true;
+  }
+  extract->records++;
+  if(record->type == CAP_RECORD_DROP)
+  {
+    fprintf(stderr, "%.3f s: %llu bytes lost\n", (double)(record->hostNs - extract->startNs) / 1e9,
+            (unsigned long long)dropCount(record));
+    return true;
+  }
+  if(HOST_writeAll(extract->fd, record + 1, record->length) != 0)
+  {
+    perror("write");
+    extract->failed = true;
+    return false;
+  }
+  extract->bytes += record->length;
+  return true;
+}
+
+static int extractCapture(const char* path, const char* outPath, double fromS, double toS)
+{
+  capture_t capture;
+  if(openCapture(&capture, path) != 0)
+  {
+    fprintf(stderr, "%s: %s\n", path, errno == EINVAL ? "not a capture, or a damaged one" : strerror(errno));
+    return 1;
+  }
+  extract_t extract = { STDOUT_FILENO, 0, UINT64_MAX, capture.header.startNs, 0, 0, false };
+  extract.fromNs = capture.header.startNs + (uint64_t)(fromS * 1e9);
+  if(toS >= 0)
+  {
+    extract.toNs = capture.header.startNs + (uint64_t)(toS * 1e9);
+  }
+  if(outPath != NULL)
+  {
+    extract.fd = open(outPath, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if(extract.fd < 0)
+    {
+      fprintf(stderr, "%s: %s\n", outPath, strerror(errno));
+      closeCapture(&capture);
+      return 1;
+    }
+  }
+
+  uint32_t first = seekCapture(&capture, extract.fromNs);
+  int status = forEachRecord(&capture, first, extractRecord, &extract) != 0 || extract.failed;
+  fprintf(stderr, "%llu bytes from %llu records, starting at batch %u of %u\n",
+          (unsigned long long)extract.bytes, (unsigned long long)extract.records, first, capture.count);
+  if(outPath != NULL)
+  {
+    close(extract.fd);
+  }
+  closeCapture(&capture);
+  return status;
+}
+
+typedef struct
+{
+  uint64_t firstByte;
+  uint64_t mismatches;
+  bool     seen;
+} seekCheck_t;
+
+static bool checkFirstRecord(const capRecord_t* record, void* context)
+{
+  seekCheck_t* check = (seekCheck_t*)context;
+  if(record->type == CAP_RECORD_DROP)
+  {
+    check->firstByte += dropCount(record);
+    return true;
+  }
+  const uint8_t* data = (const uint8_t*)(record + 1);
+  for(uint32_t i = 0; i < record->length; i++)
+  {
+    check->mismatches += data[i] != patternByte(check->firstByte + i);
+  }
+  check->seen = true;
+  return false;
+}
+
+/** Self test: seeks to ten times through the capture and checks each lands
+	on the right batch, whose first bytes are where its index entry says
+	they are in the pattern. */
+static int checkSeeks(const char* path)
+{
+  capture_t capture;
+  if(openCapture(&capture, path) != 0 || capture.count == 0)
+  {
+    return 1;
+  }
+  int bad = 0;
+  uint64_t first = capture.entries[0].firstNs;
+  uint64_t span = capture.entries[capture.count - 1].firstNs - first;
+  for(int k = 0; k < 10; k++)
+  {
+    uint64_t ns = first + span * (uint64_t)k / 10 + 1;
+    uint32_t i = seekCapture(&capture, ns);
+    seekCheck_t check = { capture.entries[i].firstByte, 0, false };
+    bool placed = capture.entries[i].firstNs <= ns && (i + 1 == capture.count || capture.entries[i + 1].firstNs > ns);
+    if(!placed || forEachRecord(&capture, i, checkFirstRecord, &check) != 0 || !check.seen || check.mismatches != 0)
+    {
+      bad++;
+    }
+  }
+  printf("seek: 10 times looked up in %u index entries, %d wrong\n", capture.count, bad);
+  closeCapture(&capture);
+  return bad != 0;
+}
+
+static int openOutput(writer_t* writer, const char* path)
+{
+  writer->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC | O_DIRECT, 0644);
+  writer->direct = writer->fd >= 0;
+  if(writer->fd < 0 && errno == EINVAL)
+  {
+    // file systems like tmpfs don't do direct I/O
+    writer->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  }
+  return writer->fd < 0 ? -1 : 0;
+}
+
+int main(int argc, char** argv)
+{
+  const char* path = NULL;
+  uint32_t slots = 1024, batchKb = 1024, indexEvery = 64, flushMs = 1000, stallMs = 0;
+  double durationS = 0, progressS = 0, fromS = 0, toS = -1;
+  uint32_t testKbps = 0;
+  bool enableStream = false, list = false, extractMode = false;
+  int opt;
+
+  while((opt = getopt(argc, argv, "o:q:B:i:f:p:d:bS:W:lxt:T:h")) != -1)
+  {
+    switch(opt)
+    {
+      case 'o': path = optarg; break;
+      case 'q': slots = (uint32_t)strtoul(optarg, NULL, 0); break;
+      case 'B': batchKb = (uint32_t)strtoul(optarg, NULL, 0); break;
+      case 'i': indexEvery = (uint32_t)strtoul(optarg, NULL, 0); break;
+      case 'f': flushMs = (uint32_t)strtoul(optarg, NULL, 0); break;
+      case 'p': progressS = atof(optarg); break;
+      case 'd': durationS = atof(optarg); break;
+      case 'b': enableStream = true; break;
+      case 'S': testKbps = (uint32_t)strtoul(optarg, NULL, 0); break;
+      case 'W': stallMs = (uint32_t)strtoul(optarg, NULL, 0); break;
+      case 'l': list = true; break;
+      case 'x': extractMode = true; break;
+      case 't': fromS = atof(optarg); break;
+      case 'T': toS = atof(optarg); break;
+      default: usage(argv[0]); return 2;
+    }
+  }
+  if(list || extractMode)
+  {
+    if(optind != argc - 1 || (list && extractMode))
+    {
+      usage(argv[0]);
+      return 2;
+    }
+    if(list)
+    {
+      listing_t listing;
+      return listCapture(argv[optind], false, &listing);
+    }
+    return extractCapture(argv[optind], path, fromS, toS);
+  }
+  if(optind != argc - (testKbps != 0 ? 0 : 1) || slots == 0 || slots > (1u << 24) || batchKb < 64
+     || batchKb % 4 != 0 || batchKb > 64 * 1024 || indexEvery == 0 || indexEvery > INDEX_ENTRIES)
+  {
+    usage(argv[0]);
+    return 2;
+  }
+  if(path == NULL)
+  {
+    path = DEFAULT_PATH;
+  }
+  if(testKbps != 0 && durationS <= 0)
+  {
+    durationS = 10;
+  }
+
+  // the input: the tty, or for the self test a pty fed by the generator
+  static generator_t generator;
+  static reader_t reader;
+  char ptyPath[64];
+  const char* device = testKbps != 0 ? ptyPath : argv[optind];
+  if(testKbps != 0)
+  {
+    generator.master = HOST_openPty(ptyPath, sizeof(ptyPath), NULL);
+    if(generator.master < 0)
+    {
+      perror("pty");
+      return 1;
+    }
+    generator.bytesPerS = (uint64_t)testKbps * 1024;
+    generator.durationNs = (uint64_t)(durationS * 1e9);
+    generator.readerFd = &reader.fd;
+  }
+  reader.path = device;
+  reader.enableStream = enableStream;
+  reader.fd = HOST_openSerial(device);
+  if(reader.fd < 0)
+  {
+    fprintf(stderr, "%s: %s\n", device, strerror(errno));
+    return 1;
+  }
+
+  // the queue and the writer's buffers are all the memory a capture takes
+  uint32_t rounded = 1;
+  while(rounded < slots)
+  {
+    rounded <<= 1;
+  }
+  queue_g.mask = rounded - 1;
+  queue_g.chunks = aligned_alloc(64, (size_t)rounded * sizeof(chunk_t));
+  writer_t* writer = &writer_g;
+  writer->batchSize = batchKb * 1024;
+  writer->indexEvery = indexEvery;
+  writer->flushNs = (uint64_t)flushMs * 1000000ull;
+  writer->stallNs = (uint64_t)stallMs * 1000000ull;
+  writer->buffer[0] = aligned_alloc(CAP_ALIGN, writer->batchSize);
+  writer->buffer[1] = aligned_alloc(CAP_ALIGN, writer->batchSize);
+  writer->block = aligned_alloc(CAP_ALIGN, CAP_ALIGN);
+  writer->used = sizeof(capBatch_t);
+  writer->offset = CAP_ALIGN;
+  if(queue_g.chunks == NULL || writer->buffer[0] == NULL || writer->buffer[1] == NULL || writer->block == NULL)
+  {
+    perror("memory");
+    return 1;
+  }
+  // touch it all now, so the capture doesn't page fault its way up to speed
+  memset(queue_g.chunks, 0, (size_t)rounded * sizeof(chunk_t));
+  memset(writer->buffer[0], 0, writer->batchSize);
+  memset(writer->buffer[1], 0, writer->batchSize);
+
+  if(openOutput(writer, path) != 0)
+  {
+    fprintf(stderr, "%s: %s\n", path, strerror(errno));
+    return 1;
+  }
+  capHeader_t* header = &writer->header;
+  header->magic = CAP_MAGIC;
+  header->version = CAP_VERSION;
+  header->align = CAP_ALIGN;
+  header->batchSize = writer->batchSize;
+  header->startNs = HOST_nowNs();
+  header->startRealNs = realNs();
+  snprintf(header->source, sizeof(header->source), "%s", testKbps != 0 ? "self test" : device);
+  memset(writer->block, 0, CAP_ALIGN);
+  memcpy(writer->block, header, sizeof(*header));
+  if(writeBlock(writer, 0) != 0)
+  {
+    fprintf(stderr, "%s: %s\n", path, strerror(errno));
+    return 1;
+  }
+
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = onSignal;
+  sigaction(SIGINT, &sa, NULL);
+  sigaction(SIGTERM, &sa, NULL);
+  signal(SIGPIPE, SIG_IGN);
+
+  printf("capturing %s to %s (%s), %u KB batches, queue %u x %d bytes\n", device, path,
+         writer->direct ? "direct I/O" : "buffered", batchKb, rounded, CHUNK_SIZE);
+  fflush(stdout);
+
+  pthread_t readerThread, writerThread, generatorThread;
+  uint64_t start = HOST_nowNs();
+  pthread_create(&writerThread, NULL, writerMain, writer);
+  pthread_create(&readerThread, NULL, readerMain, &reader);
+  if(testKbps != 0)
+  {
+    pthread_create(&generatorThread, NULL, generatorMain, &generator);
+  }
+
+  // this thread only keeps time and prints progress
+  uint64_t nextProgress = start + (uint64_t)(progressS * 1e9), lastBytes = 0;
+  while(!atomic_load(&queue_g.done))
+  {
+    sleepNs(100000000);
+    uint64_t now = HOST_nowNs();
+    if(testKbps == 0 && durationS > 0 && now - start >= (uint64_t)(durationS * 1e9))
+    {
+      running_g = 0;
+    }
+    if(progressS > 0 && now >= nextProgress)
+    {
+      uint64_t bytes = atomic_load(&stats_g.bytes);
+      printf("%8.0f s %10.1f MB %8.1f KB/s  written %8.1f MB  lost %llu  queue max %u\n",
+             (double)(now - start) / 1e9, (double)bytes / 1048576.0,
+             (double)(bytes - lastBytes) / 1024.0 / progressS,
+             (double)atomic_load(&stats_g.written) / 1048576.0,
+             (unsigned long long)atomic_load(&stats_g.dropped), atomic_load(&stats_g.maxFill));
+      fflush(stdout);
+      lastBytes = bytes;
+      nextProgress += (uint64_t)(progressS * 1e9);
+    }
+  }
+  if(testKbps != 0)
+  {
+    running_g = 0;
+    pthread_join(generatorThread, NULL);
+  }
+  pthread_join(readerThread, NULL);
+  pthread_join(writerThread, NULL);
+  double seconds = (double)(HOST_nowNs() - start) / 1e9;
+
+  uint64_t bytes = atomic_load(&stats_g.bytes), dropped = atomic_load(&stats_g.dropped);
+  size_t memoryKb = ((size_t)rounded * sizeof(chunk_t) + 2 * writer->batchSize + CAP_ALIGN) / 1024;
+  printf("%.1f s: %llu bytes in %llu reads, %.1f KB/s; %llu bytes lost in %llu drops\n", seconds,
+         (unsigned long long)bytes, (unsigned long long)stats_g.reads,
+         seconds > 0 ? (double)bytes / 1024.0 / seconds : 0.0,
+         (unsigned long long)dropped, (unsigned long long)stats_g.dropRuns);
+  printf("%llu records in %llu batches and %llu index blocks, %.1f MB written; queue max %u of %u chunks\n",
+         (unsigned long long)stats_g.records, (unsigned long long)stats_g.batches,
+         (unsigned long long)stats_g.indexes, (double)atomic_load(&stats_g.written) / 1048576.0,
+         atomic_load(&stats_g.maxFill), rounded);
+  printf("writes waited for %llu times, at most %.1f ms; buffers %zu KB, peak resident %lu KB\n",
+         (unsigned long long)stats_g.waits, (double)stats_g.maxWaitNs / 1e6, memoryKb, peakRssKb());
+  close(writer->fd);
+  close(reader.fd);
+  int status = writer->failed;
+
+  if(testKbps != 0 && !writer->failed)
+  {
+    listing_t listing;
+    status = listCapture(path, true, &listing);
+    bool complete = listing.position == generator.sent && listing.dropped == dropped;
+    printf("self test: %llu bytes sent, %llu in the capture, %llu lost, %llu not matching the pattern\n",
+           (unsigned long long)generator.sent, (unsigned long long)listing.bytes,
+           (unsigned long long)listing.dropped, (unsigned long long)listing.mismatches);
+    status |= !complete || listing.mismatches != 0;
+    status |= checkSeeks(path);
+    printf("self test %s\n", status == 0 ? "passed" : "FAILED");
+  }
+  if(testKbps != 0)
+  {
+    close(generator.master);
+  }
+  return status;
+}
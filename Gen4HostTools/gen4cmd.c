@@ -0,0 +1,534 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+/** gen4cmd - scripted register access through the dev kit's binary command
+	channel (see API_Command.h). Commands come from the arguments after the
+	tty, one per argument, or from stdin one per line. Up to -w commands are
+	sent ahead of their responses, so a long script is not slowed down by a
+	round trip per command. Results are printed in command order.
+
+	-R reads a memory region of any length with READ_REGION, which streams
+	it back in chunks, then again with pipelined READ_MEMORY commands, and
+	compares the two. -o saves the region.
+
+	usage: gen4cmd [-w window] [-t timeout_ms] [-b count [-n bytes]] [-R addr:length [-o file]]
+	               <tty> [command...] */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "API_Command.h"
+#include "API_Haptic.h"
+#include "API_C2_Watch.h"
+#include "HostCommand.h"
+#include "HostUtil.h"
+
+#define MAX_WINDOW (64)
+
+static void usage(const char* argv0)
+{
+  fprintf(stderr,
+          "usage: %s [-w window] [-t timeout_ms] [-b count [-n bytes]] [-R addr:length [-o file]]\n"
+          "       <tty> [command...]\n"
+          "  -w  commands in flight at once, 1 for stop-and-wait (default 16)\n"
+          "  -t  time to wait for each response (default 1000)\n"
+          "  -b  benchmark: time count reads stop-and-wait and pipelined\n"
+          "  -n  bytes per benchmark read (default 16)\n"
+          "  -R  read a region of any length, streamed and with read commands, and compare\n"
+          "  -o  write the region read with -R to this file\n"
+          "commands:\n"
+          "  read ADDR COUNT            read COUNT bytes of extended memory\n"
+          "  write ADDR BYTE...         write bytes to extended memory\n"
+          "  batch ADDR:COUNT...        read several ranges in one command\n"
+          "  action NAME                absolute relative feed nofeed comp nocomp\n"
+          "                             forcecomp tracking notracking persist calibrate\n"
+          "  info                       system information\n"
+          "  stats MS                   touch statistics summaries every MS, 0 to stop\n"
+          "  haptic EVENT ON OFF N STR  pattern for press, contact or lift: N pulses of\n"
+          "                             ON ms at STR (0-255), OFF ms apart; turns haptics on\n"
+          "  watch ADDR LEN MS          watch LEN (1-4) bytes every MS, 0 to stop; turns the\n"
+          "                             register watch on\n"
+          "  ping [BYTE...]             echo\n",
+          argv0);
+}
+
+static const struct
+{
+  const char* name;
+  uint8_t     action;
+} _actions[] =
+{
+  { "absolute",   COMMAND_ACTION_ABSOLUTE_MODE },
+  { "relative",   COMMAND_ACTION_RELATIVE_MODE },
+  { "feed",       COMMAND_ACTION_ENABLE_FEED },
+  { "nofeed",     COMMAND_ACTION_DISABLE_FEED },
+  { "comp",       COMMAND_ACTION_ENABLE_COMP },
+  { "nocomp",     COMMAND_ACTION_DISABLE_COMP },
+  { "forcecomp",  COMMAND_ACTION_FORCE_COMP },
+  { "tracking",   COMMAND_ACTION_ENABLE_TRACKING },
+  { "notracking", COMMAND_ACTION_DISABLE_TRACKING },
+  { "persist",    COMMAND_ACTION_PERSIST },
+  { "calibrate",  COMMAND_ACTION_FACTORY_CAL },
+};
+
+/** A command sent and waiting for its response */
+typedef struct
+{
+  int  requestId;
+  char text[64];
+} pending_t;
+
+static bool parseNumber(const char* word, uint32_t* value)
+{
+  char* end;
+  errno = 0;
+  unsigned long n = strtoul(word, &end, 0);
+  if(errno != 0 || end == word || *end != '\0' || n > 0xFFFFFFFFul)
+  {
+    return false;
+  }
+  *value = (uint32_t)n;
+  return true;
+}
+
+/** Parses and sends one command line. Returns the request ID, -1 on a send
+	error, or -2 if the line is not a valid command. */
+static int sendLine(cmdLink_t* link, char* line, pending_t* pending)
+{
+  char* words[STREAM_MAX_PAYLOAD];
+  int count = 0;
+  uint32_t address, value;
+
+  snprintf(pending->text, sizeof(pending->text), "%.*s", (int)sizeof(pending->text) - 1, line);
+  pending->text[strcspn(pending->text, "\r\n")] = '\0';
+  for(char* save = NULL, *word = strtok_r(line, " \t\r\n", &save); word != NULL && count < STREAM_MAX_PAYLOAD;
+      word = strtok_r(NULL, " \t\r\n", &save))
+  {
+    words[count++] = word;
+  }
+  if(count == 0)
+  {
+    return -2;
+  }
+
+  if(strcmp(words[0], "read") == 0 && count == 3)
+  {
+    uint32_t length;
+    if(!parseNumber(words[1], &address) || !parseNumber(words[2], &length) || length > COMMAND_MAX_DATA)
+    {
+      return -2;
+    }
+    return CMDLINK_sendRead(link, address, (uint16_t)length);
+  }
+  if((strcmp(words[0], "write") == 0 && count >= 2) || strcmp(words[0], "ping") == 0)
+  {
+    bool write = words[0][0] == 'w';
+    uint8_t data[STREAM_MAX_PAYLOAD];
+    int first = write ? 2 : 1;
+    if(write && !parseNumber(words[1], &address))
+    {
+      return -2;
+    }
+    for(int i = first; i < count; i++)
+    {
+      if(!parseNumber(words[i], &value) || value > 0xFF)
+      {
+        return -2;
+      }
+      data[i - first] = (uint8_t)value;
+    }
+    return write ? CMDLINK_sendWrite(link, address, data, (uint16_t)(count - first))
+                 : CMDLINK_send(link, COMMAND_PING, data, (uint16_t)(count - first));
+  }
+  if(strcmp(words[0], "batch") == 0 && count >= 2)
+  {
+    cmdRange_t ranges[STREAM_MAX_PAYLOAD / 6];
+    uint16_t rangeCount = 0;
+    for(int i = 1; i < count && rangeCount < STREAM_MAX_PAYLOAD / 6; i++)
+    {
+      char* colon = strchr(words[i], ':');
+      uint32_t length;
+      if(colon == NULL)
+      {
+        return -2;
+      }
+      *colon = '\0';
+      if(!parseNumber(words[i], &ranges[rangeCount].address) || !parseNumber(colon + 1, &length) || length > COMMAND_MAX_DATA)
+      {
+        return -2;
+      }
+      ranges[rangeCount++].count = (uint16_t)length;
+    }
+    return CMDLINK_sendBatch(link, ranges, rangeCount);
+  }
+  if(strcmp(words[0], "action") == 0 && count == 2)
+  {
+    for(size_t i = 0; i < sizeof(_actions) / sizeof(_actions[0]); i++)
+    {
+      if(strcmp(words[1], _actions[i].name) == 0)
+      {
+        return CMDLINK_sendAction(link, _actions[i].action);
+      }
+    }
+    return -2;
+  }
+  if(strcmp(words[0], "info") == 0 && count == 1)
+  {
+    return CMDLINK_send(link, COMMAND_SYSTEM_INFO, NULL, 0);
+  }
+  if(strcmp(words[0], "stats") == 0 && count == 2)
+  {
+    uint8_t interval[2];
+    if(!parseNumber(words[1], &value) || value > 0xFFFF)
+    {
+      return -2;
+    }
+    interval[0] = (uint8_t)(value & 0xFF);
+    interval[1] = (uint8_t)(value >> 8);
+    return CMDLINK_send(link, COMMAND_STATS, interval, 2);
+  }
+  if(strcmp(words[0], "haptic") == 0 && count == 6)
+  {
+    static const char* const events[HAPTIC_EVENTS] = { "press", "contact", "lift" };
+    static const uint32_t limits[4] = { 0xFFFF, 0xFFFF, 0xFF, 0xFF };
+    uint8_t args[7];
+    uint32_t fields[4];
+    args[0] = HAPTIC_EVENTS;
+    for(uint8_t e = 0; e < HAPTIC_EVENTS; e++)
+    {
+      args[0] = strcmp(words[1], events[e]) == 0 ? e : args[0];
+    }
+    for(int i = 0; i < 4; i++)
+    {
+      if(!parseNumber(words[2 + i], &value) || value > limits[i])
+      {
+        return -2;
+      }
+      fields[i] = value;
+    }
+    if(args[0] == HAPTIC_EVENTS)
+    {
+      return -2;
+    }
+    args[1] = (uint8_t)(fields[0] & 0xFF);
+    args[2] = (uint8_t)(fields[0] >> 8);
+    args[3] = (uint8_t)(fields[1] & 0xFF);
+    args[4] = (uint8_t)(fields[1] >> 8);
+    args[5] = (uint8_t)fields[2];
+    args[6] = (uint8_t)fields[3];
+    return CMDLINK_send(link, COMMAND_HAPTIC, args, 7);
+  }
+  if(strcmp(words[0], "watch") == 0 && count == 4)
+  {
+    uint8_t args[7];
+    uint32_t address, length;
+    if(!parseNumber(words[1], &address) || !parseNumber(words[2], &length) || length < 1 || length > WATCH_MAX_LENGTH
+       || !parseNumber(words[3], &value) || value > 0xFFFF)
+    {
+      return -2;
+    }
+    for(int i = 0; i < 4; i++)
+    {
+      args[i] = (uint8_t)(address >> (8 * i));
+    }
+    args[4] = (uint8_t)length;
+    args[5] = (uint8_t)(value & 0xFF);
+    args[6] = (uint8_t)(value >> 8);
+    return CMDLINK_send(link, COMMAND_WATCH, args, 7);
+  }
+  return -2;
+}
+
+static void printResponse(const pending_t* pending, const cmdResponse_t* response)
+{
+  printf("%s:", pending->text);
+  if(response->status != 0)
+  {
+    printf(" status 0x%02X%s%s%s%s%s%s%s", response->status,
+           (response->status & 0x01) ? " bad-checksum" : "",
+           (response->status & 0x02) ? " length-mismatch" : "",
+           (response->status & 0x04) ? " bus-timeout" : "",
+           (response->status & 0x08) ? " no-response" : "",
+           (response->status & COMMAND_STATUS_FAILED) ? " failed" : "",
+           (response->status & COMMAND_STATUS_BAD_REQUEST) ? " bad-request" : "",
+           (response->status & COMMAND_STATUS_UNKNOWN) ? " unknown" : "");
+  }
+  if(response->opcode == COMMAND_SYSTEM_INFO && response->length >= 9)
+  {
+    const uint8_t* d = response->data;
+    printf(" vendor %04X product %04X version %04X chip %02X firmware %02X.%02X\n",
+           d[0] | (d[1] << 8), d[2] | (d[3] << 8), d[4] | (d[5] << 8), d[6], d[7], d[8]);
+    return;
+  }
+  for(uint16_t i = 0; i < response->length; i++)
+  {
+    printf(" %02X", response->data[i]);
+  }
+  printf(response->status == 0 && response->length == 0 ? " ok\n" : "\n");
+}
+
+/** Waits for the response to the oldest pending command and prints it. */
+static int completeOne(cmdLink_t* link, const pending_t* pending, int timeoutMs)
+{
+  cmdResponse_t response;
+  int result = CMDLINK_receive(link, &response, timeoutMs);
+  if(result <= 0)
+  {
+    fprintf(stderr, "%s: %s\n", pending->text, result == 0 ? "no response" : strerror(errno));
+    return -1;
+  }
+  if(response.requestId != (uint16_t)pending->requestId)
+  {
+    fprintf(stderr, "%s: response to request %u, expected %u\n", pending->text,
+            response.requestId, (uint16_t)pending->requestId);
+    return -1;
+  }
+  printResponse(pending, &response);
+  return response.status == 0 ? 0 : 1;
+}
+
+/** Sends count reads of bytes each with window commands in flight. Returns seconds taken. */
+static double timeReads(cmdLink_t* link, uint32_t count, uint16_t bytes, int window, int timeoutMs)
+{
+  uint32_t sent = 0, done = 0;
+  uint64_t start = HOST_nowNs();
+  while(done < count)
+  {
+    while(sent < count && (int)(sent - done) < window)
+    {
+      if(CMDLINK_sendRead(link, 0xC2C0 + (sent % 16), bytes) < 0)
+      {
+        return -1;
+      }
+      sent++;
+    }
+    cmdResponse_t response;
+    if(CMDLINK_receive(link, &response, timeoutMs) <= 0)
+    {
+      fprintf(stderr, "bench: no response after %u of %u reads\n", done, count);
+      return -1;
+    }
+    done++;
+  }
+  return (HOST_nowNs() - start) / 1e9;
+}
+
+/** Reads length bytes from address with READ_MEMORY commands of the largest
+	size, window at a time. Returns seconds taken, or -1. */
+static double readWithCommands(cmdLink_t* link, uint32_t address, uint8_t* data, uint32_t length,
+                               int window, int timeoutMs, uint8_t* status)
+{
+  uint32_t sent = 0, done = 0;
+  uint64_t start = HOST_nowNs();
+  *status = 0;
+  while(done < length)
+  {
+    while(sent < length && (sent - done) < (uint32_t)window * COMMAND_MAX_DATA)
+    {
+      uint32_t piece = length - sent < COMMAND_MAX_DATA ? length - sent : COMMAND_MAX_DATA;
+      if(CMDLINK_sendRead(link, address + sent, (uint16_t)piece) < 0)
+      {
+        return -1;
+      }
+      sent += piece;
+    }
+    cmdResponse_t response;
+    if(CMDLINK_receive(link, &response, timeoutMs) <= 0 || response.length > length - done)
+    {
+      fprintf(stderr, "region: no response after %u of %u bytes\n", done, length);
+      return -1;
+    }
+    memcpy(data + done, response.data, response.length);
+    *status |= response.status;
+    done += response.length;
+  }
+  return (HOST_nowNs() - start) / 1e9;
+}
+
+/** -R: reads the region both ways, compares them and saves it to output */
+static int readRegion(cmdLink_t* link, const char* spec, const char* output, int window, int timeoutMs)
+{
+  char text[64];
+  uint32_t address, length;
+  snprintf(text, sizeof(text), "%s", spec);
+  char* colon = strchr(text, ':');
+  if(colon == NULL)
+  {
+    return 2;
+  }
+  *colon = '\0';
+  if(!parseNumber(text, &address) || !parseNumber(colon + 1, &length) || length == 0)
+  {
+    return 2;
+  }
+
+  uint8_t* streamed = malloc(length);
+  uint8_t* commanded = malloc(length);
+  uint8_t commandStatus;
+  if(streamed == NULL || commanded == NULL)
+  {
+    return 1;
+  }
+  uint64_t start = HOST_nowNs();
+  int streamStatus = CMDLINK_readRegion(link, address, streamed, length, timeoutMs);
+  double streamSeconds = (HOST_nowNs() - start) / 1e9;
+  if(streamStatus < 0)
+  {
+    fprintf(stderr, "region: stream stopped after %u of %u bytes\n", link->region.received, length);
+    return 1;
+  }
+  double commandSeconds = readWithCommands(link, address, commanded, length, window, timeoutMs, &commandStatus);
+  if(commandSeconds < 0)
+  {
+    return 1;
+  }
+
+  bool same = memcmp(streamed, commanded, length) == 0;
+  printf("region 0x%X:%u\n", address, length);
+  printf("READ_REGION          %8.1f KB/s  %8.3f s  %5u chunks  status 0x%02X\n",
+         length / streamSeconds / 1000.0, streamSeconds, link->region.chunks, streamStatus);
+  printf("READ_MEMORY (w=%-3d)  %8.1f KB/s  %8.3f s  %5u reads   status 0x%02X  %s\n", window,
+         length / commandSeconds / 1000.0, commandSeconds, (length + COMMAND_MAX_DATA - 1) / COMMAND_MAX_DATA,
+         commandStatus, same ? "same data" : "DATA DIFFERS");
+
+  int result = (same && streamStatus == 0 && commandStatus == 0) ? 0 : 1;
+  if(output != NULL)
+  {
+    int fd = open(output, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if(fd < 0 || HOST_writeAll(fd, streamed, length) != 0)
+    {
+      fprintf(stderr, "%s: %s\n", output, strerror(errno));
+      result = 1;
+    }
+    if(fd >= 0)
+    {
+      close(fd);
+    }
+  }
+  free(streamed);
+  free(commanded);
+  return result;
+}
+
+int main(int argc, char** argv)
+{
+  int window = 16, timeoutMs = 1000, opt;
+  uint32_t benchCount = 0, benchBytes = 16;
+  const char* region = NULL;
+  const char* output = NULL;
+
+  while((opt = getopt(argc, argv, "w:t:b:n:R:o:h")) != -1)
+  {
+    switch(opt)
+    {
+      case 'w': window = atoi(optarg); break;
+      case 't': timeoutMs = atoi(optarg); break;
+      case 'b': benchCount = (uint32_t)strtoul(optarg, NULL, 0); break;
+      case 'n': benchBytes = (uint32_t)strtoul(optarg, NULL, 0); break;
+      case 'R': region = optarg; break;
+      case 'o': output = optarg; break;
+      default: usage(argv[0]); return 2;
+    }
+  }
+  if(optind >= argc || window < 1 || window > MAX_WINDOW || benchBytes > COMMAND_MAX_DATA)
+  {
+    usage(argv[0]);
+    return 2;
+  }
+
+  int fd = HOST_openSerial(argv[optind]);
+  if(fd < 0)
+  {
+    fprintf(stderr, "%s: %s\n", argv[optind], strerror(errno));
+    return 1;
+  }
+  static cmdLink_t link;
+  CMDLINK_init(&link, fd);
+
+  if(region != NULL)
+  {
+    int result = readRegion(&link, region, output, window, timeoutMs);
+    if(result == 2)
+    {
+      usage(argv[0]);
+    }
+    close(fd);
+    return result;
+  }
+
+  if(benchCount > 0)
+  {
+    double serial = timeReads(&link, benchCount, (uint16_t)benchBytes, 1, timeoutMs);
+    double pipelined = timeReads(&link, benchCount, (uint16_t)benchBytes, window, timeoutMs);
+    if(serial < 0 || pipelined < 0)
+    {
+      return 1;
+    }
+    printf("%u reads of %u bytes\n", benchCount, benchBytes);
+    printf("stop-and-wait      %8.1f reads/s  %8.1f us each\n", benchCount / serial, serial * 1e6 / benchCount);
+    printf("pipelined (w=%-3d)  %8.1f reads/s  %8.1f us each  %.2fx\n", window,
+           benchCount / pipelined, pipelined * 1e6 / benchCount, serial / pipelined);
+    close(fd);
+    return 0;
+  }
+
+  pending_t pending[MAX_WINDOW];
+  uint32_t sent = 0, done = 0;
+  int failures = 0, next = optind + 1;
+  bool fromStdin = next >= argc, more = true;
+  char line[1024];
+
+  while(more || done < sent)
+  {
+    while(more && (int)(sent - done) < window)
+    {
+      if(fromStdin)
+      {
+        more = fgets(line, sizeof(line), stdin) != NULL;
+      }
+      else
+      {
+        more = next < argc;
+        if(more)
+        {
+          snprintf(line, sizeof(line), "%s", argv[next++]);
+        }
+      }
+      if(!more || line[strspn(line, " \t\r\n")] == '\0' || line[0] == '#')
+      {
+        continue;
+      }
+      pending_t* slot = &pending[sent % MAX_WINDOW];
+      slot->requestId = sendLine(&link, line, slot);
+      if(slot->requestId == -2)
+      {
+        fprintf(stderr, "bad command: %s\n", slot->text);
+        failures++;
+        continue;
+      }
+      if(slot->requestId < 0)
+      {
+        fprintf(stderr, "%s: %s\n", argv[optind], strerror(errno));
+        return 1;
+      }
+      sent++;
+    }
+    if(done < sent)
+    {
+      int result = completeOne(&link, &pending[done % MAX_WINDOW], timeoutMs);
+      if(result < 0)
+      {
+        return 1;
+      }
+      failures += result;
+      done++;
+    }
+  }
+  close(fd);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,360 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+/** gen4decodebench - compares the table driven API_C2_decodeReport against the
+	hand written decoders it replaced. Every packet is decoded both ways and the
+	results checked for equality before anything is timed. Precision Touchpad
+	packets are also decoded with their contact IDs changed to ones past 4 or
+	repeated, and every contact must still land in a slot of its own.
+
+	usage: gen4decodebench [-n packets] [-r repeats] */
+
+#define _GNU_SOURCE
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "API_C2_Report.h"
+#include "HostSynth.h"
+#include "HostUtil.h"
+
+/************************************************************/
+/************************************************************/
+/******************* REFERENCE DECODERS *********************/
+
+/** The hand written decoders API_C2_decodeReport used before report layouts. */
+static void handDecodeMouse(const uint8_t* packet, report_t* result)
+{
+  const uint8_t* iter = &packet[3];
+  result->mouse.buttons = *iter++;
+  result->mouse.xDelta = (int8_t) *iter++;
+  result->mouse.yDelta = (int8_t) *iter++;
+  result->mouse.scrollDelta = (int8_t) *iter++;
+  result->mouse.panDelta = (int8_t) *iter;
+}
+
+static void handDecodeKeyboard(const uint8_t* packet, report_t* result)
+{
+  const uint8_t* iter = &packet[3];
+  result->keyboard.modifier = *iter++;
+  iter++;
+  for(uint8_t i = 0; i < 6; i++)
+  {
+    result->keyboard.keycode[i] = *iter++;
+  }
+}
+
+static void handDecodeAbsolute(const uint8_t* packet, report_t* result)
+{
+  const uint8_t* iter = &packet[3];
+  result->abs.contactFlags = *iter++;
+  for(uint8_t i = 0; i < 5; i++)
+  {
+    result->abs.fingers[i].palm = *iter++;
+    result->abs.fingers[i].x = (uint16_t) *iter++;
+    result->abs.fingers[i].x |= (uint16_t) *iter++ << 8;
+    result->abs.fingers[i].y = (uint16_t) *iter++;
+    result->abs.fingers[i].y |= (uint16_t) *iter++ << 8;
+  }
+  result->abs.buttons = *iter;
+}
+
+static void handDecodeReport(const uint8_t* packet, report_t* result)
+{
+  result->reportID = packet[2];
+  switch(result->reportID)
+  {
+    case MOUSE_REPORT_ID: handDecodeMouse(packet, result); break;
+    case KEYBOARD_REPORT_ID: handDecodeKeyboard(packet, result); break;
+    case CRQ_ABSOLUTE_REPORT_ID: handDecodeAbsolute(packet, result); break;
+    default: memset(result, 0, sizeof(*result)); break;
+  }
+}
+
+/************************************************************/
+/************************************************************/
+/******************* HELPER FUNCTIONS ***********************/
+
+static bool sameReport(const report_t* a, const report_t* b)
+{
+  if(a->reportID != b->reportID)
+  {
+    return false;
+  }
+  switch(a->reportID)
+  {
+    case MOUSE_REPORT_ID:
+      return memcmp(&a->mouse, &b->mouse, sizeof(a->mouse)) == 0;
+    case KEYBOARD_REPORT_ID:
+      return memcmp(&a->keyboard, &b->keyboard, sizeof(a->keyboard)) == 0;
+    default:
+      if(a->abs.contactFlags != b->abs.contactFlags || a->abs.buttons != b->abs.buttons)
+      {
+        return false;
+      }
+      for(uint8_t i = 0; i < 5; i++)
+      {
+        const fingerData_t* fa = &a->abs.fingers[i];
+        const fingerData_t* fb = &b->abs.fingers[i];
+        if(fa->x != fb->x || fa->y != fb->y || fa->palm != fb->palm)
+        {
+          return false;
+        }
+      }
+      return true;
+  }
+}
+
+/** Precision Touchpad packets only carry the confidence bit, so compare
+	the synthetic source report on contacts, buttons and positions. */
+static bool samePtpContacts(const report_t* source, const report_t* decoded)
+{
+  if(decoded->abs.contactFlags != source->abs.contactFlags
+     || decoded->abs.buttons != (source->abs.buttons & 0x07))
+  {
+    return false;
+  }
+  for(uint8_t i = 0; i < 5; i++)
+  {
+    if(!(source->abs.contactFlags & (1 << i)))
+    {
+      continue;
+    }
+    if(decoded->abs.fingers[i].x != source->abs.fingers[i].x 
+       || decoded->abs.fingers[i].y != source->abs.fingers[i].y)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+/** Contact IDs for the records of PTP packet n: all past the slots, mixed, 
+	repeated, then spread over the whole 6 bit range */
+static void contactIds(uint32_t n, uint8_t* ids)
+{
+  static const uint8_t fixed[3][5] = { { 5, 6, 7, 8, 9 }, { 63, 1, 40, 3, 2 }, { 2, 2, 0, 10, 4 } };
+  for(uint8_t i = 0; i < 5; i++)
+  {
+    ids[i] = (n % 4 < 3) ? fixed[n % 4][i] : (uint8_t)((n * 7 + i * 13) % 64);
+  }
+}
+
+/** Decodes packet with the contact IDs in ids and checks that each contact 
+	of source still has a slot of its own with its position, that an ID 
+	under 5 no earlier contact used keeps its slot, and that the view 
+	functions agree with the decode. */
+static bool ptpContactsKept(const report_t* source, const uint8_t* packet, const uint8_t* ids)
+{
+  uint8_t renumbered[PACKET_SIZE];
+  report_t decoded;
+  reportView_t view;
+  uint8_t seen = 0, claimed = 0;
+
+  memcpy(renumbered, packet, PACKET_SIZE);
+  for(uint8_t i = 0; i < 5; i++)
+  {
+    uint8_t* flags = &renumbered[3 + 5 * i];
+    *flags = (uint8_t)((*flags & 0x03) | (ids[i] << 2));
+  }
+  if(!API_C2_decodeReport(renumbered, &decoded) || !API_C2_viewReport(renumbered, &view))
+  {
+    return false;
+  }
+  for(uint8_t i = 0; i < 5; i++)
+  {
+    if(!(source->abs.contactFlags & (1 << i)))
+    {
+      continue;
+    }
+    uint8_t slot = 0;
+    while(slot < 5 && ((seen & (1 << slot)) || !(decoded.abs.contactFlags & (1 << slot))
+                       || decoded.abs.fingers[slot].x != source->abs.fingers[i].x
+                       || decoded.abs.fingers[slot].y != source->abs.fingers[i].y))
+    {
+      slot++;
+    }
+    if(slot == 5 || (ids[i] < 5 && !(claimed & (1 << ids[i])) && slot != ids[i]))
+    {
+      return false;
+    }
+    seen |= (uint8_t)(1 << slot);
+    claimed |= (uint8_t)((ids[i] < 5) ? 1 << ids[i] : 0);
+  }
+  if(decoded.abs.contactFlags != seen || API_C2_viewContactFlags(&view) != seen)
+  {
+    return false;
+  }
+  for(uint8_t slot = 0; slot < 5; slot++)
+  {
+    fingerData_t finger;
+    if((seen & (1 << slot)) && (!API_C2_viewFinger(&view, slot, &finger)
+                                || finger.x != decoded.abs.fingers[slot].x
+                                || finger.y != decoded.abs.fingers[slot].y))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void makeKeyboardPackets(uint8_t* packets, uint32_t count)
+{
+  uint32_t random = 12345;
+  for(uint32_t n = 0; n < count; n++)
+  {
+    report_t report;
+    memset(&report, 0, sizeof(report));
+    report.reportID = KEYBOARD_REPORT_ID;
+    random = random * 1103515245u + 12345u;
+    report.keyboard.modifier = (uint8_t)(random >> 24);
+    report.keyboard.keycode[0] = (uint8_t)(random >> 16);
+    report.keyboard.keycode[1] = (uint8_t)(random >> 8);
+    SYNTH_encodeReport(&report, &packets[n * PACKET_SIZE]);
+  }
+}
+
+typedef void (*decoder_t)(const uint8_t* packet, report_t* result);
+
+static void tableDecode(const uint8_t* packet, report_t* result)
+{
+  API_C2_decodeReport((uint8_t*)packet, result);
+}
+
+/** Returns nanoseconds per report for decoding all packets repeats times. */
+static double timeDecoder(decoder_t decoder, const uint8_t* packets, uint32_t count, uint32_t repeats)
+{
+  static volatile uint32_t sink;
+  report_t report;
+  uint32_t checksum = 0;
+
+  uint64_t start = HOST_nowNs();
+  for(uint32_t r = 0; r < repeats; r++)
+  {
+    for(uint32_t n = 0; n < count; n++)
+    {
+      decoder(&packets[n * PACKET_SIZE], &report);
+      checksum += report.abs.fingers[0].x + report.abs.buttons + report.keyboard.keycode[0];
+    }
+  }
+  uint64_t elapsed = HOST_nowNs() - start;
+  sink = checksum;
+  (void)sink;
+  return (double)elapsed / ((double)count * repeats);
+}
+
+/************************************************************/
+/************************************************************/
+/************************** MAIN ****************************/
+
+int main(int argc, char** argv)
+{
+  uint32_t count = 4096, repeats = 500;
+  int opt;
+  while((opt = getopt(argc, argv, "n:r:h")) != -1)
+  {
+    switch(opt)
+    {
+      case 'n': count = (uint32_t)strtoul(optarg, NULL, 0); break;
+      case 'r': repeats = (uint32_t)strtoul(optarg, NULL, 0); break;
+      default:
+        fprintf(stderr, "usage: %s [-n packets] [-r repeats]\n", argv[0]);
+        return 2;
+    }
+  }
+  if(count == 0 || repeats == 0)
+  {
+    return 2;
+  }
+
+  static const struct
+  {
+    const char* name;
+    uint8_t reportID;
+  } kinds[] =
+  {
+    { "mouse",        MOUSE_REPORT_ID },
+    { "keyboard",     KEYBOARD_REPORT_ID },
+    { "CRQ absolute", CRQ_ABSOLUTE_REPORT_ID },
+    { "PTP",          PTP_REPORT_ID },
+  };
+
+  uint8_t* packets = malloc((size_t)count * PACKET_SIZE);
+  report_t* sources = malloc((size_t)count * sizeof(report_t));
+  int status = 0;
+
+  printf("%-14s %12s %12s %8s\n", "report", "hand ns", "table ns", "ratio");
+  for(size_t k = 0; k < sizeof(kinds) / sizeof(kinds[0]); k++)
+  {
+    synth_t synth;
+    SYNTH_init(&synth, kinds[k].reportID == PTP_REPORT_ID ? CRQ_ABSOLUTE_REPORT_ID : kinds[k].reportID, 8000, 0);
+    if(kinds[k].reportID == KEYBOARD_REPORT_ID)
+    {
+      makeKeyboardPackets(packets, count);
+    }
+    else
+    {
+      for(uint32_t n = 0; n < count; n++)
+      {
+        uint8_t* packet = &packets[n * PACKET_SIZE];
+        if(kinds[k].reportID == PTP_REPORT_ID)
+        {
+          // build each frame as a CRQ absolute report, which is also the reference
+          uint8_t crq[PACKET_SIZE];
+          SYNTH_nextPacket(&synth, crq);
+          handDecodeReport(crq, &sources[n]);
+          sources[n].reportID = PTP_REPORT_ID;
+          SYNTH_encodeReport(&sources[n], packet);
+        }
+        else
+        {
+          SYNTH_nextPacket(&synth, packet);
+        }
+      }
+    }
+
+    // correctness first
+    for(uint32_t n = 0; n < count; n++)
+    {
+      report_t expected, actual;
+      const uint8_t* packet = &packets[n * PACKET_SIZE];
+      bool ok;
+      if(!API_C2_decodeReport((uint8_t*)packet, &actual))
+      {
+        ok = false;
+      }
+      else if(kinds[k].reportID == PTP_REPORT_ID)
+      {
+        uint8_t ids[5];
+        contactIds(n, ids);
+        ok = samePtpContacts(&sources[n], &actual) && ptpContactsKept(&sources[n], packet, ids);
+      }
+      else
+      {
+        handDecodeReport(packet, &expected);
+        ok = sameReport(&expected, &actual);
+      }
+      if(!ok)
+      {
+        fprintf(stderr, "%s packet %u: table decode differs from reference\n", kinds[k].name, n);
+        status = 1;
+        break;
+      }
+    }
+
+    double table = timeDecoder(tableDecode, packets, count, repeats);
+    if(kinds[k].reportID == PTP_REPORT_ID)
+    {
+      printf("%-14s %12s %12.1f %8s\n", kinds[k].name, "-", table, "-");
+    }
+    else
+    {
+      double hand = timeDecoder(handDecodeReport, packets, count, repeats);
+      printf("%-14s %12.1f %12.1f %7.2fx\n", kinds[k].name, hand, table, table / hand);
+    }
+  }
+
+  free(packets);
+  free(sources);
+  return status;
+}
@@ -0,0 +1,182 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+/** gen4fanoutd - owns the dev kit's serial port, decodes the binary report
+	stream once and publishes every report into a shared memory ring that any
+	number of tools can map (see HostRing.h).
+
+	usage: gen4fanoutd [-n ring_name] [-s slots] [-b] [-q] <tty or pty> */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <getopt.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "API_C2_Report.h"
+#include "API_Stream.h"
+#include "HostRing.h"
+#include "HostUtil.h"
+
+#define READ_CHUNK  (64 * 1024)
+
+static volatile sig_atomic_t running_g = 1;
+
+static void onSignal(int sig)
+{
+  (void)sig;
+  running_g = 0;
+}
+
+static void usage(const char* argv0)
+{
+  fprintf(stderr,
+          "usage: %s [-n ring_name] [-s slots] [-b] [-q] <tty or pty>\n"
+          "  -n  shared memory name (default " RING_DEFAULT_NAME ")\n"
+          "  -s  ring slots, rounded up to a power of two (default %d)\n"
+          "  -b  send 'b' to the board to turn on binary streaming\n"
+          "  -q  don't print statistics on exit\n",
+          argv0, RING_DEFAULT_SLOTS);
+}
+
+/** Publishes one report frame. Short packets are zero padded, so the slot 
+	always holds PACKET_SIZE bytes, exactly like a HB_readReport buffer. */
+static void publishReport(ring_t* ring, const streamFrame_t* frame, uint64_t hostTime)
+{
+  ringSlot_t* slot = RING_beginWrite(ring);
+  uint16_t length = frame->length < PACKET_SIZE ? frame->length : PACKET_SIZE;
+
+  slot->hostTime = hostTime;
+  slot->deviceTime = frame->timestamp;
+  memcpy(slot->packet, frame->payload, length);
+  memset(slot->packet + length, 0, PACKET_SIZE - length);
+  API_C2_decodeReport(slot->packet, &slot->report);
+  RING_commitWrite(ring, slot);
+}
+
+int main(int argc, char** argv)
+{
+  const char* name = RING_DEFAULT_NAME;
+  uint32_t slots = RING_DEFAULT_SLOTS;
+  bool enableStream = false, quiet = false;
+  int opt;
+
+  while((opt = getopt(argc, argv, "n:s:bqh")) != -1)
+  {
+    switch(opt)
+    {
+      case 'n': name = optarg; break;
+      case 's': slots = (uint32_t)strtoul(optarg, NULL, 0); break;
+      case 'b': enableStream = true; break;
+      case 'q': quiet = true; break;
+      default: usage(argv[0]); return 2;
+    }
+  }
+  if(optind != argc - 1 || slots == 0)
+  {
+    usage(argv[0]);
+    return 2;
+  }
+  const char* device = argv[optind];
+
+  int fd = HOST_openSerial(device);
+  if(fd < 0)
+  {
+    fprintf(stderr, "%s: %s\n", device, strerror(errno));
+    return 1;
+  }
+
+  ring_t ring;
+  if(RING_create(&ring, name, slots, device) != 0)
+  {
+    fprintf(stderr, "%s: %s\n", name, strerror(errno));
+    close(fd);
+    return 1;
+  }
+
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = onSignal;
+  sigaction(SIGINT, &sa, NULL);
+  sigaction(SIGTERM, &sa, NULL);
+  signal(SIGPIPE, SIG_IGN);
+
+  if(enableStream && HOST_writeAll(fd, "b", 1) != 0)
+  {
+    fprintf(stderr, "%s: %s\n", device, strerror(errno));
+  }
+
+  static streamParser_t parser;
+  static uint8_t buffer[READ_CHUNK];
+  uint64_t reports = 0, otherFrames = 0;
+  int status = 0;
+  API_Stream_initParser(&parser);
+
+  while(running_g)
+  {
+    struct pollfd pfd = { fd, POLLIN, 0 };
+    int ready = poll(&pfd, 1, 200);
+    if(ready < 0)
+    {
+      if(errno == EINTR)
+      {
+        continue;
+      }
+      perror("poll");
+      status = 1;
+      break;
+    }
+    if(ready == 0)
+    {
+      continue;
+    }
+
+    ssize_t count = read(fd, buffer, sizeof(buffer));
+    if(count <= 0)
+    {
+      if(count < 0 && (errno == EINTR || errno == EAGAIN))
+      {
+        continue;
+      }
+      // EOF, or EIO once the board or pty writer goes away
+      if(!quiet)
+      {
+        fprintf(stderr, "%s: input closed\n", device);
+      }
+      break;
+    }
+
+    uint64_t now = HOST_nowNs();
+    for(ssize_t i = 0; i < count; i++)
+    {
+      if(!API_Stream_parseByte(&parser, buffer[i]))
+      {
+        continue;
+      }
+      if(parser.frame.type == STREAM_TYPE_REPORT && parser.frame.length >= 3)
+      {
+        publishReport(&ring, &parser.frame, now);
+        reports++;
+      }
+      else
+      {
+        otherFrames++;
+      }
+    }
+    atomic_store_explicit(&ring.header->badFrames, parser.badFrames, memory_order_relaxed);
+    atomic_store_explicit(&ring.header->skippedBytes, parser.skipped, memory_order_relaxed);
+  }
+
+  if(!quiet)
+  {
+    fprintf(stderr, "published %llu reports, %llu other frames, %lu bad frames, %lu skipped bytes\n",
+            (unsigned long long)reports, (unsigned long long)otherFrames,
+            (unsigned long)parser.badFrames, (unsigned long)parser.skipped);
+  }
+  RING_close(&ring);
+  close(fd);
+  return status;
+}
@@ -0,0 +1,272 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+/** gen4flight - fetches and decodes the dev kit's flight recorder (see
+	API_Recorder.h). Given a tty it sends 'l' and collects the dump; given a
+	regular file it decodes a dump captured earlier (e.g. with cat).
+	The decoded packets can be written as a report stream that gen4synth -f
+	replays with the original timing.
+
+	usage: gen4flight [-l] [-o replay_file] [-w timeout_ms] <tty or file> */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "API_C2_Report.h"
+#include "API_Recorder.h"
+#include "API_Stream.h"
+#include "HostUtil.h"
+
+static void usage(const char* argv0)
+{
+  fprintf(stderr,
+          "usage: %s [-l] [-o replay_file] [-w timeout_ms] <tty or file>\n"
+          "  -l  list every recorded packet and register write\n"
+          "  -o  write the packets as API_Stream report frames (replay with gen4synth -f)\n"
+          "  -w  give up waiting for the board after this long (default 5000)\n",
+          argv0);
+}
+
+/** Dump being reassembled from STREAM_TYPE_RECORDER_ frames */
+typedef struct
+{
+  bool               haveInfo;
+  recorderDumpInfo_t info;
+  uint8_t*           data;
+  uint32_t           received;
+} dump_t;
+
+/** Handles one frame. Returns true once the whole dump has arrived. */
+static bool collectFrame(dump_t* dump, const streamFrame_t* frame)
+{
+  if(frame->type == STREAM_TYPE_RECORDER_INFO)
+  {
+    if(!API_Recorder_decodeDumpInfo(frame->payload, frame->length, &dump->info))
+    {
+      fprintf(stderr, "unsupported recorder dump version %u\n", frame->payload[0]);
+      return false;
+    }
+    free(dump->data);
+    dump->data = malloc(dump->info.length ? dump->info.length : 1);
+    dump->received = 0;
+    dump->haveInfo = dump->data != NULL;
+  }
+  else if(frame->type == STREAM_TYPE_RECORDER_DATA && dump->haveInfo && frame->length >= 4)
+  {
+    uint32_t offset = frame->payload[0] | (frame->payload[1] << 8)
+                    | (frame->payload[2] << 16) | ((uint32_t)frame->payload[3] << 24);
+    uint32_t count = frame->length - 4u;
+    if(offset + count <= dump->info.length)
+    {
+      memcpy(dump->data + offset, frame->payload + 4, count);
+      dump->received += count;
+    }
+  }
+  return dump->haveInfo && dump->received >= dump->info.length;
+}
+
+static void printEvent(const recorderEvent_t* event, uint32_t firstTimestamp)
+{
+  printf("%10.3f ms  ", (event->timestamp - firstTimestamp) / 1000.0);
+  if(event->type == RECORDER_EVENT_REGISTER)
+  {
+    printf("write 0x%08X:", event->address);
+    for(uint16_t i = 0; i < event->length; i++)
+    {
+      printf(" %02X", event->data[i]);
+    }
+    printf("\n");
+    return;
+  }
+
+  report_t report;
+  uint8_t packet[PACKET_SIZE] = { 0 };
+  memcpy(packet, event->data, event->length < PACKET_SIZE ? event->length : PACKET_SIZE);
+  if(!API_C2_decodeReport(packet, &report))
+  {
+    printf("report 0x%02X (no layout)\n", report.reportID);
+    return;
+  }
+  switch(API_C2_getReportKind(report.reportID))
+  {
+    case REPORT_KIND_MOUSE:
+      printf("mouse    buttons %02X  dx %4d dy %4d\n", report.mouse.buttons, report.mouse.xDelta, report.mouse.yDelta);
+      break;
+    case REPORT_KIND_KEYBOARD:
+      printf("keyboard modifier %02X  key %02X\n", report.keyboard.modifier, report.keyboard.keycode[0]);
+      break;
+    default:
+      printf("absolute contacts %02X buttons %02X", report.abs.contactFlags, report.abs.buttons);
+      for(uint8_t i = 0; i < 5; i++)
+      {
+        if(report.abs.contactFlags & (1 << i))
+        {
+          printf("  %u:(%u,%u)", i, report.abs.fingers[i].x, report.abs.fingers[i].y);
+        }
+      }
+      printf("\n");
+      break;
+  }
+}
+
+int main(int argc, char** argv)
+{
+  const char* output = NULL;
+  bool list = false;
+  int timeoutMs = 5000, opt;
+
+  while((opt = getopt(argc, argv, "lo:w:h")) != -1)
+  {
+    switch(opt)
+    {
+      case 'l': list = true; break;
+      case 'o': output = optarg; break;
+      case 'w': timeoutMs = atoi(optarg); break;
+      default: usage(argv[0]); return 2;
+    }
+  }
+  if(optind != argc - 1)
+  {
+    usage(argv[0]);
+    return 2;
+  }
+  const char* source = argv[optind];
+
+  struct stat st;
+  if(stat(source, &st) != 0)
+  {
+    fprintf(stderr, "%s: %s\n", source, strerror(errno));
+    return 1;
+  }
+  bool live = S_ISCHR(st.st_mode);
+  int fd = live ? HOST_openSerial(source) : open(source, O_RDONLY | O_CLOEXEC);
+  if(fd < 0)
+  {
+    fprintf(stderr, "%s: %s\n", source, strerror(errno));
+    return 1;
+  }
+  if(live && HOST_writeAll(fd, "l", 1) != 0)
+  {
+    fprintf(stderr, "%s: %s\n", source, strerror(errno));
+    return 1;
+  }
+
+  static streamParser_t parser;
+  static uint8_t buffer[64 * 1024];
+  dump_t dump = { 0 };
+  bool complete = false;
+  API_Stream_initParser(&parser);
+
+  uint64_t start = HOST_nowNs();
+  while(!complete)
+  {
+    if(live)
+    {
+      int remaining = timeoutMs - (int)((HOST_nowNs() - start) / 1000000);
+      struct pollfd pfd = { fd, POLLIN, 0 };
+      if(remaining <= 0 || poll(&pfd, 1, remaining) <= 0)
+      {
+        break;
+      }
+    }
+    ssize_t count = read(fd, buffer, sizeof(buffer));
+    if(count < 0 && (errno == EINTR || errno == EAGAIN))
+    {
+      continue;
+    }
+    if(count <= 0)
+    {
+      break;
+    }
+    for(ssize_t i = 0; i < count && !complete; i++)
+    {
+      if(API_Stream_parseByte(&parser, buffer[i]))
+      {
+        complete = collectFrame(&dump, &parser.frame);
+      }
+    }
+  }
+  close(fd);
+
+  if(!complete)
+  {
+    fprintf(stderr, "%s: incomplete dump (%u of %u bytes, %lu bad frames)\n", source,
+            dump.received, dump.haveInfo ? dump.info.length : 0, (unsigned long)parser.badFrames);
+    return 1;
+  }
+
+  int out = -1;
+  if(output != NULL)
+  {
+    out = open(output, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if(out < 0)
+    {
+      fprintf(stderr, "%s: %s\n", output, strerror(errno));
+      return 1;
+    }
+  }
+
+  recorderDecoder_t decoder;
+  recorderEvent_t event;
+  uint32_t packets = 0, writes = 0, firstTimestamp = 0, lastTimestamp = 0;
+  API_Recorder_initDecoder(&decoder);
+
+  for(uint32_t offset = 0; offset + RECORDER_RECORD_HEADER <= dump.info.length; )
+  {
+    const uint8_t* record = dump.data + offset;
+    offset += RECORDER_RECORD_HEADER + record[1];
+    if(offset > dump.info.length || !API_Recorder_decodeRecord(&decoder, record, &event))
+    {
+      continue;
+    }
+    if(packets + writes == 0)
+    {
+      firstTimestamp = event.timestamp;
+    }
+    lastTimestamp = event.timestamp;
+
+    if(event.type == RECORDER_EVENT_PACKET)
+    {
+      packets++;
+      if(out >= 0)
+      {
+        uint8_t frame[STREAM_MAX_FRAME];
+        uint16_t length = API_Stream_encodeFrame(STREAM_TYPE_REPORT, event.timestamp, event.data, event.length, frame);
+        HOST_writeAll(out, frame, length);
+      }
+    }
+    else
+    {
+      writes++;
+    }
+    if(list)
+    {
+      printEvent(&event, firstTimestamp);
+    }
+  }
+  if(out >= 0)
+  {
+    close(out);
+  }
+
+  const recorderStats_t* stats = &dump.info.stats;
+  printf("buffer %u of %u bytes: %u packets and %u register writes over %.3f s\n",
+         dump.info.length, dump.info.bufferSize, packets, writes, (lastTimestamp - firstTimestamp) / 1e6);
+  printf("since clear: %u packets (%u keyframes), %u register writes, %u records evicted\n",
+         stats->packets, stats->keyframes, stats->registerWrites, stats->evicted);
+  printf("compression: %u raw bytes stored in %u (%.1fx)\n", stats->rawBytes, stats->storedBytes,
+         stats->storedBytes ? (double)stats->rawBytes / stats->storedBytes : 0.0);
+  if(decoder.skipped || decoder.corrupt)
+  {
+    printf("%u records before the first keyframe skipped, %u corrupt\n", decoder.skipped, decoder.corrupt);
+  }
+  free(dump.data);
+  return decoder.corrupt ? 1 : 0;
+}
@@ -0,0 +1,375 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+/** gen4haptic - runs the haptic path (API_Haptic.h) against a simulated pad
+	(SimGen4.h) in real time and times the pulses it plays.
+
+	The pad plays the same touch over and over, every CYCLE_MS: a finger
+	down from 0 to 300 ms, with BTN1 pressed from 150 to 200 ms. It sends a
+	Cirque absolute report at every scan (-s) while the finger is down and
+	one more after it lifts, so each cycle has a contact, a press and a lift
+	event. The loop does what the sketch's reportTask does: reads a report
+	when DR asserts, with the sketch held for as long as the transfer takes at
+	400 kHz, and hands it to API_Haptic_report with the time DR asserted.
+	SIMHW_poll stands in for the DR edge and timer interrupts.
+
+	The motor is watched through SIMHW_getHaptic. For each event the pulses
+	played are compared with the pattern the sketch sets up for it: the
+	count, strength, and each pulse and gap to within a timer tick, and the
+	time from the pad asserting DR to the motor turning on, which should be
+	the report read. An event is not scored if the process was off the CPU
+	for longer than a timer tick while it played, since the interrupt on the
+	board would have been on time. Exits non-zero if an event was missed or
+	more than 1% of the scored ones are off.
+
+	usage: gen4haptic [-n cycles] [-s scan_us] */
+
+#define _GNU_SOURCE
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "API_C2.h"
+#include "API_Haptic.h"
+#include "API_Hardware.h"
+#include "HostSynth.h"
+#include "HostUtil.h"
+#include "SimBus.h"
+#include "SimGen4.h"
+#include "SimHardware.h"
+
+#define CYCLE_MS   (400)
+#define LIFT_MS    (300)
+#define PRESS_MS   (150)
+#define RELEASE_MS (200)
+#define SLACK_US   (1000)     /**< Host scheduling allowance on the bounds */
+#define MAX_PULSES (8)
+
+/** The patterns the sketch starts with (hapticPatterns_g) */
+static const hapticPattern_t patterns_g[HAPTIC_EVENTS] = { { 15, 10, 2, 200 }, { 10, 0, 1, 120 }, { 5, 0, 1, 80 } };
+static const char* const names_g[HAPTIC_EVENTS] = { "press", "contact", "lift" };
+
+static simGen4_t pad_g;
+
+/** The pad's side: the scripted touch and its reports */
+typedef struct
+{
+  uint32_t scanUs;
+  uint32_t startUs;
+  uint32_t lastScan;
+  uint8_t  contacts;        /**< As last reported */
+  uint8_t  buttons;
+  uint32_t cycles;          /**< Finished, counting from the lift */
+} padModel_t;
+
+/** What the motor did for one event */
+typedef struct
+{
+  uint8_t  event;           /**< HAPTIC_EVENTS until the pad has made one */
+  uint32_t readyUs;         /**< When the pad asserted DR with it */
+  bool     started;
+  uint32_t latencyUs;       /**< readyUs to the motor turning on */
+  uint8_t  pulses;
+  uint8_t  strength;        /**< Of the first pulse, 0 if they differ */
+  uint32_t onUs[MAX_PULSES];
+  uint32_t offUs[MAX_PULSES];
+  uint32_t edgeUs;          /**< Last motor change */
+  uint8_t  level;
+  bool     stalled;         /**< The process was off the CPU for over a tick */
+} burst_t;
+
+typedef struct
+{
+  uint32_t played;
+  uint32_t missed;          /**< No pulse at all */
+  uint32_t wrong;           /**< Pulses off from the pattern */
+  uint32_t slow;            /**< Latency over the bound */
+  uint32_t stalled;         /**< Not scored, see burst_t */
+  uint32_t minUs;
+  uint32_t maxUs;
+  uint64_t totalUs;
+} eventResult_t;
+
+static padModel_t model_g;
+static burst_t burst_g;
+static eventResult_t results_g[HAPTIC_EVENTS];
+
+static void usage(const char* argv0)
+{
+  fprintf(stderr,
+          "usage: %s [-n cycles] [-s scan_us]\n"
+          "  -n  touches of %u ms, each with a contact, a press and a lift (default 25)\n"
+          "  -s  pad scan period (default 8000)\n",
+          argv0, CYCLE_MS);
+}
+
+static bool dataReady(const void* context)
+{
+  return SIMGEN4_dataReady((const simGen4_t*)context);
+}
+
+static uint32_t readUs(void)
+{
+  return (uint32_t)(9ull * (PACKET_SIZE + 1) * 1000000ull / 400000u);
+}
+
+static bool within(uint32_t measured, uint32_t expected)
+{
+  return measured + HAPTIC_TICK_US + SLACK_US >= expected && measured <= expected + HAPTIC_TICK_US + SLACK_US;
+}
+
+/** Scores the burst of the last event against its pattern */
+static void endBurst(void)
+{
+  burst_t* b = &burst_g;
+  if(b->event == HAPTIC_EVENTS)
+  {
+    return;
+  }
+  const hapticPattern_t* pattern = &patterns_g[b->event];
+  eventResult_t* result = &results_g[b->event];
+  result->played++;
+  if(!b->started)
+  {
+    result->missed++;
+    return;
+  }
+  if(b->stalled)
+  {
+    result->stalled++;
+    return;
+  }
+  bool right = b->pulses == pattern->pulses && b->strength == pattern->strength && b->level == 0;
+  for(uint8_t p = 0; right && p < b->pulses; p++)
+  {
+    right = within(b->onUs[p], pattern->onMs * 1000u)
+            && (p + 1 == b->pulses || within(b->offUs[p], pattern->offMs * 1000u));
+  }
+  result->wrong += right ? 0 : 1;
+  result->slow += b->latencyUs > readUs() + SLACK_US ? 1 : 0;
+  result->minUs = (result->played - result->missed - result->stalled == 1 || b->latencyUs < result->minUs) ? b->latencyUs : result->minUs;
+  result->maxUs = b->latencyUs > result->maxUs ? b->latencyUs : result->maxUs;
+  result->totalUs += b->latencyUs;
+}
+
+/** Follows the motor: pulse starts, widths and gaps */
+static void watchMotor(uint32_t now)
+{
+  burst_t* b = &burst_g;
+  uint8_t level = SIMHW_getHaptic();
+  if(level == b->level || b->event == HAPTIC_EVENTS)
+  {
+    b->level = level;
+    return;
+  }
+  if(level != 0 && b->level == 0)
+  {
+    if(!b->started)
+    {
+      b->started = true;
+      b->latencyUs = now - b->readyUs;
+      b->strength = level;
+    }
+    else if(b->pulses <= MAX_PULSES)
+    {
+      b->offUs[b->pulses - 1] = now - b->edgeUs;
+    }
+    b->strength = level == b->strength ? b->strength : 0;
+  }
+  else if(level == 0)
+  {
+    if(b->pulses < MAX_PULSES)
+    {
+      b->onUs[b->pulses] = now - b->edgeUs;
+    }
+    b->pulses++;
+  }
+  b->level = level;
+  b->edgeUs = now;
+}
+
+/** Steps the pad to now: sends a report at each scan the finger is down,
+	and the one after it lifts */
+static void stepPad(uint32_t now)
+{
+  padModel_t* m = &model_g;
+  uint32_t scan = now / m->scanUs;
+  if(scan == m->lastScan)
+  {
+    return;
+  }
+  m->lastScan = scan;
+
+  uint32_t phaseMs = (now - m->startUs) / 1000u % CYCLE_MS;
+  uint8_t contacts = phaseMs < LIFT_MS ? 0x01 : 0;
+  uint8_t buttons = (phaseMs >= PRESS_MS && phaseMs < RELEASE_MS) ? 0x01 : 0;
+  if(contacts == 0 && m->contacts == 0)
+  {
+    return;
+  }
+  uint8_t event = HAPTIC_EVENTS;
+  if(buttons & ~m->buttons)
+  {
+    event = HAPTIC_EVENT_PRESS;
+  }
+  else if(contacts & ~m->contacts)
+  {
+    event = HAPTIC_EVENT_CONTACT;
+  }
+  else if(contacts == 0)
+  {
+    event = HAPTIC_EVENT_LIFT;
+    m->cycles++;
+  }
+
+  report_t report;
+  uint8_t packet[PACKET_SIZE];
+  memset(&report, 0, sizeof(report));
+  report.reportID = CRQ_ABSOLUTE_REPORT_ID;
+  report.abs.contactFlags = contacts;
+  report.abs.buttons = buttons;
+  report.abs.fingers[0].x = 1000;
+  report.abs.fingers[0].y = 800;
+  SYNTH_encodeReport(&report, packet);
+  SIMGEN4_queuePacket(&pad_g, packet);
+  m->contacts = contacts;
+  m->buttons = buttons;
+
+  if(event != HAPTIC_EVENTS)
+  {
+    endBurst();
+    memset(&burst_g, 0, sizeof(burst_g));
+    burst_g.event = event;
+    burst_g.readyUs = now;
+    burst_g.level = SIMHW_getHaptic();
+  }
+}
+
+/** One pass of everything that is not the sketch: interrupts, the pad, the motor */
+static void stepWorld(void)
+{
+  static uint32_t lastUs = 0;
+  SIMHW_poll();
+  uint32_t now = API_Hardware_micros();
+  bool playing = API_Haptic_playing() || (burst_g.event != HAPTIC_EVENTS && !burst_g.started);
+  if(playing && lastUs != 0 && now - lastUs > HAPTIC_TICK_US)
+  {
+    burst_g.stalled = true;     // the timer interrupt would have been on time
+  }
+  lastUs = now;
+  watchMotor(now);
+  stepPad(now);
+}
+
+/** Holds the sketch for as long as the bus traffic since the last call
+	takes at the current clock, with the world running meanwhile */
+static void holdForBus(void)
+{
+  static uint64_t lastBits = 0;
+  simBusStats_t* stats = SIMBUS_getStats();
+  uint64_t bits = 9ull * ((uint64_t)stats->bytesRead + stats->bytesWritten
+                          + stats->readTransactions + stats->writeTransactions);
+  uint64_t until = HOST_nowNs() + (bits - lastBits) * 1000000000ull / stats->clockFrequency;
+  lastBits = bits;
+  while(HOST_nowNs() < until)
+  {
+    stepWorld();
+  }
+}
+
+/************************************************************/
+/************************************************************/
+/************************** MAIN ****************************/
+
+int main(int argc, char** argv)
+{
+  uint32_t cycles = 25;
+  int opt;
+
+  model_g.scanUs = 8000;
+  while((opt = getopt(argc, argv, "n:s:h")) != -1)
+  {
+    switch(opt)
+    {
+      case 'n': cycles = (uint32_t)strtoul(optarg, NULL, 0); break;
+      case 's': model_g.scanUs = (uint32_t)strtoul(optarg, NULL, 0); break;
+      default: usage(argv[0]); return 2;
+    }
+  }
+  if(cycles == 0 || model_g.scanUs < 2 * readUs() || model_g.scanUs > 20000)
+  {
+    usage(argv[0]);
+    return 2;
+  }
+
+  SIMGEN4_init(&pad_g, CIRQUE_SLAVE_ADDR);
+  SIMBUS_detachAll();
+  SIMBUS_attach(&pad_g.device);
+  SIMHW_setDataReady(dataReady, &pad_g);
+  API_Hardware_init();
+  API_Hardware_PowerOn();
+  API_C2_init(400000, CIRQUE_SLAVE_ADDR);
+  holdForBus();
+  for(uint8_t event = 0; event < HAPTIC_EVENTS; event++)
+  {
+    API_Haptic_setPattern(event, &patterns_g[event]);
+  }
+  API_Haptic_enable(true);
+  burst_g.event = HAPTIC_EVENTS;
+  model_g.startUs = API_Hardware_micros();
+  model_g.lastScan = model_g.startUs / model_g.scanUs;
+
+  uint32_t lastReadUs = 0;
+  while(model_g.cycles < cycles || API_C2_DR_Asserted() || API_Haptic_playing())
+  {
+    stepWorld();
+    if(API_C2_DR_Asserted())
+    {
+      // as reportTask: ready from the DR edge, or the last read if DR stayed asserted
+      uint32_t readyUs = HostDR_assertedUs();
+      uint8_t packet[PACKET_SIZE];
+      if((int32_t)(lastReadUs - readyUs) > 0)
+      {
+        readyUs = lastReadUs;
+      }
+      uint8_t status = API_C2_readReportPacket(packet);
+      holdForBus();
+      lastReadUs = API_Hardware_micros();
+      if(status == SUCCESS)
+      {
+        reportView_t view;
+        API_C2_viewReport(packet, &view);
+        API_Haptic_report(&view, readyUs);
+      }
+    }
+  }
+  stepWorld();
+  endBurst();
+
+  const hapticStats_t* stats = API_Haptic_getStats();
+  uint32_t scored = 0, bad = 0;
+  printf("%u touches, scan %u us; report read %u us at 400 kHz\n", cycles, model_g.scanUs, readUs());
+  printf("%-8s %6s %6s %7s %6s %6s %6s %6s %6s | %8s\n", "event", "events", "pulsed", "stalled", "wrong", "slow",
+         "min", "mean", "max", "triggers");
+  for(uint8_t event = 0; event < HAPTIC_EVENTS; event++)
+  {
+    eventResult_t* r = &results_g[event];
+    uint32_t pulsed = r->played - r->missed;
+    uint32_t scored = pulsed - r->stalled;
+    printf("%-8s %6u %6u %7u %6u %6u %6u %6u %6u | %8u\n", names_g[event], r->played, pulsed, r->stalled, r->wrong,
+           r->slow, r->minUs, scored ? (uint32_t)(r->totalUs / scored) : 0, r->maxUs, stats->triggers[event]);
+    scored += pulsed - r->stalled;
+    bad += r->wrong + r->slow;
+    if(r->played < cycles || r->missed != 0 || stats->triggers[event] != r->played)
+    {
+      bad += 1000000;         // an event missed fails the run
+    }
+  }
+  printf("module: %u started, %u cut short, DR to motor min %u mean %u max %u us\n", stats->started,
+         stats->restarts, stats->minUs, API_Haptic_meanLatencyUs(stats), stats->maxUs);
+  if(stats->restarts != 0 || stats->minUs + 50 < readUs())
+  {
+    bad += 1000000;
+  }
+  return bad * 100 <= scored ? 0 : 1;
+}
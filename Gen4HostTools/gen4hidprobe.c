@@ -0,0 +1,209 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+/** gen4hidprobe - walks a pad through the I2C-HID host stack (API_I2CHID):
+	HID descriptor, report descriptor, reset handshake, input reports in mouse
+	and Precision Touchpad mode, GET/SET_REPORT and SET_POWER. In this host 
+	build it runs against the simulated pad in SimI2CHID.c and checks every 
+	step, so it doubles as a regression check for the stack.
+
+	usage: gen4hidprobe [-n reports] [-v] */
+
+#define _GNU_SOURCE
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "API_C2_Report.h"
+#include "API_I2CHID.h"
+#include "HostSynth.h"
+#include "SimBus.h"
+#include "SimI2CHID.h"
+
+static int failures_g = 0;
+static bool verbose_g = false;
+
+#define CHECK(condition, ...)                   \
+  do                                            \
+  {                                             \
+    if(!(condition))                            \
+    {                                           \
+      failures_g++;                             \
+      printf("FAIL: " __VA_ARGS__);             \
+      printf("\n");                             \
+    }                                           \
+  } while(0)
+
+static const char* statusText(uint8_t status)
+{
+  static char text[96];
+  if(status == I2CHID_SUCCESS)
+  {
+    return "ok";
+  }
+  snprintf(text, sizeof(text), "%s%s%s%s%s",
+           (status & I2CHID_SHORT_READ) ? "short-read " : "",
+           (status & I2CHID_LENGTH_MISMATCH) ? "length-mismatch " : "",
+           (status & I2CHID_BAD_DESCRIPTOR) ? "bad-descriptor " : "",
+           (status & I2CHID_BUFFER_TOO_SMALL) ? "buffer-too-small " : "",
+           (status & I2CHID_NO_REPORT) ? "no-report " : "");
+  return text;
+}
+
+/** Queues count synthetic reports one at a time, reads each back through the 
+	input register and checks the decoded result. Returns bytes read per report. */
+static double exchangeReports(simI2CHID_t* sim, uint8_t synthID, uint32_t count)
+{
+  const hidDescriptor_t* descriptor = I2CHID_getDescriptor();
+  synth_t synth;
+  uint32_t before = SIMBUS_getStats()->bytesRead;
+
+  SYNTH_init(&synth, synthID, 8000, 7);
+  for(uint32_t n = 0; n < count; n++)
+  {
+    uint8_t source[PACKET_SIZE];
+    uint8_t packet[PACKET_SIZE];
+    report_t expected, actual;
+
+    SYNTH_nextPacket(&synth, source);
+    API_C2_decodeReport(source, &expected);
+    CHECK(SIMHID_queueReport(sim, &expected), "queue report %u", n);
+    CHECK(SIMHID_interruptAsserted(sim), "DR not asserted for report %u", n);
+
+    memset(packet, 0, sizeof(packet));
+    uint8_t status = I2CHID_readInputReport(packet, descriptor->maxInputLength);
+    CHECK(status == I2CHID_SUCCESS, "input report %u: %s", n, statusText(status));
+    CHECK(API_C2_decodeReport(packet, &actual), "report ID 0x%02X has no layout", packet[2]);
+
+    if(synthID == MOUSE_REPORT_ID)
+    {
+      CHECK(memcmp(&actual.mouse, &expected.mouse, sizeof(actual.mouse)) == 0, "mouse report %u differs", n);
+    }
+    else
+    {
+      CHECK(actual.abs.contactFlags == expected.abs.contactFlags, "PTP report %u contacts 0x%02X != 0x%02X",
+            n, actual.abs.contactFlags, expected.abs.contactFlags);
+      for(uint8_t i = 0; i < 5; i++)
+      {
+        if(expected.abs.contactFlags & (1 << i))
+        {
+          CHECK(actual.abs.fingers[i].x == expected.abs.fingers[i].x
+                && actual.abs.fingers[i].y == expected.abs.fingers[i].y, "PTP report %u finger %u moved", n, i);
+        }
+      }
+    }
+    if(verbose_g && n < 3)
+    {
+      printf("  report %u: length %u id 0x%02X\n", n, packet[0] | (packet[1] << 8), packet[2]);
+    }
+  }
+  return (double)(SIMBUS_getStats()->bytesRead - before) / count;
+}
+
+int main(int argc, char** argv)
+{
+  uint32_t count = 200;
+  int opt;
+  while((opt = getopt(argc, argv, "n:vh")) != -1)
+  {
+    switch(opt)
+    {
+      case 'n': count = (uint32_t)strtoul(optarg, NULL, 0); break;
+      case 'v': verbose_g = true; break;
+      default:
+        fprintf(stderr, "usage: %s [-n reports] [-v]\n", argv[0]);
+        return 2;
+    }
+  }
+  if(count == 0)
+  {
+    count = 1;
+  }
+
+  simI2CHID_t sim;
+  SIMHID_init(&sim, 0x2C);
+  SIMBUS_attach(&sim.device);
+  I2C_init(400000);
+
+  // HID descriptor
+  uint8_t status = I2CHID_init(0x2C, SIMHID_DESCRIPTOR_REGISTER);
+  CHECK(status == I2CHID_SUCCESS, "HID descriptor: %s", statusText(status));
+  const hidDescriptor_t* descriptor = I2CHID_getDescriptor();
+  printf("HID descriptor: version %04X, VID %04X PID %04X, report descriptor %u bytes, max input %u bytes\n",
+         descriptor->bcdVersion, descriptor->vendorId, descriptor->productId,
+         descriptor->reportDescLength, descriptor->maxInputLength);
+
+  // report descriptor
+  static uint8_t reportDescriptor[1024];
+  status = I2CHID_readReportDescriptor(reportDescriptor, sizeof(reportDescriptor));
+  CHECK(status == I2CHID_SUCCESS, "report descriptor: %s", statusText(status));
+  printf("%-10s %8s %8s %8s\n", "report ID", "input", "output", "feature");
+  for(uint16_t id = 1; id < 256; id++)
+  {
+    const hidReportInfo_t* info = I2CHID_getReportInfo((uint8_t)id);
+    if(info != NULL)
+    {
+      printf("0x%02X       %8u %8u %8u\n", id, info->inputLength, info->outputLength, info->featureLength);
+    }
+  }
+  const hidReportInfo_t* mouse = I2CHID_getReportInfo(MOUSE_REPORT_ID);
+  const hidReportInfo_t* ptp = I2CHID_getReportInfo(PTP_REPORT_ID);
+  CHECK(mouse != NULL && mouse->inputLength == 6, "mouse input length");
+  CHECK(ptp != NULL && ptp->inputLength == 30, "PTP input length");
+  CHECK(ptp != NULL && ptp->inputLength + 2 == descriptor->maxInputLength, "max input length matches PTP report");
+
+  // reset handshake: DR asserts and the input register returns length 0
+  I2CHID_reset();
+  CHECK(SIMHID_interruptAsserted(&sim), "no interrupt after reset");
+  uint8_t packet[PACKET_SIZE];
+  status = I2CHID_readInputReport(packet, sizeof(packet));
+  CHECK(status == I2CHID_NO_REPORT, "reset response: %s", statusText(status));
+  CHECK(!SIMHID_interruptAsserted(&sim), "interrupt still asserted after reset response");
+
+  // mouse mode reports
+  double mouseBytes = exchangeReports(&sim, MOUSE_REPORT_ID, count);
+
+  // switch to Precision Touchpad mode with SET_REPORT, read it back with GET_REPORT
+  uint8_t mode = SIMHID_INPUT_MODE_PTP;
+  I2CHID_setReport(I2CHID_REPORT_FEATURE, SIMHID_INPUT_MODE_ID, &mode, 1);
+  uint8_t feature[8];
+  uint16_t length = 0;
+  status = I2CHID_getReport(I2CHID_REPORT_FEATURE, SIMHID_INPUT_MODE_ID, feature, sizeof(feature), &length);
+  CHECK(status == I2CHID_SUCCESS && length == 2 && feature[1] == SIMHID_INPUT_MODE_PTP,
+        "input mode feature: %s, length %u", statusText(status), length);
+  status = I2CHID_getReport(I2CHID_REPORT_FEATURE, SIMHID_MAX_CONTACTS_ID, feature, sizeof(feature), &length);
+  CHECK(status == I2CHID_SUCCESS && length == 2 && feature[1] == 5, "maximum contacts feature: %s", statusText(status));
+  printf("input mode %u, maximum contacts %u\n", sim.inputMode, feature[1]);
+
+  // Precision Touchpad reports, decoded with the PTP report layout
+  double ptpBytes = exchangeReports(&sim, CRQ_ABSOLUTE_REPORT_ID, count);
+
+  // an input report can also be fetched with GET_REPORT
+  report_t report;
+  synth_t synth;
+  SYNTH_init(&synth, CRQ_ABSOLUTE_REPORT_ID, 8000, 3);
+  SYNTH_nextPacket(&synth, packet);
+  API_C2_decodeReport(packet, &report);
+  SIMHID_queueReport(&sim, &report);
+  uint8_t input[64];
+  status = I2CHID_getReport(I2CHID_REPORT_INPUT, PTP_REPORT_ID, input, sizeof(input), &length);
+  CHECK(status == I2CHID_SUCCESS && length == 30 && input[0] == PTP_REPORT_ID, 
+        "GET_REPORT input: %s, length %u", statusText(status), length);
+  CHECK(!SIMHID_interruptAsserted(&sim), "GET_REPORT did not consume the input report");
+
+  // power commands
+  I2CHID_setPower(I2CHID_POWER_SLEEP);
+  CHECK(sim.powerState == I2CHID_POWER_SLEEP, "SET_POWER sleep");
+  CHECK(!SIMHID_queueReport(&sim, &report), "sleeping pad produced a report");
+  I2CHID_setPower(I2CHID_POWER_ON);
+  CHECK(sim.powerState == I2CHID_POWER_ON, "SET_POWER on");
+
+  simBusStats_t* stats = SIMBUS_getStats();
+  printf("%u reports per mode: %.1f bytes read per mouse report, %.1f per PTP report "
+         "(HB_readReport always reads %d)\n",
+         count, mouseBytes, ptpBytes, PACKET_SIZE);
+  printf("bus: %u write / %u read transactions, %u bytes written, %u read, %u NAKs\n",
+         stats->writeTransactions, stats->readTransactions, stats->bytesWritten, stats->bytesRead, stats->naks);
+  printf("%s\n", failures_g ? "FAILED" : "PASSED");
+  return failures_g ? 1 : 0;
+}
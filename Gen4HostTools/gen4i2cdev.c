@@ -0,0 +1,244 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+/** gen4i2cdev - system calls and time per pad access with the Linux
+	backend (LinuxHal.h), combined I2C_RDWR transfers against split ones.
+
+	Runs count extended memory reads of -c bytes and count report reads,
+	first with combined transfers (LINUXI2C_setCombined(true): one I2C_RDWR
+	per access, a repeated start between the command and the data), then
+	split (I2C_SLAVE, write() and read()). Each report read waits for Data
+	Ready (LINUXDR_wait) and is timed from the edge's kernel timestamp
+	(HostDR_assertedUs) to the end of the read.
+
+	With -d the pad is real: an i2c-dev adapter, and with -g and -l the GPIO
+	line of its Data Ready (reports come as it is touched; without -g only
+	memory is read). Without -d the stand-ins of SimLinuxDev.h answer, with
+	a simulated pad (SimGen4.h) that has a report queued before each wait.
+	The stand-ins take no time for the transfers themselves, so the times
+	are the software's: the system calls and the code around them.
+
+	Exits non-zero if data read back differs (against the simulated pad,
+	from its memory; on a real one, from the first read) or a combined
+	access took more than one I2C system call.
+
+	usage: gen4i2cdev [-d /dev/i2c-N] [-a address] [-g /dev/gpiochipN -l line]
+	                  [-n count] [-c bytes] [-m address] */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "API_C2.h"
+#include "API_Hardware.h"
+#include "API_HostBus.h"
+#include "HostDR.h"
+#include "HostSynth.h"
+#include "HostUtil.h"
+#include "LinuxHal.h"
+#include "SimGen4.h"
+#include "SimLinuxDev.h"
+
+static simGen4_t pad_g;
+
+/** One kind of access in one mode */
+typedef struct
+{
+  uint32_t count;
+  uint32_t errors;
+  uint32_t mismatches;
+  uint32_t syscalls;        /**< All of them */
+  uint32_t i2cSyscalls;
+  uint32_t transactions;
+  uint64_t totalNs;
+  uint64_t maxNs;
+  uint64_t minNs;
+} accessStats_t;
+
+static void usage(const char* argv0)
+{
+  fprintf(stderr,
+          "usage: %s [-d /dev/i2c-N] [-a address] [-g /dev/gpiochipN -l line] [-n count] [-c bytes] [-m address]\n"
+          "  -d  i2c-dev adapter of a real pad; without it the stand-ins answer\n"
+          "  -a  pad address (default 0x%02X)\n"
+          "  -g  GPIO chip and -l line of the pad's Data Ready\n"
+          "  -n  accesses of each kind (default 1000)\n"
+          "  -c  bytes per extended memory read (default 4, at most %u)\n"
+          "  -m  extended memory address to read (default 0x20001000)\n",
+          argv0, CIRQUE_SLAVE_ADDR, HB_MAX_READ_COUNT);
+}
+
+static bool dataReady(const void* context)
+{
+  return SIMGEN4_dataReady((const simGen4_t*)context);
+}
+
+static void count(accessStats_t* a, uint64_t ns, const linuxHalStats_t* before, const linuxHalStats_t* after)
+{
+  a->minNs = (a->count == 0 || ns < a->minNs) ? ns : a->minNs;
+  a->maxNs = ns > a->maxNs ? ns : a->maxNs;
+  a->totalNs += ns;
+  a->syscalls += after->syscalls - before->syscalls;
+  a->i2cSyscalls += after->i2cSyscalls - before->i2cSyscalls;
+  a->transactions += after->transactions - before->transactions;
+  a->count++;
+}
+
+static void printAccess(const char* mode, const char* kind, const accessStats_t* a, const char* timed)
+{
+  double n = a->count ? a->count : 1;
+  printf("%-9s %-8s %6u %6u %9.2f %9.2f %9.2f %8.1f %8.1f %8.1f  %s\n", mode, kind, a->count, a->errors,
+         a->syscalls / n, a->i2cSyscalls / n, a->transactions / n, a->minNs / 1000.0, a->totalNs / n / 1000.0,
+         a->maxNs / 1000.0, timed);
+}
+
+/************************************************************/
+/************************************************************/
+/************************** MAIN ****************************/
+
+int main(int argc, char** argv)
+{
+  const char* adapter = NULL;
+  const char* chip = NULL;
+  long line = -1;
+  uint32_t n = 1000;
+  uint16_t bytes = 4;
+  uint32_t memoryAddress = 0x20001000;
+  uint8_t address = CIRQUE_SLAVE_ADDR;
+  int opt;
+
+  while((opt = getopt(argc, argv, "d:a:g:l:n:c:m:h")) != -1)
+  {
+    switch(opt)
+    {
+      case 'd': adapter = optarg; break;
+      case 'a': address = (uint8_t)strtoul(optarg, NULL, 0); break;
+      case 'g': chip = optarg; break;
+      case 'l': line = strtol(optarg, NULL, 0); break;
+      case 'n': n = (uint32_t)strtoul(optarg, NULL, 0); break;
+      case 'c': bytes = (uint16_t)strtoul(optarg, NULL, 0); break;
+      case 'm': memoryAddress = (uint32_t)strtoul(optarg, NULL, 0); break;
+      default: usage(argv[0]); return 2;
+    }
+  }
+  if(n == 0 || bytes == 0 || bytes > HB_MAX_READ_COUNT || (chip != NULL) != (line >= 0))
+  {
+    usage(argv[0]);
+    return 2;
+  }
+
+  bool simulated = adapter == NULL;
+  if(simulated)
+  {
+    SIMLINUX_init();
+    SIMGEN4_init(&pad_g, address);
+    SIMLINUX_attach(&pad_g.device);
+    SIMLINUX_setDataReady(dataReady, &pad_g);
+    for(uint32_t i = 0; i < SIMGEN4_MEMORY_SIZE; i++)
+    {
+      pad_g.memory[i] = (uint8_t)(i * 7 + 3);
+    }
+    LINUXHAL_setOps(SIMLINUX_ops());
+    adapter = "/dev/i2c-1";
+    chip = "/dev/gpiochip0";
+    line = 0;
+  }
+  API_Hardware_init();
+  if(!LINUXI2C_open(adapter))
+  {
+    fprintf(stderr, "%s: %s\n", adapter, strerror(errno));
+    return 1;
+  }
+  if(chip != NULL && !LINUXDR_open(chip, (uint32_t)line))
+  {
+    fprintf(stderr, "%s line %ld: %s\n", chip, line, strerror(errno));
+    return 1;
+  }
+  API_C2_init(400000, address);
+
+  uint8_t expected[HB_MAX_READ_COUNT];
+  if(simulated)
+  {
+    for(uint16_t i = 0; i < bytes; i++)
+    {
+      expected[i] = pad_g.memory[(memoryAddress + i) & 0xFFFF];
+    }
+  }
+  else if(HB_readExtendedMemory(memoryAddress, expected, bytes) != SUCCESS)
+  {
+    fprintf(stderr, "no answer from the pad at 0x%02X\n", address);
+    return 1;
+  }
+
+  printf("%s, %u accesses of each kind, %u byte memory reads at 0x%08X\n",
+         simulated ? "stand-ins (SimLinuxDev.h)" : adapter, n, bytes, memoryAddress);
+  printf("%-9s %-8s %6s %6s %9s %9s %9s %8s %8s %8s\n", "mode", "access", "count", "errors", "syscalls",
+         "i2c", "transfers", "min us", "mean us", "max us");
+  int failures = 0;
+  for(int combined = 1; combined >= 0; combined--)
+  {
+    const char* mode = combined ? "combined" : "split";
+    accessStats_t memory, reports;
+    memset(&memory, 0, sizeof(memory));
+    memset(&reports, 0, sizeof(reports));
+    LINUXI2C_setCombined(combined != 0);
+
+    for(uint32_t i = 0; i < n; i++)
+    {
+      uint8_t data[HB_MAX_READ_COUNT];
+      linuxHalStats_t before = *LINUXHAL_getStats();
+      uint64_t start = HOST_nowNs();
+      uint8_t status = HB_readExtendedMemory(memoryAddress, data, bytes);
+      count(&memory, HOST_nowNs() - start, &before, LINUXHAL_getStats());
+      memory.errors += status != SUCCESS;
+      memory.mismatches += status == SUCCESS && memcmp(data, expected, bytes) != 0;
+    }
+
+    for(uint32_t i = 0; chip != NULL && i < n; i++)
+    {
+      uint8_t packet[PACKET_SIZE];
+      if(simulated)
+      {
+        report_t report;
+        memset(&report, 0, sizeof(report));
+        report.reportID = CRQ_ABSOLUTE_REPORT_ID;
+        report.abs.contactFlags = 0x01;
+        report.abs.fingers[0].x = (uint16_t)(i % 2048);
+        SYNTH_encodeReport(&report, packet);
+        SIMGEN4_queuePacket(&pad_g, packet);
+      }
+      linuxHalStats_t before = *LINUXHAL_getStats();
+      if(!LINUXDR_wait(1000000))
+      {
+        reports.errors++;
+        break;
+      }
+      uint8_t status = API_C2_readReportPacket(packet);
+      uint32_t doneUs = API_Hardware_micros();
+      count(&reports, (uint64_t)(doneUs - HostDR_assertedUs()) * 1000u, &before, LINUXHAL_getStats());
+      reports.errors += status != SUCCESS;
+    }
+
+    printAccess(mode, "memory", &memory, "call to return");
+    if(chip != NULL)
+    {
+      printAccess(mode, "report", &reports, "DR edge to read done");
+    }
+    failures += memory.errors + memory.mismatches + reports.errors;
+    if(combined && (memory.i2cSyscalls != memory.count || reports.i2cSyscalls != reports.count))
+    {
+      failures++;
+    }
+  }
+  if(simulated)
+  {
+    simLinuxStats_t* s = SIMLINUX_getStats();
+    printf("stand-ins: %u calls, %u I2C_RDWR carrying %u messages, %u read() %u write(), %u polls, %u edges\n",
+           s->calls, s->rdwrs, s->messages, s->reads, s->writes, s->polls, s->edges);
+  }
+  LINUXDR_close();
+  LINUXI2C_close();
+  return failures == 0 ? 0 : 1;
+}
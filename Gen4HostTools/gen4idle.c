@@ -0,0 +1,281 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+/** gen4idle - runs the idle power policy (API_C2_Idle.h) against a
+	simulated pad (SimGen4.h) and INA219 (SimINA219.h) on one simulated bus,
+	in real time. The pad scans every SIMINA_SCAN_PERIOD_US while tracking is
+	on and sends a report for each scan while it is touched; with tracking
+	off it sleeps, and the INA219 sees SIMINA_SLEEP_UV.
+
+	Touches follow a script of touch and gap lengths, long enough gaps for
+	the pad to doze and to sleep. The loop does what the sketch does: reads
+	reports on DR, hands them to the policy, polls the policy when due, and
+	samples the shunt voltage every 100 ms. The script is run twice, with the
+	policy and with tracking on the whole time, so the policy's estimate of
+	the energy saved can be checked against the shunt voltage measured.
+
+	For each touch, the time from the touch starting to its first report is
+	measured, by the state the pad was in when it started. Exits non-zero if
+	a touch got no report or waited longer than the state's wake bound plus a
+	scan period (the pad's own report interval).
+
+	usage: gen4idle [-a doze_after_ms] [-s sleep_after_ms] [-p doze_period_ms]
+	                [-P sleep_period_ms] [-w sample_ms] [-n cycles] */
+
+#define _GNU_SOURCE
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "API_C2.h"
+#include "API_C2_Idle.h"
+#include "API_Hardware.h"
+#include "HostSynth.h"
+#include "INA219.h"
+#include "SimBus.h"
+#include "SimGen4.h"
+#include "SimHardware.h"
+#include "SimINA219.h"
+
+#define POWER_PERIOD_US (100000)    /**< The sketch's power task */
+#define SLACK_US        (2000)      /**< Host scheduling allowance on the bound */
+
+/** Touch and gap lengths in ms: gaps long enough to doze, then to sleep,
+    and touches longer than the sleep period */
+static const uint32_t script_g[] = { 600, 1000, 600, 4000, 600, 500 };
+#define SCRIPT_STEPS (sizeof(script_g) / sizeof(script_g[0]))
+
+static simGen4_t pad_g;
+static simINA219_t ina_g;
+
+typedef struct
+{
+  uint32_t touches;
+  uint32_t missed;          /**< Touches that ended without a report */
+  uint64_t totalUs;         /**< Touch start to first report */
+  uint32_t maxUs;
+} touchStats_t;
+
+typedef struct
+{
+  int64_t  shuntSum;
+  uint32_t shuntSamples;
+  touchStats_t touches[IDLE_STATES];  /**< By the state at the start of the touch */
+} run_t;
+
+static void usage(const char* argv0)
+{
+  fprintf(stderr,
+          "usage: %s [-a doze_after_ms] [-s sleep_after_ms] [-p doze_period_ms]\n"
+          "          [-P sleep_period_ms] [-w sample_ms] [-n cycles]\n"
+          "  -a  no activity for this long dozes (default 500)\n"
+          "  -s  no activity for this long sleeps (default 2000)\n"
+          "  -p  sample period in DOZE (default %u)\n"
+          "  -P  sample period in SLEEP (default %u)\n"
+          "  -w  tracking time of each sample (default %u)\n"
+          "  -n  times through the touch script (default 1)\n",
+          argv0, IDLE_DOZE_PERIOD_MS, IDLE_SLEEP_PERIOD_MS, IDLE_SAMPLE_MS);
+}
+
+static bool dataReady(const void* context)
+{
+  return SIMGEN4_dataReady((const simGen4_t*)context);
+}
+
+static bool tracking(const void* context)
+{
+  return (((const simGen4_t*)context)->memory[0xC2C2] & 0x02) != 0;
+}
+
+/** Runs the script cycles times. With policy NULL tracking stays on. */
+static void runScript(const idlePolicy_t* policy, uint32_t cycles, run_t* run)
+{
+  synth_t synth;
+  report_t lift;
+  uint8_t packet[PACKET_SIZE], liftPacket[PACKET_SIZE];
+  bool measuring = false, touching = false, reported = true;
+  uint8_t touchState = IDLE_ACTIVE;
+  uint32_t step = 0, touchStartUs = 0, lastScan = 0;
+
+  memset(run, 0, sizeof(*run));
+  SYNTH_init(&synth, CRQ_ABSOLUTE_REPORT_ID, SIMINA_SCAN_PERIOD_US, 0);
+  memset(&lift, 0, sizeof(lift));
+  lift.reportID = CRQ_ABSOLUTE_REPORT_ID;
+  SYNTH_encodeReport(&lift, liftPacket);
+  pad_g.memory[0xC2C2] |= 0x02;     // the pad boots tracking
+
+  uint32_t now = API_Hardware_micros(), nextStep = now, nextPower = now;
+  if(policy != NULL)
+  {
+    API_C2_initIdle(policy, now);
+  }
+  while(step <= cycles * SCRIPT_STEPS)
+  {
+    now = API_Hardware_micros();
+
+    // the world: touches start and end, the pad scans while tracking
+    if((int32_t)(now - nextStep) >= 0)
+    {
+      if(touching && !reported)
+      {
+        run->touches[touchState].missed++;
+      }
+      if(touching && tracking(&pad_g))
+      {
+        SIMGEN4_queuePacket(&pad_g, liftPacket);
+      }
+      touching = (step % 2) == 0 && step < cycles * SCRIPT_STEPS;
+      if(touching)
+      {
+        touchStartUs = now;
+        touchState = (policy != NULL) ? API_C2_getIdleState() : IDLE_ACTIVE;
+        reported = false;
+        run->touches[touchState].touches++;
+      }
+      nextStep += script_g[step % SCRIPT_STEPS] * 1000u;
+      step++;
+    }
+    if(now / SIMINA_SCAN_PERIOD_US != lastScan)
+    {
+      lastScan = now / SIMINA_SCAN_PERIOD_US;
+      if(touching && tracking(&pad_g))
+      {
+        SYNTH_nextPacket(&synth, packet);
+        SIMGEN4_queuePacket(&pad_g, packet);
+      }
+    }
+
+    // the sketch: reports, the policy, the power task
+    if(API_C2_DR_Asserted() && API_C2_readReportPacket(packet) == SUCCESS)
+    {
+      reportView_t view;
+      API_C2_viewReport(packet, &view);
+      if(touching && !reported && API_C2_viewContactFlags(&view) != 0)
+      {
+        touchStats_t* touches = &run->touches[touchState];
+        uint32_t waited = API_Hardware_micros() - touchStartUs;
+        touches->totalUs += waited;
+        touches->maxUs = waited > touches->maxUs ? waited : touches->maxUs;
+        reported = true;
+      }
+      if(policy != NULL)
+      {
+        API_C2_idleReport(&view, now);
+      }
+    }
+    else if(policy != NULL && API_C2_idleDue(now))
+    {
+      API_C2_idlePoll(now);
+    }
+    else if((int32_t)(now - nextPower) >= 0 && INA219_busFree())
+    {
+      if(!measuring)
+      {
+        nextPower = now + INA219_startShuntMeasurement(CONFIG__SHUNT_ADC_AVERAGE_8);
+      }
+      else
+      {
+        int32_t microvolts = INA219_readShuntVoltage();
+        run->shuntSum += microvolts;
+        run->shuntSamples++;
+        if(policy != NULL)
+        {
+          API_C2_idleRecordShunt(microvolts);
+        }
+        nextPower += POWER_PERIOD_US;
+      }
+      measuring = !measuring;
+    }
+  }
+}
+
+static int32_t meanShunt(const run_t* run)
+{
+  return run->shuntSamples ? (int32_t)(run->shuntSum / run->shuntSamples) : 0;
+}
+
+/************************************************************/
+/************************************************************/
+/************************** MAIN ****************************/
+
+int main(int argc, char** argv)
+{
+  idlePolicy_t policy = { 500, 2000, IDLE_DOZE_PERIOD_MS, IDLE_SLEEP_PERIOD_MS, IDLE_SAMPLE_MS };
+  uint32_t cycles = 1;
+  int opt;
+
+  while((opt = getopt(argc, argv, "a:s:p:P:w:n:h")) != -1)
+  {
+    switch(opt)
+    {
+      case 'a': policy.dozeAfterMs = (uint32_t)strtoul(optarg, NULL, 0); break;
+      case 's': policy.sleepAfterMs = (uint32_t)strtoul(optarg, NULL, 0); break;
+      case 'p': policy.dozePeriodMs = (uint32_t)strtoul(optarg, NULL, 0); break;
+      case 'P': policy.sleepPeriodMs = (uint32_t)strtoul(optarg, NULL, 0); break;
+      case 'w': policy.sampleMs = (uint32_t)strtoul(optarg, NULL, 0); break;
+      case 'n': cycles = (uint32_t)strtoul(optarg, NULL, 0); break;
+      default: usage(argv[0]); return 2;
+    }
+  }
+  if(cycles == 0 || policy.sampleMs == 0 || policy.dozePeriodMs <= policy.sampleMs
+     || policy.sleepPeriodMs <= policy.sampleMs)
+  {
+    usage(argv[0]);
+    return 2;
+  }
+
+  SIMGEN4_init(&pad_g, CIRQUE_SLAVE_ADDR);
+  SIMINA_init(&ina_g, 0x40);
+  ina_g.scanning = tracking;
+  ina_g.scanningContext = &pad_g;
+  SIMBUS_detachAll();
+  SIMBUS_attach(&pad_g.device);
+  SIMBUS_attach(&ina_g.device);
+  SIMHW_setDataReady(dataReady, &pad_g);
+
+  // the sketch's order: API_Hardware_init starts the INA219, then the pad
+  API_Hardware_init();
+  INA219_init(0x40);
+  INA219_config(CONFIG__FS_RANGE_16V | CONFIG__SHUNT_PGA_DIV8);
+  API_Hardware_PowerOn();
+  API_C2_init(400000, CIRQUE_SLAVE_ADDR);
+
+  static run_t idle, always;
+  runScript(&policy, cycles, &idle);
+  idleStats_t stats = *API_C2_getIdleStats(API_Hardware_micros());
+  API_C2_stopIdle(API_Hardware_micros());
+  runScript(NULL, cycles, &always);
+
+  static const char* const names[IDLE_STATES] = { "active", "doze", "sleep" };
+  printf("policy: doze after %u ms (every %u ms), sleep after %u ms (every %u ms), %u ms samples\n",
+         policy.dozeAfterMs, policy.dozePeriodMs, policy.sleepAfterMs, policy.sleepPeriodMs, policy.sampleMs);
+  printf("%-8s %8s %9s %8s %8s | %8s %8s %8s %7s\n", "state", "time ms", "shunt uV", "entries", "bound ms",
+         "touches", "avg ms", "max ms", "missed");
+  int failures = 0;
+  for(uint8_t state = 0; state < IDLE_STATES; state++)
+  {
+    const touchStats_t* touches = &idle.touches[state];
+    uint32_t reported = touches->touches - touches->missed;
+    printf("%-8s %8llu %9d %8u %8u | %8u %8.1f %8.1f %7u\n", names[state],
+           (unsigned long long)(stats.timeUs[state] / 1000), API_C2_idleMeanShunt(&stats, state),
+           stats.entries[state], API_C2_idleWakeBoundUs(state) / 1000, touches->touches,
+           reported ? touches->totalUs / 1000.0 / reported : 0.0, touches->maxUs / 1000.0, touches->missed);
+    if(touches->missed != 0
+       || touches->maxUs > API_C2_idleWakeBoundUs(state) + SIMINA_SCAN_PERIOD_US + SLACK_US)
+    {
+      failures++;
+    }
+  }
+  printf("wakes %u: since last look avg %.1f ms, max %.1f ms; tracking on to report max %.1f ms\n",
+         stats.wakes, stats.wakes ? stats.totalWakeUs / 1000.0 / stats.wakes : 0.0,
+         stats.maxWakeUs / 1000.0, stats.maxResumeUs / 1000.0);
+  int32_t saved = API_C2_idleSavedPermille(&stats);
+  double measured = meanShunt(&always) ? 100.0 * (1.0 - (double)meanShunt(&idle) / meanShunt(&always)) : 0.0;
+  printf("energy saved: %.1f%% estimated from the states, %.1f%% measured (mean %d uV against %d uV tracking)\n",
+         saved / 10.0, measured, meanShunt(&idle), meanShunt(&always));
+  for(uint8_t state = 0; state < IDLE_STATES; state++)
+  {
+    failures += always.touches[state].missed != 0;
+  }
+  return failures == 0 ? 0 : 1;
+}
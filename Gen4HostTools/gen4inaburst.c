@@ -0,0 +1,292 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+/** gen4inaburst - compares three ways of taking shunt voltage samples from a
+	simulated INA219 (SimINA219.h), for each ADC setting:
+	  rmw     the old driver: read the config, write it back to trigger a
+	          conversion, wait, then point at the shunt register and read it
+	  shadow  INA219_measureShuntVoltage with the config kept in the driver:
+	          one config write to trigger, wait, pointer write and read
+	  burst   INA219_burstShuntVoltage: continuous conversions and one read
+	          per sample, the pointer left on the shunt register
+	For each: I2C transactions and bytes per sample, and samples per second
+	on the board, which adds the bus time at the given clock to the host time
+	(SimBus itself takes none; in a burst the bus overlaps the conversions).
+	The burst's own count (INA219_samplesPerSecond) and the conversions it
+	missed are shown too. Every read must return a conversion not read
+	before. Then a burst and single samples are taken with every 7th read
+	failing (a NAK or a short read): no sample may come from a failed read
+	and every failure must be counted. The exit status is non-zero if a
+	check fails.
+
+	usage: gen4inaburst [-n samples] [-k i2c_khz] [-a] */
+
+#define _GNU_SOURCE
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "API_Hardware.h"
+#include "INA219.h"
+#include "SimBus.h"
+#include "SimHardware.h"
+#include "SimINA219.h"
+
+#define INA_ADDRESS (0x40)
+#define BASE_CONFIG (CONFIG__FS_RANGE_16V | CONFIG__SHUNT_PGA_DIV8)
+
+typedef struct
+{
+  double   transactions;  /**< Per sample */
+  double   bytes;
+  double   boardRate;     /**< Samples per second with bus time */
+  uint32_t repeats;       /**< Reads that returned a conversion already read */
+} method_t;
+
+static void usage(const char* argv0)
+{
+  fprintf(stderr,
+          "usage: %s [-n samples] [-k i2c_khz] [-a]\n"
+          "  -n  samples per setting and method (default 200)\n"
+          "  -k  I2C clock used to work out bus time (default 400)\n"
+          "  -a  also run 16 to 128 sample averaging (slow)\n",
+          argv0);
+}
+
+/************************************************************/
+/************************************************************/
+/******************* HELPER FUNCTIONS ***********************/
+
+/** Register access of the old driver, a pointer write every time */
+static uint16_t rmwRead(uint8_t reg)
+{
+  I2C_beginTransmission(INA_ADDRESS);
+  I2C_write(reg);
+  I2C_endTransmission(false);
+  I2C_request(INA_ADDRESS, 2, true);
+  return (uint16_t)((I2C_read() << 8) | I2C_read());
+}
+
+static void rmwWrite(uint8_t reg, uint16_t value)
+{
+  I2C_beginTransmission(INA_ADDRESS);
+  I2C_write(reg);
+  I2C_write((uint8_t)(value >> 8));
+  I2C_write((uint8_t)(value & 0xFF));
+  I2C_endTransmission(true);
+}
+
+static int32_t rmwSample(uint16_t adcMask)
+{
+  uint16_t config = rmwRead(REGISTER__CONFIG);
+  config &= ~CONFIG__SHUNT_ADC_AVERAGE_128;
+  config |= CONFIG__MODE_SHUNT_TRIG | adcMask;
+  rmwWrite(REGISTER__CONFIG, config);
+  uint32_t start = API_Hardware_micros();
+  while(API_Hardware_micros() - start < INA219_shuntConversionUs(adcMask));
+  return (int16_t)rmwRead(REGISTER__SHUNT_VOLTAGE) * 10;
+}
+
+static uint32_t busTimeUs(uint32_t clockHz)
+{
+  simBusStats_t* stats = SIMBUS_getStats();
+  uint64_t bits = 9ull * ((uint64_t)stats->bytesRead + stats->bytesWritten
+                          + stats->readTransactions + stats->writeTransactions);
+  return (uint32_t)(bits * 1000000ull / clockHz);
+}
+
+/** Brings the INA219 and the driver to the sketch's starting point, then 
+	clears the counters */
+static void reset(simINA219_t* ina)
+{
+  SIMINA_init(ina, INA_ADDRESS);
+  SIMBUS_detachAll();
+  SIMBUS_attach(&ina->device);
+  INA219_init(INA_ADDRESS);
+  INA219_config(BASE_CONFIG);
+  SIMBUS_resetStats();
+  memset(&ina->stats, 0, sizeof(ina->stats));
+  ina->lastReadSequence = ina->baseSequence;
+}
+
+static void finish(const simINA219_t* ina, uint32_t samples, uint32_t hostUs, bool overlapped,
+                   uint32_t clockHz, method_t* result)
+{
+  simBusStats_t* stats = SIMBUS_getStats();
+  uint32_t busUs = busTimeUs(clockHz);
+  uint32_t boardUs = overlapped ? (busUs > hostUs ? busUs : hostUs) : hostUs + busUs;
+
+  result->transactions = (double)(stats->readTransactions + stats->writeTransactions) / samples;
+  result->bytes = (double)(stats->bytesRead + stats->bytesWritten) / samples;
+  result->boardRate = boardUs ? samples * 1e6 / boardUs : 0;
+  result->repeats = ina->stats.repeats;
+}
+
+/** A level SimINA219 draws, as opposed to bytes from a failed read */
+static bool validSample(int32_t microvolts)
+{
+  return microvolts == SIMINA_SCAN_UV || microvolts == SIMINA_IDLE_UV || microvolts == SIMINA_SLEEP_UV;
+}
+
+/** Fails every 7th read, NAKs and short reads in turn, first in a burst and 
+	then for single samples, and checks that each sample taken is a real one 
+	and each failure was counted. Returns the checks that went wrong. */
+static int checkFaults(simINA219_t* ina, int32_t* values, uint32_t samples)
+{
+  ina219BurstStats_t stats;
+  uint32_t attempts = 0, taken = 0, invalid = 0;
+  int wrong = 0;
+
+  reset(ina);
+  INA219_startBurst(CONFIG__SHUNT_ADC_RES_12);
+  while(taken < samples && INA219_burstActive())
+  {
+    if(!INA219_burstDue())
+    {
+      continue;
+    }
+    if(++attempts % 7 == 0)
+    {
+      SIMBUS_injectFault((attempts % 14 == 0) ? SIMBUS_FAULT_SHORT_READ : SIMBUS_FAULT_NAK, 1);
+    }
+    taken += INA219_readBurst(&values[taken]) ? 1 : 0;
+    SIMBUS_injectFault(SIMBUS_FAULT_NONE, 0);
+  }
+  INA219_getBurstStats(&stats);
+  INA219_stopBurst();
+  for(uint32_t n = 0; n < taken; n++)
+  {
+    invalid += validSample(values[n]) ? 0 : 1;
+  }
+  bool pass = taken == samples && stats.samples == samples && invalid == 0
+              && stats.errors == SIMBUS_getStats()->faults;
+  printf("faults: burst  %u samples, %u invalid, %u reads failed of %u injected: %s\n", taken, invalid,
+         stats.errors, SIMBUS_getStats()->faults, pass ? "ok" : "FAIL");
+  wrong += pass ? 0 : 1;
+
+  // Short reads only: a NAK could hit the config write instead, which is not a read
+  reset(ina);
+  uint32_t errors = INA219_getErrorCount();
+  invalid = 0;
+  for(uint32_t n = 0; n < samples; n++)
+  {
+    if(n % 7 == 6)
+    {
+      SIMBUS_injectFault(SIMBUS_FAULT_SHORT_READ, 1);
+    }
+    values[n] = INA219_measureShuntVoltage(CONFIG__SHUNT_ADC_RES_12);
+    SIMBUS_injectFault(SIMBUS_FAULT_NONE, 0);
+    invalid += validSample(values[n]) ? 0 : 1;
+  }
+  errors = INA219_getErrorCount() - errors;
+  pass = invalid == 0 && errors == SIMBUS_getStats()->faults;
+  printf("faults: single %u samples, %u invalid, %u reads failed of %u injected: %s\n", samples, invalid,
+         errors, SIMBUS_getStats()->faults, pass ? "ok" : "FAIL");
+  wrong += pass ? 0 : 1;
+  return wrong;
+}
+
+/************************************************************/
+/************************************************************/
+/************************** MAIN ****************************/
+
+int main(int argc, char** argv)
+{
+  uint32_t samples = 200, clockHz = 400000;
+  bool all = false;
+  int opt;
+
+  while((opt = getopt(argc, argv, "n:k:ah")) != -1)
+  {
+    switch(opt)
+    {
+      case 'n': samples = (uint32_t)strtoul(optarg, NULL, 0); break;
+      case 'k': clockHz = (uint32_t)strtoul(optarg, NULL, 0) * 1000u; break;
+      case 'a': all = true; break;
+      default: usage(argv[0]); return 2;
+    }
+  }
+  if(samples == 0 || clockHz == 0)
+  {
+    usage(argv[0]);
+    return 2;
+  }
+
+  static const struct
+  {
+    const char* name;
+    uint16_t    mask;
+  } settings[] =
+  {
+    { "9 bit",  CONFIG__SHUNT_ADC_RES_9 },
+    { "10 bit", CONFIG__SHUNT_ADC_RES_10 },
+    { "11 bit", CONFIG__SHUNT_ADC_RES_11 },
+    { "12 bit", CONFIG__SHUNT_ADC_RES_12 },
+    { "2x",     CONFIG__SHUNT_ADC_AVERAGE_2 },
+    { "4x",     CONFIG__SHUNT_ADC_AVERAGE_4 },
+    { "8x",     CONFIG__SHUNT_ADC_AVERAGE_8 },
+    { "16x",    CONFIG__SHUNT_ADC_AVERAGE_16 },
+    { "32x",    CONFIG__SHUNT_ADC_AVERAGE_32 },
+    { "64x",    CONFIG__SHUNT_ADC_AVERAGE_64 },
+    { "128x",   CONFIG__SHUNT_ADC_AVERAGE_128 },
+  };
+  size_t count = all ? sizeof(settings) / sizeof(settings[0]) : 7;
+
+  static simINA219_t ina;
+  int32_t* values = malloc(samples * sizeof(int32_t));
+  int failures = 0;
+
+  API_Hardware_init();
+  printf("%-7s %6s %6s | %-16s | %-16s | %-16s | %6s %6s\n", "", "", "", "rmw", "shadow", "burst",
+         "burst", "");
+  printf("%-7s %6s %6s | %4s %4s %6s | %4s %4s %6s | %4s %4s %6s | %6s %6s\n", "adc", "conv", "max/s",
+         "i2c", "B", "/s", "i2c", "B", "/s", "i2c", "B", "/s", "own/s", "missed");
+  for(size_t s = 0; s < count; s++)
+  {
+    uint16_t mask = settings[s].mask;
+    method_t rmw, shadow, burst;
+    ina219BurstStats_t stats;
+
+    reset(&ina);
+    uint32_t start = API_Hardware_micros();
+    for(uint32_t n = 0; n < samples; n++)
+    {
+      values[n] = rmwSample(mask);
+    }
+    finish(&ina, samples, API_Hardware_micros() - start, false, clockHz, &rmw);
+
+    reset(&ina);
+    start = API_Hardware_micros();
+    for(uint32_t n = 0; n < samples; n++)
+    {
+      values[n] = INA219_measureShuntVoltage(mask);
+    }
+    finish(&ina, samples, API_Hardware_micros() - start, false, clockHz, &shadow);
+
+    reset(&ina);
+    start = API_Hardware_micros();
+    INA219_startBurst(mask);
+    for(uint32_t n = 0; n < samples; )
+    {
+      n += INA219_readBurst(&values[n]) ? 1 : 0;
+    }
+    uint32_t hostUs = API_Hardware_micros() - start;
+    INA219_getBurstStats(&stats);
+    INA219_stopBurst();
+    finish(&ina, samples, hostUs, true, clockHz, &burst);
+
+    printf("%-7s %6u %6u | %4.1f %4.1f %6.0f | %4.1f %4.1f %6.0f | %4.1f %4.1f %6.0f | %6u %6u\n",
+           settings[s].name, INA219_shuntConversionUs(mask), 1000000u / INA219_shuntConversionUs(mask),
+           rmw.transactions, rmw.bytes, rmw.boardRate, shadow.transactions, shadow.bytes, shadow.boardRate,
+           burst.transactions, burst.bytes, burst.boardRate, INA219_samplesPerSecond(&stats), stats.missed);
+    if(rmw.repeats != 0 || shadow.repeats != 0 || burst.repeats != 0)
+    {
+      fprintf(stderr, "%s: reads returned a conversion already read (rmw %u, shadow %u, burst %u)\n",
+              settings[s].name, rmw.repeats, shadow.repeats, burst.repeats);
+      failures++;
+    }
+  }
+  failures += checkFaults(&ina, values, samples);
+  free(values);
+  return failures == 0 ? 0 : 1;
+}
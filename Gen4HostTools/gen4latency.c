@@ -0,0 +1,240 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+/** gen4latency - runs the latency benchmark (API_C2_Latency.h) against a
+	simulated pad (SimGen4.h) with a known response, on a virtual clock
+	(SIMHW_useVirtualClock) so the result is the same on any host.
+
+	The benchmark presses BTN1 through API_Hardware_injectButton, which
+	SimHardware.c keeps for SIMHW_getButtons. The pad sees a change of its
+	button inputs response_us later and reports it at its next scan (every
+	scan_us, or at once with -s 0), as a mouse report in relative mode and a
+	Cirque absolute report in absolute mode (0xC2C4 bit 1, set by the
+	benchmark). The loop does what the sketch does: reads a report when DR
+	asserts and hands it to the benchmark, and polls the benchmark when due.
+	Each pass of it takes 1 us, and each transfer as long as it takes at the
+	bus clock: 9 clocks per byte plus the address byte.
+
+	Each run (relative and absolute, at 400 and 100 kHz) should then see
+	latencies from response_us plus the report read up to a scan period
+	more, and a mean half way. Exits non-zero if a run is short of presses,
+	a press timed out, or a run's minimum or mean is outside that. The
+	percentiles are printed but not checked.
+
+	usage: gen4latency [-r response_us] [-s scan_us] [-n iterations]
+	                   [-g gap_ms] [-j jitter_ms] */
+
+#define _GNU_SOURCE
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "API_C2.h"
+#include "API_C2_Latency.h"
+#include "API_Hardware.h"
+#include "HostSynth.h"
+#include "SimBus.h"
+#include "SimGen4.h"
+#include "SimHardware.h"
+
+static simGen4_t pad_g;
+
+/** The pad's side: what its button inputs are, and what it reports */
+typedef struct
+{
+  uint32_t responseUs;
+  uint32_t scanUs;
+  uint8_t  inputs;          /**< Button inputs as the pins have them */
+  uint8_t  seen;            /**< ... as the pad has noticed them */
+  uint32_t changedUs;       /**< When inputs last changed */
+  bool     unreported;      /**< seen changed since the last report */
+  uint32_t lastScan;
+} padModel_t;
+
+static padModel_t model_g;
+
+static void usage(const char* argv0)
+{
+  fprintf(stderr,
+          "usage: %s [-r response_us] [-s scan_us] [-n iterations] [-g gap_ms] [-j jitter_ms]\n"
+          "  -r  time for the pad to notice a button change (default 1000)\n"
+          "  -s  pad scan period, 0 to report as soon as it notices (default 8000)\n"
+          "  -n  presses per run (default 100)\n"
+          "  -g  gap between a report and the next edge (default 2)\n"
+          "  -j  most added to the gap at random (default %u)\n",
+          argv0, LATENCY_JITTER_MS);
+}
+
+static bool dataReady(const void* context)
+{
+  return SIMGEN4_dataReady((const simGen4_t*)context);
+}
+
+/** Steps the pad to now: notices button changes response_us after they
+    happen and reports them at the next scan */
+static void stepPad(uint32_t now)
+{
+  padModel_t* m = &model_g;
+  uint8_t buttons = SIMHW_getButtons();
+  if(buttons != m->inputs)
+  {
+    m->inputs = buttons;
+    m->changedUs = now;
+  }
+  if(m->seen != m->inputs && now - m->changedUs >= m->responseUs)
+  {
+    m->seen = m->inputs;
+    m->unreported = true;
+  }
+  bool scan = m->scanUs == 0 || now / m->scanUs != m->lastScan;
+  if(m->scanUs != 0)
+  {
+    m->lastScan = now / m->scanUs;
+  }
+  if(scan && m->unreported)
+  {
+    report_t report;
+    uint8_t packet[PACKET_SIZE];
+    memset(&report, 0, sizeof(report));
+    if(pad_g.memory[0xC2C4] & 0x02)
+    {
+      report.reportID = CRQ_ABSOLUTE_REPORT_ID;
+      report.abs.buttons = m->seen;
+    }
+    else
+    {
+      report.reportID = MOUSE_REPORT_ID;
+      report.mouse.buttons = m->seen;
+    }
+    SYNTH_encodeReport(&report, packet);
+    SIMGEN4_queuePacket(&pad_g, packet);
+    m->unreported = false;
+  }
+}
+
+/** Holds the sketch for as long as the bus traffic since the last call
+    takes at the current clock, with the pad running meanwhile */
+static void holdForBus(void)
+{
+  static uint64_t lastBits = 0;
+  simBusStats_t* stats = SIMBUS_getStats();
+  uint64_t bits = 9ull * ((uint64_t)stats->bytesRead + stats->bytesWritten
+                          + stats->readTransactions + stats->writeTransactions);
+  uint64_t us = ((bits - lastBits) * 1000000ull + stats->clockFrequency / 2) / stats->clockFrequency;
+  lastBits = bits;
+  for(; us > 0; us--)
+  {
+    SIMHW_advance(1);
+    stepPad(API_Hardware_micros());
+  }
+}
+
+static uint32_t readUs(uint32_t clockHz)
+{
+  return (uint32_t)(9ull * (PACKET_SIZE + 1) * 1000000ull / clockHz);
+}
+
+/************************************************************/
+/************************************************************/
+/************************** MAIN ****************************/
+
+int main(int argc, char** argv)
+{
+  latencyPlan_t plan = { 0, 100, 2, LATENCY_JITTER_MS, 400000, 4,
+                         { { false, 400000 }, { false, 100000 }, { true, 400000 }, { true, 100000 } } };
+  int opt;
+
+  model_g.responseUs = 1000;
+  model_g.scanUs = 8000;
+  while((opt = getopt(argc, argv, "r:s:n:g:j:h")) != -1)
+  {
+    switch(opt)
+    {
+      case 'r': model_g.responseUs = (uint32_t)strtoul(optarg, NULL, 0); break;
+      case 's': model_g.scanUs = (uint32_t)strtoul(optarg, NULL, 0); break;
+      case 'n': plan.iterations = (uint16_t)strtoul(optarg, NULL, 0); break;
+      case 'g': plan.gapMs = (uint16_t)strtoul(optarg, NULL, 0); break;
+      case 'j': plan.jitterMs = (uint16_t)strtoul(optarg, NULL, 0); break;
+      default: usage(argv[0]); return 2;
+    }
+  }
+  if(plan.iterations == 0 || model_g.responseUs + model_g.scanUs + readUs(100000) >= LATENCY_TIMEOUT_MS * 1000u)
+  {
+    usage(argv[0]);
+    return 2;
+  }
+
+  SIMGEN4_init(&pad_g, CIRQUE_SLAVE_ADDR);
+  SIMBUS_detachAll();
+  SIMBUS_attach(&pad_g.device);
+  SIMHW_setDataReady(dataReady, &pad_g);
+  SIMHW_useVirtualClock();
+  API_Hardware_init();
+  API_Hardware_PowerOn();
+  API_C2_init(400000, CIRQUE_SLAVE_ADDR);
+
+  API_C2_startLatency(&plan, API_Hardware_micros());
+  holdForBus();
+  while(API_C2_latencyRunning())
+  {
+    uint32_t now = API_Hardware_micros();
+    uint8_t packet[PACKET_SIZE];
+
+    stepPad(now);
+    if(API_C2_DR_Asserted())
+    {
+      uint8_t status = API_C2_readReportPacket(packet);
+      holdForBus();
+      if(status == SUCCESS)
+      {
+        reportView_t view;
+        API_C2_viewReport(packet, &view);
+        API_C2_latencyReport(&view, API_Hardware_micros());
+      }
+    }
+    else if(API_C2_latencyDue(now))
+    {
+      API_C2_latencyPoll(now);
+      holdForBus();
+    }
+    SIMHW_advance(1);
+  }
+
+  printf("pad: response %u us, scan %u us; %u presses per run, gaps %u-%u ms\n", model_g.responseUs,
+         model_g.scanUs, plan.iterations, plan.gapMs, plan.gapMs + plan.jitterMs);
+  printf("%-8s %4s %7s %8s %6s %6s %6s %6s %6s %6s | %8s %6s\n", "mode", "kHz", "presses", "timeouts", "min",
+         "mean", "p50", "p90", "p99", "max", "expected", "range");
+  int failures = 0;
+  for(uint8_t r = 0; r < API_C2_latencyRunsDone(); r++)
+  {
+    const latencyRun_t* run = API_C2_getLatencyRun(r);
+    const latencyStats_t* stats = API_C2_getLatencyStats(r);
+    uint32_t low = model_g.responseUs + readUs(run->clockHz);
+    uint32_t expected = low + model_g.scanUs / 2;
+    uint32_t mean = API_C2_latencyMeanUs(stats);
+    int32_t meanError = (int32_t)mean - (int32_t)expected;
+    printf("%-8s %4u %7u %8u %6u %6u %6u %6u %6u %6u | %8u %6u\n", run->absolute ? "absolute" : "relative",
+           run->clockHz / 1000, stats->samples, stats->timeouts + stats->releaseTimeouts, stats->minUs, mean,
+           API_C2_latencyPercentileUs(stats, 500), API_C2_latencyPercentileUs(stats, 900),
+           API_C2_latencyPercentileUs(stats, 990), stats->maxUs, expected, model_g.scanUs);
+    printf("  us:");
+    for(uint16_t b = 0; b < LATENCY_BUCKETS; b++)
+    {
+      if(stats->histogram[b] != 0)
+      {
+        printf(" %u:%u", b * LATENCY_BUCKET_US, stats->histogram[b]);
+      }
+    }
+    printf("\n");
+    if(stats->samples != plan.iterations || stats->timeouts != 0 || stats->releaseTimeouts != 0
+       || stats->minUs + 50 < low || abs(meanError) > (int32_t)(model_g.scanUs / 8 + 50))
+    {
+      failures++;
+    }
+  }
+  if(API_C2_latencyRunsDone() != plan.runCount)
+  {
+    failures++;
+  }
+  return failures == 0 ? 0 : 1;
+}
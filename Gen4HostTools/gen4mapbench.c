@@ -0,0 +1,284 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+/** gen4mapbench - compares the fixed point mapping of API_C2_mapFingers with
+	the single precision floating point mapping a consumer would otherwise
+	write. Both are checked against a double precision reference (largest
+	error in output units, and the same fingers kept) before they are timed.
+
+	The Teensy 3.2's Cortex-M4 has no FPU, so float there is done in software
+	and costs far more than on this host; the host ratio is the lower bound.
+
+	usage: gen4mapbench [-n reports] [-r repeats] */
+
+#define _GNU_SOURCE
+#include <getopt.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "API_C2_Map.h"
+#include "API_C2_Report.h"
+#include "HostSynth.h"
+#include "HostUtil.h"
+
+/************************************************************/
+/************************************************************/
+/******************* REFERENCE MAPPINGS *********************/
+
+/** Maps one pad axis to 0..1 in T precision, or returns false if dropped.
+	Written the way consumers of CRQabsoluteReport_t do it today. */
+#define DEFINE_NORMALIZE(name, T)                                                   \
+  static bool name(const mapConfig_t* config, const uint16_t* table,                \
+                   uint16_t min, uint16_t max, bool invert, uint16_t raw, T* result) \
+  {                                                                                 \
+    T low = (T)(min + config->deadZone), high = (T)(max - config->deadZone);        \
+    T value = (T)raw;                                                               \
+    if(value < low || value > high)                                                 \
+    {                                                                               \
+      if(!config->clip)                                                             \
+      {                                                                             \
+        return false;                                                               \
+      }                                                                             \
+      value = value < low ? low : high;                                             \
+    }                                                                               \
+    value = (value - low) / (high - low);                                           \
+    if(table != NULL)                                                               \
+    {                                                                               \
+      T position = value * (T)(MAP_TABLE_POINTS - 1);                               \
+      int index = (int)position;                                                    \
+      if(index >= MAP_TABLE_POINTS - 1)                                             \
+      {                                                                             \
+        value = (T)table[MAP_TABLE_POINTS - 1] / (T)MAP_UNIT;                       \
+      }                                                                             \
+      else                                                                          \
+      {                                                                             \
+        T fraction = position - (T)index;                                           \
+        value = ((T)table[index] + ((T)table[index + 1] - (T)table[index]) * fraction) \
+                / (T)MAP_UNIT;                                                      \
+      }                                                                             \
+      value = value > (T)1 ? (T)1 : value;                                          \
+    }                                                                               \
+    *result = invert ? (T)1 - value : value;                                        \
+    return true;                                                                    \
+  }
+
+DEFINE_NORMALIZE(normalizeFloat, float)
+DEFINE_NORMALIZE(normalizeDouble, double)
+
+/** Maps every valid finger like API_C2_mapFingers, in T precision, straight
+	from the config. */
+#define DEFINE_MAP(name, normalize, T, ROUND)                                       \
+  static uint8_t name(const mapConfig_t* config, const report_t* report, mappedPoint_t* points) \
+  {                                                                                 \
+    uint8_t count = 0;                                                              \
+    for(uint8_t i = 0; i < 5; i++)                                                  \
+    {                                                                               \
+      const fingerData_t* finger = &report->abs.fingers[i];                         \
+      T x, y, outX, outY;                                                           \
+      if(!API_C2_isFingerContacted((report_t*)report, i)                            \
+         || !API_C2_isFingerValid((report_t*)report, i)                             \
+         || !normalize(config, config->edgeTableX, config->minX, config->maxX,      \
+                       config->invertX, finger->x, &x)                              \
+         || !normalize(config, config->edgeTableY, config->minY, config->maxY,      \
+                       config->invertY, finger->y, &y))                             \
+      {                                                                             \
+        continue;                                                                   \
+      }                                                                             \
+      switch(config->rotation)                                                      \
+      {                                                                             \
+        case MAP_ROTATE_90:  outX = (T)1 - y; outY = x;          break;             \
+        case MAP_ROTATE_180: outX = (T)1 - x; outY = (T)1 - y;   break;             \
+        case MAP_ROTATE_270: outX = y;        outY = (T)1 - x;   break;             \
+        default:             outX = x;        outY = y;          break;             \
+      }                                                                             \
+      points[count].x = (uint16_t)ROUND(outX * (T)(config->width - 1));             \
+      points[count].y = (uint16_t)ROUND(outY * (T)(config->height - 1));            \
+      points[count].finger = i;                                                     \
+      count++;                                                                      \
+    }                                                                               \
+    return count;                                                                   \
+  }
+
+DEFINE_MAP(floatMapFingers, normalizeFloat, float, lrintf)
+DEFINE_MAP(doubleMapFingers, normalizeDouble, double, lrint)
+
+/************************************************************/
+/************************************************************/
+/******************* HELPER FUNCTIONS ***********************/
+
+/** An edge correction curve: the pad reads positions near its edges
+	compressed toward the middle, so the outer 1/8 on each side is stretched. */
+static void makeEdgeTable(uint16_t* table)
+{
+  for(int i = 0; i < MAP_TABLE_POINTS; i++)
+  {
+    double u = (double)i / (MAP_TABLE_POINTS - 1);
+    double v = u + 0.06 * sin(2.0 * M_PI * u);
+    table[i] = (uint16_t)lrint((v < 0 ? 0 : v > 1 ? 1 : v) * MAP_UNIT);
+  }
+}
+
+typedef struct
+{
+  uint32_t fingers;
+  uint32_t mismatches;       /**< Reports where a different set of fingers was kept */
+  uint32_t maxError;         /**< Largest difference from the reference, output units */
+} accuracy_t;
+
+static void compare(const mappedPoint_t* points, uint8_t count,
+                    const mappedPoint_t* reference, uint8_t referenceCount, accuracy_t* accuracy)
+{
+  if(count != referenceCount)
+  {
+    accuracy->mismatches++;
+    return;
+  }
+  for(uint8_t i = 0; i < count; i++)
+  {
+    if(points[i].finger != reference[i].finger)
+    {
+      accuracy->mismatches++;
+      return;
+    }
+    uint32_t dx = (uint32_t)abs((int)points[i].x - (int)reference[i].x);
+    uint32_t dy = (uint32_t)abs((int)points[i].y - (int)reference[i].y);
+    accuracy->maxError = dx > accuracy->maxError ? dx : accuracy->maxError;
+    accuracy->maxError = dy > accuracy->maxError ? dy : accuracy->maxError;
+    accuracy->fingers++;
+  }
+}
+
+static volatile uint32_t sink_g;
+
+static double timeFixed(const mapTransform_t* transform, const report_t* reports, uint32_t count, uint32_t repeats)
+{
+  mappedPoint_t points[5];
+  uint32_t checksum = 0;
+
+  uint64_t start = HOST_nowNs();
+  for(uint32_t r = 0; r < repeats; r++)
+  {
+    for(uint32_t n = 0; n < count; n++)
+    {
+      uint8_t mapped = API_C2_mapFingers(transform, &reports[n], points);
+      checksum += mapped + points[0].x + points[0].y;
+    }
+  }
+  uint64_t elapsed = HOST_nowNs() - start;
+  sink_g = checksum;
+  return (double)elapsed / ((double)count * repeats);
+}
+
+static double timeFloat(const mapConfig_t* config, const report_t* reports, uint32_t count, uint32_t repeats)
+{
+  mappedPoint_t points[5];
+  uint32_t checksum = 0;
+
+  uint64_t start = HOST_nowNs();
+  for(uint32_t r = 0; r < repeats; r++)
+  {
+    for(uint32_t n = 0; n < count; n++)
+    {
+      uint8_t mapped = floatMapFingers(config, &reports[n], points);
+      checksum += mapped + points[0].x + points[0].y;
+    }
+  }
+  uint64_t elapsed = HOST_nowNs() - start;
+  sink_g = checksum;
+  return (double)elapsed / ((double)count * repeats);
+}
+
+/************************************************************/
+/************************************************************/
+/************************** MAIN ****************************/
+
+int main(int argc, char** argv)
+{
+  uint32_t count = 4096, repeats = 200;
+  int opt;
+  while((opt = getopt(argc, argv, "n:r:h")) != -1)
+  {
+    switch(opt)
+    {
+      case 'n': count = (uint32_t)strtoul(optarg, NULL, 0); break;
+      case 'r': repeats = (uint32_t)strtoul(optarg, NULL, 0); break;
+      default:
+        fprintf(stderr, "usage: %s [-n reports] [-r repeats]\n", argv[0]);
+        return 2;
+    }
+  }
+  if(count == 0 || repeats == 0)
+  {
+    return 2;
+  }
+
+  static uint16_t edgeTable[MAP_TABLE_POINTS];
+  makeEdgeTable(edgeTable);
+
+  // Pad range of the synthetic reports (see HostSynth.c)
+  static const struct
+  {
+    const char* name;
+    mapConfig_t config;
+  } maps[] =
+  {
+    { "scale 1920x1080",     { 0, 2047, 0, 1535, 0,   true,  false, false, MAP_ROTATE_0,   1920, 1080, NULL, NULL } },
+    { "rotate 90, invert",   { 0, 2047, 0, 1535, 0,   true,  true,  false, MAP_ROTATE_90,  1080, 1920, NULL, NULL } },
+    { "dead zone, clip",     { 0, 2047, 0, 1535, 64,  true,  false, true,  MAP_ROTATE_180, 3840, 2160, NULL, NULL } },
+    { "dead zone, drop",     { 0, 2047, 0, 1535, 128, false, false, false, MAP_ROTATE_270, 800,  1280, NULL, NULL } },
+    { "edge table",          { 0, 2047, 0, 1535, 32,  true,  false, false, MAP_ROTATE_0,   1920, 1080, edgeTable, edgeTable } },
+    { "16 bit surface",      { 0, 2047, 0, 1535, 0,   true,  false, false, MAP_ROTATE_0,   65535, 65535, NULL, NULL } },
+  };
+
+  // Absolute reports with 1 to 5 fingers moving over the whole pad
+  report_t* reports = malloc((size_t)count * sizeof(report_t));
+  synth_t synth;
+  SYNTH_init(&synth, CRQ_ABSOLUTE_REPORT_ID, 8000, 0);
+  for(uint32_t n = 0; n < count; n++)
+  {
+    uint8_t packet[PACKET_SIZE];
+    SYNTH_nextPacket(&synth, packet);
+    API_C2_decodeReport(packet, &reports[n]);
+  }
+
+  int status = 0;
+  printf("%-20s %10s %10s %8s %10s %10s\n", "map", "fixed ns", "float ns", "ratio", "fixed err", "float err");
+  for(size_t m = 0; m < sizeof(maps) / sizeof(maps[0]); m++)
+  {
+    const mapConfig_t* config = &maps[m].config;
+    mapTransform_t transform;
+    accuracy_t fixed = { 0, 0, 0 }, single = { 0, 0, 0 };
+
+    if(!API_C2_compileMap(config, &transform))
+    {
+      fprintf(stderr, "%s: API_C2_compileMap rejected the config\n", maps[m].name);
+      status = 1;
+      continue;
+    }
+
+    // correctness first
+    for(uint32_t n = 0; n < count; n++)
+    {
+      mappedPoint_t reference[5], points[5];
+      uint8_t referenceCount = doubleMapFingers(config, &reports[n], reference);
+      compare(points, API_C2_mapFingers(&transform, &reports[n], points), reference, referenceCount, &fixed);
+      compare(points, floatMapFingers(config, &reports[n], points), reference, referenceCount, &single);
+    }
+    uint32_t allowed = config->width > 4096 || config->height > 4096 ? 2 : 1;
+    if(fixed.mismatches != 0 || fixed.maxError > allowed)
+    {
+      fprintf(stderr, "%s: fixed point differs from reference (%u reports with other fingers, error %u)\n",
+              maps[m].name, fixed.mismatches, fixed.maxError);
+      status = 1;
+    }
+
+    double fixedNs = timeFixed(&transform, reports, count, repeats);
+    double floatNs = timeFloat(config, reports, count, repeats);
+    printf("%-20s %10.1f %10.1f %7.2fx %10u %10u\n", maps[m].name, fixedNs, floatNs,
+           floatNs / fixedNs, fixed.maxError, single.maxError);
+  }
+
+  free(reports);
+  return status;
+}
@@ -0,0 +1,883 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+/** gen4merge - reads the binary streams of several dev kits at once and
+	merges them into one stream in the order things happened.
+
+	Every board stamps its frames with its own micros(), which started when
+	it powered up and runs a little fast or slow. To put the boards on one
+	time line each is pinged (COMMAND_PING) every -s ms: the response is
+	stamped by the board when it was built, which is taken to be half way
+	between the host sending the ping and reading the response. The pings of
+	the last SYNC_WINDOW exchanges with the shortest round trips are fitted
+	with a line, host time against board time; its slope is the board's
+	drift and it maps every frame's timestamp to the host's monotonic clock.
+	A board that never answers is placed by when its frames arrive instead.
+
+	The frames are then merged, earliest first, from a queue per board of -q
+	frames. A frame goes out once every board has sent something later, so
+	nothing that happened before it can still arrive, or after -w ms, so a
+	quiet board holds the rest up no longer than that. A full queue sends
+	out the earliest frame of all. Frames that arrive after something later
+	went out are sent anyway and counted as late.
+
+	All boards are read with one epoll set. With -S, that many gen4simkit
+	boards are started with random clock offsets and drifts of up to -p ppm,
+	and the estimates are checked against their true clocks: every frame's
+	placement error, and frames merged out of their true order, from when
+	the board's drift is known (SYNC_SPAN_US after it first answers).
+
+	-o writes the merged stream as STREAM_TYPE_MERGED frames, timestamped
+	with the host's monotonic clock in us:
+
+	    board type timestamp[4] payload...
+
+	the board's index on the command line, and the frame type, timestamp and
+	payload as the board sent it. -t writes a line per frame instead.
+
+	usage: gen4merge [-s sync_ms] [-w hold_ms] [-q depth] [-o path] [-t] [-b] [-d seconds]
+	                 [-S boards [-r rate_hz] [-p ppm]] [tty or pty...] */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "API_Command.h"
+#include "API_Stream.h"
+#include "HostCommand.h"
+#include "HostUtil.h"
+
+#define MAX_BOARDS     (64)
+#define READ_CHUNK     (16 * 1024)
+#define SYNC_WINDOW    (64)        /**< Ping exchanges fitted per board */
+#define SYNC_SPAN_US   (2000000)   /**< Board time the pings must span to fit a drift */
+#define SYNC_GIVE_UP   (4)         /**< Unanswered pings before a board is placed by arrival */
+#define MERGED_HEADER  (6)         /**< board type timestamp[4] */
+#define MISORDER_LIMIT_US (1000)   /**< -S fails if a frame is merged this far out of order */
+
+static volatile sig_atomic_t running_g = 1;
+
+static void onSignal(int sig)
+{
+  (void)sig;
+  running_g = 0;
+}
+
+static void usage(const char* argv0)
+{
+  fprintf(stderr,
+          "usage: %s [-s sync_ms] [-w hold_ms] [-q depth] [-o path] [-t] [-b] [-d seconds]\n"
+          "          [-S boards [-r rate_hz] [-p ppm]] [tty or pty...]\n"
+          "  -s  ping each board this often to follow its clock (default 250)\n"
+          "  -w  longest a frame waits for the other boards (default 20)\n"
+          "  -q  frames queued per board (default 256)\n"
+          "  -o  write the merged stream to a file, '-' for stdout\n"
+          "  -t  write a line of text per frame instead of frames\n"
+          "  -b  send 'b' to every board to turn on binary streaming\n"
+          "  -d  exit after this many seconds, 0 to run until interrupted (default 0)\n"
+          "  -S  start this many gen4simkit boards with skewed clocks and check the merge\n"
+          "  -r  reports per second of each simulated board (default 125)\n"
+          "  -p  largest drift of a simulated board's clock in ppm (default 200)\n",
+          argv0);
+}
+
+/************************************************************/
+/************************************************************/
+/******************* DATA STRUCTURES ************************/
+
+/** One ping exchange */
+typedef struct
+{
+  uint64_t boardUs;       /**< Response timestamp, unwrapped */
+  uint64_t hostNs;        /**< Half way through the round trip */
+  uint64_t rttNs;
+} syncSample_t;
+
+typedef struct
+{
+  uint64_t hostNs;        /**< When it happened, on the host's clock */
+  uint32_t timestamp;     /**< As the board sent it */
+  uint8_t  type;
+  uint16_t length;
+  uint8_t  payload[STREAM_MAX_PAYLOAD];
+} mergeFrame_t;
+
+typedef struct
+{
+  const char*    path;
+  uint8_t        index;
+  int            fd;
+  bool           open;
+  cmdLink_t      link;            /**< Only for sending pings; responses come through parser */
+  streamParser_t parser;
+
+  /* Clock */
+  uint64_t       boardUs;         /**< Last timestamp seen, unwrapped */
+  bool           seen;
+  syncSample_t   samples[SYNC_WINDOW];
+  uint32_t       sampleCount;
+  bool           fitted;          /**< A ping has been answered */
+  bool           byArrival;       /**< Given up on pings, placed by arrival */
+  double         slope;           /**< Host ns per board us */
+  uint64_t       driftSinceNs;    /**< When the drift was first fitted, 0 until then */
+  uint64_t       baseBoardUs;     /**< A point on the fitted line */
+  uint64_t       baseHostNs;
+  int            pingId;          /**< Ping in flight, -1 for none */
+  uint64_t       pingSentNs;
+  uint64_t       nextSyncNs;
+  uint32_t       unanswered;      /**< Pings in a row with no response */
+  uint64_t       latestNs;        /**< Latest host time of anything this board sent */
+  uint64_t       lastMappedNs;
+
+  /* Queue of frames not merged yet, in board order */
+  mergeFrame_t*  queue;
+  uint64_t*      arrivalNs;
+  uint32_t       head;
+  uint32_t       count;
+  int            heapIndex;       /**< Position in the merge heap, -1 if not in it */
+
+  /* Statistics */
+  uint64_t       frames;
+  uint64_t       merged;
+  uint32_t       syncs;
+  uint32_t       lostSyncs;
+  uint64_t       minRttNs;
+  uint64_t       totalRttNs;
+  uint32_t       late;
+  uint32_t       forced;
+  uint32_t       tooLong;
+
+  /* -S: the true clock, and how far off the frames were placed */
+  pid_t          pid;
+  bool           simulated;
+  uint32_t       trueOffsetUs;
+  int32_t        truePpm;
+  int64_t        minErrorNs;
+  int64_t        maxErrorNs;
+  int64_t        totalErrorNs;
+  uint64_t       scored;          /**< Frames placed with the drift known */
+} board_t;
+
+static board_t boards_g[MAX_BOARDS];
+static uint32_t boardCount_g = 0;
+static uint32_t depth_g = 256;
+
+/** Boards with queued, placed frames, earliest head first */
+static board_t* heap_g[MAX_BOARDS];
+static uint32_t heapCount_g = 0;
+
+static FILE* output_g = NULL;
+static bool text_g = false;
+static uint64_t startNs_g = 0;
+static uint64_t lastMergedNs_g = 0;
+static uint64_t lastTrueNs_g = 0;
+static uint64_t misordered_g = 0;
+static uint64_t worstMisorderNs_g = 0;
+
+/************************************************************/
+/************************************************************/
+/********************** MERGE HEAP **************************/
+
+static uint64_t headNs(const board_t* board)
+{
+  return board->queue[board->head].hostNs;
+}
+
+static void heapSwap(uint32_t a, uint32_t b)
+{
+  board_t* swap = heap_g[a];
+  heap_g[a] = heap_g[b];
+  heap_g[b] = swap;
+  heap_g[a]->heapIndex = (int)a;
+  heap_g[b]->heapIndex = (int)b;
+}
+
+static void heapUp(uint32_t i)
+{
+  while(i > 0 && headNs(heap_g[(i - 1) / 2]) > headNs(heap_g[i]))
+  {
+    heapSwap(i, (i - 1) / 2);
+    i = (i - 1) / 2;
+  }
+}
+
+static void heapDown(uint32_t i)
+{
+  for(;;)
+  {
+    uint32_t least = i, left = 2 * i + 1, right = left + 1;
+    if(left < heapCount_g && headNs(heap_g[left]) < headNs(heap_g[least]))
+    {
+      least = left;
+    }
+    if(right < heapCount_g && headNs(heap_g[right]) < headNs(heap_g[least]))
+    {
+      least = right;
+    }
+    if(least == i)
+    {
+      return;
+    }
+    heapSwap(i, least);
+    i = least;
+  }
+}
+
+static void heapInsert(board_t* board)
+{
+  heap_g[heapCount_g] = board;
+  board->heapIndex = (int)heapCount_g;
+  heapUp(heapCount_g++);
+}
+
+static void heapRemoveTop(void)
+{
+  heap_g[0]->heapIndex = -1;
+  if(--heapCount_g > 0)
+  {
+    heap_g[0] = heap_g[heapCount_g];
+    heap_g[0]->heapIndex = 0;
+    heapDown(0);
+  }
+}
+
+/************************************************************/
+/************************************************************/
+/************************* CLOCKS ***************************/
+
+/** Extends a 32 bit timestamp, which wraps every 71 minutes, to 64 bits.
+	Frames can be stamped a little out of order, so it may step back. */
+static uint64_t unwrap(board_t* board, uint32_t timestamp)
+{
+  if(!board->seen)
+  {
+    board->seen = true;
+    board->boardUs = timestamp;
+    return timestamp;
+  }
+  uint64_t boardUs = board->boardUs + (int64_t)(int32_t)(timestamp - (uint32_t)board->boardUs);
+  if(boardUs > board->boardUs)
+  {
+    board->boardUs = boardUs;
+  }
+  return boardUs;
+}
+
+/** Host time of a board time, on the fitted line */
+static uint64_t boardToHost(const board_t* board, uint64_t boardUs)
+{
+  double boardDelta = (double)(int64_t)(boardUs - board->baseBoardUs);
+  return board->baseHostNs + (uint64_t)(int64_t)(boardDelta * board->slope);
+}
+
+/** Fits the line through the exchanges whose round trips were close to
+	the shortest. A long round trip was held up in one direction or the
+	other, and says less about when the board stamped the response. The
+	drift is only fitted once the exchanges span SYNC_SPAN_US; until then
+	the board's clock is taken to run at the host's rate. */
+static void fitClock(board_t* board)
+{
+  uint64_t minRtt = UINT64_MAX;
+  for(uint32_t i = 0; i < board->sampleCount; i++)
+  {
+    minRtt = board->samples[i].rttNs < minRtt ? board->samples[i].rttNs : minRtt;
+  }
+  uint64_t limit = minRtt + minRtt / 2 + 50000;
+  const syncSample_t* origin = NULL;
+  double n = 0, sumX = 0, sumY = 0, sumXX = 0, sumXY = 0, firstX = 0, lastX = 0;
+  for(uint32_t i = 0; i < board->sampleCount; i++)
+  {
+    const syncSample_t* sample = &board->samples[i];
+    if(sample->rttNs > limit)
+    {
+      continue;
+    }
+    origin = origin ? origin : sample;
+    double x = (double)(int64_t)(sample->boardUs - origin->boardUs);
+    double y = (double)(int64_t)(sample->hostNs - origin->hostNs);
+    firstX = n == 0 || x < firstX ? x : firstX;
+    lastX = n == 0 || x > lastX ? x : lastX;
+    n++;
+    sumX += x;
+    sumY += y;
+    sumXX += x * x;
+    sumXY += x * y;
+  }
+  double meanX = sumX / n, meanY = sumY / n;
+  if(n >= 3 && lastX - firstX >= SYNC_SPAN_US)
+  {
+    board->slope = (sumXY - n * meanX * meanY) / (sumXX - n * meanX * meanX);
+    board->driftSinceNs = board->driftSinceNs ? board->driftSinceNs : origin->hostNs + (uint64_t)(int64_t)lastX * 1000;
+  }
+  else if(!board->fitted)
+  {
+    board->slope = 1000.0;
+  }
+  board->baseBoardUs = origin->boardUs + (uint64_t)(int64_t)meanX;
+  board->baseHostNs = origin->hostNs + (uint64_t)(int64_t)(meanY - (meanX - (double)(int64_t)meanX) * board->slope);
+}
+
+/** Drift in ppm, positive for a board clock that runs fast */
+static double driftPpm(const board_t* board)
+{
+  return board->fitted ? (1000.0 / board->slope - 1.0) * 1e6 : 0.0;
+}
+
+/** What the board's micros() reads now, less the host's monotonic clock
+	in us, both as 32 bit counters */
+static int32_t offsetUs(const board_t* board, uint64_t nowNs)
+{
+  if(!board->fitted)
+  {
+    return 0;
+  }
+  double boardUs = (double)board->baseBoardUs + (double)(int64_t)(nowNs - board->baseHostNs) / board->slope;
+  return (int32_t)((uint32_t)(uint64_t)boardUs - (uint32_t)(nowNs / 1000));
+}
+
+/** The host time a simulated board's timestamp was really taken at:
+	gen4simkit's micros() is its offset plus the host's monotonic clock
+	plus the drift (SIMHW_setClock). Solved near the estimate. */
+static uint64_t trueHostNs(const board_t* board, uint32_t timestamp, uint64_t estimateNs)
+{
+  uint64_t us = estimateNs / 1000;
+  uint32_t predicted = (uint32_t)(board->trueOffsetUs + us + (uint64_t)((int64_t)us * board->truePpm / 1000000));
+  int32_t difference = (int32_t)(timestamp - predicted);
+  return us * 1000 + (uint64_t)((int64_t)difference * 1000000000ll / (1000000 + board->truePpm));
+}
+
+/************************************************************/
+/************************************************************/
+/************************* OUTPUT ***************************/
+
+static void writeFrame(const board_t* board, const mergeFrame_t* frame)
+{
+  if(output_g == NULL)
+  {
+    return;
+  }
+  uint64_t us = frame->hostNs / 1000;
+  if(text_g)
+  {
+    fprintf(output_g, "%llu.%06llu %u 0x%02X %u %lu\n", (unsigned long long)(us / 1000000),
+            (unsigned long long)(us % 1000000), board->index, frame->type, frame->length,
+            (unsigned long)frame->timestamp);
+    return;
+  }
+  uint8_t payload[STREAM_MAX_PAYLOAD];
+  uint8_t data[STREAM_MAX_FRAME];
+  payload[0] = board->index;
+  payload[1] = frame->type;
+  payload[2] = (uint8_t)(frame->timestamp & 0xFF);
+  payload[3] = (uint8_t)((frame->timestamp >> 8) & 0xFF);
+  payload[4] = (uint8_t)((frame->timestamp >> 16) & 0xFF);
+  payload[5] = (uint8_t)((frame->timestamp >> 24) & 0xFF);
+  memcpy(payload + MERGED_HEADER, frame->payload, frame->length);
+  uint16_t length = API_Stream_encodeFrame(STREAM_TYPE_MERGED, (uint32_t)us, payload,
+                                           (uint16_t)(MERGED_HEADER + frame->length), data);
+  fwrite(data, 1, length, output_g);
+}
+
+/** Sends out the earliest queued frame of all */
+static void mergeOne(void)
+{
+  board_t* board = heap_g[0];
+  const mergeFrame_t* frame = &board->queue[board->head];
+
+  bool late = frame->hostNs < lastMergedNs_g;
+  if(late)
+  {
+    board->late++;
+  }
+  else
+  {
+    lastMergedNs_g = frame->hostNs;
+  }
+  // frames placed before the drift was known are off by up to SYNC_SPAN_US of it
+  if(board->simulated && board->driftSinceNs && frame->hostNs >= board->driftSinceNs)
+  {
+    uint64_t trueNs = trueHostNs(board, frame->timestamp, frame->hostNs);
+    int64_t error = (int64_t)(frame->hostNs - trueNs);
+    board->minErrorNs = board->scored == 0 || error < board->minErrorNs ? error : board->minErrorNs;
+    board->maxErrorNs = board->scored == 0 || error > board->maxErrorNs ? error : board->maxErrorNs;
+    board->totalErrorNs += error;
+    board->scored++;
+    // late frames are out of order however well they were placed
+    if(!late && trueNs < lastTrueNs_g)
+    {
+      misordered_g++;
+      worstMisorderNs_g = lastTrueNs_g - trueNs > worstMisorderNs_g ? lastTrueNs_g - trueNs : worstMisorderNs_g;
+    }
+    else if(!late)
+    {
+      lastTrueNs_g = trueNs;
+    }
+  }
+  writeFrame(board, frame);
+  board->merged++;
+  board->head = (board->head + 1) % depth_g;
+  board->count--;
+  if(board->count > 0)
+  {
+    heapDown(0);
+  }
+  else
+  {
+    heapRemoveTop();
+  }
+}
+
+/** Sends out every frame nothing earlier can still arrive for: up to the
+	latest time every open board has reached, and anything held holdNs. */
+static void mergeReady(uint64_t nowNs, uint64_t holdNs, bool all)
+{
+  uint64_t watermark = UINT64_MAX;
+  for(uint32_t i = 0; i < boardCount_g; i++)
+  {
+    const board_t* board = &boards_g[i];
+    if(!board->open)
+    {
+      continue;
+    }
+    // a board whose clock is not known yet could still send anything
+    uint64_t reached = board->fitted || board->byArrival ? board->latestNs : 0;
+    watermark = reached < watermark ? reached : watermark;
+  }
+  while(heapCount_g > 0 && (all || headNs(heap_g[0]) <= watermark || headNs(heap_g[0]) + holdNs <= nowNs))
+  {
+    mergeOne();
+  }
+}
+
+/************************************************************/
+/************************************************************/
+/************************* BOARDS ***************************/
+
+static void placeFrame(board_t* board, mergeFrame_t* frame, uint64_t arrivalNs)
+{
+  uint64_t hostNs = board->fitted ? boardToHost(board, unwrap(board, frame->timestamp)) : arrivalNs;
+  frame->hostNs = hostNs > board->lastMappedNs ? hostNs : board->lastMappedNs;
+  board->lastMappedNs = frame->hostNs;
+}
+
+/** Places the frames that were queued while the board's clock was unknown */
+static void placeQueue(board_t* board)
+{
+  for(uint32_t i = 0; i < board->count; i++)
+  {
+    uint32_t slot = (board->head + i) % depth_g;
+    placeFrame(board, &board->queue[slot], board->arrivalNs[slot]);
+  }
+  if(board->count > 0 && board->heapIndex < 0)
+  {
+    heapInsert(board);
+  }
+}
+
+static void queueFrame(board_t* board, const streamFrame_t* frame, uint64_t nowNs)
+{
+  if(frame->length > STREAM_MAX_PAYLOAD - MERGED_HEADER)
+  {
+    board->tooLong++;
+    return;
+  }
+  while(board->count == depth_g)
+  {
+    if(heapCount_g == 0)
+    {
+      // queued before the clock is known; place it by arrival after all
+      board->byArrival = true;
+      placeQueue(board);
+    }
+    heap_g[0]->forced++;
+    mergeOne();
+  }
+  uint32_t slot = (board->head + board->count) % depth_g;
+  mergeFrame_t* queued = &board->queue[slot];
+  queued->timestamp = frame->timestamp;
+  queued->type = frame->type;
+  queued->length = frame->length;
+  memcpy(queued->payload, frame->payload, frame->length);
+  board->arrivalNs[slot] = nowNs;
+  board->count++;
+  board->frames++;
+  if(!board->fitted && !board->byArrival)
+  {
+    unwrap(board, frame->timestamp);
+    return;
+  }
+  placeFrame(board, queued, nowNs);
+  board->latestNs = queued->hostNs > board->latestNs ? queued->hostNs : board->latestNs;
+  if(board->heapIndex < 0)
+  {
+    heapInsert(board);
+  }
+}
+
+static void addSample(board_t* board, uint32_t timestamp, uint64_t nowNs)
+{
+  syncSample_t sample = { unwrap(board, timestamp), board->pingSentNs + (nowNs - board->pingSentNs) / 2,
+                          nowNs - board->pingSentNs };
+  if(board->sampleCount < SYNC_WINDOW)
+  {
+    board->samples[board->sampleCount++] = sample;
+  }
+  else
+  {
+    memmove(&board->samples[0], &board->samples[1], sizeof(syncSample_t) * (SYNC_WINDOW - 1));
+    board->samples[SYNC_WINDOW - 1] = sample;
+  }
+  board->syncs++;
+  board->unanswered = 0;
+  board->minRttNs = board->syncs == 1 || sample.rttNs < board->minRttNs ? sample.rttNs : board->minRttNs;
+  board->totalRttNs += sample.rttNs;
+  fitClock(board);
+  if(!board->fitted)
+  {
+    board->fitted = true;
+    board->byArrival = false;
+    placeQueue(board);
+  }
+  uint64_t hostNs = boardToHost(board, sample.boardUs);
+  board->latestNs = hostNs > board->latestNs ? hostNs : board->latestNs;
+  board->pingId = -1;
+}
+
+static void sendPing(board_t* board, uint64_t nowNs, uint32_t syncMs)
+{
+  if(board->pingId >= 0)
+  {
+    board->lostSyncs++;
+    if(++board->unanswered >= SYNC_GIVE_UP && !board->fitted && !board->byArrival)
+    {
+      board->byArrival = true;
+      placeQueue(board);
+    }
+  }
+  board->pingSentNs = HOST_nowNs();
+  board->pingId = CMDLINK_send(&board->link, COMMAND_PING, NULL, 0);
+  board->nextSyncNs = nowNs + syncMs * 1000000ull;
+}
+
+static void closeBoard(board_t* board, int epoll)
+{
+  epoll_ctl(epoll, EPOLL_CTL_DEL, board->fd, NULL);
+  close(board->fd);
+  board->open = false;
+  if(!board->fitted && !board->byArrival)
+  {
+    board->byArrival = true;
+    placeQueue(board);
+  }
+}
+
+static void readBoard(board_t* board, int epoll, uint64_t nowNs)
+{
+  static uint8_t buffer[READ_CHUNK];
+  ssize_t count = read(board->fd, buffer, sizeof(buffer));
+  if(count <= 0)
+  {
+    if(count < 0 && (errno == EINTR || errno == EAGAIN))
+    {
+      return;
+    }
+    // EOF, or EIO once the board or pty writer goes away
+    fprintf(stderr, "%s: input closed\n", board->path);
+    closeBoard(board, epoll);
+    return;
+  }
+  for(ssize_t i = 0; i < count; i++)
+  {
+    if(!API_Stream_parseByte(&board->parser, buffer[i]))
+    {
+      continue;
+    }
+    const streamFrame_t* frame = &board->parser.frame;
+    if(frame->type == STREAM_TYPE_RESPONSE && frame->length >= COMMAND_RESPONSE_HEADER
+       && frame->payload[2] == COMMAND_PING)
+    {
+      if(board->pingId >= 0 && (frame->payload[0] | (frame->payload[1] << 8)) == board->pingId)
+      {
+        addSample(board, frame->timestamp, nowNs);
+      }
+      continue;
+    }
+    queueFrame(board, frame, nowNs);
+  }
+}
+
+static int openBoard(board_t* board, const char* path, uint8_t index, int epoll, bool enableStream)
+{
+  memset(board, 0, sizeof(*board));
+  board->path = path;
+  board->index = index;
+  board->pingId = -1;
+  board->heapIndex = -1;
+  board->queue = malloc(sizeof(mergeFrame_t) * depth_g);
+  board->arrivalNs = malloc(sizeof(uint64_t) * depth_g);
+  board->fd = HOST_openSerial(path);
+  if(board->fd < 0 || board->queue == NULL || board->arrivalNs == NULL)
+  {
+    fprintf(stderr, "%s: %s\n", path, strerror(errno));
+    return -1;
+  }
+  struct epoll_event event = { EPOLLIN, { .ptr = board } };
+  if(epoll_ctl(epoll, EPOLL_CTL_ADD, board->fd, &event) != 0)
+  {
+    fprintf(stderr, "%s: %s\n", path, strerror(errno));
+    return -1;
+  }
+  CMDLINK_init(&board->link, board->fd);
+  API_Stream_initParser(&board->parser);
+  board->open = true;
+  if(enableStream && HOST_writeAll(board->fd, "b", 1) != 0)
+  {
+    fprintf(stderr, "%s: %s\n", path, strerror(errno));
+  }
+  return 0;
+}
+
+/** Starts a gen4simkit whose clock is offsetUs and driftPpm off the host's,
+	and copies the path of its pty into path. Returns its pid or -1. */
+static pid_t startSimKit(const char* program, uint32_t rate, uint32_t offsetUs, int32_t driftPpm,
+                         char* path, size_t size)
+{
+  char rateArg[16], offsetArg[16], driftArg[16];
+  int pipeFds[2];
+  snprintf(rateArg, sizeof(rateArg), "%u", rate);
+  snprintf(offsetArg, sizeof(offsetArg), "%u", offsetUs);
+  snprintf(driftArg, sizeof(driftArg), "%d", driftPpm);
+  if(pipe2(pipeFds, O_CLOEXEC) != 0)
+  {
+    return -1;
+  }
+  pid_t pid = fork();
+  if(pid == 0)
+  {
+    dup2(pipeFds[1], STDOUT_FILENO);
+    execl(program, program, "-b", "-r", rateArg, "-o", offsetArg, "-p", driftArg, (char*)NULL);
+    _exit(127);
+  }
+  close(pipeFds[1]);
+  FILE* in = fdopen(pipeFds[0], "r");
+  if(pid < 0 || in == NULL || fgets(path, (int)size, in) == NULL)
+  {
+    fprintf(stderr, "%s: did not start\n", program);
+    if(in != NULL)
+    {
+      fclose(in);
+    }
+    return -1;
+  }
+  fclose(in);
+  path[strcspn(path, "\n")] = '\0';
+  return pid;
+}
+
+/************************************************************/
+/************************************************************/
+/************************** MAIN ****************************/
+
+static void printBoards(uint64_t nowNs, bool simulated)
+{
+  fprintf(stderr, "%-5s %-14s %8s %8s %5s %4s %8s %8s %9s %12s %5s %6s %4s", "board", "path", "frames",
+          "merged", "syncs", "lost", "rtt min", "rtt avg", "drift ppm", "offset us", "late", "forced", "long");
+  fprintf(stderr, simulated ? " | %9s %12s %8s %8s %8s\n" : "\n", "true ppm", "true offset", "err min", "err avg",
+          "err max");
+  for(uint32_t i = 0; i < boardCount_g; i++)
+  {
+    const board_t* board = &boards_g[i];
+    fprintf(stderr, "%-5u %-14s %8llu %8llu %5u %4u %8.0f %8.0f %9.1f %12d %5u %6u %4u", board->index,
+            board->path, (unsigned long long)board->frames, (unsigned long long)board->merged, board->syncs,
+            board->lostSyncs, (double)board->minRttNs / 1000,
+            board->syncs ? (double)board->totalRttNs / board->syncs / 1000 : 0.0, driftPpm(board),
+            offsetUs(board, nowNs), board->late, board->forced, board->tooLong);
+    if(!simulated)
+    {
+      fprintf(stderr, board->byArrival ? " (by arrival)\n" : "\n");
+      continue;
+    }
+    uint64_t nowUs = nowNs / 1000;
+    uint32_t trueUs = (uint32_t)(board->trueOffsetUs + nowUs + (uint64_t)((int64_t)nowUs * board->truePpm / 1000000));
+    fprintf(stderr, " | %9d %12d %8.0f %8.0f %8.0f\n", board->truePpm, (int32_t)(trueUs - (uint32_t)nowUs),
+            (double)board->minErrorNs / 1000,
+            board->scored ? (double)board->totalErrorNs / (double)board->scored / 1000 : 0.0,
+            (double)board->maxErrorNs / 1000);
+  }
+}
+
+int main(int argc, char** argv)
+{
+  uint32_t syncMs = 250, holdMs = 20, seconds = 0, simulate = 0, rate = 125, maxPpm = 200;
+  const char* outputPath = NULL;
+  bool enableStream = false;
+  int opt;
+
+  while((opt = getopt(argc, argv, "s:w:q:o:tbd:S:r:p:h")) != -1)
+  {
+    switch(opt)
+    {
+      case 's': syncMs = (uint32_t)strtoul(optarg, NULL, 0); break;
+      case 'w': holdMs = (uint32_t)strtoul(optarg, NULL, 0); break;
+      case 'q': depth_g = (uint32_t)strtoul(optarg, NULL, 0); break;
+      case 'o': outputPath = optarg; break;
+      case 't': text_g = true; break;
+      case 'b': enableStream = true; break;
+      case 'd': seconds = (uint32_t)strtoul(optarg, NULL, 0); break;
+      case 'S': simulate = (uint32_t)strtoul(optarg, NULL, 0); break;
+      case 'r': rate = (uint32_t)strtoul(optarg, NULL, 0); break;
+      case 'p': maxPpm = (uint32_t)strtoul(optarg, NULL, 0); break;
+      default: usage(argv[0]); return 2;
+    }
+  }
+  uint32_t total = simulate + (uint32_t)(argc - optind);
+  if(total == 0 || total > MAX_BOARDS || syncMs == 0 || depth_g == 0)
+  {
+    usage(argv[0]);
+    return 2;
+  }
+  if(outputPath != NULL)
+  {
+    output_g = strcmp(outputPath, "-") == 0 ? stdout : fopen(outputPath, "wb");
+    if(output_g == NULL)
+    {
+      perror(outputPath);
+      return 1;
+    }
+  }
+
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = onSignal;
+  sigaction(SIGINT, &sa, NULL);
+  sigaction(SIGTERM, &sa, NULL);
+  signal(SIGPIPE, SIG_IGN);
+
+  int epoll = epoll_create1(EPOLL_CLOEXEC);
+  if(epoll < 0)
+  {
+    perror("epoll");
+    return 1;
+  }
+
+  static char simPaths[MAX_BOARDS][64];
+  char program[4096];
+  const char* slash = strrchr(argv[0], '/');
+  snprintf(program, sizeof(program), "%.*sgen4simkit", slash ? (int)(slash - argv[0] + 1) : 0, argv[0]);
+  unsigned int seed = 1;
+  int status = 0;
+  for(uint32_t i = 0; i < total && status == 0; i++)
+  {
+    board_t* board = &boards_g[i];
+    const char* path = argv[optind + (int)i - (int)simulate];
+    uint32_t trueOffsetUs = 0;
+    int32_t truePpm = 0;
+    pid_t pid = 0;
+    if(i < simulate)
+    {
+      trueOffsetUs = ((uint32_t)rand_r(&seed) << 16) ^ (uint32_t)rand_r(&seed);
+      truePpm = maxPpm ? (int32_t)(rand_r(&seed) % (2 * maxPpm + 1)) - (int32_t)maxPpm : 0;
+      pid = startSimKit(program, rate, trueOffsetUs, truePpm, simPaths[i], sizeof(simPaths[i]));
+      path = simPaths[i];
+    }
+    if(pid < 0 || openBoard(board, path, (uint8_t)i, epoll, enableStream) != 0)
+    {
+      status = 1;
+    }
+    board->pid = pid;
+    board->simulated = i < simulate;
+    board->trueOffsetUs = trueOffsetUs;
+    board->truePpm = truePpm;
+    boardCount_g = i + 1;
+  }
+
+  startNs_g = HOST_nowNs();
+  uint64_t holdNs = holdMs * 1000000ull;
+  static struct epoll_event events[MAX_BOARDS];
+  uint32_t openBoards = boardCount_g;
+  while(status == 0 && running_g && openBoards > 0
+        && (seconds == 0 || HOST_nowNs() - startNs_g < seconds * 1000000000ull))
+  {
+    uint64_t now = HOST_nowNs();
+    uint64_t wake = now + 100000000ull;
+    openBoards = 0;
+    for(uint32_t i = 0; i < boardCount_g; i++)
+    {
+      board_t* board = &boards_g[i];
+      if(!board->open)
+      {
+        continue;
+      }
+      openBoards++;
+      if(now >= board->nextSyncNs)
+      {
+        sendPing(board, now, syncMs);
+      }
+      wake = board->nextSyncNs < wake ? board->nextSyncNs : wake;
+    }
+    if(heapCount_g > 0 && headNs(heap_g[0]) + holdNs < wake)
+    {
+      wake = headNs(heap_g[0]) + holdNs;
+    }
+    int timeoutMs = wake > now ? (int)((wake - now + 999999) / 1000000) : 0;
+    int ready = epoll_wait(epoll, events, MAX_BOARDS, timeoutMs);
+    if(ready < 0 && errno != EINTR)
+    {
+      perror("epoll_wait");
+      status = 1;
+      break;
+    }
+    now = HOST_nowNs();
+    for(int i = 0; i < ready; i++)
+    {
+      readBoard((board_t*)events[i].data.ptr, epoll, now);
+    }
+    mergeReady(now, holdNs, false);
+    if(output_g != NULL)
+    {
+      fflush(output_g);
+    }
+  }
+  mergeReady(HOST_nowNs(), holdNs, true);
+
+  uint64_t frames = 0, merged = 0, late = 0;
+  for(uint32_t i = 0; i < boardCount_g; i++)
+  {
+    board_t* board = &boards_g[i];
+    frames += board->frames;
+    merged += board->merged;
+    late += board->late;
+    if(board->pid > 0)
+    {
+      // it may be blocked writing to a pty no one reads any more
+      kill(board->pid, SIGKILL);
+      waitpid(board->pid, NULL, 0);
+    }
+  }
+  printBoards(HOST_nowNs(), simulate > 0);
+  fprintf(stderr, "%u boards: %llu frames, %llu merged, %llu late; %.0f KB of queues\n",
+          boardCount_g, (unsigned long long)frames, (unsigned long long)merged, (unsigned long long)late,
+          (double)sizeof(mergeFrame_t) * depth_g * boardCount_g / 1024.0);
+  if(simulate > 0)
+  {
+    fprintf(stderr, "true order: %llu frames merged out of order (not counting late ones), worst by %.0f us\n",
+            (unsigned long long)misordered_g, (double)worstMisorderNs_g / 1000);
+    if(worstMisorderNs_g > MISORDER_LIMIT_US * 1000ull)
+    {
+      status = 1;
+    }
+  }
+  if(output_g != NULL && output_g != stdout)
+  {
+    fclose(output_g);
+  }
+  close(epoll);
+  return status;
+}
@@ -0,0 +1,840 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+/** gen4py - Python extension module "gen4": batch decoding of report
+	captures and live streams with the dev kit's own decoder
+	(API_C2_decodeReport), handed to Python as columns rather than objects.
+
+	A Batch holds the reports of one load, decode or read as one C array
+	per field (timestamps, report IDs, finger positions, ...). Each column
+	is an Array, which exports its memory through the buffer protocol, so
+	numpy.asarray(batch.x) or memoryview(batch.x) is a view of the decoded
+	data, not a copy. No Python object is made per report, and the decoding
+	runs with the GIL released.
+
+	    import gen4, numpy as np
+	    batch = gen4.load("capture.bin")       # or gen4.decode(bytes)
+	    x = np.asarray(batch.x)                 # shape (len(batch), 5), uint16
+	    with gen4.Stream("/dev/ttyACM0", binary=True) as stream:
+	        live = stream.read(1000, timeout_ms=2000)
+
+	Columns (one row per report; fields that do not apply to a report's
+	kind are zero):
+	    timestamp      uint32   board micros() when the frame was built
+	    report_id      uint8
+	    kind           uint8    REPORT_KIND_ (0 none, 1 mouse, 2 keyboard, 3 absolute)
+	    buttons        uint8    mouse and absolute
+	    contact_flags  uint8    absolute
+	    x, y           uint16   absolute, 5 fingers per row
+	    palm           uint8    absolute, 5 fingers per row
+	    dx, dy, scroll, pan  int8  mouse
+	    modifier       uint8    keyboard
+	    keycode        uint8    keyboard, 6 per row */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <structmember.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "API_C2_Report.h"
+#include "API_Stream.h"
+#include "HostUtil.h"
+
+#define FINGERS          (5)
+#define KEYCODES         (6)
+#define FIRST_CAPACITY   (4096)
+#define STREAM_READ_SIZE (4096)
+
+enum
+{
+  COLUMN_TIMESTAMP,
+  COLUMN_REPORT_ID,
+  COLUMN_KIND,
+  COLUMN_BUTTONS,
+  COLUMN_CONTACT_FLAGS,
+  COLUMN_X,
+  COLUMN_Y,
+  COLUMN_PALM,
+  COLUMN_DX,
+  COLUMN_DY,
+  COLUMN_SCROLL,
+  COLUMN_PAN,
+  COLUMN_MODIFIER,
+  COLUMN_KEYCODE,
+  COLUMN_COUNT
+};
+
+/** What one column holds */
+typedef struct
+{
+  const char* name;
+  const char* format;     /**< struct module code, as the buffer protocol wants it */
+  uint8_t     itemSize;
+  uint8_t     width;      /**< Values per report; more than one makes the column 2-D */
+  const char* doc;
+} columnInfo_t;
+
+static const columnInfo_t _columns[COLUMN_COUNT] =
+{
+  { "timestamp",     "I", 4, 1,        "board micros() when the frame was built" },
+  { "report_id",     "B", 1, 1,        "report ID" },
+  { "kind",          "B", 1, 1,        "REPORT_KIND_ of the report ID" },
+  { "buttons",       "B", 1, 1,        "button bitmap (mouse, absolute)" },
+  { "contact_flags", "B", 1, 1,        "bitmap of contacted fingers (absolute)" },
+  { "x",             "H", 2, FINGERS,  "finger X positions (absolute)" },
+  { "y",             "H", 2, FINGERS,  "finger Y positions (absolute)" },
+  { "palm",          "B", 1, FINGERS,  "finger palm and confidence bits (absolute)" },
+  { "dx",            "b", 1, 1,        "X movement (mouse)" },
+  { "dy",            "b", 1, 1,        "Y movement (mouse)" },
+  { "scroll",        "b", 1, 1,        "vertical scroll (mouse)" },
+  { "pan",           "b", 1, 1,        "horizontal scroll (mouse)" },
+  { "modifier",      "B", 1, 1,        "modifier keys (keyboard)" },
+  { "keycode",       "B", 1, KEYCODES, "keycodes (keyboard)" },
+};
+
+/** Decoded reports, one array per column, and what was passed over */
+typedef struct
+{
+  uint8_t*           data[COLUMN_COUNT];
+  Py_ssize_t         count;
+  Py_ssize_t         capacity;
+  unsigned long long frames;        /**< Valid frames of any type */
+  unsigned long long badFrames;     /**< Sync found but length or checksum wrong */
+  unsigned long long skippedBytes;  /**< Menu text and the like */
+} columns_t;
+
+/************************************************************/
+/************************************************************/
+/******************* HELPER FUNCTIONS ***********************/
+
+static void freeColumns(columns_t* columns)
+{
+  for(int i = 0; i < COLUMN_COUNT; i++)
+  {
+    free(columns->data[i]);
+    columns->data[i] = NULL;
+  }
+  columns->count = columns->capacity = 0;
+}
+
+/** Makes room for at least capacity reports, doubling. false if out of
+	memory. */
+static bool growColumns(columns_t* columns, Py_ssize_t capacity)
+{
+  if(capacity <= columns->capacity)
+  {
+    return true;
+  }
+  if(capacity < columns->capacity * 2)
+  {
+    capacity = columns->capacity * 2;
+  }
+  if(capacity < FIRST_CAPACITY)
+  {
+    capacity = FIRST_CAPACITY;
+  }
+  for(int i = 0; i < COLUMN_COUNT; i++)
+  {
+    uint8_t* data = realloc(columns->data[i], (size_t)capacity * _columns[i].itemSize * _columns[i].width);
+    if(data == NULL)
+    {
+      return false;
+    }
+    columns->data[i] = data;
+  }
+  columns->capacity = capacity;
+  return true;
+}
+
+/** Decodes the payload of a report frame into the next row. false if out
+	of memory. */
+static bool addReport(columns_t* columns, uint32_t timestamp, const uint8_t* payload, uint16_t length)
+{
+  uint8_t packet[PACKET_SIZE];
+  report_t report;
+
+  if(!growColumns(columns, columns->count + 1))
+  {
+    return false;
+  }
+  memcpy(packet, payload, length < PACKET_SIZE ? length : PACKET_SIZE);
+  if(length < PACKET_SIZE)
+  {
+    memset(packet + length, 0, PACKET_SIZE - length);
+  }
+  API_C2_decodeReport(packet, &report);
+  uint8_t kind = API_C2_getReportKind(report.reportID);
+
+  Py_ssize_t n = columns->count++;
+  uint8_t** data = columns->data;
+  ((uint32_t*)data[COLUMN_TIMESTAMP])[n] = timestamp;
+  data[COLUMN_REPORT_ID][n] = report.reportID;
+  data[COLUMN_KIND][n] = kind;
+  data[COLUMN_BUTTONS][n] = kind == REPORT_KIND_ABSOLUTE ? report.abs.buttons
+                          : kind == REPORT_KIND_MOUSE ? report.mouse.buttons : 0;
+  data[COLUMN_CONTACT_FLAGS][n] = kind == REPORT_KIND_ABSOLUTE ? report.abs.contactFlags : 0;
+  for(int i = 0; i < FINGERS; i++)
+  {
+    bool absolute = kind == REPORT_KIND_ABSOLUTE;
+    ((uint16_t*)data[COLUMN_X])[n * FINGERS + i] = absolute ? report.abs.fingers[i].x : 0;
+    ((uint16_t*)data[COLUMN_Y])[n * FINGERS + i] = absolute ? report.abs.fingers[i].y : 0;
+    data[COLUMN_PALM][n * FINGERS + i] = absolute ? report.abs.fingers[i].palm : 0;
+  }
+  bool mouse = kind == REPORT_KIND_MOUSE;
+  data[COLUMN_DX][n] = mouse ? (uint8_t)report.mouse.xDelta : 0;
+  data[COLUMN_DY][n] = mouse ? (uint8_t)report.mouse.yDelta : 0;
+  data[COLUMN_SCROLL][n] = mouse ? (uint8_t)report.mouse.scrollDelta : 0;
+  data[COLUMN_PAN][n] = mouse ? (uint8_t)report.mouse.panDelta : 0;
+  bool keyboard = kind == REPORT_KIND_KEYBOARD;
+  data[COLUMN_MODIFIER][n] = keyboard ? report.keyboard.modifier : 0;
+  for(int i = 0; i < KEYCODES; i++)
+  {
+    data[COLUMN_KEYCODE][n * KEYCODES + i] = keyboard ? report.keyboard.keycode[i] : 0;
+  }
+  return true;
+}
+
+/** Returns the size of the valid frame starting at offset, or 0. */
+static size_t frameAt(const uint8_t* data, size_t size, size_t offset)
+{
+  if(size - offset < STREAM_OVERHEAD || data[offset] != STREAM_SYNC_0 || data[offset + 1] != STREAM_SYNC_1)
+  {
+    return 0;
+  }
+  uint16_t length = data[offset + 3] | (data[offset + 4] << 8);
+  if(length > STREAM_MAX_PAYLOAD || size - offset < (size_t)length + STREAM_OVERHEAD)
+  {
+    return 0;
+  }
+  uint8_t checksum = 0;
+  const uint8_t* iter = &data[offset + 2];
+  const uint8_t* end = &data[offset + STREAM_HEADER_SIZE + length];
+  while(iter < end)
+  {
+    checksum += *iter++;
+  }
+  return *end == checksum ? (size_t)length + STREAM_OVERHEAD : 0;
+}
+
+/** Decodes the report frames of a whole capture. Walks it the way
+	gen4analyze does, retrying one byte later after anything that is not a
+	valid frame. false if out of memory. Called without the GIL. */
+static bool decodeCapture(columns_t* columns, const uint8_t* data, size_t size)
+{
+  size_t offset = 0;
+
+  // sized for absolute reports, the largest; smaller ones grow it once or twice
+  if(!growColumns(columns, (Py_ssize_t)(size / (PACKET_SIZE + STREAM_OVERHEAD))))
+  {
+    return false;
+  }
+  while(offset < size)
+  {
+    size_t frameSize = frameAt(data, size, offset);
+    if(frameSize == 0)
+    {
+      if(data[offset] == STREAM_SYNC_0 && offset + 1 < size && data[offset + 1] == STREAM_SYNC_1)
+      {
+        columns->badFrames++;
+      }
+      else
+      {
+        columns->skippedBytes++;
+      }
+      offset++;
+      continue;
+    }
+    columns->frames++;
+    const uint8_t* payload = &data[offset + STREAM_HEADER_SIZE];
+    uint16_t length = payload[-6] | (payload[-5] << 8);
+    if(data[offset + 2] == STREAM_TYPE_REPORT && length >= 3)
+    {
+      uint32_t timestamp = payload[-4] | (payload[-3] << 8) | (payload[-2] << 16) | ((uint32_t)payload[-1] << 24);
+      if(!addReport(columns, timestamp, payload, length))
+      {
+        return false;
+      }
+    }
+    offset += frameSize;
+  }
+  return true;
+}
+
+/************************************************************/
+/************************************************************/
+/************************** Array **************************/
+
+/** One column of a Batch, exported through the buffer protocol */
+typedef struct
+{
+  PyObject_HEAD
+  PyObject*  owner;       /**< The Batch, kept alive while the column is */
+  void*      data;
+  int        column;
+  int        ndim;
+  Py_ssize_t shape[2];
+  Py_ssize_t strides[2];
+} arrayObject_t;
+
+static uint8_t _empty[8];
+
+static int arrayGetBuffer(PyObject* self, Py_buffer* view, int flags)
+{
+  arrayObject_t* array = (arrayObject_t*)self;
+  const columnInfo_t* info = &_columns[array->column];
+
+  if(flags & PyBUF_WRITABLE)
+  {
+    PyErr_SetString(PyExc_BufferError, "gen4 arrays are read-only");
+    return -1;
+  }
+  view->buf = array->data != NULL ? array->data : _empty;
+  view->obj = Py_NewRef(self);
+  view->len = array->shape[0] * (array->ndim > 1 ? array->shape[1] : 1) * info->itemSize;
+  view->readonly = 1;
+  view->itemsize = info->itemSize;
+  view->format = (flags & PyBUF_FORMAT) ? (char*)info->format : NULL;
+  view->ndim = array->ndim;
+  view->shape = (flags & PyBUF_ND) ? array->shape : NULL;
+  view->strides = (flags & PyBUF_STRIDES) == PyBUF_STRIDES ? array->strides : NULL;
+  view->suboffsets = NULL;
+  view->internal = NULL;
+  return 0;
+}
+
+static void arrayDealloc(PyObject* self)
+{
+  Py_XDECREF(((arrayObject_t*)self)->owner);
+  Py_TYPE(self)->tp_free(self);
+}
+
+static Py_ssize_t arrayLength(PyObject* self)
+{
+  return ((arrayObject_t*)self)->shape[0];
+}
+
+static PyObject* arrayRepr(PyObject* self)
+{
+  arrayObject_t* array = (arrayObject_t*)self;
+  const columnInfo_t* info = &_columns[array->column];
+  if(array->ndim > 1)
+  {
+    return PyUnicode_FromFormat("<gen4.Array %s '%s' (%zd, %zd)>", info->name, info->format,
+                                array->shape[0], array->shape[1]);
+  }
+  return PyUnicode_FromFormat("<gen4.Array %s '%s' (%zd,)>", info->name, info->format, array->shape[0]);
+}
+
+static PyBufferProcs _arrayBuffer = { arrayGetBuffer, NULL };
+
+static PySequenceMethods _arraySequence = { .sq_length = arrayLength };
+
+static PyTypeObject _arrayType =
+{
+  PyVarObject_HEAD_INIT(NULL, 0)
+  .tp_name = "gen4.Array",
+  .tp_doc = "One column of a Batch. Read it through the buffer protocol:\n"
+            "numpy.asarray(column) or memoryview(column), without copying.",
+  .tp_basicsize = sizeof(arrayObject_t),
+  .tp_flags = Py_TPFLAGS_DEFAULT,
+  .tp_dealloc = arrayDealloc,
+  .tp_repr = arrayRepr,
+  .tp_as_buffer = &_arrayBuffer,
+  .tp_as_sequence = &_arraySequence,
+};
+
+/************************************************************/
+/************************************************************/
+/************************** Batch **************************/
+
+/** Reports decoded together. The columns never change once it is made. */
+typedef struct
+{
+  PyObject_HEAD
+  columns_t columns;
+} batchObject_t;
+
+static PyTypeObject _batchType;
+
+/** Wraps columns, which the new Batch owns from then on */
+static PyObject* newBatch(columns_t* columns)
+{
+  batchObject_t* batch = PyObject_New(batchObject_t, &_batchType);
+  if(batch == NULL)
+  {
+    freeColumns(columns);
+    return NULL;
+  }
+  batch->columns = *columns;
+  memset(columns, 0, sizeof(*columns));
+  return (PyObject*)batch;
+}
+
+static void batchDealloc(PyObject* self)
+{
+  freeColumns(&((batchObject_t*)self)->columns);
+  PyObject_Free(self);
+}
+
+static Py_ssize_t batchLength(PyObject* self)
+{
+  return ((batchObject_t*)self)->columns.count;
+}
+
+static PyObject* batchColumn(PyObject* self, void* closure)
+{
+  batchObject_t* batch = (batchObject_t*)self;
+  int column = (int)(intptr_t)closure;
+  arrayObject_t* array = PyObject_New(arrayObject_t, &_arrayType);
+  if(array == NULL)
+  {
+    return NULL;
+  }
+  array->owner = Py_NewRef(self);
+  array->data = batch->columns.data[column];
+  array->column = column;
+  array->ndim = _columns[column].width > 1 ? 2 : 1;
+  array->shape[0] = batch->columns.count;
+  array->shape[1] = _columns[column].width;
+  array->strides[0] = (Py_ssize_t)_columns[column].itemSize * _columns[column].width;
+  array->strides[1] = _columns[column].itemSize;
+  return (PyObject*)array;
+}
+
+static PyObject* batchRepr(PyObject* self)
+{
+  columns_t* columns = &((batchObject_t*)self)->columns;
+  return PyUnicode_FromFormat("<gen4.Batch %zd reports>", columns->count);
+}
+
+static PyGetSetDef _batchGetSet[COLUMN_COUNT + 1];
+
+static PyMemberDef _batchMembers[] =
+{
+  { "frames", T_ULONGLONG, offsetof(batchObject_t, columns.frames), READONLY, "valid frames of any type" },
+  { "bad_frames", T_ULONGLONG, offsetof(batchObject_t, columns.badFrames), READONLY,
+    "frames dropped for a bad length or checksum" },
+  { "skipped_bytes", T_ULONGLONG, offsetof(batchObject_t, columns.skippedBytes), READONLY,
+    "bytes outside frames, such as menu text" },
+  { NULL }
+};
+
+static PySequenceMethods _batchSequence = { .sq_length = batchLength };
+
+static PyTypeObject _batchType =
+{
+  PyVarObject_HEAD_INIT(NULL, 0)
+  .tp_name = "gen4.Batch",
+  .tp_doc = "Decoded reports, one Array per field. See the module help for the columns.",
+  .tp_basicsize = sizeof(batchObject_t),
+  .tp_flags = Py_TPFLAGS_DEFAULT,
+  .tp_dealloc = batchDealloc,
+  .tp_repr = batchRepr,
+  .tp_as_sequence = &_batchSequence,
+  .tp_members = _batchMembers,
+  .tp_getset = _batchGetSet,
+};
+
+/************************************************************/
+/************************************************************/
+/************************** Stream *************************/
+
+/** A dev kit's serial port, or anything else streaming frames */
+typedef struct
+{
+  PyObject_HEAD
+  int            fd;
+  bool           eof;
+  streamParser_t parser;
+  uint8_t        pending[STREAM_READ_SIZE];  /**< Read but not yet parsed */
+  size_t         pendingIndex;
+  size_t         pendingLength;
+  unsigned long long frames;
+} streamObject_t;
+
+static int streamInit(PyObject* self, PyObject* args, PyObject* kwargs)
+{
+  static char* keywords[] = { "path", "binary", NULL };
+  streamObject_t* stream = (streamObject_t*)self;
+  PyObject* path;
+  int binary = 0;
+
+  if(!PyArg_ParseTupleAndKeywords(args, kwargs, "O&|p", keywords, PyUnicode_FSConverter, &path, &binary))
+  {
+    return -1;
+  }
+  if(stream->fd >= 0)
+  {
+    close(stream->fd);
+  }
+  stream->fd = HOST_openSerial(PyBytes_AS_STRING(path));
+  if(stream->fd < 0)
+  {
+    PyErr_SetFromErrnoWithFilenameObject(PyExc_OSError, path);
+    Py_DECREF(path);
+    return -1;
+  }
+  Py_DECREF(path);
+  if(binary && HOST_writeAll(stream->fd, "b", 1) != 0)
+  {
+    PyErr_SetFromErrno(PyExc_OSError);
+    return -1;
+  }
+  API_Stream_initParser(&stream->parser);
+  stream->eof = false;
+  stream->pendingIndex = stream->pendingLength = 0;
+  stream->frames = 0;
+  return 0;
+}
+
+static PyObject* streamNew(PyTypeObject* type, PyObject* args, PyObject* kwargs)
+{
+  (void)args;
+  (void)kwargs;
+  streamObject_t* stream = (streamObject_t*)type->tp_alloc(type, 0);
+  if(stream != NULL)
+  {
+    stream->fd = -1;
+  }
+  return (PyObject*)stream;
+}
+
+static void streamDealloc(PyObject* self)
+{
+  streamObject_t* stream = (streamObject_t*)self;
+  if(stream->fd >= 0)
+  {
+    close(stream->fd);
+  }
+  Py_TYPE(self)->tp_free(self);
+}
+
+/** Parses pending bytes until count reports are in. false if out of memory. */
+static bool parsePending(streamObject_t* stream, columns_t* columns, Py_ssize_t count)
+{
+  while(stream->pendingIndex < stream->pendingLength && columns->count < count)
+  {
+    if(!API_Stream_parseByte(&stream->parser, stream->pending[stream->pendingIndex++]))
+    {
+      continue;
+    }
+    streamFrame_t* frame = &stream->parser.frame;
+    stream->frames++;
+    if(frame->type == STREAM_TYPE_REPORT && frame->length >= 3
+       && !addReport(columns, frame->timestamp, frame->payload, frame->length))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+static PyObject* streamRead(PyObject* self, PyObject* args, PyObject* kwargs)
+{
+  static char* keywords[] = { "count", "timeout_ms", NULL };
+  streamObject_t* stream = (streamObject_t*)self;
+  Py_ssize_t count = 1;
+  int timeoutMs = -1;
+  columns_t columns;
+
+  if(!PyArg_ParseTupleAndKeywords(args, kwargs, "|ni", keywords, &count, &timeoutMs))
+  {
+    return NULL;
+  }
+  if(stream->fd < 0)
+  {
+    PyErr_SetString(PyExc_ValueError, "read from a closed stream");
+    return NULL;
+  }
+  memset(&columns, 0, sizeof(columns));
+  uint32_t badFrames = stream->parser.badFrames;
+  uint32_t skipped = stream->parser.skipped;
+  uint64_t until = HOST_nowNs() + (uint64_t)(timeoutMs < 0 ? 0 : timeoutMs) * 1000000u;
+  bool memory = true;
+  int error = 0;
+
+  // waits in short slices so Ctrl-C is seen
+  while(columns.count < count && !stream->eof)
+  {
+    Py_BEGIN_ALLOW_THREADS
+    memory = parsePending(stream, &columns, count);
+    while(memory && columns.count < count && stream->pendingIndex == stream->pendingLength)
+    {
+      uint64_t now = HOST_nowNs();
+      if(timeoutMs >= 0 && now >= until)
+      {
+        break;
+      }
+      int waitMs = timeoutMs < 0 ? 100 : (int)((until - now + 999999) / 1000000);
+      struct pollfd p = { stream->fd, POLLIN, 0 };
+      int ready = poll(&p, 1, waitMs < 100 ? waitMs : 100);
+      if(ready < 0 && errno != EINTR)
+      {
+        error = errno;
+        break;
+      }
+      if(ready <= 0)
+      {
+        break;
+      }
+      ssize_t length = read(stream->fd, stream->pending, sizeof(stream->pending));
+      if(length == 0 || (length < 0 && errno == EIO))
+      {
+        stream->eof = true;          // a pty reads EIO once its writer is gone
+        break;
+      }
+      if(length < 0 && errno != EINTR && errno != EAGAIN)
+      {
+        error = errno;
+        break;
+      }
+      stream->pendingIndex = 0;
+      stream->pendingLength = length > 0 ? (size_t)length : 0;
+      memory = parsePending(stream, &columns, count);
+    }
+    Py_END_ALLOW_THREADS
+
+    if(!memory || error != 0 || PyErr_CheckSignals() != 0)
+    {
+      freeColumns(&columns);
+      if(!memory)
+      {
+        return PyErr_NoMemory();
+      }
+      if(error != 0)
+      {
+        errno = error;
+        return PyErr_SetFromErrno(PyExc_OSError);
+      }
+      return NULL;
+    }
+    if(timeoutMs >= 0 && HOST_nowNs() >= until)
+    {
+      break;
+    }
+  }
+  columns.frames = stream->frames;
+  columns.badFrames = stream->parser.badFrames - badFrames;
+  columns.skippedBytes = stream->parser.skipped - skipped;
+  stream->frames = 0;
+  return newBatch(&columns);
+}
+
+static PyObject* streamClose(PyObject* self, PyObject* unused)
+{
+  streamObject_t* stream = (streamObject_t*)self;
+  (void)unused;
+  if(stream->fd >= 0)
+  {
+    close(stream->fd);
+  }
+  stream->fd = -1;
+  Py_RETURN_NONE;
+}
+
+static PyObject* streamFileno(PyObject* self, PyObject* unused)
+{
+  (void)unused;
+  return PyLong_FromLong(((streamObject_t*)self)->fd);
+}
+
+static PyObject* streamEnter(PyObject* self, PyObject* unused)
+{
+  (void)unused;
+  return Py_NewRef(self);
+}
+
+static PyObject* streamExit(PyObject* self, PyObject* args)
+{
+  (void)args;
+  return streamClose(self, NULL);
+}
+
+static PyObject* streamEof(PyObject* self, void* closure)
+{
+  (void)closure;
+  return PyBool_FromLong(((streamObject_t*)self)->eof);
+}
+
+static PyMethodDef _streamMethods[] =
+{
+  { "read", (PyCFunction)(void (*)(void))streamRead, METH_VARARGS | METH_KEYWORDS,
+    "read(count=1, timeout_ms=-1) -> Batch\n\n"
+    "Waits for count reports, or until timeout_ms pass (-1 waits for ever),\n"
+    "and returns the reports that came. Frames of other types are skipped." },
+  { "close", streamClose, METH_NOARGS, "Closes the port." },
+  { "fileno", streamFileno, METH_NOARGS, "The port's file descriptor, for select or poll." },
+  { "__enter__", streamEnter, METH_NOARGS, NULL },
+  { "__exit__", streamExit, METH_VARARGS, NULL },
+  { NULL }
+};
+
+static PyGetSetDef _streamGetSet[] =
+{
+  { "eof", streamEof, NULL, "True once the port hung up or the file ended", NULL },
+  { NULL }
+};
+
+static PyTypeObject _streamType =
+{
+  PyVarObject_HEAD_INIT(NULL, 0)
+  .tp_name = "gen4.Stream",
+  .tp_doc = "Stream(path, binary=False)\n\n"
+            "Reports as they arrive on a dev kit's serial port (or a pty or file).\n"
+            "binary=True sends 'b' to the board to turn binary streaming on.",
+  .tp_basicsize = sizeof(streamObject_t),
+  .tp_flags = Py_TPFLAGS_DEFAULT,
+  .tp_new = streamNew,
+  .tp_init = streamInit,
+  .tp_dealloc = streamDealloc,
+  .tp_methods = _streamMethods,
+  .tp_getset = _streamGetSet,
+};
+
+/************************************************************/
+/************************************************************/
+/********************  MODULE FUNCTIONS *********************/
+
+static PyObject* decodeOrFail(columns_t* columns, const uint8_t* data, size_t size)
+{
+  bool memory;
+
+  Py_BEGIN_ALLOW_THREADS
+  memory = decodeCapture(columns, data, size);
+  Py_END_ALLOW_THREADS
+  if(!memory)
+  {
+    freeColumns(columns);
+    return PyErr_NoMemory();
+  }
+  return newBatch(columns);
+}
+
+static PyObject* gen4Load(PyObject* module, PyObject* args)
+{
+  PyObject* path;
+  columns_t columns;
+  struct stat st;
+
+  (void)module;
+  if(!PyArg_ParseTuple(args, "O&", PyUnicode_FSConverter, &path))
+  {
+    return NULL;
+  }
+  int fd = open(PyBytes_AS_STRING(path), O_RDONLY | O_CLOEXEC);
+  if(fd < 0 || fstat(fd, &st) != 0)
+  {
+    PyErr_SetFromErrnoWithFilenameObject(PyExc_OSError, path);
+    if(fd >= 0)
+    {
+      close(fd);
+    }
+    Py_DECREF(path);
+    return NULL;
+  }
+  const uint8_t* data = NULL;
+  size_t size = (size_t)st.st_size;
+  if(size != 0)
+  {
+    data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if(data == MAP_FAILED)
+    {
+      PyErr_SetFromErrnoWithFilenameObject(PyExc_OSError, path);
+      close(fd);
+      Py_DECREF(path);
+      return NULL;
+    }
+    madvise((void*)data, size, MADV_SEQUENTIAL);
+  }
+  close(fd);
+  Py_DECREF(path);
+
+  memset(&columns, 0, sizeof(columns));
+  PyObject* batch = decodeOrFail(&columns, data, size);
+  if(size != 0)
+  {
+    munmap((void*)data, size);
+  }
+  return batch;
+}
+
+static PyObject* gen4Decode(PyObject* module, PyObject* args)
+{
+  Py_buffer buffer;
+  columns_t columns;
+
+  (void)module;
+  if(!PyArg_ParseTuple(args, "y*", &buffer))
+  {
+    return NULL;
+  }
+  memset(&columns, 0, sizeof(columns));
+  PyObject* batch = decodeOrFail(&columns, buffer.buf, (size_t)buffer.len);
+  PyBuffer_Release(&buffer);
+  return batch;
+}
+
+static PyMethodDef _moduleMethods[] =
+{
+  { "load", gen4Load, METH_VARARGS,
+    "load(path) -> Batch\n\nDecodes the report frames of a capture file (the binary stream saved\n"
+    "with cat, gen4flight -o, gen4synth -o). The file is memory mapped." },
+  { "decode", gen4Decode, METH_VARARGS,
+    "decode(data) -> Batch\n\nDecodes the report frames in a bytes-like object." },
+  { NULL }
+};
+
+static struct PyModuleDef _module =
+{
+  PyModuleDef_HEAD_INIT,
+  .m_name = "gen4",
+  .m_doc = "Batch decoding of Gen4 report captures and live streams, with the\n"
+           "dev kit's decoder. Columns of a Batch are read through the buffer\n"
+           "protocol (numpy.asarray, memoryview) without copying.\n\n"
+           "Columns: timestamp report_id kind buttons contact_flags x y palm\n"
+           "dx dy scroll pan modifier keycode (x, y, palm: 5 per report;\n"
+           "keycode: 6 per report). Fields that do not apply to a report's\n"
+           "kind are zero.",
+  .m_size = -1,
+  .m_methods = _moduleMethods,
+};
+
+PyMODINIT_FUNC PyInit_gen4(void)
+{
+  for(int i = 0; i < COLUMN_COUNT; i++)
+  {
+    _batchGetSet[i].name = _columns[i].name;
+    _batchGetSet[i].get = batchColumn;
+    _batchGetSet[i].doc = _columns[i].doc;
+    _batchGetSet[i].closure = (void*)(intptr_t)i;
+  }
+  if(PyType_Ready(&_arrayType) < 0 || PyType_Ready(&_batchType) < 0 || PyType_Ready(&_streamType) < 0)
+  {
+    return NULL;
+  }
+  PyObject* module = PyModule_Create(&_module);
+  if(module == NULL)
+  {
+    return NULL;
+  }
+  if(PyModule_AddObjectRef(module, "Array", (PyObject*)&_arrayType) < 0
+     || PyModule_AddObjectRef(module, "Batch", (PyObject*)&_batchType) < 0
+     || PyModule_AddObjectRef(module, "Stream", (PyObject*)&_streamType) < 0
+     || PyModule_AddIntConstant(module, "KIND_NONE", REPORT_KIND_NONE) < 0
+     || PyModule_AddIntConstant(module, "KIND_MOUSE", REPORT_KIND_MOUSE) < 0
+     || PyModule_AddIntConstant(module, "KIND_KEYBOARD", REPORT_KIND_KEYBOARD) < 0
+     || PyModule_AddIntConstant(module, "KIND_ABSOLUTE", REPORT_KIND_ABSOLUTE) < 0)
+  {
+    Py_DECREF(module);
+    return NULL;
+  }
+  return module;
+}
@@ -0,0 +1,143 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+/** gen4ringcat - example reader for the gen4fanoutd report ring. Prints one 
+	line per report, straight from the shared slots without copying them.
+
+	usage: gen4ringcat [-n ring_name] [-a] [-c count] [-d delay_us] [-q] */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <getopt.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "API_C2_Report.h"
+#include "HostRing.h"
+
+static volatile sig_atomic_t running_g = 1;
+
+static void onSignal(int sig)
+{
+  (void)sig;
+  running_g = 0;
+}
+
+static void usage(const char* argv0)
+{
+  fprintf(stderr,
+          "usage: %s [-n ring_name] [-a] [-c count] [-d delay_us] [-q]\n"
+          "  -a  start at the oldest report still in the ring instead of the newest\n"
+          "  -c  exit after count reports\n"
+          "  -d  stall for delay_us after every report (simulates a slow reader)\n"
+          "  -q  only print the summary\n",
+          argv0);
+}
+
+/** Formats a slot into line. Done before RING_release so a lapped slot
+	can be thrown away instead of printed. */
+static int formatSlot(const ringSlot_t* slot, char* line, size_t size)
+{
+  const report_t* report = &slot->report;
+  int n = snprintf(line, size, "%10u id=0x%02X", slot->deviceTime, report->reportID);
+
+  switch(report->reportID)
+  {
+    case CRQ_ABSOLUTE_REPORT_ID:
+      n += snprintf(line + n, size - n, " contacts=0x%02X buttons=0x%02X",
+                    report->abs.contactFlags, report->abs.buttons);
+      for(uint8_t i = 0; i < 5; i++)
+      {
+        if(report->abs.contactFlags & (1 << i))
+        {
+          n += snprintf(line + n, size - n, " f%u=(%u,%u,0x%02X)", i, report->abs.fingers[i].x,
+                        report->abs.fingers[i].y, report->abs.fingers[i].palm);
+        }
+      }
+      break;
+    case MOUSE_REPORT_ID:
+      n += snprintf(line + n, size - n, " buttons=0x%02X dx=%d dy=%d scroll=%d pan=%d",
+                    report->mouse.buttons, report->mouse.xDelta, report->mouse.yDelta,
+                    report->mouse.scrollDelta, report->mouse.panDelta);
+      break;
+    case KEYBOARD_REPORT_ID:
+      n += snprintf(line + n, size - n, " modifier=0x%02X key=0x%02X",
+                    report->keyboard.modifier, report->keyboard.keycode[0]);
+      break;
+    default:
+      break;
+  }
+  return n;
+}
+
+int main(int argc, char** argv)
+{
+  const char* name = RING_DEFAULT_NAME;
+  bool fromOldest = false, quiet = false;
+  uint64_t limit = 0;
+  useconds_t delay = 0;
+  int opt;
+
+  while((opt = getopt(argc, argv, "n:ac:d:qh")) != -1)
+  {
+    switch(opt)
+    {
+      case 'n': name = optarg; break;
+      case 'a': fromOldest = true; break;
+      case 'c': limit = strtoull(optarg, NULL, 0); break;
+      case 'd': delay = (useconds_t)strtoul(optarg, NULL, 0); break;
+      case 'q': quiet = true; break;
+      default: usage(argv[0]); return 2;
+    }
+  }
+
+  ring_t ring;
+  if(RING_open(&ring, name) != 0)
+  {
+    fprintf(stderr, "%s: %s\n", name, strerror(errno));
+    return 1;
+  }
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+
+  ringReader_t reader;
+  RING_attach(&reader, &ring, fromOldest);
+  uint64_t received = 0;
+
+  while(running_g && (limit == 0 || received < limit))
+  {
+    const ringSlot_t* slot = RING_peek(&reader);
+    if(slot == NULL)
+    {
+      if(ring.header->magic != RING_MAGIC)
+      {
+        break; // writer exited
+      }
+      RING_wait(&reader, 100);
+      continue;
+    }
+
+    char line[256];
+    formatSlot(slot, line, sizeof(line));
+    if(!RING_release(&reader, slot))
+    {
+      continue;
+    }
+    received++;
+    if(!quiet)
+    {
+      puts(line);
+    }
+    if(delay)
+    {
+      usleep(delay);
+    }
+  }
+
+  fprintf(stderr, "received %llu reports, lost %llu\n",
+          (unsigned long long)received, (unsigned long long)reader.lost);
+  RING_close(&ring);
+  return 0;
+}
@@ -0,0 +1,404 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+/** gen4simkit - a simulated dev kit. It runs the sketch's own API_C2,
+	API_HostBus and API_Command code against a simulated Gen4 (SimGen4.h)
+	on a SimBus and serves it on a pseudo terminal, whose path is printed on
+	stdout. Like the sketch it answers binary command frames and, once 'b'
+	is received, streams a report frame for each report it reads. A
+	READ_REGION command streams its chunks between reports, as the sketch's
+	region task does; memory below 0xC000 holds a test pattern for it. 'x' dumps
+	the trace points (see API_Trace.h), for which it is built with
+	CONFIG_TRACE_ENABLE. 'm' and 'M', or a STATS command, start and stop
+	touch statistics (see API_C2_Stats.h): a STREAM_TYPE_STATS frame per
+	summary replaces the report frames. A WATCH command watches registers
+	between reports (see API_C2_Watch.h), each change a STREAM_TYPE_WATCH
+	frame. Other menu characters are ignored.
+	With -o or -p the frames are stamped by a clock of the kit's own, off 
+	from the host's by an offset and a drift (SIMHW_setClock), to stand in 
+	for one of several unsynchronized boards (see gen4merge).
+
+	usage: gen4simkit [-r rate_hz] [-k i2c_khz] [-u usb_us] [-d seconds] [-o offset_us] [-p drift_ppm] [-b] */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <getopt.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "API_C2.h"
+#include "API_C2_Region.h"
+#include "API_C2_Stats.h"
+#include "API_C2_Watch.h"
+#include "API_Command.h"
+#include "API_HostBus.h"
+#include "API_Stream.h"
+#include "API_Trace.h"
+#include "HostSynth.h"
+#include "HostUtil.h"
+#include "SimBus.h"
+#include "SimGen4.h"
+#include "SimHardware.h"
+
+#define REGION_CHUNKS_PER_PASS (8)
+
+static void usage(const char* argv0)
+{
+  fprintf(stderr,
+          "usage: %s [-r rate_hz] [-k i2c_khz] [-u usb_us] [-d seconds] [-o offset_us] [-p drift_ppm] [-b]\n"
+          "  -r  reports per second from the simulated pad, 0 for none (default 125)\n"
+          "  -k  take as long as a real bus at this clock for every I2C transfer, 0 for no delay (default 400)\n"
+          "  -u  delay before the host sees each frame sent (default 1000, one USB frame)\n"
+          "  -d  exit after this many seconds, 0 to run until killed (default 0)\n"
+          "  -o  micros() is this plus the host's monotonic clock in us\n"
+          "  -p  micros() gains this many us a second on the host's clock (default 0)\n"
+          "  -b  start in binary streaming mode\n",
+          argv0);
+}
+
+static volatile sig_atomic_t _stop = 0;
+
+static void onSignal(int sig)
+{
+  (void)sig;
+  _stop = 1;
+}
+
+static bool dataReady(const void* context)
+{
+  return SIMGEN4_dataReady((const simGen4_t*)context);
+}
+
+/** Serial input, with the available/peek/read view the sketch has of it */
+typedef struct
+{
+  int      fd;
+  uint8_t  data[4096];
+  uint16_t index;
+  uint16_t length;
+} serialIn_t;
+
+static uint16_t serialAvailable(serialIn_t* in)
+{
+  return in->length - in->index;
+}
+
+/** Waits up to timeoutMs for input when none is buffered. Returns false once the link is gone. */
+static bool serialFill(serialIn_t* in, int timeoutMs)
+{
+  struct pollfd pfd = { in->fd, POLLIN, 0 };
+  if(serialAvailable(in) > 0 || poll(&pfd, 1, timeoutMs) <= 0)
+  {
+    return true;
+  }
+  ssize_t count = read(in->fd, in->data, sizeof(in->data));
+  if(count < 0)
+  {
+    // EIO just means no one has the slave end open right now
+    return errno == EINTR || errno == EAGAIN || errno == EIO;
+  }
+  in->index = 0;
+  in->length = (uint16_t)count;
+  return count > 0;
+}
+
+/** Holds the loop for as long as the bus traffic since the last call would
+	take at clockHz: 9 clocks per byte plus the address byte of each transaction.
+	The sketch is blocked in Wire for that long, plus any time SimBus counted 
+	for deadlines and bus clearing. Host sleeps can wake late by
+	milliseconds; the extra time is taken off the following transfers so that
+	it doesn't add up. */
+static void modelBusTime(uint32_t clockHz)
+{
+  static uint64_t lastBits = 0, lastStalledUs = 0, overslept = 0;
+  simBusStats_t* stats = SIMBUS_getStats();
+  uint64_t bits = 9ull * ((uint64_t)stats->bytesRead + stats->bytesWritten
+                          + stats->readTransactions + stats->writeTransactions);
+  if(clockHz == 0 || (bits == lastBits && stats->stalledUs == lastStalledUs))
+  {
+    lastBits = bits;
+    lastStalledUs = stats->stalledUs;
+    return;
+  }
+  uint64_t busyNs = (bits - lastBits) * 1000000000ull / clockHz
+                  + (stats->stalledUs - lastStalledUs) * 1000ull;
+  uint64_t credit = overslept < busyNs ? overslept : busyNs;
+  lastBits = bits;
+  lastStalledUs = stats->stalledUs;
+  overslept -= credit;
+
+  uint64_t until = HOST_nowNs() + busyNs - credit;
+  struct timespec ts = { (time_t)(until / 1000000000ull), (long)(until % 1000000000ull) };
+  while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) != 0)
+  {
+  }
+  overslept += HOST_nowNs() - until;
+  if(overslept > 5000000ull)
+  {
+    overslept = 5000000ull;
+  }
+}
+
+/** Frames on their way to the host. USB serial does not deliver a frame the
+	moment the sketch writes it; the host controller collects data once per 
+	1 ms frame. Frames are held here for the modelled latency. */
+typedef struct
+{
+  uint64_t due;
+  uint16_t length;
+  uint8_t  data[STREAM_MAX_FRAME];
+} outFrame_t;
+
+#define OUT_QUEUE_DEPTH (128)
+
+static outFrame_t _out[OUT_QUEUE_DEPTH];
+static uint16_t _outHead = 0, _outCount = 0;
+static uint64_t _latencyNs = 0;
+
+/** Writes the held frames that are due, or all of them with force. */
+static void flushFrames(int fd, bool force)
+{
+  uint64_t now = HOST_nowNs();
+  while(_outCount > 0 && (force || _out[_outHead].due <= now))
+  {
+    HOST_writeAll(fd, _out[_outHead].data, _out[_outHead].length);
+    _outHead = (_outHead + 1) % OUT_QUEUE_DEPTH;
+    _outCount--;
+  }
+}
+
+static void sendFrame(int fd, uint8_t type, const uint8_t* payload, uint16_t length)
+{
+  if(_outCount == OUT_QUEUE_DEPTH)
+  {
+    flushFrames(fd, true);
+  }
+  outFrame_t* frame = &_out[(_outHead + _outCount) % OUT_QUEUE_DEPTH];
+  frame->length = API_Stream_encodeFrame(type, API_Hardware_micros(), payload, length, frame->data);
+  frame->due = HOST_nowNs() + _latencyNs;
+  _outCount++;
+  flushFrames(fd, false);
+}
+
+/** Sends the trace dump all at once, as the sketch's traceDumpTask does a 
+    chunk at a time, and starts tracing again empty. */
+static void sendTraceDump(int fd)
+{
+  uint8_t info[TRACE_DUMP_INFO_SIZE];
+  uint8_t chunk[4 + 32 * TRACE_ENTRY_SIZE];
+  uint32_t count = API_Trace_getCount();
+
+  API_Trace_enable(false);
+  sendFrame(fd, STREAM_TYPE_TRACE_INFO, info, API_Trace_encodeDumpInfo(info));
+  for(uint32_t index = 0; index < count; index += 32)
+  {
+    chunk[0] = (uint8_t)(index & 0xFF);
+    chunk[1] = (uint8_t)((index >> 8) & 0xFF);
+    chunk[2] = (uint8_t)((index >> 16) & 0xFF);
+    chunk[3] = (uint8_t)((index >> 24) & 0xFF);
+    sendFrame(fd, STREAM_TYPE_TRACE_DATA, chunk, 4 + API_Trace_copy(index, &chunk[4], 32));
+  }
+  API_Trace_clear();
+  API_Trace_enable(true);
+}
+
+int main(int argc, char** argv)
+{
+  uint32_t rate = 125, clockHz = 400000, latencyUs = 1000, seconds = 0;
+  uint32_t clockOffsetUs = 0;
+  int32_t driftPpm = 0;
+  bool streaming = false, ownClock = false;
+  int opt;
+
+  while((opt = getopt(argc, argv, "r:k:u:d:o:p:bh")) != -1)
+  {
+    switch(opt)
+    {
+      case 'r': rate = (uint32_t)strtoul(optarg, NULL, 0); break;
+      case 'k': clockHz = (uint32_t)strtoul(optarg, NULL, 0) * 1000u; break;
+      case 'u': latencyUs = (uint32_t)strtoul(optarg, NULL, 0); break;
+      case 'd': seconds = (uint32_t)strtoul(optarg, NULL, 0); break;
+      case 'o': clockOffsetUs = (uint32_t)strtoul(optarg, NULL, 0); ownClock = true; break;
+      case 'p': driftPpm = (int32_t)strtol(optarg, NULL, 0); ownClock = true; break;
+      case 'b': streaming = true; break;
+      default: usage(argv[0]); return 2;
+    }
+  }
+
+  char path[128];
+  int slave;
+  int fd = HOST_openPty(path, sizeof(path), &slave);
+  if(fd < 0)
+  {
+    perror("pty");
+    return 1;
+  }
+  printf("%s\n", path);
+  fflush(stdout);
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+
+  _latencyNs = latencyUs * 1000ull;
+
+  static simGen4_t pad;
+  SIMGEN4_init(&pad, CIRQUE_SLAVE_ADDR);
+  for(uint32_t i = 0; i < 0xC000; i++)
+  {
+    pad.memory[i] = (uint8_t)(i * 7 + (i >> 8));
+  }
+  SIMBUS_attach(&pad.device);
+  SIMHW_setDataReady(dataReady, &pad);
+
+  API_Hardware_init();
+  if(ownClock)
+  {
+    SIMHW_setClock(clockOffsetUs, driftPpm);
+  }
+  API_Hardware_PowerOn();
+  API_C2_init(400000, CIRQUE_SLAVE_ADDR);
+
+  synth_t synth;
+  SYNTH_init(&synth, CRQ_ABSOLUTE_REPORT_ID, rate ? 1000000u / rate : 1000u, 0);
+  uint64_t periodNs = rate ? 1000000000ull / rate : 0;
+  uint64_t start = HOST_nowNs(), nextReport = start;
+
+  static serialIn_t in;
+  static streamParser_t parser;
+  in.fd = fd;
+  API_Stream_initParser(&parser);
+
+  uint32_t commands = 0, reports = 0;
+  while(!_stop && (seconds == 0 || HOST_nowNs() - start < seconds * 1000000000ull))
+  {
+    uint64_t now = HOST_nowNs();
+    if(periodNs && now >= nextReport)
+    {
+      uint8_t packet[PACKET_SIZE];
+      SYNTH_nextPacket(&synth, packet);
+      SIMGEN4_queuePacket(&pad, packet);
+      nextReport += periodNs;
+    }
+
+    /* The sketch's loop(): reports first, then one command, then the menu */
+    if(API_C2_DR_Asserted())
+    {
+      TRACE_INSTANT(TRACE_ID_DR, 0);
+      uint32_t readyUs = HostDR_assertedUs();
+      report_t report;
+      uint8_t packet[PACKET_SIZE];
+      API_C2_getReportPacket(packet, &report);
+      modelBusTime(clockHz);
+      reports++;
+      API_C2_watchReport(readyUs, API_Hardware_micros());
+      if(API_C2_statsRunning())
+      {
+        reportView_t view;
+        API_C2_viewReport(packet, &view);
+        API_C2_statsReport(&view, API_Hardware_micros());
+      }
+      else if(streaming)
+      {
+        sendFrame(fd, STREAM_TYPE_REPORT, packet, PACKET_SIZE);
+      }
+    }
+
+    if(API_C2_statsDue(API_Hardware_micros()))
+    {
+      statsSummary_t summary;
+      uint8_t payload[STATS_SUMMARY_MAX_SIZE];
+      API_C2_takeStatsSummary(&summary, API_Hardware_micros());
+      sendFrame(fd, STREAM_TYPE_STATS, payload, API_C2_encodeStatsSummary(&summary, payload));
+    }
+
+    if(API_C2_watchDue(API_Hardware_micros()))
+    {
+      API_C2_watchPoll(API_Hardware_micros());
+      modelBusTime(clockHz);
+    }
+    watchEvent_t event;
+    while(API_C2_takeWatchEvent(&event))
+    {
+      uint8_t payload[WATCH_EVENT_SIZE];
+      sendFrame(fd, STREAM_TYPE_WATCH, payload, API_C2_encodeWatchEvent(&event, payload));
+    }
+
+    flushFrames(fd, false);
+    int waitMs = 0;
+    if(!SIMGEN4_dataReady(&pad) && serialAvailable(&in) == 0 && !API_Command_regionPending())
+    {
+      uint64_t wake = periodNs ? nextReport : now + 100000000ull;
+      if(_outCount > 0 && _out[_outHead].due < wake)
+      {
+        wake = _out[_outHead].due;
+      }
+      waitMs = wake > now ? (int)((wake - now + 999999) / 1000000) : 0;
+    }
+    if(!serialFill(&in, waitMs))
+    {
+      break;
+    }
+
+    while(serialAvailable(&in) && (parser.index != 0 || in.data[in.index] == STREAM_SYNC_0))
+    {
+      if(API_Stream_parseByte(&parser, in.data[in.index++]) && parser.frame.type == STREAM_TYPE_COMMAND)
+      {
+        static uint8_t response[STREAM_MAX_PAYLOAD];
+        uint16_t length = API_Command_execute(parser.frame.payload, parser.frame.length, response);
+        modelBusTime(clockHz);
+        commands++;
+        if(length > 0)
+        {
+          sendFrame(fd, STREAM_TYPE_RESPONSE, response, length);
+        }
+        break;
+      }
+    }
+
+    /* A few region chunks per pass: the sketch sends one per task run, but
+       sleeping off the bus time of each 50 byte chunk costs the host more
+       than the chunk takes on a real bus */
+    if(API_Command_regionPending())
+    {
+      for(int i = 0; i < REGION_CHUNKS_PER_PASS && API_Command_regionPending(); i++)
+      {
+        uint8_t payload[COMMAND_REGION_HEADER + REGION_MAX_CHUNK];
+        uint16_t length = API_Command_nextRegionFrame(payload);
+        sendFrame(fd, STREAM_TYPE_REGION_DATA, payload, length);
+      }
+      modelBusTime(clockHz);
+    }
+
+    if(serialAvailable(&in) && parser.index == 0 && in.data[in.index] != STREAM_SYNC_0)
+    {
+      char rxChar = (char)in.data[in.index++];
+      if(rxChar == 'b' || rxChar == 'B')
+      {
+        streaming = (rxChar == 'b');
+      }
+      else if(rxChar == 'x')
+      {
+        sendTraceDump(fd);
+      }
+      else if(rxChar == 'm')
+      {
+        API_C2_startStats(STATS_INTERVAL_MS, API_Hardware_micros());
+      }
+      else if(rxChar == 'M')
+      {
+        API_C2_stopStats();
+      }
+    }
+  }
+
+  flushFrames(fd, true);
+  simBusStats_t* stats = SIMBUS_getStats();
+  fprintf(stderr, "gen4simkit: %u commands, %u reports, %u bytes read and %u written on the bus\n",
+          commands, reports, stats->bytesRead, stats->bytesWritten);
+  close(slave);
+  close(fd);
+  return 0;
+}
@@ -0,0 +1,204 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+/** gen4startup - measures the sketch's time to first report against a
+	simulated pad (SimGen4.h) that takes a given time to boot after power on,
+	and has a report waiting as soon as it has booted. Two startups are run
+	for each boot time:
+	  fixed  the old setup(): 2 ms power up and 50 ms boot delays, then the
+	         system info read one register at a time (six reads)
+	  polled API_C2_waitReady: the pad is polled until it answers, and the
+	         system info comes with it in one burst read
+	Times are from power on to the end of the system info read (ready) and to
+	the first report read (first). The board's bus time at the given clock is
+	added to the host time, since SimBus itself takes none. The old setup()
+	also waited for a USB host to open the port first, which is not counted.
+	Exits non-zero if the polled startup fails to identify a pad that boots
+	within STARTUP_TIMEOUT_US.
+
+	usage: gen4startup [-b boot_ms] [-k i2c_khz] */
+
+#define _GNU_SOURCE
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "API_C2.h"
+#include "API_HostBus.h"
+#include "HostSynth.h"
+#include "SimBus.h"
+#include "SimGen4.h"
+#include "SimHardware.h"
+
+#define FIRST_REPORT_TIMEOUT_US (1000000)
+
+typedef struct
+{
+  uint32_t readyUs;       /**< Power on to system info read */
+  uint32_t firstUs;       /**< Power on to first report read, 0 if none came */
+  uint32_t transactions;  /**< I2C transactions, including NAKed polls */
+  bool     identified;    /**< The system info read was the pad's */
+} startup_t;
+
+static void usage(const char* argv0)
+{
+  fprintf(stderr,
+          "usage: %s [-b boot_ms] [-k i2c_khz]\n"
+          "  -b  pad boot time, repeat for several (default 2, 10, 30, 45 and 80)\n"
+          "  -k  I2C clock used to work out bus time (default 400)\n",
+          argv0);
+}
+
+static bool dataReady(const void* context)
+{
+  return SIMGEN4_dataReady((const simGen4_t*)context);
+}
+
+/** Bus time so far at clockHz, including what SimBus counted for deadlines.
+	A NAKed poll is an address byte, which fits in the STARTUP_POLL_US the
+	poll waits anyway, so it is left out. */
+static uint32_t busTimeUs(uint32_t clockHz)
+{
+  simBusStats_t* stats = SIMBUS_getStats();
+  uint64_t bits = 9ull * ((uint64_t)stats->bytesRead + stats->bytesWritten
+                          + stats->readTransactions + stats->writeTransactions - stats->naks);
+  return (uint32_t)(bits * 1000000ull / clockHz + stats->stalledUs);
+}
+
+static uint32_t boardTimeUs(uint32_t clockHz)
+{
+  return API_Hardware_micros() + busTimeUs(clockHz);
+}
+
+/** The system info read of the old setup(), a register at a time */
+static void fixedReadSystemInfo(systemInfo_t* result)
+{
+  uint8_t pair[2];
+  memset(result, 0, sizeof(*result));
+  result->chipId = API_C2_readRegister(REG_CHIP_ID);
+  result->firmwareVersion = API_C2_readRegister(REG_FIRMWARE_VER);
+  result->firmwareSubversion = API_C2_readRegister(REG_FIRMWARE_SUBVERSION);
+  API_C2_readMemory(REG_VENDOR_ID, pair, 2);
+  result->vendorId = (uint16_t)(pair[0] | (pair[1] << 8));
+  API_C2_readMemory(REG_PRODUCT_ID, pair, 2);
+  result->productId = (uint16_t)(pair[0] | (pair[1] << 8));
+  API_C2_readMemory(REG_VERSION_ID, pair, 2);
+  result->versionId = (uint16_t)(pair[0] | (pair[1] << 8));
+}
+
+/** Powers the simulated board up and runs one startup, then services DR
+	until the first report is read, like reportTask. */
+static void runStartup(simGen4_t* pad, uint32_t bootUs, bool polled, uint32_t clockHz, startup_t* result)
+{
+  systemInfo_t info;
+  uint8_t packet[PACKET_SIZE];
+  synth_t synth;
+
+  memset(result, 0, sizeof(*result));
+  SIMGEN4_init(pad, CIRQUE_SLAVE_ADDR);
+  pad->bootUs = bootUs;
+  SYNTH_init(&synth, CRQ_ABSOLUTE_REPORT_ID, 8000, 0);
+  SYNTH_nextPacket(&synth, packet);
+  SIMGEN4_queuePacket(pad, packet);     // a finger is already down
+  SIMBUS_detachAll();
+  SIMBUS_attach(&pad->device);
+  SIMHW_setDataReady(dataReady, pad);
+  SIMBUS_resetStats();
+
+  API_Hardware_init();
+  API_Hardware_PowerOn();
+  if(polled)
+  {
+    API_C2_init((int32_t)clockHz, CIRQUE_SLAVE_ADDR);
+    API_C2_waitReady(&info, STARTUP_TIMEOUT_US);
+  }
+  else
+  {
+    API_Hardware_delay(2);
+    API_C2_init((int32_t)clockHz, CIRQUE_SLAVE_ADDR);
+    API_Hardware_delay(50);
+    fixedReadSystemInfo(&info);
+  }
+  result->readyUs = boardTimeUs(clockHz);
+  result->identified = info.chipId == pad->memory[REG_CHIP_ID] && info.vendorId == 0x0488
+                       && info.productId == 0xD001 && info.versionId == 0x4514;
+
+  uint32_t start = API_Hardware_micros();
+  while(API_Hardware_micros() - start < FIRST_REPORT_TIMEOUT_US)
+  {
+    if(API_C2_DR_Asserted() && API_C2_readReportPacket(packet) == SUCCESS)
+    {
+      result->firstUs = boardTimeUs(clockHz);
+      break;
+    }
+  }
+  result->transactions = SIMBUS_getStats()->readTransactions + SIMBUS_getStats()->writeTransactions;
+}
+
+static void printRow(const startup_t* startup)
+{
+  printf(" %9.2f", startup->readyUs / 1000.0);
+  if(startup->firstUs != 0)
+  {
+    printf(" %9.2f", startup->firstUs / 1000.0);
+  }
+  else
+  {
+    printf(" %9s", "none");
+  }
+  printf(" %4u %3s", startup->transactions, startup->identified ? "yes" : "NO");
+}
+
+int main(int argc, char** argv)
+{
+  uint32_t bootMs[16], bootCount = 0, clockHz = 400000;
+  int opt;
+
+  while((opt = getopt(argc, argv, "b:k:h")) != -1)
+  {
+    switch(opt)
+    {
+      case 'b':
+        if(bootCount < sizeof(bootMs) / sizeof(bootMs[0]))
+        {
+          bootMs[bootCount++] = (uint32_t)strtoul(optarg, NULL, 0);
+        }
+        break;
+      case 'k': clockHz = (uint32_t)strtoul(optarg, NULL, 0) * 1000u; break;
+      default: usage(argv[0]); return 2;
+    }
+  }
+  if(clockHz == 0)
+  {
+    usage(argv[0]);
+    return 2;
+  }
+  if(bootCount == 0)
+  {
+    static const uint32_t defaults[] = { 2, 10, 30, 45, 80 };
+    memcpy(bootMs, defaults, sizeof(defaults));
+    bootCount = sizeof(defaults) / sizeof(defaults[0]);
+  }
+
+  static simGen4_t pad;
+  int failures = 0;
+  printf("%-8s | %-28s | %-28s\n", "", "fixed delays", "polled");
+  printf("%-8s | %9s %9s %4s %3s | %9s %9s %4s %3s\n", "boot ms", "ready ms", "first ms", "i2c", "id",
+         "ready ms", "first ms", "i2c", "id");
+  for(uint32_t b = 0; b < bootCount; b++)
+  {
+    startup_t fixed, polled;
+    runStartup(&pad, bootMs[b] * 1000u, false, clockHz, &fixed);
+    runStartup(&pad, bootMs[b] * 1000u, true, clockHz, &polled);
+    printf("%-8u |", bootMs[b]);
+    printRow(&fixed);
+    printf(" |");
+    printRow(&polled);
+    printf("\n");
+    if(bootMs[b] * 1000u < STARTUP_TIMEOUT_US && (!polled.identified || polled.firstUs == 0))
+    {
+      failures++;
+    }
+  }
+  return failures == 0 ? 0 : 1;
+}
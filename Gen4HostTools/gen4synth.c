@@ -0,0 +1,215 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+/** gen4synth - stands in for a dev kit in binary streaming mode. It creates a 
+	pseudo terminal (or writes to a file / stdout) and sends synthetic report 
+	frames, optionally mixed with menu text, so host tools can be exercised 
+	end to end without hardware. With -f it replays the report frames of a 
+	recording (e.g. from gen4flight -o) with their original timing instead.
+
+	usage: gen4synth [-r rate_hz] [-c count] [-m abs|rel|ptp] [-f replay_file] [-t] [-s] [-w wait_ms] [-o path] */
+
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "API_C2_Report.h"
+#include "API_Stream.h"
+#include "HostSynth.h"
+#include "HostUtil.h"
+
+static void usage(const char* argv0)
+{
+  fprintf(stderr,
+          "usage: %s [-r rate_hz] [-c count] [-m abs|rel|ptp] [-f replay_file] [-t] [-s] [-w wait_ms] [-o path]\n"
+          "  -r  reports per second, 0 for as fast as possible (default 125)\n"
+          "  -c  number of reports, 0 for unlimited (default 0)\n"
+          "  -m  abs, rel (mouse) or ptp (Precision Touchpad) reports (default abs)\n"
+          "  -f  replay the report frames in a file at their recorded timing\n"
+          "  -t  mix menu text between frames\n"
+          "  -s  don't sleep; timestamp frames at the nominal rate (for making capture files)\n"
+          "  -w  wait before streaming so readers can attach (default 500)\n"
+          "  -o  write to a file or '-' for stdout instead of a new pty\n",
+          argv0);
+}
+
+static void sleepUntil(uint64_t deadline)
+{
+  struct timespec ts = { (time_t)(deadline / 1000000000ull), (long)(deadline % 1000000000ull) };
+  while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) != 0)
+  {
+  }
+}
+
+/** Sends the report frames found in path, spaced by their original
+	timestamps. Returns the number of frames sent or -1 on error. */
+static long replayFile(int fd, const char* path, uint64_t count)
+{
+  static streamParser_t parser;
+  static uint8_t buffer[64 * 1024];
+  int input = open(path, O_RDONLY | O_CLOEXEC);
+  if(input < 0)
+  {
+    perror(path);
+    return -1;
+  }
+  API_Stream_initParser(&parser);
+
+  long sent = 0;
+  uint32_t firstTimestamp = 0;
+  uint64_t start = 0;
+  ssize_t length;
+  while((length = read(input, buffer, sizeof(buffer))) > 0)
+  {
+    for(ssize_t i = 0; i < length; i++)
+    {
+      if(!API_Stream_parseByte(&parser, buffer[i]) || parser.frame.type != STREAM_TYPE_REPORT)
+      {
+        continue;
+      }
+      if(count != 0 && (uint64_t)sent == count)
+      {
+        close(input);
+        return sent;
+      }
+      if(sent == 0)
+      {
+        firstTimestamp = parser.frame.timestamp;
+        start = HOST_nowNs();
+      }
+      sleepUntil(start + (uint64_t)(parser.frame.timestamp - firstTimestamp) * 1000u);
+
+      uint8_t frame[STREAM_MAX_FRAME];
+      uint16_t frameLength = API_Stream_encodeFrame(STREAM_TYPE_REPORT, parser.frame.timestamp,
+                                                    parser.frame.payload, parser.frame.length, frame);
+      if(HOST_writeAll(fd, frame, frameLength) != 0)
+      {
+        perror("write");
+        close(input);
+        return -1;
+      }
+      sent++;
+    }
+  }
+  close(input);
+  return sent;
+}
+
+int main(int argc, char** argv)
+{
+  uint32_t rate = 125, waitMs = 500;
+  uint64_t count = 0;
+  uint8_t reportID = CRQ_ABSOLUTE_REPORT_ID;
+  bool text = false, simulated = false;
+  const char* output = NULL;
+  const char* replay = NULL;
+  int opt;
+
+  while((opt = getopt(argc, argv, "r:c:m:f:tsw:o:h")) != -1)
+  {
+    switch(opt)
+    {
+      case 'r': rate = (uint32_t)strtoul(optarg, NULL, 0); break;
+      case 'c': count = strtoull(optarg, NULL, 0); break;
+      case 'm':
+        reportID = strcmp(optarg, "rel") == 0 ? MOUSE_REPORT_ID 
+                 : strcmp(optarg, "ptp") == 0 ? PTP_REPORT_ID : CRQ_ABSOLUTE_REPORT_ID;
+        break;
+      case 'f': replay = optarg; break;
+      case 't': text = true; break;
+      case 's': simulated = true; break;
+      case 'w': waitMs = (uint32_t)strtoul(optarg, NULL, 0); break;
+      case 'o': output = optarg; break;
+      default: usage(argv[0]); return 2;
+    }
+  }
+
+  int fd, slave = -1;
+  if(output == NULL)
+  {
+    char path[128];
+    fd = HOST_openPty(path, sizeof(path), &slave);
+    if(fd < 0)
+    {
+      perror("pty");
+      return 1;
+    }
+    printf("%s\n", path);
+    fflush(stdout);
+  }
+  else if(strcmp(output, "-") == 0)
+  {
+    fd = STDOUT_FILENO;
+  }
+  else
+  {
+    fd = open(output, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if(fd < 0)
+    {
+      perror(output);
+      return 1;
+    }
+  }
+
+  uint64_t periodNs = rate ? 1000000000ull / rate : 0;
+  synth_t synth;
+  SYNTH_init(&synth, reportID, rate ? 1000000u / rate : 1000u, 0);
+
+  if(output == NULL && waitMs > 0)
+  {
+    usleep(waitMs * 1000u);
+  }
+
+  uint64_t start = HOST_nowNs(), deadline = start;
+  for(uint64_t n = 0; replay == NULL && (count == 0 || n < count); n++)
+  {
+    uint8_t packet[PACKET_SIZE];
+    uint8_t frame[STREAM_MAX_FRAME];
+    SYNTH_nextPacket(&synth, packet);
+
+    uint32_t timestamp = simulated ? (uint32_t)(n * (periodNs / 1000))
+                                   : (uint32_t)((HOST_nowNs() - start) / 1000);
+    uint16_t length = API_Stream_encodeFrame(STREAM_TYPE_REPORT, timestamp, packet, PACKET_SIZE, frame);
+    if(HOST_writeAll(fd, frame, length) != 0)
+    {
+      perror("write");
+      return 1;
+    }
+    if(text && n % 50 == 25)
+    {
+      static const char menu[] = "Absolute Mode Set\r\n";
+      HOST_writeAll(fd, menu, sizeof(menu) - 1);
+    }
+    if(periodNs && !simulated)
+    {
+      deadline += periodNs;
+      sleepUntil(deadline);
+    }
+  }
+
+  if(replay != NULL && replayFile(fd, replay, count) < 0)
+  {
+    return 1;
+  }
+
+  if(slave >= 0)
+  {
+    // let readers drain the pty before the slave side goes away
+    int pending = 0;
+    for(int i = 0; i < 200 && ioctl(slave, FIONREAD, &pending) == 0 && pending > 0; i++)
+    {
+      usleep(10000);
+    }
+    close(slave);
+  }
+  if(fd != STDOUT_FILENO)
+  {
+    close(fd);
+  }
+  return 0;
+}
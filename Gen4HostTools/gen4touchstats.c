@@ -0,0 +1,407 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+/** gen4touchstats - touch statistics summaries (see API_C2_Stats.h).
+
+	Given a tty it sends 'b' and a STATS command for a summary every
+	interval_ms, prints count summaries as they come and stops the
+	statistics again. Given a regular file it prints the summaries captured
+	in it.
+
+	With -s it checks the fixed point statistics instead, on synthetic
+	reports: a finger that holds still with Gaussian noise of a known size,
+	moves, holds still again and lifts, with a second finger moving all the
+	time and occasional low confidence and palm samples. Each summary is
+	checked against the same statistics worked out in double precision, and
+	its size compared with the report frames it replaces. Exits non-zero if
+	the noise differs from the reference by more than NOISE_TOLERANCE or
+	the counts differ at all.
+
+	usage: gen4touchstats [-i interval_ms] [-n count] [-w timeout_ms] <tty or file>
+	       gen4touchstats -s [-i interval_ms] [-n count] [-g noise] */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <math.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "API_C2_Stats.h"
+#include "API_Command.h"
+#include "API_Stream.h"
+#include "HostSynth.h"
+#include "HostUtil.h"
+
+#define NOISE_TOLERANCE (2)       /**< 1/256 counts */
+#define REPORT_US       (8000)
+
+static void usage(const char* argv0)
+{
+  fprintf(stderr,
+          "usage: %s [-i interval_ms] [-n count] [-w timeout_ms] <tty or file>\n"
+          "       %s -s [-i interval_ms] [-n count] [-g noise]\n"
+          "  -i  summary interval (default %u)\n"
+          "  -n  summaries to print or check (default 10)\n"
+          "  -w  give up waiting for a summary after this long (default 5000)\n"
+          "  -s  check against double precision on synthetic reports\n"
+          "  -g  standard deviation of the synthetic noise, counts (default 1.5)\n",
+          argv0, argv0, STATS_INTERVAL_MS);
+}
+
+static void printSummary(const statsSummary_t* summary)
+{
+  printf("window %u ms: %u reports, interval %u-%u us, %u pauses, histogram", summary->windowMs,
+         summary->reports, summary->intervalMinUs, summary->intervalMaxUs, summary->pauses);
+  for(int b = 0; b < STATS_INTERVAL_BUCKETS; b++)
+  {
+    printf(" %u", summary->histogram[b]);
+  }
+  printf("\n");
+  for(int i = 0; i < STATS_FINGERS; i++)
+  {
+    const statsFinger_t* f = &summary->fingers[i];
+    if(summary->fingerMask & (1 << i))
+    {
+      printf("  F%d samples %u palm %u lowconf %u contacts %u avg/max %u/%u ms still %u at %u,%u noise %.2f,%.2f\n",
+             i, f->samples, f->palmRejected, f->lowConfidence, f->contacts, f->contactMsAvg, f->contactMsMax,
+             f->stillSamples, f->meanX, f->meanY, f->noiseX / 256.0, f->noiseY / 256.0);
+    }
+  }
+}
+
+/************************************************************/
+/************************************************************/
+/******************* LIVE AND CAPTURED **********************/
+
+static int sendStatsCommand(int fd, uint16_t intervalMs)
+{
+  uint8_t request[COMMAND_HEADER_SIZE + 2] = { 0x54, 0x53, COMMAND_STATS,
+                                               (uint8_t)(intervalMs & 0xFF), (uint8_t)(intervalMs >> 8) };
+  uint8_t frame[STREAM_MAX_FRAME];
+  uint16_t length = API_Stream_encodeFrame(STREAM_TYPE_COMMAND, 0, request, sizeof(request), frame);
+  return HOST_writeAll(fd, frame, length);
+}
+
+static int readSummaries(const char* source, uint16_t intervalMs, uint32_t count, int timeoutMs)
+{
+  struct stat st;
+  if(stat(source, &st) != 0)
+  {
+    fprintf(stderr, "%s: %s\n", source, strerror(errno));
+    return 1;
+  }
+  bool live = S_ISCHR(st.st_mode);
+  int fd = live ? HOST_openSerial(source) : open(source, O_RDONLY | O_CLOEXEC);
+  if(fd < 0 || (live && (HOST_writeAll(fd, "b", 1) != 0 || sendStatsCommand(fd, intervalMs) != 0)))
+  {
+    fprintf(stderr, "%s: %s\n", source, strerror(errno));
+    return 1;
+  }
+
+  static streamParser_t parser;
+  static uint8_t buffer[4096];
+  uint32_t printed = 0;
+  uint64_t bytes = 0, lastSummary = HOST_nowNs();
+  API_Stream_initParser(&parser);
+  while(printed < count)
+  {
+    if(live)
+    {
+      int remaining = timeoutMs - (int)((HOST_nowNs() - lastSummary) / 1000000);
+      struct pollfd pfd = { fd, POLLIN, 0 };
+      if(remaining <= 0 || poll(&pfd, 1, remaining) <= 0)
+      {
+        fprintf(stderr, "%s: no summary for %d ms\n", source, timeoutMs);
+        break;
+      }
+    }
+    ssize_t length = read(fd, buffer, sizeof(buffer));
+    if(length < 0 && (errno == EINTR || errno == EAGAIN))
+    {
+      continue;
+    }
+    if(length <= 0)
+    {
+      break;
+    }
+    bytes += (uint64_t)length;
+    for(ssize_t i = 0; i < length && printed < count; i++)
+    {
+      statsSummary_t summary;
+      if(API_Stream_parseByte(&parser, buffer[i]) && parser.frame.type == STREAM_TYPE_STATS)
+      {
+        if(API_C2_decodeStatsSummary(parser.frame.payload, parser.frame.length, &summary))
+        {
+          printSummary(&summary);
+          printed++;
+          lastSummary = HOST_nowNs();
+        }
+        else
+        {
+          fprintf(stderr, "unsupported summary version %u\n", parser.frame.payload[0]);
+        }
+      }
+    }
+  }
+  if(live)
+  {
+    sendStatsCommand(fd, 0);
+  }
+  close(fd);
+  printf("%u summaries, %llu bytes read\n", printed, (unsigned long long)bytes);
+  return printed == count ? 0 : 1;
+}
+
+/************************************************************/
+/************************************************************/
+/********************** SELF CHECK **************************/
+
+/** The same statistics as API_C2_Stats.c, in double precision */
+typedef struct
+{
+  bool     down;
+  uint32_t downUs;
+  uint16_t anchorX, anchorY;
+  uint32_t runCount;
+  double   runSumX, runSumY, runSumXX, runSumYY;
+  uint32_t samples, palm, lowConfidence, contacts, contactMsTotal, contactMsMax;
+  uint32_t stillSamples, stillDegrees;
+  double   m2X, m2Y;
+} refFinger_t;
+
+static void refFold(refFinger_t* f)
+{
+  if(f->runCount >= 2)
+  {
+    f->stillSamples += f->runCount;
+    f->stillDegrees += f->runCount - 1;
+    f->m2X += f->runSumXX - f->runSumX * f->runSumX / f->runCount;
+    f->m2Y += f->runSumYY - f->runSumY * f->runSumY / f->runCount;
+  }
+  f->runCount = 0;
+  f->runSumX = f->runSumY = f->runSumXX = f->runSumYY = 0;
+}
+
+static void refReport(refFinger_t* fingers, const report_t* report, uint32_t timestamp)
+{
+  for(int i = 0; i < STATS_FINGERS; i++)
+  {
+    refFinger_t* f = &fingers[i];
+    const fingerData_t* finger = &report->abs.fingers[i];
+    if(!(report->abs.contactFlags & (1 << i)))
+    {
+      if(f->down)
+      {
+        uint32_t ms = (timestamp - f->downUs) / 1000;
+        refFold(f);
+        f->down = false;
+        f->contacts++;
+        f->contactMsTotal += ms;
+        f->contactMsMax = ms > f->contactMsMax ? ms : f->contactMsMax;
+      }
+      continue;
+    }
+    bool palm = finger->palm & CRQ_ABSOLUTE_PALM_REJECT_MASK;
+    bool confident = finger->palm & CRQ_ABSOLUTE_CONFIDENCE_MASK;
+    f->samples++;
+    f->palm += palm;
+    f->lowConfidence += !confident;
+    if(!f->down)
+    {
+      f->down = true;
+      f->downUs = timestamp;
+    }
+    if(palm || !confident)
+    {
+      continue;
+    }
+    if(f->runCount == 0 || abs((int)finger->x - f->anchorX) > STATS_STILL_RADIUS
+       || abs((int)finger->y - f->anchorY) > STATS_STILL_RADIUS)
+    {
+      refFold(f);
+      f->anchorX = finger->x;
+      f->anchorY = finger->y;
+    }
+    f->runCount++;
+    f->runSumX += finger->x;
+    f->runSumY += finger->y;
+    f->runSumXX += (double)finger->x * finger->x;
+    f->runSumYY += (double)finger->y * finger->y;
+  }
+}
+
+/** Rounded Gaussian noise, Box-Muller */
+static int gaussian(synth_t* random, double sigma)
+{
+  double u1 = ((random->random = random->random * 1103515245u + 12345u) >> 8) / 16777216.0 + 1e-9;
+  double u2 = ((random->random = random->random * 1103515245u + 12345u) >> 8) / 16777216.0;
+  return (int)lrint(sigma * sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2));
+}
+
+/** The synthetic session at time ms: finger 0 holds still for 700 ms, moves
+    300 counts in 200 ms, holds still for 700 ms and lifts for 300 ms; finger
+    1 circles; a palm rests now and then */
+static void makeReport(synth_t* random, uint32_t ms, uint32_t frame, double sigma, report_t* report)
+{
+  uint32_t phase = ms % 1900;
+  memset(report, 0, sizeof(*report));
+  report->reportID = CRQ_ABSOLUTE_REPORT_ID;
+  if(phase < 1600)
+  {
+    int x = 1000, y = 700;
+    if(phase >= 700)
+    {
+      uint32_t moved = phase < 900 ? phase - 700 : 200;
+      x += (int)(moved * 3 / 2);
+      y += (int)(moved * 3 / 4);
+    }
+    report->abs.contactFlags |= 0x01;
+    report->abs.fingers[0].x = (uint16_t)(x + gaussian(random, sigma));
+    report->abs.fingers[0].y = (uint16_t)(y + gaussian(random, sigma));
+    report->abs.fingers[0].palm = (frame % 10 == 0) ? CRQ_ABSOLUTE_SINGLE_SAMPLE_MASK : CRQ_ABSOLUTE_CONFIDENCE_MASK;
+  }
+  double angle = ms / 1000.0;
+  report->abs.contactFlags |= 0x02;
+  report->abs.fingers[1].x = (uint16_t)(1024 + 400 * cos(angle) + gaussian(random, sigma));
+  report->abs.fingers[1].y = (uint16_t)(768 + 400 * sin(angle) + gaussian(random, sigma));
+  report->abs.fingers[1].palm = CRQ_ABSOLUTE_CONFIDENCE_MASK;
+  if(ms % 5000 < 400)
+  {
+    report->abs.contactFlags |= 0x04;
+    report->abs.fingers[2].x = 1800;
+    report->abs.fingers[2].y = 1400;
+    report->abs.fingers[2].palm = CRQ_ABSOLUTE_PALM_REJECT_MASK;
+  }
+}
+
+static int check(const char* name, uint32_t got, uint32_t want)
+{
+  if(got != want)
+  {
+    fprintf(stderr, "%s: %u, reference %u\n", name, got, want);
+    return 1;
+  }
+  return 0;
+}
+
+static int selfCheck(uint16_t intervalMs, uint32_t count, double sigma)
+{
+  static refFinger_t ref[STATS_FINGERS];
+  synth_t random;
+  uint32_t now = 0, frame = 0;
+  uint64_t reportBytes = 0, summaryBytes = 0, statsNs = 0, reports = 0;
+  int failures = 0;
+  double worstNoise = 0;
+
+  SYNTH_init(&random, CRQ_ABSOLUTE_REPORT_ID, REPORT_US, 0);
+  API_C2_startStats(intervalMs, now);
+  for(uint32_t s = 0; s < count; s++)
+  {
+    while(!API_C2_statsDue(now))
+    {
+      report_t report;
+      uint8_t packet[PACKET_SIZE];
+      reportView_t view;
+
+      makeReport(&random, now / 1000, frame++, sigma, &report);
+      SYNTH_encodeReport(&report, packet);
+      API_C2_viewReport(packet, &view);
+      uint64_t start = HOST_nowNs();
+      API_C2_statsReport(&view, now);
+      statsNs += HOST_nowNs() - start;
+      refReport(ref, &report, now);
+      reportBytes += STREAM_OVERHEAD + PACKET_SIZE;
+      reports++;
+      now += REPORT_US - 200 + (random.random >> 8) % 400;    // a little interval jitter
+    }
+
+    statsSummary_t summary, decoded;
+    uint8_t payload[STATS_SUMMARY_MAX_SIZE];
+    API_C2_takeStatsSummary(&summary, now);
+    uint16_t length = API_C2_encodeStatsSummary(&summary, payload);
+    summaryBytes += STREAM_OVERHEAD + length;
+    if(!API_C2_decodeStatsSummary(payload, length, &decoded) || memcmp(&decoded, &summary, sizeof(summary)) != 0)
+    {
+      fprintf(stderr, "summary %u does not decode to itself\n", s);
+      failures++;
+    }
+    printSummary(&summary);
+
+    for(int i = 0; i < STATS_FINGERS; i++)
+    {
+      refFinger_t* f = &ref[i];
+      const statsFinger_t* got = &summary.fingers[i];
+      refFold(f);
+      failures += check("samples", got->samples, f->samples);
+      failures += check("palm", got->palmRejected, f->palm);
+      failures += check("low confidence", got->lowConfidence, f->lowConfidence);
+      failures += check("contacts", got->contacts, f->contacts);
+      failures += check("longest contact", got->contactMsMax, f->contactMsMax);
+      failures += check("still samples", got->stillSamples, f->stillSamples);
+      if(f->stillDegrees > 0)
+      {
+        double wantX = sqrt(f->m2X / f->stillDegrees) * 256.0, wantY = sqrt(f->m2Y / f->stillDegrees) * 256.0;
+        double error = fmax(fabs(got->noiseX - wantX), fabs(got->noiseY - wantY));
+        worstNoise = fmax(worstNoise, error);
+        if(error > NOISE_TOLERANCE)
+        {
+          fprintf(stderr, "F%d noise %.2f,%.2f, reference %.3f,%.3f\n", i, got->noiseX / 256.0,
+                  got->noiseY / 256.0, wantX / 256.0, wantY / 256.0);
+          failures++;
+        }
+      }
+      uint16_t keepX = f->anchorX, keepY = f->anchorY;
+      bool down = f->down;
+      uint32_t downUs = f->downUs;
+      memset(f, 0, sizeof(*f));
+      f->anchorX = keepX;
+      f->anchorY = keepY;
+      f->down = down;
+      f->downUs = downUs;
+    }
+  }
+  API_C2_stopStats();
+
+  printf("noise %.2f counts synthesized, largest difference from double precision %.2f/256\n", sigma, worstNoise);
+  printf("%llu reports: %llu bytes as report frames, %llu as %u summaries (%.0fx less), %.0f ns per report\n",
+         (unsigned long long)reports, (unsigned long long)reportBytes, (unsigned long long)summaryBytes, count,
+         summaryBytes ? (double)reportBytes / summaryBytes : 0.0, reports ? (double)statsNs / reports : 0.0);
+  return failures == 0 ? 0 : 1;
+}
+
+/************************************************************/
+/************************************************************/
+/************************** MAIN ****************************/
+
+int main(int argc, char** argv)
+{
+  uint32_t intervalMs = STATS_INTERVAL_MS, count = 10;
+  int timeoutMs = 5000, opt;
+  double sigma = 1.5;
+  bool self = false;
+
+  while((opt = getopt(argc, argv, "i:n:w:g:sh")) != -1)
+  {
+    switch(opt)
+    {
+      case 'i': intervalMs = (uint32_t)strtoul(optarg, NULL, 0); break;
+      case 'n': count = (uint32_t)strtoul(optarg, NULL, 0); break;
+      case 'w': timeoutMs = atoi(optarg); break;
+      case 'g': sigma = atof(optarg); break;
+      case 's': self = true; break;
+      default: usage(argv[0]); return 2;
+    }
+  }
+  if(intervalMs == 0 || intervalMs > 0xFFFF || count == 0 || (self ? optind != argc : optind != argc - 1))
+  {
+    usage(argv[0]);
+    return 2;
+  }
+  return self ? selfCheck((uint16_t)intervalMs, count, sigma)
+              : readSummaries(argv[optind], (uint16_t)intervalMs, count, timeoutMs);
+}
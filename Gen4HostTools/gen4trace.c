@@ -0,0 +1,347 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+/** gen4trace - fetches the dev kit's trace points (see API_Trace.h) and
+	writes them as Chrome trace JSON, for chrome://tracing or
+	ui.perfetto.dev. Given a tty it sends 'x' and collects the dump; given a
+	regular file it decodes a dump captured earlier (e.g. with cat).
+
+	Each event ID gets its own timeline (DR, I2C, report, decode, output,
+	task). Timestamps are the board's micros(), unwrapped past 32 bits. An
+	end without a begin (its begin was overwritten in the ring) is dropped and
+	a begin still open at the end of the dump is closed at the last entry.
+	A summary of the spans is printed on stdout.
+
+	usage: gen4trace [-o json_file] [-w timeout_ms] <tty or file> */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "API_Stream.h"
+#include "API_Trace.h"
+#include "HostUtil.h"
+
+#define MAX_IDS (256)
+
+static void usage(const char* argv0)
+{
+  fprintf(stderr,
+          "usage: %s [-o json_file] [-w timeout_ms] <tty or file>\n"
+          "  -o  write the Chrome trace here (default trace.json)\n"
+          "  -w  give up waiting for the board after this long (default 5000)\n",
+          argv0);
+}
+
+/** Dump being reassembled from STREAM_TYPE_TRACE_ frames */
+typedef struct
+{
+  bool            haveInfo;
+  traceDumpInfo_t info;
+  uint8_t*        data;
+  uint32_t        received;     /**< Entries */
+} dump_t;
+
+/** Spans of one event ID */
+typedef struct
+{
+  uint32_t events;
+  uint32_t spans;
+  uint32_t dropped;             /**< Ends without a begin */
+  uint32_t depth;               /**< Begins not yet ended */
+  uint64_t openUs[8];           /**< Start of each open begin, innermost last */
+  uint64_t totalUs;
+  uint64_t maxUs;
+} idStats_t;
+
+/** Handles one frame. Returns true once the whole dump has arrived. */
+static bool collectFrame(dump_t* dump, const streamFrame_t* frame)
+{
+  if(frame->type == STREAM_TYPE_TRACE_INFO)
+  {
+    if(!API_Trace_decodeDumpInfo(frame->payload, frame->length, &dump->info))
+    {
+      fprintf(stderr, "unsupported trace dump version %u\n", frame->payload[0]);
+      return false;
+    }
+    free(dump->data);
+    dump->data = malloc(dump->info.count ? (size_t)dump->info.count * TRACE_ENTRY_SIZE : 1);
+    dump->received = 0;
+    dump->haveInfo = dump->data != NULL;
+  }
+  else if(frame->type == STREAM_TYPE_TRACE_DATA && dump->haveInfo && frame->length >= 4)
+  {
+    uint32_t index = frame->payload[0] | (frame->payload[1] << 8)
+                   | (frame->payload[2] << 16) | ((uint32_t)frame->payload[3] << 24);
+    uint32_t count = (frame->length - 4u) / TRACE_ENTRY_SIZE;
+    if(index + count <= dump->info.count)
+    {
+      memcpy(dump->data + (size_t)index * TRACE_ENTRY_SIZE, frame->payload + 4, (size_t)count * TRACE_ENTRY_SIZE);
+      dump->received += count;
+    }
+  }
+  return dump->haveInfo && dump->received >= dump->info.count;
+}
+
+static const char* timelineName(uint8_t id)
+{
+  switch(id)
+  {
+    case TRACE_ID_DR:     return "DR";
+    case TRACE_ID_I2C:    return "I2C";
+    case TRACE_ID_REPORT: return "report";
+    case TRACE_ID_DECODE: return "decode";
+    case TRACE_ID_OUTPUT: return "output";
+    case TRACE_ID_TASK:   return "task";
+    default:              return NULL;
+  }
+}
+
+/** Names one event: the timeline, made specific by the argument where it
+    says which device or task it was. */
+static void eventName(uint8_t id, uint16_t arg, char* name, size_t size)
+{
+  const char* timeline = timelineName(id);
+  if(id == TRACE_ID_I2C)
+  {
+    snprintf(name, size, "i2c 0x%02X", arg);
+  }
+  else if(id == TRACE_ID_TASK)
+  {
+    snprintf(name, size, "task %u", arg);
+  }
+  else if(timeline != NULL)
+  {
+    snprintf(name, size, "%s", timeline);
+  }
+  else
+  {
+    snprintf(name, size, "user %u", id);
+  }
+}
+
+static void writeEvent(FILE* out, const char* name, char phase, uint64_t us, uint8_t id,
+                       const char* argName, uint32_t arg)
+{
+  fprintf(out, ",\n{\"name\":\"%s\",\"cat\":\"gen4\",\"ph\":\"%c\",\"ts\":%llu,\"pid\":1,\"tid\":%u",
+          name, phase, (unsigned long long)us, id);
+  if(phase == TRACE_PHASE_INSTANT)
+  {
+    fprintf(out, ",\"s\":\"t\"");
+  }
+  if(argName != NULL)
+  {
+    fprintf(out, ",\"args\":{\"%s\":%u}", argName, arg);
+  }
+  fprintf(out, "}");
+}
+
+/** Writes the trace and fills in stats. Returns the time covered, in us. */
+static uint64_t writeTrace(FILE* out, const dump_t* dump, idStats_t* stats)
+{
+  bool named[MAX_IDS] = { false };
+  uint64_t now = 0, startUs = 0;
+  uint32_t last = 0;
+  char name[32];
+
+  // the process name first, so every event after it starts with a comma
+  fprintf(out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+  fprintf(out, "\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"Gen4DevKit\"}}");
+  for(uint32_t n = 0; n < dump->info.count; n++)
+  {
+    traceEntry_t entry;
+    API_Trace_decodeEntry(dump->data + (size_t)n * TRACE_ENTRY_SIZE, &entry);
+    now = (n == 0) ? entry.timestamp : now + (uint32_t)(entry.timestamp - last);
+    last = entry.timestamp;
+    startUs = (n == 0) ? now : startUs;
+
+    idStats_t* id = &stats[entry.id];
+    if(!named[entry.id])
+    {
+      const char* timeline = timelineName(entry.id);
+      fprintf(out, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"", entry.id);
+      if(timeline != NULL)
+      {
+        fprintf(out, "%s\"}}", timeline);
+      }
+      else
+      {
+        fprintf(out, "user %u\"}}", entry.id);
+      }
+      named[entry.id] = true;
+    }
+    eventName(entry.id, entry.arg, name, sizeof(name));
+    id->events++;
+    switch(entry.phase)
+    {
+      case TRACE_PHASE_BEGIN:
+        if(id->depth < sizeof(id->openUs) / sizeof(id->openUs[0]))
+        {
+          id->openUs[id->depth++] = now;
+          writeEvent(out, name, TRACE_PHASE_BEGIN, now, entry.id, "arg", entry.arg);
+        }
+        break;
+      case TRACE_PHASE_END:
+        if(id->depth == 0)
+        {
+          id->dropped++;
+          break;
+        }
+        {
+          uint64_t span = now - id->openUs[--id->depth];
+          id->spans++;
+          id->totalUs += span;
+          id->maxUs = span > id->maxUs ? span : id->maxUs;
+        }
+        writeEvent(out, name, TRACE_PHASE_END, now, entry.id, "arg", entry.arg);
+        break;
+      case TRACE_PHASE_COUNTER:
+        writeEvent(out, name, TRACE_PHASE_COUNTER, now, entry.id, "value", entry.arg);
+        break;
+      default:
+        writeEvent(out, name, TRACE_PHASE_INSTANT, now, entry.id, "arg", entry.arg);
+        break;
+    }
+  }
+  for(uint32_t i = 0; i < MAX_IDS; i++)
+  {
+    while(stats[i].depth > 0)
+    {
+      stats[i].depth--;
+      eventName((uint8_t)i, 0, name, sizeof(name));
+      writeEvent(out, name, TRACE_PHASE_END, now, (uint8_t)i, NULL, 0);
+    }
+  }
+  fprintf(out, "\n]}\n");
+  return now - startUs;
+}
+
+int main(int argc, char** argv)
+{
+  const char* output = "trace.json";
+  int timeoutMs = 5000, opt;
+
+  while((opt = getopt(argc, argv, "o:w:h")) != -1)
+  {
+    switch(opt)
+    {
+      case 'o': output = optarg; break;
+      case 'w': timeoutMs = atoi(optarg); break;
+      default: usage(argv[0]); return 2;
+    }
+  }
+  if(optind != argc - 1)
+  {
+    usage(argv[0]);
+    return 2;
+  }
+  const char* source = argv[optind];
+
+  struct stat st;
+  if(stat(source, &st) != 0)
+  {
+    fprintf(stderr, "%s: %s\n", source, strerror(errno));
+    return 1;
+  }
+  bool live = S_ISCHR(st.st_mode);
+  int fd = live ? HOST_openSerial(source) : open(source, O_RDONLY | O_CLOEXEC);
+  if(fd < 0)
+  {
+    fprintf(stderr, "%s: %s\n", source, strerror(errno));
+    return 1;
+  }
+  if(live && HOST_writeAll(fd, "x", 1) != 0)
+  {
+    fprintf(stderr, "%s: %s\n", source, strerror(errno));
+    return 1;
+  }
+
+  static streamParser_t parser;
+  static uint8_t buffer[64 * 1024];
+  dump_t dump = { 0 };
+  bool complete = false;
+  API_Stream_initParser(&parser);
+
+  uint64_t start = HOST_nowNs();
+  while(!complete)
+  {
+    if(live)
+    {
+      int remaining = timeoutMs - (int)((HOST_nowNs() - start) / 1000000);
+      struct pollfd pfd = { fd, POLLIN, 0 };
+      if(remaining <= 0 || poll(&pfd, 1, remaining) <= 0)
+      {
+        break;
+      }
+    }
+    ssize_t count = read(fd, buffer, sizeof(buffer));
+    if(count < 0 && (errno == EINTR || errno == EAGAIN))
+    {
+      continue;
+    }
+    if(count <= 0)
+    {
+      break;
+    }
+    for(ssize_t i = 0; i < count && !complete; i++)
+    {
+      if(API_Stream_parseByte(&parser, buffer[i]))
+      {
+        complete = collectFrame(&dump, &parser.frame);
+      }
+    }
+  }
+  close(fd);
+
+  if(!complete)
+  {
+    fprintf(stderr, "%s: incomplete dump (%u of %u entries, %lu bad frames)\n", source,
+            dump.received, dump.haveInfo ? dump.info.count : 0, (unsigned long)parser.badFrames);
+    return 1;
+  }
+  if(dump.info.count == 0)
+  {
+    fprintf(stderr, "%s: no trace entries (is CONFIG_TRACE_ENABLE set?)\n", source);
+    free(dump.data);
+    return 1;
+  }
+
+  FILE* out = fopen(output, "w");
+  if(out == NULL)
+  {
+    fprintf(stderr, "%s: %s\n", output, strerror(errno));
+    return 1;
+  }
+  static idStats_t stats[MAX_IDS];
+  uint64_t coveredUs = writeTrace(out, &dump, stats);
+  fclose(out);
+
+  printf("%u entries over %.3f ms (%u recorded, %u overwritten), written to %s\n", dump.info.count,
+         coveredUs / 1000.0, dump.info.recorded, dump.info.overwritten, output);
+  printf("%-10s %8s %8s %10s %10s %8s\n", "timeline", "events", "spans", "avg us", "max us", "dropped");
+  for(uint32_t i = 0; i < MAX_IDS; i++)
+  {
+    if(stats[i].events == 0)
+    {
+      continue;
+    }
+    char name[32];
+    const char* timeline = timelineName((uint8_t)i);
+    if(timeline == NULL)
+    {
+      snprintf(name, sizeof(name), "user %u", i);
+      timeline = name;
+    }
+    printf("%-10s %8u %8u %10.1f %10llu %8u\n", timeline, stats[i].events, stats[i].spans,
+           stats[i].spans ? (double)stats[i].totalUs / stats[i].spans : 0.0,
+           (unsigned long long)stats[i].maxUs, stats[i].dropped);
+  }
+  free(dump.data);
+  return 0;
+}
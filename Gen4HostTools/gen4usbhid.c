@@ -0,0 +1,367 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+/** gen4usbhid - checks the USB HID passthrough translation (API_UsbHid.h)
+	and times what it adds to each report read.
+
+	The checks feed scripted report packets through API_UsbHid_report, the
+	call reportTask makes, and compare what a USB host would have seen
+	(SIMHW_getUsbHost) with what the reports mean: mouse movement and
+	buttons, keys pressed and released, touch contacts pressed, moved and
+	lifted at mapped positions, the pad's button as the left button, nothing
+	sent for a report that changes nothing, everything let go when
+	passthrough is turned off, and nothing sent to an interface the USB Type
+	does not have.
+
+	The timing runs -n synthetic absolute and mouse reports (HostSynth.h)
+	through the same call and, for comparison, through a stand-in for the
+	text the sketch prints for each report (printDataReport), which
+	passthrough skips. On the host the USB stand-ins take no time, so the
+	passthrough times are the decode and translation; on the board 'S'
+	prints the same measurement with the real USB stack behind it.
+
+	Exits non-zero if a check fails.
+
+	usage: gen4usbhid [-n reports] */
+
+#define _GNU_SOURCE
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "API_C2_Report.h"
+#include "API_Hardware.h"
+#include "API_UsbHid.h"
+#include "HostSynth.h"
+#include "HostUtil.h"
+#include "SimHardware.h"
+
+#define ALL_INTERFACES ((1 << USB_HID_MOUSE) | (1 << USB_HID_KEYBOARD) | (1 << USB_HID_TOUCH))
+#define TEXT_SIZE      (1024)
+
+/** The sketch's map (usbHidMap_g) */
+static const mapConfig_t map_g = { 0, 2047, 0, 1535, 0, true, false, false, MAP_ROTATE_0,
+                                   USB_HID_TOUCH_RANGE, USB_HID_TOUCH_RANGE, NULL, NULL };
+
+static uint32_t checks_g = 0;
+static uint32_t failures_g = 0;
+
+static void usage(const char* argv0)
+{
+  fprintf(stderr,
+          "usage: %s [-n reports]\n"
+          "  -n  synthetic reports of each kind to time (default 200000)\n",
+          argv0);
+}
+
+static void check(bool ok, const char* what)
+{
+  checks_g++;
+  if(!ok)
+  {
+    failures_g++;
+    printf("FAIL: %s\n", what);
+  }
+}
+
+/************************************************************/
+/************************************************************/
+/************************* REPORTS **************************/
+
+static void send(const report_t* report)
+{
+  uint8_t packet[PACKET_SIZE];
+  SYNTH_encodeReport(report, packet);
+  API_UsbHid_report(packet, API_Hardware_micros());
+}
+
+static void sendMouse(uint8_t buttons, int8_t x, int8_t y, int8_t wheel, int8_t pan)
+{
+  report_t report;
+  memset(&report, 0, sizeof(report));
+  report.reportID = MOUSE_REPORT_ID;
+  report.mouse.buttons = buttons;
+  report.mouse.xDelta = x;
+  report.mouse.yDelta = y;
+  report.mouse.scrollDelta = wheel;
+  report.mouse.panDelta = pan;
+  send(&report);
+}
+
+static void sendKeys(uint8_t modifier, uint8_t key1, uint8_t key2)
+{
+  report_t report;
+  memset(&report, 0, sizeof(report));
+  report.reportID = KEYBOARD_REPORT_ID;
+  report.keyboard.modifier = modifier;
+  report.keyboard.keycode[0] = key1;
+  report.keyboard.keycode[1] = key2;
+  send(&report);
+}
+
+/** Fingers of contacts at (x[i], y[i]); palm gives each one's palm byte */
+static void sendTouch(uint8_t contacts, uint8_t buttons, const uint16_t* x, const uint16_t* y, const uint8_t* palm)
+{
+  report_t report;
+  memset(&report, 0, sizeof(report));
+  report.reportID = CRQ_ABSOLUTE_REPORT_ID;
+  report.abs.contactFlags = contacts;
+  report.abs.buttons = buttons;
+  for(uint8_t i = 0; i < 5; i++)
+  {
+    report.abs.fingers[i].x = x[i];
+    report.abs.fingers[i].y = y[i];
+    report.abs.fingers[i].palm = palm != NULL ? palm[i] : CRQ_ABSOLUTE_CONFIDENCE_MASK;
+  }
+  send(&report);
+}
+
+/** Within the mapping's 2 units of the exact scaling (see API_C2_Map.h) */
+static bool mapped(uint16_t value, uint16_t raw, uint16_t rawMax)
+{
+  int32_t exact = (int32_t)((uint64_t)raw * (USB_HID_TOUCH_RANGE - 1) / rawMax);
+  return value + 2 >= exact && value <= exact + 2;
+}
+
+static uint32_t reportsOf(uint8_t interface)
+{
+  return SIMHW_getUsbHost()->reports[interface];
+}
+
+/************************************************************/
+/************************************************************/
+/************************* CHECKS ***************************/
+
+static void checkMouse(void)
+{
+  const simUsbHost_t* host = SIMHW_getUsbHost();
+
+  sendMouse(0, 3, -2, 0, 0);
+  sendMouse(BUTTON_1_MASK, 5, 4, 1, -1);
+  check(reportsOf(USB_HID_MOUSE) == 2, "mouse: a report per mouse report that moves");
+  check(host->pointerX == 8 && host->pointerY == 2 && host->wheel == 1 && host->pan == -1,
+        "mouse: movement, wheel and pan passed on");
+  check(host->mouse.buttons == BUTTON_1_MASK, "mouse: left button held");
+  sendMouse(BUTTON_1_MASK, 0, 0, 0, 0);
+  check(reportsOf(USB_HID_MOUSE) == 2, "mouse: nothing sent without movement or a button change");
+  sendMouse(BUTTON_1_MASK | BUTTON_2_MASK | BUTTON_3_MASK, 0, 0, 0, 0);
+  check(reportsOf(USB_HID_MOUSE) == 3 && host->mouse.buttons == 0x07, "mouse: right and middle buttons");
+  sendMouse(0, 0, 0, 0, 0);
+  check(reportsOf(USB_HID_MOUSE) == 4 && host->mouse.buttons == 0, "mouse: buttons released");
+  sendMouse(0, -128, 127, 0, 0);
+  check(host->pointerX == 8 - 128 && host->pointerY == 2 + 127, "mouse: full range movement");
+}
+
+static void checkKeyboard(void)
+{
+  const simUsbHost_t* host = SIMHW_getUsbHost();
+
+  sendKeys(KEYBOARD_MODIFIER_LEFT_SHIFT_KEY_MASK, 0x04, 0);
+  check(reportsOf(USB_HID_KEYBOARD) == 1 && host->keyboard.modifier == KEYBOARD_MODIFIER_LEFT_SHIFT_KEY_MASK
+        && host->keyboard.keys[0] == 0x04, "keyboard: shift and A pressed");
+  sendKeys(KEYBOARD_MODIFIER_LEFT_SHIFT_KEY_MASK, 0x04, 0);
+  check(reportsOf(USB_HID_KEYBOARD) == 1, "keyboard: the same keys again send nothing");
+  sendKeys(0, 0x04, 0x05);
+  check(reportsOf(USB_HID_KEYBOARD) == 2 && host->keyboard.modifier == 0 && host->keyboard.keys[1] == 0x05,
+        "keyboard: shift up, B down");
+  sendKeys(0, 0, 0);
+  check(reportsOf(USB_HID_KEYBOARD) == 3 && host->keyboard.keys[0] == 0 && host->keyboard.keys[1] == 0,
+        "keyboard: all keys up");
+}
+
+static void checkTouch(void)
+{
+  const simUsbHost_t* host = SIMHW_getUsbHost();
+  uint16_t x[5] = { 1024, 100, 0, 0, 0 };
+  uint16_t y[5] = { 768, 1500, 0, 0, 0 };
+  uint8_t palm[5] = { CRQ_ABSOLUTE_CONFIDENCE_MASK | CRQ_ABSOLUTE_PALM_REJECT_MASK, CRQ_ABSOLUTE_CONFIDENCE_MASK,
+                      0, 0, 0 };
+
+  sendTouch(0x01, 0, x, y, NULL);
+  check(reportsOf(USB_HID_TOUCH) == 1 && host->touch.contacts == 0x01, "touch: first finger pressed");
+  check(mapped(host->touch.x[0], 1024, 2047) && mapped(host->touch.y[0], 768, 1535),
+        "touch: position mapped to the touch screen's range");
+  sendTouch(0x01, 0, x, y, NULL);
+  check(reportsOf(USB_HID_TOUCH) == 1, "touch: a finger that did not move sends nothing");
+  sendTouch(0x03, 0, x, y, NULL);
+  check(reportsOf(USB_HID_TOUCH) == 2 && host->touch.contacts == 0x03
+        && mapped(host->touch.x[1], 100, 2047) && mapped(host->touch.y[1], 1500, 1535), "touch: second finger pressed");
+  x[1] = 2047;
+  y[1] = 1535;
+  sendTouch(0x03, 0, x, y, NULL);
+  check(reportsOf(USB_HID_TOUCH) == 3 && host->touch.x[1] == USB_HID_TOUCH_RANGE - 1
+        && host->touch.y[1] == USB_HID_TOUCH_RANGE - 1, "touch: second finger moved to the far corner");
+  sendTouch(0x03, 0, x, y, palm);
+  check(host->touch.contacts == 0x02 && host->releases == 1, "touch: a palm is lifted");
+  sendTouch(0x03, BUTTON_8_MASK, x, y, palm);
+  check(reportsOf(USB_HID_MOUSE) == 1 && host->mouse.buttons == BUTTON_1_MASK && reportsOf(USB_HID_TOUCH) == 4,
+        "touch: the pad's button is the left button, the contacts are unchanged");
+  sendTouch(0, 0, x, y, NULL);
+  check(host->touch.contacts == 0 && host->releases == 2 && host->mouse.buttons == 0,
+        "touch: last finger lifted, button released");
+  check(host->pointerX == 0 && host->pointerY == 0, "touch: the button report does not move the pointer");
+}
+
+static void checkEnable(void)
+{
+  const simUsbHost_t* host = SIMHW_getUsbHost();
+  uint16_t x[5] = { 500, 600, 700, 800, 900 };
+  uint16_t y[5] = { 500, 600, 700, 800, 900 };
+
+  sendTouch(0x1F, BUTTON_1_MASK, x, y, NULL);
+  sendKeys(KEYBOARD_MODIFIER_LEFT_CTRL_KEY_MASK, 0x06, 0);
+  check(host->touch.contacts == 0x1F && host->mouse.buttons != 0 && host->keyboard.keys[0] != 0,
+        "off: five fingers, a button and a key held");
+  API_UsbHid_enable(false);
+  check(host->touch.contacts == 0 && host->mouse.buttons == 0 && host->keyboard.modifier == 0
+        && host->keyboard.keys[0] == 0, "off: everything let go");
+  uint32_t before = reportsOf(USB_HID_MOUSE);
+  sendMouse(BUTTON_1_MASK, 1, 1, 0, 0);
+  check(reportsOf(USB_HID_MOUSE) == before, "off: reports are not forwarded");
+  API_UsbHid_enable(true);
+  sendTouch(0x01, 0, x, y, NULL);
+  check(host->touch.contacts == 0x01 && host->presses > 0, "on again: a finger down is sent as new");
+  sendTouch(0, 0, x, y, NULL);
+}
+
+static void checkInterfaces(void)
+{
+  const usbHidStats_t* stats = API_UsbHid_getStats();
+  report_t report;
+
+  SIMHW_setUsbInterfaces(1 << USB_HID_MOUSE);
+  uint32_t unsupported = stats->unsupported;
+  sendKeys(0, 0x07, 0);
+  check(reportsOf(USB_HID_KEYBOARD) == 0 && stats->unsupported == unsupported + 1,
+        "interfaces: no keyboard in the USB Type, counted and not sent");
+  sendKeys(0, 0, 0);
+  SIMHW_setUsbInterfaces(ALL_INTERFACES);
+
+  uint32_t unchanged = stats->unchanged;
+  memset(&report, 0, sizeof(report));
+  report.reportID = 0x42;
+  send(&report);
+  check(stats->unchanged == unchanged + 1 && reportsOf(USB_HID_MOUSE) + reportsOf(USB_HID_TOUCH) == 0,
+        "interfaces: an unknown report ID sends nothing");
+}
+
+/** Runs one group of checks, if any, from a clean start */
+static void run(void (*checks)(void))
+{
+  API_UsbHid_enable(false);
+  API_UsbHid_enable(true);
+  SIMHW_resetUsbHost();
+  if(checks != NULL)
+  {
+    checks();
+  }
+}
+
+/************************************************************/
+/************************************************************/
+/************************* TIMING ***************************/
+
+/** What the sketch prints for a report, into text (see printDataReport) */
+static size_t formatReport(const report_t* report, char* text)
+{
+  size_t length = 0;
+  if(API_C2_getReportKind(report->reportID) == REPORT_KIND_MOUSE)
+  {
+    return (size_t)snprintf(text, TEXT_SIZE, "Report ID:\t0x%X\nButtons:\t0b%u\nX Delta:\t%d\nY Delta:\t%d\n"
+                            "Scroll Delta:\t%d\nPan Delta:\t%d\n\n", report->reportID, report->mouse.buttons,
+                            report->mouse.xDelta, report->mouse.yDelta, report->mouse.scrollDelta,
+                            report->mouse.panDelta);
+  }
+  length += (size_t)snprintf(text, TEXT_SIZE, "Report ID:\t0x%X\nContact Flags:\t0b%u\nButtons:\t0b%u\n",
+                             report->reportID, report->abs.contactFlags, report->abs.buttons);
+  for(uint8_t i = 0; i < 5; i++)
+  {
+    const fingerData_t* finger = &report->abs.fingers[i];
+    length += (size_t)snprintf(text + length, TEXT_SIZE - length,
+                               "Finger%u:\n    Palm Flags:\t0b%u\n    Valid:\t%s\n    (x,y):\t(%u,%u)\n", i,
+                               finger->palm, API_C2_isFingerValid((report_t*)report, i) ? "Yes" : "No",
+                               finger->x, finger->y);
+  }
+  text[length++] = '\n';
+  return length;
+}
+
+static void timeKind(const char* name, uint8_t reportID, uint32_t count)
+{
+  uint8_t* packets = malloc((size_t)count * PACKET_SIZE);
+  synth_t synth;
+  char text[TEXT_SIZE];
+  uint64_t textBytes = 0;
+
+  SYNTH_init(&synth, reportID, 8000, 1);
+  for(uint32_t n = 0; n < count; n++)
+  {
+    SYNTH_nextPacket(&synth, &packets[(size_t)n * PACKET_SIZE]);
+  }
+
+  run(NULL);
+  API_UsbHid_resetStats();
+  uint64_t start = HOST_nowNs();
+  for(uint32_t n = 0; n < count; n++)
+  {
+    API_UsbHid_report(&packets[(size_t)n * PACKET_SIZE], API_Hardware_micros());
+  }
+  uint64_t passthroughNs = HOST_nowNs() - start;
+
+  start = HOST_nowNs();
+  for(uint32_t n = 0; n < count; n++)
+  {
+    report_t report;
+    API_C2_decodeReport(&packets[(size_t)n * PACKET_SIZE], &report);
+    textBytes += formatReport(&report, text);
+  }
+  uint64_t textNs = HOST_nowNs() - start;
+
+  const usbHidStats_t* stats = API_UsbHid_getStats();
+  const simUsbHost_t* host = SIMHW_getUsbHost();
+  printf("%-9s %8u %8u %9u %11.1f %10.1f %11.1f %10.1f\n", name, count,
+         host->reports[USB_HID_MOUSE] + host->reports[USB_HID_KEYBOARD] + host->reports[USB_HID_TOUCH],
+         stats->unchanged, (double)passthroughNs / count, (double)stats->maxCostUs, (double)textNs / count,
+         (double)textBytes / count);
+  check(stats->reports == count, "timing: every report passed through");
+  free(packets);
+}
+
+/************************************************************/
+/************************************************************/
+/************************** MAIN ****************************/
+
+int main(int argc, char** argv)
+{
+  uint32_t count = 200000;
+  int opt;
+
+  while((opt = getopt(argc, argv, "n:h")) != -1)
+  {
+    switch(opt)
+    {
+      case 'n': count = (uint32_t)strtoul(optarg, NULL, 0); break;
+      default: usage(argv[0]); return 2;
+    }
+  }
+  if(count == 0)
+  {
+    usage(argv[0]);
+    return 2;
+  }
+
+  API_Hardware_init();
+  check(API_UsbHid_setMap(&map_g), "the sketch's map compiles");
+  run(checkMouse);
+  run(checkKeyboard);
+  run(checkTouch);
+  run(checkEnable);
+  run(checkInterfaces);
+  printf("translation: %u checks, %u failed\n\n", checks_g, failures_g);
+
+  printf("%-9s %8s %8s %9s %11s %10s %11s %10s\n", "reports", "count", "sent", "unchanged", "usb ns/rep",
+         "usb max us", "text ns/rep", "text bytes");
+  timeKind("absolute", CRQ_ABSOLUTE_REPORT_ID, count);
+  timeKind("mouse", MOUSE_REPORT_ID, count);
+  return failures_g == 0 ? 0 : 1;
+}
@@ -0,0 +1,363 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+/** gen4viewbench - compares the two ways the sketch can turn report packets
+	into touch events: decoding every packet into a report_t and keeping a
+	copy of the last report of each kind, or reading it in place through a
+	reportView_t and keeping a reportState_t. The view accessors are first
+	checked against API_C2_decodeReport for every packet, and both event paths
+	must find the same events, before anything is timed. Also prints what the
+	sketch's report queue and previous state cost in RAM either way.
+
+	usage: gen4viewbench [-n packets] [-r repeats] */
+
+#define _GNU_SOURCE
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "API_C2_Report.h"
+#include "HostSynth.h"
+#include "HostUtil.h"
+
+#define QUEUE_DEPTH (8)   /**< REPORT_QUEUE_DEPTH of the sketch */
+
+/************************************************************/
+/************************************************************/
+/********************* EVENT DETECTION **********************/
+
+/** Event detection as the sketch did it: the whole report is decoded and
+	the previous one of its kind kept by value. Returns the number of events. */
+static uint32_t reportEvents(uint8_t* packet, report_t* prev)
+{
+  report_t report;
+  uint32_t events = 0;
+
+  API_C2_decodeReport(packet, &report);
+  switch(API_C2_getReportKind(report.reportID))
+  {
+    case REPORT_KIND_ABSOLUTE:
+      for(uint8_t i = 0; i < 5; i++)
+      {
+        events += API_C2_isFingerContacted(&report, i) != API_C2_isFingerContacted(prev, i);
+        events += API_C2_isFingerValid(&report, i) != API_C2_isFingerValid(prev, i);
+      }
+      events += (uint32_t)__builtin_popcount(report.abs.buttons ^ prev->abs.buttons);
+      break;
+    case REPORT_KIND_MOUSE:
+      events += (uint32_t)__builtin_popcount(report.mouse.buttons ^ prev->mouse.buttons);
+      break;
+    case REPORT_KIND_KEYBOARD:
+      events += (uint32_t)__builtin_popcount(report.keyboard.modifier ^ prev->keyboard.modifier);
+      for(uint8_t i = 0; i < 6; i++)
+      {
+        events += report.keyboard.keycode[i] != prev->keyboard.keycode[i];
+      }
+      break;
+  }
+  *prev = report;
+  return events;
+}
+
+/** The same through a view, keeping a reportState_t. */
+static uint32_t viewEvents(const uint8_t* packet, reportState_t* prev)
+{
+  reportView_t view;
+  reportState_t state;
+  uint32_t events = 0;
+
+  API_C2_viewReport(packet, &view);
+  API_C2_saveReportState(&view, &state);
+  switch(API_C2_viewKind(&view))
+  {
+    case REPORT_KIND_ABSOLUTE:
+      events += (uint32_t)__builtin_popcount(state.contactFlags ^ prev->contactFlags);
+      events += (uint32_t)__builtin_popcount(state.validFlags ^ prev->validFlags);
+      events += (uint32_t)__builtin_popcount(state.buttons ^ prev->buttons);
+      break;
+    case REPORT_KIND_MOUSE:
+      events += (uint32_t)__builtin_popcount(state.buttons ^ prev->buttons);
+      break;
+    case REPORT_KIND_KEYBOARD:
+      events += (uint32_t)__builtin_popcount(state.modifier ^ prev->modifier);
+      for(uint8_t i = 0; i < 6; i++)
+      {
+        events += state.keycode[i] != prev->keycode[i];
+      }
+      break;
+  }
+  *prev = state;
+  return events;
+}
+
+/************************************************************/
+/************************************************************/
+/******************* HELPER FUNCTIONS ***********************/
+
+static void makeKeyboardPackets(uint8_t* packets, uint32_t count)
+{
+  uint32_t random = 12345;
+  for(uint32_t n = 0; n < count; n++)
+  {
+    report_t report;
+    memset(&report, 0, sizeof(report));
+    report.reportID = KEYBOARD_REPORT_ID;
+    random = random * 1103515245u + 12345u;
+    // keys change every few reports, like a gesture would send them
+    if((random >> 28) < 4)
+    {
+      report.keyboard.modifier = (uint8_t)(random >> 20);
+      report.keyboard.keycode[0] = (uint8_t)(random >> 12);
+    }
+    SYNTH_encodeReport(&report, &packets[n * PACKET_SIZE]);
+  }
+}
+
+static void makePackets(uint8_t reportID, uint8_t* packets, uint32_t count)
+{
+  synth_t synth;
+
+  if(reportID == KEYBOARD_REPORT_ID)
+  {
+    makeKeyboardPackets(packets, count);
+    return;
+  }
+  SYNTH_init(&synth, reportID == PTP_REPORT_ID ? CRQ_ABSOLUTE_REPORT_ID : reportID, 8000, 0);
+  for(uint32_t n = 0; n < count; n++)
+  {
+    uint8_t* packet = &packets[n * PACKET_SIZE];
+    SYNTH_nextPacket(&synth, packet);
+    if(reportID == PTP_REPORT_ID)
+    {
+      report_t report;
+      API_C2_decodeReport(packet, &report);
+      report.reportID = PTP_REPORT_ID;
+      SYNTH_encodeReport(&report, packet);
+    }
+  }
+}
+
+/** Checks every view accessor against the full decode of packet. */
+static bool sameAsDecode(uint8_t* packet)
+{
+  report_t report;
+  reportView_t view;
+  uint8_t valid = 0;
+
+  API_C2_decodeReport(packet, &report);
+  API_C2_viewReport(packet, &view);
+  if(API_C2_viewKind(&view) != API_C2_getReportKind(report.reportID))
+  {
+    return false;
+  }
+  switch(API_C2_viewKind(&view))
+  {
+    case REPORT_KIND_MOUSE:
+      return API_C2_viewButtons(&view) == report.mouse.buttons;
+    case REPORT_KIND_KEYBOARD:
+      for(uint8_t i = 0; i < 6; i++)
+      {
+        if(API_C2_viewKeycode(&view, i) != report.keyboard.keycode[i])
+        {
+          return false;
+        }
+      }
+      return API_C2_viewModifier(&view) == report.keyboard.modifier;
+    case REPORT_KIND_ABSOLUTE:
+      for(uint8_t i = 0; i < 5; i++)
+      {
+        fingerData_t finger;
+        API_C2_viewFinger(&view, i, &finger);
+        if(finger.x != report.abs.fingers[i].x || finger.y != report.abs.fingers[i].y
+           || finger.palm != report.abs.fingers[i].palm)
+        {
+          return false;
+        }
+        valid |= (uint8_t)(API_C2_isFingerValid(&report, i) << i);
+      }
+      return API_C2_viewContactFlags(&view) == report.abs.contactFlags
+             && API_C2_viewButtons(&view) == report.abs.buttons
+             && API_C2_viewValidFlags(&view) == valid;
+    default:
+      return false;
+  }
+}
+
+static void initPrevious(uint8_t reportID, report_t* prevReport, reportState_t* prevState)
+{
+  memset(prevReport, 0, sizeof(*prevReport));
+  memset(prevState, 0, sizeof(*prevState));
+  prevReport->reportID = reportID;
+  prevState->reportID = reportID;
+}
+
+static volatile uint32_t sink_g;
+
+/** Returns nanoseconds per packet for the report_t path */
+static double timeReports(uint8_t reportID, uint8_t* packets, uint32_t count, uint32_t repeats)
+{
+  report_t prev;
+  reportState_t unused;
+  uint32_t events = 0;
+
+  initPrevious(reportID, &prev, &unused);
+  uint64_t start = HOST_nowNs();
+  for(uint32_t r = 0; r < repeats; r++)
+  {
+    for(uint32_t n = 0; n < count; n++)
+    {
+      events += reportEvents(&packets[n * PACKET_SIZE], &prev);
+    }
+  }
+  uint64_t elapsed = HOST_nowNs() - start;
+  sink_g = events;
+  return (double)elapsed / ((double)count * repeats);
+}
+
+/** Returns nanoseconds per packet for the view path */
+static double timeViews(uint8_t reportID, const uint8_t* packets, uint32_t count, uint32_t repeats)
+{
+  report_t unused;
+  reportState_t prev;
+  uint32_t events = 0;
+
+  initPrevious(reportID, &unused, &prev);
+  uint64_t start = HOST_nowNs();
+  for(uint32_t r = 0; r < repeats; r++)
+  {
+    for(uint32_t n = 0; n < count; n++)
+    {
+      events += viewEvents(&packets[n * PACKET_SIZE], &prev);
+    }
+  }
+  uint64_t elapsed = HOST_nowNs() - start;
+  sink_g = events;
+  return (double)elapsed / ((double)count * repeats);
+}
+
+/** Nanoseconds per packet to get just the contact flags and buttons,
+	by full decode or through a view */
+static double timeFlags(bool useView, uint8_t* packets, uint32_t count, uint32_t repeats)
+{
+  uint32_t checksum = 0;
+
+  uint64_t start = HOST_nowNs();
+  for(uint32_t r = 0; r < repeats; r++)
+  {
+    for(uint32_t n = 0; n < count; n++)
+    {
+      uint8_t* packet = &packets[n * PACKET_SIZE];
+      if(useView)
+      {
+        reportView_t view;
+        API_C2_viewReport(packet, &view);
+        checksum += API_C2_viewContactFlags(&view) + API_C2_viewButtons(&view);
+      }
+      else
+      {
+        report_t report;
+        API_C2_decodeReport(packet, &report);
+        checksum += report.abs.contactFlags + report.abs.buttons;
+      }
+    }
+  }
+  uint64_t elapsed = HOST_nowNs() - start;
+  sink_g = checksum;
+  return (double)elapsed / ((double)count * repeats);
+}
+
+/************************************************************/
+/************************************************************/
+/************************** MAIN ****************************/
+
+int main(int argc, char** argv)
+{
+  uint32_t count = 4096, repeats = 500;
+  int opt;
+  while((opt = getopt(argc, argv, "n:r:h")) != -1)
+  {
+    switch(opt)
+    {
+      case 'n': count = (uint32_t)strtoul(optarg, NULL, 0); break;
+      case 'r': repeats = (uint32_t)strtoul(optarg, NULL, 0); break;
+      default:
+        fprintf(stderr, "usage: %s [-n packets] [-r repeats]\n", argv[0]);
+        return 2;
+    }
+  }
+  if(count == 0 || repeats == 0)
+  {
+    return 2;
+  }
+
+  static const struct
+  {
+    const char* name;
+    uint8_t reportID;
+  } kinds[] =
+  {
+    { "mouse",        MOUSE_REPORT_ID },
+    { "keyboard",     KEYBOARD_REPORT_ID },
+    { "CRQ absolute", CRQ_ABSOLUTE_REPORT_ID },
+    { "PTP",          PTP_REPORT_ID },
+  };
+
+  uint8_t* packets = malloc((size_t)count * PACKET_SIZE);
+  int status = 0;
+
+  printf("%-14s %10s %10s %8s %12s %12s %8s\n", "report", "report ns", "view ns", "ratio",
+         "decode flags", "view flags", "ratio");
+  for(size_t k = 0; k < sizeof(kinds) / sizeof(kinds[0]); k++)
+  {
+    makePackets(kinds[k].reportID, packets, count);
+
+    // correctness first: the accessors, then the events found
+    report_t prevReport;
+    reportState_t prevState;
+    initPrevious(kinds[k].reportID, &prevReport, &prevState);
+    for(uint32_t n = 0; n < count; n++)
+    {
+      uint8_t* packet = &packets[n * PACKET_SIZE];
+      if(!sameAsDecode(packet))
+      {
+        fprintf(stderr, "%s packet %u: view differs from API_C2_decodeReport\n", kinds[k].name, n);
+        status = 1;
+        break;
+      }
+      if(reportEvents(packet, &prevReport) != viewEvents(packet, &prevState))
+      {
+        fprintf(stderr, "%s packet %u: view path finds other events\n", kinds[k].name, n);
+        status = 1;
+        break;
+      }
+    }
+
+    double reportNs = timeReports(kinds[k].reportID, packets, count, repeats);
+    double viewNs = timeViews(kinds[k].reportID, packets, count, repeats);
+    if(kinds[k].reportID == CRQ_ABSOLUTE_REPORT_ID || kinds[k].reportID == PTP_REPORT_ID)
+    {
+      double decodeFlagsNs = timeFlags(false, packets, count, repeats);
+      double viewFlagsNs = timeFlags(true, packets, count, repeats);
+      printf("%-14s %10.1f %10.1f %7.2fx %12.1f %12.1f %7.2fx\n", kinds[k].name, reportNs, viewNs,
+             reportNs / viewNs, decodeFlagsNs, viewFlagsNs, decodeFlagsNs / viewFlagsNs);
+    }
+    else
+    {
+      printf("%-14s %10.1f %10.1f %7.2fx %12s %12s %8s\n", kinds[k].name, reportNs, viewNs,
+             reportNs / viewNs, "-", "-", "-");
+    }
+  }
+
+  // The sketch's queue entries were packet, report_t and timestamp; now packet and timestamp
+  struct { uint8_t packet[PACKET_SIZE]; report_t report; uint32_t timestamp; } oldEntry;
+  struct { uint8_t packet[PACKET_SIZE]; uint32_t timestamp; } newEntry;
+  size_t oldBytes = QUEUE_DEPTH * sizeof(oldEntry) + 3 * sizeof(report_t);
+  size_t newBytes = QUEUE_DEPTH * sizeof(newEntry) + 3 * sizeof(reportState_t);
+  printf("\nsizeof report_t %zu, reportState_t %zu, reportView_t %zu\n",
+         sizeof(report_t), sizeof(reportState_t), sizeof(reportView_t));
+  printf("sketch RAM (queue of %d + 3 previous): %zu bytes with report_t, %zu with views, %zu saved\n",
+         QUEUE_DEPTH, oldBytes, newBytes, oldBytes - newBytes);
+
+  free(packets);
+  return status;
+}
@@ -0,0 +1,398 @@
+// Copyright (c) 2018 Cirque Corp. Restrictions apply. See: www.cirque.com/sw-license
+
+/** gen4watch - runs the register watch (API_C2_Watch.h) against a simulated
+	pad (SimGen4.h) in real time, and compares what watching registers costs
+	the reports with plain API_C2_readRegister polling.
+
+	The pad sends a report every scan (-s), a little early or late at random
+	(-j), as with a finger down. The loop does what the sketch's reportTask
+	does when DR asserts, and in between does the register work of the
+	phase. Every transfer holds the loop for as long as it takes at 400 kHz
+	(SIMBUS_setTransferHook), with the pad running meanwhile, so a report
+	can come due part way through a register read and wait for it. Three
+	phases of -d seconds each:
+
+	    none     no register reads, the reports' own wait
+	    poll     each register read with API_C2_readRegister when due and
+	             DR is not asserted: the obvious low priority task
+	    watch    API_C2_watchPoll when API_C2_watchDue
+
+	Both poll and watch read the sketch's watch list (watchList_g) every -p
+	ms. During each the test pokes a new value into one of the registers
+	every CHANGE_PERIODS periods, and checks that each poke is seen, with
+	the right old and new value, within a period and a scan.
+
+	For each phase it prints the time from DR asserting to the report read
+	starting, and the register reads and bus bytes they took. Exits non-zero
+	if the watch missed or misreported a change, made more events than
+	there were changes, did not coalesce, or held up more than 1% of its
+	delayed reports for longer than WATCH_MAX_DELAY_US.
+
+	usage: gen4watch [-d seconds] [-s scan_us] [-j jitter_us] [-p period_ms] */
+
+#define _GNU_SOURCE
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "API_C2.h"
+#include "API_C2_Watch.h"
+#include "API_Hardware.h"
+#include "HostSynth.h"
+#include "HostUtil.h"
+#include "SimBus.h"
+#include "SimGen4.h"
+#include "SimHardware.h"
+
+#define REGISTERS       (4)
+#define CHANGE_PERIODS  (5)       /**< Periods from one poke to the next */
+#define SLACK_US        (2000)    /**< Host scheduling allowance on the bounds */
+#define WAITED_US       (50)      /**< A report that waited longer was held up */
+
+#define PHASE_NONE      (0)
+#define PHASE_POLL      (1)
+#define PHASE_WATCH     (2)
+#define PHASES          (3)
+
+/** The sketch's watch list (watchList_g), at the period given with -p */
+static const uint32_t addresses_g[REGISTERS] = { REG_FEED_CONFIG_1, 0xC2C7, REG_VENDOR_ID, 0xC2DF };
+static const char* const phaseNames_g[PHASES] = { "none", "poll", "watch" };
+
+static simGen4_t pad_g;
+
+/** The pad's side: the reports and the register pokes */
+typedef struct
+{
+  synth_t  synth;
+  uint32_t scanUs;
+  uint32_t jitterUs;
+  uint32_t nextScanUs;
+  bool     poking;
+  uint32_t pokes;
+  uint32_t changes;               /**< Pokes of registers whose last change had been seen */
+  uint32_t nextPokeUs;
+  uint32_t pokeUs[REGISTERS];     /**< When the change not yet seen was made, per register */
+  uint8_t  previous[REGISTERS];
+  bool     pending[REGISTERS];
+} padModel_t;
+
+typedef struct
+{
+  uint32_t reports;
+  uint32_t waited;                /**< Reports that waited over WAITED_US */
+  uint64_t totalUs;
+  uint32_t maxUs;
+  uint32_t reads;                 /**< Register transfers: reads for poll, bursts for watch */
+  uint32_t registers;             /**< Register values read */
+  uint64_t busBits;               /**< Bus time of the register work */
+  uint32_t changes;               /**< Pokes */
+  uint32_t seen;                  /**< Pokes seen with the right values */
+  uint32_t wrong;                 /**< Events with the wrong values, or for no poke */
+  uint32_t late;                  /**< Seen, but later than a period and a scan */
+  uint32_t missed;
+  uint32_t maxSeenUs;
+} phaseResult_t;
+
+static padModel_t model_g;
+static phaseResult_t results_g[PHASES];
+static uint32_t periodUs_g;
+
+static void usage(const char* argv0)
+{
+  fprintf(stderr,
+          "usage: %s [-d seconds] [-s scan_us] [-j jitter_us] [-p period_ms]\n"
+          "  -d  length of each phase (default 3)\n"
+          "  -s  pad scan period (default 8000)\n"
+          "  -j  most a report is early or late (default 200)\n"
+          "  -p  register polling period (default 20)\n",
+          argv0);
+}
+
+static bool dataReady(const void* context)
+{
+  return SIMGEN4_dataReady((const simGen4_t*)context);
+}
+
+static uint64_t busBits(void)
+{
+  simBusStats_t* stats = SIMBUS_getStats();
+  return 9ull * ((uint64_t)stats->bytesRead + stats->bytesWritten + stats->readTransactions + stats->writeTransactions);
+}
+
+/** Steps the pad to now: a report every scan, and in the poll and watch
+	phases a new value in the next register every CHANGE_PERIODS periods */
+static void stepPad(uint32_t now)
+{
+  padModel_t* m = &model_g;
+  if((int32_t)(now - m->nextScanUs) >= 0)
+  {
+    uint8_t packet[PACKET_SIZE];
+    SYNTH_nextPacket(&m->synth, packet);
+    SIMGEN4_queuePacket(&pad_g, packet);
+    int32_t jitter = m->jitterUs ? (int32_t)(rand() % (2 * m->jitterUs + 1)) - (int32_t)m->jitterUs : 0;
+    m->nextScanUs += m->scanUs + jitter;
+  }
+  if(m->poking && (int32_t)(now - m->nextPokeUs) >= 0)
+  {
+    uint8_t r = m->pokes++ % REGISTERS;
+    uint8_t* value = &pad_g.memory[addresses_g[r] & 0xFFFF];
+    if(!m->pending[r])
+    {
+      m->previous[r] = *value;
+      m->pending[r] = true;
+      m->pokeUs[r] = now;
+      m->changes++;
+    }
+    *value = (uint8_t)(*value + 0x11);
+    m->nextPokeUs += CHANGE_PERIODS * periodUs_g / REGISTERS;
+  }
+}
+
+static void stepWorld(void)
+{
+  stepPad(API_Hardware_micros());
+  SIMHW_poll();     // stamps a DR edge the pad just made
+}
+
+/** SimBus transfer hook: holds the loop for as long as the bus traffic
+	since the last call takes, with the world running meanwhile */
+static void holdForBus(void)
+{
+  static uint64_t lastBits = 0;
+  uint64_t bits = busBits();
+  uint64_t until = HOST_nowNs() + (bits - lastBits) * 1000000000ull / SIMBUS_getStats()->clockFrequency;
+  lastBits = bits;
+  while(HOST_nowNs() < until)
+  {
+    stepWorld();
+  }
+}
+
+/** Checks an event against the pokes: the register's first read must see
+	its value as set up, every other event a poke not yet seen */
+static void checkEvent(phaseResult_t* result, const watchEvent_t* event, uint32_t now)
+{
+  padModel_t* m = &model_g;
+  uint8_t r = 0;
+  while(r < REGISTERS && addresses_g[r] != event->address)
+  {
+    r++;
+  }
+  if(r == REGISTERS || event->length != 1)
+  {
+    result->wrong++;
+    return;
+  }
+  if(event->flags & WATCH_EVENT_FIRST)
+  {
+    // a poke made before the first read is seen as the first value
+    if(event->value != pad_g.memory[event->address & 0xFFFF])
+    {
+      result->wrong++;
+    }
+    m->pending[r] = false;
+    return;
+  }
+  if(!m->pending[r] || event->previous != m->previous[r] || event->value != pad_g.memory[event->address & 0xFFFF])
+  {
+    result->wrong++;
+    m->pending[r] = false;
+    return;
+  }
+  uint32_t seenUs = now - m->pokeUs[r];
+  result->seen++;
+  result->late += seenUs > periodUs_g + m->scanUs + SLACK_US ? 1 : 0;
+  result->maxSeenUs = seenUs > result->maxSeenUs ? seenUs : result->maxSeenUs;
+  m->pending[r] = false;
+}
+
+/** The poll phase's register task: one API_C2_readRegister per run, with
+	the last value of each kept to make the same events the watch does */
+static bool pollRegisters(phaseResult_t* result, uint32_t* dueUs, uint32_t* values, bool* valid, uint32_t now)
+{
+  for(uint8_t r = 0; r < REGISTERS; r++)
+  {
+    if((int32_t)(now - dueUs[r]) < 0)
+    {
+      continue;
+    }
+    uint64_t bits = busBits();
+    uint32_t value = API_C2_readRegister(addresses_g[r]);
+    result->busBits += busBits() - bits;
+    result->reads++;
+    result->registers++;
+    dueUs[r] = now + periodUs_g;
+    if(!valid[r] || value != values[r])
+    {
+      watchEvent_t event = { addresses_g[r], 1, valid[r] ? 0 : WATCH_EVENT_FIRST, values[r], value, now };
+      checkEvent(result, &event, API_Hardware_micros());
+    }
+    values[r] = value;
+    valid[r] = true;
+    return true;
+  }
+  return false;
+}
+
+static void runPhase(uint8_t phase, uint32_t seconds)
+{
+  phaseResult_t* result = &results_g[phase];
+  padModel_t* m = &model_g;
+  uint32_t dueUs[REGISTERS], values[REGISTERS];
+  bool valid[REGISTERS] = { false };
+  uint32_t start = API_Hardware_micros();
+  uint32_t end = start + seconds * 1000000u;
+  uint32_t pokesEnd = end - 3 * (periodUs_g + m->scanUs);
+  uint32_t lastReadUs = 0;
+
+  memset(m->pending, 0, sizeof(m->pending));
+  m->changes = 0;
+  m->poking = phase != PHASE_NONE;
+  m->nextPokeUs = start + 2 * periodUs_g;
+  for(uint8_t r = 0; r < REGISTERS; r++)
+  {
+    dueUs[r] = start;
+  }
+  if(phase == PHASE_WATCH)
+  {
+    API_C2_watchClear();
+    for(uint8_t r = 0; r < REGISTERS; r++)
+    {
+      API_C2_watchAdd(addresses_g[r], 1, (uint16_t)(periodUs_g / 1000), start);
+    }
+    API_C2_resetWatchStats();
+    API_C2_watchEnable(true);
+  }
+
+  while((int32_t)(API_Hardware_micros() - end) < 0)
+  {
+    stepWorld();
+    uint32_t now = API_Hardware_micros();
+    m->poking = m->poking && (int32_t)(now - pokesEnd) < 0;
+    if(API_C2_DR_Asserted())
+    {
+      // as reportTask: ready from the DR edge, or the last read if DR stayed asserted
+      uint32_t readyUs = HostDR_assertedUs();
+      uint8_t packet[PACKET_SIZE];
+      if((int32_t)(lastReadUs - readyUs) > 0)
+      {
+        readyUs = lastReadUs;
+      }
+      uint32_t waitUs = API_Hardware_micros() - readyUs;
+      API_C2_readReportPacket(packet);
+      lastReadUs = API_Hardware_micros();
+      if(phase == PHASE_WATCH)
+      {
+        API_C2_watchReport(readyUs, lastReadUs);
+      }
+      result->reports++;
+      result->totalUs += waitUs;
+      result->maxUs = waitUs > result->maxUs ? waitUs : result->maxUs;
+      result->waited += waitUs > WAITED_US ? 1 : 0;
+    }
+    else if(phase == PHASE_POLL)
+    {
+      pollRegisters(result, dueUs, values, valid, now);
+    }
+    else if(phase == PHASE_WATCH && API_C2_watchDue(now))
+    {
+      uint64_t bits = busBits();
+      API_C2_watchPoll(now);
+      result->busBits += busBits() - bits;
+    }
+    watchEvent_t event;
+    while(API_C2_takeWatchEvent(&event))
+    {
+      checkEvent(result, &event, event.timestamp);
+    }
+  }
+  API_C2_watchEnable(false);
+  result->changes = m->changes;
+  for(uint8_t r = 0; r < REGISTERS; r++)
+  {
+    result->missed += m->pending[r] ? 1 : 0;
+  }
+  if(phase == PHASE_WATCH)
+  {
+    result->reads = API_C2_getWatchStats()->bursts;
+    result->registers = API_C2_getWatchStats()->registers;
+  }
+}
+
+/************************************************************/
+/************************************************************/
+/************************** MAIN ****************************/
+
+int main(int argc, char** argv)
+{
+  uint32_t seconds = 3, periodMs = 20;
+  int opt;
+
+  model_g.scanUs = 8000;
+  model_g.jitterUs = 200;
+  while((opt = getopt(argc, argv, "d:s:j:p:h")) != -1)
+  {
+    switch(opt)
+    {
+      case 'd': seconds = (uint32_t)strtoul(optarg, NULL, 0); break;
+      case 's': model_g.scanUs = (uint32_t)strtoul(optarg, NULL, 0); break;
+      case 'j': model_g.jitterUs = (uint32_t)strtoul(optarg, NULL, 0); break;
+      case 'p': periodMs = (uint32_t)strtoul(optarg, NULL, 0); break;
+      default: usage(argv[0]); return 2;
+    }
+  }
+  periodUs_g = periodMs * 1000u;
+  if(seconds == 0 || seconds > 600 || model_g.scanUs < 2000 || model_g.scanUs > 20000
+     || model_g.jitterUs * 4 > model_g.scanUs || periodMs < 2 || periodMs > 1000
+     || 3 * (periodUs_g + model_g.scanUs) >= seconds * 1000000u)
+  {
+    usage(argv[0]);
+    return 2;
+  }
+
+  srand(1);
+  SIMGEN4_init(&pad_g, CIRQUE_SLAVE_ADDR);
+  for(uint8_t r = 0; r < REGISTERS; r++)
+  {
+    pad_g.memory[addresses_g[r] & 0xFFFF] = (uint8_t)(0x10 * r + 1);
+  }
+  SIMBUS_detachAll();
+  SIMBUS_attach(&pad_g.device);
+  SIMHW_setDataReady(dataReady, &pad_g);
+  SIMBUS_setTransferHook(holdForBus);
+  API_Hardware_init();
+  API_Hardware_PowerOn();
+  API_C2_init(400000, CIRQUE_SLAVE_ADDR);
+  SYNTH_init(&model_g.synth, CRQ_ABSOLUTE_REPORT_ID, model_g.scanUs, 1);
+  model_g.nextScanUs = API_Hardware_micros();
+
+  for(uint8_t phase = 0; phase < PHASES; phase++)
+  {
+    runPhase(phase, seconds);
+  }
+
+  const watchStats_t* stats = API_C2_getWatchStats();
+  printf("%u s per phase, scan %u us +-%u, %u registers every %u ms, 400 kHz\n", seconds, model_g.scanUs,
+         model_g.jitterUs, REGISTERS, periodMs);
+  printf("%-6s %7s %7s %6s %6s | %6s %6s %7s | %7s %5s %5s %5s %6s %8s\n", "phase", "reports", "waited", "mean", "max",
+         "reads", "regs", "bus us", "changes", "seen", "wrong", "late", "missed", "max seen");
+  for(uint8_t phase = 0; phase < PHASES; phase++)
+  {
+    phaseResult_t* r = &results_g[phase];
+    printf("%-6s %7u %7u %6u %6u | %6u %6u %7llu | %7u %5u %5u %5u %6u %8u\n", phaseNames_g[phase], r->reports,
+           r->waited, r->reports ? (uint32_t)(r->totalUs / r->reports) : 0, r->maxUs, r->reads, r->registers,
+           (unsigned long long)(r->busBits * 1000000ull / 400000u), r->changes, r->seen, r->wrong, r->late,
+           r->missed, r->maxSeenUs);
+  }
+  printf("watch: %u waits for a gap, max late %u us, max burst %u us, %u ns/byte; "
+         "%u reports delayed, mean %u max %u us, %u over the %u us cap\n",
+         stats->deferrals, stats->maxLateUs, stats->maxBurstUs, API_C2_watchNsPerByte(), stats->reportsDelayed,
+         API_C2_watchMeanDelayUs(stats), stats->maxDelayUs, stats->overCap, WATCH_MAX_DELAY_US);
+
+  phaseResult_t* w = &results_g[PHASE_WATCH];
+  bool bad = w->wrong != 0 || w->missed != 0 || w->seen != w->changes || w->late * 100 > w->seen
+             || w->reads >= w->registers || stats->overCap * 100 > stats->reportsDelayed + 99
+             || stats->eventsDropped != 0;
+  return bad ? 1 : 0;
+}